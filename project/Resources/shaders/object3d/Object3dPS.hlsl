@@ -1,5 +1,19 @@
 #include "Object3d.hlsli"
 
+// @\L[[hBLȑgݍ킹Ƃɕʂ̃VF[_[ƂăRpCA`悲ƂɃ}eA̐ݒőI
+// @keyword LIGHTING
+// @keyword HALF_LAMBERT requires LIGHTING
+// @keyword ALPHA_TEST
+#ifndef LIGHTING
+#define LIGHTING 0
+#endif
+#ifndef HALF_LAMBERT
+#define HALF_LAMBERT 0
+#endif
+#ifndef ALPHA_TEST
+#define ALPHA_TEST 0
+#endif
+
 Texture2D<float4> gTexture : register(t0);
 SamplerState gSampler : register(s0);
 
@@ -8,11 +22,20 @@ struct Material
     float4 color;
     int enableLighting;
     int shadingType; // 0: Lambert, 1: HalfLambert
-    float2 padding;
+    int alphaTest;
+    float padding;
     float4x4 uvTransform;
 };
 
-ConstantBuffer<Material> gMaterial : register(b0);
+// S}eA̕\B`悲ƂɎgԍ[g萔Ŏ󂯎
+StructuredBuffer<Material> gMaterials : register(t1);
+
+struct DrawConstants
+{
+    uint materialIndex;
+};
+
+ConstantBuffer<DrawConstants> gDrawConstants : register(b0);
 
 struct DirectionalLight
 {
@@ -31,54 +54,33 @@ struct PixelShaderOutput
 PixelShaderOutput main(VertexShaderOutput input)
 {
     PixelShaderOutput output;
-    float4 transformedUV = mul(float4(input.texcoord, 0.0f, 1.0f), gMaterial.uvTransform);
+    Material material = gMaterials[gDrawConstants.materialIndex];
+    float4 transformedUV = mul(float4(input.texcoord, 0.0f, 1.0f), material.uvTransform);
     float4 textureColor = gTexture.Sample(gSampler, transformedUV.xy);
 
-    float4 baseColor = gMaterial.color * textureColor;
+    float4 baseColor = material.color * textureColor;
 
-    if (gMaterial.enableLighting != 0)
-    {
-        float NdotL = dot(normalize(input.normal), -gDirectionalLight.direction);
-
-        float lighting = 1.0f;
-        if (gMaterial.shadingType == 0)
-        { // Lambert
-            lighting = max(NdotL, 0.0f);
-        }
-        else
-        { // HalfLambert
-            lighting = NdotL * 0.5f + 0.5f;
-        }
+    // enableLightingEshadingTypeEalphaTest̓oAg̑IɎgAł͕򂵂Ȃ
+#if LIGHTING
+    float NdotL = dot(normalize(input.normal), -gDirectionalLight.direction);
+#if HALF_LAMBERT
+    float lighting = NdotL * 0.5f + 0.5f;
+#else
+    float lighting = max(NdotL, 0.0f);
+#endif
+    output.color.rgb = baseColor.rgb * gDirectionalLight.color.rgb * lighting * gDirectionalLight.intensity;
+    output.color.a = baseColor.a;
+#else
+    output.color = baseColor;
+#endif
 
-        // ÕR[h
-        //output.color = baseColor * gDirectionalLight.color * lighting * gDirectionalLight.intensity;
-        
-        output.color = gMaterial.color * textureColor * gDirectionalLight.color * lighting * gDirectionalLight.intensity;
-        output.color.rgb = gMaterial.color.rgb * textureColor.rgb * gDirectionalLight.color.rgb  * gDirectionalLight.intensity;
-        output.color.a = gMaterial.color.a * textureColor.a;
-    }
-    else
-    {
-        output.color = baseColor;
-    }
-    
-    // output.color̃l0̂ƂsNZp
-    if (output.color.a == 0.0f)
-    {
-        discard;
-    }
-    
-    // textureColor̃l0̂ƂsNZp
-    if (textureColor.a == 0.0f)
+#if ALPHA_TEST
+    // eNX`̃l0.5ȉAŏIIȃl0̂ƂsNZp
+    if (textureColor.a <= 0.5f || output.color.a == 0.0f)
     {
         discard;
     }
-    
-    // textureColor̃l0.5ȉ̂ƂsNZp
-    if (textureColor.a <= 0.5f)
-    {
-        discard;
-    }
-    
+#endif
+
     return output;
 }
\ No newline at end of file
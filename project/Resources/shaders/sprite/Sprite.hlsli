@@ -0,0 +1,7 @@
+﻿// SpriteBatchの板。色はテクスチャに掛ける
+struct VertexShaderOutput
+{
+    float4 position : SV_POSITION;
+    float2 texcoord : TEXCOORD0;
+    float4 color : COLOR0;
+};
@@ -0,0 +1,25 @@
+#include "Sprite.hlsli"
+
+struct TransformationMatrix
+{
+    float4x4 WVP;
+    float4x4 World;
+};
+
+ConstantBuffer<TransformationMatrix> gTransformationMatrix : register(b0);
+
+struct VertexShaderInput
+{
+    float2 position : POSITION0;
+    float2 texcoord : TEXCOORD0;
+    float4 color : COLOR0;
+};
+
+VertexShaderOutput main(VertexShaderInput input)
+{
+    VertexShaderOutput output;
+    output.position = mul(float4(input.position, 0.0f, 1.0f), gTransformationMatrix.WVP);
+    output.texcoord = input.texcoord;
+    output.color = input.color;
+    return output;
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+#include "Skeleton.h"
+#include <cassert>
+
+int32_t Skeleton::AddJoint(const std::string& name, int32_t parent, const Transform& bindPose)
+{
+    assert(parent < static_cast<int32_t>(joints.size()));
+    joints.push_back({ name, parent, bindPose, bindPose });
+    return static_cast<int32_t>(joints.size()) - 1;
+}
+
+void Skeleton::Finalize()
+{
+    std::vector<Matrix4x4> bindWorld(joints.size());
+    inverseBindMatrices_.resize(joints.size());
+    for (size_t i = 0; i < joints.size(); ++i) {
+        const Joint& joint = joints[i];
+        Matrix4x4 local = MakeAffineMatrix(joint.bindPose.scale, joint.bindPose.rotate, joint.bindPose.translate);
+        bindWorld[i] = joint.parent < 0 ? local : Multiply(local, bindWorld[joint.parent]);
+        inverseBindMatrices_[i] = Inverse(bindWorld[i]);
+    }
+}
+
+void Skeleton::UpdatePalette(std::vector<Matrix4x4>& palette) const
+{
+    assert(inverseBindMatrices_.size() == joints.size());
+
+    // 親が先に並んでいるので前から順に積めばワールド行列になる
+    std::vector<Matrix4x4> world(joints.size());
+    palette.resize(joints.size());
+    for (size_t i = 0; i < joints.size(); ++i) {
+        const Joint& joint = joints[i];
+        Matrix4x4 local = MakeAffineMatrix(joint.localPose.scale, joint.localPose.rotate, joint.localPose.translate);
+        world[i] = joint.parent < 0 ? local : Multiply(local, world[joint.parent]);
+        palette[i] = Multiply(inverseBindMatrices_[i], world[i]);
+    }
+}
@@ -0,0 +1,266 @@
+#include "SkinningEngine.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SKINNING_ENGINE_SSE2
+#endif
+
+namespace {
+
+// 1チャンクの最小頂点数(小さすぎるとスレッドの受け渡しの方が高くつく)
+constexpr uint32_t kMinVerticesPerChunk = 256;
+
+void Normalize3(float* v)
+{
+    float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    if (length > 0.0f) {
+        float inverse = 1.0f / length;
+        v[0] *= inverse;
+        v[1] *= inverse;
+        v[2] *= inverse;
+    }
+}
+
+// クォータニオンの積 a * b (x, y, z, w)
+void QuaternionMultiply(const float* a, const float* b, float* result)
+{
+    result[0] = a[3] * b[0] + a[0] * b[3] + a[1] * b[2] - a[2] * b[1];
+    result[1] = a[3] * b[1] - a[0] * b[2] + a[1] * b[3] + a[2] * b[0];
+    result[2] = a[3] * b[2] + a[0] * b[1] - a[1] * b[0] + a[2] * b[3];
+    result[3] = a[3] * b[3] - a[0] * b[0] - a[1] * b[1] - a[2] * b[2];
+}
+
+// 行ベクトル形式(v * M)の回転部分からクォータニオンを作る
+void QuaternionFromMatrix(const Matrix4x4& m, float* q)
+{
+    // スケールを取り除いた回転行列を列ベクトル形式(c[i][j] = m[j][i])で扱う
+    float rows[3][3];
+    for (int i = 0; i < 3; ++i) {
+        rows[i][0] = m.m[i][0];
+        rows[i][1] = m.m[i][1];
+        rows[i][2] = m.m[i][2];
+        Normalize3(rows[i]);
+    }
+    auto c = [&](int i, int j) { return rows[j][i]; };
+
+    float trace = c(0, 0) + c(1, 1) + c(2, 2);
+    if (trace > 0.0f) {
+        float s = std::sqrt(trace + 1.0f) * 2.0f;
+        q[3] = 0.25f * s;
+        q[0] = (c(2, 1) - c(1, 2)) / s;
+        q[1] = (c(0, 2) - c(2, 0)) / s;
+        q[2] = (c(1, 0) - c(0, 1)) / s;
+    } else if (c(0, 0) > c(1, 1) && c(0, 0) > c(2, 2)) {
+        float s = std::sqrt(1.0f + c(0, 0) - c(1, 1) - c(2, 2)) * 2.0f;
+        q[3] = (c(2, 1) - c(1, 2)) / s;
+        q[0] = 0.25f * s;
+        q[1] = (c(0, 1) + c(1, 0)) / s;
+        q[2] = (c(0, 2) + c(2, 0)) / s;
+    } else if (c(1, 1) > c(2, 2)) {
+        float s = std::sqrt(1.0f + c(1, 1) - c(0, 0) - c(2, 2)) * 2.0f;
+        q[3] = (c(0, 2) - c(2, 0)) / s;
+        q[0] = (c(0, 1) + c(1, 0)) / s;
+        q[1] = 0.25f * s;
+        q[2] = (c(1, 2) + c(2, 1)) / s;
+    } else {
+        float s = std::sqrt(1.0f + c(2, 2) - c(0, 0) - c(1, 1)) * 2.0f;
+        q[3] = (c(1, 0) - c(0, 1)) / s;
+        q[0] = (c(0, 2) + c(2, 0)) / s;
+        q[1] = (c(1, 2) + c(2, 1)) / s;
+        q[2] = 0.25f * s;
+    }
+}
+
+// 単位クォータニオンでベクトルを回転する
+void QuaternionRotate(const float* q, const float* v, float* result)
+{
+    // t = 2 * cross(q.xyz, v), v' = v + w * t + cross(q.xyz, t)
+    float tx = 2.0f * (q[1] * v[2] - q[2] * v[1]);
+    float ty = 2.0f * (q[2] * v[0] - q[0] * v[2]);
+    float tz = 2.0f * (q[0] * v[1] - q[1] * v[0]);
+    result[0] = v[0] + q[3] * tx + (q[1] * tz - q[2] * ty);
+    result[1] = v[1] + q[3] * ty + (q[2] * tx - q[0] * tz);
+    result[2] = v[2] + q[3] * tz + (q[0] * ty - q[1] * tx);
+}
+
+} // namespace
+
+SkinningEngine::SkinningEngine(ThreadPool* threadPool)
+    : threadPool_(threadPool)
+{
+}
+
+uint32_t SkinningEngine::GetMaxThreadCount() const
+{
+    return threadPool_ ? threadPool_->GetThreadCount() + 1 : 1;
+}
+
+void SkinningEngine::Skin(const SkinVertexData* input, uint32_t vertexCount, const std::vector<Matrix4x4>& palette,
+    VertexData* output, SkinningMode mode)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    if (mode == SkinningMode::DualQuaternion) {
+        // 関節ごとに一度だけ変換しておく
+        dualQuaternions_.resize(palette.size());
+        for (size_t i = 0; i < palette.size(); ++i) {
+            DualQuaternion& dq = dualQuaternions_[i];
+            QuaternionFromMatrix(palette[i], dq.real);
+            float translation[4] = { palette[i].m[3][0], palette[i].m[3][1], palette[i].m[3][2], 0.0f };
+            QuaternionMultiply(translation, dq.real, dq.dual);
+            for (float& d : dq.dual) {
+                d *= 0.5f;
+            }
+        }
+    }
+
+    // スレッド数から分割の粒度を決める
+    uint32_t threadCount = std::clamp(threadCount_ == 0 ? GetMaxThreadCount() : threadCount_, 1u, GetMaxThreadCount());
+    uint32_t grainSize = std::max(kMinVerticesPerChunk, (vertexCount + threadCount - 1) / threadCount);
+
+    auto skinRange = [&](uint32_t begin, uint32_t end) {
+        if (mode == SkinningMode::DualQuaternion) {
+            SkinDualQuaternion(input, begin, end, output);
+        } else {
+            SkinLinearBlend(input, begin, end, palette.data(), output);
+        }
+    };
+    if (threadPool_ != nullptr && threadCount > 1) {
+        threadPool_->ParallelFor(vertexCount, grainSize, skinRange);
+    } else {
+        skinRange(0, vertexCount);
+    }
+
+    stats_.vertexCount = vertexCount;
+    stats_.threadCount = std::min(threadCount, (vertexCount + grainSize - 1) / grainSize);
+    stats_.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    stats_.verticesPerSecond = stats_.milliseconds > 0.0 ? vertexCount / (stats_.milliseconds * 0.001) : 0.0;
+}
+
+void SkinningEngine::SkinLinearBlend(const SkinVertexData* input, uint32_t begin, uint32_t end, const Matrix4x4* palette, VertexData* output) const
+{
+    for (uint32_t i = begin; i < end; ++i) {
+        const SkinVertexData& vertex = input[i];
+        VertexData& result = output[i];
+        float normal[4];
+
+#ifdef SKINNING_ENGINE_SSE2
+        // 影響する行列を重みで混ぜる(4行を4レーンずつ)
+        __m128 row0 = _mm_setzero_ps();
+        __m128 row1 = _mm_setzero_ps();
+        __m128 row2 = _mm_setzero_ps();
+        __m128 row3 = _mm_setzero_ps();
+        for (int k = 0; k < 4; ++k) {
+            float weight = vertex.weights[k];
+            if (weight == 0.0f) {
+                continue;
+            }
+            const Matrix4x4& m = palette[vertex.jointIndices[k]];
+            __m128 w = _mm_set1_ps(weight);
+            row0 = _mm_add_ps(row0, _mm_mul_ps(w, _mm_loadu_ps(m.m[0])));
+            row1 = _mm_add_ps(row1, _mm_mul_ps(w, _mm_loadu_ps(m.m[1])));
+            row2 = _mm_add_ps(row2, _mm_mul_ps(w, _mm_loadu_ps(m.m[2])));
+            row3 = _mm_add_ps(row3, _mm_mul_ps(w, _mm_loadu_ps(m.m[3])));
+        }
+
+        // v * M
+        __m128 position = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(_mm_set1_ps(vertex.position.x), row0), _mm_mul_ps(_mm_set1_ps(vertex.position.y), row1)),
+            _mm_add_ps(_mm_mul_ps(_mm_set1_ps(vertex.position.z), row2), _mm_mul_ps(_mm_set1_ps(vertex.position.w), row3)));
+        __m128 skinnedNormal = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(_mm_set1_ps(vertex.normal.x), row0), _mm_mul_ps(_mm_set1_ps(vertex.normal.y), row1)),
+            _mm_mul_ps(_mm_set1_ps(vertex.normal.z), row2));
+        _mm_storeu_ps(&result.position.x, position);
+        _mm_storeu_ps(normal, skinnedNormal);
+#else
+        Matrix4x4 blended {};
+        for (int k = 0; k < 4; ++k) {
+            float weight = vertex.weights[k];
+            if (weight == 0.0f) {
+                continue;
+            }
+            const Matrix4x4& m = palette[vertex.jointIndices[k]];
+            for (int r = 0; r < 4; ++r) {
+                for (int c = 0; c < 4; ++c) {
+                    blended.m[r][c] += weight * m.m[r][c];
+                }
+            }
+        }
+        const Vector4& p = vertex.position;
+        const Vector3& n = vertex.normal;
+        result.position = {
+            p.x * blended.m[0][0] + p.y * blended.m[1][0] + p.z * blended.m[2][0] + p.w * blended.m[3][0],
+            p.x * blended.m[0][1] + p.y * blended.m[1][1] + p.z * blended.m[2][1] + p.w * blended.m[3][1],
+            p.x * blended.m[0][2] + p.y * blended.m[1][2] + p.z * blended.m[2][2] + p.w * blended.m[3][2],
+            p.x * blended.m[0][3] + p.y * blended.m[1][3] + p.z * blended.m[2][3] + p.w * blended.m[3][3],
+        };
+        normal[0] = n.x * blended.m[0][0] + n.y * blended.m[1][0] + n.z * blended.m[2][0];
+        normal[1] = n.x * blended.m[0][1] + n.y * blended.m[1][1] + n.z * blended.m[2][1];
+        normal[2] = n.x * blended.m[0][2] + n.y * blended.m[1][2] + n.z * blended.m[2][2];
+#endif
+        Normalize3(normal);
+        result.texcoord = vertex.texcoord;
+        result.normal = { normal[0], normal[1], normal[2] };
+    }
+}
+
+void SkinningEngine::SkinDualQuaternion(const SkinVertexData* input, uint32_t begin, uint32_t end, VertexData* output) const
+{
+    for (uint32_t i = begin; i < end; ++i) {
+        const SkinVertexData& vertex = input[i];
+
+        // 最初の関節と同じ半球にそろえてから混ぜる
+        float real[4] = {};
+        float dual[4] = {};
+        const DualQuaternion& pivot = dualQuaternions_[vertex.jointIndices[0]];
+        for (int k = 0; k < 4; ++k) {
+            float weight = vertex.weights[k];
+            if (weight == 0.0f) {
+                continue;
+            }
+            const DualQuaternion& dq = dualQuaternions_[vertex.jointIndices[k]];
+            float dot = pivot.real[0] * dq.real[0] + pivot.real[1] * dq.real[1] + pivot.real[2] * dq.real[2] + pivot.real[3] * dq.real[3];
+            if (dot < 0.0f) {
+                weight = -weight;
+            }
+            for (int c = 0; c < 4; ++c) {
+                real[c] += weight * dq.real[c];
+                dual[c] += weight * dq.dual[c];
+            }
+        }
+
+        float length = std::sqrt(real[0] * real[0] + real[1] * real[1] + real[2] * real[2] + real[3] * real[3]);
+        float inverseLength = length > 0.0f ? 1.0f / length : 0.0f;
+        for (int c = 0; c < 4; ++c) {
+            real[c] *= inverseLength;
+            dual[c] *= inverseLength;
+        }
+
+        // 平行移動 t = 2 * dual * conj(real)
+        float conjugate[4] = { -real[0], -real[1], -real[2], real[3] };
+        float translation[4];
+        QuaternionMultiply(dual, conjugate, translation);
+
+        float position[3] = { vertex.position.x, vertex.position.y, vertex.position.z };
+        float normal[3] = { vertex.normal.x, vertex.normal.y, vertex.normal.z };
+        float rotatedPosition[3];
+        float rotatedNormal[3];
+        QuaternionRotate(real, position, rotatedPosition);
+        QuaternionRotate(real, normal, rotatedNormal);
+
+        VertexData& result = output[i];
+        result.position = {
+            rotatedPosition[0] + 2.0f * translation[0],
+            rotatedPosition[1] + 2.0f * translation[1],
+            rotatedPosition[2] + 2.0f * translation[2],
+            vertex.position.w,
+        };
+        result.texcoord = vertex.texcoord;
+        result.normal = { rotatedNormal[0], rotatedNormal[1], rotatedNormal[2] };
+    }
+}
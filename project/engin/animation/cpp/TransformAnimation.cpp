@@ -0,0 +1,414 @@
+#include "TransformAnimation.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define TRANSFORM_ANIMATION_SSE2
+#endif
+
+static_assert(sizeof(Transform) == sizeof(float) * 9, "Transform must be 9 tightly packed floats");
+
+namespace {
+
+constexpr float kQuantizeMax = 65535.0f;
+constexpr float kPi = 3.14159265358979f;
+
+struct Quaternion {
+    float x, y, z, w;
+};
+
+// 積 a * b
+Quaternion Multiply(const Quaternion& a, const Quaternion& b)
+{
+    return {
+        a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+        a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+        a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+        a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z,
+    };
+}
+
+// MakeAffineMatrixと同じくX, Y, Zの順に回す
+Quaternion QuaternionFromEuler(const Vector3& rotate)
+{
+    Quaternion x = { std::sin(rotate.x * 0.5f), 0.0f, 0.0f, std::cos(rotate.x * 0.5f) };
+    Quaternion y = { 0.0f, std::sin(rotate.y * 0.5f), 0.0f, std::cos(rotate.y * 0.5f) };
+    Quaternion z = { 0.0f, 0.0f, std::sin(rotate.z * 0.5f), std::cos(rotate.z * 0.5f) };
+    return Multiply(z, Multiply(y, x));
+}
+
+#ifndef TRANSFORM_ANIMATION_SSE2
+Vector3 EulerFromQuaternion(const Quaternion& q)
+{
+    return {
+        std::atan2(2.0f * (q.w * q.x + q.y * q.z), 1.0f - 2.0f * (q.x * q.x + q.y * q.y)),
+        std::asin(std::clamp(2.0f * (q.w * q.y - q.z * q.x), -1.0f, 1.0f)),
+        std::atan2(2.0f * (q.w * q.z + q.x * q.y), 1.0f - 2.0f * (q.y * q.y + q.z * q.z)),
+    };
+}
+#endif
+
+// 球面線形補間の係数を多項式で求める(Eberly, "A Fast and Accurate Algorithm for Computing SLERP")
+// cosThetaは2つのクォータニオンの内積(0以上にそろえておく)。q0にweight0、q1にweight1を掛けて足すと補間になる
+constexpr float kSlerpMu = 1.85298109240830f;
+constexpr float kSlerpU[8] = { 1.0f / 3.0f, 1.0f / 10.0f, 1.0f / 21.0f, 1.0f / 36.0f, 1.0f / 55.0f, 1.0f / 78.0f, 1.0f / 105.0f, kSlerpMu / 136.0f };
+constexpr float kSlerpV[8] = { 1.0f / 3.0f, 2.0f / 5.0f, 3.0f / 7.0f, 4.0f / 9.0f, 5.0f / 11.0f, 6.0f / 13.0f, 7.0f / 15.0f, kSlerpMu * 8.0f / 17.0f };
+
+// tごとに決まる部分(u * t^2 - v)
+void SlerpTerms(float t, float* terms)
+{
+    for (int i = 0; i < 8; ++i) {
+        terms[i] = kSlerpU[i] * t * t - kSlerpV[i];
+    }
+}
+
+float SlerpWeight(float t, const float* terms, float cosTheta)
+{
+    const float xm1 = cosTheta - 1.0f;
+    float weight = 1.0f;
+    for (int i = 7; i >= 0; --i) {
+        weight = 1.0f + terms[i] * xm1 * weight;
+    }
+    return t * weight;
+}
+
+Quaternion Slerp(const Quaternion& q0, Quaternion q1, float t)
+{
+    float cosTheta = q0.x * q1.x + q0.y * q1.y + q0.z * q1.z + q0.w * q1.w;
+    // 最短の向きに回す
+    if (cosTheta < 0.0f) {
+        q1 = { -q1.x, -q1.y, -q1.z, -q1.w };
+        cosTheta = -cosTheta;
+    }
+    cosTheta = std::min(cosTheta, 1.0f);
+    float terms0[8];
+    float terms1[8];
+    SlerpTerms(1.0f - t, terms0);
+    SlerpTerms(t, terms1);
+    const float weight0 = SlerpWeight(1.0f - t, terms0, cosTheta);
+    const float weight1 = SlerpWeight(t, terms1, cosTheta);
+    Quaternion result = {
+        q0.x * weight0 + q1.x * weight1,
+        q0.y * weight0 + q1.y * weight1,
+        q0.z * weight0 + q1.z * weight1,
+        q0.w * weight0 + q1.w * weight1,
+    };
+    const float length = std::sqrt(result.x * result.x + result.y * result.y + result.z * result.z + result.w * result.w);
+    if (length > 0.0f) {
+        result = { result.x / length, result.y / length, result.z / length, result.w / length };
+    }
+    return result;
+}
+
+// キー列を時刻timeで挟む2つのキーと補間係数を求める
+template <class Key>
+bool FindKeys(const std::vector<Key>& keys, float time, size_t& index0, size_t& index1, float& t)
+{
+    if (keys.empty()) {
+        return false;
+    }
+    if (time <= keys.front().time) {
+        index0 = index1 = 0;
+        t = 0.0f;
+        return true;
+    }
+    if (time >= keys.back().time) {
+        index0 = index1 = keys.size() - 1;
+        t = 0.0f;
+        return true;
+    }
+    auto next = std::upper_bound(keys.begin(), keys.end(), time,
+        [](float value, const Key& key) { return value < key.time; });
+    index1 = static_cast<size_t>(next - keys.begin());
+    index0 = index1 - 1;
+    float span = keys[index1].time - keys[index0].time;
+    t = span > 0.0f ? (time - keys[index0].time) / span : 0.0f;
+    return true;
+}
+
+// キー列を時刻timeで線形補間する
+Vector3 EvaluateKeys(const std::vector<Keyframe>& keys, float time, const Vector3& defaultValue)
+{
+    size_t index0 = 0;
+    size_t index1 = 0;
+    float t = 0.0f;
+    if (!FindKeys(keys, time, index0, index1, t)) {
+        return defaultValue;
+    }
+    const Vector3& v0 = keys[index0].value;
+    const Vector3& v1 = keys[index1].value;
+    return {
+        v0.x + (v1.x - v0.x) * t,
+        v0.y + (v1.y - v0.y) * t,
+        v0.z + (v1.z - v0.z) * t,
+    };
+}
+
+// 回転のキー列をクォータニオンにして時刻timeで球面線形補間する
+Quaternion EvaluateRotation(const std::vector<Keyframe>& keys, float time)
+{
+    size_t index0 = 0;
+    size_t index1 = 0;
+    float t = 0.0f;
+    if (!FindKeys(keys, time, index0, index1, t)) {
+        return { 0.0f, 0.0f, 0.0f, 1.0f };
+    }
+    return Slerp(QuaternionFromEuler(keys[index0].value), QuaternionFromEuler(keys[index1].value), t);
+}
+
+float LastKeyTime(const std::vector<Keyframe>& keys)
+{
+    return keys.empty() ? 0.0f : keys.back().time;
+}
+
+#ifdef TRANSFORM_ANIMATION_SSE2
+__m128 Select(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// 4つ同時のatan2。atanは[0, tan(pi/8)]まで縮めてから多項式で求める(誤差は1e-6ラジアン程度)
+__m128 Atan2(__m128 y, __m128 x)
+{
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 ax = _mm_andnot_ps(signMask, x);
+    const __m128 ay = _mm_andnot_ps(signMask, y);
+    const __m128 larger = _mm_max_ps(ax, ay);
+    const __m128 a = _mm_div_ps(_mm_min_ps(ax, ay), _mm_max_ps(larger, _mm_set1_ps(1.0e-30f)));
+
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 reduce = _mm_cmpgt_ps(a, _mm_set1_ps(0.414213562f));
+    const __m128 z = Select(reduce, _mm_div_ps(_mm_sub_ps(a, one), _mm_add_ps(a, one)), a);
+    const __m128 z2 = _mm_mul_ps(z, z);
+    __m128 p = _mm_set1_ps(8.05374449538e-2f);
+    p = _mm_add_ps(_mm_mul_ps(p, z2), _mm_set1_ps(-1.38776856032e-1f));
+    p = _mm_add_ps(_mm_mul_ps(p, z2), _mm_set1_ps(1.99777106478e-1f));
+    p = _mm_add_ps(_mm_mul_ps(p, z2), _mm_set1_ps(-3.33329491539e-1f));
+    p = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(p, z2), z), z);
+    __m128 angle = Select(reduce, _mm_add_ps(p, _mm_set1_ps(kPi * 0.25f)), p);
+
+    // 象限を戻す
+    angle = Select(_mm_cmpgt_ps(ay, ax), _mm_sub_ps(_mm_set1_ps(kPi * 0.5f), angle), angle);
+    angle = Select(_mm_cmplt_ps(x, _mm_setzero_ps()), _mm_sub_ps(_mm_set1_ps(kPi), angle), angle);
+    return _mm_or_ps(angle, _mm_and_ps(y, signMask));
+}
+
+// 量子化したキーの1チャンネル(4オブジェクト分)を戻す
+__m128 Dequantize(const uint16_t* keys, const float* minValue, const float* extent)
+{
+    __m128i packed = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(keys));
+    __m128 q = _mm_cvtepi32_ps(_mm_unpacklo_epi16(packed, _mm_setzero_si128()));
+    return _mm_add_ps(_mm_loadu_ps(minValue), _mm_mul_ps(q, _mm_loadu_ps(extent)));
+}
+#endif
+
+} // namespace
+
+void TransformAnimation::Build(const std::vector<TransformTrack>& tracks, float sampleRate, bool loop)
+{
+    objectCount_ = static_cast<uint32_t>(tracks.size());
+    blockCount_ = (objectCount_ + kObjectsPerBlock - 1) / kObjectsPerBlock;
+    channelStride_ = blockCount_ * kChannelsPerObject * kObjectsPerBlock;
+    loop_ = loop;
+
+    duration_ = 0.0f;
+    for (const TransformTrack& track : tracks) {
+        duration_ = std::max({ duration_, LastKeyTime(track.scale), LastKeyTime(track.rotate), LastKeyTime(track.translate) });
+    }
+    // 最後のキーがちょうどdurationに来るように、間隔をduration / (keyCount - 1)にする
+    keyCount_ = static_cast<uint32_t>(std::ceil(duration_ * sampleRate)) + 1;
+    keysPerSecond_ = duration_ > 0.0f ? float(keyCount_ - 1) / duration_ : 0.0f;
+
+    // 等間隔に再サンプリングする(ブロックの空きは初期値で埋める)
+    std::vector<float> samples(size_t(keyCount_) * channelStride_, 0.0f);
+    for (uint32_t key = 0; key < keyCount_; ++key) {
+        float time = keyCount_ > 1 ? duration_ * float(key) / float(keyCount_ - 1) : 0.0f;
+        float* row = &samples[size_t(key) * channelStride_];
+        for (uint32_t object = 0; object < blockCount_ * kObjectsPerBlock; ++object) {
+            Vector3 scale = { 1.0f, 1.0f, 1.0f };
+            Quaternion rotation = { 0.0f, 0.0f, 0.0f, 1.0f };
+            Vector3 translate = { 0.0f, 0.0f, 0.0f };
+            if (object < objectCount_) {
+                const TransformTrack& track = tracks[object];
+                scale = EvaluateKeys(track.scale, time, scale);
+                rotation = EvaluateRotation(track.rotate, time);
+                translate = EvaluateKeys(track.translate, time, translate);
+            }
+            // 前のキーと同じ半球にそろえておくと、再生時の最短の向きの判定が量子化の誤差で揺れない
+            float* channel = row + size_t(object / kObjectsPerBlock) * kChannelsPerObject * kObjectsPerBlock + object % kObjectsPerBlock;
+            if (key > 0) {
+                const float* previous = channel - channelStride_;
+                float dot = previous[3 * kObjectsPerBlock] * rotation.x + previous[4 * kObjectsPerBlock] * rotation.y
+                    + previous[5 * kObjectsPerBlock] * rotation.z + previous[6 * kObjectsPerBlock] * rotation.w;
+                if (dot < 0.0f) {
+                    rotation = { -rotation.x, -rotation.y, -rotation.z, -rotation.w };
+                }
+            }
+            const float values[kChannelsPerObject] = { scale.x, scale.y, scale.z, rotation.x, rotation.y, rotation.z, rotation.w, translate.x, translate.y, translate.z };
+            for (uint32_t c = 0; c < kChannelsPerObject; ++c) {
+                channel[c * kObjectsPerBlock] = values[c];
+            }
+        }
+    }
+
+    // チャンネルごとの範囲で16bitに量子化する
+    channelMin_.assign(channelStride_, 0.0f);
+    channelExtent_.assign(channelStride_, 0.0f);
+    for (uint32_t channel = 0; channel < channelStride_; ++channel) {
+        float minValue = samples[channel];
+        float maxValue = samples[channel];
+        for (uint32_t key = 1; key < keyCount_; ++key) {
+            float value = samples[size_t(key) * channelStride_ + channel];
+            minValue = std::min(minValue, value);
+            maxValue = std::max(maxValue, value);
+        }
+        channelMin_[channel] = minValue;
+        // 復元時に掛けるだけで済むように 1/65535 を含めておく
+        channelExtent_[channel] = (maxValue - minValue) / kQuantizeMax;
+    }
+
+    keys_.assign(size_t(keyCount_) * channelStride_, 0);
+    for (uint32_t key = 0; key < keyCount_; ++key) {
+        for (uint32_t channel = 0; channel < channelStride_; ++channel) {
+            size_t index = size_t(key) * channelStride_ + channel;
+            float range = channelExtent_[channel] * kQuantizeMax;
+            float normalized = range > 0.0f ? (samples[index] - channelMin_[channel]) / range : 0.0f;
+            keys_[index] = static_cast<uint16_t>(std::lround(std::clamp(normalized, 0.0f, 1.0f) * kQuantizeMax));
+        }
+    }
+}
+
+void TransformAnimation::Sample(float time, Transform* output) const
+{
+    if (keyCount_ == 0 || output == nullptr) {
+        return;
+    }
+
+    // 再生位置をキー番号と補間係数にする(全トラックで共通)
+    if (loop_ && duration_ > 0.0f) {
+        time = std::fmod(time, duration_);
+        if (time < 0.0f) {
+            time += duration_;
+        }
+    } else {
+        time = std::clamp(time, 0.0f, duration_);
+    }
+    float position = time * keysPerSecond_;
+    uint32_t key0 = std::min(static_cast<uint32_t>(position), keyCount_ - 1);
+    uint32_t key1 = std::min(key0 + 1, keyCount_ - 1);
+    float alpha = std::clamp(position - float(key0), 0.0f, 1.0f);
+
+    const uint16_t* row0 = &keys_[size_t(key0) * channelStride_];
+    const uint16_t* row1 = &keys_[size_t(key1) * channelStride_];
+    float* out = reinterpret_cast<float*>(output);
+    constexpr uint32_t kBlockStride = kChannelsPerObject * kObjectsPerBlock;
+
+#ifdef TRANSFORM_ANIMATION_SSE2
+    // 球面線形補間の係数のうちalphaだけで決まる部分
+    float terms0[8];
+    float terms1[8];
+    SlerpTerms(1.0f - alpha, terms0);
+    SlerpTerms(alpha, terms1);
+    const __m128 alphaVector = _mm_set1_ps(alpha);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+    // 4オブジェクトずつ 展開→復元→補間 してTransformの並びに組み替えて書き込む
+    for (uint32_t block = 0; block < blockCount_; ++block) {
+        const uint32_t base = block * kBlockStride;
+        __m128 values[kChannelsPerObject];
+        __m128 q0[4];
+        __m128 q1[4];
+        for (uint32_t c = 0; c < kChannelsPerObject; ++c) {
+            const uint32_t offset = base + c * kObjectsPerBlock;
+            __m128 v0 = Dequantize(row0 + offset, &channelMin_[offset], &channelExtent_[offset]);
+            __m128 v1 = Dequantize(row1 + offset, &channelMin_[offset], &channelExtent_[offset]);
+            if (c >= 3 && c < 7) {
+                q0[c - 3] = v0;
+                q1[c - 3] = v1;
+            } else {
+                values[c] = _mm_add_ps(v0, _mm_mul_ps(_mm_sub_ps(v1, v0), alphaVector));
+            }
+        }
+
+        // 回転: 最短の向きにそろえて球面線形補間し、正規化する
+        __m128 cosTheta = _mm_add_ps(_mm_add_ps(_mm_mul_ps(q0[0], q1[0]), _mm_mul_ps(q0[1], q1[1])),
+            _mm_add_ps(_mm_mul_ps(q0[2], q1[2]), _mm_mul_ps(q0[3], q1[3])));
+        const __m128 flip = _mm_and_ps(cosTheta, _mm_set1_ps(-0.0f));
+        cosTheta = _mm_min_ps(_mm_xor_ps(cosTheta, flip), one);
+        const __m128 xm1 = _mm_sub_ps(cosTheta, one);
+        __m128 weight0 = one;
+        __m128 weight1 = one;
+        for (int i = 7; i >= 0; --i) {
+            weight0 = _mm_add_ps(one, _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(terms0[i]), xm1), weight0));
+            weight1 = _mm_add_ps(one, _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(terms1[i]), xm1), weight1));
+        }
+        weight0 = _mm_mul_ps(weight0, _mm_set1_ps(1.0f - alpha));
+        weight1 = _mm_xor_ps(_mm_mul_ps(weight1, alphaVector), flip);
+        __m128 q[4];
+        __m128 lengthSquared = _mm_setzero_ps();
+        for (int i = 0; i < 4; ++i) {
+            q[i] = _mm_add_ps(_mm_mul_ps(q0[i], weight0), _mm_mul_ps(q1[i], weight1));
+            lengthSquared = _mm_add_ps(lengthSquared, _mm_mul_ps(q[i], q[i]));
+        }
+        const __m128 inverseLength = _mm_div_ps(one, _mm_sqrt_ps(_mm_max_ps(lengthSquared, _mm_set1_ps(1.0e-30f))));
+        for (int i = 0; i < 4; ++i) {
+            q[i] = _mm_mul_ps(q[i], inverseLength);
+        }
+
+        // オイラー角(X, Y, Zの順に回す)に戻す
+        const __m128& x = q[0];
+        const __m128& y = q[1];
+        const __m128& z = q[2];
+        const __m128& w = q[3];
+        __m128 sinY = _mm_mul_ps(two, _mm_sub_ps(_mm_mul_ps(w, y), _mm_mul_ps(z, x)));
+        sinY = _mm_max_ps(_mm_min_ps(sinY, one), _mm_set1_ps(-1.0f));
+        values[3] = Atan2(_mm_mul_ps(two, _mm_add_ps(_mm_mul_ps(w, x), _mm_mul_ps(y, z))),
+            _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)))));
+        values[4] = Atan2(sinY, _mm_sqrt_ps(_mm_sub_ps(one, _mm_mul_ps(sinY, sinY))));
+        values[5] = Atan2(_mm_mul_ps(two, _mm_add_ps(_mm_mul_ps(w, z), _mm_mul_ps(x, y))),
+            _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(_mm_mul_ps(y, y), _mm_mul_ps(z, z)))));
+        values[6] = values[7];
+        values[7] = values[8];
+        values[8] = values[9];
+
+        // SoAの9チャンネルをTransform 4つ分(AoS)に組み替える
+        __m128 low[4] = { values[0], values[1], values[2], values[3] };
+        __m128 high[4] = { values[4], values[5], values[6], values[7] };
+        _MM_TRANSPOSE4_PS(low[0], low[1], low[2], low[3]);
+        _MM_TRANSPOSE4_PS(high[0], high[1], high[2], high[3]);
+        alignas(16) float last[4];
+        _mm_store_ps(last, values[8]);
+        const uint32_t firstObject = block * kObjectsPerBlock;
+        const uint32_t count = std::min(kObjectsPerBlock, objectCount_ - firstObject);
+        for (uint32_t i = 0; i < count; ++i) {
+            float* destination = out + size_t(firstObject + i) * 9;
+            _mm_storeu_ps(destination, low[i]);
+            _mm_storeu_ps(destination + 4, high[i]);
+            destination[8] = last[i];
+        }
+    }
+#else
+    for (uint32_t object = 0; object < objectCount_; ++object) {
+        const uint32_t base = object / kObjectsPerBlock * kBlockStride + object % kObjectsPerBlock;
+        float v0[kChannelsPerObject];
+        float v1[kChannelsPerObject];
+        for (uint32_t c = 0; c < kChannelsPerObject; ++c) {
+            const uint32_t index = base + c * kObjectsPerBlock;
+            v0[c] = channelMin_[index] + float(row0[index]) * channelExtent_[index];
+            v1[c] = channelMin_[index] + float(row1[index]) * channelExtent_[index];
+        }
+        Quaternion rotation = Slerp({ v0[3], v0[4], v0[5], v0[6] }, { v1[3], v1[4], v1[5], v1[6] }, alpha);
+        Vector3 euler = EulerFromQuaternion(rotation);
+        float* destination = out + size_t(object) * 9;
+        const uint32_t linear[6] = { 0, 1, 2, 7, 8, 9 };
+        const uint32_t target[6] = { 0, 1, 2, 6, 7, 8 };
+        for (int i = 0; i < 6; ++i) {
+            destination[target[i]] = v0[linear[i]] + (v1[linear[i]] - v0[linear[i]]) * alpha;
+        }
+        destination[3] = euler.x;
+        destination[4] = euler.y;
+        destination[5] = euler.z;
+    }
+#endif
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "MakeAffine.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 関節
+struct Joint {
+    std::string name;
+    // 親関節の番号(ルートは-1)。親は必ず子より前に並べる
+    int32_t parent = -1;
+    // 親から見たバインドポーズ
+    Transform bindPose;
+    // 親から見た現在の姿勢
+    Transform localPose;
+};
+
+// スケルトン
+class Skeleton {
+public:
+    // 関節を追加し、その番号を返す
+    int32_t AddJoint(const std::string& name, int32_t parent, const Transform& bindPose);
+    // バインドポーズから逆バインド行列を作る。関節を追加し終えたら呼ぶ
+    void Finalize();
+
+    // 現在の姿勢からスキニング用の行列パレット(逆バインド行列 * ワールド行列)を作る
+    void UpdatePalette(std::vector<Matrix4x4>& palette) const;
+
+    std::vector<Joint> joints;
+
+private:
+    std::vector<Matrix4x4> inverseBindMatrices_;
+};
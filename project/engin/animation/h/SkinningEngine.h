@@ -0,0 +1,61 @@
+#pragma once
+#include "MakeAffine.h"
+#include "MeshManager.h"
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// スキニング前の頂点(影響する関節は最大4つ)
+struct SkinVertexData {
+    Vector4 position;
+    Vector2 texcoord;
+    Vector3 normal;
+    uint16_t jointIndices[4];
+    float weights[4];
+};
+
+enum class SkinningMode {
+    LinearBlend, // 線形ブレンド(行列パレット)
+    DualQuaternion, // デュアルクォータニオン(スケールは扱わない)
+};
+
+// 直近のスキニング計測結果
+struct SkinningStats {
+    uint32_t vertexCount = 0;
+    uint32_t threadCount = 0;
+    double milliseconds = 0.0;
+    double verticesPerSecond = 0.0;
+};
+
+// CPUスキニング。頂点をスレッドに分けて処理し、結果をVertexDataとして書き出す
+class SkinningEngine {
+public:
+    // threadPoolがnullptrなら呼び出しスレッドだけで処理する
+    explicit SkinningEngine(ThreadPool* threadPool = nullptr);
+
+    // 使うスレッド数(呼び出しスレッドを含む)。0ならプールの全スレッドを使う
+    void SetThreadCount(uint32_t threadCount) { threadCount_ = threadCount; }
+    uint32_t GetMaxThreadCount() const;
+
+    // outputはアップロードバッファを直接指してよい(順番に書き込むだけで読み戻さない)
+    void Skin(const SkinVertexData* input, uint32_t vertexCount, const std::vector<Matrix4x4>& palette,
+        VertexData* output, SkinningMode mode = SkinningMode::LinearBlend);
+
+    const SkinningStats& GetLastStats() const { return stats_; }
+
+private:
+    // 回転と平行移動を表すデュアルクォータニオン
+    struct DualQuaternion {
+        float real[4]; // x, y, z, w
+        float dual[4];
+    };
+
+    void SkinLinearBlend(const SkinVertexData* input, uint32_t begin, uint32_t end, const Matrix4x4* palette, VertexData* output) const;
+    void SkinDualQuaternion(const SkinVertexData* input, uint32_t begin, uint32_t end, VertexData* output) const;
+
+    ThreadPool* threadPool_ = nullptr;
+    uint32_t threadCount_ = 0;
+    std::vector<DualQuaternion> dualQuaternions_;
+    SkinningStats stats_;
+};
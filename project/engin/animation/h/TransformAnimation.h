@@ -0,0 +1,58 @@
+#pragma once
+#include "MakeAffine.h"
+#include <cstdint>
+#include <vector>
+
+// キーフレーム
+struct Keyframe {
+    float time;
+    Vector3 value;
+};
+
+// 1オブジェクト分のトラック(キーは時間順に並べる。空なら初期値のまま)
+// rotateはオイラー角で書くが、クォータニオンにして最短の向きで補間する。隣り合うキーは半回転未満の差にする
+struct TransformTrack {
+    std::vector<Keyframe> scale;
+    std::vector<Keyframe> rotate;
+    std::vector<Keyframe> translate;
+};
+
+// 複数オブジェクトのTransformアニメーション
+// キーは最初から最後までを等間隔に再サンプリングし、チャンネルごとに16bitへ量子化してSoAで持つ
+// 1オブジェクトは scale.xyz、回転のクォータニオン xyzw、translate.xyz の10チャンネルで、
+// 4オブジェクトを1ブロックとしてチャンネルごとに4つ並べる(SIMDの1レジスタが同じチャンネルの4オブジェクト分になる)
+class TransformAnimation {
+public:
+    // トラックからアニメーションを組み立てる。sampleRateは1秒あたりのキーの数の目安(実際はキーが最後の時刻にちょうど来るように詰める)
+    void Build(const std::vector<TransformTrack>& tracks, float sampleRate = 30.0f, bool loop = true);
+
+    // 全トラックを一度にサンプリングし、outputからobjectCount個のTransformへ直接書き込む
+    // 回転はクォータニオンを球面線形補間してからオイラー角に戻す
+    void Sample(float time, Transform* output) const;
+
+    uint32_t GetObjectCount() const { return objectCount_; }
+    float GetDuration() const { return duration_; }
+    uint32_t GetKeyCount() const { return keyCount_; }
+    // 圧縮後のキーデータのバイト数
+    size_t GetKeyBytes() const { return keys_.size() * sizeof(uint16_t); }
+
+private:
+    static constexpr uint32_t kChannelsPerObject = 10;
+    static constexpr uint32_t kObjectsPerBlock = 4;
+
+    uint32_t objectCount_ = 0;
+    uint32_t blockCount_ = 0;
+    // キー1つ分の並び(blockCount * 10チャンネル * 4オブジェクト)
+    uint32_t channelStride_ = 0;
+    uint32_t keyCount_ = 0;
+    // 再生時間をキー番号にする係数((keyCount - 1) / duration)
+    float keysPerSecond_ = 0.0f;
+    float duration_ = 0.0f;
+    bool loop_ = true;
+
+    // 量子化を戻すための最小値と幅
+    std::vector<float> channelMin_;
+    std::vector<float> channelExtent_;
+    // [key][block][channel][object]
+    std::vector<uint16_t> keys_;
+};
@@ -0,0 +1,171 @@
+#include "AssetWatcher.h"
+#include <Windows.h>
+#include <filesystem>
+
+namespace {
+
+// ポーリングの間隔と、通知待ちで停止要求を確かめる間隔
+constexpr DWORD kWaitMilliseconds = 100;
+constexpr std::chrono::milliseconds kPollInterval(250);
+
+} // namespace
+
+AssetWatcher::~AssetWatcher()
+{
+    Stop();
+}
+
+bool AssetWatcher::Start(const std::string& directory, bool forcePolling)
+{
+    Stop();
+    if (!std::filesystem::is_directory(directory)) {
+        return false;
+    }
+    directory_ = std::filesystem::path(directory).generic_string();
+    writeTimes_.clear();
+    scanned_ = false;
+    polling_.store(forcePolling, std::memory_order_release);
+    running_.store(true, std::memory_order_release);
+    thread_ = std::thread([this] { Run(); });
+    return true;
+}
+
+void AssetWatcher::Stop()
+{
+    running_.store(false, std::memory_order_release);
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+std::vector<AssetChange> AssetWatcher::PollChanges(std::chrono::milliseconds settleTime)
+{
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    std::vector<AssetChange> changes;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = pending_.begin(); it != pending_.end();) {
+        if (now - it->second.lastTime < settleTime) {
+            ++it;
+            continue;
+        }
+        changes.push_back({ it->first, it->second.firstTime });
+        it = pending_.erase(it);
+    }
+    return changes;
+}
+
+void AssetWatcher::Run()
+{
+    if (!IsPolling() && !WatchNotifications()) {
+        // 監視できないドライブなどではポーリングに切り替える
+        polling_.store(true, std::memory_order_release);
+    }
+    if (IsPolling()) {
+        WatchPolling();
+    }
+}
+
+bool AssetWatcher::WatchNotifications()
+{
+    HANDLE directory = CreateFileW(std::filesystem::path(directory_).wstring().c_str(), FILE_LIST_DIRECTORY,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+        FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+    if (directory == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    OVERLAPPED overlapped {};
+    overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+
+    // FILE_NOTIFY_INFORMATIONはDWORD境界に並ぶ
+    std::vector<DWORD> notifyBuffer(16 * 1024);
+    void* buffer = notifyBuffer.data();
+    const DWORD bufferSize = static_cast<DWORD>(notifyBuffer.size() * sizeof(DWORD));
+    const DWORD filter = FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE;
+    bool watching = ReadDirectoryChangesW(directory, buffer, bufferSize, TRUE, filter, nullptr, &overlapped, nullptr);
+    // 通知を頼み始めてから更新時刻を控える(走査中の変更は通知で拾う)
+    if (watching) {
+        ScanWriteTimes(false);
+    }
+    while (watching && running_.load(std::memory_order_acquire)) {
+        if (WaitForSingleObject(overlapped.hEvent, kWaitMilliseconds) != WAIT_OBJECT_0) {
+            continue;
+        }
+        DWORD bytes = 0;
+        if (!GetOverlappedResult(directory, &overlapped, &bytes, FALSE)) {
+            watching = false;
+            break;
+        }
+        // 0バイトはバッファが溢れて通知を取りこぼした印なので、ポーリングに任せる
+        // ポーリングの最初の走査で控えておいた更新時刻と比べ、取りこぼした変更を見つける
+        if (bytes == 0) {
+            watching = false;
+            break;
+        }
+        for (const uint8_t* cursor = static_cast<const uint8_t*>(buffer);;) {
+            const FILE_NOTIFY_INFORMATION* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(cursor);
+            if (info->Action != FILE_ACTION_REMOVED && info->Action != FILE_ACTION_RENAMED_OLD_NAME) {
+                std::wstring name(info->FileName, info->FileNameLength / sizeof(WCHAR));
+                const std::filesystem::path path = std::filesystem::path(directory_) / name;
+                std::error_code error;
+                const std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(path, error);
+                if (!error) {
+                    writeTimes_[path.generic_string()] = writeTime;
+                }
+                Record(path.generic_string());
+            }
+            if (info->NextEntryOffset == 0) {
+                break;
+            }
+            cursor += info->NextEntryOffset;
+        }
+        ResetEvent(overlapped.hEvent);
+        watching = ReadDirectoryChangesW(directory, buffer, bufferSize, TRUE, filter, nullptr, &overlapped, nullptr);
+    }
+
+    CancelIoEx(directory, &overlapped);
+    DWORD bytes = 0;
+    GetOverlappedResult(directory, &overlapped, &bytes, TRUE);
+    CloseHandle(overlapped.hEvent);
+    CloseHandle(directory);
+    // 停止要求で抜けたなら成功、監視が続けられなくなったなら失敗
+    return !running_.load(std::memory_order_acquire);
+}
+
+void AssetWatcher::WatchPolling()
+{
+    // 通知から切り替えたのでなければ、初回の走査は基準を作るだけ
+    if (!scanned_) {
+        ScanWriteTimes(false);
+        std::this_thread::sleep_for(kPollInterval);
+    }
+    while (running_.load(std::memory_order_acquire)) {
+        ScanWriteTimes(true);
+        std::this_thread::sleep_for(kPollInterval);
+    }
+}
+
+void AssetWatcher::ScanWriteTimes(bool report)
+{
+    std::error_code error;
+    for (std::filesystem::recursive_directory_iterator it(directory_, error), end; !error && it != end; it.increment(error)) {
+        if (!it->is_regular_file(error)) {
+            continue;
+        }
+        const std::string path = it->path().generic_string();
+        const std::filesystem::file_time_type writeTime = it->last_write_time(error);
+        auto [found, inserted] = writeTimes_.try_emplace(path, writeTime);
+        if (report && (inserted || found->second != writeTime)) {
+            Record(path);
+        }
+        found->second = writeTime;
+    }
+    scanned_ = true;
+}
+
+void AssetWatcher::Record(const std::string& path)
+{
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto [it, inserted] = pending_.try_emplace(path, PendingChange { now, now });
+    it->second.lastTime = now;
+}
@@ -0,0 +1,120 @@
+#include "FramePacer.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+uint64_t SimulatedGpuTimeline::Signal()
+{
+    const uint64_t value = ++signaled_;
+    // GPUは前の処理が終わってから次に取り掛かる。手が空いていた分は遊んでいた時間
+    if (value > 1 && now_ > gpuBusyUntil_) {
+        gpuIdleMilliseconds_ += now_ - gpuBusyUntil_;
+    }
+    gpuBusyUntil_ = std::max(now_, gpuBusyUntil_) + gpuFrameMilliseconds_;
+    pending_.push_back({ value, gpuBusyUntil_ });
+    return value;
+}
+
+uint64_t SimulatedGpuTimeline::GetCompletedValue()
+{
+    while (!pending_.empty() && pending_.front().second <= now_) {
+        completed_ = pending_.front().first;
+        pending_.pop_front();
+    }
+    return completed_;
+}
+
+void SimulatedGpuTimeline::Wait(uint64_t value)
+{
+    assert(value <= signaled_);
+    // もう終わっている印なら待たない(残っている次の印まで待ってしまわないように)
+    if (value <= GetCompletedValue()) {
+        return;
+    }
+    for (const auto& [pendingValue, finishTime] : pending_) {
+        if (pendingValue >= value) {
+            if (finishTime > now_) {
+                cpuStallMilliseconds_ += finishTime - now_;
+                now_ = finishTime;
+            }
+            break;
+        }
+    }
+    GetCompletedValue();
+}
+
+FramePacer::FramePacer(GpuTimeline& timeline, uint32_t frameCount)
+    : timeline_(timeline)
+    , fenceValues_(frameCount, 0)
+{
+    assert(frameCount > 0);
+}
+
+FramePacer::~FramePacer()
+{
+    // GPUが読んでいるものを解放しないように、すべて終わるのを待つ
+    WaitIdle();
+}
+
+uint32_t FramePacer::BeginFrame()
+{
+    assert(!recording_);
+    const uint64_t completedValue = timeline_.GetCompletedValue();
+    stats_.framesInFlight = static_cast<uint32_t>(lastSignaled_ - completedValue);
+
+    // この番号を前に使ったフレームがまだ終わっていない = frameCountフレーム先行しているので待つ
+    const uint64_t fenceValue = fenceValues_[frameIndex_];
+    stats_.lastWaitMilliseconds = 0.0;
+    if (fenceValue > completedValue) {
+        auto begin = std::chrono::steady_clock::now();
+        timeline_.Wait(fenceValue);
+        stats_.lastWaitMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        stats_.totalWaitMilliseconds += stats_.lastWaitMilliseconds;
+        ++stats_.waits;
+    }
+
+    CollectReleases(timeline_.GetCompletedValue());
+    recording_ = true;
+    return frameIndex_;
+}
+
+uint64_t FramePacer::EndFrame()
+{
+    assert(recording_);
+    lastSignaled_ = timeline_.Signal();
+    fenceValues_[frameIndex_] = lastSignaled_;
+    frameIndex_ = (frameIndex_ + 1) % GetFrameCount();
+    recording_ = false;
+    ++stats_.frames;
+    return lastSignaled_;
+}
+
+void FramePacer::WaitIdle()
+{
+    // 積んでいる途中のフレームはまだGPUに渡していないので、渡し終えたものだけを待てばよい
+    if (timeline_.GetCompletedValue() < lastSignaled_) {
+        timeline_.Wait(lastSignaled_);
+        ++stats_.idleWaits;
+    }
+    CollectReleases(timeline_.GetCompletedValue());
+}
+
+void FramePacer::DeferRelease(std::function<void()> release)
+{
+    // 積んでいるフレームにはEndFrameでlastSignaled_の次の印が付く
+    releases_.push_back({ recording_ ? lastSignaled_ + 1 : lastSignaled_, std::move(release) });
+    stats_.pendingReleases = static_cast<uint32_t>(releases_.size());
+}
+
+void FramePacer::CollectReleases(uint64_t completedValue)
+{
+    while (!releases_.empty() && releases_.front().first <= completedValue) {
+        // 呼んだ後にラムダごと捨てるので、キャプチャしたものもここで解放される
+        std::function<void()> release = std::move(releases_.front().second);
+        releases_.pop_front();
+        if (release) {
+            release();
+        }
+    }
+    stats_.pendingReleases = static_cast<uint32_t>(releases_.size());
+}
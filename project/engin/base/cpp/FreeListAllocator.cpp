@@ -0,0 +1,77 @@
+#include "FreeListAllocator.h"
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+FreeListAllocator::FreeListAllocator(uint32_t capacity)
+    : capacity_(capacity)
+{
+    assert(capacity > 0);
+    freeRanges_.emplace(0, capacity);
+}
+
+uint32_t FreeListAllocator::Allocate(uint32_t count)
+{
+    assert(count > 0);
+    for (auto it = freeRanges_.begin(); it != freeRanges_.end(); ++it) {
+        if (it->second < count) {
+            continue;
+        }
+        // 空きの先頭から切り出し、残りは空きのまま置いておく
+        const uint32_t first = it->first;
+        const uint32_t rest = it->second - count;
+        freeRanges_.erase(it);
+        if (rest > 0) {
+            freeRanges_.emplace(first + count, rest);
+        }
+        usedCount_ += count;
+        ++allocationCount_;
+        peakUsedCount_ = std::max(peakUsedCount_, usedCount_);
+        return first;
+    }
+    ++failedAllocations_;
+    return kFreeListAllocationFailed;
+}
+
+void FreeListAllocator::Free(uint32_t first, uint32_t count)
+{
+    assert(count > 0 && first + count <= capacity_ && usedCount_ >= count);
+    auto next = freeRanges_.lower_bound(first);
+    assert(next == freeRanges_.end() || first + count <= next->first);
+
+    // 前の空きと続いていればそこへ足し、後ろの空きと続いていれば取り込む
+    uint32_t mergedFirst = first;
+    uint32_t mergedCount = count;
+    if (next != freeRanges_.begin()) {
+        auto prev = std::prev(next);
+        assert(prev->first + prev->second <= first);
+        if (prev->first + prev->second == first) {
+            mergedFirst = prev->first;
+            mergedCount += prev->second;
+            freeRanges_.erase(prev);
+        }
+    }
+    if (next != freeRanges_.end() && first + count == next->first) {
+        mergedCount += next->second;
+        freeRanges_.erase(next);
+    }
+    freeRanges_.emplace(mergedFirst, mergedCount);
+
+    usedCount_ -= count;
+    --allocationCount_;
+}
+
+FreeListAllocatorStats FreeListAllocator::GetStats() const
+{
+    FreeListAllocatorStats stats;
+    stats.capacity = capacity_;
+    stats.usedCount = usedCount_;
+    stats.allocationCount = allocationCount_;
+    stats.freeRangeCount = static_cast<uint32_t>(freeRanges_.size());
+    for (const auto& [first, count] : freeRanges_) {
+        stats.largestFreeRange = std::max(stats.largestFreeRange, count);
+    }
+    stats.peakUsedCount = peakUsedCount_;
+    stats.failedAllocations = failedAllocations_;
+    return stats;
+}
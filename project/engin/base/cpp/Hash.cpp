@@ -0,0 +1,23 @@
+#include "Hash.h"
+#include <cstring>
+
+uint64_t HashBytes(const void* data, size_t size)
+{
+    Hasher hasher;
+    hasher.Add(data, size);
+    return hasher.Get();
+}
+
+void Hasher::Add(const void* data, size_t size)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash_ ^= bytes[i];
+        hash_ *= 1099511628211ull;
+    }
+}
+
+void Hasher::AddString(const char* text)
+{
+    Add(text, text != nullptr ? std::strlen(text) + 1 : 0);
+}
@@ -0,0 +1,144 @@
+#include "ParallelRecorder.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+void RecordingCommandListBackend::Reserve(uint32_t listCount)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (lists_.size() < listCount) {
+        lists_.resize(listCount);
+        open_.resize(listCount);
+    }
+}
+
+void RecordingCommandListBackend::Open(uint32_t list)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    assert(list > 0 && list < lists_.size() && !open_[list]);
+    open_[list] = 1;
+    lists_[list].clear();
+    events_.push_back({ EventType::Open, list, std::this_thread::get_id() });
+}
+
+void RecordingCommandListBackend::Close(uint32_t list)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    assert(list < lists_.size() && open_[list]);
+    open_[list] = 0;
+    events_.push_back({ EventType::Close, list, std::this_thread::get_id() });
+}
+
+void RecordingCommandListBackend::Submit(uint32_t listCount)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    assert(listCount <= lists_.size());
+    for (uint32_t list = 0; list < listCount; ++list) {
+        assert(!open_[list]);
+        submitted_.insert(submitted_.end(), lists_[list].begin(), lists_[list].end());
+        lists_[list].clear();
+    }
+    events_.push_back({ EventType::Submit, listCount, std::this_thread::get_id() });
+    // 次のフレームの0番は呼び出し側が開く
+    open_[0] = 1;
+}
+
+void RecordingCommandListBackend::Record(uint32_t list, uint32_t value)
+{
+    // 違うリストへは同時に積まれるが、1つのリストは1つのスレッドしか触らないのでロックは要らない
+    assert(list < lists_.size() && open_[list]);
+    lists_[list].push_back(value);
+}
+
+void RecordingCommandListBackend::Clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    events_.clear();
+    submitted_.clear();
+    for (std::vector<uint32_t>& list : lists_) {
+        list.clear();
+    }
+    std::fill(open_.begin(), open_.end(), uint8_t(0));
+    open_[0] = 1;
+}
+
+ParallelRecorder::ParallelRecorder(CommandListBackend& backend, ThreadPool* threadPool, uint32_t minItemsPerChunk)
+    : backend_(backend)
+    , threadPool_(threadPool)
+    , minItemsPerChunk_(std::max(1u, minItemsPerChunk))
+    , maxChunks_(threadPool ? threadPool->GetThreadCount() + 1 : 1)
+{
+}
+
+void ParallelRecorder::BeginFrame()
+{
+    current_ = 0;
+    frameStats_ = {};
+    backend_.Reserve(1);
+}
+
+std::vector<RecordRange> ParallelRecorder::Partition(uint32_t count, uint32_t maxChunks, uint32_t minItemsPerChunk)
+{
+    std::vector<RecordRange> ranges;
+    if (count == 0) {
+        return ranges;
+    }
+    const uint32_t chunkCount = std::clamp(count / std::max(1u, minItemsPerChunk), 1u, std::max(1u, maxChunks));
+    ranges.resize(chunkCount);
+    for (uint32_t i = 0; i < chunkCount; ++i) {
+        // 余りは前から1つずつ配る
+        ranges[i].begin = static_cast<uint32_t>(uint64_t(count) * i / chunkCount);
+        ranges[i].end = static_cast<uint32_t>(uint64_t(count) * (i + 1) / chunkCount);
+    }
+    return ranges;
+}
+
+void ParallelRecorder::RecordParallel(uint32_t count, const RecordFunc& record)
+{
+    auto start = std::chrono::steady_clock::now();
+    frameStats_.items += count;
+    ranges_ = Partition(count, maxChunks_, minItemsPerChunk_);
+    if (ranges_.size() <= 1) {
+        // 分けるほどでもなければ今のリストにそのまま記録する
+        if (!ranges_.empty()) {
+            record(current_, ranges_[0].begin, ranges_[0].end);
+        }
+        frameStats_.recordMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return;
+    }
+
+    // 今のリストを閉じ、その後ろに区切った数だけのリストと続きのリストを並べる
+    const uint32_t chunkCount = static_cast<uint32_t>(ranges_.size());
+    const uint32_t first = current_ + 1;
+    backend_.Reserve(first + chunkCount + 1);
+    backend_.Close(current_);
+
+    listMilliseconds_.assign(chunkCount, 0.0);
+    threadPool_->ParallelFor(chunkCount, 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t chunk = begin; chunk < end; ++chunk) {
+            auto listStart = std::chrono::steady_clock::now();
+            const uint32_t list = first + chunk;
+            backend_.Open(list);
+            record(list, ranges_[chunk].begin, ranges_[chunk].end);
+            backend_.Close(list);
+            listMilliseconds_[chunk] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - listStart).count();
+        }
+    });
+
+    current_ = first + chunkCount;
+    backend_.Open(current_);
+
+    frameStats_.parallelLists += chunkCount;
+    frameStats_.longestListMilliseconds = std::max(frameStats_.longestListMilliseconds,
+        *std::max_element(listMilliseconds_.begin(), listMilliseconds_.end()));
+    frameStats_.recordMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void ParallelRecorder::Submit()
+{
+    backend_.Close(current_);
+    backend_.Submit(current_ + 1);
+    frameStats_.commandLists = current_ + 1;
+    stats_ = frameStats_;
+}
@@ -0,0 +1,97 @@
+#include "RadixSort.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <array>
+
+namespace {
+
+constexpr uint32_t kRadixBits = 8;
+constexpr uint32_t kBucketCount = 1u << kRadixBits;
+constexpr uint32_t kPassCount = 64 / kRadixBits;
+// これより少なければ並列にしない
+constexpr uint32_t kParallelThreshold = 16 * 1024;
+constexpr uint32_t kMaxChunks = 16;
+
+using Histogram = std::array<uint32_t, kBucketCount>;
+
+uint32_t Digit(uint64_t key, uint32_t pass)
+{
+    return static_cast<uint32_t>(key >> (pass * kRadixBits)) & (kBucketCount - 1);
+}
+
+} // namespace
+
+uint32_t RadixSort(std::vector<SortKey>& keys, std::vector<SortKey>& scratch, ThreadPool* threadPool)
+{
+    const uint32_t count = static_cast<uint32_t>(keys.size());
+    if (count < 2) {
+        return 0;
+    }
+    scratch.resize(count);
+
+    // 要素を連続したチャンクに分け、チャンクごとのヒストグラムから書き込み先を決める(チャンク順に並べるので安定)
+    const bool parallel = threadPool != nullptr && count >= kParallelThreshold;
+    const uint32_t chunkCount = parallel ? std::min(kMaxChunks, threadPool->GetThreadCount() + 1) : 1;
+    const uint32_t chunkSize = (count + chunkCount - 1) / chunkCount;
+    std::vector<Histogram> histograms(chunkCount);
+
+    auto forEachChunk = [&](auto&& func) {
+        if (chunkCount == 1) {
+            func(0u, 0u, count);
+            return;
+        }
+        threadPool->ParallelFor(chunkCount, 1, [&](uint32_t first, uint32_t last) {
+            for (uint32_t chunk = first; chunk < last; ++chunk) {
+                func(chunk, std::min(count, chunk * chunkSize), std::min(count, (chunk + 1) * chunkSize));
+            }
+        });
+    };
+
+    std::vector<SortKey>* source = &keys;
+    std::vector<SortKey>* destination = &scratch;
+    uint32_t sortedPasses = 0;
+    for (uint32_t pass = 0; pass < kPassCount; ++pass) {
+        forEachChunk([&](uint32_t chunk, uint32_t begin, uint32_t end) {
+            Histogram& histogram = histograms[chunk];
+            histogram.fill(0);
+            for (uint32_t i = begin; i < end; ++i) {
+                ++histogram[Digit((*source)[i].key, pass)];
+            }
+        });
+
+        // この桁が全要素で同じなら並べ替える必要はない
+        const uint32_t firstDigit = Digit((*source)[0].key, pass);
+        uint32_t sameDigit = 0;
+        for (const Histogram& histogram : histograms) {
+            sameDigit += histogram[firstDigit];
+        }
+        if (sameDigit == count) {
+            continue;
+        }
+
+        // 桁の小さい順、同じ桁の中ではチャンク順に書き込み位置を割り当てる
+        uint32_t offset = 0;
+        for (uint32_t bucket = 0; bucket < kBucketCount; ++bucket) {
+            for (Histogram& histogram : histograms) {
+                uint32_t bucketCount = histogram[bucket];
+                histogram[bucket] = offset;
+                offset += bucketCount;
+            }
+        }
+
+        forEachChunk([&](uint32_t chunk, uint32_t begin, uint32_t end) {
+            Histogram& writePositions = histograms[chunk];
+            for (uint32_t i = begin; i < end; ++i) {
+                const SortKey& key = (*source)[i];
+                (*destination)[writePositions[Digit(key.key, pass)]++] = key;
+            }
+        });
+        std::swap(source, destination);
+        ++sortedPasses;
+    }
+
+    if (source != &keys) {
+        keys.swap(scratch);
+    }
+    return sortedPasses;
+}
@@ -0,0 +1,73 @@
+#include "RingAllocator.h"
+#include <algorithm>
+#include <cassert>
+
+RingAllocator::RingAllocator(uint64_t capacity)
+    : capacity_(capacity)
+{
+    assert(capacity > 0);
+    stats_.capacity = capacity;
+}
+
+uint64_t RingAllocator::Allocate(uint64_t sizeInBytes, uint64_t alignment)
+{
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+    if (usedBytes_ == 0 && frames_.empty()) {
+        // 空になったら先頭から使い直す(終わっていないフレームがあるとその終わりの位置がずれるので戻さない)
+        head_ = tail_ = 0;
+    }
+
+    uint64_t offset = kRingAllocationFailed;
+    const uint64_t aligned = (head_ + alignment - 1) & ~(alignment - 1);
+    if (usedBytes_ == 0 || head_ > tail_) {
+        // 空きは[head_, capacity_)と[0, tail_)
+        if (aligned + sizeInBytes <= capacity_) {
+            offset = aligned;
+        } else if (sizeInBytes <= tail_) {
+            // 終わりに入らないので折り返す。残りは使わない
+            offset = 0;
+        }
+    } else if (head_ < tail_ && aligned + sizeInBytes <= tail_) {
+        // 空きは[head_, tail_)
+        offset = aligned;
+    }
+    if (offset == kRingAllocationFailed) {
+        ++stats_.overflows;
+        return kRingAllocationFailed;
+    }
+
+    const uint64_t consumed = offset >= head_ ? offset + sizeInBytes - head_ : capacity_ - head_ + sizeInBytes;
+    head_ = offset + sizeInBytes;
+    usedBytes_ += consumed;
+    frameBytes_ += consumed;
+    ++frameAllocations_;
+
+    ++stats_.totalAllocations;
+    stats_.paddingBytes += consumed - sizeInBytes;
+    stats_.usedBytes = usedBytes_;
+    stats_.peakUsedBytes = std::max(stats_.peakUsedBytes, usedBytes_);
+    return offset;
+}
+
+void RingAllocator::FinishFrame(uint64_t fenceValue)
+{
+    assert(frames_.empty() || frames_.back().fenceValue <= fenceValue);
+    frames_.push_back({ fenceValue, head_, frameBytes_ });
+    stats_.frameBytes = frameBytes_;
+    stats_.frameAllocations = frameAllocations_;
+    stats_.framesInFlight = static_cast<uint32_t>(frames_.size());
+    frameBytes_ = 0;
+    frameAllocations_ = 0;
+}
+
+void RingAllocator::Reclaim(uint64_t completedValue)
+{
+    while (!frames_.empty() && frames_.front().fenceValue <= completedValue) {
+        // フレームは切り出した順に終わるので、先頭をそのフレームの終わりまで進めればよい
+        tail_ = frames_.front().end;
+        usedBytes_ -= frames_.front().bytes;
+        frames_.pop_front();
+    }
+    stats_.usedBytes = usedBytes_;
+    stats_.framesInFlight = static_cast<uint32_t>(frames_.size());
+}
@@ -0,0 +1,73 @@
+#include "StartupTimeline.h"
+#include <algorithm>
+#include <format>
+
+namespace {
+
+double ToMilliseconds(StartupTimeline::Clock::duration duration)
+{
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+} // namespace
+
+StartupTimeline::Scope::Scope(StartupTimeline* timeline, std::string name)
+    : timeline_(timeline)
+    , name_(std::move(name))
+    , begin_(Clock::now())
+{
+}
+
+StartupTimeline::Scope::~Scope()
+{
+    if (timeline_) {
+        timeline_->Record(std::move(name_), begin_, Clock::now());
+    }
+}
+
+StartupTimeline::StartupTimeline()
+    : origin_(Clock::now())
+{
+}
+
+void StartupTimeline::Record(std::string name, Clock::time_point begin, Clock::time_point end)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    spans_.push_back({ std::move(name), std::this_thread::get_id(), begin, end });
+}
+
+double StartupTimeline::GetElapsedMilliseconds() const
+{
+    return ToMilliseconds(Clock::now() - origin_);
+}
+
+std::string StartupTimeline::BuildReport() const
+{
+    std::vector<Span> spans;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        spans = spans_;
+    }
+    std::sort(spans.begin(), spans.end(), [](const Span& a, const Span& b) { return a.begin < b.begin; });
+
+    // スレッドに0から番号を振る(最初に記録したスレッドが0)
+    std::vector<std::thread::id> threads;
+    std::vector<double> busyMilliseconds;
+    std::string report = "---- Startup Timeline ----\n";
+    for (const Span& span : spans) {
+        size_t lane = std::find(threads.begin(), threads.end(), span.threadId) - threads.begin();
+        if (lane == threads.size()) {
+            threads.push_back(span.threadId);
+            busyMilliseconds.push_back(0.0);
+        }
+        const double duration = ToMilliseconds(span.end - span.begin);
+        busyMilliseconds[lane] += duration;
+        report += std::format("[{:8.2f} - {:8.2f}] {:7.2f}ms thread{} {}\n",
+            ToMilliseconds(span.begin - origin_), ToMilliseconds(span.end - origin_), duration, lane, span.name);
+    }
+    for (size_t lane = 0; lane < threads.size(); ++lane) {
+        report += std::format("thread{} busy {:.2f}ms\n", lane, busyMilliseconds[lane]);
+    }
+    report += std::format("total {:.2f}ms\n", GetElapsedMilliseconds());
+    return report;
+}
@@ -0,0 +1,122 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+    if (threadCount == 0) {
+        uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        threadCount = std::max(1u, hardwareThreads > 1 ? hardwareThreads - 1 : 1u);
+    }
+
+    workers_.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; ++i) {
+        workers_.emplace_back([this] { WorkerMain(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    jobCondition_.notify_all();
+
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::Enqueue(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_.push_back(std::move(job));
+    }
+    jobCondition_.notify_one();
+}
+
+void ThreadPool::WaitIdle()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    idleCondition_.wait(lock, [this] { return jobs_.empty() && activeJobs_ == 0; });
+}
+
+void ThreadPool::ParallelFor(uint32_t count, uint32_t grainSize, const std::function<void(uint32_t begin, uint32_t end)>& func)
+{
+    if (count == 0) {
+        return;
+    }
+    grainSize = std::max(1u, grainSize);
+    uint32_t chunkCount = (count + grainSize - 1) / grainSize;
+
+    // 分割するほどでもなければその場で実行する
+    if (chunkCount == 1 || workers_.empty()) {
+        func(0, count);
+        return;
+    }
+
+    // チャンクは早い者勝ちで取り合う
+    // 出遅れたヘルパーが戻った後に触れても良いように、状態は共有ポインタで持つ
+    struct State {
+        std::atomic<uint32_t> nextChunk { 0 };
+        std::atomic<uint32_t> finishedChunks { 0 };
+        std::mutex doneMutex;
+        std::condition_variable doneCondition;
+    };
+    auto state = std::make_shared<State>();
+    const auto* body = &func;
+
+    auto runChunks = [state, body, count, grainSize, chunkCount] {
+        uint32_t chunk;
+        while ((chunk = state->nextChunk.fetch_add(1, std::memory_order_relaxed)) < chunkCount) {
+            uint32_t begin = chunk * grainSize;
+            uint32_t end = std::min(count, begin + grainSize);
+            (*body)(begin, end);
+            if (state->finishedChunks.fetch_add(1, std::memory_order_acq_rel) + 1 == chunkCount) {
+                std::lock_guard<std::mutex> lock(state->doneMutex);
+                state->doneCondition.notify_all();
+            }
+        }
+    };
+
+    uint32_t helperCount = std::min(GetThreadCount(), chunkCount - 1);
+    for (uint32_t i = 0; i < helperCount; ++i) {
+        Enqueue(runChunks);
+    }
+    runChunks();
+
+    std::unique_lock<std::mutex> lock(state->doneMutex);
+    state->doneCondition.wait(lock, [&] { return state->finishedChunks.load(std::memory_order_acquire) == chunkCount; });
+}
+
+void ThreadPool::WorkerMain()
+{
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            jobCondition_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+
+            // 停止要求が来ても積まれたジョブは最後まで処理する
+            if (jobs_.empty()) {
+                return;
+            }
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+            ++activeJobs_;
+        }
+
+        job();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --activeJobs_;
+            if (jobs_.empty() && activeJobs_ == 0) {
+                idleCondition_.notify_all();
+            }
+        }
+    }
+}
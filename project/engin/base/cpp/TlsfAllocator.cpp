@@ -0,0 +1,279 @@
+#include "TlsfAllocator.h"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+
+namespace {
+
+uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+[[maybe_unused]] bool IsPowerOfTwo(uint64_t value)
+{
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+} // namespace
+
+TlsfAllocator::TlsfAllocator(uint64_t capacity, uint64_t granularity)
+    : capacity_(capacity & ~(granularity - 1))
+    , granularity_(granularity)
+{
+    // 一番小さいブロックでも2段目を引けるように、granularityは2段目の数以上にする
+    assert(IsPowerOfTwo(granularity) && granularity >= kSecondLevelCount);
+    assert(capacity_ > 0);
+    for (auto& lists : freeLists_) {
+        std::fill(std::begin(lists), std::end(lists), kNone);
+    }
+
+    // 最初は全体が1つの空きブロック
+    const uint32_t block = NewBlock();
+    blocks_[block].offset = 0;
+    blocks_[block].size = capacity_;
+    InsertFree(block);
+}
+
+TlsfAllocation TlsfAllocator::Allocate(uint64_t sizeInBytes, uint64_t alignment)
+{
+    assert(IsPowerOfTwo(alignment));
+    alignment = std::max(alignment, granularity_);
+    const uint64_t size = AlignUp(std::max<uint64_t>(sizeInBytes, 1), granularity_);
+
+    // アラインメントで先頭をずらしても必ず入る大きさで探す。無ければsizeで探して入るか確かめる
+    uint32_t block = FindFreeBlock(size + alignment - granularity_);
+    if (block == kNone && alignment > granularity_) {
+        block = FindFreeBlock(size);
+        if (block != kNone && AlignUp(blocks_[block].offset, alignment) + size > blocks_[block].offset + blocks_[block].size) {
+            block = kNone;
+        }
+    }
+    if (block == kNone) {
+        return {};
+    }
+    RemoveFree(block);
+
+    // ずらした分は前に空きとして残す(前のブロックは使用中なのでまとめる相手はいない)
+    const uint64_t padding = AlignUp(blocks_[block].offset, alignment) - blocks_[block].offset;
+    if (padding > 0) {
+        const uint32_t aligned = Split(block, padding);
+        InsertFree(block);
+        block = aligned;
+    }
+    // 余った後ろも空きとして残す
+    if (blocks_[block].size > size) {
+        InsertFree(Split(block, size));
+    }
+
+    Block& allocated = blocks_[block];
+    allocated.alignment = alignment;
+    usedBytes_ += allocated.size;
+    ++allocationCount_;
+    return { allocated.offset, allocated.size, block };
+}
+
+void TlsfAllocator::Free(const TlsfAllocation& allocation)
+{
+    uint32_t block = allocation.block;
+    assert(block < blocks_.size() && blocks_[block].used && !blocks_[block].free);
+    assert(blocks_[block].offset == allocation.offset);
+    usedBytes_ -= blocks_[block].size;
+    --allocationCount_;
+
+    // 前後が空いていればまとめてから空きリストに戻す
+    const uint32_t next = blocks_[block].nextPhysical;
+    if (next != kNone && blocks_[next].free) {
+        RemoveFree(next);
+        MergeWithNext(block);
+    }
+    const uint32_t prev = blocks_[block].prevPhysical;
+    if (prev != kNone && blocks_[prev].free) {
+        RemoveFree(prev);
+        MergeWithNext(prev);
+        block = prev;
+    }
+    InsertFree(block);
+}
+
+uint32_t TlsfAllocator::Defragment(uint32_t maxMoves, const MoveFunc& move)
+{
+    // 後ろにあるものから、より前の空きへ入るか試す
+    std::vector<uint32_t> allocated;
+    allocated.reserve(allocationCount_);
+    for (uint32_t i = 0; i < blocks_.size(); ++i) {
+        if (blocks_[i].used && !blocks_[i].free) {
+            allocated.push_back(i);
+        }
+    }
+    std::sort(allocated.begin(), allocated.end(), [this](uint32_t a, uint32_t b) { return blocks_[a].offset > blocks_[b].offset; });
+
+    uint32_t moves = 0;
+    for (uint32_t block : allocated) {
+        if (moves >= maxMoves) {
+            break;
+        }
+        const TlsfAllocation from = { blocks_[block].offset, blocks_[block].size, block };
+        const TlsfAllocation to = Allocate(from.size, blocks_[block].alignment);
+        if (!to.IsValid()) {
+            continue;
+        }
+        if (to.offset < from.offset && move(from, to)) {
+            ++moves;
+        } else {
+            Free(to);
+        }
+    }
+    return moves;
+}
+
+TlsfAllocatorStats TlsfAllocator::GetStats() const
+{
+    TlsfAllocatorStats stats;
+    stats.capacity = capacity_;
+    stats.usedBytes = usedBytes_;
+    stats.freeBytes = capacity_ - usedBytes_;
+    stats.allocationCount = allocationCount_;
+    stats.freeBlockCount = freeBlockCount_;
+
+    // 一番大きい空きは、空きがある一番上のリストのどれか
+    if (firstLevelBitmap_ != 0) {
+        const uint32_t firstLevel = 63 - std::countl_zero(firstLevelBitmap_);
+        const uint32_t secondLevel = 31 - std::countl_zero(secondLevelBitmaps_[firstLevel]);
+        for (uint32_t block = freeLists_[firstLevel][secondLevel]; block != kNone; block = blocks_[block].nextFree) {
+            stats.largestFreeBlock = std::max(stats.largestFreeBlock, blocks_[block].size);
+        }
+    }
+    if (stats.freeBytes > 0) {
+        stats.fragmentation = 1.0f - static_cast<float>(static_cast<double>(stats.largestFreeBlock) / static_cast<double>(stats.freeBytes));
+    }
+    stats.occupancy = static_cast<float>(static_cast<double>(usedBytes_) / static_cast<double>(capacity_));
+    return stats;
+}
+
+void TlsfAllocator::Mapping(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel) const
+{
+    // 1段目は2の何乗か、2段目はその中をkSecondLevelCount等分したどこか
+    firstLevel = 63 - std::countl_zero(size);
+    secondLevel = static_cast<uint32_t>(size >> (firstLevel - kSecondLevelBits)) & (kSecondLevelCount - 1);
+}
+
+uint32_t TlsfAllocator::FindFreeBlock(uint64_t size) const
+{
+    // 切り上げてから引くと、見つかったリストのブロックはどれもsize以上になる
+    uint32_t firstLevel = 0;
+    uint32_t secondLevel = 0;
+    Mapping(size, firstLevel, secondLevel);
+    size += (uint64_t(1) << (firstLevel - kSecondLevelBits)) - 1;
+    Mapping(size, firstLevel, secondLevel);
+
+    uint32_t secondLevelMap = secondLevelBitmaps_[firstLevel] & (~0u << secondLevel);
+    if (secondLevelMap == 0) {
+        // 同じ1段目に無ければ、より大きい1段目から一番小さいものを使う
+        const uint64_t firstLevelMap = firstLevel + 1 < kFirstLevelCount ? firstLevelBitmap_ & (~uint64_t(0) << (firstLevel + 1)) : 0;
+        if (firstLevelMap == 0) {
+            return kNone;
+        }
+        firstLevel = std::countr_zero(firstLevelMap);
+        secondLevelMap = secondLevelBitmaps_[firstLevel];
+    }
+    secondLevel = std::countr_zero(secondLevelMap);
+    return freeLists_[firstLevel][secondLevel];
+}
+
+void TlsfAllocator::InsertFree(uint32_t block)
+{
+    uint32_t firstLevel = 0;
+    uint32_t secondLevel = 0;
+    Mapping(blocks_[block].size, firstLevel, secondLevel);
+
+    const uint32_t head = freeLists_[firstLevel][secondLevel];
+    blocks_[block].free = true;
+    blocks_[block].prevFree = kNone;
+    blocks_[block].nextFree = head;
+    if (head != kNone) {
+        blocks_[head].prevFree = block;
+    }
+    freeLists_[firstLevel][secondLevel] = block;
+    firstLevelBitmap_ |= uint64_t(1) << firstLevel;
+    secondLevelBitmaps_[firstLevel] |= 1u << secondLevel;
+    ++freeBlockCount_;
+}
+
+void TlsfAllocator::RemoveFree(uint32_t block)
+{
+    uint32_t firstLevel = 0;
+    uint32_t secondLevel = 0;
+    Mapping(blocks_[block].size, firstLevel, secondLevel);
+
+    Block& removed = blocks_[block];
+    if (removed.prevFree != kNone) {
+        blocks_[removed.prevFree].nextFree = removed.nextFree;
+    } else {
+        freeLists_[firstLevel][secondLevel] = removed.nextFree;
+    }
+    if (removed.nextFree != kNone) {
+        blocks_[removed.nextFree].prevFree = removed.prevFree;
+    }
+    if (freeLists_[firstLevel][secondLevel] == kNone) {
+        secondLevelBitmaps_[firstLevel] &= ~(1u << secondLevel);
+        if (secondLevelBitmaps_[firstLevel] == 0) {
+            firstLevelBitmap_ &= ~(uint64_t(1) << firstLevel);
+        }
+    }
+    removed.free = false;
+    removed.prevFree = removed.nextFree = kNone;
+    --freeBlockCount_;
+}
+
+uint32_t TlsfAllocator::NewBlock()
+{
+    uint32_t block = 0;
+    if (!unusedBlocks_.empty()) {
+        block = unusedBlocks_.back();
+        unusedBlocks_.pop_back();
+    } else {
+        block = static_cast<uint32_t>(blocks_.size());
+        blocks_.emplace_back();
+    }
+    blocks_[block] = Block{};
+    blocks_[block].used = true;
+    return block;
+}
+
+void TlsfAllocator::DeleteBlock(uint32_t block)
+{
+    blocks_[block].used = false;
+    unusedBlocks_.push_back(block);
+}
+
+uint32_t TlsfAllocator::Split(uint32_t block, uint64_t size)
+{
+    assert(size > 0 && size < blocks_[block].size);
+    // NewBlockでblocks_が伸びることがあるので、参照はその後で取る
+    const uint32_t rest = NewBlock();
+    Block& front = blocks_[block];
+    Block& back = blocks_[rest];
+    back.offset = front.offset + size;
+    back.size = front.size - size;
+    back.prevPhysical = block;
+    back.nextPhysical = front.nextPhysical;
+    if (back.nextPhysical != kNone) {
+        blocks_[back.nextPhysical].prevPhysical = rest;
+    }
+    front.nextPhysical = rest;
+    front.size = size;
+    return rest;
+}
+
+void TlsfAllocator::MergeWithNext(uint32_t block)
+{
+    const uint32_t next = blocks_[block].nextPhysical;
+    assert(next != kNone && blocks_[block].offset + blocks_[block].size == blocks_[next].offset);
+    blocks_[block].size += blocks_[next].size;
+    blocks_[block].nextPhysical = blocks_[next].nextPhysical;
+    if (blocks_[block].nextPhysical != kNone) {
+        blocks_[blocks_[block].nextPhysical].prevPhysical = block;
+    }
+    DeleteBlock(next);
+}
@@ -0,0 +1,114 @@
+#include "UploadScheduler.h"
+#include <cassert>
+
+UploadScheduler::UploadScheduler(uint64_t stagingBytes, uint64_t batchBytes, uint64_t alignment)
+    : batchBytes_(batchBytes)
+    , alignment_(alignment)
+    , staging_(stagingBytes)
+{
+    assert(batchBytes > 0 && alignment > 0 && (alignment & (alignment - 1)) == 0);
+}
+
+uint32_t UploadScheduler::Enqueue(const std::vector<uint64_t>& subresourceBytes)
+{
+    assert(!subresourceBytes.empty());
+    const uint32_t ticket = nextTicket_++;
+    for (uint32_t subresource = 0; subresource < subresourceBytes.size(); ++subresource) {
+        pending_.push_back({ ticket, subresource, subresourceBytes[subresource] });
+        ++stats_.queuedCopies;
+        stats_.queuedBytes += subresourceBytes[subresource];
+    }
+    remainingCopies_[ticket] = static_cast<uint32_t>(subresourceBytes.size());
+    ++stats_.queuedTickets;
+    return ticket;
+}
+
+std::vector<uint32_t> UploadScheduler::Update(uint64_t completedValue, uint32_t maxBatches, const SubmitFunc& submit)
+{
+    std::vector<uint32_t> finished;
+    Complete(completedValue, finished);
+
+    stats_.lastBatches = 0;
+    stats_.lastCopies = 0;
+    UploadBatch batch;
+    while (stats_.lastBatches < maxBatches && BuildBatch(batch)) {
+        const uint64_t fenceValue = submit(batch);
+        staging_.FinishFrame(fenceValue);
+
+        InFlightBatch inFlight;
+        inFlight.fenceValue = fenceValue;
+        for (const UploadCopy& copy : batch.copies) {
+            inFlight.tickets.push_back(copy.ticket);
+        }
+        batches_.push_back(std::move(inFlight));
+
+        ++stats_.lastBatches;
+        stats_.lastCopies += static_cast<uint32_t>(batch.copies.size());
+        ++stats_.submittedBatches;
+        stats_.submittedCopies += batch.copies.size();
+        stats_.submittedBytes += batch.sizeInBytes;
+    }
+    return finished;
+}
+
+bool UploadScheduler::BuildBatch(UploadBatch& batch)
+{
+    batch.copies.clear();
+    batch.sizeInBytes = 0;
+    while (!pending_.empty()) {
+        const PendingCopy& pending = pending_.front();
+        // 1つ目は大きくても入れる。2つ目からはbatchBytesを超えるなら次の提出に回す
+        if (!batch.copies.empty() && batch.sizeInBytes + pending.sizeInBytes > batchBytes_) {
+            break;
+        }
+
+        UploadCopy copy;
+        copy.ticket = pending.ticket;
+        copy.subresource = pending.subresource;
+        copy.sizeInBytes = pending.sizeInBytes;
+        if (pending.sizeInBytes > staging_.GetStats().capacity) {
+            // ステージング領域にはどうやっても入らない
+            copy.dedicated = true;
+            ++stats_.dedicatedCopies;
+        } else {
+            copy.stagingOffset = staging_.Allocate(pending.sizeInBytes, alignment_);
+            if (copy.stagingOffset == kRingAllocationFailed) {
+                // 前の提出が終わって空くのを待つ
+                break;
+            }
+        }
+
+        batch.copies.push_back(copy);
+        batch.sizeInBytes += pending.sizeInBytes;
+        --stats_.queuedCopies;
+        stats_.queuedBytes -= pending.sizeInBytes;
+        pending_.pop_front();
+    }
+    return !batch.copies.empty();
+}
+
+void UploadScheduler::Complete(uint64_t completedValue, std::vector<uint32_t>& finished)
+{
+    staging_.Reclaim(completedValue);
+    while (!batches_.empty() && batches_.front().fenceValue <= completedValue) {
+        for (uint32_t ticket : batches_.front().tickets) {
+            auto it = remainingCopies_.find(ticket);
+            assert(it != remainingCopies_.end() && it->second > 0);
+            if (--it->second == 0) {
+                remainingCopies_.erase(it);
+                finished.push_back(ticket);
+                --stats_.queuedTickets;
+                ++stats_.completedTickets;
+            }
+        }
+        batches_.pop_front();
+    }
+}
+
+UploadSchedulerStats UploadScheduler::GetStats() const
+{
+    UploadSchedulerStats stats = stats_;
+    stats.batchesInFlight = static_cast<uint32_t>(batches_.size());
+    stats.staging = staging_.GetStats();
+    return stats;
+}
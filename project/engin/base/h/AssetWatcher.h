@@ -0,0 +1,58 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// 変更を検出したファイル
+struct AssetChange {
+    std::string path; // directoryを先頭に付けた'/'区切りのパス
+    std::chrono::steady_clock::time_point detectedTime;
+};
+
+// ディレクトリ以下のファイル変更を専用スレッドで監視する
+// ReadDirectoryChangesWが使えなければ更新時刻のポーリングで代用する
+class AssetWatcher {
+public:
+    AssetWatcher() = default;
+    ~AssetWatcher();
+
+    AssetWatcher(const AssetWatcher&) = delete;
+    AssetWatcher& operator=(const AssetWatcher&) = delete;
+
+    // forcePollingなら最初からポーリングで監視する
+    bool Start(const std::string& directory, bool forcePolling = false);
+    void Stop();
+    bool IsPolling() const { return polling_.load(std::memory_order_acquire); }
+
+    // 書き込みが落ち着いた(settleTime以上続報が無い)変更を取り出す
+    std::vector<AssetChange> PollChanges(std::chrono::milliseconds settleTime = std::chrono::milliseconds(50));
+
+private:
+    void Run();
+    bool WatchNotifications();
+    void WatchPolling();
+    // ファイルごとの更新時刻を取り直す。reportなら前回から変わったものを変更として残す
+    void ScanWriteTimes(bool report);
+    void Record(const std::string& path);
+
+    std::string directory_;
+    std::thread thread_;
+    std::atomic<bool> running_ { false };
+    std::atomic<bool> polling_ { false };
+    // 監視スレッドだけで触る。通知が溢れてポーリングに切り替えたとき、取りこぼした変更をこれと比べて見つける
+    std::unordered_map<std::string, std::filesystem::file_time_type> writeTimes_;
+    bool scanned_ = false;
+
+    std::mutex mutex_;
+    // パスごとに、最初に検出した時刻と最後に通知が来た時刻
+    struct PendingChange {
+        std::chrono::steady_clock::time_point firstTime;
+        std::chrono::steady_clock::time_point lastTime;
+    };
+    std::unordered_map<std::string, PendingChange> pending_;
+};
@@ -0,0 +1,105 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <utility>
+#include <vector>
+
+// GPUの進み具合。実機ではフェンス、テストではシミュレーションで置き換える
+class GpuTimeline {
+public:
+    virtual ~GpuTimeline() = default;
+
+    // ここまで積んだ処理の後ろに印を付け、その値を返す(1から順に増える)
+    virtual uint64_t Signal() = 0;
+    // GPUが終えた印の最大値
+    virtual uint64_t GetCompletedValue() = 0;
+    // valueの印までGPUが進むのを待つ
+    virtual void Wait(uint64_t value) = 0;
+};
+
+// GPUを使わずにフレームの進み方を再現する
+// 時刻は実際には進まず、AdvanceCpuとWaitで動かす。積んだフレームは1つずつgpuFrameMilliseconds掛かって終わる
+class SimulatedGpuTimeline : public GpuTimeline {
+public:
+    explicit SimulatedGpuTimeline(double gpuFrameMilliseconds) : gpuFrameMilliseconds_(gpuFrameMilliseconds) { }
+
+    uint64_t Signal() override;
+    uint64_t GetCompletedValue() override;
+    void Wait(uint64_t value) override;
+
+    // CPU側の処理でmilliseconds進める
+    void AdvanceCpu(double milliseconds) { now_ += milliseconds; }
+    void SetGpuFrameMilliseconds(double milliseconds) { gpuFrameMilliseconds_ = milliseconds; }
+
+    double GetNow() const { return now_; }
+    // Waitで止まっていた時間の合計と、GPUが何もしていなかった時間の合計
+    double GetCpuStallMilliseconds() const { return cpuStallMilliseconds_; }
+    double GetGpuIdleMilliseconds() const { return gpuIdleMilliseconds_; }
+
+private:
+    double gpuFrameMilliseconds_ = 0.0;
+    double now_ = 0.0;
+    // 最後に積んだ処理が終わる時刻
+    double gpuBusyUntil_ = 0.0;
+    double cpuStallMilliseconds_ = 0.0;
+    double gpuIdleMilliseconds_ = 0.0;
+    // 積んだ印とそれが終わる時刻(古い順)
+    std::deque<std::pair<uint64_t, double>> pending_;
+    uint64_t signaled_ = 0;
+    uint64_t completed_ = 0;
+};
+
+struct FramePacerStats {
+    uint64_t frames = 0;
+    // BeginFrameでGPUを待った回数と時間
+    uint64_t waits = 0;
+    double lastWaitMilliseconds = 0.0;
+    double totalWaitMilliseconds = 0.0;
+    // WaitIdleで全部を待った回数
+    uint64_t idleWaits = 0;
+    // 直前のBeginFrameの時点でGPUが終えていなかったフレーム数
+    uint32_t framesInFlight = 0;
+    uint32_t pendingReleases = 0;
+};
+
+// frameCount個のフレームを順に使い回し、CPUがframeCountフレーム先行したときだけGPUを待つ
+// GPUが読んでいるかもしれないものは、そのフレームが終わるまで解放を遅らせる
+class FramePacer {
+public:
+    FramePacer(GpuTimeline& timeline, uint32_t frameCount);
+    ~FramePacer();
+
+    FramePacer(const FramePacer&) = delete;
+    FramePacer& operator=(const FramePacer&) = delete;
+
+    // 次のフレームを始める。同じ番号を前に使ったフレームが終わっていなければ待つ。戻り値はフレームの番号
+    uint32_t BeginFrame();
+    // 積み終えたフレームに印を付け、その値を返す
+    uint64_t EndFrame();
+    // GPUがすべてを終えるまで待つ(その場で書き換える差し替えや終了の前に呼ぶ)
+    void WaitIdle();
+
+    // 今積んでいるフレーム(フレームの外なら積み終えたフレーム)をGPUが終えたらreleaseを呼ぶ
+    // 捨てるものをキャプチャしたラムダを渡す
+    void DeferRelease(std::function<void()> release);
+
+    uint32_t GetFrameIndex() const { return frameIndex_; }
+    uint32_t GetFrameCount() const { return static_cast<uint32_t>(fenceValues_.size()); }
+    const FramePacerStats& GetStats() const { return stats_; }
+
+private:
+    // 終わったフレームの解放待ちを片付ける
+    void CollectReleases(uint64_t completedValue);
+
+    GpuTimeline& timeline_;
+    // フレームの番号ごとに、最後に付けた印(0なら未使用)
+    std::vector<uint64_t> fenceValues_;
+    // 解放を待つものと、それを使うフレームの印(古い順)
+    std::deque<std::pair<uint64_t, std::function<void()>>> releases_;
+    uint32_t frameIndex_ = 0;
+    bool recording_ = false;
+    // 最後に付けた印
+    uint64_t lastSignaled_ = 0;
+    FramePacerStats stats_;
+};
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <map>
+
+// Allocateで空きが足りなかったときの戻り値
+constexpr uint32_t kFreeListAllocationFailed = UINT32_MAX;
+
+struct FreeListAllocatorStats {
+    uint32_t capacity = 0;
+    uint32_t usedCount = 0;
+    uint32_t allocationCount = 0;
+    uint32_t freeRangeCount = 0;
+    uint32_t largestFreeRange = 0;
+    // 一度に使っていた数の最大
+    uint32_t peakUsedCount = 0;
+    uint64_t failedAllocations = 0;
+};
+
+// [0, capacity)の番号を連続した範囲で貸し出す。返された範囲は前後の空きとまとめ、次の確保で使い回す
+// ディスクリプタのように数が少なく、範囲も短いものに向けて先頭から空きを探す
+class FreeListAllocator {
+public:
+    explicit FreeListAllocator(uint32_t capacity);
+
+    // 先頭の番号を返す。入る空きが無ければkFreeListAllocationFailed
+    uint32_t Allocate(uint32_t count);
+    void Free(uint32_t first, uint32_t count);
+
+    FreeListAllocatorStats GetStats() const;
+    uint32_t GetCapacity() const { return capacity_; }
+
+private:
+    uint32_t capacity_ = 0;
+    uint32_t usedCount_ = 0;
+    uint32_t allocationCount_ = 0;
+    uint32_t peakUsedCount_ = 0;
+    uint64_t failedAllocations_ = 0;
+    // 空きの先頭 -> 数。先頭の順に並ぶので隣とすぐにまとめられる
+    std::map<uint32_t, uint32_t> freeRanges_;
+};
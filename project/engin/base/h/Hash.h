@@ -0,0 +1,26 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// 64bit FNV-1a。キャッシュのキーやアーカイブのパスなど、ファイルに残す値にも使うので変えないこと
+uint64_t HashBytes(const void* data, size_t size);
+
+// FNV-1aを少しずつ足していく(すべてを1回でHashBytesに渡したのと同じ値になる)
+// 構造体は詰め物の中身が不定なので、メンバーごとに足す
+class Hasher {
+public:
+    void Add(const void* data, size_t size);
+    template <typename T>
+    void Add(const T& value)
+    {
+        static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>);
+        Add(&value, sizeof(value));
+    }
+    // 終端の0も含めて足す(nullptrは何も足さない)
+    void AddString(const char* text);
+    uint64_t Get() const { return hash_; }
+
+private:
+    uint64_t hash_ = 14695981039346656037ull;
+};
@@ -0,0 +1,84 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+// 固定長のロックフリーキュー(複数生産者・複数消費者)
+// Capacityは2のべき乗にすること
+template <class T, size_t Capacity>
+class LockFreeQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    LockFreeQueue()
+    {
+        for (size_t i = 0; i < Capacity; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    LockFreeQueue(const LockFreeQueue&) = delete;
+    LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+    // 満杯ならfalseを返す(valueはそのまま残る)
+    bool TryPush(T& value)
+    {
+        size_t position = enqueuePosition_.load(std::memory_order_relaxed);
+        Cell* cell = nullptr;
+        while (true) {
+            cell = &cells_[position & (Capacity - 1)];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (diff == 0) {
+                if (enqueuePosition_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                position = enqueuePosition_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::move(value);
+        cell->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 空ならstd::nulloptを返す
+    std::optional<T> TryPop()
+    {
+        size_t position = dequeuePosition_.load(std::memory_order_relaxed);
+        Cell* cell = nullptr;
+        while (true) {
+            cell = &cells_[position & (Capacity - 1)];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+            if (diff == 0) {
+                if (dequeuePosition_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return std::nullopt;
+            } else {
+                position = dequeuePosition_.load(std::memory_order_relaxed);
+            }
+        }
+        std::optional<T> result(std::move(cell->value));
+        cell->value = T {};
+        cell->sequence.store(position + Capacity, std::memory_order_release);
+        return result;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value {};
+    };
+
+    // 生産者と消費者で同じキャッシュラインを取り合わないように離しておく
+    alignas(64) Cell cells_[Capacity];
+    alignas(64) std::atomic<size_t> enqueuePosition_ { 0 };
+    alignas(64) std::atomic<size_t> dequeuePosition_ { 0 };
+};
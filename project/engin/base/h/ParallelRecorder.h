@@ -0,0 +1,120 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool;
+
+// 区切った描画の範囲 [begin, end)
+struct RecordRange {
+    uint32_t begin = 0;
+    uint32_t end = 0;
+};
+
+// 提出する順に番号を振ったコマンドリストを用意して提出するもの
+// D3D12で動くもの(D3D12CommandListSet)と、呼ばれた順を残すだけのもの(RecordingCommandListBackend)を差し替えられる
+class CommandListBackend {
+public:
+    virtual ~CommandListBackend() = default;
+
+    // listCount-1番目までを開けるよう用意する(メインスレッドから呼ぶ)
+    virtual void Reserve(uint32_t listCount) = 0;
+    // list番目を開く/閉じる。番号が違えばワーカーから同時に呼ばれる。0番は呼び出し側が開いておく
+    virtual void Open(uint32_t list) = 0;
+    virtual void Close(uint32_t list) = 0;
+    // 0からlistCount-1番目までを、番号の順に1回で提出する
+    virtual void Submit(uint32_t listCount) = 0;
+};
+
+// GPUの代わりに、開いた/閉じた/提出した順と、リストごとに記録した値を残すだけのもの
+// 分け方と提出の順を確かめるのに使う
+class RecordingCommandListBackend : public CommandListBackend {
+public:
+    enum class EventType {
+        Open,
+        Close,
+        Submit,
+    };
+    struct Event {
+        EventType type = EventType::Open;
+        uint32_t list = 0;
+        std::thread::id thread;
+    };
+
+    RecordingCommandListBackend() : lists_(1), open_(1, 1) { }
+
+    void Reserve(uint32_t listCount) override;
+    void Open(uint32_t list) override;
+    void Close(uint32_t list) override;
+    void Submit(uint32_t listCount) override;
+
+    // list番目のリストにコマンドの代わりにvalueを積む(開いている間だけ)
+    void Record(uint32_t list, uint32_t value);
+
+    const std::vector<Event>& GetEvents() const { return events_; }
+    // 提出したリストの中身を提出した順につなげたもの
+    const std::vector<uint32_t>& GetSubmitted() const { return submitted_; }
+    void Clear();
+
+private:
+    std::mutex mutex_;
+    std::vector<Event> events_;
+    std::vector<std::vector<uint32_t>> lists_;
+    // 0番は呼び出し側が開いておくので最初から開いている
+    std::vector<uint8_t> open_;
+    std::vector<uint32_t> submitted_;
+};
+
+struct ParallelRecorderStats {
+    // 提出したコマンドリストの数と、そのうちワーカーで記録したもの
+    uint32_t commandLists = 0;
+    uint32_t parallelLists = 0;
+    // RecordParallelに渡した数
+    uint32_t items = 0;
+    // RecordParallelにかかった時間と、1つのリストの記録にかかった最長の時間
+    double recordMilliseconds = 0.0;
+    double longestListMilliseconds = 0.0;
+};
+
+// 1フレームのコマンドを、提出する順に番号を振ったいくつものコマンドリストへ記録する
+// メインスレッドで記録するリストの間に、描画の並びを区切ってワーカーで同時に記録したリストを挟み、最後に1回で提出する
+class ParallelRecorder {
+public:
+    using RecordFunc = std::function<void(uint32_t list, uint32_t begin, uint32_t end)>;
+
+    // minItemsPerChunkより細かくは分けない。threadPoolが無ければ分けずにメインスレッドで記録する
+    ParallelRecorder(CommandListBackend& backend, ThreadPool* threadPool, uint32_t minItemsPerChunk);
+
+    void SetMinItemsPerChunk(uint32_t minItemsPerChunk) { minItemsPerChunk_ = minItemsPerChunk > 0 ? minItemsPerChunk : 1; }
+
+    // フレームの始めに呼ぶ。0番(呼び出し側が開いたもの)から記録を始める
+    void BeginFrame();
+    // メインスレッドで記録している今のリストの番号
+    uint32_t GetCurrentList() const { return current_; }
+
+    // [0, count)を区切り、それぞれを別のリストにワーカーで記録する。recordは(リストの番号, 範囲)で呼ばれる
+    // 今のリストを閉じ、区切ったリストの後ろに続きを記録するリストを開く
+    // 1つにしか分けられないときは今のリストにそのまま記録する
+    void RecordParallel(uint32_t count, const RecordFunc& record);
+    // 今のリストを閉じ、開いたすべてのリストを順に1回で提出する
+    void Submit();
+
+    // countをmaxChunks個以下、1つminItemsPerChunk個以上に、なるべく均等に分ける
+    static std::vector<RecordRange> Partition(uint32_t count, uint32_t maxChunks, uint32_t minItemsPerChunk);
+
+    // 直前に提出したフレームのもの
+    const ParallelRecorderStats& GetStats() const { return stats_; }
+
+private:
+    CommandListBackend& backend_;
+    ThreadPool* threadPool_ = nullptr;
+    uint32_t minItemsPerChunk_ = 1;
+    uint32_t maxChunks_ = 1;
+    uint32_t current_ = 0;
+    std::vector<RecordRange> ranges_;
+    std::vector<double> listMilliseconds_;
+    ParallelRecorderStats frameStats_;
+    ParallelRecorderStats stats_;
+};
@@ -0,0 +1,16 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// 64bitのキーと元の並びの番号
+struct SortKey {
+    uint64_t key;
+    uint32_t index;
+};
+
+// キーの下位8bitずつ並べる安定なLSD基数ソート
+// 全要素で同じ値の桁は飛ばす。threadPoolがあり要素数が多いときは、ヒストグラムと振り分けを分担して並列に行う
+// scratchは作業用(同じ大きさに伸ばして使い回す)。戻り値は飛ばさずに処理した桁の数
+uint32_t RadixSort(std::vector<SortKey>& keys, std::vector<SortKey>& scratch, ThreadPool* threadPool = nullptr);
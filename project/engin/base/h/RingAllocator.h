@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+
+// Allocateで空きが足りなかったときの戻り値
+constexpr uint64_t kRingAllocationFailed = UINT64_MAX;
+
+struct RingAllocatorStats {
+    uint64_t capacity = 0;
+    // GPUが終えていないフレームと今のフレームが使っている量(アラインメントと折り返しで空けた分も含む)
+    uint64_t usedBytes = 0;
+    uint64_t peakUsedBytes = 0;
+    // 直前に閉じたフレームで使った量と切り出した数
+    uint64_t frameBytes = 0;
+    uint32_t frameAllocations = 0;
+    uint64_t totalAllocations = 0;
+    // アラインメントと折り返しで使えなかった量の合計
+    uint64_t paddingBytes = 0;
+    // 空きが足りずに失敗した回数
+    uint64_t overflows = 0;
+    uint32_t framesInFlight = 0;
+};
+
+// 1つの大きな領域を先頭から順に切り出し、フレーム単位でフェンスの値に合わせて返すリング
+// 大きさとオフセットだけを扱うのでGPUが無くても動かせる
+class RingAllocator {
+public:
+    explicit RingAllocator(uint64_t capacity);
+
+    // alignmentは2の累乗。切り出した位置を返し、空きが足りなければkRingAllocationFailed
+    uint64_t Allocate(uint64_t sizeInBytes, uint64_t alignment);
+    // ここまで切り出した分を、fenceValueの印が付いたフレームのものとして閉じる
+    void FinishFrame(uint64_t fenceValue);
+    // completedValueまでに終わったフレームの分を返す
+    void Reclaim(uint64_t completedValue);
+
+    // 空きを作るために待つべき一番古いフレームの印(閉じたフレームが無ければ0)
+    uint64_t GetOldestFenceValue() const { return frames_.empty() ? 0 : frames_.front().fenceValue; }
+    const RingAllocatorStats& GetStats() const { return stats_; }
+
+private:
+    struct Frame {
+        uint64_t fenceValue = 0;
+        // このフレームが使った範囲の終わりと、使った量
+        uint64_t end = 0;
+        uint64_t bytes = 0;
+    };
+
+    uint64_t capacity_ = 0;
+    // 次に切り出す位置と、使用中の先頭
+    uint64_t head_ = 0;
+    uint64_t tail_ = 0;
+    uint64_t usedBytes_ = 0;
+    // 閉じていない今のフレームが使った量と切り出した数
+    uint64_t frameBytes_ = 0;
+    uint32_t frameAllocations_ = 0;
+    std::deque<Frame> frames_;
+    RingAllocatorStats stats_;
+};
@@ -0,0 +1,46 @@
+#pragma once
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 起動処理のどこに時間がかかっているかを記録する(どのスレッドからでも記録できる)
+class StartupTimeline {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // 区間を記録するためのRAII
+    class Scope {
+    public:
+        Scope(StartupTimeline* timeline, std::string name);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        StartupTimeline* timeline_;
+        std::string name_;
+        Clock::time_point begin_;
+    };
+
+    StartupTimeline();
+
+    void Record(std::string name, Clock::time_point begin, Clock::time_point end);
+    // 起動開始からの経過時間(ミリ秒)
+    double GetElapsedMilliseconds() const;
+    // 開始順に並べた区間とスレッドごとの合計を文字列にする
+    std::string BuildReport() const;
+
+private:
+    struct Span {
+        std::string name;
+        std::thread::id threadId;
+        Clock::time_point begin;
+        Clock::time_point end;
+    };
+
+    Clock::time_point origin_;
+    mutable std::mutex mutex_;
+    std::vector<Span> spans_;
+};
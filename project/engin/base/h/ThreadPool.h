@@ -0,0 +1,40 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ワーカースレッドのプール
+class ThreadPool {
+public:
+    // threadCountが0ならハードウェアスレッド数-1(最低1)で起動する
+    explicit ThreadPool(uint32_t threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // ジョブを積む
+    void Enqueue(std::function<void()> job);
+    // 積んだジョブがすべて終わるまで待つ
+    void WaitIdle();
+    // [0, count) を grainSize ずつに分けて並列に実行し、終わるまで待つ
+    // 呼び出したスレッドも処理に加わる。ワーカー内から呼ばないこと
+    void ParallelFor(uint32_t count, uint32_t grainSize, const std::function<void(uint32_t begin, uint32_t end)>& func);
+
+    uint32_t GetThreadCount() const { return static_cast<uint32_t>(workers_.size()); }
+
+private:
+    void WorkerMain();
+
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> jobs_;
+    std::mutex mutex_;
+    std::condition_variable jobCondition_;
+    std::condition_variable idleCondition_;
+    uint32_t activeJobs_ = 0;
+    bool stop_ = false;
+};
@@ -0,0 +1,92 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// TlsfAllocatorで切り出した範囲。blockはFreeに渡す番号
+struct TlsfAllocation {
+    uint64_t offset = 0;
+    uint64_t size = 0;
+    uint32_t block = UINT32_MAX;
+
+    bool IsValid() const { return block != UINT32_MAX; }
+};
+
+struct TlsfAllocatorStats {
+    uint64_t capacity = 0;
+    uint64_t usedBytes = 0;
+    uint64_t freeBytes = 0;
+    uint64_t largestFreeBlock = 0;
+    uint32_t allocationCount = 0;
+    uint32_t freeBlockCount = 0;
+    // 1 - 最大の空き / 空きの合計。0なら空きが1か所にまとまっている
+    float fragmentation = 0.0f;
+    float occupancy = 0.0f;
+};
+
+// 2段のビットマップで空きブロックを引くTLSF(Two-Level Segregated Fit)
+// 確保も解放もO(1)で、隣の空きとはすぐにまとめる。オフセットと大きさだけを扱うのでGPUが無くても動かせる
+class TlsfAllocator {
+public:
+    // granularityより細かくは切らない(2の累乗)
+    explicit TlsfAllocator(uint64_t capacity, uint64_t granularity = 256);
+
+    // alignmentは2の累乗。空きが足りなければ無効なものを返す
+    TlsfAllocation Allocate(uint64_t sizeInBytes, uint64_t alignment);
+    void Free(const TlsfAllocation& allocation);
+
+    // 後ろにある確保済みの範囲について前の空きにtoを確保し、1件ずつmoveに渡す。戻り値は移した数
+    // moveは中身を移して参照を差し替えたらtrueを返す。fromは確保されたままなので、読み終えてから呼び出し側がFreeする
+    // falseならtoを返して元の場所に残す
+    using MoveFunc = std::function<bool(const TlsfAllocation& from, const TlsfAllocation& to)>;
+    uint32_t Defragment(uint32_t maxMoves, const MoveFunc& move);
+
+    TlsfAllocatorStats GetStats() const;
+    uint64_t GetCapacity() const { return capacity_; }
+    bool IsEmpty() const { return usedBytes_ == 0; }
+
+private:
+    static constexpr uint32_t kSecondLevelBits = 4;
+    static constexpr uint32_t kSecondLevelCount = 1u << kSecondLevelBits;
+    static constexpr uint32_t kFirstLevelCount = 64;
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    struct Block {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        // 並びの前後と、同じ空きリストの前後
+        uint32_t prevPhysical = kNone;
+        uint32_t nextPhysical = kNone;
+        uint32_t prevFree = kNone;
+        uint32_t nextFree = kNone;
+        // 確保したときのアラインメント(デフラグで移すときに使う)
+        uint64_t alignment = 0;
+        bool free = false;
+        bool used = false;
+    };
+
+    // sizeが入るリストの番号
+    void Mapping(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel) const;
+    // size以上が必ず入るリストから空きを探す
+    uint32_t FindFreeBlock(uint64_t size) const;
+    void InsertFree(uint32_t block);
+    void RemoveFree(uint32_t block);
+    uint32_t NewBlock();
+    void DeleteBlock(uint32_t block);
+    // blockの先頭sizeを残し、残りを後ろの新しいブロックにして返す
+    uint32_t Split(uint32_t block, uint64_t size);
+    // blockと後ろのブロックを1つにする
+    void MergeWithNext(uint32_t block);
+
+    uint64_t capacity_ = 0;
+    uint64_t granularity_ = 0;
+    uint64_t usedBytes_ = 0;
+    uint32_t allocationCount_ = 0;
+    uint32_t freeBlockCount_ = 0;
+
+    std::vector<Block> blocks_;
+    std::vector<uint32_t> unusedBlocks_;
+    uint64_t firstLevelBitmap_ = 0;
+    uint32_t secondLevelBitmaps_[kFirstLevelCount] = {};
+    uint32_t freeLists_[kFirstLevelCount][kSecondLevelCount];
+};
@@ -0,0 +1,88 @@
+#pragma once
+#include "RingAllocator.h"
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+// 1つのサブリソースのコピー。コピー元はステージング領域のstagingOffsetから
+struct UploadCopy {
+    uint32_t ticket = 0;
+    uint32_t subresource = 0;
+    uint64_t stagingOffset = 0;
+    uint64_t sizeInBytes = 0;
+    // ステージング領域より大きいので、この提出だけの専用のバッファを使う
+    bool dedicated = false;
+};
+
+// 1回の提出でまとめて流すコピー
+struct UploadBatch {
+    std::vector<UploadCopy> copies;
+    uint64_t sizeInBytes = 0;
+};
+
+struct UploadSchedulerStats {
+    // 待っているチケットとサブリソースと量
+    uint32_t queuedTickets = 0;
+    uint32_t queuedCopies = 0;
+    uint64_t queuedBytes = 0;
+    uint32_t batchesInFlight = 0;
+    uint64_t submittedBatches = 0;
+    uint64_t submittedCopies = 0;
+    uint64_t submittedBytes = 0;
+    uint64_t completedTickets = 0;
+    uint64_t dedicatedCopies = 0;
+    // 直前のUpdateで提出した数
+    uint32_t lastBatches = 0;
+    uint32_t lastCopies = 0;
+    RingAllocatorStats staging;
+};
+
+// サブリソースのコピーを、ステージング領域の空きとbatchBytesの範囲で提出単位にまとめる
+// ステージング領域は提出ごとにフェンスの印で返す。キューには触らず、提出は渡された関数に任せるのでGPUが無くても動かせる
+class UploadScheduler {
+public:
+    // stagingBytesのステージング領域を使い、1回の提出はおよそbatchBytesまで。alignmentは各コピーの先頭のアラインメント
+    UploadScheduler(uint64_t stagingBytes, uint64_t batchBytes, uint64_t alignment);
+
+    // サブリソースごとの量を渡してチケットを返す。コピーは渡した順に提出する
+    uint32_t Enqueue(const std::vector<uint64_t>& subresourceBytes);
+
+    // バッチを記録してキューに流し、印を付けたフェンスの値を返す
+    using SubmitFunc = std::function<uint64_t(const UploadBatch& batch)>;
+    // completedValueまでに終わった提出の分を返してから、最大maxBatches回提出する
+    // すべてのサブリソースが届いたチケットを返す
+    std::vector<uint32_t> Update(uint64_t completedValue, uint32_t maxBatches, const SubmitFunc& submit);
+
+    bool IsIdle() const { return pending_.empty() && batches_.empty(); }
+    // 提出済みで一番新しい印(無ければ0)
+    uint64_t GetLastFenceValue() const { return batches_.empty() ? 0 : batches_.back().fenceValue; }
+    UploadSchedulerStats GetStats() const;
+
+private:
+    struct PendingCopy {
+        uint32_t ticket = 0;
+        uint32_t subresource = 0;
+        uint64_t sizeInBytes = 0;
+    };
+    struct InFlightBatch {
+        uint64_t fenceValue = 0;
+        std::vector<uint32_t> tickets;
+    };
+
+    // 空きに入るだけ取り出す。ステージングが足りなければ途中で止める
+    bool BuildBatch(UploadBatch& batch);
+    void Complete(uint64_t completedValue, std::vector<uint32_t>& finished);
+
+    uint64_t batchBytes_ = 0;
+    uint64_t alignment_ = 0;
+    RingAllocator staging_;
+    uint32_t nextTicket_ = 1;
+
+    std::deque<PendingCopy> pending_;
+    std::deque<InFlightBatch> batches_;
+    // チケット -> まだ届いていないサブリソースの数
+    std::unordered_map<uint32_t, uint32_t> remainingCopies_;
+    UploadSchedulerStats stats_;
+};
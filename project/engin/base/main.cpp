@@ -2,10 +2,39 @@
 // include
 // --------------------------------------------------
 
+#include "CommandListSet.h"
+#include "DescriptorAllocator.h"
 #include "DirectXTex.h"
+#include "FrameContext.h"
+#include "GpakArchive.h"
+#include "GpuMemoryAllocator.h"
+#include "Hash.h"
+#include "HotReloadDemo.h"
 #include "Input.h"
+#include "Log.h"
 #include "MakeAffine.h"
+#include "MaterialTable.h"
+#include "MeshManager.h"
+#include "MeshStreamer.h"
+#include "OcclusionDemo.h"
+#include "ParallelRecorder.h"
+#include "PipelineCache.h"
+#include "RenderQueue.h"
+#include "ResourceStateTracker.h"
 #include "ResourceObject.h"
+#include "SceneRenderGraph.h"
+#include "ShaderCache.h"
+#include "ShaderPermutation.h"
+#include "SkinnedTubeDemo.h"
+#include "SpriteAtlasDemo.h"
+#include "SpriteBatchDemo.h"
+#include "StartupTimeline.h"
+#include "TextureCooker.h"
+#include "TextureManager.h"
+#include "TextureUploader.h"
+#include "ThreadPool.h"
+#include "TransformAnimation.h"
+#include "TransformationMatrix.h"
 #include "WinApp.h"
 #include "d3dx12.h"
 #include "imgui.h"
@@ -13,13 +42,18 @@
 #include "imgui_impl_win32.h"
 #include <Windows.h>
 #include <Xinput.h>
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstdint>
+#include <cstring>
 #include <d3d12.h>
 #include <dxcapi.h>
 #include <dxgi1_6.h>
 #include <dxgidebug.h>
+#include <filesystem>
 #include <format>
+#include <memory>
 #include <numbers>
 #include <string>
 #include <vector>
@@ -69,153 +103,6 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 // 関数、構造体定義
 // --------------------------------------------------
 
-// 文字列を出す
-void Log(const std::string& message)
-{
-    OutputDebugStringA(message.c_str());
-}
-
-std::wstring ConvertString(const std::string& str)
-{
-    if (str.empty()) {
-        return std::wstring();
-    }
-    auto sizeNeeded = MultiByteToWideChar(CP_UTF8, 0, reinterpret_cast<const char*>(&str[0]), static_cast<int>(str.size()), NULL, 0);
-    if (sizeNeeded == 0) {
-        return std::wstring();
-    }
-    std::wstring result(sizeNeeded, 0);
-    MultiByteToWideChar(CP_UTF8, 0, reinterpret_cast<const char*>(&str[0]), static_cast<int>(str.size()), &result[0], sizeNeeded);
-    return result;
-}
-
-std::string ConvertString(const std::wstring& str)
-{
-    if (str.empty()) {
-        return std::string();
-    }
-    auto sizeNeeded = WideCharToMultiByte(CP_UTF8, 0, str.data(), static_cast<int>(str.size()), NULL, 0, NULL, NULL);
-    if (sizeNeeded == 0) {
-        return std::string();
-    }
-    std::string result(sizeNeeded, 0);
-    WideCharToMultiByte(CP_UTF8, 0, str.data(), static_cast<int>(str.size()), result.data(), sizeNeeded, NULL, NULL);
-    return result;
-}
-
-DirectX ::ScratchImage LoadTexture(const std ::string filePath)
-{
-    DirectX::ScratchImage image {};
-    std::wstring filePathW = ConvertString(filePath);
-    HRESULT hr = DirectX ::LoadFromWICFile(filePathW.c_str(), DirectX ::WIC_FLAGS_FORCE_SRGB, nullptr, image);
-    assert(SUCCEEDED(hr));
-    DirectX ::ScratchImage mipImages {};
-    hr = DirectX ::GenerateMipMaps(image.GetImages(), image.GetImageCount(), image.GetMetadata(), DirectX ::TEX_FILTER_SRGB, 8, mipImages);
-    assert(SUCCEEDED(hr));
-    return mipImages;
-}
-
-ComPtr<ID3D12Resource> CreateTextureResourse(ID3D12Device* device, const DirectX::TexMetadata& metadata)
-{
-    D3D12_RESOURCE_DESC resourceDesc {};
-    resourceDesc.Width = UINT(metadata.width);
-    resourceDesc.Height = UINT(metadata.height);
-    resourceDesc.MipLevels = UINT16(metadata.mipLevels);
-    resourceDesc.DepthOrArraySize = UINT16(metadata.arraySize);
-    resourceDesc.Format = metadata.format;
-    resourceDesc.SampleDesc.Count = 1;
-    resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION(metadata.dimension);
-
-    D3D12_HEAP_PROPERTIES heapProperties {};
-    heapProperties.Type = D3D12_HEAP_TYPE_CUSTOM;
-    heapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_WRITE_BACK;
-    heapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_L0;
-
-    ComPtr<ID3D12Resource> resource = nullptr;
-    HRESULT hr = device->CreateCommittedResource(
-        &heapProperties,
-        D3D12_HEAP_FLAG_NONE,
-        &resourceDesc,
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(&resource));
-    assert(SUCCEEDED(hr));
-    return resource;
-}
-
-void UploadTextureData(ID3D12Resource* texture, const DirectX::ScratchImage& mipImages)
-{
-    const DirectX::TexMetadata& metadata = mipImages.GetMetadata();
-
-    for (size_t mipLevel = 0; mipLevel < metadata.mipLevels; ++mipLevel) {
-        const DirectX ::Image* img = mipImages.GetImage(mipLevel, 0, 0);
-        HRESULT hr = texture->WriteToSubresource(
-            UINT(mipLevel),
-            nullptr,
-            img->pixels,
-            UINT(img->rowPitch),
-            UINT(img->slicePitch));
-        assert(SUCCEEDED(hr));
-    }
-}
-
-ComPtr<ID3D12Resource> CreateBufferResource(ID3D12Device* device, size_t sizeInBytes)
-{
-    // ヒーププロパティの設定
-    D3D12_HEAP_PROPERTIES heapProperties {};
-    heapProperties.Type = D3D12_HEAP_TYPE_UPLOAD;
-
-    // リソースの設定
-    D3D12_RESOURCE_DESC resourceDesc {};
-    resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-    resourceDesc.Width = sizeInBytes;
-    resourceDesc.Height = 1;
-    resourceDesc.DepthOrArraySize = 1;
-    resourceDesc.MipLevels = 1;
-    resourceDesc.SampleDesc.Count = 1;
-    resourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-
-    // リソースの作成
-    ComPtr<ID3D12Resource> resource = nullptr;
-    HRESULT hr = device->CreateCommittedResource(
-        &heapProperties,
-        D3D12_HEAP_FLAG_NONE,
-        &resourceDesc,
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(&resource));
-    assert(SUCCEEDED(hr));
-
-    return resource;
-}
-
-struct Vector4 {
-    float x, y, z, w;
-};
-
-struct Vector2 {
-    float x, y;
-};
-
-struct VertexData {
-    Vector4 position;
-    Vector2 texcoord;
-    Vector3 normal;
-};
-
-struct Material {
-    Vector4 color;
-    int enableLighting;
-    int shadingType; // 0: Lambert, 1: HalfLambert
-    float padding[2];
-    Matrix4x4 uvTransform;
-};
-
-struct TransformationMatrix {
-    Matrix4x4 WVP;
-    Matrix4x4 World;
-};
-
 struct DirectionalLight {
     Vector4 color;
     Vector3 direction;
@@ -234,90 +121,93 @@ struct D3D12ResourceLeakChecker {
     }
 };
 
-IDxcBlob* CompileShader(
-    // Comilerするファイルへのパス
-    const std::wstring& filePath,
-    // Compilerに使用するProfile
-    const wchar_t* profile,
-    // 初期化で生成したものを3つ
-    ComPtr<IDxcUtils> dxcUtils, ComPtr<IDxcCompiler3> dxcCompiler, IDxcIncludeHandler* includeHandler)
-{
-    // 1.hlslファイルを読む
-    Log(ConvertString(std::format(L"Begin CompileShader, path:{}, profile:{}", filePath, profile)));
-    IDxcBlobEncoding* shaderSource = nullptr;
-    HRESULT hr = dxcUtils->LoadFile(filePath.c_str(), nullptr, &shaderSource);
-    assert(SUCCEEDED(hr));
-    DxcBuffer shaderSourceBuffer;
-    shaderSourceBuffer.Ptr = shaderSource->GetBufferPointer();
-    shaderSourceBuffer.Size = shaderSource->GetBufferSize();
-    shaderSourceBuffer.Encoding = DXC_CP_UTF8;
-
-    // 2.Compileする
-    LPCWSTR arguments[] = {
-        filePath.c_str(),
-        L"-E",
-        L"main",
-        L"-T",
-        profile,
-        L"-Zi",
-        L"-Qembed_debug",
-        L"-Od",
-        L"-Zpr",
-    };
-
-    IDxcResult* shaderResult = nullptr;
-    hr = dxcCompiler->Compile(
-        &shaderSourceBuffer,
-        arguments,
-        _countof(arguments),
-        includeHandler,
-        IID_PPV_ARGS(&shaderResult));
+// メッシュ1つ分の頂点バッファ
+struct MeshBuffer {
+    GpuAllocation memory;
+    D3D12_VERTEX_BUFFER_VIEW view {};
+    UINT vertexCount = 0;
+    uint32_t version = 0;
+};
 
-    assert(SUCCEEDED(hr));
+// メッシュの頂点をアップロードヒープに書き込む(差し替え時は作り直す)
+void UploadMeshBuffer(GpuMemoryAllocator& gpuMemory, const MeshData& mesh, MeshBuffer& buffer)
+{
+    UINT sizeInBytes = UINT(sizeof(VertexData) * mesh.vertices.size());
+    buffer.memory = gpuMemory.CreateBuffer(sizeInBytes);
+
+    VertexData* mappedData = nullptr;
+    buffer.memory.resource->Map(0, nullptr, reinterpret_cast<void**>(&mappedData));
+    std::memcpy(mappedData, mesh.vertices.data(), sizeInBytes);
+    buffer.memory.resource->Unmap(0, nullptr);
+
+    buffer.view.BufferLocation = buffer.memory.resource->GetGPUVirtualAddress();
+    buffer.view.SizeInBytes = sizeInBytes;
+    buffer.view.StrideInBytes = sizeof(VertexData);
+    buffer.vertexCount = UINT(mesh.vertices.size());
+    buffer.version = mesh.version;
+}
 
-    // 3.警告・エラーが出てないか確認する
-    IDxcBlobUtf8* shaderError = nullptr;
-    shaderResult->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(&shaderError), nullptr);
-    if (shaderError != nullptr && shaderError->GetStringLength() != 0) {
-        Log(shaderError->GetStringPointer());
-        assert(false); // エラーが出たので起動できない
+// 全ファイルをばらばらに読む場合とアーカイブから読む場合の時間(ミリ秒)を測る
+double MeasureLooseRead(const std::vector<std::string>& files, uint64_t& checksum)
+{
+    StartupTimeline::Clock::time_point begin = StartupTimeline::Clock::now();
+    for (const std::string& file : files) {
+        AssetBytes bytes;
+        ReadAssetBytes(nullptr, file, bytes);
+        checksum ^= HashBytes(bytes.data, bytes.size);
     }
+    return std::chrono::duration<double, std::milli>(StartupTimeline::Clock::now() - begin).count();
+}
 
-    // 4.Compile結果を受け取って返す
-    IDxcBlob* shaderBlob = nullptr;
-    hr = shaderResult->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&shaderBlob), nullptr);
-    assert(SUCCEEDED(hr));
-    Log(ConvertString(std::format(L"Compile Succeeded, path:{}, profile:{}", filePath, profile)));
-    // 読み込んだファイルのリソースを解放する
-    shaderSource->Release();
-    shaderResult->Release();
-    return shaderBlob;
+double MeasureArchiveRead(const std::string& archivePath, const std::vector<std::string>& files, uint64_t& checksum)
+{
+    StartupTimeline::Clock::time_point begin = StartupTimeline::Clock::now();
+    GpakArchive archive;
+    bool opened = archive.Open(archivePath);
+    assert(opened);
+    (void)opened;
+    for (const std::string& file : files) {
+        AssetBytes bytes;
+        archive.Read(file, bytes);
+        checksum ^= HashBytes(bytes.data, bytes.size);
+    }
+    return std::chrono::duration<double, std::milli>(StartupTimeline::Clock::now() - begin).count();
 }
 
-ComPtr<ID3D12Resource> CreateBufferResouse(ID3D12Device* device, size_t sizeInBytes)
+// directory以下をarchivePathにまとめ、読み込み時間を比べる
+// シェーダーはDXCがインクルードを解決するためディスクに残す
+void PackResources(const std::string& directory, const std::string& archivePath, ThreadPool& threadPool)
 {
-    // 生成したShaderのリソースを解放する
-    D3D12_HEAP_PROPERTIES uploadHeapProperties {};
-    uploadHeapProperties.Type = D3D12_HEAP_TYPE_UPLOAD;
-    // 頂点リソースの設定
-    D3D12_RESOURCE_DESC vertexResourceDesc {};
-    // バッファリソース。テクスチャの場合はまた別の設定をする
-    vertexResourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-    vertexResourceDesc.Width = sizeInBytes;
-    // バッファの場合はこれらは1にする決まり
-    vertexResourceDesc.Height = 1;
-    vertexResourceDesc.DepthOrArraySize = 1;
-    vertexResourceDesc.MipLevels = 1;
-    vertexResourceDesc.SampleDesc.Count = 1;
-    // バッファの場合はこれにする決まり
-    vertexResourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-    // 実際に頂点リソースを作る
-    ComPtr<ID3D12Resource> vertexResource = nullptr;
-    HRESULT hr = device->CreateCommittedResource(&uploadHeapProperties, D3D12_HEAP_FLAG_NONE,
-        &vertexResourceDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-        IID_PPV_ARGS(&vertexResource));
-    assert(SUCCEEDED(hr));
-    return vertexResource;
+    std::vector<std::string> files;
+    for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator(directory)) {
+        std::string path = entry.path().generic_string();
+        if (entry.is_regular_file() && TextureCache::NormalizePath(path).find("/shaders/") == std::string::npos) {
+            files.push_back(path);
+        }
+    }
+
+    // PNGやJPEGはもう圧縮されているのでそのまま入れる
+    GpakWriter writer;
+    for (const std::string& file : files) {
+        std::string extension = TextureCache::NormalizePath(std::filesystem::path(file).extension().string());
+        writer.AddFile(file, file, extension != ".png" && extension != ".jpg" && extension != ".jpeg");
+    }
+    GpakPackStats packStats;
+    if (!writer.Write(archivePath, threadPool, packStats)) {
+        Log(std::format("GpakWriter: failed to write {}\n", archivePath));
+        return;
+    }
+    Log(std::format("GpakWriter: {} files ({} compressed), {} -> {} bytes, {:.2f}ms\n",
+        packStats.files, packStats.compressedFiles, packStats.sourceBytes, packStats.archiveBytes, packStats.milliseconds));
+
+    // 直前に書いたファイルはOSのキャッシュに載っている。本当のコールドスタートは再起動直後に測ること
+    uint64_t looseChecksum = 0;
+    uint64_t archiveChecksum = 0;
+    double looseMilliseconds = MeasureLooseRead(files, looseChecksum);
+    double archiveMilliseconds = MeasureArchiveRead(archivePath, files, archiveChecksum);
+    assert(looseChecksum == archiveChecksum);
+    Log(std::format("Load {} files: loose {:.2f}ms, archive {:.2f}ms (x{:.2f})\n",
+        files.size(), looseMilliseconds, archiveMilliseconds, archiveMilliseconds > 0.0 ? looseMilliseconds / archiveMilliseconds : 0.0));
 }
 
 ComPtr<ID3D12DescriptorHeap> CreateDescriptorHeap(
@@ -341,47 +231,18 @@ ComPtr<ID3D12DescriptorHeap> CreateDescriptorHeap(
     return descriptorHeap;
 }
 
-ComPtr<ID3D12Resource> CreateDepthStencilTextureResource(
-    ID3D12Device* device, int32_t width, int32_t height)
-{
-    // 深度ステンシルテクスチャの設定
-    D3D12_RESOURCE_DESC resourceDesc = {};
-    resourceDesc.Width = width; // 幅
-    resourceDesc.Height = height; // 高さ
-    resourceDesc.MipLevels = 1; // ミップレベル
-    resourceDesc.DepthOrArraySize = 1; // 深度または配列サイズ
-    resourceDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT; // 深度ステンシルフォーマット
-    resourceDesc.SampleDesc.Count = 1; // サンプル数
-    resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D; // 2Dテクスチャ
-    resourceDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL; // 深度ステンシルを許可
-
-    // ヒーププロパティの設定
-    D3D12_HEAP_PROPERTIES heapProperties = {};
-    heapProperties.Type = D3D12_HEAP_TYPE_DEFAULT;
-    D3D12_CLEAR_VALUE depthClearValue {};
-    depthClearValue.DepthStencil.Depth = 1.0f;
-    depthClearValue.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
-    ComPtr<ID3D12Resource> resource = nullptr;
-    HRESULT hr = device->CreateCommittedResource(
-        &heapProperties,
-        D3D12_HEAP_FLAG_NONE,
-        &resourceDesc,
-        D3D12_RESOURCE_STATE_DEPTH_WRITE,
-        &depthClearValue,
-        IID_PPV_ARGS(&resource));
-    assert(SUCCEEDED(hr));
-    return resource;
-}
-
 // --------------------------------------------------
 // メイン関数
 // --------------------------------------------------
 
 // Windowsアプリでのエントリーポイント(main関数)
-int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
+int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR lpCmdLine, int)
 {
     D3D12ResourceLeakChecker leakCheck;
 
+    // 最初のフレームを出すまでの時間を記録する
+    StartupTimeline startupTimeline;
+
     // DXGIファクトリーの生成
     ComPtr<IDXGIFactory7> dxgiFactory;
 
@@ -396,6 +257,56 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
 
     CoInitializeEx(nullptr, COINIT_MULTITHREADED);
 
+    // テクスチャのデコードとミップ生成は、デバイスの準備やシェーダーのコンパイルと並行してワーカーで進める
+    ThreadPool threadPool;
+
+    // -cook で起動したらResources以下の画像をDDSに変換して終了する
+    if (std::string(lpCmdLine).find("-cook") != std::string::npos) {
+        TextureCooker textureCooker;
+        TextureCookerStats cookStats = textureCooker.Cook(TextureCooker::FindSourceFiles("Resources"), threadPool);
+        Log(std::format("TextureCooker: cooked {}, up to date {}, failed {}, {} -> {} bytes, {:.2f}ms\n",
+            cookStats.cooked, cookStats.upToDate, cookStats.failed, cookStats.uncompressedBytes, cookStats.cookedBytes, cookStats.milliseconds));
+        winApp->Finalize();
+        return 0;
+    }
+
+    // -pack で起動したらResources以下をアーカイブにまとめ、読み込み時間を比べて終了する(クックの後に行う)
+    if (std::string(lpCmdLine).find("-pack") != std::string::npos) {
+        PackResources("Resources", "Resources.gpak", threadPool);
+        winApp->Finalize();
+        return 0;
+    }
+
+    // アーカイブがあればそこから読み、無ければ今まで通りResources以下を読む
+    GpakArchive archive;
+    {
+        StartupTimeline::Scope scope(&startupTimeline, "Open archive");
+        archive.Open("Resources.gpak");
+    }
+    const GpakArchive* assetArchive = archive.IsOpen() ? &archive : nullptr;
+    Log(std::format("GpakArchive: {} entries\n", archive.GetEntryCount()));
+
+    // テクスチャやバッファは大きなヒープにまとめて置く(デバイスを作った後に初期化する)
+    // リソースより先に作っておき、最後に解放されるようにする
+    GpuMemoryAllocator gpuMemory;
+
+    TextureManager textureManager(&threadPool);
+    textureManager.SetTimeline(&startupTimeline);
+    textureManager.SetArchive(assetArchive);
+    textureManager.SetCookedDirectory("Resources/cooked");
+
+    std::vector<std::string> textureFiles = {
+        "Resources/uvChecker.png",
+        "Resources/monsterBall.png",
+    };
+    for (const std::string& textureFile : textureFiles) {
+        textureManager.RequestLoad(textureFile);
+    }
+    // スプライト用(上と同じファイルなので読み込み直さずに共有される)
+    textureManager.RequestLoad("./Resources/uvChecker.png");
+
+    StartupTimeline::Clock::time_point deviceSetupBegin = StartupTimeline::Clock::now();
+
 #ifdef _DEBUG
     ComPtr<ID3D12Debug1> debugController = nullptr;
     if (SUCCEEDED(D3D12GetDebugInterface(IID_PPV_ARGS(&debugController)))) {
@@ -474,17 +385,21 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
     // コマンドキューの生成に失敗したので起動できない
     assert(SUCCEEDED(hr));
 
-    // コマンドアロケータを生成する
-    ComPtr<ID3D12CommandAllocator> commandAllocator = nullptr;
+    // コマンドアロケータとフェンスの値をフレームごとに持ち、CPUはGPUよりkFramesInFlightフレーム先行したときだけ待つ
+    // 毎フレーム書き換える定数や頂点は1つのアップロードリングから切り出し、フレームが終わったら返す
+    const uint32_t kFramesInFlight = 2;
+    // SpriteBatchの板(1枚80バイト)を13万枚ほど書いても、前のフレームを待たずに済む大きさ
+    const uint64_t kUploadRingBytes = 32 * 1024 * 1024;
+    FrameContextRing frameContexts(device.Get(), commandQueue.Get(), kFramesInFlight, kUploadRingBytes);
 
-    // コマンドアロケータの生成
-    hr = device->CreateCommandAllocator(
-        D3D12_COMMAND_LIST_TYPE_DIRECT, // コマンドリストの種類
-        IID_PPV_ARGS(&commandAllocator) // コマンドアロケータのポインタ
-    );
+    // 変わらないバッファとテクスチャは32MBのヒープにTLSFで置いていく
+    const uint64_t kGpuHeapBytes = 32 * 1024 * 1024;
+    gpuMemory.Initialize(device.Get(), kGpuHeapBytes);
 
-    // コマンドアロケータの生成に失敗したので起動できない
-    assert(SUCCEEDED(hr));
+    // テクスチャの中身はコピー専用のキューでDEFAULTヒープへ写し、描画のキューは待たない
+    const uint64_t kTextureStagingBytes = 32 * 1024 * 1024;
+    const uint64_t kTextureUploadBatchBytes = 4 * 1024 * 1024;
+    TextureUploader textureUploader(device.Get(), kTextureStagingBytes, kTextureUploadBatchBytes);
 
     // コマンドリストを生成する
     ComPtr<ID3D12GraphicsCommandList> commandList = nullptr;
@@ -493,7 +408,7 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
     hr = device->CreateCommandList(
         0, // コマンドリストのフラグ
         D3D12_COMMAND_LIST_TYPE_DIRECT, // コマンドリストの種類
-        commandAllocator.Get(), // コマンドアロケータ
+        frameContexts.GetCommandAllocator(), // コマンドアロケータ
         nullptr, // パイプラインステートオブジェクト
         IID_PPV_ARGS(&commandList) // コマンドリストのポインタ
     );
@@ -501,6 +416,10 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
     // コマンドリストの生成に失敗したので起動できない
     assert(SUCCEEDED(hr));
 
+    // 開き直しは毎フレームの先頭で行うので、いったん閉じておく
+    hr = commandList->Close();
+    assert(SUCCEEDED(hr));
+
     // スワップチェーンを生成する
     ComPtr<IDXGISwapChain4> swapChain = nullptr;
     DXGI_SWAP_CHAIN_DESC1 swapChainDesc = {};
@@ -523,8 +442,13 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
     ComPtr<ID3D12DescriptorHeap> rtvDescriptorHeap = CreateDescriptorHeap(
         device.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_RTV, 2, false);
 
-    ComPtr<ID3D12DescriptorHeap> srvDescriptorHeap = CreateDescriptorHeap(
-        device.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 128, true);
+    // SRVはCPUだけから見えるステージングヒープに作り、描画に使う分だけを毎フレームまとめてシェーダーから見えるヒープへ写す
+    // シェーダーから見えるヒープの常駐範囲は、ImGuiのフォントのようにずっと同じ場所を使うもの
+    const uint32_t kPersistentDescriptors = 16;
+    const uint32_t kFrameDescriptors = 1024;
+    const uint32_t kStagingDescriptors = 1024;
+    DescriptorAllocator descriptors(device.Get(), kPersistentDescriptors, kFrameDescriptors, kStagingDescriptors);
+    frameContexts.AttachDescriptorAllocator(&descriptors);
 
     // スワップチェーンからリソースを引っ張ってくる
     ComPtr<ID3D12Resource> swapChainResoures[2] = { nullptr };
@@ -541,6 +465,14 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
     // スワップチェーンのリソースの取得に失敗したので起動できない
     assert(SUCCEEDED(hr));
 
+    // バリアはResourceStateTrackerを通して張り、コマンドリストをまたいだ状態はこれで追う
+    ResourceStateRegistry resourceStates;
+#ifdef _DEBUG
+    resourceStates.SetValidation(true);
+#endif
+    resourceStates.Register(swapChainResoures[0].Get(), D3D12_RESOURCE_STATE_PRESENT);
+    resourceStates.Register(swapChainResoures[1].Get(), D3D12_RESOURCE_STATE_PRESENT);
+
     // RTVの設定
     D3D12_RENDER_TARGET_VIEW_DESC rtvDesc = {};
 
@@ -563,29 +495,6 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
     // 2つ目を作る
     device->CreateRenderTargetView(swapChainResoures[1].Get(), &rtvDesc, rtvHandles[1]);
 
-    // 初期値0でFrenceを作る
-    ComPtr<ID3D12Fence> fence = nullptr;
-    uint64_t fenceValue = 0;
-    hr = device->CreateFence(fenceValue, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence));
-    assert(SUCCEEDED(hr));
-
-    // FenceのSignalを持つためのイベントを作成する
-    HANDLE fenceEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
-    assert(fenceEvent != nullptr);
-
-    // dxcCompilerを初期化
-    ComPtr<IDxcUtils> dxcUtils = nullptr;
-    ComPtr<IDxcCompiler3> dxcCompiler = nullptr;
-    hr = DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&dxcUtils));
-    assert(SUCCEEDED(hr));
-    hr = DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&dxcCompiler));
-    assert(SUCCEEDED(hr));
-
-    // 現時点でincludeはしないが、includeに対応するための設定を行っておく
-    IDxcIncludeHandler* includeHandler = nullptr;
-    hr = dxcUtils->CreateDefaultIncludeHandler(&includeHandler);
-    assert(SUCCEEDED(hr));
-
     D3D12_ROOT_SIGNATURE_DESC descriptionRootSignature {};
     descriptionRootSignature.Flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT;
 
@@ -595,10 +504,12 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
     descriptorRanges[0].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
     descriptorRanges[0].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
 
-    D3D12_ROOT_PARAMETER rootParameters[4] = {};
-    rootParameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
+    D3D12_ROOT_PARAMETER rootParameters[5] = {};
+    // マテリアルは表の番号だけをルート定数で渡す
+    rootParameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
     rootParameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
-    rootParameters[0].Descriptor.ShaderRegister = 0;
+    rootParameters[0].Constants.ShaderRegister = 0;
+    rootParameters[0].Constants.Num32BitValues = 1;
     rootParameters[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
     rootParameters[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
     rootParameters[1].Descriptor.ShaderRegister = 0;
@@ -609,6 +520,10 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
     rootParameters[3].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
     rootParameters[3].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
     rootParameters[3].Descriptor.ShaderRegister = 1;
+    // マテリアルの表(StructuredBuffer)
+    rootParameters[4].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+    rootParameters[4].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+    rootParameters[4].Descriptor.ShaderRegister = 1;
 
     // レジスタ番号1を使う
     descriptionRootSignature.pParameters = rootParameters;
@@ -644,6 +559,10 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
 
     assert(SUCCEEDED(hr));
 
+    // PSOは記述全体のハッシュで使い回し、作ったものはパイプラインライブラリに残して次の起動で読む
+    PipelineCache pipelineCache(device.Get(), threadPool);
+    pipelineCache.RegisterRootSignature(rootSignature.Get(), signatureBlob->GetBufferPointer(), signatureBlob->GetBufferSize());
+
     D3D12_INPUT_ELEMENT_DESC inputElementDescs[3] = {};
     inputElementDescs[0].SemanticName = "POSITION";
     inputElementDescs[0]
@@ -672,22 +591,49 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
     rasterizerDesc.CullMode = D3D12_CULL_MODE_BACK;
     rasterizerDesc.FillMode = D3D12_FILL_MODE_SOLID;
 
-    // Shaderをコンパイルする
-    IDxcBlob* vertexShaderBlob = CompileShader(L"Resources/shaders/object3d/Object3dVS.hlsl",
-        L"vs_6_0", dxcUtils, dxcCompiler, includeHandler);
-    assert(vertexShaderBlob != nullptr);
+    startupTimeline.Record("Device setup", deviceSetupBegin, StartupTimeline::Clock::now());
 
-    IDxcBlob* pixelShaderBlob = CompileShader(L"Resources/shaders/object3d/Object3dPS.hlsl",
-        L"ps_6_0", dxcUtils, dxcCompiler, includeHandler);
-    assert(pixelShaderBlob != nullptr);
+    // Shaderをコンパイルする
+    StartupTimeline::Clock::time_point shaderCompileBegin = StartupTimeline::Clock::now();
+    // コンパイル済みのDXILはキャッシュに置き、入力が変わっていなければ読むだけで済ませる
+    // キャッシュに無いものはスレッドプールで並列にコンパイルする
+    ShaderCache shaderCache;
+    const std::string vertexShaderPath = "Resources/shaders/object3d/Object3dVS.hlsl";
+    // ピクセルシェーダーは機能キーワードの有効な組み合わせごとにコンパイルし、描画ごとにマテリアルで選ぶ
+    const std::string pixelShaderPath = "Resources/shaders/object3d/Object3dPS.hlsl";
+    ShaderPermutation pixelPermutation;
+    bool pixelPermutationParsed = pixelPermutation.ParseFile(pixelShaderPath);
+    assert(pixelPermutationParsed);
+
+    std::vector<ShaderCompileDesc> shaderDescs = { { vertexShaderPath, L"vs_6_0", {} } };
+    for (ShaderPermutation::Key key : pixelPermutation.GetVariants()) {
+        shaderDescs.push_back({ pixelShaderPath, L"ps_6_0", pixelPermutation.GetDefines(key) });
+    }
+    // SpriteBatchのシェーダーも一緒にコンパイルする(後ろの2つ)
+    const std::string spriteVertexShaderPath = "Resources/shaders/sprite/SpriteVS.hlsl";
+    const std::string spritePixelShaderPath = "Resources/shaders/sprite/SpritePS.hlsl";
+    const size_t spriteShaderIndex = shaderDescs.size();
+    shaderDescs.push_back({ spriteVertexShaderPath, L"vs_6_0", {} });
+    shaderDescs.push_back({ spritePixelShaderPath, L"ps_6_0", {} });
+    std::vector<ShaderCompileResult> shaderResults = shaderCache.Compile(shaderDescs, &threadPool);
+    // エラーが出たので起動できない
+    bool shadersCompiled = LogShaderResults(shaderDescs, shaderResults);
+    assert(shadersCompiled);
+    ComPtr<IDxcBlob> vertexShaderBlob = shaderResults[0].blob;
+    std::vector<ComPtr<IDxcBlob>> pixelShaderBlobs;
+    for (size_t i = 1; i < spriteShaderIndex; ++i) {
+        pixelShaderBlobs.push_back(shaderResults[i].blob);
+    }
+    const ShaderCacheStats shaderCacheStats = shaderCache.GetStats();
+    Log(std::format("ShaderCache: {} cached, {} compiled, {:.1f} ms\n", shaderCacheStats.hits, shaderCacheStats.compiled, shaderCacheStats.lastMilliseconds));
+    startupTimeline.Record("Shader compile", shaderCompileBegin, StartupTimeline::Clock::now());
 
     D3D12_GRAPHICS_PIPELINE_STATE_DESC graphicsPipelineStateDesc {};
     graphicsPipelineStateDesc.pRootSignature = rootSignature.Get(); // RootSignature
     graphicsPipelineStateDesc.InputLayout = inputLayoutDesc; // InputLayout
     graphicsPipelineStateDesc.VS = { vertexShaderBlob->GetBufferPointer(),
         vertexShaderBlob->GetBufferSize() }; // VertexShader
-    graphicsPipelineStateDesc.PS = { pixelShaderBlob->GetBufferPointer(),
-        pixelShaderBlob->GetBufferSize() }; // PixelShader
+    // PixelShaderはバリアントごとに差し替える
     graphicsPipelineStateDesc.BlendState = blendDesc; // BlendState
     graphicsPipelineStateDesc.RasterizerState = rasterizerDesc; // RasterizerSt
     // 書き込むRTVの情報
@@ -708,100 +654,134 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
     graphicsPipelineStateDesc.DepthStencilState = depthStencilDesc;
     graphicsPipelineStateDesc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
 
-    // 実際に生成
-    ComPtr<ID3D12PipelineState> graphicsPipelineState = nullptr;
-    hr = device->CreateGraphicsPipelineState(&graphicsPipelineStateDesc,
-        IID_PPV_ARGS(&graphicsPipelineState));
-    assert(SUCCEEDED(hr));
-
-    ComPtr<ID3D12Resource> wvpResource = CreateBufferResouse(device.Get(), sizeof(TransformationMatrix));
-    TransformationMatrix* wvpData = nullptr;
-    wvpResource->Map(0, nullptr, reinterpret_cast<void**>(&wvpData));
-
-    ComPtr<ID3D12Resource> materialResource = CreateBufferResouse(device.Get(), sizeof(Vector4) * 3);
-
-    Material* materialData = nullptr;
-    materialResource->Map(0, nullptr, reinterpret_cast<void**>(&materialData));
-    materialData->color = { 1.0f, 1.0f, 1.0f, 1.0f };
-    materialData->uvTransform = MakeIdentity4x4();
-
-    // --- 頂点バッファ生成前に定義 ---
-    const uint32_t kSubdivision = 32; // 分割数（大きいほど滑らか）
-    const uint32_t kSphereVertexCount = kSubdivision * kSubdivision * 6;
-
-    // 頂点バッファ用リソースを作成
-    ComPtr<ID3D12Resource> vertexResource = CreateBufferResouse(device.Get(), sizeof(VertexData) * kSphereVertexCount);
-
-    // 頂点データを書き込む
-    VertexData* vertexData = nullptr;
-    vertexResource->Map(0, nullptr, reinterpret_cast<void**>(&vertexData));
-
-    // 球体メッシュ生成
-    const float kRadius = 1.0f;
-    const float kPi = std::numbers::pi_v<float>;
-    const float kTwoPi = kPi * 2.0f;
-    uint32_t vertexIdx = 0;
-    for (uint32_t lat = 0; lat < kSubdivision; ++lat) {
-        float lat0 = kPi * (float(lat) / kSubdivision - 0.5f); // -π/2 ～ +π/2
-        float lat1 = kPi * (float(lat + 1) / kSubdivision - 0.5f);
-        for (uint32_t lon = 0; lon < kSubdivision; ++lon) {
-            float lon0 = kTwoPi * float(lon) / kSubdivision;
-            float lon1 = kTwoPi * float(lon + 1) / kSubdivision;
-
-            // 4点の球面座標
-            Vector4 p00 = { kRadius * cos(lat0) * cos(lon0), kRadius * sin(lat0), kRadius * cos(lat0) * sin(lon0), 1.0f };
-            Vector4 p01 = { kRadius * cos(lat0) * cos(lon1), kRadius * sin(lat0), kRadius * cos(lat0) * sin(lon1), 1.0f };
-            Vector4 p10 = { kRadius * cos(lat1) * cos(lon0), kRadius * sin(lat1), kRadius * cos(lat1) * sin(lon0), 1.0f };
-            Vector4 p11 = { kRadius * cos(lat1) * cos(lon1), kRadius * sin(lat1), kRadius * cos(lat1) * sin(lon1), 1.0f };
-
-            // テクスチャ座標
-            Vector2 uv00 = { float(lon) / kSubdivision, 1.0f - float(lat) / kSubdivision };
-            Vector2 uv01 = { float(lon + 1) / kSubdivision, 1.0f - float(lat) / kSubdivision };
-            Vector2 uv10 = { float(lon) / kSubdivision, 1.0f - float(lat + 1) / kSubdivision };
-            Vector2 uv11 = { float(lon + 1) / kSubdivision, 1.0f - float(lat + 1) / kSubdivision };
-
-            // 2三角形
-            vertexData[vertexIdx++] = { p00, uv00 };
-            vertexData[vertexIdx++] = { p10, uv10 };
-            vertexData[vertexIdx++] = { p11, uv11 };
-
-            vertexData[vertexIdx++] = { p00, uv00 };
-            vertexData[vertexIdx++] = { p11, uv11 };
-            vertexData[vertexIdx++] = { p01, uv01 };
+    // SpriteBatchの板。画面の上にアルファブレンドで重ね、深度もカリングも使わない
+    D3D12_INPUT_ELEMENT_DESC spriteInputElementDescs[3] = {};
+    spriteInputElementDescs[0].SemanticName = "POSITION";
+    spriteInputElementDescs[0].Format = DXGI_FORMAT_R32G32_FLOAT;
+    spriteInputElementDescs[0].AlignedByteOffset = D3D12_APPEND_ALIGNED_ELEMENT;
+    spriteInputElementDescs[1].SemanticName = "TEXCOORD";
+    spriteInputElementDescs[1].Format = DXGI_FORMAT_R32G32_FLOAT;
+    spriteInputElementDescs[1].AlignedByteOffset = D3D12_APPEND_ALIGNED_ELEMENT;
+    spriteInputElementDescs[2].SemanticName = "COLOR";
+    spriteInputElementDescs[2].Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    spriteInputElementDescs[2].AlignedByteOffset = D3D12_APPEND_ALIGNED_ELEMENT;
+
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC spritePipelineStateDesc = graphicsPipelineStateDesc;
+    spritePipelineStateDesc.InputLayout = { spriteInputElementDescs, _countof(spriteInputElementDescs) };
+    spritePipelineStateDesc.VS = { shaderResults[spriteShaderIndex].blob->GetBufferPointer(), shaderResults[spriteShaderIndex].blob->GetBufferSize() };
+    spritePipelineStateDesc.PS = { shaderResults[spriteShaderIndex + 1].blob->GetBufferPointer(), shaderResults[spriteShaderIndex + 1].blob->GetBufferSize() };
+    D3D12_RENDER_TARGET_BLEND_DESC& spriteBlend = spritePipelineStateDesc.BlendState.RenderTarget[0];
+    spriteBlend.BlendEnable = true;
+    spriteBlend.SrcBlend = D3D12_BLEND_SRC_ALPHA;
+    spriteBlend.DestBlend = D3D12_BLEND_INV_SRC_ALPHA;
+    spriteBlend.BlendOp = D3D12_BLEND_OP_ADD;
+    spriteBlend.SrcBlendAlpha = D3D12_BLEND_ONE;
+    spriteBlend.DestBlendAlpha = D3D12_BLEND_INV_SRC_ALPHA;
+    spriteBlend.BlendOpAlpha = D3D12_BLEND_OP_ADD;
+    spritePipelineStateDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+    spritePipelineStateDesc.DepthStencilState.DepthEnable = false;
+    spritePipelineStateDesc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
+    spritePipelineStateDesc.DSVFormat = DXGI_FORMAT_UNKNOWN;
+    pipelineCache.Prewarm(spritePipelineStateDesc);
+
+    // ピクセルシェーダーのバリアントごとの記述
+    auto makePipelineDescs = [](D3D12_GRAPHICS_PIPELINE_STATE_DESC desc, const std::vector<ComPtr<IDxcBlob>>& pixelBlobs) {
+        std::vector<D3D12_GRAPHICS_PIPELINE_STATE_DESC> descs(pixelBlobs.size(), desc);
+        for (size_t i = 0; i < pixelBlobs.size(); ++i) {
+            descs[i].PS = { pixelBlobs[i]->GetBufferPointer(), pixelBlobs[i]->GetBufferSize() };
         }
-    }
+        return descs;
+    };
+    // バリアントごとにワーカーで作り、そろったら差し替える。1つでも失敗したら何も差し替えない
+    auto createPipelineStates = [&](const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, const std::vector<ComPtr<IDxcBlob>>& pixelBlobs,
+                                    std::vector<ComPtr<ID3D12PipelineState>>& pipelineStates) {
+        std::vector<D3D12_GRAPHICS_PIPELINE_STATE_DESC> descs = makePipelineDescs(desc, pixelBlobs);
+        for (const D3D12_GRAPHICS_PIPELINE_STATE_DESC& variantDesc : descs) {
+            pipelineCache.Prewarm(variantDesc);
+        }
+        std::vector<ComPtr<ID3D12PipelineState>> created;
+        for (const D3D12_GRAPHICS_PIPELINE_STATE_DESC& variantDesc : descs) {
+            ComPtr<ID3D12PipelineState> pipelineState = pipelineCache.GetOrCreate(variantDesc);
+            if (pipelineState == nullptr) {
+                return false;
+            }
+            created.push_back(pipelineState);
+        }
+        pipelineStates = std::move(created);
+        return true;
+    };
 
-    for (uint32_t i = 0; i < vertexIdx; ++i) {
-        vertexData[i].normal.x = vertexData[i].position.x;
-        vertexData[i].normal.y = vertexData[i].position.y;
-        vertexData[i].normal.z = vertexData[i].position.z;
+    // 起動時はワーカーで作り始めておき、メッシュやテクスチャの準備の後で受け取る
+    for (const D3D12_GRAPHICS_PIPELINE_STATE_DESC& variantDesc : makePipelineDescs(graphicsPipelineStateDesc, pixelShaderBlobs)) {
+        pipelineCache.Prewarm(variantDesc);
     }
+    std::vector<ComPtr<ID3D12PipelineState>> graphicsPipelineStates;
+    ComPtr<ID3D12PipelineState> spritePipelineState;
+
+    // マテリアルの設定から、使うピクセルシェーダーのバリアントの番号を決める
+    auto selectPixelVariant = [&pixelPermutation](const Material& material) {
+        ShaderPermutation::Key key = 0;
+        if (material.enableLighting != 0) {
+            key |= pixelPermutation.GetKeywordBit("LIGHTING");
+        }
+        if (material.shadingType == 1) {
+            key |= pixelPermutation.GetKeywordBit("HALF_LAMBERT");
+        }
+        if (material.alphaTest != 0) {
+            key |= pixelPermutation.GetKeywordBit("ALPHA_TEST");
+        }
+        return pixelPermutation.GetVariantIndex(pixelPermutation.Resolve(key));
+    };
 
-    ComPtr<ID3D12Resource> directionalLightResource = CreateBufferResource(device.Get(), sizeof(DirectionalLight));
-    DirectionalLight* directionalLightData = nullptr;
-    directionalLightResource->Map(0, nullptr, reinterpret_cast<void**>(&directionalLightData));
-
-    // デフォルト値はとりあえず以下のようにしておく
-    directionalLightData->color = { 1.0f, 1.0f, 1.0f, 1.0f };
-    directionalLightData->direction = { 0.0f, -1.0f, 0.0f };
-    directionalLightData->intensity = 1.0f;
-
-    // Sprite用のマテリアルリソースを作る
-    ComPtr<ID3D12Resource> materialResourceSprite = CreateBufferResource(device.Get(), sizeof(Material));
+    // マテリアルはすべて1つの表に入れ、描画では番号で引く
+    MaterialTable materialTable;
+    materialTable.Initialize(gpuMemory, resourceStates, 256);
+
+    Material spriteMaterial {};
+    spriteMaterial.color = { 1.0f, 1.0f, 1.0f, 1.0f };
+    spriteMaterial.alphaTest = true;
+    spriteMaterial.uvTransform = MakeIdentity4x4();
+    const MaterialId spriteMaterialId = materialTable.Add(spriteMaterial);
+
+    // 描画はキーで並べ替えてから発行する
+    RenderQueue renderQueue(&threadPool);
+    // 描画が多いときは並べた順に区切り、ワーカーでそれぞれのコマンドリストに記録して順に1回で提出する
+    const uint32_t kMinDrawsPerCommandList = 256;
+    D3D12CommandListSet commandListSet(device.Get(), commandQueue.Get(), kFramesInFlight, descriptors.GetShaderVisibleHeap(), resourceStates);
+    ParallelRecorder parallelRecorder(commandListSet, &threadPool, kMinDrawsPerCommandList);
+    bool forceParallelRecording = false;
+
+    // 球・立方体・平面はその場で生成し、モデルはワーカースレッドで読み込む
+    MeshStreamer meshStreamer(threadPool);
+    meshStreamer.SetArchive(assetArchive);
+    MeshManager meshManager;
+    meshManager.AttachStreamer(&meshStreamer);
+    meshManager.RequestMesh("Resources/monkey/monkey.obj", MeshType_Model);
+
+    // メッシュごとの頂点バッファを作る
+    std::vector<MeshBuffer> meshBuffers(MeshType_Count);
+    for (int i = 0; i < MeshType_Count; ++i) {
+        UploadMeshBuffer(gpuMemory, meshManager.meshes[i], meshBuffers[i]);
+    }
 
-    vertexResource->Unmap(0, nullptr);
+    // スキニングのデモ(2関節で曲がる円柱)
+    SkinnedTubeDemo skinnedTubeDemo(&threadPool);
+    skinnedTubeDemo.Initialize();
 
-    // Lightingを有効にする
-    Material* materialDataSprite = nullptr;
-    materialResourceSprite->Map(0, nullptr, reinterpret_cast<void**>(&materialDataSprite));
+    // ライトはCPU側で編集し、毎フレームアップロードリングへ写す
+    DirectionalLight directionalLight {};
 
-    materialDataSprite->enableLighting = false;
+    // デフォルト値はとりあえず以下のようにしておく
+    directionalLight.color = { 1.0f, 1.0f, 1.0f, 1.0f };
+    directionalLight.direction = { 0.0f, -1.0f, 0.0f };
+    directionalLight.intensity = 1.0f;
 
-    // 頂点バッファビュー
-    D3D12_VERTEX_BUFFER_VIEW vertexBufferView = {};
-    vertexBufferView.BufferLocation = vertexResource->GetGPUVirtualAddress();
-    vertexBufferView.SizeInBytes = sizeof(VertexData) * kSphereVertexCount;
-    vertexBufferView.StrideInBytes = sizeof(VertexData);
+    // 球のマテリアル
+    Material sphereMaterial {};
+    sphereMaterial.color = { 1.0f, 1.0f, 1.0f, 1.0f };
+    sphereMaterial.enableLighting = true;
+    sphereMaterial.uvTransform = MakeIdentity4x4();
+    const MaterialId sphereMaterialId = materialTable.Add(sphereMaterial);
 
     // ビューポート
     D3D12_VIEWPORT viewport {};
@@ -823,23 +803,13 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
 
     Matrix4x4 projectionMatrix = MakePerspectiveFovMatrix(0.45f, float(WinApp::kClientWidth) / float(WinApp::kClientHeight), 0.1f, 100.0f);
 
-    Matrix4x4* transformationMatrixData = nullptr;
-    ComPtr<ID3D12Resource> transformationMatrixResource = CreateBufferResouse(device.Get(), sizeof(Matrix4x4));
-    transformationMatrixResource->Map(0, nullptr, reinterpret_cast<void**>(&transformationMatrixData));
+    // 1フレームの描画をパスの並びにする(深度バッファもここで持つ)
+    SceneRenderGraph sceneRenderGraph(device.Get(), resourceStates);
+    sceneRenderGraph.Initialize(WinApp::kClientWidth, WinApp::kClientHeight);
 
-    ComPtr<ID3D12Resource> depthStencilResource = CreateDepthStencilTextureResource(device.Get(), WinApp::kClientWidth, WinApp::kClientHeight);
-    ComPtr<ID3D12DescriptorHeap> dsvDescriptorHeap = CreateDescriptorHeap(
-        device.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_DSV, 1, false);
-    D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
-    dsvDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
-    dsvDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D;
-    device->CreateDepthStencilView(
-        depthStencilResource.Get(),
-        &dsvDesc,
-        dsvDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
-
-    // Sprite用の瓦点リソースを作る
-    ComPtr<ID3D12Resource> vertexResourceSprite = CreateBufferResouse(device.Get(), sizeof(VertexData) * 6);
+    // Sprite用の瓦点リソースを作る(中身は変わらないので専用のバッファに置く)
+    GpuAllocation spriteVertexMemory = gpuMemory.CreateBuffer(sizeof(VertexData) * 6);
+    ID3D12Resource* vertexResourceSprite = spriteVertexMemory.resource.Get();
 
     // 瓦点バッファビューを作成する
     D3D12_VERTEX_BUFFER_VIEW vertexBufferViewSprite {};
@@ -870,11 +840,6 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
     vertexDataSprite[5].position = { 640.0f, 360.0f, 0.0f, 1.0f };
     vertexDataSprite[5].texcoord = { 1.0f, 1.0f };
 
-    ComPtr<ID3D12Resource> transformationMatrixResourceSprite = CreateBufferResouse(device.Get(), sizeof(Matrix4x4));
-    Matrix4x4* transformationMatrixDataSprite = nullptr;
-    transformationMatrixResourceSprite->Map(0, nullptr, reinterpret_cast<void**>(&transformationMatrixDataSprite));
-    *transformationMatrixDataSprite = MakeIdentity4x4();
-
     Transform transformSprite {
         {
             1.0f,
@@ -893,8 +858,6 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
         }
     };
 
-    materialDataSprite->uvTransform = MakeIdentity4x4();
-
     Transform uvTransformSprite {
         {
             1.0f,
@@ -913,56 +876,30 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
         }
     };
 
-    std::vector<std::string> textureFiles = {
-        "Resources/uvChecker.png",
-        "Resources/monsterBall.png",
-    };
-    std::vector<ComPtr<ID3D12Resource>> textureResources;
-    std::vector<DirectX::ScratchImage> mipImagesList;
-    std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> textureSrvHandlesCPU;
-    std::vector<D3D12_GPU_DESCRIPTOR_HANDLE> textureSrvHandlesGPU;
-
-    UINT srvIncrement = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-    D3D12_CPU_DESCRIPTOR_HANDLE srvHandleCPU = srvDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
-    D3D12_GPU_DESCRIPTOR_HANDLE srvHandleGPU = srvDescriptorHeap->GetGPUDescriptorHandleForHeapStart();
-
-    // 先頭はImGui用に1つ使われているので+1
-    srvHandleCPU.ptr += srvIncrement;
-    srvHandleGPU.ptr += srvIncrement;
-
-    for (size_t i = 0; i < textureFiles.size(); ++i) {
-        mipImagesList.push_back(LoadTexture(textureFiles[i]));
-        const DirectX::TexMetadata& metadata = mipImagesList.back().GetMetadata();
-        ComPtr<ID3D12Resource> texRes = CreateTextureResourse(device.Get(), metadata);
-        UploadTextureData(texRes.Get(), mipImagesList.back());
-        textureResources.push_back(texRes);
-
-        D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc {};
-        srvDesc.Format = metadata.format;
-        srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-        srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-        srvDesc.Texture2D.MipLevels = UINT(metadata.mipLevels);
-
-        device->CreateShaderResourceView(texRes.Get(), &srvDesc, srvHandleCPU);
-
-        textureSrvHandlesCPU.push_back(srvHandleCPU);
-        textureSrvHandlesGPU.push_back(srvHandleGPU);
-
-        srvHandleCPU.ptr += srvIncrement;
-        srvHandleGPU.ptr += srvIncrement;
-    }
+    textureManager.Initialize(device.Get(), &gpuMemory, &descriptors, &textureUploader);
+    // 作り直したテクスチャの古いリソースは、流しているフレームが終わってから返す
+    textureManager.SetDeferRelease([&frameContexts](std::function<void()> release) { frameContexts.DeferRelease(std::move(release)); });
+    // 最初は粗いミップだけを載せ、画面上の大きさに応じて細かいミップを読み込む
+    int textureBudgetMegabytes = 64;
+    textureManager.EnableStreaming(uint64_t(textureBudgetMegabytes) << 20);
+
+    // 依頼順に textureFiles の分、最後にスプライト用
+    std::vector<TextureHandle> textureHandles = textureManager.FinishLoading();
+    TextureHandle spriteTexture = textureHandles.back();
+    textureHandles.pop_back();
 
     // ImGuiの初期化
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
     ImGui::StyleColorsDark();
     ImGui_ImplWin32_Init(winApp->GetHwnd());
+    DescriptorRange imguiFontDescriptor = descriptors.AllocatePersistent(1);
     ImGui_ImplDX12_Init(device.Get(),
-        swapChainDesc.BufferCount,
+        frameContexts.GetFrameCount(),
         rtvDesc.Format,
-        srvDescriptorHeap.Get(),
-        srvDescriptorHeap->GetCPUDescriptorHandleForHeapStart(),
-        srvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
+        descriptors.GetShaderVisibleHeap(),
+        imguiFontDescriptor.cpuHandle,
+        imguiFontDescriptor.gpuHandle);
 
     ImGuiIO& io = ImGui::GetIO();
     io.ConfigFlags |= ImGuiConfigFlags_NavEnableGamepad; // ゲームパッドナビ有効化
@@ -981,34 +918,100 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
     style.Colors[ImGuiCol_ButtonHovered] = ImVec4(0.8f, 0.5f, 0.3f, 1.0f); // 薄いオレンジ
     style.Colors[ImGuiCol_ButtonActive] = ImVec4(1.0f, 0.3f, 0.2f, 1.0f); // 赤っぽい
 
-    DirectX::ScratchImage mipImages = LoadTexture("Resources/uvChecker.png");
-    const DirectX::TexMetadata& metadata = mipImages.GetMetadata();
-    ComPtr<ID3D12Resource> textureResouce = CreateTextureResourse(device.Get(), metadata);
-    UploadTextureData(textureResouce.Get(), mipImages);
+    {
+        const TextureCacheStats& textureStats = textureManager.GetStats();
+        Log(std::format("Texture: {} requests, {} unique, {} path hits, {} content hits, {} bytes resident, {} bytes saved\n",
+            textureStats.requests, textureStats.uniqueTextures, textureStats.pathHits, textureStats.contentHits,
+            textureStats.residentBytes, textureStats.bytesSaved));
+    }
 
-    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc {};
-    srvDesc.Format = metadata.format;
-    srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-    srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-    srvDesc.Texture2D.MipLevels = UINT(metadata.mipLevels);
+    // スプライトアトラスのデモ。小さな画像を数枚のページにまとめ、ページごとに1回のDrawで描く
+    SpriteAtlasDemo spriteAtlasDemo(textureManager);
+    spriteAtlasDemo.Initialize(assetArchive, gpuMemory, materialTable);
 
-    D3D12_CPU_DESCRIPTOR_HANDLE textureSrvStartHandleCPU = srvDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
-    D3D12_GPU_DESCRIPTOR_HANDLE textureSrvStartHandleGPU = srvDescriptorHeap->GetGPUDescriptorHandleForHeapStart();
+    // SpriteBatchのデモ。アトラスの画像をたくさん画面中で跳ね回らせ、アトラスのページごとにまとめて描く
+    SpriteBatchDemo spriteBatchDemo(&threadPool);
+    spriteBatchDemo.Initialize(gpuMemory);
 
-    textureSrvStartHandleCPU.ptr += device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-    textureSrvStartHandleGPU.ptr += device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    // OcclusionCullerのデモ。床に並べた小さな箱のうち、大きな壁の陰になるものをCPUで省いて描く
+    OcclusionDemo occlusionDemo(&threadPool);
+    occlusionDemo.Initialize();
 
-    device->CreateShaderResourceView(textureResouce.Get(), &srvDesc, textureSrvStartHandleCPU);
+    // Resources以下のテクスチャ、アトラスの元画像、シェーダー、モデルの変更を監視して作り直す
+    HotReloadDemo hotReloadDemo(threadPool);
+    std::vector<std::string> reloadTextureFiles = textureFiles;
+    reloadTextureFiles.push_back("Resources/uvChecker.png");
+    hotReloadDemo.RegisterTextures(reloadTextureFiles, textureManager);
+    hotReloadDemo.RegisterAtlas(spriteAtlasDemo);
+
+    {
+        StartupTimeline::Scope scope(&startupTimeline, "Pipeline state");
+        bool pipelineStatesCreated = createPipelineStates(graphicsPipelineStateDesc, pixelShaderBlobs, graphicsPipelineStates);
+        assert(pipelineStatesCreated);
+        spritePipelineState = pipelineCache.GetOrCreate(spritePipelineStateDesc);
+        assert(spritePipelineState != nullptr);
+        const PipelineCacheStats pipelineStats = pipelineCache.GetStats();
+        Log(std::format("PipelineCache: {} from library, {} created, {:.1f} ms creating\n", pipelineStats.libraryHits, pipelineStats.created,
+            pipelineStats.createMilliseconds));
+    }
+
+    // シェーダーを作り直したらパイプラインを作り直す
+    hotReloadDemo.RegisterShaders(
+        shaderCache, vertexShaderPath,
+        [&](const ComPtr<IDxcBlob>& blob) {
+            D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = graphicsPipelineStateDesc;
+            desc.VS = { blob->GetBufferPointer(), blob->GetBufferSize() };
+            // 古いPSOはPipelineCacheが持っているので、GPUが使っている途中でもここで手放せる
+            if (!createPipelineStates(desc, pixelShaderBlobs, graphicsPipelineStates)) {
+                return false;
+            }
+            graphicsPipelineStateDesc = desc;
+            vertexShaderBlob = blob;
+            return true;
+        },
+        pixelShaderPath,
+        [&](const ShaderPermutation& permutation, const std::vector<ComPtr<IDxcBlob>>& blobs) {
+            if (!createPipelineStates(graphicsPipelineStateDesc, blobs, graphicsPipelineStates)) {
+                return false;
+            }
+            pixelShaderBlobs = blobs;
+            pixelPermutation = permutation;
+            return true;
+        });
+    hotReloadDemo.RegisterModel("Resources/monkey/monkey.obj", meshManager);
+    hotReloadDemo.Start("Resources", std::string(lpCmdLine).find("-poll") != std::string::npos);
 
     static int kyu = 0;
     static int sphereTextureIndex = 0;
+    static int sphereMeshIndex = MeshType_Sphere;
 
-    directionalLightData->color = { 1.0f, 1.0f, 1.0f, 1.0f };
-    directionalLightData->direction = { 0.0f, -1.0f, 0.0f };
-    directionalLightData->intensity = 1.0f;
+    // 球のアニメーション(上下に揺れながら1周回る)
+    TransformAnimation sphereAnimation;
+    {
+        TransformTrack track;
+        // 回転は最短の向きに補間するので、1周は4分の1周ずつに分けて書く
+        track.rotate = {
+            { 0.0f, { 0.0f, 0.0f, 0.0f } },
+            { 1.0f, { 0.0f, 0.5f * pi_v<float>, 0.0f } },
+            { 2.0f, { 0.0f, pi_v<float>, 0.0f } },
+            { 3.0f, { 0.0f, 1.5f * pi_v<float>, 0.0f } },
+            { 4.0f, { 0.0f, 2.0f * pi_v<float>, 0.0f } },
+        };
+        track.translate = {
+            { 0.0f, { 0.0f, 0.0f, 0.0f } },
+            { 1.0f, { 0.0f, 0.5f, 0.0f } },
+            { 2.0f, { 0.0f, 0.0f, 0.0f } },
+            { 3.0f, { 0.0f, -0.5f, 0.0f } },
+            { 4.0f, { 0.0f, 0.0f, 0.0f } },
+        };
+        sphereAnimation.Build({ track });
+    }
+    bool playAnimation = false;
+    float animationTime = 0.0f;
 
-    materialDataSprite->color = { 1.0f, 1.0f, 1.0f };
-    materialDataSprite->enableLighting = true;
+    directionalLight.color = { 1.0f, 1.0f, 1.0f, 1.0f };
+    directionalLight.direction = { 0.0f, -1.0f, 0.0f };
+    directionalLight.intensity = 1.0f;
 
     // ポインタ
     Input* input = nullptr;
@@ -1021,6 +1024,9 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
     // メインループ
     // --------------------------------------------------
 
+    bool startupReported = false;
+    StartupTimeline::Clock::time_point frameBegin = StartupTimeline::Clock::now();
+
     // ウィンドウの×ボタンが押されるまでループ
     while (true) {
 
@@ -1030,6 +1036,38 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
             break;
         } else {
 
+            // kFramesInFlightフレーム前のGPU処理が終わっていなければ待ち、このフレームのアロケータでコマンドリストを開く
+            const uint32_t frameIndex = frameContexts.BeginFrame(commandList.Get());
+            commandListSet.BeginFrame(frameIndex, commandList.Get());
+            parallelRecorder.SetMinItemsPerChunk(forceParallelRecording ? 1 : kMinDrawsPerCommandList);
+            parallelRecorder.BeginFrame();
+
+            // 前フレームで見積もったミップに合わせてテクスチャの作り直しを依頼し、コピーが終わったものから差し替える
+            textureManager.UpdateStreaming();
+            textureManager.UpdateUploads();
+
+            // 変更されたアセットのうち、作り直しが終わったものを差し替える
+            hotReloadDemo.Update();
+
+            // 詰め直したアトラスのページと頂点を反映する
+            spriteAtlasDemo.Update(frameContexts);
+
+            // 読み込み済みのメッシュを差し替える。古い頂点バッファはそれを使ったフレームが終わるまで残す
+            if (meshManager.Update() > 0) {
+                for (int i = 0; i < MeshType_Count; ++i) {
+                    if (meshBuffers[i].version != meshManager.meshes[i].version) {
+                        frameContexts.DeferRelease([&gpuMemory, oldMemory = meshBuffers[i].memory]() mutable { gpuMemory.Free(oldMemory); });
+                        UploadMeshBuffer(gpuMemory, meshManager.meshes[i], meshBuffers[i]);
+                    }
+                }
+                MeshStreamerStats streamStats = meshStreamer.GetStats();
+                uint32_t finished = streamStats.completed + streamStats.failed;
+                Log(std::format("MeshStreamer: completed {} / failed {}, avg latency {:.2f}ms, max latency {:.2f}ms, decode {:.2f}ms, {} bytes\n",
+                    streamStats.completed, streamStats.failed,
+                    finished > 0 ? streamStats.totalLatencyMilliseconds / finished : 0.0,
+                    streamStats.maxLatencyMilliseconds, streamStats.totalDecodeMilliseconds, streamStats.decodedBytes));
+            }
+
             ImGui_ImplDX12_NewFrame();
             ImGui_ImplWin32_NewFrame();
             ImGui::NewFrame();
@@ -1037,30 +1075,6 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
             // ゲームの処理
             UINT backBufferIndex = swapChain->GetCurrentBackBufferIndex(); // バックバッファのインデックス
 
-            // 描画先のRTVを取得する
-            commandList->OMSetRenderTargets(1, &rtvHandles[backBufferIndex], false, nullptr);
-
-            // TransitionBarrierの設定
-            D3D12_RESOURCE_BARRIER barrier {};
-
-            // 今回のバリアはTransition
-            barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-
-            // Noneにする
-            barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-
-            // バリアを張る対象のリソース。現在のバックバッファに対して行う
-            barrier.Transition.pResource = swapChainResoures[backBufferIndex].Get();
-
-            // 漂移前のResourceState
-            barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_PRESENT;
-
-            // 漂移後のResourceState
-            barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_RENDER_TARGET;
-
-            // TransitionBarrierを張る
-            commandList->ResourceBarrier(1, &barrier);
-
             // 入力の更新
             input->Update();
 
@@ -1110,6 +1124,7 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
 
             static int sphereShadingType = 0; // 0: Lambert, 1: HalfLambert
             static bool sphereEnableLighting = false;
+            static bool sphereAlphaTest = false;
 
             ImGui::ShowDemoWindow();
 
@@ -1161,14 +1176,32 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
             if (ImGui::IsItemHovered())
                 ImGui::SetTooltip("Change the scale of the sphere (multipliers for X, Y, Z axes)");
 
-            ImGui::ColorEdit3("Sphere Color", &materialDataSprite->color.x);
+            ImGui::ColorEdit3("Sphere Color", &sphereMaterial.color.x);
             if (ImGui::IsItemHovered())
                 ImGui::SetTooltip("Change the sphere's color (RGB)");
 
+            {
+                const MaterialTableStats& materialStats = materialTable.GetStats();
+                ImGui::Text("Materials: %u / %u, %u uploaded in %u copies", materialStats.materialCount, materialStats.capacity,
+                    materialStats.uploadedMaterials, materialStats.copyCommands);
+                if (ImGui::IsItemHovered())
+                    ImGui::SetTooltip("All materials live in one structured buffer; only entries changed last frame are copied (%llu bytes so far)",
+                        static_cast<unsigned long long>(materialStats.totalUploadedBytes));
+            }
+
+            ImGui::Combo("Sphere Mesh", &sphereMeshIndex, "Sphere\0Cube\0Plane\0Model\0");
+            if (ImGui::IsItemHovered())
+                ImGui::SetTooltip("Select the mesh to draw (Model is streamed in asynchronously)");
+            meshManager.SetCurrentMeshType(MeshType(sphereMeshIndex));
+
             ImGui::Combo("Sphere Texture", &sphereTextureIndex, "texture1\0texture2\0");
             if (ImGui::IsItemHovered())
                 ImGui::SetTooltip("Select the texture image for the sphere");
 
+            ImGui::Checkbox("Play Animation", &playAnimation);
+            if (ImGui::IsItemHovered())
+                ImGui::SetTooltip("Drive the sphere transform from its keyframe animation");
+
             ImGui::Checkbox("Enable Lighting", &sphereEnableLighting);
             if (ImGui::IsItemHovered())
                 ImGui::SetTooltip("Enable or disable lighting effects on the sphere");
@@ -1178,6 +1211,210 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
             if (ImGui::IsItemHovered())
                 ImGui::SetTooltip("Select the shading method for the sphere");
 
+            ImGui::Checkbox("Sphere Alpha Test", &sphereAlphaTest);
+            if (ImGui::IsItemHovered())
+                ImGui::SetTooltip("Discard pixels whose texture alpha is 0.5 or less");
+
+            ImGui::Spacing();
+            ImGui::Separator();
+            ImGui::Spacing();
+
+            // --- Skinning ---
+            skinnedTubeDemo.DrawGui();
+
+            ImGui::Spacing();
+            ImGui::Separator();
+            ImGui::Spacing();
+
+            // --- Occlusion Culling ---
+            occlusionDemo.DrawGui();
+
+            ImGui::Spacing();
+            ImGui::Separator();
+            ImGui::Spacing();
+
+            // --- Sprite Batch ---
+            spriteBatchDemo.DrawGui();
+
+            ImGui::Spacing();
+            ImGui::Separator();
+            ImGui::Spacing();
+
+            // --- Sprite Atlas ---
+            spriteAtlasDemo.DrawGui();
+
+            ImGui::Spacing();
+            ImGui::Separator();
+            ImGui::Spacing();
+
+            // --- Frames ---
+            ImGui::Text("Frames");
+            ImGui::Separator();
+            {
+                const FramePacerStats& frameStats = frameContexts.GetStats();
+                ImGui::Text("%u frames, %u in flight, waited %llu times (last %.2f ms)", frameContexts.GetFrameCount(), frameStats.framesInFlight,
+                    frameStats.waits, frameStats.lastWaitMilliseconds);
+                if (ImGui::IsItemHovered())
+                    ImGui::SetTooltip("The CPU only waits for the GPU when it is %u frames ahead; %llu full waits for in-place resource swaps",
+                        frameContexts.GetFrameCount(), frameStats.idleWaits);
+                const FrameUploadStats uploadStats = frameContexts.GetUploadStats();
+                ImGui::Text("Upload ring: %.1f KB last frame (%u allocations), %.1f / %.1f KB in use, peak %.1f KB", uploadStats.ring.frameBytes / 1024.0,
+                    uploadStats.ring.frameAllocations, uploadStats.ring.usedBytes / 1024.0, uploadStats.ring.capacity / 1024.0,
+                    uploadStats.ring.peakUsedBytes / 1024.0);
+                if (ImGui::IsItemHovered())
+                    ImGui::SetTooltip("Constants, materials and skinned vertices are suballocated from one mapped buffer and reclaimed by fence value\n"
+                                      "%.1f KB lost to alignment and wrap-around, %u deferred releases",
+                        uploadStats.ring.paddingBytes / 1024.0, frameStats.pendingReleases);
+                ImGui::Text("Upload overflow: %llu waits, %llu fallback buffers (%.1f KB)", uploadStats.overflowWaits, uploadStats.overflowBuffers,
+                    uploadStats.overflowBytes / 1024.0);
+                if (ImGui::IsItemHovered())
+                    ImGui::SetTooltip("When the ring is full the CPU waits for the oldest frame; a frame that alone does not fit gets a temporary buffer");
+                const DescriptorAllocatorStats descriptorStats = descriptors.GetStats();
+                ImGui::Text("Descriptors: %u copied, %u reused last frame, %u / %u in frame ring, %u / %u staged", descriptorStats.copiedDescriptors,
+                    descriptorStats.reusedDescriptors, uint32_t(descriptorStats.frame.usedBytes), uint32_t(descriptorStats.frame.capacity),
+                    descriptorStats.staging.usedCount, descriptorStats.staging.capacity);
+                if (ImGui::IsItemHovered())
+                    ImGui::SetTooltip("SRVs live in a CPU-only staging heap and are copied into a shader-visible ring with one CopyDescriptors per frame\n"
+                                      "%u / %u persistent descriptors, %llu copy calls, %llu overflow waits",
+                        descriptorStats.persistent.usedCount, descriptorStats.persistent.capacity, descriptorStats.copyCalls, descriptorStats.overflowWaits);
+                const TextureUploaderStats textureUploadStats = textureUploader.GetStats();
+                ImGui::Text("Texture uploads: %u queued (%.1f KB), %u batches in flight, %u submitted last frame, %llu completed",
+                    textureUploadStats.scheduler.queuedTickets, textureUploadStats.scheduler.queuedBytes / 1024.0, textureUploadStats.scheduler.batchesInFlight,
+                    textureUploadStats.scheduler.lastBatches, textureUploadStats.scheduler.completedTickets);
+                if (ImGui::IsItemHovered())
+                    ImGui::SetTooltip("Mips are copied into DEFAULT-heap textures on a copy queue, up to %.0f MB per submission, and swapped in when its fence completes\n"
+                                      "%llu batches, %llu subresources (%.1f MB), staging %.1f / %.1f MB, %llu oversized subresources, %u command allocators",
+                        kTextureUploadBatchBytes / (1024.0 * 1024.0), textureUploadStats.scheduler.submittedBatches, textureUploadStats.scheduler.submittedCopies,
+                        textureUploadStats.scheduler.submittedBytes / (1024.0 * 1024.0), textureUploadStats.scheduler.staging.usedBytes / (1024.0 * 1024.0),
+                        textureUploadStats.scheduler.staging.capacity / (1024.0 * 1024.0), textureUploadStats.dedicatedBuffers, textureUploadStats.commandAllocators);
+            }
+
+            ImGui::Spacing();
+            ImGui::Separator();
+            ImGui::Spacing();
+
+            // --- GPU Memory ---
+            ImGui::Text("GPU Memory");
+            ImGui::Separator();
+            {
+                const GpuMemoryStats memoryStats = gpuMemory.GetStats();
+                ImGui::Text("%u placed resources in %u heaps, %.1f / %.1f MB used", memoryStats.placedResources, memoryStats.heapCount,
+                    memoryStats.usedBytes / (1024.0 * 1024.0), memoryStats.heapBytes / (1024.0 * 1024.0));
+                if (ImGui::IsItemHovered())
+                    ImGui::SetTooltip("Buffers and textures are placed into %.0f MB heaps with a TLSF allocator instead of one committed resource each\n"
+                                      "%u small textures use 4 KB alignment, %u committed resources (%.1f MB) did not fit a heap",
+                        kGpuHeapBytes / (1024.0 * 1024.0), memoryStats.smallTextures, memoryStats.committedResources, memoryStats.committedBytes / (1024.0 * 1024.0));
+                for (const GpuMemoryPoolStats& pool : memoryStats.pools) {
+                    ImGui::Text("  %s: %u resources, %.1f%% occupied, %.1f%% fragmented, %u free blocks", pool.name.c_str(), pool.heaps.allocationCount,
+                        pool.heaps.occupancy * 100.0f, pool.heaps.fragmentation * 100.0f, pool.heaps.freeBlockCount);
+                    if (ImGui::IsItemHovered())
+                        ImGui::SetTooltip("%u heaps, largest free block %.1f KB\nFragmentation is 1 - largest free block / free bytes of the worst heap",
+                            pool.heapCount, pool.heaps.largestFreeBlock / 1024.0);
+                }
+                // メッシュの頂点バッファをヒープの前の空きへ詰める。古いものはそのフレームが終わってから返す
+                if (ImGui::Button("Defragment Meshes")) {
+                    gpuMemory.Defragment(MeshType_Count, [&](const GpuAllocation& from, GpuAllocation& to) {
+                        for (MeshBuffer& meshBuffer : meshBuffers) {
+                            if (meshBuffer.memory.resource.Get() != from.resource.Get()) {
+                                continue;
+                            }
+                            void* source = nullptr;
+                            void* destination = nullptr;
+                            from.resource->Map(0, nullptr, &source);
+                            to.resource->Map(0, nullptr, &destination);
+                            std::memcpy(destination, source, meshBuffer.view.SizeInBytes);
+                            to.resource->Unmap(0, nullptr);
+                            from.resource->Unmap(0, nullptr);
+                            frameContexts.DeferRelease([&gpuMemory, oldMemory = meshBuffer.memory]() mutable { gpuMemory.Free(oldMemory); });
+                            meshBuffer.memory = std::move(to);
+                            meshBuffer.view.BufferLocation = meshBuffer.memory.resource->GetGPUVirtualAddress();
+                            return true;
+                        }
+                        return false;
+                    });
+                }
+                ImGui::SameLine();
+                ImGui::Text("%u moves", memoryStats.defragmentMoves);
+            }
+
+            ImGui::Spacing();
+            ImGui::Separator();
+            ImGui::Spacing();
+
+            // --- Render Graph ---
+            sceneRenderGraph.DrawGui();
+
+            ImGui::Spacing();
+            ImGui::Separator();
+            ImGui::Spacing();
+
+            // --- Render Queue ---
+            ImGui::Text("Render Queue");
+            ImGui::Separator();
+            {
+                const RenderQueueStats& queueStats = renderQueue.GetStats();
+                ImGui::Text("%u draws, sort %.3f ms (%u passes)", queueStats.drawCount, queueStats.sortMilliseconds, queueStats.sortPasses);
+                if (ImGui::IsItemHovered())
+                    ImGui::SetTooltip("Draws are sorted by a 64-bit key (layer, pipeline, material, texture, mesh, depth) with a radix sort");
+                const ParallelRecorderStats& recordStats = parallelRecorder.GetStats();
+                ImGui::Text("Recording: %u command lists (%u on workers), %.3f ms, longest list %.3f ms", recordStats.commandLists,
+                    recordStats.parallelLists, recordStats.recordMilliseconds, recordStats.longestListMilliseconds);
+                if (ImGui::IsItemHovered())
+                    ImGui::SetTooltip("Sorted draws are split into chunks of at least %u, each recorded on a worker into its own command list\n"
+                                      "and submitted in order with one ExecuteCommandLists; %u lists created",
+                        forceParallelRecording ? 1u : kMinDrawsPerCommandList, commandListSet.GetCreatedListCount());
+                ImGui::Checkbox("Split even small draw lists", &forceParallelRecording);
+                ImGui::Text("%u pixel shader variants, sphere uses %s", pixelPermutation.GetVariantCount(),
+                    pixelPermutation.GetVariantName(pixelPermutation.GetVariants()[selectPixelVariant(materialTable.Get(sphereMaterialId))]).c_str());
+                if (ImGui::IsItemHovered())
+                    ImGui::SetTooltip("Lighting, shading and alpha test are compiled into separate pipelines and picked per draw from the material");
+                const ShaderCacheStats cacheStats = shaderCache.GetStats();
+                ImGui::Text("Shader cache: %u cached, %u compiled, %u failed (last %.1f ms)", cacheStats.hits, cacheStats.compiled, cacheStats.failed,
+                    cacheStats.lastMilliseconds);
+                if (ImGui::IsItemHovered())
+                    ImGui::SetTooltip("DXIL is stored under %s, keyed by a hash of the source, includes, profile, defines and arguments",
+                        shaderCache.GetCacheDirectory().c_str());
+                const PipelineCacheStats pipelineStats = pipelineCache.GetStats();
+                ImGui::Text("PSO cache: %u requests, %u reused, %u from library, %u created", pipelineStats.requests, pipelineStats.deduplicated,
+                    pipelineStats.libraryHits, pipelineStats.created);
+                if (ImGui::IsItemHovered())
+                    ImGui::SetTooltip("Pipelines are keyed by a hash of the whole description; %s", pipelineCache.HasLibrary() ? "new ones are stored in the pipeline library on exit" : "pipeline libraries are not supported on this device");
+                ImGui::Text("State changes: %u sorted / %u unsorted", queueStats.GetStateChanges(), queueStats.unsortedStateChanges);
+                if (ImGui::IsItemHovered())
+                    ImGui::SetTooltip("pipeline %u, material %u, vertex buffer %u, transform %u, texture %u", queueStats.pipelineChanges,
+                        queueStats.materialChanges, queueStats.vertexBufferChanges, queueStats.transformChanges, queueStats.textureChanges);
+            }
+
+            ImGui::Spacing();
+            ImGui::Separator();
+            ImGui::Spacing();
+
+            // --- Texture Streaming ---
+            ImGui::Text("Texture Streaming");
+            ImGui::Separator();
+            if (ImGui::SliderInt("Texture Budget (MB)", &textureBudgetMegabytes, 1, 64)) {
+                textureManager.SetStreamingBudget(uint64_t(textureBudgetMegabytes) << 20);
+            }
+            if (ImGui::IsItemHovered())
+                ImGui::SetTooltip("GPU memory budget for streamed texture mips");
+
+            const TextureResidencyStats& streamingStats = textureManager.GetStreamingStats();
+            ImGui::Text("Resident %.2f / %.2f MB, streamed %.2f MB total",
+                double(streamingStats.residentBytes) / (1 << 20), double(streamingStats.budgetBytes) / (1 << 20),
+                double(streamingStats.totalStreamedBytes) / (1 << 20));
+            ImGui::Text("Last update: +%u / -%u mips, %u starved", streamingStats.loadedMips, streamingStats.evictedMips, streamingStats.starvedTextures);
+            for (size_t i = 0; i < textureFiles.size(); ++i) {
+                const Texture& texture = textureManager.GetTexture(textureHandles[i]);
+                ImGui::Text("%s: mip %u resident, mip %u wanted", textureFiles[i].c_str(), texture.residentMip, textureManager.GetRequestedMip(textureHandles[i]));
+            }
+
+            ImGui::Spacing();
+            ImGui::Separator();
+            ImGui::Spacing();
+
+            // --- Hot Reload ---
+            hotReloadDemo.DrawGui();
+
             ImGui::Spacing();
             ImGui::Separator();
             ImGui::Spacing();
@@ -1185,20 +1422,22 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
             // --- Light ---
             ImGui::Text("Light");
             ImGui::Separator();
-            ImGui::DragFloat3("Light Direction", &directionalLightData->direction.x, 0.01f, -1.0f, 1.0f);
+            ImGui::DragFloat3("Light Direction", &directionalLight.direction.x, 0.01f, -1.0f, 1.0f);
             if (ImGui::IsItemHovered())
                 ImGui::SetTooltip("Change the direction of the light (X, Y, Z)");
 
             ImGui::End();
 
-            materialDataSprite->enableLighting = sphereEnableLighting;
-            materialDataSprite->shadingType = sphereShadingType;
+            sphereMaterial.enableLighting = sphereEnableLighting;
+            sphereMaterial.shadingType = sphereShadingType;
+            sphereMaterial.alphaTest = sphereAlphaTest;
+            materialTable.Set(sphereMaterialId, sphereMaterial);
 
             // 光源方向の正規化
             {
-                float& x = directionalLightData->direction.x;
-                float& y = directionalLightData->direction.y;
-                float& z = directionalLightData->direction.z;
+                float& x = directionalLight.direction.x;
+                float& y = directionalLight.direction.y;
+                float& z = directionalLight.direction.z;
                 float len = sqrtf(x * x + y * y + z * z);
                 if (len > 0.0001f) {
                     x /= len;
@@ -1209,24 +1448,14 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
 
             ImGui::Render();
 
-            // 指定した色で画面全体をクリアする
-            float clearColor[] = { 0.1f, 0.25f, 0.5f, 1.0f }; // 青っぽい色、RGBAの順
-
-            commandList->ClearRenderTargetView(
-                rtvHandles[backBufferIndex], // 描画先のRTV
-                clearColor, // クリアする色
-                0, // フラグ
-                nullptr // 深度ステンシルビューのハンドル
-            );
-
-            ID3D12DescriptorHeap* descriptorHeaps[] = { srvDescriptorHeap.Get() };
+            ID3D12DescriptorHeap* descriptorHeaps[] = { descriptors.GetShaderVisibleHeap() };
             commandList->SetDescriptorHeaps(1, descriptorHeaps);
 
-            // 今回はRenderTargetからPresentにする
-            barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
-            barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PRESENT;
-
-            transform.rotate.y += 0.00f;
+            // 再生中はサンプリング結果でTransformを上書きする
+            if (playAnimation) {
+                animationTime += 1.0f / 60.0f;
+                sphereAnimation.Sample(animationTime, &transform);
+            }
 
             // カメラの位置をz=-10.0fに設定
             Transform cameraTransform {
@@ -1251,14 +1480,22 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
             Matrix4x4 cameraMatrix = MakeAffineMatrix(cameraTransform.scale, cameraTransform.rotate, cameraTransform.translate);
             Matrix4x4 viewMatrix = Inverse(cameraMatrix);
             Matrix4x4 projectionMatrix = MakePerspectiveFovMatrix(0.45f, float(WinApp::kClientWidth) / float(WinApp::kClientHeight), 0.1f, 100.0f);
-            Matrix4x4 worldViewProjectionMatrix = Multiply(worldMatrix, Multiply(viewMatrix, projectionMatrix));
+            const Matrix4x4 viewProjectionMatrix = Multiply(viewMatrix, projectionMatrix);
+            Matrix4x4 worldViewProjectionMatrix = Multiply(worldMatrix, viewProjectionMatrix);
+            // 毎フレーム書き換えるものはアップロードリングから切り出して書く(GPUが読んでいる前のフレームの分は壊さない)
+            D3D12_GPU_VIRTUAL_ADDRESS sphereTransformAddress = 0;
+            TransformationMatrix* wvpData = frameContexts.AllocateUpload<TransformationMatrix>(sphereTransformAddress);
             wvpData->WVP = worldViewProjectionMatrix;
             wvpData->World = worldMatrix;
 
+            // スキニングの結果もアップロードリングへ直接書き込む
+            skinnedTubeDemo.Update(frameContexts, viewProjectionMatrix, 1.0f / 60.0f);
+
             Matrix4x4 uvTransformMatrix = MakeScaleMatrix(uvTransformSprite.scale);
             uvTransformMatrix = Multiply(uvTransformMatrix, MakeRotateZMatrix(uvTransformSprite.rotate.z));
             uvTransformMatrix = Multiply(uvTransformMatrix, MakeTranslateMatrix(uvTransformSprite.translate));
-            materialData->uvTransform = uvTransformMatrix;
+            spriteMaterial.uvTransform = uvTransformMatrix;
+            materialTable.Set(spriteMaterialId, spriteMaterial);
 
             Matrix4x4 worldMatrixSprite = MakeAffineMatrix(transformSprite.scale, transformSprite.rotate, transformSprite.translate);
             Matrix4x4 viewMatrixSprite = MakeIdentity4x4();
@@ -1269,73 +1506,162 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
                 0.0f, 100.0f);
 
             Matrix4x4 worldViewProjectionMatrixSprite = Multiply(worldMatrixSprite, Multiply(viewMatrixSprite, projectionMatrixSprite));
-            *transformationMatrixDataSprite = worldViewProjectionMatrixSprite;
-
-            D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle = dsvDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
-            commandList->OMSetRenderTargets(1, &rtvHandles[backBufferIndex], false, &dsvHandle);
-            commandList->ClearDepthStencilView(
-                dsvHandle,
-                D3D12_CLEAR_FLAG_DEPTH,
-                1.0f,
-                0,
-                0,
-                nullptr);
-
-            // TransitionBarrierを張る
-            commandList->SetGraphicsRootSignature(rootSignature.Get());
-            commandList->SetPipelineState(graphicsPipelineState.Get());
-            commandList->IASetVertexBuffers(0, 1, &vertexBufferView);
-            commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-            commandList->SetGraphicsRootConstantBufferView(0, materialResourceSprite->GetGPUVirtualAddress());
-            commandList->SetGraphicsRootConstantBufferView(1, wvpResource->GetGPUVirtualAddress());
-            commandList->SetGraphicsRootDescriptorTable(2, textureSrvHandlesGPU[sphereTextureIndex]);
-            commandList->SetGraphicsRootConstantBufferView(3, directionalLightResource->GetGPUVirtualAddress());
-            commandList->RSSetViewports(1, &viewport);
-            commandList->RSSetScissorRects(1, &scissorRect);
-            commandList->DrawInstanced(kSphereVertexCount, 1, 0, 0);
-
-            // スプライト描画
-            commandList->IASetVertexBuffers(0, 1, &vertexBufferViewSprite);
-            commandList->SetGraphicsRootConstantBufferView(0, materialResource->GetGPUVirtualAddress());
-            commandList->SetGraphicsRootConstantBufferView(1, transformationMatrixResourceSprite->GetGPUVirtualAddress());
-            commandList->SetGraphicsRootDescriptorTable(2, textureSrvHandlesGPU[0]);
-            commandList->DrawInstanced(6, 1, 0, 0);
-
-            ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), commandList.Get());
-
-            hr = commandList->Close();
-
-            // コマンドリストの生成に失敗したので起動できない
-            assert(SUCCEEDED(hr));
-
-            // GPUのコマンドリスト実行を行わせる
-            ID3D12CommandList* commandLists[] = { commandList.Get() };
-
-            commandQueue->ExecuteCommandLists(1, commandLists);
+            D3D12_GPU_VIRTUAL_ADDRESS spriteTransformAddress = 0;
+            *frameContexts.AllocateUpload<Matrix4x4>(spriteTransformAddress) = worldViewProjectionMatrixSprite;
+
+            // カメラからの距離(ミップの見積もりと描画の並べ替えに使う)
+            auto distanceFromCamera = [&](const Vector3& position) {
+                Vector3 toPosition = {
+                    position.x - cameraTransform.translate.x,
+                    position.y - cameraTransform.translate.y,
+                    position.z - cameraTransform.translate.z,
+                };
+                return std::sqrt(toPosition.x * toPosition.x + toPosition.y * toPosition.y + toPosition.z * toPosition.z);
+            };
+            float sphereDistance = distanceFromCamera(transform.translate);
 
-            // GPUとOSに画面の交換を行うように通知する
-            swapChain->Present(1, 0);
+            // 画面上の大きさとUVの密度から、各テクスチャに必要なミップを見積もる
+            {
+                // 球: 見えている直径にVは1周分、Uは半周分が乗る
+                const Texture& sphereTexture = textureManager.GetTexture(textureHandles[sphereTextureIndex]);
+                float sphereRadius = std::max({ transform.scale.x, transform.scale.y, transform.scale.z });
+                float spherePixels = TextureResidency::ProjectSphereToPixels(sphereRadius, sphereDistance, 0.45f, float(WinApp::kClientHeight)) * 2.0f;
+                float sphereTexels = std::max(float(sphereTexture.metadata.width) * 0.5f, float(sphereTexture.metadata.height));
+                textureManager.RequestMip(textureHandles[sphereTextureIndex],
+                    TextureResidency::EstimateMip(sphereTexels, spherePixels, uint32_t(sphereTexture.metadata.mipLevels)));
+
+                // スプライト: 640x360の板にuvTransformの拡大率分だけ繰り返して貼る
+                const Texture& spriteTextureData = textureManager.GetTexture(spriteTexture);
+                uint32_t spriteMipLevels = uint32_t(spriteTextureData.metadata.mipLevels);
+                uint32_t spriteMipX = TextureResidency::EstimateMip(float(spriteTextureData.metadata.width) * std::abs(uvTransformSprite.scale.x),
+                    640.0f * std::abs(transformSprite.scale.x), spriteMipLevels);
+                uint32_t spriteMipY = TextureResidency::EstimateMip(float(spriteTextureData.metadata.height) * std::abs(uvTransformSprite.scale.y),
+                    360.0f * std::abs(transformSprite.scale.y), spriteMipLevels);
+                textureManager.RequestMip(spriteTexture, std::min(spriteMipX, spriteMipY));
+            }
+
+            // 壁を低解像度の深度に描いてHiZを作り、箱ごとに見えるかを調べる
+            occlusionDemo.Update(meshManager.meshes[MeshType_Cube], viewProjectionMatrix);
+
+            // 描画を積んでキーで並べ替え、変わった状態だけを設定しながら発行する
+            // メッシュの番号はMeshTypeの後ろにスキニングした円柱、スプライト、アトラスを並べる
+            renderQueue.Clear();
+            {
+                const MeshBuffer& currentMeshBuffer = meshBuffers[meshManager.GetCurrentMeshType()];
+                DrawItem sphereItem;
+                sphereItem.depth = sphereDistance;
+                sphereItem.pipelineId = selectPixelVariant(materialTable.Get(sphereMaterialId));
+                sphereItem.pipelineState = graphicsPipelineStates[sphereItem.pipelineId].Get();
+                sphereItem.materialId = sphereMaterialId;
+                sphereItem.vertexBufferView = currentMeshBuffer.view;
+                sphereItem.meshId = meshManager.GetCurrentMeshType();
+                sphereItem.transform = sphereTransformAddress;
+                sphereItem.texture = descriptors.StageFrameDescriptor(textureManager.GetSrvHandleCPU(textureHandles[sphereTextureIndex]));
+                sphereItem.textureId = textureHandles[sphereTextureIndex];
+                sphereItem.vertexCount = currentMeshBuffer.vertexCount;
+                renderQueue.Submit(sphereItem);
+
+                // スキニングした円柱は球と同じマテリアルとテクスチャで描く
+                skinnedTubeDemo.Record(renderQueue, sphereItem, cameraTransform.translate);
+
+                // 壁と見える箱は立方体のメッシュを球と同じマテリアルとテクスチャで描く
+                const MeshBuffer& cubeMeshBuffer = meshBuffers[MeshType_Cube];
+                DrawItem cubeItem = sphereItem;
+                cubeItem.vertexBufferView = cubeMeshBuffer.view;
+                cubeItem.meshId = MeshType_Cube;
+                cubeItem.vertexCount = cubeMeshBuffer.vertexCount;
+                occlusionDemo.Record(renderQueue, frameContexts, cubeItem, cameraTransform.translate);
+
+                // スプライトとアトラスは積んだ順に重ねる
+                DrawItem spriteItem;
+                spriteItem.layer = RenderLayer::Overlay;
+                spriteItem.pipelineId = selectPixelVariant(materialTable.Get(spriteMaterialId));
+                spriteItem.pipelineState = graphicsPipelineStates[spriteItem.pipelineId].Get();
+                spriteItem.materialId = spriteMaterialId;
+                spriteItem.vertexBufferView = vertexBufferViewSprite;
+                spriteItem.meshId = MeshType_Count + 1;
+                spriteItem.transform = spriteTransformAddress;
+                spriteItem.texture = descriptors.StageFrameDescriptor(textureManager.GetSrvHandleCPU(spriteTexture));
+                spriteItem.textureId = spriteTexture;
+                spriteItem.vertexCount = 6;
+                renderQueue.Submit(spriteItem);
+
+                // アトラスのスプライトはページごとにまとめて描く
+                DrawItem atlasItem = spriteItem;
+                atlasItem.materialId = spriteAtlasDemo.GetMaterialId();
+                atlasItem.pipelineId = selectPixelVariant(materialTable.Get(atlasItem.materialId));
+                atlasItem.pipelineState = graphicsPipelineStates[atlasItem.pipelineId].Get();
+                spriteAtlasDemo.Record(renderQueue, atlasItem, descriptors);
+            }
+            renderQueue.Sort();
+
+            // SpriteBatchは毎フレーム積み直し、並べ替えて作った板をシーンの後のパスでまとめて描く
+            spriteBatchDemo.Update(frameContexts, spriteAtlasDemo, 1.0f / 60.0f);
+
+            // このフレームの描画をパスの並びにして、バリアと深度バッファの置き場所をまとめて決める
+            sceneRenderGraph.Begin(swapChainResoures[backBufferIndex].Get(), rtvHandles[backBufferIndex]);
+
+            sceneRenderGraph.AddScenePass([&](ID3D12GraphicsCommandList*) {
+                // 区切ったリストはそれぞれ何も設定されていない状態から始まるので、共通のものをリストごとに設定する
+                D3D12_GPU_VIRTUAL_ADDRESS lightAddress = 0;
+                *frameContexts.AllocateUpload<DirectionalLight>(lightAddress) = directionalLight;
+                parallelRecorder.RecordParallel(renderQueue.GetDrawCount(), [&](uint32_t listIndex, uint32_t begin, uint32_t end) {
+                    ID3D12GraphicsCommandList* chunkList = commandListSet.GetCommandList(listIndex);
+                    chunkList->OMSetRenderTargets(1, &sceneRenderGraph.GetRenderTargetView(), false, &sceneRenderGraph.GetDepthStencilView());
+                    chunkList->SetGraphicsRootSignature(rootSignature.Get());
+                    chunkList->SetGraphicsRootShaderResourceView(4, materialTable.GetGpuAddress());
+                    chunkList->SetGraphicsRootConstantBufferView(3, lightAddress);
+                    chunkList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+                    chunkList->RSSetViewports(1, &viewport);
+                    chunkList->RSSetScissorRects(1, &scissorRect);
+                    renderQueue.Execute(chunkList, begin, end);
+                });
+            });
+
+            // SpriteBatchも深度を使わずにシーンの上へ重ねる
+            spriteBatchDemo.Record(
+                sceneRenderGraph,
+                [&](ID3D12GraphicsCommandList* list) {
+                    list->SetGraphicsRootSignature(rootSignature.Get());
+                    list->SetPipelineState(spritePipelineState.Get());
+                    list->SetGraphicsRootConstantBufferView(1, spriteAtlasDemo.GetScreenTransformAddress());
+                    list->RSSetViewports(1, &viewport);
+                    list->RSSetScissorRects(1, &scissorRect);
+                },
+                2, [&](uint32_t texture) { return descriptors.StageFrameDescriptor(textureManager.GetSrvHandleCPU(texture)); });
+
+            // ImGuiは深度を使わずに上から重ねる
+            sceneRenderGraph.AddOverlayPass("ImGui", [&](ID3D12GraphicsCommandList* list) {
+                ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), list);
+            });
+
+            sceneRenderGraph.Compile(frameContexts);
 
-            // Fenceの値を更新
-            fenceValue++;
+            // 変更されたマテリアルだけを表に送る(コピーなのでパスの外で先に積む。読める状態への遷移は最初のパスのバリアとまとめて張る)
+            materialTable.Upload(commandListSet.GetStateTracker(parallelRecorder.GetCurrentList()), frameContexts);
+            sceneRenderGraph.Execute([&]() -> ResourceStateTracker& { return commandListSet.GetStateTracker(parallelRecorder.GetCurrentList()); });
 
-            // GPUがここまでたどり着いたときに、Fenceの値を設定した値に代入するようにSignalを送る
-            commandQueue->Signal(fence.Get(), fenceValue);
+            // このフレームで使うSRVを1回のCopyDescriptorsでまとめて写してから、GPUに渡す
+            descriptors.FlushFrameCopies();
 
-            // Fenceの値が指定したSignal値にたどり着いているか確認する
-            // GetComplatedValueの初期値はFenceに渡した初期値
-            if (fence->GetCompletedValue() < fenceValue) {
-                // 指定したSignalにたどり着いていないので、たどり着くまで待つようにイベントを設定する
-                fence->SetEventOnCompletion(fenceValue, fenceEvent);
-                // イベントを待つ
-                WaitForSingleObject(fenceEvent, INFINITE);
+            // 記録したコマンドリストを順に閉じ、1回のExecuteCommandListsでGPUに渡す
+            parallelRecorder.Submit();
+            for (const std::string& error : resourceStates.TakeErrors()) {
+                Log(std::format("Resource state: {}\n", error));
             }
 
-            // 次のフレーム用のコマンドリストを準備
-            hr = commandAllocator->Reset();
-            assert(SUCCEEDED(hr));
-            hr = commandList->Reset(commandAllocator.Get(), nullptr);
-            assert(SUCCEEDED(hr));
+            // GPUとOSに画面の交換を行うように通知する
+            swapChain->Present(1, 0);
+
+            // 最初のフレームを出したところで起動の内訳を出す
+            if (!startupReported) {
+                startupTimeline.Record("First frame", frameBegin, StartupTimeline::Clock::now());
+                Log(startupTimeline.BuildReport());
+                startupReported = true;
+            }
+
+            // このフレームの終わりに印を付ける。待つのは次に同じ番号のフレームを始めるとき
+            frameContexts.EndFrame();
         }
     }
 
@@ -1379,6 +1705,14 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
     // 終了
     // --------------------------------------------------
 
+    // GPUが読んでいる途中のものを解放しないように、流しているフレームをすべて待つ
+    frameContexts.WaitIdle();
+
+    // 今回作ったPSOを次の起動で読めるように残す
+    if (pipelineCache.Save()) {
+        Log("PipelineCache: library saved\n");
+    }
+
     ImGui_ImplDX12_Shutdown();
     ImGui_ImplWin32_Shutdown();
     ImGui::DestroyContext();
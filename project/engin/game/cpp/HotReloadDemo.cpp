@@ -0,0 +1,136 @@
+#include "HotReloadDemo.h"
+#include "Log.h"
+#include "MeshManager.h"
+#include "ShaderIncludes.h"
+#include "SpriteAtlasDemo.h"
+#include "TextureManager.h"
+#include "imgui.h"
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <unordered_set>
+
+namespace {
+
+// シェーダーが#include "..."で読んでいるファイルのパス(インクルード先のインクルードも含める)
+void AppendShaderIncludes(const std::filesystem::path& filePath, std::unordered_set<std::string>& visited, std::vector<std::string>& includes)
+{
+    std::ifstream file(filePath, std::ios::binary);
+    const std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    for (const std::string& include : FindShaderIncludes(source)) {
+        const std::filesystem::path includePath = (filePath.parent_path() / include).lexically_normal();
+        if (visited.insert(includePath.generic_string()).second) {
+            includes.push_back(includePath.generic_string());
+            AppendShaderIncludes(includePath, visited, includes);
+        }
+    }
+}
+
+} // namespace
+
+void HotReloadDemo::RegisterTextures(const std::vector<std::string>& textureFiles, TextureManager& textureManager)
+{
+    for (const std::string& textureFile : textureFiles) {
+        hotReloader_.Register(textureFile, [this, &textureManager, textureFile]() -> AssetHotReloader::ApplyFunc {
+            auto prepared = std::make_shared<PreparedTexture>();
+            if (!TextureManager::PrepareReload(textureFile, &cooker_, *prepared)) {
+                return nullptr;
+            }
+            return [&textureManager, textureFile, prepared] { return textureManager.ApplyReload(textureFile, std::move(*prepared)); };
+        });
+    }
+}
+
+void HotReloadDemo::RegisterAtlas(SpriteAtlasDemo& spriteAtlasDemo)
+{
+    for (uint32_t source = 0; source < spriteAtlasDemo.GetSourceCount(); ++source) {
+        const std::string target = "atlas:" + spriteAtlasDemo.GetSourcePath(source);
+        hotReloader_.AddDependency(spriteAtlasDemo.GetSourcePath(source), target);
+        hotReloader_.Register(target, [&spriteAtlasDemo, source] { return spriteAtlasDemo.PrepareSourceReload(source); });
+    }
+}
+
+void HotReloadDemo::RegisterShaders(ShaderCache& shaderCache, const std::string& vertexShaderPath, ApplyVertexShader applyVertexShader,
+    const std::string& pixelShaderPath, ApplyPixelShaders applyPixelShaders)
+{
+    for (const std::string& shaderPath : { vertexShaderPath, pixelShaderPath }) {
+        std::unordered_set<std::string> visited;
+        std::vector<std::string> includes;
+        AppendShaderIncludes(shaderPath, visited, includes);
+        for (const std::string& include : includes) {
+            hotReloader_.AddDependency(include, shaderPath);
+        }
+    }
+
+    // ワーカーで呼ばれるので、キャッシュはこのスレッドだけで引く
+    hotReloader_.Register(vertexShaderPath, [&shaderCache, vertexShaderPath, applyVertexShader]() -> AssetHotReloader::ApplyFunc {
+        std::vector<ShaderCompileDesc> descs = { { vertexShaderPath, L"vs_6_0", {} } };
+        std::vector<ShaderCompileResult> results = shaderCache.Compile(descs, nullptr);
+        if (!LogShaderResults(descs, results)) {
+            return nullptr;
+        }
+        Microsoft::WRL::ComPtr<IDxcBlob> blob = results[0].blob;
+        return [applyVertexShader, blob] { return applyVertexShader(blob); };
+    });
+    hotReloader_.Register(pixelShaderPath, [&shaderCache, pixelShaderPath, applyPixelShaders]() -> AssetHotReloader::ApplyFunc {
+        ShaderPermutation permutation;
+        if (!permutation.ParseFile(pixelShaderPath)) {
+            return nullptr;
+        }
+        std::vector<ShaderCompileDesc> descs;
+        for (ShaderPermutation::Key key : permutation.GetVariants()) {
+            descs.push_back({ pixelShaderPath, L"ps_6_0", permutation.GetDefines(key) });
+        }
+        std::vector<ShaderCompileResult> results = shaderCache.Compile(descs, nullptr);
+        if (!LogShaderResults(descs, results)) {
+            return nullptr;
+        }
+        std::vector<Microsoft::WRL::ComPtr<IDxcBlob>> blobs;
+        for (const ShaderCompileResult& result : results) {
+            blobs.push_back(result.blob);
+        }
+        return [applyPixelShaders, permutation, blobs] { return applyPixelShaders(permutation, blobs); };
+    });
+}
+
+void HotReloadDemo::RegisterModel(const std::string& modelPath, MeshManager& meshManager)
+{
+    hotReloader_.Register(modelPath, [&meshManager, modelPath]() -> AssetHotReloader::ApplyFunc {
+        return [&meshManager, modelPath] {
+            meshManager.RequestMesh(modelPath, MeshType_Model, true);
+            return true;
+        };
+    });
+}
+
+void HotReloadDemo::Start(const std::string& directory, bool poll)
+{
+    const bool started = hotReloader_.Start(directory, poll);
+    Log(std::format("AssetHotReloader: {}\n", !started ? "not started" : hotReloader_.IsPolling() ? "polling" : "watching"));
+}
+
+void HotReloadDemo::Update()
+{
+    for (const HotReloadResult& result : hotReloader_.Update()) {
+        Log(std::format("HotReload: {} {}, cook {:.2f}ms, latency {:.2f}ms\n",
+            result.path, result.succeeded ? "reloaded" : "failed", result.cookMilliseconds, result.latencyMilliseconds));
+    }
+}
+
+void HotReloadDemo::DrawGui()
+{
+    ImGui::Text("Hot Reload");
+    ImGui::Separator();
+    const HotReloadStats& reloadStats = hotReloader_.GetStats();
+    ImGui::Text("%s, %u changes, %u reloaded, %u failed, %u cooking", hotReloader_.IsPolling() ? "Polling" : "Watching",
+        reloadStats.changes, reloadStats.reloaded, reloadStats.failed, hotReloader_.GetCookingCount());
+    if (ImGui::IsItemHovered())
+        ImGui::SetTooltip("Edited textures, shaders and the model under Resources are rebuilt in the background and swapped in at the frame start");
+    uint32_t finishedReloads = reloadStats.reloaded + reloadStats.failed;
+    ImGui::Text("Latency: last %.1f ms, avg %.1f ms, max %.1f ms", reloadStats.lastLatencyMilliseconds,
+        finishedReloads > 0 ? reloadStats.totalLatencyMilliseconds / finishedReloads : 0.0, reloadStats.maxLatencyMilliseconds);
+    if (ImGui::IsItemHovered())
+        ImGui::SetTooltip("Time from detecting the file change to swapping the result in");
+}
@@ -0,0 +1,51 @@
+#include "Log.h"
+#include <Windows.h>
+#include <format>
+
+void Log(const std::string& message)
+{
+    OutputDebugStringA(message.c_str());
+}
+
+std::wstring ConvertString(const std::string& str)
+{
+    if (str.empty()) {
+        return std::wstring();
+    }
+    auto sizeNeeded = MultiByteToWideChar(CP_UTF8, 0, reinterpret_cast<const char*>(&str[0]), static_cast<int>(str.size()), NULL, 0);
+    if (sizeNeeded == 0) {
+        return std::wstring();
+    }
+    std::wstring result(sizeNeeded, 0);
+    MultiByteToWideChar(CP_UTF8, 0, reinterpret_cast<const char*>(&str[0]), static_cast<int>(str.size()), &result[0], sizeNeeded);
+    return result;
+}
+
+std::string ConvertString(const std::wstring& str)
+{
+    if (str.empty()) {
+        return std::string();
+    }
+    auto sizeNeeded = WideCharToMultiByte(CP_UTF8, 0, str.data(), static_cast<int>(str.size()), NULL, 0, NULL, NULL);
+    if (sizeNeeded == 0) {
+        return std::string();
+    }
+    std::string result(sizeNeeded, 0);
+    WideCharToMultiByte(CP_UTF8, 0, str.data(), static_cast<int>(str.size()), result.data(), sizeNeeded, NULL, NULL);
+    return result;
+}
+
+bool LogShaderResults(const std::vector<ShaderCompileDesc>& descs, const std::vector<ShaderCompileResult>& results)
+{
+    bool succeeded = true;
+    for (size_t i = 0; i < descs.size(); ++i) {
+        const ShaderCompileResult& result = results[i];
+        Log(std::format("Shader {} {}: {}\n", descs[i].filePath, ConvertString(descs[i].profile),
+            result.blob == nullptr ? "failed" : result.cacheHit ? "cached" : "compiled"));
+        if (!result.messages.empty()) {
+            Log(result.messages);
+        }
+        succeeded = succeeded && result.blob != nullptr;
+    }
+    return succeeded;
+}
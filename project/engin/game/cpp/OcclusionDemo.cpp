@@ -0,0 +1,100 @@
+#include "OcclusionDemo.h"
+#include "FrameContext.h"
+#include "MeshManager.h"
+#include "RenderQueue.h"
+#include "TransformationMatrix.h"
+#include "imgui.h"
+#include <algorithm>
+#include <cmath>
+
+void OcclusionDemo::Initialize()
+{
+    walls_ = {
+        MakeAffineMatrix({ 10.0f, 3.0f, 0.5f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, -1.0f, 4.0f }),
+        MakeAffineMatrix({ 0.5f, 3.0f, 24.0f }, { 0.0f, 0.0f, 0.0f }, { -12.0f, -1.0f, 20.0f }),
+        MakeAffineMatrix({ 0.5f, 3.0f, 24.0f }, { 0.0f, 0.0f, 0.0f }, { 12.0f, -1.0f, 20.0f }),
+    };
+    // カメラの後ろや横にはみ出すところまで並べる
+    boxes_.clear();
+    for (int z = -30; z <= 50; z += 2) {
+        for (int x = -30; x <= 30; x += 2) {
+            Vector3 center = { float(x), -1.5f, float(z) };
+            boxes_.push_back({
+                { center.x - kBoxSize * 0.5f, center.y - kBoxSize * 0.5f, center.z - kBoxSize * 0.5f },
+                { center.x + kBoxSize * 0.5f, center.y + kBoxSize * 0.5f, center.z + kBoxSize * 0.5f },
+            });
+        }
+    }
+    visible_.assign(boxes_.size(), 1);
+}
+
+void OcclusionDemo::DrawGui()
+{
+    ImGui::Text("Occlusion Culling");
+    ImGui::Separator();
+    ImGui::Checkbox("Show Occlusion Scene", &show_);
+    if (ImGui::IsItemHovered())
+        ImGui::SetTooltip("Draw %u small boxes on the floor behind %u large walls", uint32_t(boxes_.size()), uint32_t(walls_.size()));
+
+    ImGui::Checkbox("Occlusion Culling", &cullingEnabled_);
+    if (ImGui::IsItemHovered())
+        ImGui::SetTooltip("Skip boxes hidden behind the walls or outside the view (off = draw every box, for comparison)");
+    ImGui::SliderInt("Occlusion Threads", &threadCount_, 0, int(culler_.GetMaxThreadCount()));
+    if (ImGui::IsItemHovered())
+        ImGui::SetTooltip("Number of threads used to rasterize the walls and test the boxes (0 = all)");
+
+    const OcclusionCullerStats& occlusionStats = culler_.GetLastStats();
+    ImGui::Text("%u boxes: %u visible, %u frustum, %u occluded (%.1f%% culled)", occlusionStats.tested, occlusionStats.GetVisible(),
+        occlusionStats.frustumCulled, occlusionStats.occlusionCulled, occlusionStats.GetCullRate() * 100.0);
+    ImGui::Text("%u threads: raster %.3f ms, HiZ %.3f ms, test %.3f ms", occlusionStats.threadCount,
+        occlusionStats.rasterMilliseconds, occlusionStats.hizMilliseconds, occlusionStats.testMilliseconds);
+    if (ImGui::IsItemHovered())
+        ImGui::SetTooltip("%u of %u occluder triangles rasterized into a %ux%u depth buffer",
+            occlusionStats.rasterizedTriangles, occlusionStats.occluderTriangles, culler_.GetWidth(), culler_.GetHeight());
+}
+
+void OcclusionDemo::Update(const MeshData& cubeMesh, const Matrix4x4& viewProjection)
+{
+    if (!show_) {
+        return;
+    }
+    // カリングを切っても判定は行い、時間と省けた数を比べられるようにする
+    viewProjection_ = viewProjection;
+    culler_.SetThreadCount(uint32_t(threadCount_));
+    culler_.BeginFrame(viewProjection);
+    for (const Matrix4x4& wall : walls_) {
+        culler_.AddOccluder(&cubeMesh.vertices[0].position, sizeof(VertexData), uint32_t(cubeMesh.vertices.size()), wall);
+    }
+    culler_.Rasterize();
+    culler_.TestBounds(boxes_.data(), uint32_t(boxes_.size()), visible_.data());
+    if (!cullingEnabled_) {
+        std::fill(visible_.begin(), visible_.end(), uint8_t(1));
+    }
+}
+
+void OcclusionDemo::Record(RenderQueue& renderQueue, FrameContextRing& frameContexts, const DrawItem& baseItem, const Vector3& cameraPosition) const
+{
+    if (!show_) {
+        return;
+    }
+    DrawItem cubeItem = baseItem;
+    auto submitCube = [&](const Matrix4x4& world) {
+        TransformationMatrix* cubeData = frameContexts.AllocateUpload<TransformationMatrix>(cubeItem.transform);
+        cubeData->WVP = Multiply(world, viewProjection_);
+        cubeData->World = world;
+        Vector3 toCube = { world.m[3][0] - cameraPosition.x, world.m[3][1] - cameraPosition.y, world.m[3][2] - cameraPosition.z };
+        cubeItem.depth = std::sqrt(toCube.x * toCube.x + toCube.y * toCube.y + toCube.z * toCube.z);
+        renderQueue.Submit(cubeItem);
+    };
+    for (const Matrix4x4& wall : walls_) {
+        submitCube(wall);
+    }
+    for (size_t i = 0; i < boxes_.size(); ++i) {
+        if (!visible_[i]) {
+            continue;
+        }
+        const OcclusionBounds& box = boxes_[i];
+        Vector3 center = { (box.min.x + box.max.x) * 0.5f, (box.min.y + box.max.y) * 0.5f, (box.min.z + box.max.z) * 0.5f };
+        submitCube(MakeAffineMatrix({ kBoxSize, kBoxSize, kBoxSize }, { 0.0f, 0.0f, 0.0f }, center));
+    }
+}
@@ -0,0 +1,119 @@
+#include "SkinnedTubeDemo.h"
+#include "FrameContext.h"
+#include "RenderQueue.h"
+#include "TransformationMatrix.h"
+#include "imgui.h"
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+namespace {
+
+// スキニング確認用の円柱。下半分は根元の関節、上半分は曲げる関節に追従する
+std::vector<SkinVertexData> CreateSkinnedTube(float radius, float height, uint32_t segments, uint32_t rings)
+{
+    const float kTwoPi = 2.0f * std::numbers::pi_v<float>;
+    auto makeVertex = [&](uint32_t segment, uint32_t ring) {
+        float angle = kTwoPi * float(segment) / float(segments);
+        float v = float(ring) / float(rings);
+        float y = (v - 0.5f) * height;
+        // 中央付近で重みをなめらかに切り替える
+        float t = std::clamp((y / height) * 2.0f + 0.5f, 0.0f, 1.0f);
+        float bendWeight = t * t * (3.0f - 2.0f * t);
+
+        SkinVertexData vertex {};
+        vertex.position = { radius * std::cos(angle), y, radius * std::sin(angle), 1.0f };
+        vertex.texcoord = { float(segment) / float(segments), 1.0f - v };
+        vertex.normal = { std::cos(angle), 0.0f, std::sin(angle) };
+        vertex.jointIndices[0] = 0;
+        vertex.jointIndices[1] = 1;
+        vertex.weights[0] = 1.0f - bendWeight;
+        vertex.weights[1] = bendWeight;
+        return vertex;
+    };
+
+    std::vector<SkinVertexData> vertices;
+    vertices.reserve(size_t(segments) * rings * 6);
+    for (uint32_t ring = 0; ring < rings; ++ring) {
+        for (uint32_t segment = 0; segment < segments; ++segment) {
+            SkinVertexData v00 = makeVertex(segment, ring);
+            SkinVertexData v01 = makeVertex(segment + 1, ring);
+            SkinVertexData v10 = makeVertex(segment, ring + 1);
+            SkinVertexData v11 = makeVertex(segment + 1, ring + 1);
+            vertices.push_back(v00);
+            vertices.push_back(v10);
+            vertices.push_back(v11);
+            vertices.push_back(v00);
+            vertices.push_back(v11);
+            vertices.push_back(v01);
+        }
+    }
+    return vertices;
+}
+
+} // namespace
+
+void SkinnedTubeDemo::Initialize()
+{
+    int32_t rootJoint = skeleton_.AddJoint("root", -1, { { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, -1.0f, 0.0f } });
+    bendJoint_ = skeleton_.AddJoint("bend", rootJoint, { { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f } });
+    skeleton_.Finalize();
+    vertices_ = CreateSkinnedTube(0.3f, 2.0f, 32, 64);
+
+    vertexBufferView_.SizeInBytes = UINT(sizeof(VertexData) * vertices_.size());
+    vertexBufferView_.StrideInBytes = sizeof(VertexData);
+}
+
+void SkinnedTubeDemo::DrawGui()
+{
+    ImGui::Text("Skinning");
+    ImGui::Separator();
+    ImGui::Checkbox("Show Skinned Tube", &show_);
+    if (ImGui::IsItemHovered())
+        ImGui::SetTooltip("Draw a CPU-skinned tube next to the sphere");
+
+    ImGui::Combo("Skinning Mode", &modeIndex_, "Linear Blend\0Dual Quaternion\0");
+    ImGui::SliderInt("Skinning Threads", &threadCount_, 0, int(skinningEngine_.GetMaxThreadCount()));
+    if (ImGui::IsItemHovered())
+        ImGui::SetTooltip("Number of threads used for skinning (0 = all)");
+
+    const SkinningStats& skinningStats = skinningEngine_.GetLastStats();
+    ImGui::Text("%u verts, %u threads, %.3f ms (%.1f Mverts/s)", skinningStats.vertexCount, skinningStats.threadCount,
+        skinningStats.milliseconds, skinningStats.verticesPerSecond / 1000000.0);
+}
+
+void SkinnedTubeDemo::Update(FrameContextRing& frameContexts, const Matrix4x4& viewProjection, float deltaTime)
+{
+    if (!show_) {
+        return;
+    }
+    time_ += deltaTime;
+    skeleton_.joints[bendJoint_].localPose.rotate.z = std::sin(time_ * 2.0f);
+    skeleton_.joints[bendJoint_].localPose.rotate.y = time_;
+    skeleton_.UpdatePalette(palette_);
+
+    VertexData* skinnedVertexData = frameContexts.AllocateUpload<VertexData>(vertexBufferView_.BufferLocation, uint32_t(vertices_.size()));
+    skinningEngine_.SetThreadCount(uint32_t(threadCount_));
+    skinningEngine_.Skin(vertices_.data(), uint32_t(vertices_.size()), palette_, skinnedVertexData,
+        modeIndex_ == 0 ? SkinningMode::LinearBlend : SkinningMode::DualQuaternion);
+
+    Matrix4x4 worldMatrix = MakeTranslateMatrix(position_);
+    TransformationMatrix* wvpData = frameContexts.AllocateUpload<TransformationMatrix>(transformAddress_);
+    wvpData->WVP = Multiply(worldMatrix, viewProjection);
+    wvpData->World = worldMatrix;
+}
+
+void SkinnedTubeDemo::Record(RenderQueue& renderQueue, const DrawItem& baseItem, const Vector3& cameraPosition) const
+{
+    if (!show_) {
+        return;
+    }
+    Vector3 toTube = { position_.x - cameraPosition.x, position_.y - cameraPosition.y, position_.z - cameraPosition.z };
+    DrawItem item = baseItem;
+    item.depth = std::sqrt(toTube.x * toTube.x + toTube.y * toTube.y + toTube.z * toTube.z);
+    item.vertexBufferView = vertexBufferView_;
+    item.meshId = kMeshId;
+    item.transform = transformAddress_;
+    item.vertexCount = UINT(vertices_.size());
+    renderQueue.Submit(item);
+}
@@ -0,0 +1,197 @@
+#include "SpriteAtlasDemo.h"
+#include "DescriptorAllocator.h"
+#include "FrameContext.h"
+#include "GpakArchive.h"
+#include "RenderQueue.h"
+#include "TextureManager.h"
+#include "TransformationMatrix.h"
+#include "WinApp.h"
+#include "imgui.h"
+#include <cassert>
+#include <memory>
+
+namespace {
+
+// 板を並べる行の長さと1枚の大きさ(ピクセル)
+const uint32_t kQuadsPerRow = 64;
+const float kQuadSize = 20.0f;
+
+// 画像を読み込み、RGBA8に変換して指定の大きさに縮小する。読めなければfalse
+bool LoadSpriteImage(const GpakArchive* archive, const std::string& filePath, size_t width, size_t height, DirectX::ScratchImage& resized)
+{
+    AssetBytes fileBytes;
+    if (!ReadAssetBytes(archive, filePath, fileBytes)) {
+        return false;
+    }
+    DirectX::ScratchImage image {};
+    HRESULT hr = DirectX::LoadFromWICMemory(fileBytes.data, fileBytes.size, DirectX::WIC_FLAGS_FORCE_SRGB, nullptr, image);
+    if (SUCCEEDED(hr) && image.GetMetadata().format != DXGI_FORMAT_R8G8B8A8_UNORM_SRGB) {
+        DirectX::ScratchImage converted {};
+        hr = DirectX::Convert(*image.GetImage(0, 0, 0), DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, DirectX::TEX_FILTER_DEFAULT, DirectX::TEX_THRESHOLD_DEFAULT, converted);
+        image = std::move(converted);
+    }
+    if (SUCCEEDED(hr)) {
+        hr = DirectX::Resize(*image.GetImage(0, 0, 0), width, height, DirectX::TEX_FILTER_SRGB, resized);
+    }
+    return SUCCEEDED(hr);
+}
+
+} // namespace
+
+void SpriteAtlasDemo::Initialize(const GpakArchive* archive, GpuMemoryAllocator& gpuMemory, MaterialTable& materialTable)
+{
+    sources_ = { "Resources/uvChecker.png", "Resources/monsterBall.png", "Resources/red01.png", "Resources/sky_sphere.png" };
+    sizes_ = { 96, 64, 48, 32 };
+    for (const std::string& source : sources_) {
+        for (size_t size : sizes_) {
+            DirectX::ScratchImage spriteImage {};
+            bool loaded = LoadSpriteImage(archive, source, size, size, spriteImage);
+            assert(loaded);
+            (void)loaded;
+            images_.push_back(std::move(spriteImage));
+            const DirectX::Image* image = images_.back().GetImage(0, 0, 0);
+            spriteIds_.push_back(atlas_.GetBuilder().AddSprite(uint32_t(image->width), uint32_t(image->height), image->pixels, uint32_t(image->rowPitch)));
+        }
+    }
+    atlas_.GetBuilder().Pack();
+    atlas_.Update();
+
+    // 画面下部に並べる板。ページ順に並べ、ページごとの範囲を覚えておく
+    vertexMemory_ = gpuMemory.CreateBuffer(sizeof(VertexData) * 6 * kQuadCount);
+    HRESULT hr = vertexMemory_.resource->Map(0, nullptr, reinterpret_cast<void**>(&vertexData_));
+    assert(SUCCEEDED(hr));
+    (void)hr;
+    vertexBufferView_.BufferLocation = vertexMemory_.resource->GetGPUVirtualAddress();
+    vertexBufferView_.SizeInBytes = UINT(sizeof(VertexData) * 6 * kQuadCount);
+    vertexBufferView_.StrideInBytes = sizeof(VertexData);
+    BuildQuads();
+
+    Material material {};
+    material.color = { 1.0f, 1.0f, 1.0f, 1.0f };
+    material.alphaTest = true;
+    material.uvTransform = MakeIdentity4x4();
+    materialId_ = materialTable.Add(material);
+
+    screenTransformMemory_ = gpuMemory.CreateBuffer(sizeof(TransformationMatrix));
+    TransformationMatrix* screenTransform = nullptr;
+    screenTransformMemory_.resource->Map(0, nullptr, reinterpret_cast<void**>(&screenTransform));
+    screenTransform->WVP = MakeOrthographicMatrix(0.0f, 0.0f, float(WinApp::kClientWidth), float(WinApp::kClientHeight), 0.0f, 100.0f);
+    screenTransform->World = MakeIdentity4x4();
+}
+
+void SpriteAtlasDemo::DrawGui()
+{
+    ImGui::Text("Sprite Atlas");
+    ImGui::Separator();
+    ImGui::Checkbox("Show Atlas Sprites", &show_);
+    if (ImGui::IsItemHovered())
+        ImGui::SetTooltip("Draw %u sprites that share atlas pages (one draw per page)", kQuadCount);
+
+    if (ImGui::Button("Re-add Sprite")) {
+        // 1つ外して入れ直す。空いている場所に差分だけ詰める
+        ReplaceSprite(readdIndex_++ % GetSpriteCount());
+        atlas_.GetBuilder().Pack();
+        changed_ = true;
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Repack Atlas")) {
+        atlas_.GetBuilder().Repack();
+        changed_ = true;
+    }
+
+    SpriteAtlasStats atlasStats = atlas_.GetBuilder().GetStats();
+    ImGui::Text("%u sprites in %u pages (%.1f%% used), %u draws", atlasStats.spriteCount, atlasStats.pageCount,
+        atlasStats.occupancy * 100.0f, atlasStats.pageCount);
+}
+
+void SpriteAtlasDemo::Update(FrameContextRing& frameContexts)
+{
+    if (!changed_) {
+        return;
+    }
+    frameContexts.WaitIdle();
+    atlas_.Update();
+    BuildQuads();
+    changed_ = false;
+}
+
+void SpriteAtlasDemo::Record(RenderQueue& renderQueue, const DrawItem& baseItem, DescriptorAllocator& descriptors) const
+{
+    if (!show_) {
+        return;
+    }
+    for (uint32_t page = 0; page < pageRanges_.size(); ++page) {
+        if (pageRanges_[page].second == 0) {
+            continue;
+        }
+        DrawItem item = baseItem;
+        item.vertexBufferView = vertexBufferView_;
+        item.meshId = kMeshId;
+        item.transform = GetScreenTransformAddress();
+        item.texture = descriptors.StageFrameDescriptor(textureManager_.GetSrvHandleCPU(atlas_.GetPageTexture(page)));
+        item.textureId = atlas_.GetPageTexture(page);
+        item.startVertex = pageRanges_[page].first;
+        item.vertexCount = pageRanges_[page].second;
+        renderQueue.Submit(item);
+    }
+}
+
+AssetHotReloader::ApplyFunc SpriteAtlasDemo::PrepareSourceReload(uint32_t source)
+{
+    // 縮小はワーカーで済ませ、差し替えと詰め直しだけをフレームの先頭で行う
+    auto images = std::make_shared<std::vector<DirectX::ScratchImage>>(sizes_.size());
+    for (size_t i = 0; i < sizes_.size(); ++i) {
+        if (!LoadSpriteImage(nullptr, sources_[source], sizes_[i], sizes_[i], (*images)[i])) {
+            return nullptr;
+        }
+    }
+    return [this, source, images] {
+        for (size_t i = 0; i < images->size(); ++i) {
+            const uint32_t sprite = uint32_t(source * sizes_.size() + i);
+            images_[sprite] = std::move((*images)[i]);
+            ReplaceSprite(sprite);
+        }
+        atlas_.GetBuilder().Pack();
+        changed_ = true;
+        return true;
+    };
+}
+
+void SpriteAtlasDemo::ReplaceSprite(uint32_t sprite)
+{
+    SpriteAtlasBuilder& builder = atlas_.GetBuilder();
+    const DirectX::Image* image = images_[sprite].GetImage(0, 0, 0);
+    builder.RemoveSprite(spriteIds_[sprite]);
+    spriteIds_[sprite] = builder.AddSprite(uint32_t(image->width), uint32_t(image->height), image->pixels, uint32_t(image->rowPitch));
+}
+
+void SpriteAtlasDemo::BuildQuads()
+{
+    const SpriteAtlasBuilder& builder = atlas_.GetBuilder();
+    std::vector<std::vector<uint32_t>> quadsPerPage(builder.GetPageCount());
+    for (uint32_t quad = 0; quad < kQuadCount; ++quad) {
+        quadsPerPage[GetRegion(quad % GetSpriteCount()).page].push_back(quad);
+    }
+
+    pageRanges_.assign(builder.GetPageCount(), { 0, 0 });
+    UINT vertex = 0;
+    for (uint32_t page = 0; page < builder.GetPageCount(); ++page) {
+        pageRanges_[page].first = vertex;
+        for (uint32_t quad : quadsPerPage[page]) {
+            const AtlasRegion& region = GetRegion(quad % GetSpriteCount());
+            float left = float(quad % kQuadsPerRow) * kQuadSize;
+            float top = float(WinApp::kClientHeight) - float(kQuadCount / kQuadsPerRow - quad / kQuadsPerRow) * kQuadSize;
+            float right = left + kQuadSize - 2.0f;
+            float bottom = top + kQuadSize - 2.0f;
+            VertexData* v = &vertexData_[vertex];
+            v[0] = { { left, bottom, 0.0f, 1.0f }, { region.u0, region.v1 }, { 0.0f, 0.0f, -1.0f } };
+            v[1] = { { left, top, 0.0f, 1.0f }, { region.u0, region.v0 }, { 0.0f, 0.0f, -1.0f } };
+            v[2] = { { right, bottom, 0.0f, 1.0f }, { region.u1, region.v1 }, { 0.0f, 0.0f, -1.0f } };
+            v[3] = v[1];
+            v[4] = { { right, top, 0.0f, 1.0f }, { region.u1, region.v0 }, { 0.0f, 0.0f, -1.0f } };
+            v[5] = v[2];
+            vertex += 6;
+        }
+        pageRanges_[page].second = vertex - pageRanges_[page].first;
+    }
+}
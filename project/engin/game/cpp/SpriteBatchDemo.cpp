@@ -0,0 +1,104 @@
+#include "SpriteBatchDemo.h"
+#include "SceneRenderGraph.h"
+#include "SpriteAtlasDemo.h"
+#include "WinApp.h"
+#include "imgui.h"
+#include <cmath>
+#include <numbers>
+
+void SpriteBatchDemo::Initialize(GpuMemoryAllocator& gpuMemory)
+{
+    spriteBatch_.Initialize(gpuMemory);
+}
+
+void SpriteBatchDemo::DrawGui()
+{
+    ImGui::Text("Sprite Batch");
+    ImGui::Separator();
+    ImGui::Checkbox("Show Sprite Batch", &show_);
+    if (ImGui::IsItemHovered())
+        ImGui::SetTooltip("Draw many bouncing atlas sprites with one draw per atlas page");
+
+    ImGui::SliderInt("Batch Sprites", &count_, 1, kMaxSprites);
+    ImGui::Checkbox("SIMD Quads", &simd_);
+    if (ImGui::IsItemHovered())
+        ImGui::SetTooltip("Build the quads 4 sprites at a time with SSE2 (off = scalar, for comparison)");
+    ImGui::SliderInt("Sprite Threads", &threadCount_, 0, int(spriteBatch_.GetMaxThreadCount()));
+    if (ImGui::IsItemHovered())
+        ImGui::SetTooltip("Number of threads used to build the quads (0 = all)");
+
+    const SpriteBatchStats& spriteBatchStats = spriteBatch_.GetLastStats();
+    ImGui::Text("%u sprites, %u draws (%u batches), sort %.3f ms", spriteBatchStats.spriteCount, spriteBatchStats.drawCount,
+        spriteBatchStats.batchCount, spriteBatchStats.sortMilliseconds);
+    ImGui::Text("Quads: %s, %u threads, %.3f ms (%.1f Msprites/s)", spriteBatchStats.simd ? "SIMD" : "scalar", spriteBatchStats.threadCount,
+        spriteBatchStats.buildMilliseconds, spriteBatchStats.spritesPerSecond / 1000000.0);
+    if (ImGui::IsItemHovered())
+        ImGui::SetTooltip("Time to write 4 vertices per sprite straight into the upload ring");
+}
+
+void SpriteBatchDemo::Update(FrameContextRing& frameContexts, const SpriteAtlasDemo& atlas, float deltaTime)
+{
+    spriteBatch_.Clear();
+    if (!show_) {
+        return;
+    }
+    Resize(uint32_t(count_), atlas.GetSpriteCount());
+    for (BatchSprite& batchSprite : sprites_) {
+        Sprite& sprite = batchSprite.sprite;
+        sprite.position.x += batchSprite.velocity.x * deltaTime;
+        sprite.position.y += batchSprite.velocity.y * deltaTime;
+        // 画面の端で跳ね返る
+        if (sprite.position.x < 0.0f || sprite.position.x > float(WinApp::kClientWidth)) {
+            batchSprite.velocity.x = std::copysign(batchSprite.velocity.x, float(WinApp::kClientWidth) * 0.5f - sprite.position.x);
+        }
+        if (sprite.position.y < 0.0f || sprite.position.y > float(WinApp::kClientHeight)) {
+            batchSprite.velocity.y = std::copysign(batchSprite.velocity.y, float(WinApp::kClientHeight) * 0.5f - sprite.position.y);
+        }
+        sprite.rotation += batchSprite.spin * deltaTime;
+        if (std::fabs(sprite.rotation) > std::numbers::pi_v<float>) {
+            sprite.rotation -= std::copysign(2.0f * std::numbers::pi_v<float>, sprite.rotation);
+        }
+        // アトラスを詰め直しても追えるよう、UVは毎フレーム引く
+        const AtlasRegion& region = atlas.GetRegion(batchSprite.atlasSprite);
+        sprite.uvRect = { region.u0, region.v0, region.u1, region.v1 };
+        spriteBatch_.Draw(atlas.GetPageTexture(region.page), sprite);
+    }
+    spriteBatch_.SetSimdEnabled(simd_);
+    spriteBatch_.SetThreadCount(uint32_t(threadCount_));
+    spriteBatch_.Build(frameContexts);
+}
+
+void SpriteBatchDemo::Record(SceneRenderGraph& sceneRenderGraph, std::function<void(ID3D12GraphicsCommandList*)> setup, UINT rootParameterIndex,
+    std::function<D3D12_GPU_DESCRIPTOR_HANDLE(uint32_t textureId)> getTexture) const
+{
+    if (!show_) {
+        return;
+    }
+    sceneRenderGraph.AddOverlayPass("Sprites",
+        [this, setup = std::move(setup), rootParameterIndex, getTexture = std::move(getTexture)](ID3D12GraphicsCommandList* list) {
+            setup(list);
+            spriteBatch_.Record(list, rootParameterIndex, getTexture);
+        });
+}
+
+void SpriteBatchDemo::Resize(uint32_t count, uint32_t atlasSpriteCount)
+{
+    uint32_t seed = uint32_t(sprites_.size()) * 2654435761u + 1;
+    auto random = [&seed]() {
+        seed = seed * 1664525u + 1013904223u;
+        return float(seed >> 8) / float(1 << 24);
+    };
+    while (sprites_.size() < count) {
+        BatchSprite batchSprite {};
+        float size = 6.0f + random() * 14.0f;
+        batchSprite.sprite.position = { random() * float(WinApp::kClientWidth), random() * float(WinApp::kClientHeight) };
+        batchSprite.sprite.scale = { size, size };
+        batchSprite.sprite.rotation = random() * 2.0f * std::numbers::pi_v<float>;
+        batchSprite.sprite.color = PackSpriteColor({ 0.5f + random() * 0.5f, 0.5f + random() * 0.5f, 0.5f + random() * 0.5f, 0.8f });
+        batchSprite.velocity = { (random() - 0.5f) * 240.0f, (random() - 0.5f) * 240.0f };
+        batchSprite.spin = (random() - 0.5f) * 4.0f;
+        batchSprite.atlasSprite = uint32_t(sprites_.size() % atlasSpriteCount);
+        sprites_.push_back(batchSprite);
+    }
+    sprites_.resize(count);
+}
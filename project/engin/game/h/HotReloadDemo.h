@@ -0,0 +1,48 @@
+#pragma once
+#include "AssetHotReloader.h"
+#include "ShaderCache.h"
+#include "ShaderPermutation.h"
+#include "TextureCooker.h"
+#include <functional>
+#include <string>
+#include <vector>
+#include <wrl.h>
+
+class MeshManager;
+class SpriteAtlasDemo;
+class TextureManager;
+class ThreadPool;
+
+// Resources以下の変更を監視し、変わったものとそれに依存するものだけを作り直して差し替える
+// 差し替えはフレームの先頭で行う(GPUが読んでいるかもしれないものは解放を遅らせるか、GPUを待ってから書き換える)
+class HotReloadDemo {
+public:
+    // 作り直したシェーダーでパイプラインを差し替える。失敗したらfalseを返し、今のものを使い続ける
+    using ApplyVertexShader = std::function<bool(const Microsoft::WRL::ComPtr<IDxcBlob>& blob)>;
+    using ApplyPixelShaders = std::function<bool(const ShaderPermutation& permutation, const std::vector<Microsoft::WRL::ComPtr<IDxcBlob>>& blobs)>;
+
+    explicit HotReloadDemo(ThreadPool& threadPool) : hotReloader_(threadPool) { }
+
+    // テクスチャ。クック済みならクックし直す
+    void RegisterTextures(const std::vector<std::string>& textureFiles, TextureManager& textureManager);
+    // アトラスのスプライトは元画像に依存する
+    void RegisterAtlas(SpriteAtlasDemo& spriteAtlasDemo);
+    // シェーダー。インクルードしているファイルが変わっても作り直す
+    // ピクセルシェーダーはキーワードを読み直し、全バリアントをそろえ直す
+    void RegisterShaders(ShaderCache& shaderCache, const std::string& vertexShaderPath, ApplyVertexShader applyVertexShader,
+        const std::string& pixelShaderPath, ApplyPixelShaders applyPixelShaders);
+    // モデルはメッシュの読み込みをやり直す(デコードはMeshStreamerのワーカーで行う)
+    void RegisterModel(const std::string& modelPath, MeshManager& meshManager);
+
+    // 登録し終えたら監視を始める。pollなら変更通知を使わずに見に行く
+    void Start(const std::string& directory, bool poll);
+    // 作り直しが終わったものを差し替える。フレームの先頭で呼ぶ
+    void Update();
+    // Main Controlの中に監視の状態と差し替えまでの時間を出す
+    void DrawGui();
+
+private:
+    // ワーカーの作り直しが使うので、監視より後に消えるよう先に宣言する
+    TextureCooker cooker_;
+    AssetHotReloader hotReloader_;
+};
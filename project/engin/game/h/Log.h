@@ -0,0 +1,13 @@
+#pragma once
+#include "ShaderCache.h"
+#include <string>
+#include <vector>
+
+// 文字列を出す
+void Log(const std::string& message);
+
+std::wstring ConvertString(const std::string& str);
+std::string ConvertString(const std::wstring& str);
+
+// シェーダーのコンパイル結果をログに出す。すべて成功していればtrue
+bool LogShaderResults(const std::vector<ShaderCompileDesc>& descs, const std::vector<ShaderCompileResult>& results);
@@ -0,0 +1,41 @@
+#pragma once
+#include "MakeAffine.h"
+#include "OcclusionCuller.h"
+#include <cstdint>
+#include <vector>
+
+class FrameContextRing;
+class RenderQueue;
+class ThreadPool;
+struct DrawItem;
+struct MeshData;
+
+// OcclusionCullerのデモ。床に並べた小さな箱のうち、大きな壁の陰になるものをCPUで省いて描く
+// 壁も箱も立方体のメッシュで描き、オクルーダーには立方体のCPU側の頂点をそのまま渡す
+class OcclusionDemo {
+public:
+    // threadPoolがnullptrなら呼び出しスレッドだけで判定する
+    explicit OcclusionDemo(ThreadPool* threadPool = nullptr) : culler_(threadPool) { }
+
+    // 壁と箱を並べる
+    void Initialize();
+    // Main Controlの中に設定と計測結果を出す
+    void DrawGui();
+    // 見せているときだけ、壁を低解像度の深度に描いて箱ごとに見えるかを調べる
+    void Update(const MeshData& cubeMesh, const Matrix4x4& viewProjection);
+    // 壁と見える箱を積む。baseItemには立方体のメッシュとマテリアルを設定しておく
+    void Record(RenderQueue& renderQueue, FrameContextRing& frameContexts, const DrawItem& baseItem, const Vector3& cameraPosition) const;
+
+private:
+    static constexpr float kBoxSize = 0.5f;
+
+    OcclusionCuller culler_;
+    std::vector<Matrix4x4> walls_;
+    std::vector<OcclusionBounds> boxes_;
+    std::vector<uint8_t> visible_;
+    Matrix4x4 viewProjection_ {};
+
+    bool show_ = false;
+    bool cullingEnabled_ = true;
+    int threadCount_ = 0;
+};
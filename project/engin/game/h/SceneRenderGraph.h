@@ -0,0 +1,59 @@
+#pragma once
+#include "RenderGraph.h"
+#include <cstdint>
+#include <d3d12.h>
+#include <functional>
+#include <string>
+#include <wrl.h>
+
+class FrameContextRing;
+class ResourceStateRegistry;
+
+// 1フレームの描画をRenderGraphのパスの並びにする
+// 深度バッファはフレームの中だけで使うので一時リソースとして置き、DSVは実体が作り直されたときだけ作り直す
+class SceneRenderGraph {
+public:
+    SceneRenderGraph(ID3D12Device* device, ResourceStateRegistry& resourceStates)
+        : device_(device)
+        , resourceStates_(resourceStates)
+        , transientResources_(device, resourceStates)
+    {
+    }
+
+    // 深度バッファの設定とDSVのヒープを作る
+    void Initialize(int32_t width, int32_t height);
+    // Main Controlの中にパスとバリア、一時リソースの数を出す
+    void DrawGui();
+
+    // フレームの始めにパスを消し、このフレームのバックバッファを使う
+    void Begin(ID3D12Resource* backBuffer, D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle);
+    // 色と深度をクリアしてからrecordを呼ぶパス
+    void AddScenePass(RenderGraph::ExecuteFunc record);
+    // 深度を使わずに上から重ねるパス。足した順に描く
+    void AddOverlayPass(const std::string& name, RenderGraph::ExecuteFunc record);
+    // バリアと一時リソースの置き場所を決める(CPUだけで済み、コマンドリストには積まない)
+    void Compile(FrameContextRing& frameContexts);
+    // 足したパスを順に記録する
+    void Execute(const std::function<ResourceStateTracker&()>& getStateTracker);
+
+    // Beginからこのフレームを記録し終えるまで使える(区切ったコマンドリストで設定し直すときに使う)
+    const D3D12_CPU_DESCRIPTOR_HANDLE& GetRenderTargetView() const { return rtvHandle_; }
+    const D3D12_CPU_DESCRIPTOR_HANDLE& GetDepthStencilView() const { return dsvHandle_; }
+
+private:
+    ID3D12Device* device_ = nullptr;
+    ResourceStateRegistry& resourceStates_;
+    RenderGraph renderGraph_;
+    TransientResourceCache transientResources_;
+
+    D3D12_RESOURCE_DESC depthTextureDesc_ {};
+    D3D12_RESOURCE_ALLOCATION_INFO depthAllocationInfo_ {};
+    D3D12_CLEAR_VALUE depthClearValue_ {};
+    ID3D12Resource* depthStencilResource_ = nullptr;
+    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> dsvDescriptorHeap_;
+
+    RenderGraphResource backBuffer_ = kInvalidRenderGraphResource;
+    RenderGraphResource depthBuffer_ = kInvalidRenderGraphResource;
+    D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle_ {};
+    D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle_ {};
+};
@@ -0,0 +1,47 @@
+#pragma once
+#include "MakeAffine.h"
+#include "Skeleton.h"
+#include "SkinningEngine.h"
+#include <cstdint>
+#include <d3d12.h>
+#include <vector>
+
+class FrameContextRing;
+class RenderQueue;
+class ThreadPool;
+struct DrawItem;
+
+// スキニングのデモ(2関節で曲がる円柱)。結果はアップロードリングへ直接書き込む
+class SkinnedTubeDemo {
+public:
+    // RenderQueueに積むときのメッシュの番号
+    static constexpr uint32_t kMeshId = MeshType_Count;
+
+    // threadPoolがnullptrなら呼び出しスレッドだけでスキニングする
+    explicit SkinnedTubeDemo(ThreadPool* threadPool = nullptr) : skinningEngine_(threadPool) { }
+
+    // 関節と円柱の頂点を作る
+    void Initialize();
+    // Main Controlの中に設定と計測結果を出す
+    void DrawGui();
+    // 見せているときだけ姿勢を進めてスキニングし、頂点と変換行列をこのフレームのアップロードリングに書く
+    void Update(FrameContextRing& frameContexts, const Matrix4x4& viewProjection, float deltaTime);
+    // baseItemと同じマテリアルとテクスチャで描く
+    void Record(RenderQueue& renderQueue, const DrawItem& baseItem, const Vector3& cameraPosition) const;
+
+private:
+    Skeleton skeleton_;
+    int32_t bendJoint_ = -1;
+    std::vector<SkinVertexData> vertices_;
+    std::vector<Matrix4x4> palette_;
+    SkinningEngine skinningEngine_;
+
+    D3D12_VERTEX_BUFFER_VIEW vertexBufferView_ {};
+    D3D12_GPU_VIRTUAL_ADDRESS transformAddress_ = 0;
+
+    Vector3 position_ = { 2.5f, 0.0f, 0.0f };
+    bool show_ = false;
+    int modeIndex_ = 0;
+    int threadCount_ = 0;
+    float time_ = 0.0f;
+};
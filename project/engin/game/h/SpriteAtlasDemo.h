@@ -0,0 +1,85 @@
+#pragma once
+#include "AssetHotReloader.h"
+#include "DirectXTex.h"
+#include "GpuMemoryAllocator.h"
+#include "MaterialTable.h"
+#include "MeshManager.h"
+#include "SpriteAtlas.h"
+#include <cstdint>
+#include <d3d12.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+class DescriptorAllocator;
+class FrameContextRing;
+class GpakArchive;
+class RenderQueue;
+class TextureManager;
+struct DrawItem;
+
+// スプライトアトラスのデモ。小さな画像を数枚のページにまとめ、ページごとに1回のDrawで描く
+class SpriteAtlasDemo {
+public:
+    // RenderQueueに積むときのメッシュの番号
+    static constexpr uint32_t kMeshId = MeshType_Count + 2;
+    // 画面下部に並べる板の数
+    static constexpr uint32_t kQuadCount = 1024;
+
+    explicit SpriteAtlasDemo(TextureManager& textureManager)
+        : textureManager_(textureManager)
+        , atlas_(textureManager, "atlas/sprites")
+    {
+    }
+
+    // 元画像を縮小してアトラスに詰め、板とマテリアル、画面への射影を作る
+    void Initialize(const GpakArchive* archive, GpuMemoryAllocator& gpuMemory, MaterialTable& materialTable);
+    // Main Controlの中に設定と詰め具合を出す
+    void DrawGui();
+    // 詰め直したアトラスをフレームの先頭で反映する
+    // ページと頂点はその場で書き換えるので、変わったときだけGPUを待つ
+    void Update(FrameContextRing& frameContexts);
+    // ページごとにまとめて積む。baseItemにはマテリアルとパイプラインを設定しておく
+    void Record(RenderQueue& renderQueue, const DrawItem& baseItem, DescriptorAllocator& descriptors) const;
+
+    MaterialId GetMaterialId() const { return materialId_; }
+    // 画面の座標をそのまま使う射影(WVPとWorldのCBV)
+    D3D12_GPU_VIRTUAL_ADDRESS GetScreenTransformAddress() const { return screenTransformMemory_.resource->GetGPUVirtualAddress(); }
+
+    // 詰めたスプライト。番号は0からGetSpriteCount()-1で、詰め直しても変わらない
+    uint32_t GetSpriteCount() const { return uint32_t(spriteIds_.size()); }
+    const AtlasRegion& GetRegion(uint32_t sprite) const { return atlas_.GetBuilder().GetRegion(spriteIds_[sprite]); }
+    TextureHandle GetPageTexture(uint32_t page) const { return atlas_.GetPageTexture(page); }
+
+    // ホットリロード用。元画像ごとに縮小し直し、アトラスの中身を差し替える
+    uint32_t GetSourceCount() const { return uint32_t(sources_.size()); }
+    const std::string& GetSourcePath(uint32_t source) const { return sources_[source]; }
+    // ワーカーで呼ぶ。読めなければ空のApplyFuncを返す
+    AssetHotReloader::ApplyFunc PrepareSourceReload(uint32_t source);
+
+private:
+    // 読み込んだ画像をアトラスに入れ直す
+    void ReplaceSprite(uint32_t sprite);
+    // 板の頂点をページ順に書き直す
+    void BuildQuads();
+
+    TextureManager& textureManager_;
+    SpriteAtlas atlas_;
+    std::vector<std::string> sources_;
+    std::vector<size_t> sizes_;
+    // sources_ごとにsizes_の順に並べた画像と、アトラスでの番号
+    std::vector<DirectX::ScratchImage> images_;
+    std::vector<uint32_t> spriteIds_;
+
+    GpuAllocation vertexMemory_;
+    VertexData* vertexData_ = nullptr;
+    D3D12_VERTEX_BUFFER_VIEW vertexBufferView_ {};
+    // ページごとの先頭頂点と頂点数
+    std::vector<std::pair<UINT, UINT>> pageRanges_;
+    MaterialId materialId_ = 0;
+    GpuAllocation screenTransformMemory_;
+
+    bool show_ = false;
+    bool changed_ = false;
+    uint32_t readdIndex_ = 0;
+};
@@ -0,0 +1,52 @@
+#pragma once
+#include "SpriteBatch.h"
+#include <cstdint>
+#include <d3d12.h>
+#include <functional>
+#include <vector>
+
+class FrameContextRing;
+class SceneRenderGraph;
+class SpriteAtlasDemo;
+class ThreadPool;
+
+// SpriteBatchのデモ。アトラスの画像をたくさん画面中で跳ね回らせ、アトラスのページごとにまとめて描く
+class SpriteBatchDemo {
+public:
+    static constexpr int kMaxSprites = 131072;
+
+    // threadPoolがnullptrなら呼び出しスレッドだけで板を作る
+    explicit SpriteBatchDemo(ThreadPool* threadPool = nullptr) : spriteBatch_(threadPool) { }
+
+    // 共有するインデックスバッファを作る
+    void Initialize(GpuMemoryAllocator& gpuMemory);
+    // Main Controlの中に設定と計測結果を出す
+    void DrawGui();
+    // 見せているときだけスプライトを動かし、板をこのフレームのアップロードリングに作る
+    void Update(FrameContextRing& frameContexts, const SpriteAtlasDemo& atlas, float deltaTime);
+    // 見せているときだけ、深度を使わずにシーンの上へ重ねるパスを足す
+    // setupはルートシグネチャとパイプライン、画面への射影のCBV、ビューポートを設定する
+    // テクスチャはgetTextureで受け取り、rootParameterIndexのディスクリプタテーブルに設定する
+    void Record(SceneRenderGraph& sceneRenderGraph, std::function<void(ID3D12GraphicsCommandList*)> setup, UINT rootParameterIndex,
+        std::function<D3D12_GPU_DESCRIPTOR_HANDLE(uint32_t textureId)> getTexture) const;
+
+private:
+    struct BatchSprite {
+        Sprite sprite;
+        Vector2 velocity;
+        float spin;
+        // SpriteAtlasDemoのスプライトの番号
+        uint32_t atlasSprite;
+    };
+
+    // 足りない分を足す。位置や速さは番号から決まる乱数で決める
+    void Resize(uint32_t count, uint32_t atlasSpriteCount);
+
+    SpriteBatch spriteBatch_;
+    std::vector<BatchSprite> sprites_;
+
+    bool show_ = false;
+    bool simd_ = true;
+    int count_ = 100000;
+    int threadCount_ = 0;
+};
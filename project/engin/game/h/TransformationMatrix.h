@@ -0,0 +1,8 @@
+#pragma once
+#include "MakeAffine.h"
+
+// object3dのシェーダーに渡す変換行列
+struct TransformationMatrix {
+    Matrix4x4 WVP;
+    Matrix4x4 World;
+};
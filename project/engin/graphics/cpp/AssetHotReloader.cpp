@@ -0,0 +1,140 @@
+#include "AssetHotReloader.h"
+#include "TextureCache.h"
+#include "ThreadPool.h"
+#include <algorithm>
+
+namespace {
+
+double ElapsedMilliseconds(std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end)
+{
+    return std::chrono::duration<double, std::milli>(end - begin).count();
+}
+
+} // namespace
+
+AssetHotReloader::AssetHotReloader(ThreadPool& threadPool)
+    : threadPool_(threadPool)
+{
+}
+
+AssetHotReloader::~AssetHotReloader()
+{
+    watcher_.Stop();
+    // ワーカーが触っている作り直しを先に片付ける
+    std::unique_lock<std::mutex> lock(completedMutex_);
+    completedCondition_.wait(lock, [this] { return inFlight_ == 0; });
+}
+
+bool AssetHotReloader::Start(const std::string& directory, bool forcePolling)
+{
+    return watcher_.Start(directory, forcePolling);
+}
+
+void AssetHotReloader::Register(const std::string& path, CookFunc cook)
+{
+    targets_[TextureCache::NormalizePath(path)] = std::move(cook);
+}
+
+void AssetHotReloader::AddDependency(const std::string& dependency, const std::string& dependent)
+{
+    dependents_[TextureCache::NormalizePath(dependency)].push_back(TextureCache::NormalizePath(dependent));
+}
+
+std::vector<HotReloadResult> AssetHotReloader::Update()
+{
+    for (const AssetChange& change : watcher_.PollChanges()) {
+        std::vector<std::string> targets = CollectTargets(TextureCache::NormalizePath(change.path));
+        if (targets.empty()) {
+            continue;
+        }
+        ++stats_.changes;
+        for (const std::string& target : targets) {
+            Schedule(target, change.detectedTime);
+        }
+    }
+
+    std::vector<Completed> completed;
+    {
+        std::lock_guard<std::mutex> lock(completedMutex_);
+        completed.swap(completed_);
+    }
+
+    std::vector<HotReloadResult> results;
+    for (Completed& done : completed) {
+        cooking_.erase(done.path);
+
+        HotReloadResult result;
+        result.path = done.path;
+        result.succeeded = done.apply && done.apply();
+        result.cookMilliseconds = done.cookMilliseconds;
+        result.latencyMilliseconds = ElapsedMilliseconds(done.detectedTime, std::chrono::steady_clock::now());
+        if (result.succeeded) {
+            ++stats_.reloaded;
+        } else {
+            ++stats_.failed;
+        }
+        stats_.lastLatencyMilliseconds = result.latencyMilliseconds;
+        stats_.maxLatencyMilliseconds = std::max(stats_.maxLatencyMilliseconds, result.latencyMilliseconds);
+        stats_.totalLatencyMilliseconds += result.latencyMilliseconds;
+        results.push_back(std::move(result));
+
+        // 作り直している間にまた変更されていたら、もう一度作り直す
+        auto again = changedWhileCooking_.find(done.path);
+        if (again != changedWhileCooking_.end()) {
+            std::chrono::steady_clock::time_point detectedTime = again->second;
+            changedWhileCooking_.erase(again);
+            Schedule(done.path, detectedTime);
+        }
+    }
+    return results;
+}
+
+void AssetHotReloader::Schedule(const std::string& path, std::chrono::steady_clock::time_point detectedTime)
+{
+    if (!cooking_.insert(path).second) {
+        changedWhileCooking_.try_emplace(path, detectedTime);
+        return;
+    }
+
+    CookFunc cook = targets_.at(path);
+    {
+        std::lock_guard<std::mutex> lock(completedMutex_);
+        ++inFlight_;
+    }
+    threadPool_.Enqueue([this, path, cook, detectedTime] {
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        ApplyFunc apply = cook();
+        double cookMilliseconds = ElapsedMilliseconds(begin, std::chrono::steady_clock::now());
+        {
+            std::lock_guard<std::mutex> lock(completedMutex_);
+            completed_.push_back({ path, std::move(apply), cookMilliseconds, detectedTime });
+            --inFlight_;
+            // デストラクタが待ち終えて条件変数を壊す前に知らせる
+            completedCondition_.notify_all();
+        }
+    });
+}
+
+std::vector<std::string> AssetHotReloader::CollectTargets(const std::string& changedPath) const
+{
+    std::vector<std::string> targets;
+    std::unordered_set<std::string> visited { changedPath };
+    std::vector<std::string> stack { changedPath };
+    while (!stack.empty()) {
+        std::string path = std::move(stack.back());
+        stack.pop_back();
+        if (targets_.count(path) != 0) {
+            targets.push_back(path);
+        }
+        auto it = dependents_.find(path);
+        if (it == dependents_.end()) {
+            continue;
+        }
+        for (const std::string& dependent : it->second) {
+            if (visited.insert(dependent).second) {
+                stack.push_back(dependent);
+            }
+        }
+    }
+    return targets;
+}
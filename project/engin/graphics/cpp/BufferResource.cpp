@@ -0,0 +1,30 @@
+#include "BufferResource.h"
+#include <cassert>
+
+D3D12_RESOURCE_DESC MakeBufferDesc(uint64_t sizeInBytes)
+{
+    // バッファの場合は高さなどを1にし、ROW_MAJORにする決まり
+    D3D12_RESOURCE_DESC resourceDesc {};
+    resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+    resourceDesc.Width = sizeInBytes;
+    resourceDesc.Height = 1;
+    resourceDesc.DepthOrArraySize = 1;
+    resourceDesc.MipLevels = 1;
+    resourceDesc.SampleDesc.Count = 1;
+    resourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+    return resourceDesc;
+}
+
+Microsoft::WRL::ComPtr<ID3D12Resource> CreateBufferResource(ID3D12Device* device, uint64_t sizeInBytes, D3D12_HEAP_TYPE heapType, D3D12_RESOURCE_STATES state)
+{
+    // ヒーププロパティの設定
+    D3D12_HEAP_PROPERTIES heapProperties {};
+    heapProperties.Type = heapType;
+    D3D12_RESOURCE_DESC resourceDesc = MakeBufferDesc(sizeInBytes);
+
+    // リソースの作成
+    Microsoft::WRL::ComPtr<ID3D12Resource> resource = nullptr;
+    HRESULT hr = device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &resourceDesc, state, nullptr, IID_PPV_ARGS(&resource));
+    assert(SUCCEEDED(hr));
+    return resource;
+}
@@ -0,0 +1,99 @@
+#include "CommandListSet.h"
+#include <cassert>
+
+D3D12CommandListSet::D3D12CommandListSet(ID3D12Device* device, ID3D12CommandQueue* commandQueue, uint32_t frameCount, ID3D12DescriptorHeap* shaderVisibleHeap,
+    ResourceStateRegistry& resourceStates)
+    : device_(device)
+    , commandQueue_(commandQueue)
+    , frameCount_(frameCount)
+    , shaderVisibleHeap_(shaderVisibleHeap)
+    , resourceStates_(resourceStates)
+{
+    lists_.push_back(std::make_unique<List>(resourceStates));
+}
+
+void D3D12CommandListSet::BeginFrame(uint32_t frameIndex, ID3D12GraphicsCommandList* head)
+{
+    assert(frameIndex < frameCount_);
+    frameIndex_ = frameIndex;
+    head_ = head;
+    lists_[0]->stateTracker.Begin(head);
+}
+
+void D3D12CommandListSet::CreateCommandList(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>& commandList,
+    std::vector<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>>& commandAllocators)
+{
+    commandAllocators.resize(frameCount_);
+    for (Microsoft::WRL::ComPtr<ID3D12CommandAllocator>& commandAllocator : commandAllocators) {
+        HRESULT hr = device_->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&commandAllocator));
+        assert(SUCCEEDED(hr));
+    }
+    HRESULT hr = device_->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, commandAllocators[0].Get(), nullptr, IID_PPV_ARGS(&commandList));
+    assert(SUCCEEDED(hr));
+    hr = commandList->Close();
+    assert(SUCCEEDED(hr));
+}
+
+void D3D12CommandListSet::Reserve(uint32_t listCount)
+{
+    // ワーカーが開く前にメインスレッドで作っておく
+    while (lists_.size() < listCount) {
+        std::unique_ptr<List> list = std::make_unique<List>(resourceStates_);
+        CreateCommandList(list->commandList, list->commandAllocators);
+        lists_.push_back(std::move(list));
+    }
+}
+
+void D3D12CommandListSet::Open(uint32_t list)
+{
+    assert(list > 0 && list < lists_.size());
+    ID3D12CommandAllocator* commandAllocator = lists_[list]->commandAllocators[frameIndex_].Get();
+    HRESULT hr = commandAllocator->Reset();
+    assert(SUCCEEDED(hr));
+    ID3D12GraphicsCommandList* commandList = lists_[list]->commandList.Get();
+    hr = commandList->Reset(commandAllocator, nullptr);
+    assert(SUCCEEDED(hr));
+    lists_[list]->stateTracker.Begin(commandList);
+    // ディスクリプタヒープはリストをまたいで引き継がれない
+    ID3D12DescriptorHeap* descriptorHeaps[] = { shaderVisibleHeap_ };
+    commandList->SetDescriptorHeaps(1, descriptorHeaps);
+}
+
+void D3D12CommandListSet::Close(uint32_t list)
+{
+    lists_[list]->stateTracker.End();
+    HRESULT hr = GetCommandList(list)->Close();
+    assert(SUCCEEDED(hr));
+}
+
+void D3D12CommandListSet::Submit(uint32_t listCount)
+{
+    // 提出する順に、前のリストまでの状態から最初の遷移を決める。要るときだけリストの前に遷移だけのリストを挟む
+    submitLists_.clear();
+    for (uint32_t index = 0; index < listCount; ++index) {
+        List& list = *lists_[index];
+        const std::vector<D3D12_RESOURCE_BARRIER>& resolved = list.stateTracker.ResolvePending();
+        if (!resolved.empty()) {
+            if (!list.fixupList) {
+                CreateCommandList(list.fixupList, list.fixupAllocators);
+            }
+            ID3D12CommandAllocator* commandAllocator = list.fixupAllocators[frameIndex_].Get();
+            HRESULT hr = commandAllocator->Reset();
+            assert(SUCCEEDED(hr));
+            hr = list.fixupList->Reset(commandAllocator, nullptr);
+            assert(SUCCEEDED(hr));
+            list.fixupList->ResourceBarrier(static_cast<UINT>(resolved.size()), resolved.data());
+            hr = list.fixupList->Close();
+            assert(SUCCEEDED(hr));
+            submitLists_.push_back(list.fixupList.Get());
+            ResourceStateStats fixupStats;
+            fixupStats.fixupLists = 1;
+            fixupStats.barrierCalls = 1;
+            resourceStates_.AddStats(fixupStats);
+        }
+        list.stateTracker.Commit();
+        submitLists_.push_back(GetCommandList(index));
+    }
+    commandQueue_->ExecuteCommandLists(static_cast<UINT>(submitLists_.size()), submitLists_.data());
+    resourceStates_.EndSubmit();
+}
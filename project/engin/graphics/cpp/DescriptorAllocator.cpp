@@ -0,0 +1,117 @@
+#include "DescriptorAllocator.h"
+#include <cassert>
+
+DescriptorAllocator::DescriptorAllocator(ID3D12Device* device, uint32_t persistentCount, uint32_t frameCount, uint32_t stagingCount)
+    : device_(device)
+    , descriptorSize_(device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV))
+    , indices_(persistentCount, frameCount, stagingCount)
+{
+    D3D12_DESCRIPTOR_HEAP_DESC heapDesc {};
+    heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+    heapDesc.NumDescriptors = persistentCount + frameCount;
+    heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+    HRESULT hr = device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&shaderVisibleHeap_));
+    assert(SUCCEEDED(hr));
+
+    // コピー元はシェーダーから見えないヒープでないと遅い
+    heapDesc.NumDescriptors = stagingCount;
+    heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+    hr = device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&stagingHeap_));
+    assert(SUCCEEDED(hr));
+
+    shaderVisibleCpuStart_ = shaderVisibleHeap_->GetCPUDescriptorHandleForHeapStart();
+    shaderVisibleGpuStart_ = shaderVisibleHeap_->GetGPUDescriptorHandleForHeapStart();
+    stagingCpuStart_ = stagingHeap_->GetCPUDescriptorHandleForHeapStart();
+}
+
+DescriptorRange DescriptorAllocator::AllocatePersistent(uint32_t count)
+{
+    DescriptorRange range;
+    const uint32_t index = indices_.AllocatePersistent(count);
+    if (index == kFreeListAllocationFailed) {
+        return range;
+    }
+    range.index = index;
+    range.count = count;
+    range.cpuHandle = GetShaderVisibleCpuHandle(index);
+    range.gpuHandle = GetShaderVisibleGpuHandle(index);
+    return range;
+}
+
+void DescriptorAllocator::FreePersistent(DescriptorRange& range)
+{
+    if (range.IsValid()) {
+        indices_.FreePersistent(range.index, range.count);
+        range = DescriptorRange {};
+    }
+}
+
+DescriptorRange DescriptorAllocator::AllocateStaging(uint32_t count)
+{
+    DescriptorRange range;
+    const uint32_t index = indices_.AllocateStaging(count);
+    if (index == kFreeListAllocationFailed) {
+        return range;
+    }
+    range.index = index;
+    range.count = count;
+    range.cpuHandle.ptr = stagingCpuStart_.ptr + static_cast<SIZE_T>(descriptorSize_) * index;
+    return range;
+}
+
+void DescriptorAllocator::FreeStaging(DescriptorRange& range)
+{
+    if (range.IsValid()) {
+        indices_.FreeStaging(range.index, range.count);
+        range = DescriptorRange {};
+    }
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE DescriptorAllocator::StageFrameTable(const D3D12_CPU_DESCRIPTOR_HANDLE* sources, uint32_t count)
+{
+    // コピー元はハンドルの値で渡す
+    stageSources_.clear();
+    for (uint32_t i = 0; i < count; ++i) {
+        stageSources_.push_back(sources[i].ptr);
+    }
+    return GetShaderVisibleGpuHandle(indices_.StageFrameTable(stageSources_.data(), count));
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE DescriptorAllocator::StageFrameDescriptor(D3D12_CPU_DESCRIPTOR_HANDLE source)
+{
+    return GetShaderVisibleGpuHandle(indices_.StageFrameDescriptor(source.ptr));
+}
+
+void DescriptorAllocator::FlushFrameCopies()
+{
+    const DescriptorCopyList& copies = indices_.GetPendingCopies();
+    if (copies.empty()) {
+        return;
+    }
+    copyDestinations_.clear();
+    for (uint32_t index : copies.destinations) {
+        copyDestinations_.push_back(GetShaderVisibleCpuHandle(index));
+    }
+    copySources_.clear();
+    for (uint64_t source : copies.sources) {
+        copySources_.push_back({ static_cast<SIZE_T>(source) });
+    }
+    // コピー元の大きさを省くとすべて1つずつとして扱われる
+    device_->CopyDescriptors(static_cast<UINT>(copyDestinations_.size()), copyDestinations_.data(), copies.destinationSizes.data(),
+        static_cast<UINT>(copySources_.size()), copySources_.data(), nullptr, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    indices_.ClearPendingCopies();
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE DescriptorAllocator::GetShaderVisibleCpuHandle(uint32_t index) const
+{
+    D3D12_CPU_DESCRIPTOR_HANDLE handle = shaderVisibleCpuStart_;
+    handle.ptr += static_cast<SIZE_T>(descriptorSize_) * index;
+    return handle;
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE DescriptorAllocator::GetShaderVisibleGpuHandle(uint32_t index) const
+{
+    D3D12_GPU_DESCRIPTOR_HANDLE handle = shaderVisibleGpuStart_;
+    handle.ptr += static_cast<UINT64>(descriptorSize_) * index;
+    return handle;
+}
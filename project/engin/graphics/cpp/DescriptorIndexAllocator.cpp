@@ -0,0 +1,75 @@
+#include "DescriptorIndexAllocator.h"
+#include <cassert>
+
+DescriptorIndexAllocator::DescriptorIndexAllocator(uint32_t persistentCount, uint32_t frameCount, uint32_t stagingCount)
+    : persistentCount_(persistentCount)
+    , persistent_(persistentCount)
+    , staging_(stagingCount)
+    , frameRing_(frameCount)
+{
+}
+
+uint32_t DescriptorIndexAllocator::StageFrameTable(const uint64_t* sources, uint32_t count)
+{
+    uint64_t offset = frameRing_.Allocate(count, 1);
+    // 空きが無ければ古いフレームから順にGPUを待って返してもらう
+    while (offset == kRingAllocationFailed && timeline_ && frameRing_.GetOldestFenceValue() != 0) {
+        timeline_->Wait(frameRing_.GetOldestFenceValue());
+        frameRing_.Reclaim(timeline_->GetCompletedValue());
+        ++stats_.overflowWaits;
+        offset = frameRing_.Allocate(count, 1);
+    }
+    // シェーダーから見えるヒープはフレームの途中で替えられないので、1フレームで使う分はリングに収まる大きさにしておく
+    assert(offset != kRingAllocationFailed);
+
+    const uint32_t index = persistentCount_ + static_cast<uint32_t>(offset);
+    pendingCopies_.destinations.push_back(index);
+    pendingCopies_.destinationSizes.push_back(count);
+    pendingCopies_.sources.insert(pendingCopies_.sources.end(), sources, sources + count);
+    frameCopied_ += count;
+    return index;
+}
+
+uint32_t DescriptorIndexAllocator::StageFrameDescriptor(uint64_t source)
+{
+    auto it = frameDescriptors_.find(source);
+    if (it != frameDescriptors_.end()) {
+        ++frameReused_;
+        return it->second;
+    }
+    const uint32_t index = StageFrameTable(&source, 1);
+    frameDescriptors_.emplace(source, index);
+    return index;
+}
+
+void DescriptorIndexAllocator::ClearPendingCopies()
+{
+    if (pendingCopies_.empty()) {
+        return;
+    }
+    ++stats_.copyCalls;
+    pendingCopies_.destinations.clear();
+    pendingCopies_.destinationSizes.clear();
+    pendingCopies_.sources.clear();
+}
+
+void DescriptorIndexAllocator::FinishFrame(uint64_t fenceValue)
+{
+    // 写し忘れたままGPUに渡していないか
+    assert(pendingCopies_.empty());
+    frameRing_.FinishFrame(fenceValue);
+    frameDescriptors_.clear();
+    stats_.copiedDescriptors = frameCopied_;
+    stats_.reusedDescriptors = frameReused_;
+    frameCopied_ = 0;
+    frameReused_ = 0;
+}
+
+DescriptorAllocatorStats DescriptorIndexAllocator::GetStats() const
+{
+    DescriptorAllocatorStats stats = stats_;
+    stats.persistent = persistent_.GetStats();
+    stats.staging = staging_.GetStats();
+    stats.frame = frameRing_.GetStats();
+    return stats;
+}
@@ -0,0 +1,131 @@
+#include "FrameContext.h"
+#include "BufferResource.h"
+#include "DescriptorAllocator.h"
+#include <Windows.h>
+#include <cassert>
+
+D3D12FenceTimeline::D3D12FenceTimeline(ID3D12Device* device, ID3D12CommandQueue* commandQueue)
+    : commandQueue_(commandQueue)
+{
+    HRESULT hr = device->CreateFence(fenceValue_, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence_));
+    assert(SUCCEEDED(hr));
+    fenceEvent_ = CreateEvent(NULL, FALSE, FALSE, NULL);
+    assert(fenceEvent_ != nullptr);
+}
+
+D3D12FenceTimeline::~D3D12FenceTimeline()
+{
+    if (fenceEvent_ != nullptr) {
+        CloseHandle(fenceEvent_);
+    }
+}
+
+uint64_t D3D12FenceTimeline::Signal()
+{
+    // GPUがここまでたどり着いたら、Fenceの値をfenceValue_にする
+    HRESULT hr = commandQueue_->Signal(fence_.Get(), ++fenceValue_);
+    assert(SUCCEEDED(hr));
+    return fenceValue_;
+}
+
+uint64_t D3D12FenceTimeline::GetCompletedValue()
+{
+    return fence_->GetCompletedValue();
+}
+
+void D3D12FenceTimeline::Wait(uint64_t value)
+{
+    if (fence_->GetCompletedValue() >= value) {
+        return;
+    }
+    fence_->SetEventOnCompletion(value, fenceEvent_);
+    WaitForSingleObject(fenceEvent_, INFINITE);
+}
+
+FrameContextRing::FrameContextRing(ID3D12Device* device, ID3D12CommandQueue* commandQueue, uint32_t frameCount, uint64_t uploadRingBytes)
+    : device_(device)
+    , timeline_(device, commandQueue)
+    , frames_(frameCount)
+    , uploadRing_(uploadRingBytes)
+    , pacer_(timeline_, frameCount)
+{
+    for (Frame& frame : frames_) {
+        HRESULT hr = device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&frame.commandAllocator));
+        assert(SUCCEEDED(hr));
+    }
+
+    // アップロードリングはずっとMapしたまま使う
+    uploadBuffer_ = CreateBufferResource(device, uploadRingBytes);
+    uploadBuffer_->Map(0, nullptr, reinterpret_cast<void**>(&uploadData_));
+}
+
+uint32_t FrameContextRing::BeginFrame(ID3D12GraphicsCommandList* commandList)
+{
+    // このフレームのアロケータを前に使ったフレームが終わるまで待ち、終わったフレームが使っていた分を返す
+    const uint32_t frameIndex = pacer_.BeginFrame();
+    const uint64_t completedValue = timeline_.GetCompletedValue();
+    uploadRing_.Reclaim(completedValue);
+    if (descriptors_) {
+        descriptors_->Reclaim(completedValue);
+    }
+
+    Frame& frame = frames_[frameIndex];
+    HRESULT hr = frame.commandAllocator->Reset();
+    assert(SUCCEEDED(hr));
+    hr = commandList->Reset(frame.commandAllocator.Get(), nullptr);
+    assert(SUCCEEDED(hr));
+    return frameIndex;
+}
+
+void FrameContextRing::EndFrame()
+{
+    const uint64_t fenceValue = pacer_.EndFrame();
+    uploadRing_.FinishFrame(fenceValue);
+    if (descriptors_) {
+        descriptors_->FinishFrame(fenceValue);
+    }
+}
+
+void FrameContextRing::AttachDescriptorAllocator(DescriptorAllocator* descriptors)
+{
+    descriptors_ = descriptors;
+    descriptors_->SetTimeline(&timeline_);
+}
+
+FrameUpload FrameContextRing::AllocateUpload(uint64_t sizeInBytes, uint64_t alignment)
+{
+    uint64_t offset = uploadRing_.Allocate(sizeInBytes, alignment);
+    // 空きが無ければ古いフレームから順にGPUを待って返してもらう
+    while (offset == kRingAllocationFailed && uploadRing_.GetOldestFenceValue() != 0) {
+        timeline_.Wait(uploadRing_.GetOldestFenceValue());
+        uploadRing_.Reclaim(timeline_.GetCompletedValue());
+        ++uploadStats_.overflowWaits;
+        offset = uploadRing_.Allocate(sizeInBytes, alignment);
+    }
+
+    FrameUpload upload;
+    if (offset != kRingAllocationFailed) {
+        upload.resource = uploadBuffer_.Get();
+        upload.offset = offset;
+        upload.cpuAddress = uploadData_ + offset;
+        upload.gpuAddress = uploadBuffer_->GetGPUVirtualAddress() + offset;
+        return upload;
+    }
+
+    // このフレームだけでリングに入りきらないので、専用のバッファを作ってフレームが終わったら捨てる
+    Microsoft::WRL::ComPtr<ID3D12Resource> overflowBuffer = CreateBufferResource(device_, sizeInBytes);
+    overflowBuffer->Map(0, nullptr, &upload.cpuAddress);
+    upload.resource = overflowBuffer.Get();
+    upload.gpuAddress = overflowBuffer->GetGPUVirtualAddress();
+    pacer_.DeferRelease([overflowBuffer] {});
+    ++uploadStats_.overflowBuffers;
+    uploadStats_.overflowBytes += sizeInBytes;
+    return upload;
+}
+
+FrameUploadStats FrameContextRing::GetUploadStats() const
+{
+    FrameUploadStats stats = uploadStats_;
+    stats.ring = uploadRing_.GetStats();
+    return stats;
+}
@@ -0,0 +1,380 @@
+#include "GpakArchive.h"
+#include "GpakCodec.h"
+#include "Hash.h"
+#include "TextureCache.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+uint32_t Read32(const uint8_t* p)
+{
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+bool ReadLooseFile(const std::string& filePath, std::vector<uint8_t>& bytes)
+{
+    std::ifstream file(filePath, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return false;
+    }
+    bytes.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+    return file.good();
+}
+
+uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+GpakArchive::~GpakArchive()
+{
+    Close();
+}
+
+bool GpakArchive::Open(const std::string& archivePath)
+{
+    Close();
+#ifdef _WIN32
+    HANDLE file = CreateFileW(std::filesystem::path(archivePath).wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    fileHandle_ = file;
+
+    LARGE_INTEGER size {};
+    if (!GetFileSizeEx(file, &size) || static_cast<uint64_t>(size.QuadPart) < sizeof(GpakHeader)) {
+        Close();
+        return false;
+    }
+    mappingHandle_ = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingHandle_ == nullptr) {
+        Close();
+        return false;
+    }
+    base_ = static_cast<const uint8_t*>(MapViewOfFile(mappingHandle_, FILE_MAP_READ, 0, 0, 0));
+    if (base_ == nullptr) {
+        Close();
+        return false;
+    }
+    mappedSize_ = static_cast<uint64_t>(size.QuadPart);
+#else
+    // マップした後はファイルを閉じてもよい
+    int file = open(archivePath.c_str(), O_RDONLY);
+    if (file < 0) {
+        return false;
+    }
+    struct stat status {};
+    if (fstat(file, &status) != 0 || static_cast<uint64_t>(status.st_size) < sizeof(GpakHeader)) {
+        close(file);
+        return false;
+    }
+    void* mapped = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+    base_ = static_cast<const uint8_t*>(mapped);
+    mappedSize_ = static_cast<uint64_t>(status.st_size);
+#endif
+
+    // 壊れたファイルや古い形式は開かない
+    const GpakHeader* header = reinterpret_cast<const GpakHeader*>(base_);
+    const bool valid = header->magic == kGpakMagic && header->version == kGpakVersion && header->fileSize == mappedSize_
+        && header->bucketCount != 0 && (header->bucketCount & (header->bucketCount - 1)) == 0
+        && header->directoryOffset + uint64_t(header->bucketCount) * sizeof(GpakEntry) <= mappedSize_
+        && header->namesOffset + header->namesSize <= mappedSize_;
+    if (!valid) {
+        Close();
+        return false;
+    }
+    header_ = header;
+    buckets_ = reinterpret_cast<const GpakEntry*>(base_ + header->directoryOffset);
+    return true;
+}
+
+void GpakArchive::Close()
+{
+#ifdef _WIN32
+    if (base_ != nullptr) {
+        UnmapViewOfFile(base_);
+    }
+    if (mappingHandle_ != nullptr) {
+        CloseHandle(mappingHandle_);
+    }
+    if (fileHandle_ != nullptr) {
+        CloseHandle(fileHandle_);
+    }
+#else
+    if (base_ != nullptr) {
+        munmap(const_cast<uint8_t*>(base_), static_cast<size_t>(mappedSize_));
+    }
+#endif
+    base_ = nullptr;
+    mappedSize_ = 0;
+    header_ = nullptr;
+    buckets_ = nullptr;
+    fileHandle_ = nullptr;
+    mappingHandle_ = nullptr;
+}
+
+const GpakEntry* GpakArchive::Find(const std::string& path) const
+{
+    if (header_ == nullptr) {
+        return nullptr;
+    }
+    const std::string normalizedPath = TextureCache::NormalizePath(path);
+    const uint64_t hash = HashBytes(normalizedPath.data(), normalizedPath.size());
+    const uint32_t mask = header_->bucketCount - 1;
+    // 空きバケツに当たるまで線形探査する(表は半分以上空けてある)
+    for (uint32_t i = static_cast<uint32_t>(hash) & mask, probes = 0; probes < header_->bucketCount; i = (i + 1) & mask, ++probes) {
+        const GpakEntry& entry = buckets_[i];
+        if ((entry.flags & GpakEntry_Used) == 0) {
+            return nullptr;
+        }
+        if (entry.pathHash == hash && entry.nameLength == normalizedPath.size()
+            && uint64_t(entry.nameOffset) + entry.nameLength <= header_->namesSize
+            && std::memcmp(base_ + header_->namesOffset + entry.nameOffset, normalizedPath.data(), entry.nameLength) == 0) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+bool GpakArchive::Read(const std::string& path, AssetBytes& bytes) const
+{
+    const GpakEntry* entry = Find(path);
+    return entry != nullptr && Read(*entry, bytes);
+}
+
+bool GpakArchive::Read(const GpakEntry& entry, AssetBytes& bytes) const
+{
+    if (entry.storedSize > mappedSize_ || entry.offset > mappedSize_ - entry.storedSize) {
+        return false;
+    }
+    const uint8_t* stored = base_ + entry.offset;
+    if ((entry.flags & GpakEntry_Compressed) == 0) {
+        // 無圧縮なら中身はstoredSizeぶんしか無い。食い違うディレクトリは壊れている
+        if (entry.size != entry.storedSize) {
+            return false;
+        }
+        bytes.storage.clear();
+        bytes.data = stored;
+        bytes.size = static_cast<size_t>(entry.size);
+        return true;
+    }
+
+    const uint64_t tableSize = uint64_t(entry.blockCount) * sizeof(uint32_t);
+    if (tableSize > entry.storedSize || (entry.size + kGpakBlockSize - 1) / kGpakBlockSize != entry.blockCount) {
+        return false;
+    }
+    bytes.storage.resize(static_cast<size_t>(entry.size));
+    const uint8_t* block = stored + tableSize;
+    const uint8_t* storedEnd = stored + entry.storedSize;
+    for (uint32_t i = 0; i < entry.blockCount; ++i) {
+        const uint32_t blockSize = Read32(stored + i * sizeof(uint32_t));
+        const size_t rawSize = static_cast<size_t>(std::min<uint64_t>(kGpakBlockSize, entry.size - uint64_t(i) * kGpakBlockSize));
+        uint8_t* destination = bytes.storage.data() + size_t(i) * kGpakBlockSize;
+        if (blockSize > size_t(storedEnd - block)) {
+            return false;
+        }
+        // 縮まなかったブロックはそのまま入っている
+        if (blockSize == rawSize) {
+            std::memcpy(destination, block, rawSize);
+        } else if (!GpakDecompressBlock(block, blockSize, destination, rawSize)) {
+            return false;
+        }
+        block += blockSize;
+    }
+    bytes.data = bytes.storage.data();
+    bytes.size = bytes.storage.size();
+    return true;
+}
+
+std::string GpakArchive::GetName(const GpakEntry& entry) const
+{
+    return std::string(reinterpret_cast<const char*>(base_ + header_->namesOffset + entry.nameOffset), entry.nameLength);
+}
+
+std::vector<const GpakEntry*> GpakArchive::GetEntries() const
+{
+    std::vector<const GpakEntry*> entries;
+    for (uint32_t i = 0; header_ != nullptr && i < header_->bucketCount; ++i) {
+        if (buckets_[i].flags & GpakEntry_Used) {
+            entries.push_back(&buckets_[i]);
+        }
+    }
+    return entries;
+}
+
+bool ReadAssetBytes(const GpakArchive* archive, const std::string& filePath, AssetBytes& bytes)
+{
+    if (archive != nullptr && archive->Read(filePath, bytes)) {
+        return true;
+    }
+    if (!ReadLooseFile(filePath, bytes.storage)) {
+        return false;
+    }
+    bytes.data = bytes.storage.data();
+    bytes.size = bytes.storage.size();
+    return true;
+}
+
+void GpakWriter::AddFile(const std::string& sourcePath, const std::string& archivePath, bool compress)
+{
+    sources_.push_back({ sourcePath, TextureCache::NormalizePath(archivePath), compress });
+}
+
+bool GpakWriter::Write(const std::string& outputPath, ThreadPool& threadPool, GpakPackStats& stats)
+{
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+    // ファイルごとにアーカイブ内の形へ変換する
+    struct Packed {
+        std::vector<uint8_t> payload;
+        uint64_t size = 0;
+        uint32_t flags = GpakEntry_Used;
+        uint32_t blockCount = 0;
+        bool opened = false;
+    };
+    std::vector<Packed> packed(sources_.size());
+    threadPool.ParallelFor(static_cast<uint32_t>(sources_.size()), 1, [&](uint32_t first, uint32_t last) {
+        for (uint32_t i = first; i < last; ++i) {
+            std::vector<uint8_t> source;
+            packed[i].opened = ReadLooseFile(sources_[i].sourcePath, source);
+            if (!packed[i].opened) {
+                continue;
+            }
+            packed[i].size = source.size();
+            if (!sources_[i].compress || source.empty()) {
+                packed[i].payload = std::move(source);
+                continue;
+            }
+
+            const uint32_t blockCount = static_cast<uint32_t>((source.size() + kGpakBlockSize - 1) / kGpakBlockSize);
+            std::vector<uint8_t> payload(size_t(blockCount) * sizeof(uint32_t));
+            std::vector<uint8_t> compressed;
+            for (uint32_t block = 0; block < blockCount; ++block) {
+                const size_t offset = size_t(block) * kGpakBlockSize;
+                const size_t rawSize = std::min<size_t>(kGpakBlockSize, source.size() - offset);
+                uint32_t storedSize = static_cast<uint32_t>(rawSize);
+                if (GpakCompressBlock(source.data() + offset, rawSize, compressed)) {
+                    storedSize = static_cast<uint32_t>(compressed.size());
+                    payload.insert(payload.end(), compressed.begin(), compressed.end());
+                } else {
+                    payload.insert(payload.end(), source.begin() + offset, source.begin() + offset + rawSize);
+                }
+                std::memcpy(payload.data() + block * sizeof(uint32_t), &storedSize, sizeof(storedSize));
+            }
+            // 全体で縮まなければ無圧縮で入れる(そのほうがゼロコピーで読める)
+            if (payload.size() < source.size()) {
+                packed[i].payload = std::move(payload);
+                packed[i].flags |= GpakEntry_Compressed;
+                packed[i].blockCount = blockCount;
+            } else {
+                packed[i].payload = std::move(source);
+            }
+        }
+    });
+    for (const Packed& result : packed) {
+        if (!result.opened) {
+            return false;
+        }
+    }
+
+    GpakHeader header;
+    header.entryCount = static_cast<uint32_t>(sources_.size());
+    header.bucketCount = 16;
+    while (header.bucketCount < header.entryCount * 2) {
+        header.bucketCount *= 2;
+    }
+
+    std::string names;
+    std::vector<GpakEntry> buckets(header.bucketCount);
+    std::vector<uint32_t> bucketOfSource(sources_.size());
+    for (size_t i = 0; i < sources_.size(); ++i) {
+        const std::string& name = sources_[i].archivePath;
+        GpakEntry entry;
+        entry.pathHash = HashBytes(name.data(), name.size());
+        entry.size = packed[i].size;
+        entry.storedSize = packed[i].payload.size();
+        entry.nameOffset = static_cast<uint32_t>(names.size());
+        entry.nameLength = static_cast<uint32_t>(name.size());
+        entry.flags = packed[i].flags;
+        entry.blockCount = packed[i].blockCount;
+        names += name;
+
+        uint32_t bucket = static_cast<uint32_t>(entry.pathHash) & (header.bucketCount - 1);
+        while (buckets[bucket].flags & GpakEntry_Used) {
+            assert(buckets[bucket].pathHash != entry.pathHash || buckets[bucket].nameLength != entry.nameLength
+                || names.compare(buckets[bucket].nameOffset, entry.nameLength, name) != 0);
+            bucket = (bucket + 1) & (header.bucketCount - 1);
+        }
+        buckets[bucket] = entry;
+        bucketOfSource[i] = bucket;
+    }
+
+    // 本体はページ境界にそろえて置く
+    header.directoryOffset = sizeof(GpakHeader);
+    header.namesOffset = header.directoryOffset + buckets.size() * sizeof(GpakEntry);
+    header.namesSize = names.size();
+    uint64_t offset = AlignUp(header.namesOffset + header.namesSize, kGpakAlignment);
+    for (size_t i = 0; i < sources_.size(); ++i) {
+        buckets[bucketOfSource[i]].offset = offset;
+        offset = AlignUp(offset + packed[i].payload.size(), kGpakAlignment);
+    }
+    header.fileSize = offset;
+
+    std::ofstream file(outputPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(buckets.data()), buckets.size() * sizeof(GpakEntry));
+    file.write(names.data(), names.size());
+
+    stats = GpakPackStats();
+    const std::vector<char> padding(kGpakAlignment, 0);
+    uint64_t written = header.namesOffset + header.namesSize;
+    for (size_t i = 0; i < sources_.size(); ++i) {
+        const GpakEntry& entry = buckets[bucketOfSource[i]];
+        file.write(padding.data(), entry.offset - written);
+        file.write(reinterpret_cast<const char*>(packed[i].payload.data()), packed[i].payload.size());
+        written = entry.offset + packed[i].payload.size();
+
+        ++stats.files;
+        stats.compressedFiles += (entry.flags & GpakEntry_Compressed) ? 1 : 0;
+        stats.sourceBytes += entry.size;
+    }
+    file.write(padding.data(), header.fileSize - written);
+    file.close();
+    // 途中で書けなくなったら切れたアーカイブを残さない
+    if (file.fail()) {
+        std::error_code error;
+        std::filesystem::remove(outputPath, error);
+        return false;
+    }
+
+    stats.archiveBytes = header.fileSize;
+    stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    return true;
+}
@@ -0,0 +1,145 @@
+#include "GpakCodec.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr uint32_t kMinMatch = 4;
+constexpr uint32_t kHashBits = 12;
+constexpr uint32_t kMaxOffset = 65535;
+
+uint32_t Read32(const uint8_t* p)
+{
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+uint32_t HashSequence(uint32_t value)
+{
+    return (value * 2654435761u) >> (32 - kHashBits);
+}
+
+// 15以上の長さは255の連続と残りで表す
+void WriteLength(std::vector<uint8_t>& out, size_t length)
+{
+    while (length >= 255) {
+        out.push_back(255);
+        length -= 255;
+    }
+    out.push_back(static_cast<uint8_t>(length));
+}
+
+bool ReadLength(const uint8_t*& ip, const uint8_t* end, size_t& length)
+{
+    uint8_t byte = 0;
+    do {
+        if (ip >= end) {
+            return false;
+        }
+        byte = *ip++;
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+void WriteSequence(std::vector<uint8_t>& out, const uint8_t* literals, size_t literalLength, uint32_t offset, size_t matchLength)
+{
+    const size_t matchCode = matchLength != 0 ? matchLength - kMinMatch : 0;
+    out.push_back(static_cast<uint8_t>((std::min<size_t>(literalLength, 15) << 4) | std::min<size_t>(matchCode, 15)));
+    if (literalLength >= 15) {
+        WriteLength(out, literalLength - 15);
+    }
+    out.insert(out.end(), literals, literals + literalLength);
+    if (matchLength == 0) {
+        return;
+    }
+    out.push_back(static_cast<uint8_t>(offset & 0xFF));
+    out.push_back(static_cast<uint8_t>(offset >> 8));
+    if (matchCode >= 15) {
+        WriteLength(out, matchCode - 15);
+    }
+}
+
+} // namespace
+
+bool GpakCompressBlock(const uint8_t* source, size_t sourceSize, std::vector<uint8_t>& destination)
+{
+    destination.clear();
+    std::vector<int32_t> table(size_t(1) << kHashBits, -1);
+    size_t anchor = 0;
+    size_t i = 0;
+    while (i + kMinMatch <= sourceSize) {
+        const uint32_t sequence = Read32(source + i);
+        const uint32_t hash = HashSequence(sequence);
+        const int32_t candidate = table[hash];
+        table[hash] = static_cast<int32_t>(i);
+        if (candidate < 0 || i - candidate > kMaxOffset || Read32(source + candidate) != sequence) {
+            ++i;
+            continue;
+        }
+
+        size_t matchLength = kMinMatch;
+        while (i + matchLength < sourceSize && source[candidate + matchLength] == source[i + matchLength]) {
+            ++matchLength;
+        }
+        WriteSequence(destination, source + anchor, i - anchor, static_cast<uint32_t>(i - candidate), matchLength);
+        i += matchLength;
+        anchor = i;
+        if (destination.size() >= sourceSize) {
+            return false;
+        }
+    }
+    // 最後は一致なしのリテラルだけで終わる
+    WriteSequence(destination, source + anchor, sourceSize - anchor, 0, 0);
+    return destination.size() < sourceSize;
+}
+
+bool GpakDecompressBlock(const uint8_t* source, size_t sourceSize, uint8_t* destination, size_t destinationSize)
+{
+    const uint8_t* ip = source;
+    const uint8_t* const ipEnd = source + sourceSize;
+    uint8_t* op = destination;
+    uint8_t* const opEnd = destination + destinationSize;
+    while (ip < ipEnd) {
+        const uint8_t token = *ip++;
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !ReadLength(ip, ipEnd, literalLength)) {
+            return false;
+        }
+        if (literalLength > size_t(ipEnd - ip) || literalLength > size_t(opEnd - op)) {
+            return false;
+        }
+        std::memcpy(op, ip, literalLength);
+        ip += literalLength;
+        op += literalLength;
+        if (ip == ipEnd) {
+            break;
+        }
+
+        if (ipEnd - ip < 2) {
+            return false;
+        }
+        const size_t offset = size_t(ip[0]) | (size_t(ip[1]) << 8);
+        ip += 2;
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !ReadLength(ip, ipEnd, matchLength)) {
+            return false;
+        }
+        matchLength += kMinMatch;
+        if (offset == 0 || offset > size_t(op - destination) || matchLength > size_t(opEnd - op)) {
+            return false;
+        }
+        // 重なるときは、写したばかりのバイトを読むので1バイトずつ写す
+        const uint8_t* match = op - offset;
+        if (offset >= matchLength) {
+            std::memcpy(op, match, matchLength);
+        } else {
+            for (size_t n = 0; n < matchLength; ++n) {
+                op[n] = match[n];
+            }
+        }
+        op += matchLength;
+    }
+    return op == opEnd;
+}
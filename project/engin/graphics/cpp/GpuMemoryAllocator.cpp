@@ -0,0 +1,295 @@
+#include "GpuMemoryAllocator.h"
+#include "BufferResource.h"
+#include <algorithm>
+#include <cassert>
+
+namespace {
+
+// ヒープの中はこれより細かく切らない(小さいテクスチャのアラインメント)
+constexpr uint64_t kHeapGranularity = D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+
+const char* GetHeapTypeName(D3D12_HEAP_TYPE heapType)
+{
+    switch (heapType) {
+    case D3D12_HEAP_TYPE_DEFAULT:
+        return "DEFAULT";
+    case D3D12_HEAP_TYPE_UPLOAD:
+        return "UPLOAD";
+    case D3D12_HEAP_TYPE_READBACK:
+        return "READBACK";
+    default:
+        return "CUSTOM";
+    }
+}
+
+const char* GetResourceClassName(GpuResourceClass resourceClass)
+{
+    switch (resourceClass) {
+    case GpuResourceClass::Buffer:
+        return "Buffer";
+    case GpuResourceClass::Texture:
+        return "Texture";
+    default:
+        return "RT/DS";
+    }
+}
+
+} // namespace
+
+GpuResourceClass ClassifyGpuResource(const D3D12_RESOURCE_DESC& resourceDesc)
+{
+    if (resourceDesc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER) {
+        return GpuResourceClass::Buffer;
+    }
+    if (resourceDesc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) {
+        return GpuResourceClass::RenderTarget;
+    }
+    return GpuResourceClass::Texture;
+}
+
+D3D12_HEAP_FLAGS GetGpuResourceHeapFlags(GpuResourceClass resourceClass)
+{
+    switch (resourceClass) {
+    case GpuResourceClass::Buffer:
+        return D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+    case GpuResourceClass::Texture:
+        return D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+    default:
+        return D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+    }
+}
+
+GpuMemoryAllocator::Heap::Heap(uint64_t heapBytes)
+    : allocator(heapBytes, kHeapGranularity)
+{
+}
+
+void GpuMemoryAllocator::Initialize(ID3D12Device* device, uint64_t heapBytes)
+{
+    assert(heapBytes % D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT == 0);
+    device_ = device;
+    heapBytes_ = heapBytes;
+}
+
+GpuAllocation GpuMemoryAllocator::CreateResource(const D3D12_HEAP_PROPERTIES& heapProperties, const D3D12_RESOURCE_DESC& resourceDesc,
+    D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* clearValue)
+{
+    const GpuResourceClass resourceClass = ClassifyGpuResource(resourceDesc);
+    D3D12_RESOURCE_DESC desc = resourceDesc;
+
+    // 小さいテクスチャは4KBで置けるか聞き、駄目なら既定の64KBにする(バッファとRT/DSは常に64KB以上)
+    D3D12_RESOURCE_ALLOCATION_INFO allocationInfo {};
+    if (resourceClass == GpuResourceClass::Texture && desc.SampleDesc.Count == 1) {
+        desc.Alignment = D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+        allocationInfo = device_->GetResourceAllocationInfo(0, 1, &desc);
+    }
+    if (allocationInfo.Alignment != D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT) {
+        desc.Alignment = 0;
+        allocationInfo = device_->GetResourceAllocationInfo(0, 1, &desc);
+    }
+
+    // 大きすぎるものと、ヒープより大きなアラインメントが要るもの(MSAA)は単独で作る
+    if (allocationInfo.SizeInBytes > heapBytes_ / 2 || allocationInfo.Alignment > D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT) {
+        GpuAllocation allocation;
+        HRESULT hr = device_->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &desc, initialState, clearValue, IID_PPV_ARGS(&allocation.resource));
+        assert(SUCCEEDED(hr));
+        allocation.range.size = allocationInfo.SizeInBytes;
+        ++committedResources_;
+        committedBytes_ += allocationInfo.SizeInBytes;
+        return allocation;
+    }
+
+    // 入るヒープを前から探し、どこにも入らなければヒープを足す
+    const uint32_t poolIndex = FindPool(heapProperties, resourceClass);
+    Pool& pool = pools_[poolIndex];
+    for (uint32_t heapIndex = 0; heapIndex < pool.heaps.size(); ++heapIndex) {
+        if (!pool.heaps[heapIndex]) {
+            continue;
+        }
+        TlsfAllocation range = pool.heaps[heapIndex]->allocator.Allocate(allocationInfo.SizeInBytes, allocationInfo.Alignment);
+        if (range.IsValid()) {
+            return CreatePlaced(poolIndex, heapIndex, range, desc, initialState, clearValue);
+        }
+    }
+    const uint32_t heapIndex = AddHeap(pool);
+    TlsfAllocation range = pool.heaps[heapIndex]->allocator.Allocate(allocationInfo.SizeInBytes, allocationInfo.Alignment);
+    assert(range.IsValid());
+    return CreatePlaced(poolIndex, heapIndex, range, desc, initialState, clearValue);
+}
+
+GpuAllocation GpuMemoryAllocator::CreateBuffer(uint64_t sizeInBytes, D3D12_HEAP_TYPE heapType, D3D12_RESOURCE_STATES initialState)
+{
+    D3D12_HEAP_PROPERTIES heapProperties {};
+    heapProperties.Type = heapType;
+    return CreateResource(heapProperties, MakeBufferDesc(sizeInBytes), initialState);
+}
+
+void GpuMemoryAllocator::Free(GpuAllocation& allocation)
+{
+    if (!allocation.resource) {
+        return;
+    }
+    if (!allocation.IsPlaced()) {
+        --committedResources_;
+        committedBytes_ -= allocation.range.size;
+        allocation = GpuAllocation {};
+        return;
+    }
+
+    Pool& pool = pools_[allocation.pool];
+    Heap& heap = *pool.heaps[allocation.heap];
+    ForgetPlacement(heap, allocation.range.block);
+    heap.allocator.Free(allocation.range);
+
+    // 空になったヒープは、ほかにもヒープがあれば返す(1つは次に使うために残す)
+    if (heap.allocator.IsEmpty()) {
+        const auto heapCount = std::count_if(pool.heaps.begin(), pool.heaps.end(), [](const std::unique_ptr<Heap>& h) { return h != nullptr; });
+        if (heapCount > 1) {
+            pool.heaps[allocation.heap].reset();
+        }
+    }
+    allocation = GpuAllocation {};
+}
+
+uint32_t GpuMemoryAllocator::Defragment(uint32_t maxMoves, const MoveFunc& move)
+{
+    uint32_t moves = 0;
+    for (uint32_t poolIndex = 0; poolIndex < pools_.size(); ++poolIndex) {
+        for (uint32_t heapIndex = 0; heapIndex < pools_[poolIndex].heaps.size() && moves < maxMoves; ++heapIndex) {
+            Heap* heap = pools_[poolIndex].heaps[heapIndex].get();
+            if (!heap) {
+                continue;
+            }
+            // 同じヒープの中で前へ詰める
+            moves += heap->allocator.Defragment(maxMoves - moves, [&](const TlsfAllocation& from, const TlsfAllocation& to) {
+                // CreatePlacedでplacementsが伸びることがあるので写しておく
+                const Placement placement = heap->placements[from.block];
+                GpuAllocation source;
+                source.resource = placement.resource;
+                source.pool = poolIndex;
+                source.heap = heapIndex;
+                source.range = from;
+
+                GpuAllocation target = CreatePlaced(poolIndex, heapIndex, to, placement.resource->GetDesc(), placement.initialState,
+                    placement.hasClearValue ? &placement.clearValue : nullptr);
+                if (move(source, target)) {
+                    return true;
+                }
+                // 移さなかったら作ったものを捨てる(範囲はTLSFが返す)
+                ForgetPlacement(*heap, to.block);
+                return false;
+            });
+        }
+    }
+    defragmentMoves_ += moves;
+    return moves;
+}
+
+GpuMemoryStats GpuMemoryAllocator::GetStats() const
+{
+    GpuMemoryStats stats;
+    stats.placedResources = placedResources_;
+    stats.smallTextures = smallTextures_;
+    stats.committedResources = committedResources_;
+    stats.committedBytes = committedBytes_;
+    stats.defragmentMoves = defragmentMoves_;
+
+    for (const Pool& pool : pools_) {
+        GpuMemoryPoolStats poolStats;
+        poolStats.name = std::string(GetHeapTypeName(pool.heapProperties.Type)) + " " + GetResourceClassName(pool.resourceClass);
+        for (const std::unique_ptr<Heap>& heap : pool.heaps) {
+            if (!heap) {
+                continue;
+            }
+            const TlsfAllocatorStats heapStats = heap->allocator.GetStats();
+            ++poolStats.heapCount;
+            poolStats.heaps.capacity += heapStats.capacity;
+            poolStats.heaps.usedBytes += heapStats.usedBytes;
+            poolStats.heaps.freeBytes += heapStats.freeBytes;
+            poolStats.heaps.allocationCount += heapStats.allocationCount;
+            poolStats.heaps.freeBlockCount += heapStats.freeBlockCount;
+            poolStats.heaps.largestFreeBlock = std::max(poolStats.heaps.largestFreeBlock, heapStats.largestFreeBlock);
+            poolStats.heaps.fragmentation = std::max(poolStats.heaps.fragmentation, heapStats.fragmentation);
+        }
+        if (poolStats.heaps.capacity > 0) {
+            poolStats.heaps.occupancy = static_cast<float>(static_cast<double>(poolStats.heaps.usedBytes) / static_cast<double>(poolStats.heaps.capacity));
+        }
+        stats.heapCount += poolStats.heapCount;
+        stats.heapBytes += poolStats.heaps.capacity;
+        stats.usedBytes += poolStats.heaps.usedBytes;
+        stats.pools.push_back(std::move(poolStats));
+    }
+    return stats;
+}
+
+uint32_t GpuMemoryAllocator::FindPool(const D3D12_HEAP_PROPERTIES& heapProperties, GpuResourceClass resourceClass)
+{
+    for (uint32_t i = 0; i < pools_.size(); ++i) {
+        const D3D12_HEAP_PROPERTIES& properties = pools_[i].heapProperties;
+        if (pools_[i].resourceClass == resourceClass && properties.Type == heapProperties.Type
+            && properties.CPUPageProperty == heapProperties.CPUPageProperty && properties.MemoryPoolPreference == heapProperties.MemoryPoolPreference) {
+            return i;
+        }
+    }
+    Pool pool;
+    pool.heapProperties = heapProperties;
+    pool.resourceClass = resourceClass;
+    pools_.push_back(std::move(pool));
+    return static_cast<uint32_t>(pools_.size() - 1);
+}
+
+uint32_t GpuMemoryAllocator::AddHeap(Pool& pool)
+{
+    auto heap = std::make_unique<Heap>(heapBytes_);
+    D3D12_HEAP_DESC heapDesc {};
+    heapDesc.SizeInBytes = heapBytes_;
+    heapDesc.Properties = pool.heapProperties;
+    heapDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+    heapDesc.Flags = GetGpuResourceHeapFlags(pool.resourceClass);
+    HRESULT hr = device_->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap->heap));
+    assert(SUCCEEDED(hr));
+
+    // 返したヒープの番号があればそこを使う
+    for (uint32_t i = 0; i < pool.heaps.size(); ++i) {
+        if (!pool.heaps[i]) {
+            pool.heaps[i] = std::move(heap);
+            return i;
+        }
+    }
+    pool.heaps.push_back(std::move(heap));
+    return static_cast<uint32_t>(pool.heaps.size() - 1);
+}
+
+GpuAllocation GpuMemoryAllocator::CreatePlaced(uint32_t poolIndex, uint32_t heapIndex, const TlsfAllocation& range, const D3D12_RESOURCE_DESC& resourceDesc,
+    D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* clearValue)
+{
+    Heap& heap = *pools_[poolIndex].heaps[heapIndex];
+    GpuAllocation allocation;
+    HRESULT hr = device_->CreatePlacedResource(heap.heap.Get(), range.offset, &resourceDesc, initialState, clearValue, IID_PPV_ARGS(&allocation.resource));
+    assert(SUCCEEDED(hr));
+    allocation.pool = poolIndex;
+    allocation.heap = heapIndex;
+    allocation.range = range;
+
+    if (heap.placements.size() <= range.block) {
+        heap.placements.resize(range.block + 1);
+    }
+    Placement& placement = heap.placements[range.block];
+    placement.resource = allocation.resource.Get();
+    placement.initialState = initialState;
+    placement.hasClearValue = clearValue != nullptr;
+    if (clearValue) {
+        placement.clearValue = *clearValue;
+    }
+    placement.smallTexture = resourceDesc.Alignment == D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+    ++placedResources_;
+    smallTextures_ += placement.smallTexture ? 1 : 0;
+    return allocation;
+}
+
+void GpuMemoryAllocator::ForgetPlacement(Heap& heap, uint32_t block)
+{
+    --placedResources_;
+    smallTextures_ -= heap.placements[block].smallTexture ? 1 : 0;
+    heap.placements[block] = Placement {};
+}
@@ -0,0 +1,93 @@
+#include "MaterialTable.h"
+#include "FrameContext.h"
+#include "ResourceStateTracker.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+void MaterialTable::Initialize(GpuMemoryAllocator& gpuMemory, ResourceStateRegistry& resourceStates, uint32_t capacity)
+{
+    const uint64_t sizeInBytes = uint64_t(capacity) * sizeof(Material);
+    // バッファはCOMMONから暗黙に昇格し、ExecuteCommandListsの後にCOMMONへ戻る
+    buffer_ = gpuMemory.CreateBuffer(sizeInBytes, D3D12_HEAP_TYPE_DEFAULT, D3D12_RESOURCE_STATE_COMMON);
+    resourceStates.Register(buffer_.resource.Get(), D3D12_RESOURCE_STATE_COMMON, true);
+
+    materials_.reserve(capacity);
+    dirty_.assign(capacity, 0);
+    stats_.capacity = capacity;
+}
+
+MaterialId MaterialTable::Add(const Material& material)
+{
+    assert(materials_.size() < stats_.capacity);
+    MaterialId id = static_cast<MaterialId>(materials_.size());
+    materials_.push_back(material);
+    ++stats_.materialCount;
+    MarkDirty(id);
+    return id;
+}
+
+void MaterialTable::Set(MaterialId id, const Material& material)
+{
+    assert(id < materials_.size());
+    if (std::memcmp(&materials_[id], &material, sizeof(Material)) == 0) {
+        return;
+    }
+    materials_[id] = material;
+    MarkDirty(id);
+}
+
+void MaterialTable::MarkDirty(MaterialId id)
+{
+    if (dirty_[id]) {
+        return;
+    }
+    dirty_[id] = 1;
+    if (dirtyCount_++ == 0) {
+        dirtyBegin_ = id;
+        dirtyEnd_ = id + 1;
+    } else {
+        dirtyBegin_ = std::min(dirtyBegin_, id);
+        dirtyEnd_ = std::max(dirtyEnd_, id + 1);
+    }
+}
+
+void MaterialTable::Upload(ResourceStateTracker& tracker, FrameContextRing& frameContexts)
+{
+    stats_.uploadedMaterials = 0;
+    stats_.copyCommands = 0;
+    if (dirtyCount_ == 0) {
+        return;
+    }
+
+    // 前のフレームの提出でCOMMONに戻っていれば昇格で済む
+    tracker.Transition(buffer_.resource.Get(), D3D12_RESOURCE_STATE_COPY_DEST);
+    tracker.Flush();
+    ID3D12GraphicsCommandList* commandList = tracker.GetCommandList();
+
+    // 変更された範囲をまとめて切り出し、連続して変更されたものを1回のコピーにまとめる
+    const FrameUpload upload = frameContexts.AllocateUpload(uint64_t(dirtyEnd_ - dirtyBegin_) * sizeof(Material), alignof(Material));
+    Material* uploadData = static_cast<Material*>(upload.cpuAddress);
+    for (uint32_t begin = dirtyBegin_; begin < dirtyEnd_;) {
+        if (!dirty_[begin]) {
+            ++begin;
+            continue;
+        }
+        uint32_t end = begin;
+        while (end < dirtyEnd_ && dirty_[end]) {
+            dirty_[end++] = 0;
+        }
+        const uint64_t offset = uint64_t(begin) * sizeof(Material);
+        const uint64_t size = uint64_t(end - begin) * sizeof(Material);
+        std::memcpy(uploadData + (begin - dirtyBegin_), &materials_[begin], size);
+        commandList->CopyBufferRegion(buffer_.resource.Get(), offset, upload.resource, upload.offset + uint64_t(begin - dirtyBegin_) * sizeof(Material), size);
+
+        stats_.uploadedMaterials += end - begin;
+        ++stats_.copyCommands;
+        stats_.totalUploadedBytes += size;
+        begin = end;
+    }
+    dirtyCount_ = 0;
+
+    tracker.Transition(buffer_.resource.Get(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+}
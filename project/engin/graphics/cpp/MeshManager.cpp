@@ -1,4 +1,5 @@
 #include "MeshManager.h"
+#include "MeshStreamer.h"
 #include <cmath>
 
 namespace {
@@ -6,21 +7,21 @@ namespace {
 MeshData GenerateSphereMesh(int subdivision = 16, float radius = 1.0f)
 {
     MeshData mesh;
-    // Transform
+    // 初期Transform
     mesh.transform = { { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f } };
 
-    // ̒_
+    // 球体頂点生成
     const float kPi = 3.14159265358979323846f;
     const float kTwoPi = kPi * 2.0f;
 
     for (int lat = 0; lat < subdivision; ++lat) {
-        float lat0 = kPi * (float(lat) / subdivision - 0.5f); // -/2 ` +/2
+        float lat0 = kPi * (float(lat) / subdivision - 0.5f); // -π/2 ～ +π/2
         float lat1 = kPi * (float(lat + 1) / subdivision - 0.5f);
         for (int lon = 0; lon < subdivision; ++lon) {
             float lon0 = kTwoPi * float(lon) / subdivision;
             float lon1 = kTwoPi * float(lon + 1) / subdivision;
 
-            // 4_̋ʍW
+            // 4点の球面座標
             Vector4 p00 = { radius * cosf(lat0) * cosf(lon0), radius * sinf(lat0), radius * cosf(lat0) * sinf(lon0), 1.0f };
             Vector4 p01 = { radius * cosf(lat0) * cosf(lon1), radius * sinf(lat0), radius * cosf(lat0) * sinf(lon1), 1.0f };
             Vector4 p10 = { radius * cosf(lat1) * cosf(lon0), radius * sinf(lat1), radius * cosf(lat1) * sinf(lon0), 1.0f };
@@ -31,7 +32,7 @@ MeshData GenerateSphereMesh(int subdivision = 16, float radius = 1.0f)
             Vector2 uv10 = { float(lon) / subdivision, 1.0f - float(lat + 1) / subdivision };
             Vector2 uv11 = { float(lon + 1) / subdivision, 1.0f - float(lat + 1) / subdivision };
 
-            // 2Op`
+            // 2三角形
             mesh.vertices.push_back({ p00, uv00, { p00.x, p00.y, p00.z } });
             mesh.vertices.push_back({ p10, uv10, { p10.x, p10.y, p10.z } });
             mesh.vertices.push_back({ p11, uv11, { p11.x, p11.y, p11.z } });
@@ -50,7 +51,7 @@ MeshData GenerateCubeMesh(float size = 1.0f)
     mesh.transform = { { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f } };
 
     const float s = size * 0.5f;
-    // _f[^Fe2Op`E6
+    // 頂点データ：各面2三角形・6面
     struct Face {
         Vector4 p0, p1, p2, p3;
         Vector2 uv0, uv1, uv2, uv3;
@@ -58,21 +59,21 @@ MeshData GenerateCubeMesh(float size = 1.0f)
     };
     Face faces[6] = {
         // +X
-        { { s, -s, -s, 1 }, { s, -s, s, 1 }, { s, s, s, 1 }, { s, s, -s, 1 }, { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } }, { 1, 0, 0 } },
+        { { s, -s, -s, 1 }, { s, -s, s, 1 }, { s, s, s, 1 }, { s, s, -s, 1 }, { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 }, { 1, 0, 0 } },
         // -X
-        { { -s, -s, s, 1 }, { -s, -s, -s, 1 }, { -s, s, -s, 1 }, { -s, s, s, 1 }, { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } }, { -1, 0, 0 } },
+        { { -s, -s, s, 1 }, { -s, -s, -s, 1 }, { -s, s, -s, 1 }, { -s, s, s, 1 }, { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 }, { -1, 0, 0 } },
         // +Y
-        { { -s, s, s, 1 }, { s, s, s, 1 }, { s, s, -s, 1 }, { -s, s, -s, 1 }, { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } }, { 0, 1, 0 } },
+        { { -s, s, s, 1 }, { s, s, s, 1 }, { s, s, -s, 1 }, { -s, s, -s, 1 }, { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 }, { 0, 1, 0 } },
         // -Y
-        { { -s, -s, -s, 1 }, { s, -s, -s, 1 }, { s, -s, s, 1 }, { -s, -s, s, 1 }, { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } }, { 0, -1, 0 } },
+        { { -s, -s, -s, 1 }, { s, -s, -s, 1 }, { s, -s, s, 1 }, { -s, -s, s, 1 }, { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 }, { 0, -1, 0 } },
         // +Z
-        { { -s, -s, s, 1 }, { s, -s, s, 1 }, { s, s, s, 1 }, { -s, s, s, 1 }, { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } }, { 0, 0, 1 } },
+        { { -s, -s, s, 1 }, { s, -s, s, 1 }, { s, s, s, 1 }, { -s, s, s, 1 }, { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 }, { 0, 0, 1 } },
         // -Z
-        { { s, -s, -s, 1 }, { -s, -s, -s, 1 }, { -s, s, -s, 1 }, { s, s, -s, 1 }, { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } }, { 0, 0, -1 } },
+        { { s, -s, -s, 1 }, { -s, -s, -s, 1 }, { -s, s, -s, 1 }, { s, s, -s, 1 }, { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 }, { 0, 0, -1 } },
     };
 
     for (const auto& f : faces) {
-        // 2Op`
+        // 2三角形
         mesh.vertices.push_back({ f.p0, f.uv0, f.normal });
         mesh.vertices.push_back({ f.p1, f.uv1, f.normal });
         mesh.vertices.push_back({ f.p2, f.uv2, f.normal });
@@ -101,7 +102,7 @@ MeshData GeneratePlaneMesh(float width = 1.0f, float height = 1.0f)
     Vector2 uv3 = { 0, 1 };
     Vector3 normal = { 0, 1, 0 };
 
-    // 2Op`
+    // 2三角形
     mesh.vertices.push_back({ p0, uv0, normal });
     mesh.vertices.push_back({ p1, uv1, normal });
     mesh.vertices.push_back({ p2, uv2, normal });
@@ -123,11 +124,42 @@ MeshManager::MeshManager()
 void MeshManager::SetCurrentMeshType(MeshType type) { currentMeshType_ = type; }
 MeshType MeshManager::GetCurrentMeshType() const { return currentMeshType_; }
 MeshData& MeshManager::GetCurrentMesh() { return meshes[(int)currentMeshType_]; }
+void MeshManager::AttachStreamer(MeshStreamer* streamer) { streamer_ = streamer; }
+
+void MeshManager::RequestMesh(const std::string& filePath, MeshType target, bool fromDisk)
+{
+    if (streamer_ == nullptr) {
+        return;
+    }
+    streamer_->Request(filePath, target, fromDisk);
+}
+
+uint32_t MeshManager::Update()
+{
+    if (streamer_ == nullptr) {
+        return 0;
+    }
+
+    uint32_t swapped = 0;
+    while (std::unique_ptr<StreamedMesh> streamed = streamer_->PopCompleted()) {
+        if (!streamed->succeeded || streamed->target >= MeshType_Count) {
+            continue;
+        }
+        // 頂点だけを入れ替え、Transformは今の値を引き継ぐ
+        MeshData& mesh = meshes[(int)streamed->target];
+        mesh.vertices = std::move(streamed->mesh.vertices);
+        ++mesh.version;
+        ++swapped;
+    }
+    return swapped;
+}
 
 void MeshManager::InitMeshes()
 {
     meshes.clear();
-    meshes.push_back(GenerateSphereMesh());
+    meshes.push_back(GenerateSphereMesh(32));
     meshes.push_back(GenerateCubeMesh());
     meshes.push_back(GeneratePlaneMesh());
+    // モデルは読み込みが終わるまで立方体で代用する
+    meshes.push_back(GenerateCubeMesh());
 }
\ No newline at end of file
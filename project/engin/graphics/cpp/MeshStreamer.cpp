@@ -0,0 +1,258 @@
+#include "MeshStreamer.h"
+#include "GpakArchive.h"
+#include "ThreadPool.h"
+#include <charconv>
+#include <cmath>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+// "v/vt/vn" の形式を分解する(省略された要素は0)。数字として読めなければfalse
+// ワーカースレッドで例外を投げると止まってしまうので、std::stoiではなくfrom_charsで読む
+bool ParseFaceVertex(const std::string& token, int& position, int& texcoord, int& normal)
+{
+    position = 0;
+    texcoord = 0;
+    normal = 0;
+    int* targets[3] = { &position, &texcoord, &normal };
+    size_t start = 0;
+    for (int i = 0; i < 3 && start <= token.size(); ++i) {
+        size_t end = token.find('/', start);
+        const char* first = token.data() + start;
+        const char* last = token.data() + (end == std::string::npos ? token.size() : end);
+        if (first != last) {
+            std::from_chars_result parsed = std::from_chars(first, last, *targets[i]);
+            if (parsed.ec != std::errc() || parsed.ptr != last) {
+                return false;
+            }
+        }
+        if (end == std::string::npos) {
+            break;
+        }
+        start = end + 1;
+    }
+    // 位置は省略できない
+    return position != 0;
+}
+
+// 負のインデックスは末尾からの相対指定
+int ResolveIndex(int index, size_t count)
+{
+    if (index < 0) {
+        return static_cast<int>(count) + index;
+    }
+    return index - 1;
+}
+
+bool IsDegenerate(const VertexData& v0, const VertexData& v1, const VertexData& v2)
+{
+    float e1x = v1.position.x - v0.position.x;
+    float e1y = v1.position.y - v0.position.y;
+    float e1z = v1.position.z - v0.position.z;
+    float e2x = v2.position.x - v0.position.x;
+    float e2y = v2.position.y - v0.position.y;
+    float e2z = v2.position.z - v0.position.z;
+    float cx = e1y * e2z - e1z * e2y;
+    float cy = e1z * e2x - e1x * e2z;
+    float cz = e1x * e2y - e1y * e2x;
+    return (cx * cx + cy * cy + cz * cz) < 1.0e-12f;
+}
+
+// 法線が無い三角形には面法線を入れる
+void ApplyFaceNormal(VertexData& v0, VertexData& v1, VertexData& v2)
+{
+    Vector3 e1 = { v1.position.x - v0.position.x, v1.position.y - v0.position.y, v1.position.z - v0.position.z };
+    Vector3 e2 = { v2.position.x - v0.position.x, v2.position.y - v0.position.y, v2.position.z - v0.position.z };
+    Vector3 n = { e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x };
+    float length = std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+    if (length > 0.0f) {
+        n = { n.x / length, n.y / length, n.z / length };
+    }
+    v0.normal = n;
+    v1.normal = n;
+    v2.normal = n;
+}
+
+// OBJファイルを三角形リストに展開する
+bool LoadObjFile(const GpakArchive* archive, const std::string& filePath, MeshData& mesh, uint64_t& fileBytes)
+{
+    AssetBytes bytes;
+    if (!ReadAssetBytes(archive, filePath, bytes)) {
+        return false;
+    }
+    std::string source(reinterpret_cast<const char*>(bytes.data), bytes.size);
+    fileBytes = source.size();
+
+    std::vector<Vector4> positions;
+    std::vector<Vector2> texcoords;
+    std::vector<Vector3> normals;
+
+    std::istringstream lines(source);
+    std::string line;
+    while (std::getline(lines, line)) {
+        std::istringstream s(line);
+        std::string identifier;
+        s >> identifier;
+
+        if (identifier == "v") {
+            Vector4 position { 0.0f, 0.0f, 0.0f, 1.0f };
+            s >> position.x >> position.y >> position.z;
+            // 右手系から左手系へ
+            position.x *= -1.0f;
+            positions.push_back(position);
+        } else if (identifier == "vt") {
+            Vector2 texcoord {};
+            s >> texcoord.x >> texcoord.y;
+            texcoord.y = 1.0f - texcoord.y;
+            texcoords.push_back(texcoord);
+        } else if (identifier == "vn") {
+            Vector3 normal {};
+            s >> normal.x >> normal.y >> normal.z;
+            normal.x *= -1.0f;
+            normals.push_back(normal);
+        } else if (identifier == "f") {
+            std::vector<VertexData> polygon;
+            bool hasNormal = true;
+            std::string token;
+            while (s >> token) {
+                int p = 0;
+                int t = 0;
+                int n = 0;
+                if (!ParseFaceVertex(token, p, t, n)) {
+                    return false;
+                }
+                int pi = ResolveIndex(p, positions.size());
+                if (pi < 0 || pi >= static_cast<int>(positions.size())) {
+                    return false;
+                }
+                VertexData vertex {};
+                vertex.position = positions[pi];
+                if (t != 0) {
+                    int ti = ResolveIndex(t, texcoords.size());
+                    if (ti >= 0 && ti < static_cast<int>(texcoords.size())) {
+                        vertex.texcoord = texcoords[ti];
+                    }
+                }
+                int ni = n != 0 ? ResolveIndex(n, normals.size()) : -1;
+                if (ni >= 0 && ni < static_cast<int>(normals.size())) {
+                    vertex.normal = normals[ni];
+                } else {
+                    hasNormal = false;
+                }
+                polygon.push_back(vertex);
+            }
+
+            // 多角形は扇状に三角形へ分割し、左手系に合わせて巻き順を反転する
+            for (size_t i = 1; i + 1 < polygon.size(); ++i) {
+                VertexData v0 = polygon[0];
+                VertexData v1 = polygon[i + 1];
+                VertexData v2 = polygon[i];
+                // 面積0の三角形は捨てる
+                if (IsDegenerate(v0, v1, v2)) {
+                    continue;
+                }
+                if (!hasNormal) {
+                    ApplyFaceNormal(v0, v1, v2);
+                }
+                mesh.vertices.push_back(v0);
+                mesh.vertices.push_back(v1);
+                mesh.vertices.push_back(v2);
+            }
+        }
+    }
+
+    mesh.vertices.shrink_to_fit();
+    return !mesh.vertices.empty();
+}
+
+double ElapsedMilliseconds(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to)
+{
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+} // namespace
+
+MeshStreamer::MeshStreamer(ThreadPool& threadPool)
+    : threadPool_(threadPool)
+{
+}
+
+MeshStreamer::~MeshStreamer()
+{
+    // ワーカーがキューに触れている間に破棄しないように待つ
+    while (pending_.load(std::memory_order_acquire) != 0) {
+        completed_.TryPop();
+        std::this_thread::yield();
+    }
+}
+
+uint32_t MeshStreamer::Request(const std::string& filePath, MeshType target, bool fromDisk)
+{
+    uint32_t requestId = nextRequestId_.fetch_add(1, std::memory_order_relaxed);
+    pending_.fetch_add(1, std::memory_order_acq_rel);
+    {
+        std::lock_guard<std::mutex> lock(statsMutex_);
+        ++stats_.requested;
+    }
+
+    auto request = std::make_shared<StreamedMesh>();
+    request->requestId = requestId;
+    request->target = target;
+    request->filePath = filePath;
+    request->fromDisk = fromDisk;
+    request->requestTime = std::chrono::steady_clock::now();
+
+    threadPool_.Enqueue([this, request] {
+        auto result = std::make_unique<StreamedMesh>(std::move(*request));
+        Decode(*result);
+
+        // キューが満杯ならメインスレッドが取り出すまで譲る
+        while (!completed_.TryPush(result)) {
+            std::this_thread::yield();
+        }
+        pending_.fetch_sub(1, std::memory_order_acq_rel);
+    });
+    return requestId;
+}
+
+std::unique_ptr<StreamedMesh> MeshStreamer::PopCompleted()
+{
+    std::optional<std::unique_ptr<StreamedMesh>> popped = completed_.TryPop();
+    if (!popped) {
+        return nullptr;
+    }
+    std::unique_ptr<StreamedMesh> result = std::move(*popped);
+
+    double latency = ElapsedMilliseconds(result->requestTime, std::chrono::steady_clock::now());
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    if (result->succeeded) {
+        ++stats_.completed;
+    } else {
+        ++stats_.failed;
+    }
+    stats_.totalLatencyMilliseconds += latency;
+    if (latency > stats_.maxLatencyMilliseconds) {
+        stats_.maxLatencyMilliseconds = latency;
+    }
+    return result;
+}
+
+MeshStreamerStats MeshStreamer::GetStats()
+{
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    return stats_;
+}
+
+void MeshStreamer::Decode(StreamedMesh& result)
+{
+    auto start = std::chrono::steady_clock::now();
+    uint64_t fileBytes = 0;
+    result.mesh.transform = { { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f } };
+    result.succeeded = LoadObjFile(result.fromDisk ? nullptr : archive_, result.filePath, result.mesh, fileBytes);
+    result.decodeMilliseconds = ElapsedMilliseconds(start, std::chrono::steady_clock::now());
+
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    stats_.decodedBytes += fileBytes;
+    stats_.totalDecodeMilliseconds += result.decodeMilliseconds;
+}
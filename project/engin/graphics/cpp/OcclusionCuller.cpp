@@ -0,0 +1,525 @@
+#include "OcclusionCuller.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define OCCLUSION_CULLER_SSE2
+#endif
+
+namespace {
+
+// 1チャンクの最小数(小さすぎるとスレッドの受け渡しの方が高くつく)
+constexpr uint32_t kMinTrianglesPerChunk = 256;
+constexpr uint32_t kMinBoundsPerChunk = 256;
+
+// 行ベクトル形式で (x, y, z, 1) * m
+void TransformPoint(const Matrix4x4& m, float x, float y, float z, float* clip)
+{
+#ifdef OCCLUSION_CULLER_SSE2
+    __m128 result = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(x), _mm_loadu_ps(m.m[0])), _mm_mul_ps(_mm_set1_ps(y), _mm_loadu_ps(m.m[1]))),
+        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(z), _mm_loadu_ps(m.m[2])), _mm_loadu_ps(m.m[3])));
+    _mm_storeu_ps(clip, result);
+#else
+    for (int c = 0; c < 4; ++c) {
+        clip[c] = x * m.m[0][c] + y * m.m[1][c] + z * m.m[2][c] + m.m[3][c];
+    }
+#endif
+}
+
+// clipをplane(内積が0以上が内側)で切った多角形をoutputに書き、頂点の数を返す
+// 辺の交点は内側の頂点から求めるので、隣の三角形と共有する辺はどちらからでも同じ点で切れる
+uint32_t ClipPolygon(const float (*input)[4], uint32_t count, const float* plane, float (*output)[4])
+{
+    uint32_t outputCount = 0;
+    for (uint32_t k = 0; k < count; ++k) {
+        const float* a = input[k];
+        const float* b = input[(k + 1) % count];
+        float distanceA = a[0] * plane[0] + a[1] * plane[1] + a[2] * plane[2] + a[3] * plane[3];
+        float distanceB = b[0] * plane[0] + b[1] * plane[1] + b[2] * plane[2] + b[3] * plane[3];
+        if (distanceA >= 0.0f) {
+            std::copy(a, a + 4, output[outputCount++]);
+        }
+        if ((distanceA >= 0.0f) != (distanceB >= 0.0f)) {
+            const float* inside = distanceA >= 0.0f ? a : b;
+            const float* outside = distanceA >= 0.0f ? b : a;
+            float insideDistance = distanceA >= 0.0f ? distanceA : distanceB;
+            float outsideDistance = distanceA >= 0.0f ? distanceB : distanceA;
+            float t = insideDistance / (insideDistance - outsideDistance);
+            for (int c = 0; c < 4; ++c) {
+                output[outputCount][c] = inside[c] + (outside[c] - inside[c]) * t;
+            }
+            ++outputCount;
+        }
+    }
+    return outputCount;
+}
+
+// ピクセルの座標を一番近い固定小数点の値にする
+int32_t Snap(float pixels)
+{
+    return static_cast<int32_t>(std::lrint(pixels * float(1 << OcclusionCuller::kSubpixelBits)));
+}
+
+} // namespace
+
+OcclusionCuller::OcclusionCuller(ThreadPool* threadPool, uint32_t width, uint32_t height)
+    : threadPool_(threadPool)
+    , width_(width)
+    , height_(height)
+{
+    assert(width % kTileWidth == 0 && height % kTileHeight == 0);
+    assert(width <= uint32_t(kGuardBandPixels) * 2 && height <= uint32_t(kGuardBandPixels) * 2);
+    tilesX_ = width / kTileWidth;
+    tilesY_ = height / kTileHeight;
+    guardBandX_ = float(kGuardBandPixels) / (float(width) * 0.5f);
+    guardBandY_ = float(kGuardBandPixels) / (float(height) * 0.5f);
+
+    // 1x1になるまで半分ずつにする(奇数のときは切り上げ、端の1列は1つだけから作る)
+    uint32_t levelWidth = width;
+    uint32_t levelHeight = height;
+    while (true) {
+        Level& level = levels_.emplace_back();
+        level.width = levelWidth;
+        level.height = levelHeight;
+        level.depth.assign(size_t(levelWidth) * levelHeight, 1.0f);
+        if (levelWidth == 1 && levelHeight == 1) {
+            break;
+        }
+        levelWidth = std::max(1u, (levelWidth + 1) / 2);
+        levelHeight = std::max(1u, (levelHeight + 1) / 2);
+    }
+}
+
+uint32_t OcclusionCuller::GetMaxThreadCount() const
+{
+    return threadPool_ ? threadPool_->GetThreadCount() + 1 : 1;
+}
+
+uint32_t OcclusionCuller::ResolveThreadCount() const
+{
+    return std::clamp(threadCount_ == 0 ? GetMaxThreadCount() : threadCount_, 1u, GetMaxThreadCount());
+}
+
+void OcclusionCuller::BeginFrame(const Matrix4x4& viewProjection)
+{
+    viewProjection_ = viewProjection;
+    occluders_.clear();
+    triangleCount_ = 0;
+    stats_ = {};
+}
+
+void OcclusionCuller::AddOccluder(const void* positions, uint32_t strideInBytes, uint32_t vertexCount, const Matrix4x4& world)
+{
+    assert(vertexCount % 3 == 0);
+    Occluder occluder;
+    occluder.positions = static_cast<const uint8_t*>(positions);
+    occluder.stride = strideInBytes;
+    occluder.triangleCount = vertexCount / 3;
+    occluder.firstTriangle = triangleCount_;
+    occluder.worldViewProjection = Multiply(world, viewProjection_);
+    occluders_.push_back(occluder);
+    triangleCount_ += occluder.triangleCount;
+    ++stats_.occluders;
+}
+
+void OcclusionCuller::Rasterize()
+{
+    auto start = std::chrono::steady_clock::now();
+    const uint32_t threadCount = ResolveThreadCount();
+    const bool parallel = threadPool_ != nullptr && threadCount > 1;
+
+    // 三角形を変換してタイルに振り分ける。チャンクの番号の順に並べれば、足した順のまま描ける
+    uint32_t grainSize = std::max(kMinTrianglesPerChunk, (triangleCount_ + threadCount - 1) / threadCount);
+    chunkCount_ = (triangleCount_ + grainSize - 1) / grainSize;
+    if (chunks_.size() < chunkCount_) {
+        chunks_.resize(chunkCount_);
+    }
+    for (uint32_t chunk = 0; chunk < chunkCount_; ++chunk) {
+        chunks_[chunk].triangles.clear();
+        chunks_[chunk].bins.resize(size_t(tilesX_) * tilesY_);
+        for (std::vector<uint32_t>& bin : chunks_[chunk].bins) {
+            bin.clear();
+        }
+    }
+    auto setupRange = [&](uint32_t begin, uint32_t end) { SetupTriangles(begin, end, chunks_[begin / grainSize]); };
+    if (parallel) {
+        threadPool_->ParallelFor(triangleCount_, grainSize, setupRange);
+    } else if (triangleCount_ > 0) {
+        setupRange(0, triangleCount_);
+    }
+
+    // タイルは重ならないので、それぞれ別のスレッドで描ける
+    const uint32_t tileCount = tilesX_ * tilesY_;
+    if (parallel) {
+        threadPool_->ParallelFor(tileCount, 1, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t tile = begin; tile < end; ++tile) {
+                RasterizeTile(tile);
+            }
+        });
+    } else {
+        for (uint32_t tile = 0; tile < tileCount; ++tile) {
+            RasterizeTile(tile);
+        }
+    }
+
+    stats_.occluderTriangles = triangleCount_;
+    for (uint32_t chunk = 0; chunk < chunkCount_; ++chunk) {
+        stats_.rasterizedTriangles += static_cast<uint32_t>(chunks_[chunk].triangles.size());
+    }
+    stats_.threadCount = threadCount;
+    auto rasterEnd = std::chrono::steady_clock::now();
+    stats_.rasterMilliseconds = std::chrono::duration<double, std::milli>(rasterEnd - start).count();
+
+    BuildHiZ();
+    stats_.hizMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - rasterEnd).count();
+}
+
+void OcclusionCuller::SetupTriangles(uint32_t begin, uint32_t end, SetupChunk& chunk) const
+{
+    // 近クリップ面(z >= 0)とガードバンドの左右上下(内積が0以上が内側)。outsideのビットはこの順
+    constexpr uint32_t kClipPlaneCount = 5;
+    const float planes[kClipPlaneCount][4] = {
+        { 0.0f, 0.0f, 1.0f, 0.0f },
+        { 1.0f, 0.0f, 0.0f, guardBandX_ },
+        { -1.0f, 0.0f, 0.0f, guardBandX_ },
+        { 0.0f, 1.0f, 0.0f, guardBandY_ },
+        { 0.0f, -1.0f, 0.0f, guardBandY_ },
+    };
+
+    // beginを含むオクルーダーから始める
+    auto occluder = std::upper_bound(occluders_.begin(), occluders_.end(), begin,
+                        [](uint32_t triangle, const Occluder& o) { return triangle < o.firstTriangle; })
+        - 1;
+    for (uint32_t triangle = begin; triangle < end; ++triangle) {
+        while (triangle >= occluder->firstTriangle + occluder->triangleCount) {
+            ++occluder;
+        }
+        const uint8_t* vertices = occluder->positions + size_t(triangle - occluder->firstTriangle) * 3 * occluder->stride;
+        float clip[3][4];
+        uint32_t outside[3] = {};
+        for (int k = 0; k < 3; ++k) {
+            const float* position = reinterpret_cast<const float*>(vertices + size_t(k) * occluder->stride);
+            TransformPoint(occluder->worldViewProjection, position[0], position[1], position[2], clip[k]);
+            const float guardX = guardBandX_ * clip[k][3];
+            const float guardY = guardBandY_ * clip[k][3];
+            outside[k] = (clip[k][2] < 0.0f ? 1u : 0u) | (clip[k][0] + guardX < 0.0f ? 2u : 0u) | (guardX - clip[k][0] < 0.0f ? 4u : 0u)
+                | (clip[k][1] + guardY < 0.0f ? 8u : 0u) | (guardY - clip[k][1] < 0.0f ? 16u : 0u);
+        }
+
+        // 3頂点とも同じ面の外なら描かない。どれも中なら切らずにそのまま描く
+        if ((outside[0] & outside[1] & outside[2]) != 0) {
+            continue;
+        }
+        const uint32_t crossing = outside[0] | outside[1] | outside[2];
+        if (crossing == 0) {
+            BinTriangle(clip, chunk);
+            continue;
+        }
+
+        // またいだ面で順に切り、残った多角形を扇に分ける
+        float polygons[2][3 + kClipPlaneCount][4];
+        uint32_t polygonCount = 3;
+        uint32_t current = 0;
+        std::copy(&clip[0][0], &clip[0][0] + 12, &polygons[0][0][0]);
+        for (uint32_t plane = 0; plane < kClipPlaneCount && polygonCount >= 3; ++plane) {
+            if (crossing & (1u << plane)) {
+                polygonCount = ClipPolygon(polygons[current], polygonCount, planes[plane], polygons[current ^ 1]);
+                current ^= 1;
+            }
+        }
+        const float (*polygon)[4] = polygons[current];
+        for (uint32_t k = 1; k + 1 < polygonCount; ++k) {
+            float fan[3][4];
+            std::copy(polygon[0], polygon[0] + 4, fan[0]);
+            std::copy(polygon[k], polygon[k] + 4, fan[1]);
+            std::copy(polygon[k + 1], polygon[k + 1] + 4, fan[2]);
+            BinTriangle(fan, chunk);
+        }
+    }
+}
+
+void OcclusionCuller::BinTriangle(const float (*clip)[4], SetupChunk& chunk) const
+{
+    ScreenTriangle screen;
+    float z[3];
+    for (int k = 0; k < 3; ++k) {
+        float inverseW = 1.0f / clip[k][3];
+        screen.x[k] = Snap((clip[k][0] * inverseW * 0.5f + 0.5f) * float(width_));
+        screen.y[k] = Snap((0.5f - clip[k][1] * inverseW * 0.5f) * float(height_));
+        z[k] = clip[k][2] * inverseW;
+    }
+
+    // yが下向きの画面で時計回りなら正になる。裏と(丸めて)潰れたものは描かない
+    const int64_t area = int64_t(screen.x[1] - screen.x[0]) * (screen.y[2] - screen.y[0]) - int64_t(screen.y[1] - screen.y[0]) * (screen.x[2] - screen.x[0]);
+    if (area <= 0 || std::min({ z[0], z[1], z[2] }) > 1.0f) {
+        return;
+    }
+
+    // 中心(i + 0.5)が外接矩形に入る画素
+    constexpr int32_t kOne = 1 << kSubpixelBits;
+    constexpr int32_t kHalf = kOne / 2;
+    screen.minX = std::max(0, (std::min({ screen.x[0], screen.x[1], screen.x[2] }) - kHalf + kOne - 1) >> kSubpixelBits);
+    screen.minY = std::max(0, (std::min({ screen.y[0], screen.y[1], screen.y[2] }) - kHalf + kOne - 1) >> kSubpixelBits);
+    screen.maxX = std::min(int32_t(width_) - 1, (std::max({ screen.x[0], screen.x[1], screen.x[2] }) - kHalf) >> kSubpixelBits);
+    screen.maxY = std::min(int32_t(height_) - 1, (std::max({ screen.y[0], screen.y[1], screen.y[2] }) - kHalf) >> kSubpixelBits);
+    if (screen.minX > screen.maxX || screen.minY > screen.maxY) {
+        return;
+    }
+
+    // 深度の平面は丸めた頂点から求める
+    float x[3];
+    float y[3];
+    for (int k = 0; k < 3; ++k) {
+        x[k] = float(screen.x[k]) / float(kOne);
+        y[k] = float(screen.y[k]) / float(kOne);
+    }
+    const float pixelArea = float(area) / float(kOne * kOne);
+    screen.dzdx = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / pixelArea;
+    screen.dzdy = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) / pixelArea;
+    screen.zAtOrigin = z[0] - screen.dzdx * x[0] - screen.dzdy * y[0];
+
+    uint32_t index = static_cast<uint32_t>(chunk.triangles.size());
+    chunk.triangles.push_back(screen);
+    for (uint32_t tileY = uint32_t(screen.minY) / kTileHeight; tileY <= uint32_t(screen.maxY) / kTileHeight; ++tileY) {
+        for (uint32_t tileX = uint32_t(screen.minX) / kTileWidth; tileX <= uint32_t(screen.maxX) / kTileWidth; ++tileX) {
+            chunk.bins[tileY * tilesX_ + tileX].push_back(index);
+        }
+    }
+}
+
+void OcclusionCuller::RasterizeTile(uint32_t tile)
+{
+    const int32_t tileX0 = int32_t(tile % tilesX_ * kTileWidth);
+    const int32_t tileY0 = int32_t(tile / tilesX_ * kTileHeight);
+    float* depth = levels_[0].depth.data();
+    for (int32_t y = tileY0; y < tileY0 + int32_t(kTileHeight); ++y) {
+        std::fill_n(depth + size_t(y) * width_ + tileX0, kTileWidth, 1.0f);
+    }
+
+    for (uint32_t chunk = 0; chunk < chunkCount_; ++chunk) {
+        const SetupChunk& setup = chunks_[chunk];
+        for (uint32_t index : setup.bins[tile]) {
+            const ScreenTriangle& triangle = setup.triangles[index];
+
+            // 三角形の外接矩形とタイルの重なり。横はSIMDの4画素にそろえる
+            const int32_t x0 = std::max(tileX0, triangle.minX) & ~3;
+            const int32_t x1 = std::min(tileX0 + int32_t(kTileWidth) - 1, triangle.maxX);
+            const int32_t y0 = std::max(tileY0, triangle.minY);
+            const int32_t y1 = std::min(tileY0 + int32_t(kTileHeight) - 1, triangle.maxY);
+            if (x0 > x1 || y0 > y1) {
+                continue;
+            }
+
+            // 辺ごとに E = a * (X - x[e]) + b * (Y - y[e]) を画素の中心(固定小数点)で整数のまま求め、3つとも0以上なら内側
+            // 共有する辺は隣の三角形では向きが逆で、ちょうど符号だけが反対の値になる
+            // 0になる画素は左か上の辺を持つ方だけが描くよう、それ以外の辺は1を引いて0を外にする
+            constexpr int32_t kHalf = 1 << (kSubpixelBits - 1);
+            const int32_t sampleX = (x0 << kSubpixelBits) + kHalf;
+            const int32_t sampleY = (y0 << kSubpixelBits) + kHalf;
+            int32_t a[3];
+            int32_t b[3];
+            int32_t rowEdge[3];
+            for (int e = 0; e < 3; ++e) {
+                int next = (e + 1) % 3;
+                a[e] = triangle.y[e] - triangle.y[next];
+                b[e] = triangle.x[next] - triangle.x[e];
+                const bool topLeft = a[e] > 0 || (a[e] == 0 && b[e] > 0);
+                rowEdge[e] = int32_t(int64_t(a[e]) * (sampleX - triangle.x[e]) + int64_t(b[e]) * (sampleY - triangle.y[e])) - (topLeft ? 0 : 1);
+            }
+
+#ifdef OCCLUSION_CULLER_SSE2
+            const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+            const __m128i lane0 = _mm_setr_epi32(0, a[0] << kSubpixelBits, (a[0] << kSubpixelBits) * 2, (a[0] << kSubpixelBits) * 3);
+            const __m128i lane1 = _mm_setr_epi32(0, a[1] << kSubpixelBits, (a[1] << kSubpixelBits) * 2, (a[1] << kSubpixelBits) * 3);
+            const __m128i lane2 = _mm_setr_epi32(0, a[2] << kSubpixelBits, (a[2] << kSubpixelBits) * 2, (a[2] << kSubpixelBits) * 3);
+            const __m128i step0 = _mm_set1_epi32(a[0] << (kSubpixelBits + 2));
+            const __m128i step1 = _mm_set1_epi32(a[1] << (kSubpixelBits + 2));
+            const __m128i step2 = _mm_set1_epi32(a[2] << (kSubpixelBits + 2));
+            const __m128 dzdx = _mm_set1_ps(triangle.dzdx);
+            const __m128 stepZ = _mm_set1_ps(triangle.dzdx * 4.0f);
+            for (int32_t y = y0; y <= y1; ++y) {
+                float centerY = float(y) + 0.5f;
+                __m128i e0 = _mm_add_epi32(_mm_set1_epi32(rowEdge[0]), lane0);
+                __m128i e1 = _mm_add_epi32(_mm_set1_epi32(rowEdge[1]), lane1);
+                __m128i e2 = _mm_add_epi32(_mm_set1_epi32(rowEdge[2]), lane2);
+                __m128 z = _mm_add_ps(_mm_mul_ps(dzdx, _mm_add_ps(_mm_set1_ps(float(x0)), laneOffsets)),
+                    _mm_set1_ps(triangle.zAtOrigin + triangle.dzdy * centerY));
+                float* row = depth + size_t(y) * width_;
+                for (int32_t x = x0; x <= x1; x += 4) {
+                    // どれかの辺が負なら符号のビットが立つので、それを全ビットに広げて外の印にする
+                    __m128i outside = _mm_srai_epi32(_mm_or_si128(_mm_or_si128(e0, e1), e2), 31);
+                    if (_mm_movemask_epi8(outside) != 0xFFFF) {
+                        __m128 outsideMask = _mm_castsi128_ps(outside);
+                        __m128 old = _mm_load_ps(row + x);
+                        __m128 nearer = _mm_min_ps(old, z);
+                        _mm_store_ps(row + x, _mm_or_ps(_mm_and_ps(outsideMask, old), _mm_andnot_ps(outsideMask, nearer)));
+                    }
+                    e0 = _mm_add_epi32(e0, step0);
+                    e1 = _mm_add_epi32(e1, step1);
+                    e2 = _mm_add_epi32(e2, step2);
+                    z = _mm_add_ps(z, stepZ);
+                }
+                for (int e = 0; e < 3; ++e) {
+                    rowEdge[e] += b[e] << kSubpixelBits;
+                }
+            }
+#else
+            for (int32_t y = y0; y <= y1; ++y) {
+                float centerY = float(y) + 0.5f;
+                float* row = depth + size_t(y) * width_;
+                int32_t edge[3] = { rowEdge[0], rowEdge[1], rowEdge[2] };
+                for (int32_t x = x0; x <= x1; ++x) {
+                    if ((edge[0] | edge[1] | edge[2]) >= 0) {
+                        row[x] = std::min(row[x], triangle.zAtOrigin + triangle.dzdx * (float(x) + 0.5f) + triangle.dzdy * centerY);
+                    }
+                    for (int e = 0; e < 3; ++e) {
+                        edge[e] += a[e] << kSubpixelBits;
+                    }
+                }
+                for (int e = 0; e < 3; ++e) {
+                    rowEdge[e] += b[e] << kSubpixelBits;
+                }
+            }
+#endif
+        }
+    }
+}
+
+void OcclusionCuller::BuildHiZ()
+{
+    // 2x2の中で一番遠い深度を残す。一番大きい1段目だけスレッドに分ける
+    for (size_t level = 1; level < levels_.size(); ++level) {
+        const Level& source = levels_[level - 1];
+        Level& target = levels_[level];
+        auto buildRows = [&](uint32_t begin, uint32_t end) {
+            for (uint32_t y = begin; y < end; ++y) {
+                const float* row0 = source.depth.data() + size_t(std::min(y * 2, source.height - 1)) * source.width;
+                const float* row1 = source.depth.data() + size_t(std::min(y * 2 + 1, source.height - 1)) * source.width;
+                float* output = target.depth.data() + size_t(y) * target.width;
+                uint32_t x = 0;
+#ifdef OCCLUSION_CULLER_SSE2
+                // 8画素を読んで隣どうしの最大を4つ作る
+                if (source.width % 2 == 0) {
+                    for (; x + 4 <= target.width; x += 4) {
+                        __m128 left = _mm_max_ps(_mm_loadu_ps(row0 + x * 2), _mm_loadu_ps(row1 + x * 2));
+                        __m128 right = _mm_max_ps(_mm_loadu_ps(row0 + x * 2 + 4), _mm_loadu_ps(row1 + x * 2 + 4));
+                        _mm_storeu_ps(output + x, _mm_max_ps(_mm_shuffle_ps(left, right, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(left, right, _MM_SHUFFLE(3, 1, 3, 1))));
+                    }
+                }
+#endif
+                for (; x < target.width; ++x) {
+                    uint32_t x0 = x * 2;
+                    uint32_t x1 = std::min(x * 2 + 1, source.width - 1);
+                    output[x] = std::max({ row0[x0], row0[x1], row1[x0], row1[x1] });
+                }
+            }
+        };
+        if (level == 1 && threadPool_ != nullptr && ResolveThreadCount() > 1) {
+            threadPool_->ParallelFor(target.height, std::max(1u, target.height / ResolveThreadCount()), buildRows);
+        } else {
+            buildRows(0, target.height);
+        }
+    }
+}
+
+OcclusionCuller::TestResult OcclusionCuller::Test(const OcclusionBounds& bounds) const
+{
+    float clip[8][4];
+    for (int corner = 0; corner < 8; ++corner) {
+        TransformPoint(viewProjection_, (corner & 1) ? bounds.max.x : bounds.min.x, (corner & 2) ? bounds.max.y : bounds.min.y,
+            (corner & 4) ? bounds.max.z : bounds.min.z, clip[corner]);
+    }
+
+    // 8隅がすべて同じ面の外なら視錐台の外
+    uint32_t outsideAll = 0x3F;
+    bool crossesNear = false;
+    for (const float* c : clip) {
+        uint32_t outside = (c[0] < -c[3] ? 1u : 0u) | (c[0] > c[3] ? 2u : 0u) | (c[1] < -c[3] ? 4u : 0u) | (c[1] > c[3] ? 8u : 0u)
+            | (c[2] < 0.0f ? 16u : 0u) | (c[2] > c[3] ? 32u : 0u);
+        outsideAll &= outside;
+        crossesNear |= c[2] < 0.0f;
+    }
+    if (outsideAll != 0) {
+        return TestResult::OutsideFrustum;
+    }
+    // 近クリップ面をまたぐものは画面に写せないので見えるとする
+    if (crossesNear) {
+        return TestResult::Visible;
+    }
+
+    float minX = float(width_);
+    float maxX = 0.0f;
+    float minY = float(height_);
+    float maxY = 0.0f;
+    float minZ = 1.0f;
+    for (const float* c : clip) {
+        float inverseW = 1.0f / c[3];
+        float x = (c[0] * inverseW * 0.5f + 0.5f) * float(width_);
+        float y = (0.5f - c[1] * inverseW * 0.5f) * float(height_);
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+        minZ = std::min(minZ, c[2] * inverseW);
+    }
+
+    // 箱が覆う画素を2x2個以下で覆える段を選び、その中で一番遠い深度と比べる
+    uint32_t x0 = uint32_t(std::clamp(minX, 0.0f, float(width_ - 1)));
+    uint32_t x1 = uint32_t(std::clamp(maxX, 0.0f, float(width_ - 1)));
+    uint32_t y0 = uint32_t(std::clamp(minY, 0.0f, float(height_ - 1)));
+    uint32_t y1 = uint32_t(std::clamp(maxY, 0.0f, float(height_ - 1)));
+    uint32_t level = 0;
+    while (level + 1 < levels_.size() && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1)) {
+        ++level;
+    }
+    const Level& hiz = levels_[level];
+    float farthest = 0.0f;
+    for (uint32_t y = y0 >> level; y <= (y1 >> level); ++y) {
+        for (uint32_t x = x0 >> level; x <= (x1 >> level); ++x) {
+            farthest = std::max(farthest, hiz.depth[size_t(y) * hiz.width + x]);
+        }
+    }
+    return minZ > farthest ? TestResult::Occluded : TestResult::Visible;
+}
+
+bool OcclusionCuller::TestBounds(const OcclusionBounds& bounds) const
+{
+    return Test(bounds) == TestResult::Visible;
+}
+
+uint32_t OcclusionCuller::TestBounds(const OcclusionBounds* bounds, uint32_t count, uint8_t* visible)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::atomic<uint32_t> frustumCulled { 0 };
+    std::atomic<uint32_t> occlusionCulled { 0 };
+    auto testRange = [&](uint32_t begin, uint32_t end) {
+        uint32_t outside = 0;
+        uint32_t occluded = 0;
+        for (uint32_t i = begin; i < end; ++i) {
+            TestResult result = Test(bounds[i]);
+            visible[i] = result == TestResult::Visible ? 1 : 0;
+            outside += result == TestResult::OutsideFrustum ? 1 : 0;
+            occluded += result == TestResult::Occluded ? 1 : 0;
+        }
+        frustumCulled.fetch_add(outside, std::memory_order_relaxed);
+        occlusionCulled.fetch_add(occluded, std::memory_order_relaxed);
+    };
+    const uint32_t threadCount = ResolveThreadCount();
+    if (threadPool_ != nullptr && threadCount > 1) {
+        threadPool_->ParallelFor(count, std::max(kMinBoundsPerChunk, (count + threadCount - 1) / threadCount), testRange);
+    } else {
+        testRange(0, count);
+    }
+
+    stats_.tested += count;
+    stats_.frustumCulled += frustumCulled.load();
+    stats_.occlusionCulled += occlusionCulled.load();
+    stats_.testMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return count - frustumCulled.load() - occlusionCulled.load();
+}
@@ -0,0 +1,152 @@
+#include "PipelineCache.h"
+#include "Hash.h"
+#include "PipelineKey.h"
+#include "ThreadPool.h"
+#include <cassert>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <sstream>
+
+PipelineCache::PipelineCache(ID3D12Device* device, ThreadPool& threadPool, std::string libraryPath)
+    : device_(device)
+    , threadPool_(threadPool)
+    , libraryPath_(std::move(libraryPath))
+{
+    OpenLibrary();
+}
+
+PipelineCache::~PipelineCache()
+{
+    // 作りかけのものがdescの指す先を使い終わるまで待つ
+    table_.WaitIdle();
+}
+
+void PipelineCache::OpenLibrary()
+{
+    Microsoft::WRL::ComPtr<ID3D12Device1> device1;
+    if (FAILED(device_->QueryInterface(IID_PPV_ARGS(&device1)))) {
+        return;
+    }
+
+    // ドライバーやGPUが変わっていると読めないので、そのときは空から作り直す
+    std::ifstream file(libraryPath_, std::ios::binary);
+    if (file) {
+        std::ostringstream stream;
+        stream << file.rdbuf();
+        const std::string bytes = stream.str();
+        libraryBytes_.assign(bytes.begin(), bytes.end());
+        if (!libraryBytes_.empty() && SUCCEEDED(device1->CreatePipelineLibrary(libraryBytes_.data(), libraryBytes_.size(), IID_PPV_ARGS(&library_)))) {
+            return;
+        }
+        libraryBytes_.clear();
+        libraryChanged_ = true;
+    }
+    if (FAILED(device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&library_)))) {
+        library_ = nullptr;
+    }
+}
+
+void PipelineCache::RegisterRootSignature(ID3D12RootSignature* rootSignature, const void* serialized, size_t size)
+{
+    rootSignatureHashes_[rootSignature] = HashBytes(serialized, size);
+}
+
+uint64_t PipelineCache::ComputeKey(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash)
+{
+    return ComputePipelineKey(desc, rootSignatureHash);
+}
+
+uint64_t PipelineCache::GetKey(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) const
+{
+    auto it = rootSignatureHashes_.find(desc.pRootSignature);
+    assert(it != rootSignatureHashes_.end());
+    return ComputeKey(desc, it != rootSignatureHashes_.end() ? it->second : 0);
+}
+
+void PipelineCache::Prewarm(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+{
+    const uint64_t key = GetKey(desc);
+    if (!table_.Claim(key)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++stats_.prewarmed;
+    }
+    threadPool_.Enqueue([this, key, desc] { table_.Finish(key, Create(key, desc)); });
+}
+
+Microsoft::WRL::ComPtr<ID3D12PipelineState> PipelineCache::GetOrCreate(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+{
+    const uint64_t key = GetKey(desc);
+    Microsoft::WRL::ComPtr<ID3D12PipelineState> pipelineState;
+    if (table_.Acquire(key, pipelineState)) {
+        pipelineState = Create(key, desc);
+        table_.Finish(key, pipelineState);
+    }
+    return pipelineState;
+}
+
+Microsoft::WRL::ComPtr<ID3D12PipelineState> PipelineCache::Create(uint64_t key, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+{
+    auto start = std::chrono::steady_clock::now();
+    const std::wstring name = std::format(L"{:016x}", key);
+    Microsoft::WRL::ComPtr<ID3D12PipelineState> pipelineState;
+    bool fromLibrary = false;
+    if (library_ != nullptr) {
+        std::lock_guard<std::mutex> lock(libraryMutex_);
+        fromLibrary = SUCCEEDED(library_->LoadGraphicsPipeline(name.c_str(), &desc, IID_PPV_ARGS(&pipelineState)));
+    }
+    if (!fromLibrary) {
+        if (FAILED(device_->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&pipelineState)))) {
+            pipelineState = nullptr;
+        } else if (library_ != nullptr) {
+            std::lock_guard<std::mutex> lock(libraryMutex_);
+            if (SUCCEEDED(library_->StorePipeline(name.c_str(), pipelineState.Get()))) {
+                libraryChanged_ = true;
+            }
+        }
+    }
+    const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.createMilliseconds += milliseconds;
+    if (pipelineState == nullptr) {
+        ++stats_.failed;
+    } else if (fromLibrary) {
+        ++stats_.libraryHits;
+    } else {
+        ++stats_.created;
+    }
+    return pipelineState;
+}
+
+bool PipelineCache::Save()
+{
+    std::lock_guard<std::mutex> lock(libraryMutex_);
+    if (library_ == nullptr || !libraryChanged_) {
+        return false;
+    }
+    std::vector<uint8_t> bytes(library_->GetSerializedSize());
+    if (bytes.empty() || FAILED(library_->Serialize(bytes.data(), bytes.size()))) {
+        return false;
+    }
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(libraryPath_).parent_path(), error);
+    std::ofstream file(libraryPath_, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(bytes.data()), std::streamsize(bytes.size()));
+    libraryChanged_ = !file;
+    return static_cast<bool>(file);
+}
+
+PipelineCacheStats PipelineCache::GetStats()
+{
+    const PipelineTable<Microsoft::WRL::ComPtr<ID3D12PipelineState>>::Stats tableStats = table_.GetStats();
+    std::lock_guard<std::mutex> lock(mutex_);
+    PipelineCacheStats stats = stats_;
+    stats.requests = tableStats.requests;
+    stats.deduplicated = tableStats.deduplicated;
+    return stats;
+}
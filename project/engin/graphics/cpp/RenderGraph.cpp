@@ -0,0 +1,217 @@
+#include "RenderGraph.h"
+#include <algorithm>
+#include <cassert>
+
+// RenderGraphCompilerの状態はD3D12_RESOURCE_STATESと同じ値にしてあるので、そのまま置き換える
+static_assert(uint32_t(RenderGraphState_RenderTarget) == D3D12_RESOURCE_STATE_RENDER_TARGET);
+static_assert(uint32_t(RenderGraphState_UnorderedAccess) == D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+static_assert(uint32_t(RenderGraphState_DepthWrite) == D3D12_RESOURCE_STATE_DEPTH_WRITE);
+static_assert(uint32_t(RenderGraphState_DepthRead) == D3D12_RESOURCE_STATE_DEPTH_READ);
+static_assert(uint32_t(RenderGraphState_NonPixelShaderResource) == D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+static_assert(uint32_t(RenderGraphState_PixelShaderResource) == D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+static_assert(uint32_t(RenderGraphState_IndirectArgument) == D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+static_assert(uint32_t(RenderGraphState_CopyDest) == D3D12_RESOURCE_STATE_COPY_DEST);
+static_assert(uint32_t(RenderGraphState_CopySource) == D3D12_RESOURCE_STATE_COPY_SOURCE);
+static_assert(uint32_t(RenderGraphState_ResolveSource) == D3D12_RESOURCE_STATE_RESOLVE_SOURCE);
+
+namespace {
+
+uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+bool IsSameDesc(const D3D12_RESOURCE_DESC& a, const D3D12_RESOURCE_DESC& b)
+{
+    return a.Dimension == b.Dimension && a.Alignment == b.Alignment && a.Width == b.Width && a.Height == b.Height
+        && a.DepthOrArraySize == b.DepthOrArraySize && a.MipLevels == b.MipLevels && a.Format == b.Format
+        && a.SampleDesc.Count == b.SampleDesc.Count && a.SampleDesc.Quality == b.SampleDesc.Quality && a.Layout == b.Layout && a.Flags == b.Flags;
+}
+
+RenderGraphStates ToGraphStates(D3D12_RESOURCE_STATES state)
+{
+    return static_cast<RenderGraphStates>(state);
+}
+
+D3D12_RESOURCE_STATES ToD3D12States(RenderGraphStates state)
+{
+    return static_cast<D3D12_RESOURCE_STATES>(state);
+}
+
+} // namespace
+
+void RenderGraph::Reset()
+{
+    compiler_.Reset();
+    executes_.clear();
+    resources_.clear();
+}
+
+RenderGraphResource RenderGraph::ImportResource(const std::string& name, ID3D12Resource* resource,
+    D3D12_RESOURCE_STATES initialState, D3D12_RESOURCE_STATES finalState)
+{
+    Resource imported;
+    imported.physical = resource;
+    resources_.push_back(imported);
+    return compiler_.ImportResource(name, ToGraphStates(initialState), ToGraphStates(finalState));
+}
+
+RenderGraphResource RenderGraph::CreateTransient(const std::string& name, const D3D12_RESOURCE_DESC& desc,
+    const D3D12_RESOURCE_ALLOCATION_INFO& allocationInfo, const D3D12_CLEAR_VALUE* clearValue)
+{
+    Resource transient;
+    transient.desc = desc;
+    if (clearValue != nullptr) {
+        transient.clearValue = *clearValue;
+        transient.hasClearValue = true;
+    }
+    resources_.push_back(transient);
+    return compiler_.CreateTransient(name, allocationInfo.SizeInBytes, allocationInfo.Alignment, static_cast<uint32_t>(ClassifyGpuResource(desc)));
+}
+
+uint32_t RenderGraph::AddPass(const std::string& name, ExecuteFunc execute)
+{
+    executes_.push_back(std::move(execute));
+    return compiler_.AddPass(name);
+}
+
+void RenderGraph::Read(uint32_t pass, RenderGraphResource resource, D3D12_RESOURCE_STATES state)
+{
+    compiler_.Read(pass, resource, ToGraphStates(state));
+}
+
+void RenderGraph::Write(uint32_t pass, RenderGraphResource resource, D3D12_RESOURCE_STATES state, RenderGraphLoad load)
+{
+    compiler_.Write(pass, resource, ToGraphStates(state), load);
+}
+
+void RenderGraph::BindTransient(RenderGraphResource resource, ID3D12Resource* physical)
+{
+    assert(compiler_.IsTransient(resource));
+    resources_[resource].physical = physical;
+}
+
+const D3D12_CLEAR_VALUE* RenderGraph::GetClearValue(RenderGraphResource resource) const
+{
+    return resources_[resource].hasClearValue ? &resources_[resource].clearValue : nullptr;
+}
+
+void RenderGraph::Execute(ResourceStateTracker& tracker)
+{
+    Execute([&tracker]() -> ResourceStateTracker& { return tracker; });
+}
+
+void RenderGraph::Execute(const std::function<ResourceStateTracker&()>& getStateTracker)
+{
+    auto flush = [&](const std::vector<RenderGraphBarrier>& barriers) {
+        ResourceStateTracker& tracker = getStateTracker();
+        for (const RenderGraphBarrier& barrier : barriers) {
+            ID3D12Resource* physical = resources_[barrier.resource].physical;
+            assert(physical != nullptr);
+            if (barrier.type == RenderGraphBarrierType::Transition) {
+                if (barrier.split == RenderGraphBarrierSplit::EndOnly) {
+                    tracker.EndTransition(physical, ToD3D12States(barrier.after));
+                    continue;
+                }
+                // このリストで初めて触るなら、グラフで決めた前の状態からリストの中で遷移させる
+                tracker.Assume(physical, ToD3D12States(barrier.before));
+                if (barrier.split == RenderGraphBarrierSplit::BeginOnly) {
+                    tracker.BeginTransition(physical, ToD3D12States(barrier.after));
+                } else {
+                    tracker.Transition(physical, ToD3D12States(barrier.after));
+                }
+            } else if (barrier.type == RenderGraphBarrierType::Aliasing) {
+                // 前の持ち主はnullptrにしておけば、同じ場所を使っていたどれからでも切り替えられる
+                tracker.AliasingBarrier(nullptr, physical);
+            } else {
+                tracker.UavBarrier(physical);
+            }
+        }
+        // 外で積んでまだ張っていないものもここで一緒に張る
+        tracker.Flush();
+        return &tracker;
+    };
+
+    for (uint32_t pass = 0; pass < compiler_.GetPassCount(); ++pass) {
+        if (compiler_.IsPassCulled(pass)) {
+            continue;
+        }
+        ResourceStateTracker* tracker = flush(compiler_.GetPassBarriers(pass));
+        // 同じ場所の前の持ち主の中身を引き継がないよう、最初に書く一時リソースはここで捨てる
+        for (RenderGraphResource resource : compiler_.GetPassDiscards(pass)) {
+            tracker->GetCommandList()->DiscardResource(resources_[resource].physical, nullptr);
+        }
+        for (uint32_t access = 0; access < compiler_.GetAccessCount(pass); ++access) {
+            tracker->Validate(resources_[compiler_.GetAccessResource(pass, access)].physical, ToD3D12States(compiler_.GetPlannedState(pass, access)));
+        }
+        if (executes_[pass]) {
+            executes_[pass](tracker->GetCommandList());
+        }
+    }
+    flush(compiler_.GetFinalBarriers());
+}
+
+bool TransientResourceCache::IsSamePlacement(const Entry& entry, const RenderGraph& graph, RenderGraphResource resource)
+{
+    const RenderGraphPlacement& placement = graph.GetPlacement(resource);
+    return entry.placement.heapClass == placement.heapClass && entry.placement.offset == placement.offset
+        && entry.placement.initialState == placement.initialState && IsSameDesc(entry.desc, graph.GetDesc(resource));
+}
+
+void TransientResourceCache::Realize(RenderGraph& graph, const std::function<void(std::function<void()>)>& deferRelease)
+{
+    std::vector<RenderGraphResource> transients;
+    for (RenderGraphResource r = 0; r < graph.GetResourceCount(); ++r) {
+        if (graph.IsTransient(r) && graph.GetPlacement(r).firstPass != UINT32_MAX) {
+            transients.push_back(r);
+        }
+    }
+
+    bool same = transients.size() == entries_.size();
+    for (size_t c = 0; c < static_cast<size_t>(GpuResourceClass::Count); ++c) {
+        same = same && heapBytes_[c] == graph.GetTransientHeapBytes(static_cast<GpuResourceClass>(c));
+    }
+    for (size_t i = 0; same && i < transients.size(); ++i) {
+        same = IsSamePlacement(entries_[i], graph, transients[i]);
+    }
+
+    if (!same) {
+        // 置き場所が変わったので作り直す。古いものは流しているフレームが使い終わってから消す
+        // 状態はもう追わないので、同じアドレスで別のリソースが作られても取り違えないようすぐに外す
+        for (const Entry& entry : entries_) {
+            resourceStates_.Unregister(entry.resource.Get());
+        }
+        std::vector<Microsoft::WRL::ComPtr<ID3D12Heap>> oldHeaps(std::begin(heaps_), std::end(heaps_));
+        deferRelease([oldHeaps, oldEntries = entries_] {});
+        entries_.clear();
+        ++rebuilds_;
+
+        for (size_t c = 0; c < static_cast<size_t>(GpuResourceClass::Count); ++c) {
+            heapBytes_[c] = graph.GetTransientHeapBytes(static_cast<GpuResourceClass>(c));
+            heaps_[c] = nullptr;
+            if (heapBytes_[c] == 0) {
+                continue;
+            }
+            D3D12_HEAP_DESC heapDesc {};
+            heapDesc.SizeInBytes = AlignUp(heapBytes_[c], D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+            heapDesc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+            heapDesc.Flags = GetGpuResourceHeapFlags(static_cast<GpuResourceClass>(c));
+            HRESULT hr = device_->CreateHeap(&heapDesc, IID_PPV_ARGS(&heaps_[c]));
+            assert(SUCCEEDED(hr));
+        }
+        for (RenderGraphResource r : transients) {
+            Entry entry;
+            entry.placement = graph.GetPlacement(r);
+            entry.desc = graph.GetDesc(r);
+            HRESULT hr = device_->CreatePlacedResource(heaps_[entry.placement.heapClass].Get(), entry.placement.offset,
+                &entry.desc, static_cast<D3D12_RESOURCE_STATES>(entry.placement.initialState), graph.GetClearValue(r), IID_PPV_ARGS(&entry.resource));
+            assert(SUCCEEDED(hr));
+            resourceStates_.Register(entry.resource.Get(), static_cast<D3D12_RESOURCE_STATES>(entry.placement.initialState));
+            entries_.push_back(std::move(entry));
+        }
+    }
+
+    for (size_t i = 0; i < transients.size(); ++i) {
+        graph.BindTransient(transients[i], entries_[i].resource.Get());
+    }
+}
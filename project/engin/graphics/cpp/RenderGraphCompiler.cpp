@@ -0,0 +1,381 @@
+#include "RenderGraphCompiler.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+namespace {
+
+// 書き込みを含む状態。これを含まない状態同士はORでまとめて一度に遷移できる
+constexpr RenderGraphStates kWriteStates = RenderGraphState_RenderTarget | RenderGraphState_UnorderedAccess | RenderGraphState_DepthWrite
+    | RenderGraphState_CopyDest;
+// 中身を捨てられる状態(コピー先は全体を書くコピーで初めて使う)
+constexpr RenderGraphStates kDiscardableStates = RenderGraphState_RenderTarget | RenderGraphState_UnorderedAccess | RenderGraphState_DepthWrite;
+
+bool IsReadOnly(RenderGraphStates state)
+{
+    return (state & kWriteStates) == 0;
+}
+
+uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+void RenderGraphCompiler::Reset()
+{
+    passes_.clear();
+    resources_.clear();
+    finalBarriers_.clear();
+    uninitializedTransients_.clear();
+}
+
+RenderGraphResource RenderGraphCompiler::ImportResource(const std::string& name, RenderGraphStates initialState, RenderGraphStates finalState)
+{
+    Resource imported;
+    imported.name = name;
+    imported.initialState = initialState;
+    imported.finalState = finalState;
+    resources_.push_back(std::move(imported));
+    return static_cast<RenderGraphResource>(resources_.size() - 1);
+}
+
+RenderGraphResource RenderGraphCompiler::CreateTransient(const std::string& name, uint64_t sizeInBytes, uint64_t alignment, uint32_t heapClass)
+{
+    assert(sizeInBytes > 0 && alignment > 0);
+    Resource transient;
+    transient.name = name;
+    transient.transient = true;
+    transient.sizeInBytes = sizeInBytes;
+    transient.alignment = alignment;
+    transient.placement.heapClass = heapClass;
+    resources_.push_back(std::move(transient));
+    return static_cast<RenderGraphResource>(resources_.size() - 1);
+}
+
+uint32_t RenderGraphCompiler::AddPass(const std::string& name)
+{
+    Pass pass;
+    pass.name = name;
+    passes_.push_back(std::move(pass));
+    return static_cast<uint32_t>(passes_.size() - 1);
+}
+
+void RenderGraphCompiler::Read(uint32_t pass, RenderGraphResource resource, RenderGraphStates state)
+{
+    assert(IsReadOnly(state));
+    AddAccess(pass, { resource, state, false, RenderGraphLoad::Preserve });
+}
+
+void RenderGraphCompiler::Write(uint32_t pass, RenderGraphResource resource, RenderGraphStates state, RenderGraphLoad load)
+{
+    AddAccess(pass, { resource, state, true, load });
+}
+
+void RenderGraphCompiler::SetSideEffect(uint32_t pass)
+{
+    passes_[pass].sideEffect = true;
+}
+
+void RenderGraphCompiler::AddAccess(uint32_t pass, const Access& access)
+{
+    assert(pass < passes_.size() && access.resource < resources_.size());
+    // 同じパスで同じリソースを何度も宣言したら1つにまとめる。書き込みがあればその状態を使う
+    for (Access& existing : passes_[pass].accesses) {
+        if (existing.resource != access.resource) {
+            continue;
+        }
+        if (access.write) {
+            assert(!existing.write || existing.state == access.state);
+            // 読んでから書くなら前の内容が要る
+            existing.load = existing.write ? existing.load : RenderGraphLoad::Preserve;
+            existing.state = access.state;
+            existing.write = true;
+        } else if (!existing.write) {
+            existing.state = existing.state | access.state;
+        }
+        return;
+    }
+    passes_[pass].accesses.push_back(access);
+}
+
+void RenderGraphCompiler::Compile()
+{
+    auto start = std::chrono::steady_clock::now();
+    stats_ = RenderGraphStats {};
+    stats_.passes = static_cast<uint32_t>(passes_.size());
+    stats_.resources = static_cast<uint32_t>(resources_.size());
+    finalBarriers_.clear();
+    uninitializedTransients_.clear();
+
+    CullPasses();
+    PlaceTransients();
+    BuildBarriers();
+
+    stats_.compileMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void RenderGraphCompiler::CullPasses()
+{
+    // 後ろのパスから、まだ誰かが読む(またはImportした出力である)リソースを書くパスだけを残していく
+    std::vector<uint8_t> needed(resources_.size());
+    for (size_t i = 0; i < resources_.size(); ++i) {
+        needed[i] = !resources_[i].transient;
+    }
+    for (size_t i = passes_.size(); i-- > 0;) {
+        Pass& pass = passes_[i];
+        bool live = pass.sideEffect;
+        for (const Access& access : pass.accesses) {
+            live = live || (access.write && needed[access.resource]);
+        }
+        pass.culled = !live;
+        pass.barriers.clear();
+        pass.discards.clear();
+        if (!live) {
+            ++stats_.culledPasses;
+            continue;
+        }
+        // 書き直すものは前の内容が要らなくなり、読むものと重ねて書くものは前のパスの結果が要る
+        for (const Access& access : pass.accesses) {
+            if (access.write && access.load == RenderGraphLoad::Discard) {
+                needed[access.resource] = 0;
+            }
+        }
+        for (const Access& access : pass.accesses) {
+            if (!access.write || access.load == RenderGraphLoad::Preserve) {
+                needed[access.resource] = 1;
+            }
+        }
+    }
+}
+
+void RenderGraphCompiler::PlaceTransients()
+{
+    for (Resource& resource : resources_) {
+        resource.placement.firstPass = UINT32_MAX;
+        resource.placement.lastPass = 0;
+        resource.placement.aliased = false;
+        resource.placement.reusedLater = false;
+    }
+    uint32_t order = 0;
+    for (const Pass& pass : passes_) {
+        if (pass.culled) {
+            continue;
+        }
+        for (const Access& access : pass.accesses) {
+            RenderGraphPlacement& placement = resources_[access.resource].placement;
+            placement.firstPass = std::min(placement.firstPass, order);
+            placement.lastPass = order;
+        }
+        ++order;
+    }
+    std::vector<std::vector<RenderGraphResource>> classTransients;
+    for (RenderGraphResource i = 0; i < resources_.size(); ++i) {
+        const Resource& resource = resources_[i];
+        if (resource.transient && resource.placement.firstPass != UINT32_MAX) {
+            const uint32_t heapClass = resource.placement.heapClass;
+            if (heapClass >= classTransients.size()) {
+                classTransients.resize(heapClass + 1);
+            }
+            classTransients[heapClass].push_back(i);
+            ++stats_.transientResources;
+        }
+    }
+    heapBytes_.assign(classTransients.size(), 0);
+
+    // 大きいものから順に、生きている間が重なるものを避けた一番前の場所へ置く
+    std::vector<std::pair<uint64_t, uint64_t>> occupied;
+    for (size_t c = 0; c < classTransients.size(); ++c) {
+        std::vector<RenderGraphResource>& transients = classTransients[c];
+        std::sort(transients.begin(), transients.end(), [this](RenderGraphResource a, RenderGraphResource b) {
+            const Resource& ra = resources_[a];
+            const Resource& rb = resources_[b];
+            if (ra.sizeInBytes != rb.sizeInBytes) {
+                return ra.sizeInBytes > rb.sizeInBytes;
+            }
+            return ra.placement.firstPass < rb.placement.firstPass;
+        });
+
+        uint64_t heapBytes = 0;
+        for (size_t i = 0; i < transients.size(); ++i) {
+            Resource& resource = resources_[transients[i]];
+            RenderGraphPlacement& placement = resource.placement;
+            occupied.clear();
+            for (size_t j = 0; j < i; ++j) {
+                const Resource& placed = resources_[transients[j]];
+                if (placed.placement.firstPass <= placement.lastPass && placement.firstPass <= placed.placement.lastPass) {
+                    occupied.emplace_back(placed.placement.offset, placed.placement.offset + placed.sizeInBytes);
+                }
+            }
+            std::sort(occupied.begin(), occupied.end());
+
+            uint64_t offset = 0;
+            for (const auto& [begin, end] : occupied) {
+                if (AlignUp(offset, resource.alignment) + resource.sizeInBytes <= begin) {
+                    break;
+                }
+                offset = std::max(offset, end);
+            }
+            placement.offset = AlignUp(offset, resource.alignment);
+            heapBytes = std::max(heapBytes, placement.offset + resource.sizeInBytes);
+            stats_.unaliasedBytes += resource.sizeInBytes;
+        }
+        heapBytes_[c] = heapBytes;
+        stats_.transientBytes += heapBytes;
+
+        // 同じ場所を使うもの同士は、最初に使う前にエイリアシングバリアが要る
+        // 生きている間は重ならないので、先に使い終えるほうは後から場所を明け渡す
+        for (size_t i = 0; i < transients.size(); ++i) {
+            const Resource& ra = resources_[transients[i]];
+            for (size_t j = i + 1; j < transients.size(); ++j) {
+                const Resource& rb = resources_[transients[j]];
+                if (ra.placement.offset < rb.placement.offset + rb.sizeInBytes && rb.placement.offset < ra.placement.offset + ra.sizeInBytes) {
+                    RenderGraphPlacement& a = resources_[transients[i]].placement;
+                    RenderGraphPlacement& b = resources_[transients[j]].placement;
+                    a.aliased = true;
+                    b.aliased = true;
+                    (a.lastPass < b.firstPass ? a : b).reusedLater = true;
+                }
+            }
+        }
+    }
+}
+
+void RenderGraphCompiler::BuildBarriers()
+{
+    // 後ろから見て、書き込みまでに続けて読む状態をORでまとめておく(読むたびに遷移しなくてよい)
+    std::vector<RenderGraphStates> pendingReads(resources_.size(), RenderGraphState_Common);
+    std::vector<std::vector<RenderGraphStates>> requiredStates(passes_.size());
+    for (size_t i = passes_.size(); i-- > 0;) {
+        const Pass& pass = passes_[i];
+        if (pass.culled) {
+            continue;
+        }
+        requiredStates[i].resize(pass.accesses.size());
+        for (size_t a = 0; a < pass.accesses.size(); ++a) {
+            const Access& access = pass.accesses[a];
+            if (access.write) {
+                requiredStates[i][a] = access.state;
+                pendingReads[access.resource] = RenderGraphState_Common;
+            } else {
+                pendingReads[access.resource] = pendingReads[access.resource] | access.state;
+                requiredStates[i][a] = pendingReads[access.resource];
+            }
+        }
+    }
+
+    std::vector<RenderGraphStates> current(resources_.size());
+    std::vector<RenderGraphStates> previousAccess(resources_.size());
+    std::vector<uint8_t> used(resources_.size());
+    std::vector<uint8_t> lastWrite(resources_.size());
+    // 最後に使った生きているパスの順番(まだ使っていなければ-1)と、順番ごとのパス
+    std::vector<int32_t> lastUse(resources_.size(), -1);
+    std::vector<uint32_t> livePasses;
+    for (size_t i = 0; i < resources_.size(); ++i) {
+        current[i] = previousAccess[i] = resources_[i].initialState;
+    }
+    // 後から場所を明け渡す一時リソースは、使い終えた次のパスの前(まだ持ち主のうち)に作った状態へ戻す
+    std::vector<std::vector<RenderGraphResource>> restores(passes_.size() + 1);
+    for (RenderGraphResource r = 0; r < resources_.size(); ++r) {
+        const RenderGraphPlacement& placement = resources_[r].placement;
+        if (resources_[r].transient && placement.reusedLater) {
+            restores[placement.lastPass + 1].push_back(r);
+        }
+    }
+
+    // 使い終えてから次に使うまでの間にパスがあれば、その最初のパスで遷移を始め、使うパス(endOrder番目)の前で終える
+    auto addTransition = [&](std::vector<RenderGraphBarrier>& barriers, uint32_t endOrder, RenderGraphResource r, RenderGraphStates after) {
+        const uint32_t beginOrder = static_cast<uint32_t>(lastUse[r] + 1);
+        if (beginOrder < endOrder) {
+            passes_[livePasses[beginOrder]].barriers.push_back({ RenderGraphBarrierType::Transition, r, current[r], after, RenderGraphBarrierSplit::BeginOnly });
+            barriers.push_back({ RenderGraphBarrierType::Transition, r, current[r], after, RenderGraphBarrierSplit::EndOnly });
+            ++stats_.splitBarriers;
+        } else {
+            barriers.push_back({ RenderGraphBarrierType::Transition, r, current[r], after });
+        }
+        current[r] = after;
+        ++stats_.transitionBarriers;
+    };
+    auto restore = [&](std::vector<RenderGraphBarrier>& barriers, uint32_t endOrder, RenderGraphResource r, RenderGraphStates state) {
+        if (current[r] == state) {
+            return;
+        }
+        if (previousAccess[r] != state) {
+            ++stats_.naiveTransitions;
+        }
+        addTransition(barriers, endOrder, r, state);
+    };
+
+    for (size_t i = 0; i < passes_.size(); ++i) {
+        Pass& pass = passes_[i];
+        if (pass.culled) {
+            continue;
+        }
+        livePasses.push_back(static_cast<uint32_t>(i));
+        const uint32_t order = static_cast<uint32_t>(livePasses.size() - 1);
+        // 明け渡す前に戻すので、このパスで同じ場所を使い始めるもののエイリアシングバリアより先に積む
+        for (RenderGraphResource r : restores[order]) {
+            restore(pass.barriers, order, r, resources_[r].placement.initialState);
+        }
+        for (size_t a = 0; a < pass.accesses.size(); ++a) {
+            Access& access = pass.accesses[a];
+            const RenderGraphResource r = access.resource;
+            const RenderGraphStates required = requiredStates[i][a];
+
+            if (resources_[r].transient && !used[r]) {
+                // 一時リソースは最初に使う状態で作っておくので遷移は要らない。同じ場所の前の持ち主から切り替えるだけ
+                resources_[r].placement.initialState = required;
+                current[r] = previousAccess[r] = required;
+                if (resources_[r].placement.aliased) {
+                    pass.barriers.push_back({ RenderGraphBarrierType::Aliasing, r });
+                    ++stats_.aliasingBarriers;
+                }
+                // 中身は前の持ち主のものか作ったばかりで決まっていないので、最初はDiscardで書かなければならない
+                if (!access.write || access.load != RenderGraphLoad::Discard) {
+                    uninitializedTransients_.push_back(r);
+                    ++stats_.uninitializedTransients;
+                } else if ((required & kDiscardableStates) != 0) {
+                    pass.discards.push_back(r);
+                }
+            } else {
+                if (previousAccess[r] != access.state) {
+                    ++stats_.naiveTransitions;
+                }
+                previousAccess[r] = access.state;
+
+                if (current[r] != required && !(!access.write && IsReadOnly(current[r]) && (current[r] & required) == required)) {
+                    addTransition(pass.barriers, order, r, required);
+                } else if (current[r] == RenderGraphState_UnorderedAccess && lastWrite[r]) {
+                    // UAVへ書いた後に同じ状態のまま使うときは、書き終わるのを待つ
+                    pass.barriers.push_back({ RenderGraphBarrierType::Uav, r });
+                    ++stats_.uavBarriers;
+                }
+            }
+            access.plannedState = current[r];
+            used[r] = 1;
+            lastWrite[r] = access.write;
+            lastUse[r] = static_cast<int32_t>(order);
+        }
+    }
+    // 最初に使うパスがDiscardで書かないものは、前の持ち主の中身を読んでしまう
+    assert(uninitializedTransients_.empty());
+
+    // Importしたものは決めた状態へ、フレームの終わりに場所の持ち主である一時リソースは次のフレームのために作った状態へ戻す
+    for (RenderGraphResource r = 0; r < resources_.size(); ++r) {
+        const Resource& resource = resources_[r];
+        if (resource.transient && (!used[r] || resource.placement.reusedLater)) {
+            continue;
+        }
+        restore(finalBarriers_, static_cast<uint32_t>(livePasses.size()), r, resource.transient ? resource.placement.initialState : resource.finalState);
+    }
+
+    for (const Pass& pass : passes_) {
+        if (!pass.culled && !pass.barriers.empty()) {
+            ++stats_.barrierBatches;
+        }
+    }
+    if (!finalBarriers_.empty()) {
+        ++stats_.barrierBatches;
+    }
+}
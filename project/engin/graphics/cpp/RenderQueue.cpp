@@ -0,0 +1,165 @@
+#include "RenderQueue.h"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <chrono>
+
+namespace {
+
+uint64_t Bits(uint32_t value, uint32_t bitCount)
+{
+    return static_cast<uint64_t>(value) & ((uint64_t(1) << bitCount) - 1);
+}
+
+// 正の浮動小数点数はビット列のまま比べても大小が変わらないので、上位bitCountビットを使う
+uint32_t QuantizeDepth(float depth, uint32_t bitCount)
+{
+    uint32_t bits = std::bit_cast<uint32_t>(std::max(depth, 0.0f));
+    return bits >> (31 - bitCount);
+}
+
+enum StateChange {
+    StateChange_Pipeline,
+    StateChange_Material,
+    StateChange_VertexBuffer,
+    StateChange_Transform,
+    StateChange_Texture,
+};
+
+// 描画ごとに切り替わる状態
+struct DrawState {
+    ID3D12PipelineState* pipelineState = nullptr;
+    MaterialId materialId = ~0u;
+    D3D12_GPU_VIRTUAL_ADDRESS vertexBuffer = 0;
+    uint32_t vertexBufferSize = 0;
+    D3D12_GPU_VIRTUAL_ADDRESS transform = 0;
+    uint64_t texture = 0;
+};
+
+// itemに切り替えるときに変わる状態を数える
+template <typename Func>
+void CompareState(DrawState& state, const DrawItem& item, Func&& onChange)
+{
+    if (state.pipelineState != item.pipelineState) {
+        state.pipelineState = item.pipelineState;
+        onChange(StateChange_Pipeline);
+    }
+    if (state.materialId != item.materialId) {
+        state.materialId = item.materialId;
+        onChange(StateChange_Material);
+    }
+    if (state.vertexBuffer != item.vertexBufferView.BufferLocation || state.vertexBufferSize != item.vertexBufferView.SizeInBytes) {
+        state.vertexBuffer = item.vertexBufferView.BufferLocation;
+        state.vertexBufferSize = item.vertexBufferView.SizeInBytes;
+        onChange(StateChange_VertexBuffer);
+    }
+    if (state.transform != item.transform) {
+        state.transform = item.transform;
+        onChange(StateChange_Transform);
+    }
+    if (state.texture != item.texture.ptr) {
+        state.texture = item.texture.ptr;
+        onChange(StateChange_Texture);
+    }
+}
+
+} // namespace
+
+void RenderQueue::Clear()
+{
+    items_.clear();
+    keys_.clear();
+}
+
+void RenderQueue::Submit(const DrawItem& item)
+{
+    keys_.push_back({ MakeKey(item, static_cast<uint32_t>(items_.size())), static_cast<uint32_t>(items_.size()) });
+    items_.push_back(item);
+}
+
+uint64_t RenderQueue::MakeKey(const DrawItem& item, uint32_t sequence)
+{
+    uint64_t key = Bits(static_cast<uint32_t>(item.layer), 4) << 60;
+    switch (item.layer) {
+    case RenderLayer::Opaque:
+        key |= Bits(item.pipelineId, 8) << 52;
+        key |= Bits(item.materialId, 12) << 40;
+        key |= Bits(item.textureId, 12) << 28;
+        key |= Bits(item.meshId, 12) << 16;
+        key |= Bits(QuantizeDepth(item.depth, 16), 16);
+        return key;
+    case RenderLayer::Transparent:
+        key |= Bits(~QuantizeDepth(item.depth, 24), 24) << 36;
+        break;
+    case RenderLayer::Overlay:
+        key |= Bits(sequence, 24) << 36;
+        break;
+    }
+    key |= Bits(item.pipelineId, 8) << 28;
+    key |= Bits(item.materialId, 12) << 16;
+    key |= Bits(item.textureId, 12) << 4;
+    key |= Bits(item.meshId, 4);
+    return key;
+}
+
+void RenderQueue::Sort()
+{
+    // 比較用に、積んだ順のまま描いたときの切り替えを数える
+    stats_ = {};
+    stats_.drawCount = static_cast<uint32_t>(items_.size());
+    DrawState state;
+    for (const DrawItem& item : items_) {
+        CompareState(state, item, [&](StateChange) { ++stats_.unsortedStateChanges; });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    stats_.sortPasses = RadixSort(keys_, scratch_, threadPool_);
+    stats_.sortMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void RenderQueue::Execute(ID3D12GraphicsCommandList* commandList)
+{
+    Execute(commandList, 0, static_cast<uint32_t>(keys_.size()));
+}
+
+void RenderQueue::Execute(ID3D12GraphicsCommandList* commandList, uint32_t begin, uint32_t end)
+{
+    assert(begin <= end && end <= keys_.size());
+    DrawState state;
+    RenderQueueStats changes;
+    for (uint32_t i = begin; i < end; ++i) {
+        const DrawItem& item = items_[keys_[i].index];
+        CompareState(state, item, [&](StateChange change) {
+            switch (change) {
+            case StateChange_Pipeline:
+                commandList->SetPipelineState(item.pipelineState);
+                ++changes.pipelineChanges;
+                break;
+            case StateChange_Material:
+                commandList->SetGraphicsRoot32BitConstant(0, item.materialId, 0);
+                ++changes.materialChanges;
+                break;
+            case StateChange_VertexBuffer:
+                commandList->IASetVertexBuffers(0, 1, &item.vertexBufferView);
+                ++changes.vertexBufferChanges;
+                break;
+            case StateChange_Transform:
+                commandList->SetGraphicsRootConstantBufferView(1, item.transform);
+                ++changes.transformChanges;
+                break;
+            case StateChange_Texture:
+                commandList->SetGraphicsRootDescriptorTable(2, item.texture);
+                ++changes.textureChanges;
+                break;
+            }
+        });
+        commandList->DrawInstanced(item.vertexCount, 1, item.startVertex, 0);
+    }
+
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    stats_.pipelineChanges += changes.pipelineChanges;
+    stats_.materialChanges += changes.materialChanges;
+    stats_.vertexBufferChanges += changes.vertexBufferChanges;
+    stats_.transformChanges += changes.transformChanges;
+    stats_.textureChanges += changes.textureChanges;
+}
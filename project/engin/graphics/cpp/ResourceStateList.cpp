@@ -0,0 +1,374 @@
+#include "ResourceStateList.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+
+namespace {
+
+// 書き込みを含む状態。これを含まない状態同士はORでまとめて一度に遷移できる
+constexpr ResourceStates kWriteStates = ResourceState_RenderTarget | ResourceState_UnorderedAccess | ResourceState_DepthWrite | ResourceState_CopyDest;
+// バッファでないテクスチャがCOMMONから暗黙に昇格できる状態
+constexpr ResourceStates kTexturePromotableStates = ResourceState_NonPixelShaderResource | ResourceState_PixelShaderResource | ResourceState_CopyDest
+    | ResourceState_CopySource;
+constexpr ResourceStates kDepthStates = ResourceState_DepthWrite | ResourceState_DepthRead;
+
+bool IsReadOnly(ResourceStates state)
+{
+    return (state & kWriteStates) == 0;
+}
+
+// currentのままrequiredとして使える
+bool Covers(ResourceStates current, ResourceStates required)
+{
+    return current == required || (required != ResourceState_Common && IsReadOnly(current) && (current & required) == required);
+}
+
+bool CanPromote(bool decays, ResourceStates current, ResourceStates required)
+{
+    if (current != ResourceState_Common || required == ResourceState_Common) {
+        return false;
+    }
+    return decays ? (required & kDepthStates) == 0 : (required & ~kTexturePromotableStates) == 0;
+}
+
+ResourceStateBarrier MakeTransition(ResourceStateKey resource, ResourceStates before, ResourceStates after,
+    ResourceBarrierSplit split = ResourceBarrierSplit::None)
+{
+    ResourceStateBarrier barrier;
+    barrier.type = ResourceBarrierType::Transition;
+    barrier.resource = resource;
+    barrier.before = before;
+    barrier.after = after;
+    barrier.split = split;
+    return barrier;
+}
+
+template <typename... Args>
+std::string FormatError(const char* format, Args... args)
+{
+    char text[160];
+    std::snprintf(text, sizeof(text), format, args...);
+    return text;
+}
+
+} // namespace
+
+void ResourceStateStats::Add(const ResourceStateStats& other)
+{
+    transitions += other.transitions;
+    splitTransitions += other.splitTransitions;
+    aliasingBarriers += other.aliasingBarriers;
+    uavBarriers += other.uavBarriers;
+    barrierCalls += other.barrierCalls;
+    redundantAvoided += other.redundantAvoided;
+    mergedAvoided += other.mergedAvoided;
+    promotionsAvoided += other.promotionsAvoided;
+    resolvedTransitions += other.resolvedTransitions;
+    fixupLists += other.fixupLists;
+    validationErrors += other.validationErrors;
+}
+
+void ResourceStateRegistry::Register(ResourceStateKey resource, ResourceStates state, bool decays)
+{
+    assert(resource != nullptr);
+    Entry& entry = entries_[resource];
+    entry.state = state;
+    entry.decays = decays;
+    entry.decayAfterSubmit = false;
+}
+
+void ResourceStateRegistry::Unregister(ResourceStateKey resource)
+{
+    entries_.erase(resource);
+}
+
+ResourceStates ResourceStateRegistry::GetState(ResourceStateKey resource) const
+{
+    auto it = entries_.find(resource);
+    assert(it != entries_.end());
+    return it->second.state;
+}
+
+bool ResourceStateRegistry::Find(ResourceStateKey resource, ResourceStates& state, bool& decays) const
+{
+    auto it = entries_.find(resource);
+    if (it == entries_.end()) {
+        return false;
+    }
+    state = it->second.state;
+    decays = it->second.decays;
+    return true;
+}
+
+void ResourceStateRegistry::SetState(ResourceStateKey resource, ResourceStates state, bool afterSubmitDecay)
+{
+    auto it = entries_.find(resource);
+    if (it == entries_.end()) {
+        return;
+    }
+    it->second.state = state;
+    it->second.decayAfterSubmit = afterSubmitDecay;
+}
+
+void ResourceStateRegistry::AddError(std::string error)
+{
+    ++pendingStats_.validationErrors;
+    if (errors_.size() < kMaxErrors) {
+        errors_.push_back(std::move(error));
+    }
+}
+
+std::vector<std::string> ResourceStateRegistry::TakeErrors()
+{
+    std::vector<std::string> errors = std::move(errors_);
+    errors_.clear();
+    return errors;
+}
+
+void ResourceStateRegistry::EndSubmit()
+{
+    // バッファと、読む状態へ暗黙に昇格したテクスチャはExecuteCommandListsが終わるとCOMMONに戻る
+    // 同じExecuteCommandListsで流したリストの間では戻らないので、まとめて提出した後に戻す
+    for (auto& [resource, entry] : entries_) {
+        if (entry.decays || entry.decayAfterSubmit) {
+            entry.state = ResourceState_Common;
+        }
+        entry.decayAfterSubmit = false;
+    }
+    frameStats_ = pendingStats_;
+    totalStats_.Add(pendingStats_);
+    pendingStats_ = {};
+}
+
+void ResourceStateList::Begin()
+{
+    states_.clear();
+    pending_.clear();
+    barriers_.clear();
+    errors_.clear();
+    stats_ = {};
+}
+
+bool ResourceStateList::AddPending(ResourceStateKey resource, ResourceStates state, PendingKind kind)
+{
+    if (states_.count(resource) != 0) {
+        return false;
+    }
+    // 前のリストでの状態は提出のときまで分からないので、このリストで最初に使う状態だけを覚えておく
+    pending_.push_back({ resource, state, kind });
+    states_[resource].state = state;
+    return true;
+}
+
+void ResourceStateList::Transition(ResourceStateKey resource, ResourceStates state)
+{
+    assert(resource != nullptr);
+    if (AddPending(resource, state, PendingKind::Transition)) {
+        return;
+    }
+    Local& local = states_[resource];
+    if (local.splitting) {
+        // 分割バリアの途中で使われたら、ここで終えてから続ける
+        AddError(FormatError("Resource %p transitioned to 0x%X during a split barrier", resource, state));
+        FinishSplit(resource, local);
+    }
+    if (Covers(local.state, state)) {
+        ++stats_.redundantAvoided;
+        return;
+    }
+    // 読む状態同士ならまとめた状態へ遷移し、後でまた読む状態を足すときに遷移しなくてよいようにする
+    const ResourceStates after = IsReadOnly(local.state) && IsReadOnly(state) && local.state != ResourceState_Common && state != ResourceState_Common
+        ? local.state | state
+        : state;
+    if (local.queued >= 0) {
+        // まだ張っていない遷移があれば、その行き先を変えて1つにまとめる
+        barriers_[local.queued].after = after;
+        ++stats_.mergedAvoided;
+    } else {
+        local.queued = static_cast<int32_t>(barriers_.size());
+        barriers_.push_back(MakeTransition(resource, local.state, after));
+        ++stats_.transitions;
+    }
+    local.state = after;
+    local.transitioned = true;
+}
+
+void ResourceStateList::Assume(ResourceStateKey resource, ResourceStates state)
+{
+    assert(resource != nullptr);
+    AddPending(resource, state, PendingKind::Assume);
+}
+
+void ResourceStateList::BeginTransition(ResourceStateKey resource, ResourceStates state)
+{
+    assert(resource != nullptr);
+    if (AddPending(resource, state, PendingKind::Transition)) {
+        // 前の状態が分からないものは分割せず、提出のときにリストの前で遷移させる
+        return;
+    }
+    Local& local = states_[resource];
+    if (local.splitting || local.queued >= 0 || Covers(local.state, state)) {
+        Transition(resource, state);
+        return;
+    }
+    barriers_.push_back(MakeTransition(resource, local.state, state, ResourceBarrierSplit::BeginOnly));
+    local.splitting = true;
+    local.splitBefore = local.state;
+    local.state = state;
+    local.transitioned = true;
+    ++stats_.transitions;
+    ++stats_.splitTransitions;
+}
+
+void ResourceStateList::EndTransition(ResourceStateKey resource, ResourceStates state)
+{
+    assert(resource != nullptr);
+    auto it = states_.find(resource);
+    if (it != states_.end() && it->second.splitting && it->second.state == state) {
+        FinishSplit(resource, it->second);
+        return;
+    }
+    // 始めたリストで終えていたか、分割しなかったもの
+    Transition(resource, state);
+}
+
+void ResourceStateList::FinishSplit(ResourceStateKey resource, Local& local)
+{
+    barriers_.push_back(MakeTransition(resource, local.splitBefore, local.state, ResourceBarrierSplit::EndOnly));
+    local.splitting = false;
+}
+
+void ResourceStateList::UavBarrier(ResourceStateKey resource)
+{
+    ResourceStateBarrier barrier;
+    barrier.type = ResourceBarrierType::Uav;
+    barrier.resource = resource;
+    barriers_.push_back(barrier);
+    ++stats_.uavBarriers;
+}
+
+void ResourceStateList::AliasingBarrier(ResourceStateKey resourceBefore, ResourceStateKey resourceAfter)
+{
+    ResourceStateBarrier barrier;
+    barrier.type = ResourceBarrierType::Aliasing;
+    barrier.resource = resourceBefore;
+    barrier.resourceAfter = resourceAfter;
+    barriers_.push_back(barrier);
+    ++stats_.aliasingBarriers;
+}
+
+const std::vector<ResourceStateBarrier>& ResourceStateList::Flush()
+{
+    // まとめた結果、元の状態に戻ったものは張らない
+    flushed_.clear();
+    for (const ResourceStateBarrier& barrier : barriers_) {
+        if (barrier.type == ResourceBarrierType::Transition) {
+            states_[barrier.resource].queued = -1;
+            if (barrier.split == ResourceBarrierSplit::None && barrier.before == barrier.after) {
+                --stats_.transitions;
+                ++stats_.mergedAvoided;
+                continue;
+            }
+        }
+        flushed_.push_back(barrier);
+    }
+    if (!flushed_.empty()) {
+        ++stats_.barrierCalls;
+    }
+    barriers_.clear();
+    return flushed_;
+}
+
+const std::vector<ResourceStateBarrier>& ResourceStateList::End()
+{
+    for (auto& [resource, local] : states_) {
+        if (local.splitting) {
+            FinishSplit(resource, local);
+        }
+    }
+    return Flush();
+}
+
+void ResourceStateList::Validate(ResourceStateKey resource, ResourceStates state)
+{
+    if (!registry_->IsValidationEnabled() || AddPending(resource, state, PendingKind::Validate)) {
+        return;
+    }
+    const Local& local = states_[resource];
+    if (local.splitting) {
+        AddError(FormatError("Resource %p used during a split barrier", resource));
+    } else if (local.queued >= 0) {
+        AddError(FormatError("Resource %p used before its barrier was flushed", resource));
+    } else if (!Covers(local.state, state)) {
+        AddError(FormatError("Resource %p used as 0x%X but tracked as 0x%X", resource, state, local.state));
+    }
+}
+
+void ResourceStateList::AddError(std::string error)
+{
+    errors_.push_back(std::move(error));
+}
+
+const std::vector<ResourceStateBarrier>& ResourceStateList::ResolvePending()
+{
+    resolved_.clear();
+    for (const Pending& pending : pending_) {
+        ResourceStates current = ResourceState_Common;
+        bool decays = false;
+        if (!registry_->Find(pending.resource, current, decays)) {
+            AddError(FormatError("Resource %p is not registered", pending.resource));
+            continue;
+        }
+        Local& local = states_[pending.resource];
+        const bool validateOnly = pending.kind == PendingKind::Validate;
+        if (current == pending.state) {
+            stats_.redundantAvoided += pending.kind == PendingKind::Transition ? 1 : 0;
+            continue;
+        }
+        // みなした状態はそこから遷移を張っているので、ちょうどその状態にしなければならない
+        if (pending.kind != PendingKind::Assume) {
+            const bool covered = Covers(current, pending.state);
+            const bool promotes = !covered && CanPromote(decays, current, pending.state);
+            if (validateOnly && !covered && !promotes) {
+                AddError(FormatError("Resource %p used as 0x%X but submitted as 0x%X", pending.resource, pending.state, current));
+                continue;
+            }
+            if (promotes) {
+                // COMMONからは最初に使ったときに暗黙に昇格する。読む状態へ昇格したテクスチャはこの提出の後にCOMMONへ戻る
+                // 昇格した後にリストの中で遷移を張ったものは、張った状態のまま残る
+                stats_.promotionsAvoided += validateOnly ? 0 : 1;
+                local.promoted = !decays && IsReadOnly(pending.state) && !local.transitioned;
+                continue;
+            }
+            if (covered && !local.transitioned) {
+                // 含む読む状態のまま使える。リストの後もその状態のまま
+                stats_.redundantAvoided += validateOnly ? 0 : 1;
+                local.state = current;
+                continue;
+            }
+        }
+        resolved_.push_back(MakeTransition(pending.resource, current, pending.state));
+        ++stats_.resolvedTransitions;
+    }
+    return resolved_;
+}
+
+void ResourceStateList::Commit()
+{
+    for (auto& [resource, local] : states_) {
+        if (local.splitting) {
+            AddError(FormatError("Resource %p split barrier was never ended", resource));
+        }
+        registry_->SetState(resource, local.state, local.promoted && IsReadOnly(local.state));
+    }
+    if (registry_->IsValidationEnabled()) {
+        for (std::string& error : errors_) {
+            registry_->AddError(std::move(error));
+        }
+    }
+    registry_->AddStats(stats_);
+    stats_ = {};
+    states_.clear();
+    pending_.clear();
+    errors_.clear();
+}
@@ -0,0 +1,107 @@
+#include "ResourceStateTracker.h"
+
+// ResourceStateListの状態はD3D12_RESOURCE_STATESと同じ値にしてあるので、そのまま置き換える
+static_assert(uint32_t(ResourceState_Common) == D3D12_RESOURCE_STATE_COMMON);
+static_assert(uint32_t(ResourceState_RenderTarget) == D3D12_RESOURCE_STATE_RENDER_TARGET);
+static_assert(uint32_t(ResourceState_UnorderedAccess) == D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+static_assert(uint32_t(ResourceState_DepthWrite) == D3D12_RESOURCE_STATE_DEPTH_WRITE);
+static_assert(uint32_t(ResourceState_DepthRead) == D3D12_RESOURCE_STATE_DEPTH_READ);
+static_assert(uint32_t(ResourceState_NonPixelShaderResource) == D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+static_assert(uint32_t(ResourceState_PixelShaderResource) == D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+static_assert(uint32_t(ResourceState_IndirectArgument) == D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+static_assert(uint32_t(ResourceState_CopyDest) == D3D12_RESOURCE_STATE_COPY_DEST);
+static_assert(uint32_t(ResourceState_CopySource) == D3D12_RESOURCE_STATE_COPY_SOURCE);
+
+void ResourceStateTracker::Begin(ID3D12GraphicsCommandList* commandList)
+{
+    commandList_ = commandList;
+    list_.Begin();
+}
+
+void ResourceStateTracker::Transition(ID3D12Resource* resource, D3D12_RESOURCE_STATES state)
+{
+    list_.Transition(resource, state);
+}
+
+void ResourceStateTracker::Assume(ID3D12Resource* resource, D3D12_RESOURCE_STATES state)
+{
+    list_.Assume(resource, state);
+}
+
+void ResourceStateTracker::BeginTransition(ID3D12Resource* resource, D3D12_RESOURCE_STATES state)
+{
+    list_.BeginTransition(resource, state);
+}
+
+void ResourceStateTracker::EndTransition(ID3D12Resource* resource, D3D12_RESOURCE_STATES state)
+{
+    list_.EndTransition(resource, state);
+}
+
+void ResourceStateTracker::UavBarrier(ID3D12Resource* resource)
+{
+    list_.UavBarrier(resource);
+}
+
+void ResourceStateTracker::AliasingBarrier(ID3D12Resource* resourceBefore, ID3D12Resource* resourceAfter)
+{
+    list_.AliasingBarrier(resourceBefore, resourceAfter);
+}
+
+void ResourceStateTracker::Flush()
+{
+    ToD3D12Barriers(list_.Flush(), barriers_);
+    if (!barriers_.empty()) {
+        commandList_->ResourceBarrier(static_cast<UINT>(barriers_.size()), barriers_.data());
+    }
+}
+
+void ResourceStateTracker::End()
+{
+    ToD3D12Barriers(list_.End(), barriers_);
+    if (!barriers_.empty()) {
+        commandList_->ResourceBarrier(static_cast<UINT>(barriers_.size()), barriers_.data());
+    }
+}
+
+void ResourceStateTracker::Validate(ID3D12Resource* resource, D3D12_RESOURCE_STATES state)
+{
+    list_.Validate(resource, state);
+}
+
+const std::vector<D3D12_RESOURCE_BARRIER>& ResourceStateTracker::ResolvePending()
+{
+    ToD3D12Barriers(list_.ResolvePending(), resolved_);
+    return resolved_;
+}
+
+void ResourceStateTracker::Commit()
+{
+    list_.Commit();
+}
+
+void ResourceStateTracker::ToD3D12Barriers(const std::vector<ResourceStateBarrier>& barriers, std::vector<D3D12_RESOURCE_BARRIER>& d3d12Barriers)
+{
+    d3d12Barriers.clear();
+    for (const ResourceStateBarrier& barrier : barriers) {
+        D3D12_RESOURCE_BARRIER d3d12Barrier {};
+        if (barrier.type == ResourceBarrierType::Transition) {
+            d3d12Barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+            d3d12Barrier.Flags = barrier.split == ResourceBarrierSplit::BeginOnly ? D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY
+                : barrier.split == ResourceBarrierSplit::EndOnly                  ? D3D12_RESOURCE_BARRIER_FLAG_END_ONLY
+                                                                                  : D3D12_RESOURCE_BARRIER_FLAG_NONE;
+            d3d12Barrier.Transition.pResource = static_cast<ID3D12Resource*>(barrier.resource);
+            d3d12Barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+            d3d12Barrier.Transition.StateBefore = static_cast<D3D12_RESOURCE_STATES>(barrier.before);
+            d3d12Barrier.Transition.StateAfter = static_cast<D3D12_RESOURCE_STATES>(barrier.after);
+        } else if (barrier.type == ResourceBarrierType::Aliasing) {
+            d3d12Barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
+            d3d12Barrier.Aliasing.pResourceBefore = static_cast<ID3D12Resource*>(barrier.resource);
+            d3d12Barrier.Aliasing.pResourceAfter = static_cast<ID3D12Resource*>(barrier.resourceAfter);
+        } else {
+            d3d12Barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+            d3d12Barrier.UAV.pResource = static_cast<ID3D12Resource*>(barrier.resource);
+        }
+        d3d12Barriers.push_back(d3d12Barrier);
+    }
+}
@@ -0,0 +1,340 @@
+#include "ShaderCache.h"
+#include "Hash.h"
+#include "ShaderIncludes.h"
+#include "ThreadPool.h"
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+// キャッシュの形式やキーの作り方を変えたら上げる
+constexpr uint32_t kShaderCacheVersion = 1;
+
+bool ReadFileBytes(const std::string& filePath, std::string& bytes)
+{
+    std::ifstream file(filePath, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    std::ostringstream stream;
+    stream << file.rdbuf();
+    bytes = stream.str();
+    return true;
+}
+
+// SourceMapのキー。DXCがインクルードに渡すパスと突き合わせられるよう絶対パスにそろえる
+std::string GetSourceKey(const std::filesystem::path& filePath)
+{
+    std::error_code error;
+    std::filesystem::path absolute = std::filesystem::absolute(filePath, error);
+    return (error ? filePath : absolute).lexically_normal().generic_string();
+}
+
+// ファイルと、#include "..."で読んでいるファイルの中身を順に足す(同じファイルは1回だけ)。ファイルが読めなければfalse
+// 読んだ中身はsourcesに残し、コンパイルにはそれを使う
+// 読めないインクルードは#ifで外れているだけかもしれないのでエラーにはせず、cacheableをfalseにする
+bool AppendSourceWithIncludes(const std::filesystem::path& filePath, std::string& keySource,
+    std::unordered_map<std::string, std::string>& sources, bool& cacheable)
+{
+    const std::string normalized = filePath.lexically_normal().generic_string();
+    const std::string sourceKey = GetSourceKey(filePath);
+    if (sources.count(sourceKey) != 0) {
+        return true;
+    }
+    std::string source;
+    if (!ReadFileBytes(normalized, source)) {
+        return false;
+    }
+    keySource += normalized;
+    keySource += '\0';
+    keySource += source;
+    keySource += '\0';
+
+    const std::vector<std::string> includes = FindShaderIncludes(source);
+    sources.emplace(sourceKey, std::move(source));
+    for (const std::string& include : includes) {
+        if (!AppendSourceWithIncludes(filePath.parent_path() / include, keySource, sources, cacheable)) {
+            cacheable = false;
+        }
+    }
+    return true;
+}
+
+// キーを作ったときに読んだ中身からインクルードを返す。無いもの(読めなかったもの)はDXCの既定の処理に任せる
+// Compileの間だけスタックに置くので、参照カウントは数えない
+class HashedIncludeHandler : public IDxcIncludeHandler {
+public:
+    HashedIncludeHandler(IDxcUtils* utils, IDxcIncludeHandler* fallback, const std::unordered_map<std::string, std::string>& sources)
+        : utils_(utils)
+        , fallback_(fallback)
+        , sources_(sources)
+    {
+    }
+
+    HRESULT STDMETHODCALLTYPE LoadSource(LPCWSTR filename, IDxcBlob** includeSource) override
+    {
+        auto it = sources_.find(GetSourceKey(std::filesystem::path(filename)));
+        if (it == sources_.end()) {
+            return fallback_->LoadSource(filename, includeSource);
+        }
+        Microsoft::WRL::ComPtr<IDxcBlobEncoding> blob;
+        HRESULT hr = utils_->CreateBlob(it->second.data(), UINT32(it->second.size()), DXC_CP_UTF8, &blob);
+        if (FAILED(hr)) {
+            return hr;
+        }
+        *includeSource = blob.Detach();
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override
+    {
+        if (riid == __uuidof(IDxcIncludeHandler) || riid == __uuidof(IUnknown)) {
+            *object = static_cast<IDxcIncludeHandler*>(this);
+            return S_OK;
+        }
+        *object = nullptr;
+        return E_NOINTERFACE;
+    }
+    ULONG STDMETHODCALLTYPE AddRef() override { return 1; }
+    ULONG STDMETHODCALLTYPE Release() override { return 1; }
+
+private:
+    IDxcUtils* utils_;
+    IDxcIncludeHandler* fallback_;
+    const std::unordered_map<std::string, std::string>& sources_;
+};
+
+void AppendWide(std::string& keySource, const std::wstring& text)
+{
+    keySource.append(reinterpret_cast<const char*>(text.data()), text.size() * sizeof(wchar_t));
+    keySource += '\0';
+}
+
+uint64_t GetCompilerVersion(IDxcCompiler3* compiler)
+{
+    Microsoft::WRL::ComPtr<IDxcVersionInfo> versionInfo;
+    UINT32 major = 0;
+    UINT32 minor = 0;
+    if (SUCCEEDED(compiler->QueryInterface(IID_PPV_ARGS(&versionInfo)))) {
+        versionInfo->GetVersion(&major, &minor);
+    }
+    return (uint64_t(major) << 32) | minor;
+}
+
+} // namespace
+
+// DXCのインスタンスは同時に使えないので、スレッドごとに1組ずつ貸し出す
+struct ShaderCache::DxcInstances {
+    Microsoft::WRL::ComPtr<IDxcUtils> utils;
+    Microsoft::WRL::ComPtr<IDxcCompiler3> compiler;
+    Microsoft::WRL::ComPtr<IDxcIncludeHandler> includeHandler;
+    uint64_t compilerVersion = 0;
+
+    bool Create()
+    {
+        if (FAILED(DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&utils))) || FAILED(DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&compiler)))
+            || FAILED(utils->CreateDefaultIncludeHandler(&includeHandler))) {
+            return false;
+        }
+        compilerVersion = GetCompilerVersion(compiler.Get());
+        return true;
+    }
+};
+
+ShaderCache::ShaderCache(std::string cacheDirectory)
+    : cacheDirectory_(std::move(cacheDirectory))
+{
+    std::error_code error;
+    std::filesystem::create_directories(cacheDirectory_, error);
+}
+
+ShaderCache::~ShaderCache() = default;
+
+const std::vector<std::wstring>& ShaderCache::GetCompileArguments()
+{
+#ifdef _DEBUG
+    static const std::vector<std::wstring> arguments = { L"-Zi", L"-Qembed_debug", L"-Od", L"-Zpr" };
+#else
+    static const std::vector<std::wstring> arguments = { L"-O3", L"-Zpr" };
+#endif
+    return arguments;
+}
+
+uint64_t ShaderCache::ComputeKey(const ShaderCompileDesc& desc, uint64_t compilerVersion, SourceMap& sources, bool& cacheable) const
+{
+    std::string keySource;
+    sources.clear();
+    cacheable = true;
+    if (!AppendSourceWithIncludes(desc.filePath, keySource, sources, cacheable)) {
+        return 0;
+    }
+    AppendWide(keySource, desc.profile);
+    for (const std::wstring& define : desc.defines) {
+        AppendWide(keySource, define);
+    }
+    for (const std::wstring& argument : GetCompileArguments()) {
+        AppendWide(keySource, argument);
+    }
+    keySource += std::format("dxc{:x} cache{}", compilerVersion, kShaderCacheVersion);
+    return HashBytes(keySource.data(), keySource.size());
+}
+
+std::string ShaderCache::GetCachePath(uint64_t key) const
+{
+    return (std::filesystem::path(cacheDirectory_) / std::format("{:016x}.dxil", key)).string();
+}
+
+std::vector<ShaderCompileResult> ShaderCache::Compile(const std::vector<ShaderCompileDesc>& descs, ThreadPool* threadPool)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::vector<ShaderCompileResult> results(descs.size());
+
+    auto processRange = [&](uint32_t begin, uint32_t end) {
+        std::unique_ptr<DxcInstances> dxc = AcquireDxc();
+        if (!dxc) {
+            for (uint32_t i = begin; i < end; ++i) {
+                results[i].messages = "failed to create the DXC instances";
+            }
+            return;
+        }
+        for (uint32_t i = begin; i < end; ++i) {
+            ShaderCompileResult& result = results[i];
+            bool cacheable = true;
+            SourceMap sources;
+            result.key = ComputeKey(descs[i], dxc->compilerVersion, sources, cacheable);
+            if (result.key == 0) {
+                result.messages = std::format("failed to read {}", descs[i].filePath);
+                continue;
+            }
+
+            // キャッシュにあればそれを使う
+            std::string cached;
+            if (cacheable && ReadFileBytes(GetCachePath(result.key), cached) && !cached.empty()) {
+                Microsoft::WRL::ComPtr<IDxcBlobEncoding> blob;
+                if (SUCCEEDED(dxc->utils->CreateBlob(cached.data(), UINT32(cached.size()), DXC_CP_ACP, &blob))) {
+                    result.blob = blob;
+                    result.cacheHit = true;
+                    continue;
+                }
+            }
+            CompileOne(descs[i], sources, result, *dxc, cacheable);
+        }
+        ReleaseDxc(std::move(dxc));
+    };
+
+    const uint32_t count = static_cast<uint32_t>(descs.size());
+    if (threadPool != nullptr && count > 1) {
+        threadPool->ParallelFor(count, 1, processRange);
+    } else {
+        processRange(0, count);
+    }
+
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    for (const ShaderCompileResult& result : results) {
+        if (result.blob == nullptr) {
+            ++stats_.failed;
+        } else if (result.cacheHit) {
+            ++stats_.hits;
+        } else {
+            ++stats_.compiled;
+        }
+    }
+    stats_.lastMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return results;
+}
+
+std::unique_ptr<ShaderCache::DxcInstances> ShaderCache::AcquireDxc()
+{
+    {
+        std::lock_guard<std::mutex> lock(dxcMutex_);
+        if (!idleDxc_.empty()) {
+            std::unique_ptr<DxcInstances> dxc = std::move(idleDxc_.back());
+            idleDxc_.pop_back();
+            return dxc;
+        }
+    }
+    auto dxc = std::make_unique<DxcInstances>();
+    return dxc->Create() ? std::move(dxc) : nullptr;
+}
+
+void ShaderCache::ReleaseDxc(std::unique_ptr<DxcInstances> dxc)
+{
+    std::lock_guard<std::mutex> lock(dxcMutex_);
+    idleDxc_.push_back(std::move(dxc));
+}
+
+void ShaderCache::CompileOne(const ShaderCompileDesc& desc, const SourceMap& sources, ShaderCompileResult& result, DxcInstances& dxc, bool writeCache)
+{
+    const std::wstring filePath = std::filesystem::path(desc.filePath).wstring();
+    // ファイルを読み直すと、ハッシュしてから保存された中身をこのキーで書いてしまう
+    auto hashed = sources.find(GetSourceKey(desc.filePath));
+    Microsoft::WRL::ComPtr<IDxcBlobEncoding> source;
+    if (hashed == sources.end()
+        || FAILED(dxc.utils->CreateBlob(hashed->second.data(), UINT32(hashed->second.size()), DXC_CP_UTF8, &source))) {
+        result.messages = std::format("failed to load {}", desc.filePath);
+        return;
+    }
+    DxcBuffer sourceBuffer;
+    sourceBuffer.Ptr = source->GetBufferPointer();
+    sourceBuffer.Size = source->GetBufferSize();
+    sourceBuffer.Encoding = DXC_CP_UTF8;
+
+    std::vector<LPCWSTR> arguments = { filePath.c_str(), L"-E", L"main", L"-T", desc.profile.c_str() };
+    for (const std::wstring& argument : GetCompileArguments()) {
+        arguments.push_back(argument.c_str());
+    }
+    for (const std::wstring& define : desc.defines) {
+        arguments.push_back(L"-D");
+        arguments.push_back(define.c_str());
+    }
+
+    HashedIncludeHandler includeHandler(dxc.utils.Get(), dxc.includeHandler.Get(), sources);
+    Microsoft::WRL::ComPtr<IDxcResult> compileResult;
+    if (FAILED(dxc.compiler->Compile(&sourceBuffer, arguments.data(), UINT32(arguments.size()), &includeHandler, IID_PPV_ARGS(&compileResult)))) {
+        result.messages = std::format("failed to run the compiler for {}", desc.filePath);
+        return;
+    }
+
+    Microsoft::WRL::ComPtr<IDxcBlobUtf8> errors;
+    compileResult->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(&errors), nullptr);
+    if (errors != nullptr && errors->GetStringLength() != 0) {
+        result.messages = errors->GetStringPointer();
+    }
+    HRESULT status = E_FAIL;
+    compileResult->GetStatus(&status);
+    Microsoft::WRL::ComPtr<IDxcBlob> blob;
+    if (FAILED(status) || FAILED(compileResult->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&blob), nullptr)) || blob == nullptr) {
+        return;
+    }
+    result.blob = blob;
+    if (!writeCache) {
+        return;
+    }
+
+    // 書きかけのファイルを読まないように、別名で書いてから置き換える
+    const std::string cachePath = GetCachePath(result.key);
+    const std::string temporaryPath = cachePath + std::format(".{}.tmp", std::hash<std::thread::id>()(std::this_thread::get_id()));
+    bool written = false;
+    {
+        std::ofstream file(temporaryPath, std::ios::binary);
+        file.write(static_cast<const char*>(blob->GetBufferPointer()), std::streamsize(blob->GetBufferSize()));
+        written = static_cast<bool>(file);
+    }
+    std::error_code error;
+    if (written) {
+        std::filesystem::rename(temporaryPath, cachePath, error);
+    }
+    if (!written || error) {
+        std::filesystem::remove(temporaryPath, error);
+    }
+}
+
+ShaderCacheStats ShaderCache::GetStats()
+{
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    return stats_;
+}
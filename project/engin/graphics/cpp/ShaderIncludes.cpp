@@ -0,0 +1,72 @@
+#include "ShaderIncludes.h"
+
+namespace {
+
+bool IsSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+}
+
+// /* */ を読み飛ばす。閉じていなければ最後まで
+size_t SkipBlockComment(const std::string& source, size_t i)
+{
+    size_t end = source.find("*/", i + 2);
+    return end == std::string::npos ? source.size() : end + 2;
+}
+
+} // namespace
+
+std::vector<std::string> FindShaderIncludes(const std::string& source)
+{
+    std::vector<std::string> includes;
+    // 行の先頭から空白とコメントしか無ければ、#は指令の始まり
+    bool lineStart = true;
+    size_t i = 0;
+    while (i < source.size()) {
+        const char c = source[i];
+        if (c == '\n') {
+            lineStart = true;
+            ++i;
+        } else if (IsSpace(c)) {
+            ++i;
+        } else if (source.compare(i, 2, "//") == 0) {
+            i = source.find('\n', i);
+            i = i == std::string::npos ? source.size() : i;
+        } else if (source.compare(i, 2, "/*") == 0) {
+            // コメントは1つの空白として扱うので、行の先頭かどうかは変わらない
+            i = SkipBlockComment(source, i);
+        } else if (c == '"') {
+            // 文字列の中の // や #include は無視する
+            for (++i; i < source.size() && source[i] != '"' && source[i] != '\n'; ++i) {
+                i += source[i] == '\\' ? 1 : 0;
+            }
+            // 閉じていなければ改行は次で処理する
+            i += i < source.size() && source[i] == '"' ? 1 : 0;
+            lineStart = false;
+        } else if (c == '#' && lineStart) {
+            size_t p = i + 1;
+            while (p < source.size() && IsSpace(source[p])) {
+                ++p;
+            }
+            if (source.compare(p, 7, "include") == 0) {
+                p += 7;
+                while (p < source.size() && IsSpace(source[p])) {
+                    ++p;
+                }
+                if (p < source.size() && source[p] == '"') {
+                    size_t close = source.find_first_of("\"\n", p + 1);
+                    if (close != std::string::npos && source[close] == '"') {
+                        includes.push_back(source.substr(p + 1, close - p - 1));
+                        p = close + 1;
+                    }
+                }
+            }
+            i = p;
+            lineStart = false;
+        } else {
+            lineStart = false;
+            ++i;
+        }
+    }
+    return includes;
+}
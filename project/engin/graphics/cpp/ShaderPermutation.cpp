@@ -0,0 +1,112 @@
+#include "ShaderPermutation.h"
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <sstream>
+
+bool ShaderPermutation::Parse(const std::string& source)
+{
+    keywords_.clear();
+    variants_.clear();
+
+    std::istringstream stream(source);
+    std::string line;
+    while (std::getline(stream, line)) {
+        std::istringstream words(line);
+        std::string comment, directive, name, requiresWord, dependency;
+        if (!(words >> comment >> directive >> name) || comment != "//" || directive != "@keyword") {
+            continue;
+        }
+        if (keywords_.size() >= kMaxKeywords || GetKeywordBit(name) != 0) {
+            return false;
+        }
+
+        Keyword keyword;
+        keyword.name = name;
+        // requiresの後ろは宣言済みのキーワードに限る
+        if (words >> requiresWord) {
+            if (requiresWord != "requires") {
+                return false;
+            }
+            while (words >> dependency) {
+                Key bit = GetKeywordBit(dependency);
+                if (bit == 0) {
+                    return false;
+                }
+                keyword.required |= bit;
+            }
+        }
+        keywords_.push_back(keyword);
+    }
+
+    const Key keyCount = Key(1) << keywords_.size();
+    for (Key key = 0; key < keyCount; ++key) {
+        if (Resolve(key) == key) {
+            variants_.push_back(key);
+        }
+    }
+    return true;
+}
+
+bool ShaderPermutation::ParseFile(const std::string& filePath)
+{
+    std::ifstream file(filePath, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    std::ostringstream source;
+    source << file.rdbuf();
+    return Parse(source.str());
+}
+
+ShaderPermutation::Key ShaderPermutation::GetKeywordBit(const std::string& name) const
+{
+    for (size_t i = 0; i < keywords_.size(); ++i) {
+        if (keywords_[i].name == name) {
+            return Key(1) << i;
+        }
+    }
+    return 0;
+}
+
+ShaderPermutation::Key ShaderPermutation::Resolve(Key key) const
+{
+    key &= (Key(1) << keywords_.size()) - 1;
+    // 前提は先に宣言されたものだけなので、前から順に落とせば連鎖も処理できる
+    for (size_t i = 0; i < keywords_.size(); ++i) {
+        if ((key & keywords_[i].required) != keywords_[i].required) {
+            key &= ~(Key(1) << i);
+        }
+    }
+    return key;
+}
+
+uint32_t ShaderPermutation::GetVariantIndex(Key key) const
+{
+    auto it = std::lower_bound(variants_.begin(), variants_.end(), key);
+    assert(it != variants_.end() && *it == key);
+    return static_cast<uint32_t>(it - variants_.begin());
+}
+
+std::vector<std::wstring> ShaderPermutation::GetDefines(Key key) const
+{
+    std::vector<std::wstring> defines;
+    for (size_t i = 0; i < keywords_.size(); ++i) {
+        std::wstring define(keywords_[i].name.begin(), keywords_[i].name.end());
+        define += (key & (Key(1) << i)) != 0 ? L"=1" : L"=0";
+        defines.push_back(define);
+    }
+    return defines;
+}
+
+std::string ShaderPermutation::GetVariantName(Key key) const
+{
+    std::string name;
+    for (size_t i = 0; i < keywords_.size(); ++i) {
+        if ((key & (Key(1) << i)) != 0) {
+            name += name.empty() ? "" : "+";
+            name += keywords_[i].name;
+        }
+    }
+    return name.empty() ? "BASE" : name;
+}
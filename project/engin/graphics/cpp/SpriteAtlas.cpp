@@ -0,0 +1,60 @@
+#include "SpriteAtlas.h"
+#include "TextureManager.h"
+#include <cassert>
+#include <cstring>
+#include <format>
+
+SpriteAtlas::SpriteAtlas(TextureManager& textureManager, std::string name, const SpriteAtlasDesc& desc)
+    : textureManager_(textureManager)
+    , name_(std::move(name))
+    , builder_(desc)
+{
+}
+
+SpriteAtlas::~SpriteAtlas()
+{
+    for (TextureHandle handle : pageTextures_) {
+        textureManager_.Release(handle);
+    }
+}
+
+uint32_t SpriteAtlas::Update()
+{
+    // 詰め直しで減ったページを解放する
+    while (pageTextures_.size() > builder_.GetPageCount()) {
+        textureManager_.Release(pageTextures_.back());
+        pageTextures_.pop_back();
+    }
+
+    uint32_t updatedPages = 0;
+    const uint32_t pageSize = builder_.GetPageSize();
+    for (uint32_t page = 0; page < builder_.GetPageCount(); ++page) {
+        if (!builder_.IsPageDirty(page) && page < pageTextures_.size()) {
+            continue;
+        }
+
+        DirectX::ScratchImage image {};
+        HRESULT hr = image.Initialize2D(DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, pageSize, pageSize, 1, 1);
+        assert(SUCCEEDED(hr));
+        const std::vector<uint8_t>& pixels = builder_.GetPagePixels(page);
+        const DirectX::Image* dst = image.GetImage(0, 0, 0);
+        for (uint32_t y = 0; y < pageSize; ++y) {
+            std::memcpy(dst->pixels + y * dst->rowPitch, &pixels[size_t(y) * pageSize * 4], size_t(pageSize) * 4);
+        }
+
+        // スプライトはミップの粗さにそろえて置いてあるので、2x2の平均で隣と混ざらない
+        DirectX::ScratchImage mipImages {};
+        hr = DirectX::GenerateMipMaps(image.GetImages(), image.GetImageCount(), image.GetMetadata(),
+            DirectX::TEX_FILTER_BOX | DirectX::TEX_FILTER_SRGB, builder_.GetMipLevels(), mipImages);
+        assert(SUCCEEDED(hr));
+
+        if (page < pageTextures_.size()) {
+            textureManager_.UpdateTexture(pageTextures_[page], std::move(mipImages));
+        } else {
+            pageTextures_.push_back(textureManager_.CreateTexture(std::format("{}/page{}", name_, page), std::move(mipImages)));
+        }
+        builder_.ClearDirty(page);
+        ++updatedPages;
+    }
+    return updatedPages;
+}
@@ -0,0 +1,195 @@
+#include "SpriteAtlasBuilder.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+// imguiのものとは別に、このファイルだけで使う実装を持つ
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "imstb_rectpack.h"
+
+struct SpriteAtlasBuilder::Page {
+    stbrp_context context {};
+    std::vector<stbrp_node> nodes;
+    std::vector<uint8_t> pixels;
+    bool dirty = true;
+};
+
+SpriteAtlasBuilder::SpriteAtlasBuilder(const SpriteAtlasDesc& desc)
+    : desc_(desc)
+{
+    assert(desc_.mipLevels >= 1 && (desc_.pageSize >> (desc_.mipLevels - 1)) > 0);
+    cellSize_ = 1u << (desc_.mipLevels - 1);
+    if (desc_.padding == 0) {
+        desc_.padding = cellSize_;
+    }
+    // 縁がセルの倍数でないと、スプライトの位置がミップの境目からずれる
+    assert(desc_.padding % cellSize_ == 0);
+}
+
+SpriteAtlasBuilder::~SpriteAtlasBuilder() = default;
+
+uint32_t SpriteAtlasBuilder::AddSprite(uint32_t width, uint32_t height, const uint8_t* pixels, uint32_t rowPitch)
+{
+    assert(width + desc_.padding * 2 <= desc_.pageSize && height + desc_.padding * 2 <= desc_.pageSize);
+
+    uint32_t id;
+    if (!freeIds_.empty()) {
+        id = freeIds_.back();
+        freeIds_.pop_back();
+    } else {
+        id = static_cast<uint32_t>(sprites_.size());
+        sprites_.emplace_back();
+    }
+
+    Sprite& sprite = sprites_[id];
+    sprite = Sprite {};
+    sprite.width = width;
+    sprite.height = height;
+    sprite.alive = true;
+    sprite.pixels.resize(size_t(width) * height * 4);
+    for (uint32_t y = 0; y < height; ++y) {
+        std::memcpy(&sprite.pixels[size_t(y) * width * 4], pixels + size_t(y) * rowPitch, size_t(width) * 4);
+    }
+    return id;
+}
+
+void SpriteAtlasBuilder::RemoveSprite(uint32_t id)
+{
+    Sprite& sprite = sprites_[id];
+    assert(sprite.alive);
+    if (sprite.placed) {
+        Clear(*pages_[sprite.region.page], sprite.region);
+    }
+    sprite = Sprite {};
+    freeIds_.push_back(id);
+}
+
+void SpriteAtlasBuilder::Pack()
+{
+    // 縁を含めてセル単位に切り上げた大きさで詰める
+    [[maybe_unused]] const uint32_t cellsPerPage = desc_.pageSize / cellSize_;
+    std::vector<stbrp_rect> rects;
+    for (uint32_t id = 0; id < sprites_.size(); ++id) {
+        const Sprite& sprite = sprites_[id];
+        if (sprite.alive && !sprite.placed) {
+            stbrp_rect rect {};
+            rect.id = static_cast<int>(id);
+            rect.w = static_cast<stbrp_coord>((sprite.width + desc_.padding * 2 + cellSize_ - 1) / cellSize_);
+            rect.h = static_cast<stbrp_coord>((sprite.height + desc_.padding * 2 + cellSize_ - 1) / cellSize_);
+            assert(uint32_t(rect.w) <= cellsPerPage && uint32_t(rect.h) <= cellsPerPage);
+            rects.push_back(rect);
+        }
+    }
+
+    for (uint32_t pageIndex = 0; !rects.empty(); ++pageIndex) {
+        const bool newPage = pageIndex >= pages_.size();
+        Page& page = newPage ? *AddPage() : *pages_[pageIndex];
+        stbrp_pack_rects(&page.context, rects.data(), static_cast<int>(rects.size()));
+
+        std::vector<stbrp_rect> remaining;
+        for (const stbrp_rect& rect : rects) {
+            if (!rect.was_packed) {
+                remaining.push_back(rect);
+                continue;
+            }
+            Sprite& sprite = sprites_[rect.id];
+            AtlasRegion& region = sprite.region;
+            region.page = pageIndex;
+            region.x = uint32_t(rect.x) * cellSize_ + desc_.padding;
+            region.y = uint32_t(rect.y) * cellSize_ + desc_.padding;
+            region.width = sprite.width;
+            region.height = sprite.height;
+            const float invPageSize = 1.0f / float(desc_.pageSize);
+            region.u0 = float(region.x) * invPageSize;
+            region.v0 = float(region.y) * invPageSize;
+            region.u1 = float(region.x + region.width) * invPageSize;
+            region.v1 = float(region.y + region.height) * invPageSize;
+            sprite.placed = true;
+            Blit(page, sprite);
+        }
+        // 新しいページにすら入らないものは無い(AddSpriteで大きさを確認している)
+        assert(remaining.size() < rects.size() || !newPage);
+        rects = std::move(remaining);
+    }
+}
+
+void SpriteAtlasBuilder::Repack()
+{
+    pages_.clear();
+    for (Sprite& sprite : sprites_) {
+        sprite.placed = false;
+    }
+    // stbrpが高さ順に並べ替えてから詰めるので、まとめて渡すほど隙間が少ない
+    Pack();
+}
+
+const std::vector<uint8_t>& SpriteAtlasBuilder::GetPagePixels(uint32_t page) const
+{
+    return pages_[page]->pixels;
+}
+
+bool SpriteAtlasBuilder::IsPageDirty(uint32_t page) const
+{
+    return pages_[page]->dirty;
+}
+
+void SpriteAtlasBuilder::ClearDirty(uint32_t page)
+{
+    pages_[page]->dirty = false;
+}
+
+SpriteAtlasStats SpriteAtlasBuilder::GetStats() const
+{
+    SpriteAtlasStats stats;
+    uint64_t usedPixels = 0;
+    for (const Sprite& sprite : sprites_) {
+        if (sprite.alive) {
+            ++stats.spriteCount;
+            usedPixels += uint64_t(sprite.width) * sprite.height;
+        }
+    }
+    stats.pageCount = GetPageCount();
+    if (stats.pageCount > 0) {
+        stats.occupancy = float(double(usedPixels) / (double(desc_.pageSize) * desc_.pageSize * stats.pageCount));
+    }
+    return stats;
+}
+
+SpriteAtlasBuilder::Page* SpriteAtlasBuilder::AddPage()
+{
+    const uint32_t cellsPerPage = desc_.pageSize / cellSize_;
+    auto page = std::make_unique<Page>();
+    page->nodes.resize(cellsPerPage);
+    stbrp_init_target(&page->context, int(cellsPerPage), int(cellsPerPage), page->nodes.data(), int(cellsPerPage));
+    page->pixels.assign(size_t(desc_.pageSize) * desc_.pageSize * 4, 0);
+    pages_.push_back(std::move(page));
+    return pages_.back().get();
+}
+
+void SpriteAtlasBuilder::Blit(Page& page, const Sprite& sprite)
+{
+    // 縁には一番近い端のピクセルを複製し、バイリニアやミップで透明が混ざらないようにする
+    const AtlasRegion& region = sprite.region;
+    const int32_t padding = int32_t(desc_.padding);
+    for (int32_t y = -padding; y < int32_t(sprite.height) + padding; ++y) {
+        const uint32_t srcY = uint32_t(std::clamp(y, 0, int32_t(sprite.height) - 1));
+        uint8_t* dst = &page.pixels[(size_t(int32_t(region.y) + y) * desc_.pageSize + region.x - padding) * 4];
+        const uint8_t* srcRow = &sprite.pixels[size_t(srcY) * sprite.width * 4];
+        for (int32_t x = -padding; x < int32_t(sprite.width) + padding; ++x) {
+            const uint32_t srcX = uint32_t(std::clamp(x, 0, int32_t(sprite.width) - 1));
+            std::memcpy(dst, srcRow + size_t(srcX) * 4, 4);
+            dst += 4;
+        }
+    }
+    page.dirty = true;
+}
+
+void SpriteAtlasBuilder::Clear(Page& page, const AtlasRegion& region)
+{
+    const uint32_t padding = desc_.padding;
+    for (uint32_t y = region.y - padding; y < region.y + region.height + padding; ++y) {
+        std::memset(&page.pixels[(size_t(y) * desc_.pageSize + region.x - padding) * 4], 0, size_t(region.width + padding * 2) * 4);
+    }
+    page.dirty = true;
+}
@@ -0,0 +1,76 @@
+#include "SpriteBatch.h"
+#include "FrameContext.h"
+#include <algorithm>
+#include <cassert>
+
+void SpriteBatch::Initialize(GpuMemoryAllocator& gpuMemory)
+{
+    // 板ごとに 左上-右上-左下, 左下-右上-右下
+    const uint32_t indexCount = kMaxSpritesPerDraw * 6;
+    indexBuffer_ = gpuMemory.CreateBuffer(sizeof(uint16_t) * indexCount);
+    uint16_t* indices = nullptr;
+    HRESULT hr = indexBuffer_.resource->Map(0, nullptr, reinterpret_cast<void**>(&indices));
+    assert(SUCCEEDED(hr));
+    for (uint32_t sprite = 0; sprite < kMaxSpritesPerDraw; ++sprite) {
+        uint16_t base = static_cast<uint16_t>(sprite * 4);
+        uint16_t* quad = indices + sprite * 6;
+        quad[0] = base;
+        quad[1] = base + 1;
+        quad[2] = base + 2;
+        quad[3] = base + 2;
+        quad[4] = base + 1;
+        quad[5] = base + 3;
+    }
+    indexBuffer_.resource->Unmap(0, nullptr);
+
+    indexBufferView_.BufferLocation = indexBuffer_.resource->GetGPUVirtualAddress();
+    indexBufferView_.SizeInBytes = sizeof(uint16_t) * indexCount;
+    indexBufferView_.Format = DXGI_FORMAT_R16_UINT;
+}
+
+void SpriteBatch::Clear()
+{
+    quads_.Clear();
+    vertexBufferView_ = {};
+}
+
+void SpriteBatch::Build(FrameContextRing& frameContexts)
+{
+    quads_.Sort();
+    vertexBufferView_ = {};
+    const uint32_t spriteCount = GetSpriteCount();
+    if (spriteCount == 0) {
+        return;
+    }
+    const uint32_t sizeInBytes = sizeof(SpriteVertex) * 4 * spriteCount;
+    FrameUpload upload = frameContexts.AllocateUpload(sizeInBytes);
+    quads_.WriteVertices(static_cast<SpriteVertex*>(upload.cpuAddress));
+    vertexBufferView_.BufferLocation = upload.gpuAddress;
+    vertexBufferView_.SizeInBytes = sizeInBytes;
+    vertexBufferView_.StrideInBytes = sizeof(SpriteVertex);
+}
+
+void SpriteBatch::Record(ID3D12GraphicsCommandList* commandList, UINT rootParameterIndex,
+    const std::function<D3D12_GPU_DESCRIPTOR_HANDLE(uint32_t textureId)>& getTexture) const
+{
+    if (vertexBufferView_.SizeInBytes == 0) {
+        return;
+    }
+    commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    commandList->IASetVertexBuffers(0, 1, &vertexBufferView_);
+    commandList->IASetIndexBuffer(&indexBufferView_);
+
+    const SpriteQuadBuilder::Batch* previous = nullptr;
+    for (const SpriteQuadBuilder::Batch& batch : quads_.GetBatches()) {
+        // レイヤーが変わっても同じテクスチャなら設定し直さない
+        if (previous == nullptr || previous->textureId != batch.textureId) {
+            commandList->SetGraphicsRootDescriptorTable(rootParameterIndex, getTexture(batch.textureId));
+        }
+        previous = &batch;
+        // インデックスは共有なので、区切った先頭の頂点をずらして描く
+        for (uint32_t offset = 0; offset < batch.count; offset += kMaxSpritesPerDraw) {
+            uint32_t count = std::min(kMaxSpritesPerDraw, batch.count - offset);
+            commandList->DrawIndexedInstanced(count * 6, 1, 0, static_cast<INT>((batch.first + offset) * 4), 0);
+        }
+    }
+}
@@ -0,0 +1,241 @@
+#include "SpriteQuadBuilder.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SPRITE_QUAD_BUILDER_SSE2
+#endif
+
+namespace {
+
+// 1チャンクの最小枚数(小さすぎるとスレッドの受け渡しの方が高くつく)
+constexpr uint32_t kMinSpritesPerChunk = 1024;
+
+// 板の4隅。左上、右上、左下、右下の順(画面はyが下向き)
+constexpr float kCornerX[4] = { -0.5f, 0.5f, -0.5f, 0.5f };
+constexpr float kCornerY[4] = { -0.5f, -0.5f, 0.5f, 0.5f };
+
+// 1枚ずつ標準のsin/cosで作る
+void WriteSpritesScalar(const Sprite* sprites, const SortKey* order, uint32_t begin, uint32_t end, SpriteVertex* output)
+{
+    for (uint32_t i = begin; i < end; ++i) {
+        const Sprite& sprite = sprites[order[i].index];
+        float sine = std::sin(sprite.rotation);
+        float cosine = std::cos(sprite.rotation);
+        const float u[4] = { sprite.uvRect.x, sprite.uvRect.z, sprite.uvRect.x, sprite.uvRect.z };
+        const float v[4] = { sprite.uvRect.y, sprite.uvRect.y, sprite.uvRect.w, sprite.uvRect.w };
+        SpriteVertex* vertices = output + size_t(i) * 4;
+        for (int corner = 0; corner < 4; ++corner) {
+            float x = kCornerX[corner] * sprite.scale.x;
+            float y = kCornerY[corner] * sprite.scale.y;
+            vertices[corner].position = { sprite.position.x + x * cosine - y * sine, sprite.position.y + x * sine + y * cosine };
+            vertices[corner].texcoord = { u[corner], v[corner] };
+            vertices[corner].color = sprite.color;
+        }
+    }
+}
+
+#ifdef SPRITE_QUAD_BUILDER_SSE2
+
+__m128 Select(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// 4つの角度のsinとcosをまとめて求める(誤差は1e-6程度)
+// [-π, π]に寄せてから[-π/2, π/2]に折り返し、その範囲の多項式で近似する
+void SinCos(__m128 angle, __m128& sine, __m128& cosine)
+{
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 pi = _mm_set1_ps(3.14159265358979f);
+    const __m128 halfPi = _mm_set1_ps(1.57079632679490f);
+
+    __m128 turns = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(angle, _mm_set1_ps(0.159154943091895f))));
+    __m128 x = _mm_sub_ps(angle, _mm_mul_ps(turns, _mm_set1_ps(6.28318530717959f)));
+
+    // π/2より外はπ-xに折り返す。sinはそのまま、cosは符号が変わる
+    __m128 sign = _mm_and_ps(x, signMask);
+    __m128 fold = _mm_cmpgt_ps(_mm_andnot_ps(signMask, x), halfPi);
+    x = Select(fold, _mm_sub_ps(_mm_or_ps(pi, sign), x), x);
+    __m128 cosineSign = _mm_and_ps(fold, signMask);
+
+    __m128 x2 = _mm_mul_ps(x, x);
+    __m128 s = _mm_set1_ps(-2.5052108e-8f);
+    s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(2.7557319e-6f));
+    s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(-1.9841270e-4f));
+    s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(8.3333333e-3f));
+    s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(-1.6666667e-1f));
+    sine = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, x2), x), x);
+
+    __m128 c = _mm_set1_ps(-1.1470746e-11f);
+    c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(2.0876757e-9f));
+    c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(-2.7557319e-7f));
+    c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(2.4801587e-5f));
+    c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(-1.3888889e-3f));
+    c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(4.1666667e-2f));
+    c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(-0.5f));
+    c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(1.0f));
+    cosine = _mm_xor_ps(c, cosineSign);
+}
+
+// 4枚ずつsin/cosを求め、1枚の4頂点(80バイト)を5つの16バイトに組んで書く
+// outputが16バイトにそろっていれば、キャッシュを通さないストリーミングストアで書く(アップロードヒープは書き込み結合なのでそのまま流せる)
+void WriteSpritesSse2(const Sprite* sprites, const SortKey* order, uint32_t begin, uint32_t end, SpriteVertex* output)
+{
+    const bool streaming = (reinterpret_cast<uintptr_t>(output) & 15) == 0;
+    const __m128 cornerX = _mm_loadu_ps(kCornerX);
+    const __m128 cornerY = _mm_loadu_ps(kCornerY);
+
+    for (uint32_t group = begin; group < end; group += 4) {
+        uint32_t groupCount = std::min(4u, end - group);
+        alignas(16) float rotations[4] = {};
+        for (uint32_t k = 0; k < groupCount; ++k) {
+            rotations[k] = sprites[order[group + k].index].rotation;
+        }
+        __m128 sines;
+        __m128 cosines;
+        SinCos(_mm_load_ps(rotations), sines, cosines);
+        alignas(16) float sine[4];
+        alignas(16) float cosine[4];
+        _mm_store_ps(sine, sines);
+        _mm_store_ps(cosine, cosines);
+
+        for (uint32_t k = 0; k < groupCount; ++k) {
+            const Sprite& sprite = sprites[order[group + k].index];
+            __m128 s = _mm_set1_ps(sine[k]);
+            __m128 c = _mm_set1_ps(cosine[k]);
+            __m128 x = _mm_mul_ps(cornerX, _mm_set1_ps(sprite.scale.x));
+            __m128 y = _mm_mul_ps(cornerY, _mm_set1_ps(sprite.scale.y));
+            __m128 positionX = _mm_add_ps(_mm_set1_ps(sprite.position.x), _mm_sub_ps(_mm_mul_ps(x, c), _mm_mul_ps(y, s)));
+            __m128 positionY = _mm_add_ps(_mm_set1_ps(sprite.position.y), _mm_add_ps(_mm_mul_ps(x, s), _mm_mul_ps(y, c)));
+            __m128 xy01 = _mm_unpacklo_ps(positionX, positionY); // x0 y0 x1 y1
+            __m128 xy23 = _mm_unpackhi_ps(positionX, positionY); // x2 y2 x3 y3
+            __m128 uv = _mm_loadu_ps(&sprite.uvRect.x); // u0 v0 u1 v1
+            __m128 color = _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(sprite.color)));
+
+            // x0 y0 u0 v0 | c x1 y1 u1 | v0 c x2 y2 | u0 v1 c x3 | y3 u1 v1 c
+            __m128 xyu1 = _mm_shuffle_ps(xy01, uv, _MM_SHUFFLE(2, 2, 3, 2));
+            __m128 out0 = _mm_movelh_ps(xy01, uv);
+            __m128 out1 = _mm_move_ss(_mm_shuffle_ps(xyu1, xyu1, _MM_SHUFFLE(2, 1, 0, 0)), color);
+            __m128 out2 = _mm_shuffle_ps(_mm_shuffle_ps(uv, color, _MM_SHUFFLE(0, 0, 1, 1)), xy23, _MM_SHUFFLE(1, 0, 2, 0));
+            __m128 out3 = _mm_shuffle_ps(uv, _mm_shuffle_ps(color, xy23, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 0, 3, 0));
+            __m128 out4 = _mm_shuffle_ps(_mm_shuffle_ps(xy23, uv, _MM_SHUFFLE(2, 2, 3, 3)), _mm_shuffle_ps(uv, color, _MM_SHUFFLE(0, 0, 3, 3)),
+                _MM_SHUFFLE(2, 0, 2, 0));
+
+            float* destination = reinterpret_cast<float*>(output + size_t(group + k) * 4);
+            if (streaming) {
+                _mm_stream_ps(destination, out0);
+                _mm_stream_ps(destination + 4, out1);
+                _mm_stream_ps(destination + 8, out2);
+                _mm_stream_ps(destination + 12, out3);
+                _mm_stream_ps(destination + 16, out4);
+            } else {
+                _mm_storeu_ps(destination, out0);
+                _mm_storeu_ps(destination + 4, out1);
+                _mm_storeu_ps(destination + 8, out2);
+                _mm_storeu_ps(destination + 12, out3);
+                _mm_storeu_ps(destination + 16, out4);
+            }
+        }
+    }
+    if (streaming) {
+        _mm_sfence();
+    }
+}
+
+#endif
+
+} // namespace
+
+uint32_t PackSpriteColor(const Vector4& color)
+{
+    auto toByte = [](float value) { return static_cast<uint32_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f); };
+    return toByte(color.x) | (toByte(color.y) << 8) | (toByte(color.z) << 16) | (toByte(color.w) << 24);
+}
+
+SpriteQuadBuilder::SpriteQuadBuilder(ThreadPool* threadPool)
+    : threadPool_(threadPool)
+{
+    static_assert(sizeof(SpriteVertex) == 20, "SpriteVertex must match the input layout");
+    static_assert(sizeof(Sprite::uvRect) == 16, "uvRect is loaded as one vector");
+}
+
+uint32_t SpriteQuadBuilder::GetMaxThreadCount() const
+{
+    return threadPool_ ? threadPool_->GetThreadCount() + 1 : 1;
+}
+
+void SpriteQuadBuilder::Clear()
+{
+    sprites_.clear();
+    keys_.clear();
+    batches_.clear();
+}
+
+void SpriteQuadBuilder::Draw(uint32_t textureId, const Sprite& sprite, uint16_t layer)
+{
+    keys_.push_back({ (uint64_t(layer) << 32) | textureId, static_cast<uint32_t>(sprites_.size()) });
+    sprites_.push_back(sprite);
+}
+
+void SpriteQuadBuilder::Sort()
+{
+    auto start = std::chrono::steady_clock::now();
+
+    // 安定なので、同じテクスチャの中は積んだ順のまま
+    RadixSort(keys_, sortScratch_, threadPool_);
+
+    batches_.clear();
+    stats_.drawCount = 0;
+    for (uint32_t i = 0; i < keys_.size(); ++i) {
+        if (batches_.empty() || keys_[i].key != keys_[i - 1].key) {
+            batches_.push_back({ static_cast<uint32_t>(keys_[i].key), i, 0 });
+        }
+        ++batches_.back().count;
+    }
+    for (const Batch& batch : batches_) {
+        stats_.drawCount += (batch.count + kMaxSpritesPerDraw - 1) / kMaxSpritesPerDraw;
+    }
+    stats_.spriteCount = GetSpriteCount();
+    stats_.batchCount = static_cast<uint32_t>(batches_.size());
+    stats_.sortMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void SpriteQuadBuilder::WriteVertices(SpriteVertex* output)
+{
+    auto start = std::chrono::steady_clock::now();
+    const uint32_t spriteCount = GetSpriteCount();
+
+    // SIMDで4枚ずつ処理するので、区切りも4の倍数にする
+    uint32_t threadCount = std::clamp(threadCount_ == 0 ? GetMaxThreadCount() : threadCount_, 1u, GetMaxThreadCount());
+    uint32_t grainSize = std::max(kMinSpritesPerChunk, (spriteCount + threadCount - 1) / threadCount);
+    grainSize = (grainSize + 3) & ~3u;
+
+#ifdef SPRITE_QUAD_BUILDER_SSE2
+    const bool simd = simdEnabled_;
+#else
+    const bool simd = false;
+#endif
+    auto writeRange = [&](uint32_t begin, uint32_t end) {
+#ifdef SPRITE_QUAD_BUILDER_SSE2
+        if (simd) {
+            WriteSpritesSse2(sprites_.data(), keys_.data(), begin, end, output);
+            return;
+        }
+#endif
+        WriteSpritesScalar(sprites_.data(), keys_.data(), begin, end, output);
+    };
+    if (threadPool_ != nullptr && threadCount > 1 && spriteCount > grainSize) {
+        threadPool_->ParallelFor(spriteCount, grainSize, writeRange);
+    } else {
+        writeRange(0, spriteCount);
+    }
+
+    stats_.threadCount = spriteCount > 0 ? std::min(threadCount, (spriteCount + grainSize - 1) / grainSize) : 0;
+    stats_.simd = simd;
+    stats_.buildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    stats_.spritesPerSecond = stats_.buildMilliseconds > 0.0 ? spriteCount / (stats_.buildMilliseconds * 0.001) : 0.0;
+}
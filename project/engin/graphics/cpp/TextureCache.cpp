@@ -0,0 +1,192 @@
+#include "TextureCache.h"
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+
+std::string TextureCache::NormalizePath(const std::string& path)
+{
+    std::string unified = path;
+    for (char& c : unified) {
+        c = c == '\\' ? '/' : static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+
+    // "."は捨て、".."は一つ前の要素を取り消す
+    std::vector<std::string> parts;
+    size_t start = 0;
+    while (start <= unified.size()) {
+        size_t end = unified.find('/', start);
+        if (end == std::string::npos) {
+            end = unified.size();
+        }
+        std::string part = unified.substr(start, end - start);
+        if (part == "..") {
+            if (!parts.empty() && parts.back() != "..") {
+                parts.pop_back();
+            } else {
+                parts.push_back(part);
+            }
+        } else if (!part.empty() && part != ".") {
+            parts.push_back(part);
+        }
+        start = end + 1;
+    }
+
+    std::string result = !unified.empty() && unified[0] == '/' ? "/" : "";
+    for (size_t i = 0; i < parts.size(); ++i) {
+        if (i != 0) {
+            result += '/';
+        }
+        result += parts[i];
+    }
+    return result;
+}
+
+TextureHandle TextureCache::AcquireByPath(const std::string& normalizedPath)
+{
+    auto it = pathTable_.find(normalizedPath);
+    if (it == pathTable_.end()) {
+        return kInvalidTextureHandle;
+    }
+    Entry* entry = Find(it->second);
+    ++stats_.requests;
+    ++entry->refCount;
+    ++stats_.pathHits;
+    stats_.bytesSaved += entry->byteSize;
+    return it->second;
+}
+
+TextureHandle TextureCache::AcquireByContent(const std::string& normalizedPath, uint64_t contentHash, const std::function<bool(TextureHandle)>& isSameContent)
+{
+    auto [first, last] = contentTable_.equal_range(contentHash);
+    for (auto it = first; it != last; ++it) {
+        if (!isSameContent(it->second)) {
+            continue;
+        }
+        Entry* entry = Find(it->second);
+        ++stats_.requests;
+        ++entry->refCount;
+        ++stats_.contentHits;
+        stats_.bytesSaved += entry->byteSize;
+        // 次からはパスで見つかるようにしておく
+        entry->paths.push_back(normalizedPath);
+        pathTable_[normalizedPath] = it->second;
+        return it->second;
+    }
+    return kInvalidTextureHandle;
+}
+
+TextureHandle TextureCache::Insert(const std::string& normalizedPath, uint64_t contentHash, uint64_t byteSize)
+{
+    TextureHandle handle;
+    if (!freeHandles_.empty()) {
+        handle = freeHandles_.back();
+        freeHandles_.pop_back();
+    } else {
+        entries_.emplace_back();
+        handle = static_cast<TextureHandle>(entries_.size());
+    }
+
+    Entry& entry = entries_[handle - 1];
+    entry.contentHash = contentHash;
+    entry.byteSize = byteSize;
+    entry.refCount = 1;
+    entry.paths = { normalizedPath };
+    pathTable_[normalizedPath] = handle;
+    contentTable_.emplace(contentHash, handle);
+
+    ++stats_.requests;
+    ++stats_.uniqueTextures;
+    stats_.residentBytes += byteSize;
+    return handle;
+}
+
+void TextureCache::AddRef(TextureHandle handle)
+{
+    Entry* entry = Find(handle);
+    assert(entry != nullptr && entry->refCount > 0);
+    if (entry == nullptr || entry->refCount == 0) {
+        return;
+    }
+    ++entry->refCount;
+}
+
+bool TextureCache::Release(TextureHandle handle)
+{
+    Entry* entry = Find(handle);
+    assert(entry != nullptr && entry->refCount > 0);
+    if (entry == nullptr || entry->refCount == 0) {
+        return false;
+    }
+    if (--entry->refCount > 0) {
+        return false;
+    }
+
+    for (const std::string& path : entry->paths) {
+        pathTable_.erase(path);
+    }
+    EraseContent(entry->contentHash, handle);
+    --stats_.uniqueTextures;
+    stats_.residentBytes -= entry->byteSize;
+
+    *entry = Entry {};
+    freeHandles_.push_back(handle);
+    return true;
+}
+
+TextureHandle TextureCache::FindByPath(const std::string& normalizedPath) const
+{
+    auto it = pathTable_.find(normalizedPath);
+    return it != pathTable_.end() ? it->second : kInvalidTextureHandle;
+}
+
+void TextureCache::UpdateContent(TextureHandle handle, uint64_t contentHash, uint64_t byteSize)
+{
+    Entry* entry = Find(handle);
+    assert(entry != nullptr && entry->refCount > 0);
+    EraseContent(entry->contentHash, handle);
+    // 同じ中身のテクスチャが既にあっても、そちらとは別のまま扱う
+    contentTable_.emplace(contentHash, handle);
+    stats_.residentBytes += byteSize;
+    stats_.residentBytes -= entry->byteSize;
+    entry->contentHash = contentHash;
+    entry->byteSize = byteSize;
+}
+
+bool TextureCache::IsValid(TextureHandle handle) const
+{
+    const Entry* entry = Find(handle);
+    return entry != nullptr && entry->refCount > 0;
+}
+
+uint32_t TextureCache::GetRefCount(TextureHandle handle) const
+{
+    const Entry* entry = Find(handle);
+    return entry ? entry->refCount : 0;
+}
+
+TextureCache::Entry* TextureCache::Find(TextureHandle handle)
+{
+    if (handle == kInvalidTextureHandle || handle > entries_.size()) {
+        return nullptr;
+    }
+    return &entries_[handle - 1];
+}
+
+const TextureCache::Entry* TextureCache::Find(TextureHandle handle) const
+{
+    if (handle == kInvalidTextureHandle || handle > entries_.size()) {
+        return nullptr;
+    }
+    return &entries_[handle - 1];
+}
+
+void TextureCache::EraseContent(uint64_t contentHash, TextureHandle handle)
+{
+    auto [first, last] = contentTable_.equal_range(contentHash);
+    for (auto it = first; it != last; ++it) {
+        if (it->second == handle) {
+            contentTable_.erase(it);
+            return;
+        }
+    }
+}
@@ -0,0 +1,238 @@
+#include "TextureCooker.h"
+#include "GpakArchive.h"
+#include "Hash.h"
+#include "TextureCache.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+const char* const kManifestFileName = "manifest.txt";
+
+std::string GetStem(const std::string& filePath)
+{
+    std::string stem = std::filesystem::path(filePath).stem().string();
+    std::transform(stem.begin(), stem.end(), stem.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return stem;
+}
+
+bool EndsWith(const std::string& text, const std::string& suffix)
+{
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+} // namespace
+
+TextureCooker::TextureCooker(std::string cookedDirectory)
+    : cookedDirectory_(std::move(cookedDirectory))
+{
+    manifest_ = ReadManifest(cookedDirectory_);
+}
+
+TextureUsage TextureCooker::GuessUsage(const std::string& filePath)
+{
+    const std::string stem = GetStem(filePath);
+    for (const char* suffix : { "_n", "_normal", "_nrm" }) {
+        if (EndsWith(stem, suffix)) {
+            return TextureUsage::Normal;
+        }
+    }
+    for (const char* suffix : { "_mask", "_m", "_rough", "_roughness", "_metal", "_ao" }) {
+        if (EndsWith(stem, suffix)) {
+            return TextureUsage::Mask;
+        }
+    }
+    return TextureUsage::Albedo;
+}
+
+DXGI_FORMAT TextureCooker::GetCookedFormat(TextureUsage usage)
+{
+    switch (usage) {
+    case TextureUsage::Normal:
+        return DXGI_FORMAT_BC5_UNORM;
+    case TextureUsage::Mask:
+        return DXGI_FORMAT_BC4_UNORM;
+    default:
+        return DXGI_FORMAT_BC7_UNORM_SRGB;
+    }
+}
+
+std::vector<std::string> TextureCooker::FindSourceFiles(const std::string& directory, const std::string& cookedDirectory)
+{
+    const std::filesystem::path cookedPath = std::filesystem::path(cookedDirectory).lexically_normal();
+    std::vector<std::string> files;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(directory)) {
+        if (!entry.is_regular_file()) {
+            continue;
+        }
+        const std::filesystem::path path = entry.path().lexically_normal();
+        if (std::mismatch(cookedPath.begin(), cookedPath.end(), path.begin(), path.end()).first == cookedPath.end()) {
+            continue;
+        }
+        std::string extension = path.extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".bmp") {
+            files.push_back(path.generic_string());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+std::unordered_map<std::string, CookedTextureEntry> TextureCooker::ReadManifest(const std::string& cookedDirectory, const GpakArchive* archive)
+{
+    // 1行に「ハッシュ(16進) クック後のファイル名 元ファイルのパス」
+    std::unordered_map<std::string, CookedTextureEntry> manifest;
+    AssetBytes bytes;
+    if (!ReadAssetBytes(archive, (std::filesystem::path(cookedDirectory) / kManifestFileName).string(), bytes)) {
+        return manifest;
+    }
+    std::istringstream file(std::string(reinterpret_cast<const char*>(bytes.data), bytes.size));
+    std::string line;
+    while (std::getline(file, line)) {
+        // テキストモードで書いたので改行が\r\nのまま残る
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        std::istringstream stream(line);
+        std::string hash;
+        CookedTextureEntry entry;
+        if (!(stream >> hash >> entry.cookedFileName)) {
+            continue;
+        }
+        std::string sourcePath;
+        std::getline(stream >> std::ws, sourcePath);
+        entry.sourceHash = std::stoull(hash, nullptr, 16);
+        manifest[TextureCache::NormalizePath(sourcePath)] = entry;
+    }
+    return manifest;
+}
+
+TextureCookerStats TextureCooker::Cook(const std::vector<std::string>& sourceFiles, ThreadPool& threadPool)
+{
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    std::filesystem::create_directories(cookedDirectory_);
+
+    TextureCookerStats stats;
+    threadPool.ParallelFor(static_cast<uint32_t>(sourceFiles.size()), 1, [&](uint32_t first, uint32_t last) {
+        for (uint32_t i = first; i < last; ++i) {
+            CookFile(sourceFiles[i], stats);
+        }
+    });
+
+    WriteManifest();
+    stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    return stats;
+}
+
+bool TextureCooker::CookSingle(const std::string& sourceFile, CookedTextureEntry& entry)
+{
+    TextureCookerStats stats;
+    CookFile(sourceFile, stats);
+    if (stats.failed != 0) {
+        return false;
+    }
+    WriteManifest();
+    std::lock_guard<std::mutex> lock(mutex_);
+    entry = manifest_.at(TextureCache::NormalizePath(sourceFile));
+    return true;
+}
+
+bool TextureCooker::IsCooked(const std::string& sourceFile) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return manifest_.count(TextureCache::NormalizePath(sourceFile)) != 0;
+}
+
+void TextureCooker::CookFile(const std::string& sourceFile, TextureCookerStats& stats)
+{
+    const std::string normalizedPath = TextureCache::NormalizePath(sourceFile);
+    const TextureUsage usage = GuessUsage(sourceFile);
+
+    std::vector<uint8_t> fileBytes;
+    {
+        std::ifstream file(sourceFile, std::ios::binary);
+        fileBytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    const uint64_t sourceHash = HashBytes(fileBytes.data(), fileBytes.size());
+    const std::string cookedFileName = std::format("{:016x}_{}.dds", sourceHash, static_cast<int>(usage));
+    const std::filesystem::path cookedPath = std::filesystem::path(cookedDirectory_) / cookedFileName;
+
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        // 中身が同じ別ファイルを今クックしているなら、終わるのを待ってその結果を使う
+        // 失敗していたらファイルが無いので、こちらでクックし直す
+        bool waited = false;
+        cookedCondition_.wait(lock, [&] {
+            const bool cooking = cookingFiles_.count(cookedFileName) != 0;
+            waited = waited || cooking;
+            return !cooking;
+        });
+        auto it = manifest_.find(normalizedPath);
+        const bool recorded = it != manifest_.end() && it->second.sourceHash == sourceHash;
+        if ((recorded || waited) && std::filesystem::exists(cookedPath)) {
+            manifest_[normalizedPath] = { sourceHash, cookedFileName };
+            ++stats.upToDate;
+            return;
+        }
+        cookingFiles_.insert(cookedFileName);
+    }
+
+    const bool isColor = usage == TextureUsage::Albedo;
+    DirectX::ScratchImage image {};
+    HRESULT hr = DirectX::LoadFromWICMemory(fileBytes.data(), fileBytes.size(),
+        isColor ? DirectX::WIC_FLAGS_FORCE_SRGB : DirectX::WIC_FLAGS_IGNORE_SRGB, nullptr, image);
+    DirectX::ScratchImage mipImages {};
+    if (SUCCEEDED(hr)) {
+        hr = DirectX::GenerateMipMaps(image.GetImages(), image.GetImageCount(), image.GetMetadata(),
+            isColor ? DirectX::TEX_FILTER_SRGB : DirectX::TEX_FILTER_DEFAULT, 0, mipImages);
+    }
+
+    // BCは4の倍数のサイズしか作れないので、それ以外は非圧縮のまま保存する
+    DirectX::ScratchImage compressed {};
+    const DirectX::ScratchImage* cookedImages = &mipImages;
+    if (SUCCEEDED(hr) && mipImages.GetMetadata().width % 4 == 0 && mipImages.GetMetadata().height % 4 == 0) {
+        hr = DirectX::Compress(mipImages.GetImages(), mipImages.GetImageCount(), mipImages.GetMetadata(),
+            GetCookedFormat(usage), DirectX::TEX_COMPRESS_DEFAULT, DirectX::TEX_THRESHOLD_DEFAULT, compressed);
+        cookedImages = &compressed;
+    }
+    if (SUCCEEDED(hr)) {
+        hr = DirectX::SaveToDDSFile(cookedImages->GetImages(), cookedImages->GetImageCount(), cookedImages->GetMetadata(),
+            DirectX::DDS_FLAGS_NONE, cookedPath.wstring().c_str());
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    // 成功しても失敗しても外し、同じ中身を待っているものを起こす
+    cookingFiles_.erase(cookedFileName);
+    cookedCondition_.notify_all();
+    if (FAILED(hr)) {
+        ++stats.failed;
+        return;
+    }
+    manifest_[normalizedPath] = { sourceHash, cookedFileName };
+    ++stats.cooked;
+    stats.uncompressedBytes += mipImages.GetPixelsSize();
+    stats.cookedBytes += cookedImages->GetPixelsSize();
+}
+
+void TextureCooker::WriteManifest() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::string> paths;
+    for (const auto& [path, entry] : manifest_) {
+        paths.push_back(path);
+    }
+    std::sort(paths.begin(), paths.end());
+
+    std::ofstream file(std::filesystem::path(cookedDirectory_) / kManifestFileName);
+    for (const std::string& path : paths) {
+        const CookedTextureEntry& entry = manifest_.at(path);
+        file << std::format("{:016x} {} {}\n", entry.sourceHash, entry.cookedFileName, path);
+    }
+}
@@ -0,0 +1,541 @@
+#include "TextureManager.h"
+#include "GpakArchive.h"
+#include "Hash.h"
+#include "StartupTimeline.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <filesystem>
+
+namespace {
+
+// ファイルの中身からミップマップ付きの画像を作る
+DirectX::ScratchImage DecodeTexture(const AssetBytes& fileBytes)
+{
+    DirectX::ScratchImage image {};
+    HRESULT hr = DirectX::LoadFromWICMemory(fileBytes.data, fileBytes.size, DirectX::WIC_FLAGS_FORCE_SRGB, nullptr, image);
+    assert(SUCCEEDED(hr));
+    DirectX::ScratchImage mipImages {};
+    hr = DirectX::GenerateMipMaps(image.GetImages(), image.GetImageCount(), image.GetMetadata(), DirectX::TEX_FILTER_SRGB, 8, mipImages);
+    assert(SUCCEEDED(hr));
+    return mipImages;
+}
+
+// 最初から載せておくミップの大きさ
+constexpr size_t kInitialResidentSize = 64;
+
+// firstMip以降のミップだけを持つリソースを作る
+GpuAllocation CreateTextureResourse(GpuMemoryAllocator& gpuMemory, const DirectX::TexMetadata& metadata, uint32_t firstMip)
+{
+    D3D12_RESOURCE_DESC resourceDesc {};
+    resourceDesc.Width = UINT(std::max<size_t>(metadata.width >> firstMip, 1));
+    resourceDesc.Height = UINT(std::max<size_t>(metadata.height >> firstMip, 1));
+    resourceDesc.MipLevels = UINT16(metadata.mipLevels - firstMip);
+    resourceDesc.DepthOrArraySize = UINT16(metadata.arraySize);
+    resourceDesc.Format = metadata.format;
+    resourceDesc.SampleDesc.Count = 1;
+    resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION(metadata.dimension);
+
+    // GPUだけから見えるヒープに置き、中身はコピーキューで写す
+    D3D12_HEAP_PROPERTIES heapProperties {};
+    heapProperties.Type = D3D12_HEAP_TYPE_DEFAULT;
+
+    // COMMONで作ればコピーキューでもシェーダーからでも暗黙に状態が変わるので、バリアを張らなくてよい
+    // 小さいミップだけのものは4KB単位で置ける
+    return gpuMemory.CreateResource(heapProperties, resourceDesc, D3D12_RESOURCE_STATE_COMMON);
+}
+
+// 常に載せておくミップ。BC形式は一番上のミップが4の倍数でないと作れない
+uint32_t ComputeAlwaysResidentMip(const DirectX::TexMetadata& metadata)
+{
+    const bool compressed = DirectX::IsCompressed(metadata.format);
+    uint32_t mip = 0;
+    while (mip + 1 < metadata.mipLevels && std::max(metadata.width >> mip, metadata.height >> mip) > kInitialResidentSize) {
+        const size_t nextWidth = metadata.width >> (mip + 1);
+        const size_t nextHeight = metadata.height >> (mip + 1);
+        if (compressed && (nextWidth % 4 != 0 || nextHeight % 4 != 0)) {
+            break;
+        }
+        ++mip;
+    }
+    return mip;
+}
+
+} // namespace
+
+TextureManager::TextureManager(ThreadPool* threadPool)
+    : threadPool_(threadPool)
+{
+}
+
+TextureManager::~TextureManager()
+{
+    // ワーカーが触っている依頼を先に片付ける
+    std::unique_lock<std::mutex> lock(pendingMutex_);
+    pendingCondition_.wait(lock, [this] { return pendingJobs_ == 0; });
+}
+
+void TextureManager::SetCookedDirectory(const std::string& cookedDirectory)
+{
+    assert(pending_.empty());
+    cookedDirectory_ = cookedDirectory;
+    cookedTextures_ = TextureCooker::ReadManifest(cookedDirectory, archive_);
+}
+
+void TextureManager::Initialize(ID3D12Device* device, GpuMemoryAllocator* gpuMemory, DescriptorAllocator* descriptors, TextureUploader* uploader)
+{
+    device_ = device;
+    gpuMemory_ = gpuMemory;
+    descriptors_ = descriptors;
+    uploader_ = uploader;
+}
+
+TextureHandle TextureManager::Load(const std::string& filePath)
+{
+    PendingTexture pending;
+    pending.filePath = filePath;
+    pending.normalizedPath = TextureCache::NormalizePath(filePath);
+
+    // 同じパスは読み直さない
+    TextureHandle handle = cache_.AcquireByPath(pending.normalizedPath);
+    if (handle != kInvalidTextureHandle) {
+        return handle;
+    }
+
+    // 別名でも中身が同じならデコードせずに共有する
+    AssetBytes fileBytes;
+    pending.contentHash = ResolveContentHash(filePath, pending.normalizedPath, fileBytes);
+    handle = cache_.AcquireByContent(pending.normalizedPath, pending.contentHash,
+        [&](TextureHandle candidate) { return IsSameContent(filePath, fileBytes, textures_[candidate - 1].sourcePath); });
+    if (handle != kInvalidTextureHandle) {
+        return handle;
+    }
+
+    pending.mipImages = LoadImageData(filePath, pending.normalizedPath, fileBytes);
+    return CreateFromPending(&pending);
+}
+
+void TextureManager::RequestLoad(const std::string& filePath)
+{
+    pending_.push_back(std::make_unique<PendingTexture>());
+    PendingTexture* pending = pending_.back().get();
+    pending->filePath = filePath;
+    pending->normalizedPath = TextureCache::NormalizePath(filePath);
+    pending->cachedHandle = cache_.AcquireByPath(pending->normalizedPath);
+    if (pending->cachedHandle != kInvalidTextureHandle) {
+        return;
+    }
+
+    // 同じパスを今回すでに依頼していれば、その結果を使う
+    for (size_t i = 0; i + 1 < pending_.size(); ++i) {
+        if (pending_[i]->normalizedPath == pending->normalizedPath) {
+            return;
+        }
+    }
+
+    if (!threadPool_) {
+        DecodePending(pending);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex_);
+        ++pendingJobs_;
+    }
+    threadPool_->Enqueue([this, pending] {
+        DecodePending(pending);
+        {
+            std::lock_guard<std::mutex> lock(pendingMutex_);
+            --pendingJobs_;
+        }
+        pendingCondition_.notify_all();
+    });
+}
+
+std::vector<TextureHandle> TextureManager::FinishLoading()
+{
+    {
+        StartupTimeline::Scope scope(timeline_, "Wait texture decode");
+        std::unique_lock<std::mutex> lock(pendingMutex_);
+        pendingCondition_.wait(lock, [this] { return pendingJobs_ == 0; });
+    }
+
+    StartupTimeline::Scope scope(timeline_, "Upload textures");
+    std::vector<TextureHandle> handles;
+    handles.reserve(pending_.size());
+    for (size_t i = 0; i < pending_.size(); ++i) {
+        PendingTexture* pending = pending_[i].get();
+        if (pending->cachedHandle != kInvalidTextureHandle) {
+            handles.push_back(pending->cachedHandle);
+            continue;
+        }
+
+        // 前の依頼と同じパスならそれを共有する
+        TextureHandle handle = cache_.AcquireByPath(pending->normalizedPath);
+        if (handle == kInvalidTextureHandle) {
+            handle = CreateFromPending(pending);
+        }
+        handles.push_back(handle);
+    }
+
+    pending_.clear();
+    decodingContents_.clear();
+    return handles;
+}
+
+void TextureManager::DecodePending(PendingTexture* pending)
+{
+    AssetBytes fileBytes;
+    pending->contentHash = ResolveContentHash(pending->filePath, pending->normalizedPath, fileBytes);
+
+    // 中身が同じものは一つだけデコードする
+    PendingTexture* decoding = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex_);
+        auto [it, inserted] = decodingContents_.emplace(pending->contentHash, pending);
+        decoding = inserted ? nullptr : it->second;
+    }
+    // ハッシュが衝突しただけの別の画像なら、自分でデコードする
+    if (decoding != nullptr && IsSameContent(pending->filePath, fileBytes, decoding->filePath)) {
+        return;
+    }
+    pending->mipImages = LoadImageData(pending->filePath, pending->normalizedPath, fileBytes);
+}
+
+uint64_t TextureManager::ResolveContentHash(const std::string& filePath, const std::string& normalizedPath, AssetBytes& fileBytes) const
+{
+    // クック済みなら元ファイルを読まずにマニフェストのハッシュを使う
+    auto it = cookedTextures_.find(normalizedPath);
+    if (it != cookedTextures_.end()) {
+        return it->second.sourceHash;
+    }
+    bool read = ReadAssetBytes(archive_, filePath, fileBytes);
+    assert(read);
+    (void)read;
+    return HashBytes(fileBytes.data, fileBytes.size);
+}
+
+bool TextureManager::IsSameContent(const std::string& filePath, AssetBytes& fileBytes, const std::string& otherFilePath) const
+{
+    if (otherFilePath.empty()) {
+        return false;
+    }
+    auto cooked = cookedTextures_.find(TextureCache::NormalizePath(filePath));
+    auto otherCooked = cookedTextures_.find(TextureCache::NormalizePath(otherFilePath));
+    if (cooked != cookedTextures_.end() && otherCooked != cookedTextures_.end()) {
+        return cooked->second.cookedFileName == otherCooked->second.cookedFileName;
+    }
+
+    AssetBytes otherBytes;
+    if ((fileBytes.empty() && !ReadAssetBytes(archive_, filePath, fileBytes)) || !ReadAssetBytes(archive_, otherFilePath, otherBytes)) {
+        return false;
+    }
+    return fileBytes.size == otherBytes.size && std::memcmp(fileBytes.data, otherBytes.data, fileBytes.size) == 0;
+}
+
+DirectX::ScratchImage TextureManager::LoadImageData(const std::string& filePath, const std::string& normalizedPath, AssetBytes& fileBytes) const
+{
+    auto it = cookedTextures_.find(normalizedPath);
+    if (it != cookedTextures_.end()) {
+        StartupTimeline::Scope scope(timeline_, "Load cooked " + filePath);
+        const std::filesystem::path cookedPath = std::filesystem::path(cookedDirectory_) / it->second.cookedFileName;
+        AssetBytes cookedBytes;
+        DirectX::ScratchImage mipImages {};
+        if (ReadAssetBytes(archive_, cookedPath.string(), cookedBytes)
+            && SUCCEEDED(DirectX::LoadFromDDSMemory(cookedBytes.data, cookedBytes.size, DirectX::DDS_FLAGS_NONE, nullptr, mipImages))) {
+            return mipImages;
+        }
+    }
+
+    // クック済みが無ければ元画像からミップを作る
+    StartupTimeline::Scope scope(timeline_, "Decode " + filePath);
+    if (fileBytes.empty()) {
+        bool read = ReadAssetBytes(archive_, filePath, fileBytes);
+        assert(read);
+        (void)read;
+    }
+    return DecodeTexture(fileBytes);
+}
+
+TextureHandle TextureManager::CreateFromPending(PendingTexture* pending)
+{
+    assert(device_ != nullptr);
+
+    // 別名でも中身が同じならそれを共有する
+    AssetBytes fileBytes;
+    TextureHandle handle = cache_.AcquireByContent(pending->normalizedPath, pending->contentHash,
+        [&](TextureHandle candidate) { return IsSameContent(pending->filePath, fileBytes, textures_[candidate - 1].sourcePath); });
+    if (handle != kInvalidTextureHandle) {
+        return handle;
+    }
+
+    // デコードを別の依頼に任せていた場合は、その画像を使う
+    DirectX::ScratchImage* mipImages = &pending->mipImages;
+    if (mipImages->GetImageCount() == 0) {
+        mipImages = &decodingContents_.at(pending->contentHash)->mipImages;
+    }
+    return InsertTexture(pending->filePath, pending->normalizedPath, pending->contentHash, *mipImages, streamingEnabled_);
+}
+
+TextureHandle TextureManager::CreateTexture(const std::string& name, DirectX::ScratchImage&& mipImages)
+{
+    // 中身が後から変わるので、名前のハッシュで登録して中身による共有の対象にしない
+    const std::string normalizedPath = TextureCache::NormalizePath(name);
+    assert(!cache_.ContainsPath(normalizedPath));
+    return InsertTexture("", normalizedPath, HashBytes(normalizedPath.data(), normalizedPath.size()), mipImages, false);
+}
+
+void TextureManager::UpdateTexture(TextureHandle handle, DirectX::ScratchImage&& mipImages)
+{
+    // 写し終わるまでは古い中身のまま描く
+    Texture& texture = textures_[handle - 1];
+    assert(cache_.IsValid(handle) && texture.residencyId == UINT32_MAX);
+    texture.metadata = mipImages.GetMetadata();
+    CreateResidentResource(handle, std::make_shared<DirectX::ScratchImage>(std::move(mipImages)), 0);
+}
+
+TextureHandle TextureManager::InsertTexture(const std::string& filePath, const std::string& normalizedPath, uint64_t contentHash, DirectX::ScratchImage& mipImages, bool streamable)
+{
+    assert(device_ != nullptr && gpuMemory_ != nullptr && descriptors_ != nullptr && uploader_ != nullptr);
+
+    // コピーが終わったときにハンドルで探すので、先に登録する
+    TextureHandle handle = cache_.Insert(normalizedPath, contentHash, mipImages.GetPixelsSize());
+    if (textures_.size() < handle) {
+        textures_.resize(handle);
+    }
+    Texture& texture = textures_[handle - 1];
+    texture = Texture {};
+    texture.metadata = mipImages.GetMetadata();
+    texture.sourcePath = filePath;
+    texture.srv = descriptors_->AllocateStaging(1);
+    assert(texture.srv.IsValid());
+    // 最初のコピーが終わるまでは何も指さないビューにしておく(読むと0になる)
+    WriteSrv(texture, nullptr, 0);
+
+    if (streamable) {
+        CreateStreamedResource(handle, std::move(mipImages));
+    } else {
+        CreateResidentResource(handle, std::make_shared<DirectX::ScratchImage>(std::move(mipImages)), 0);
+    }
+    return handle;
+}
+
+void TextureManager::CreateStreamedResource(TextureHandle handle, DirectX::ScratchImage&& mipImages)
+{
+    // 粗いミップだけを載せ、残りはCPU側に持っておく
+    Texture& texture = textures_[handle - 1];
+    std::vector<uint64_t> mipBytes(texture.metadata.mipLevels);
+    for (size_t mip = 0; mip < texture.metadata.mipLevels; ++mip) {
+        mipBytes[mip] = mipImages.GetImage(mip, 0, 0)->slicePitch;
+    }
+    uint32_t alwaysResidentMip = ComputeAlwaysResidentMip(texture.metadata);
+    texture.residencyId = residency_.AddTexture(mipBytes, alwaysResidentMip);
+    texture.sourceImages = std::make_shared<DirectX::ScratchImage>(std::move(mipImages));
+    CreateResidentResource(handle, texture.sourceImages, alwaysResidentMip);
+}
+
+void TextureManager::CreateResidentResource(TextureHandle handle, std::shared_ptr<const DirectX::ScratchImage> mipImages, uint32_t firstMip)
+{
+    // 前の作り直しがまだ写している途中なら、それはもう要らない
+    Texture& texture = textures_[handle - 1];
+    AbandonUpload(texture);
+
+    texture.pendingMemory = CreateTextureResourse(*gpuMemory_, texture.metadata, firstMip);
+    texture.pendingMip = firstMip;
+    std::vector<D3D12_SUBRESOURCE_DATA> subresources;
+    for (size_t mipLevel = firstMip; mipLevel < texture.metadata.mipLevels; ++mipLevel) {
+        const DirectX::Image* img = mipImages->GetImage(mipLevel, 0, 0);
+        subresources.push_back({ img->pixels, LONG_PTR(img->rowPitch), LONG_PTR(img->slicePitch) });
+    }
+    // 画素はmipImagesが持っているので、写し終えるまで一緒に渡しておく
+    texture.uploadTicket = uploader_->Upload(texture.pendingMemory.resource.Get(), std::move(subresources), std::move(mipImages));
+    uploads_.emplace(texture.uploadTicket, handle);
+}
+
+void TextureManager::AbandonUpload(Texture& texture)
+{
+    if (texture.uploadTicket == 0) {
+        return;
+    }
+    uploads_.erase(texture.uploadTicket);
+    abandonedUploads_.emplace(texture.uploadTicket, texture.pendingMemory);
+    texture.pendingMemory = GpuAllocation {};
+    texture.uploadTicket = 0;
+}
+
+uint32_t TextureManager::UpdateUploads()
+{
+    uint32_t swapped = 0;
+    for (uint32_t ticket : uploader_->Update()) {
+        auto abandoned = abandonedUploads_.find(ticket);
+        if (abandoned != abandonedUploads_.end()) {
+            // 描画からは一度も見えていないので、すぐに返してよい
+            gpuMemory_->Free(abandoned->second);
+            abandonedUploads_.erase(abandoned);
+            continue;
+        }
+
+        auto upload = uploads_.find(ticket);
+        assert(upload != uploads_.end());
+        Texture& texture = textures_[upload->second - 1];
+        uploads_.erase(upload);
+
+        // 古いリソースは流しているフレームが読んでいるかもしれないので、それが終わってから返す
+        ReleaseMemory(texture.memory);
+        texture.memory = texture.pendingMemory;
+        texture.pendingMemory = GpuAllocation {};
+        texture.residentMip = texture.pendingMip;
+        texture.uploadTicket = 0;
+        // SRVは描画のたびにフレームのテーブルへ写しているので、その場で書き換えてよい
+        WriteSrv(texture, texture.memory.resource.Get(), texture.residentMip);
+        ++swapped;
+    }
+    return swapped;
+}
+
+void TextureManager::WriteSrv(const Texture& texture, ID3D12Resource* resource, uint32_t firstMip)
+{
+    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc {};
+    srvDesc.Format = texture.metadata.format;
+    srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+    srvDesc.Texture2D.MipLevels = UINT(texture.metadata.mipLevels - firstMip);
+    device_->CreateShaderResourceView(resource, &srvDesc, texture.srv.cpuHandle);
+}
+
+void TextureManager::ReleaseMemory(GpuAllocation& memory)
+{
+    if (!memory.resource) {
+        return;
+    }
+    if (deferRelease_) {
+        deferRelease_([gpuMemory = gpuMemory_, memory]() mutable { gpuMemory->Free(memory); });
+    } else {
+        gpuMemory_->Free(memory);
+    }
+    memory = GpuAllocation {};
+}
+
+void TextureManager::EnableStreaming(uint64_t budgetBytes)
+{
+    assert(cache_.GetStats().uniqueTextures == 0);
+    streamingEnabled_ = true;
+    residency_.SetBudget(budgetBytes);
+}
+
+void TextureManager::RequestMip(TextureHandle handle, uint32_t mip)
+{
+    const Texture& texture = GetTexture(handle);
+    if (texture.residencyId != UINT32_MAX) {
+        residency_.Request(texture.residencyId, mip, streamingFrame_);
+    }
+}
+
+uint32_t TextureManager::UpdateStreaming()
+{
+    if (!streamingEnabled_) {
+        return 0;
+    }
+
+    std::vector<ResidencyChange> changes = residency_.Update(streamingFrame_++);
+    for (const ResidencyChange& change : changes) {
+        // ミップの増減に合わせて作り直す(写し終わるまでは今のミップのまま描く)
+        for (size_t i = 0; i < textures_.size(); ++i) {
+            if (textures_[i].srv.IsValid() && textures_[i].residencyId == change.id) {
+                CreateResidentResource(TextureHandle(i + 1), textures_[i].sourceImages, change.toMip);
+                break;
+            }
+        }
+    }
+    return static_cast<uint32_t>(changes.size());
+}
+
+uint32_t TextureManager::GetRequestedMip(TextureHandle handle) const
+{
+    const Texture& texture = GetTexture(handle);
+    return texture.residencyId != UINT32_MAX ? residency_.GetRequestedMip(texture.residencyId) : 0;
+}
+
+bool TextureManager::PrepareReload(const std::string& filePath, TextureCooker* cooker, PreparedTexture& prepared)
+{
+    AssetBytes fileBytes;
+    if (!ReadAssetBytes(nullptr, filePath, fileBytes)) {
+        return false;
+    }
+    prepared.contentHash = HashBytes(fileBytes.data, fileBytes.size);
+
+    if (cooker != nullptr && cooker->IsCooked(filePath)) {
+        if (!cooker->CookSingle(filePath, prepared.cookedEntry)) {
+            return false;
+        }
+        prepared.cooked = true;
+        const std::filesystem::path cookedPath = std::filesystem::path(cooker->GetCookedDirectory()) / prepared.cookedEntry.cookedFileName;
+        return SUCCEEDED(DirectX::LoadFromDDSFile(cookedPath.wstring().c_str(), DirectX::DDS_FLAGS_NONE, nullptr, prepared.mipImages));
+    }
+
+    // 保存途中の壊れた画像などはassertせずに失敗として返す
+    DirectX::ScratchImage image {};
+    if (FAILED(DirectX::LoadFromWICMemory(fileBytes.data, fileBytes.size, DirectX::WIC_FLAGS_FORCE_SRGB, nullptr, image))) {
+        return false;
+    }
+    return SUCCEEDED(DirectX::GenerateMipMaps(image.GetImages(), image.GetImageCount(), image.GetMetadata(), DirectX::TEX_FILTER_SRGB, 8, prepared.mipImages));
+}
+
+bool TextureManager::ApplyReload(const std::string& filePath, PreparedTexture&& prepared)
+{
+    const std::string normalizedPath = TextureCache::NormalizePath(filePath);
+    const TextureHandle handle = cache_.FindByPath(normalizedPath);
+    if (handle == kInvalidTextureHandle) {
+        return false;
+    }
+    if (prepared.cooked) {
+        cookedTextures_[normalizedPath] = prepared.cookedEntry;
+    }
+
+    // 写し終わるまでは古い中身のまま描く
+    Texture& texture = textures_[handle - 1];
+    texture.metadata = prepared.mipImages.GetMetadata();
+    cache_.UpdateContent(handle, prepared.contentHash, prepared.mipImages.GetPixelsSize());
+    if (texture.residencyId == UINT32_MAX) {
+        CreateResidentResource(handle, std::make_shared<DirectX::ScratchImage>(std::move(prepared.mipImages)), 0);
+        return true;
+    }
+
+    // 大きさやミップ数が変わることがあるので、ストリーミングにも登録し直す
+    residency_.RemoveTexture(texture.residencyId);
+    CreateStreamedResource(handle, std::move(prepared.mipImages));
+    return true;
+}
+
+void TextureManager::AddRef(TextureHandle handle)
+{
+    cache_.AddRef(handle);
+}
+
+void TextureManager::Release(TextureHandle handle)
+{
+    if (!cache_.Release(handle)) {
+        return;
+    }
+    // リソースは流しているフレームが終わってから解放する。SRVは描画のたびにフレームのテーブルへ写しているので、すぐに使い回してよい
+    Texture& texture = textures_[handle - 1];
+    descriptors_->FreeStaging(texture.srv);
+    if (texture.residencyId != UINT32_MAX) {
+        residency_.RemoveTexture(texture.residencyId);
+    }
+    AbandonUpload(texture);
+    ReleaseMemory(texture.memory);
+    texture = Texture {};
+}
+
+const Texture& TextureManager::GetTexture(TextureHandle handle) const
+{
+    assert(cache_.IsValid(handle));
+    return textures_[handle - 1];
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE TextureManager::GetSrvHandleCPU(TextureHandle handle) const
+{
+    return GetTexture(handle).srv.cpuHandle;
+}
@@ -0,0 +1,187 @@
+#include "TextureResidency.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace {
+
+constexpr uint32_t kNoRequester = UINT32_MAX;
+
+} // namespace
+
+uint32_t TextureResidency::EstimateMip(float texelsAcross, float pixelsAcross, uint32_t mipLevels)
+{
+    if (mipLevels == 0) {
+        return 0;
+    }
+    if (pixelsAcross <= 0.0f) {
+        return mipLevels - 1;
+    }
+    // 1ピクセルに1テクセル以上乗るミップで一番粗いもの
+    float mip = std::floor(std::log2(std::max(texelsAcross / pixelsAcross, 1.0f)));
+    return std::min(static_cast<uint32_t>(mip), mipLevels - 1);
+}
+
+float TextureResidency::ProjectSphereToPixels(float radius, float distance, float fovY, float screenHeight)
+{
+    if (distance <= radius) {
+        return screenHeight;
+    }
+    return radius / (distance * std::tan(fovY * 0.5f)) * screenHeight;
+}
+
+uint32_t TextureResidency::AddTexture(const std::vector<uint64_t>& mipBytes, uint32_t alwaysResidentMip)
+{
+    assert(!mipBytes.empty() && alwaysResidentMip < mipBytes.size());
+
+    uint32_t id;
+    if (!freeIds_.empty()) {
+        id = freeIds_.back();
+        freeIds_.pop_back();
+    } else {
+        id = static_cast<uint32_t>(entries_.size());
+        entries_.emplace_back();
+    }
+
+    Entry& entry = entries_[id];
+    entry = Entry {};
+    entry.mipBytes = mipBytes;
+    entry.alwaysResidentMip = alwaysResidentMip;
+    entry.residentMip = alwaysResidentMip;
+    entry.requestedMip = alwaysResidentMip;
+    entry.valid = true;
+    for (uint32_t mip = alwaysResidentMip; mip < mipBytes.size(); ++mip) {
+        stats_.residentBytes += mipBytes[mip];
+    }
+    return id;
+}
+
+void TextureResidency::RemoveTexture(uint32_t id)
+{
+    Entry& entry = entries_[id];
+    assert(entry.valid);
+    for (uint32_t mip = entry.residentMip; mip < entry.mipBytes.size(); ++mip) {
+        stats_.residentBytes -= entry.mipBytes[mip];
+    }
+    entry = Entry {};
+    freeIds_.push_back(id);
+}
+
+void TextureResidency::Request(uint32_t id, uint32_t mip, uint64_t frame)
+{
+    Entry& entry = entries_[id];
+    mip = std::min(mip, entry.alwaysResidentMip);
+    if (!entry.used || entry.lastUsedFrame != frame) {
+        entry.requestedMip = mip;
+    } else {
+        entry.requestedMip = std::min(entry.requestedMip, mip);
+    }
+    entry.lastUsedFrame = frame;
+    entry.used = true;
+}
+
+std::vector<ResidencyChange> TextureResidency::Update(uint64_t frame)
+{
+    std::vector<uint32_t> before(entries_.size());
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        before[i] = entries_[i].residentMip;
+    }
+    stats_.loadedMips = 0;
+    stats_.evictedMips = 0;
+    stats_.streamedBytes = 0;
+    stats_.starvedTextures = 0;
+
+    // 予算が下げられた場合に備えて、先に予算内に収める
+    Evict(0, frame, kNoRequester);
+
+    // 最近使われたもの、足りないミップが多いものから読み込む
+    std::vector<uint32_t> candidates;
+    for (uint32_t id = 0; id < entries_.size(); ++id) {
+        const Entry& entry = entries_[id];
+        if (entry.valid && entry.used && entry.lastUsedFrame == frame && entry.requestedMip < entry.residentMip) {
+            candidates.push_back(id);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [this](uint32_t a, uint32_t b) {
+        const Entry& entryA = entries_[a];
+        const Entry& entryB = entries_[b];
+        return entryA.residentMip - entryA.requestedMip > entryB.residentMip - entryB.requestedMip;
+    });
+
+    for (uint32_t id : candidates) {
+        Entry& entry = entries_[id];
+        while (entry.residentMip > entry.requestedMip) {
+            const uint64_t bytes = entry.mipBytes[entry.residentMip - 1];
+            if (stats_.streamedBytes + bytes > maxStreamBytesPerUpdate_ && stats_.streamedBytes > 0) {
+                break;
+            }
+            if (!Evict(bytes, frame, id)) {
+                ++stats_.starvedTextures;
+                break;
+            }
+            --entry.residentMip;
+            stats_.residentBytes += bytes;
+            stats_.streamedBytes += bytes;
+            ++stats_.loadedMips;
+        }
+    }
+    stats_.totalStreamedBytes += stats_.streamedBytes;
+
+    std::vector<ResidencyChange> changes;
+    for (uint32_t id = 0; id < entries_.size(); ++id) {
+        if (entries_[id].valid && entries_[id].residentMip != before[id]) {
+            changes.push_back({ id, before[id], entries_[id].residentMip });
+        }
+    }
+    return changes;
+}
+
+uint32_t TextureResidency::GetFloorMip(const Entry& entry, uint64_t frame) const
+{
+    return entry.used && entry.lastUsedFrame == frame ? entry.requestedMip : entry.alwaysResidentMip;
+}
+
+bool TextureResidency::Evict(uint64_t bytes, uint64_t frame, uint32_t requester)
+{
+    if (stats_.residentBytes + bytes <= stats_.budgetBytes) {
+        return true;
+    }
+
+    // 追い出しても足りないなら何も追い出さない
+    uint64_t reclaimable = 0;
+    for (uint32_t id = 0; id < entries_.size(); ++id) {
+        const Entry& entry = entries_[id];
+        if (!entry.valid || id == requester) {
+            continue;
+        }
+        for (uint32_t mip = entry.residentMip; mip < GetFloorMip(entry, frame); ++mip) {
+            reclaimable += entry.mipBytes[mip];
+        }
+    }
+    if (requester != kNoRequester && stats_.residentBytes - reclaimable + bytes > stats_.budgetBytes) {
+        return false;
+    }
+
+    while (stats_.residentBytes + bytes > stats_.budgetBytes) {
+        // 余分に載っているもののうち、一番長く使われていないものから1段ずつ落とす
+        uint32_t victim = kNoRequester;
+        for (uint32_t id = 0; id < entries_.size(); ++id) {
+            const Entry& entry = entries_[id];
+            if (!entry.valid || id == requester || entry.residentMip >= GetFloorMip(entry, frame)) {
+                continue;
+            }
+            if (victim == kNoRequester || entry.lastUsedFrame < entries_[victim].lastUsedFrame) {
+                victim = id;
+            }
+        }
+        if (victim == kNoRequester) {
+            return false;
+        }
+
+        Entry& entry = entries_[victim];
+        stats_.residentBytes -= entry.mipBytes[entry.residentMip];
+        ++entry.residentMip;
+        ++stats_.evictedMips;
+    }
+    return true;
+}
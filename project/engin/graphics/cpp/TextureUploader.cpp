@@ -0,0 +1,199 @@
+#include "TextureUploader.h"
+#include "BufferResource.h"
+#include <cassert>
+#include <cstring>
+
+namespace {
+
+Microsoft::WRL::ComPtr<ID3D12CommandQueue> CreateCopyQueue(ID3D12Device* device)
+{
+    D3D12_COMMAND_QUEUE_DESC commandQueueDesc {};
+    commandQueueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+    Microsoft::WRL::ComPtr<ID3D12CommandQueue> commandQueue = nullptr;
+    HRESULT hr = device->CreateCommandQueue(&commandQueueDesc, IID_PPV_ARGS(&commandQueue));
+    assert(SUCCEEDED(hr));
+    return commandQueue;
+}
+
+} // namespace
+
+TextureUploader::TextureUploader(ID3D12Device* device, uint64_t stagingBytes, uint64_t batchBytes)
+    : device_(device)
+    , commandQueue_(CreateCopyQueue(device))
+    , timeline_(device, commandQueue_.Get())
+    , scheduler_(stagingBytes, batchBytes, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT)
+{
+    // ステージングバッファはずっとMapしたまま使う
+    stagingBuffer_ = CreateBufferResource(device, stagingBytes);
+    stagingBuffer_->Map(0, nullptr, reinterpret_cast<void**>(&stagingData_));
+
+    CommandContext context = AcquireCommandContext();
+    HRESULT hr = device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, context.commandAllocator.Get(), nullptr, IID_PPV_ARGS(&commandList_));
+    assert(SUCCEEDED(hr));
+    hr = commandList_->Close();
+    assert(SUCCEEDED(hr));
+    freeContexts_.push_back(std::move(context));
+}
+
+TextureUploader::~TextureUploader()
+{
+    // コピー中のテクスチャとステージングを消す前に終わらせる
+    timeline_.Wait(scheduler_.GetLastFenceValue());
+}
+
+uint32_t TextureUploader::Upload(ID3D12Resource* texture, std::vector<D3D12_SUBRESOURCE_DATA> subresources, std::shared_ptr<const void> source)
+{
+    Job job;
+    job.texture = texture;
+    job.subresources = std::move(subresources);
+    job.source = std::move(source);
+
+    const UINT subresourceCount = static_cast<UINT>(job.subresources.size());
+    job.layouts.resize(subresourceCount);
+    job.rowCounts.resize(subresourceCount);
+    job.rowSizes.resize(subresourceCount);
+    const D3D12_RESOURCE_DESC desc = texture->GetDesc();
+    device_->GetCopyableFootprints(&desc, 0, subresourceCount, 0, job.layouts.data(), job.rowCounts.data(), job.rowSizes.data(), nullptr);
+
+    // ステージングではサブリソースごとに行の間隔を揃え直すので、その大きさで場所を取る
+    std::vector<uint64_t> subresourceBytes(subresourceCount);
+    for (UINT i = 0; i < subresourceCount; ++i) {
+        const D3D12_SUBRESOURCE_FOOTPRINT& footprint = job.layouts[i].Footprint;
+        subresourceBytes[i] = uint64_t(footprint.RowPitch) * job.rowCounts[i] * footprint.Depth;
+    }
+    const uint32_t ticket = scheduler_.Enqueue(subresourceBytes);
+    jobs_.emplace(ticket, std::move(job));
+    return ticket;
+}
+
+std::vector<uint32_t> TextureUploader::Update(uint32_t maxBatches)
+{
+    const uint64_t completedValue = timeline_.GetCompletedValue();
+    CollectCompleted(completedValue);
+    std::vector<uint32_t> finished = std::move(waitedTickets_);
+    waitedTickets_.clear();
+    for (uint32_t ticket : scheduler_.Update(completedValue, maxBatches, [this](const UploadBatch& batch) { return Submit(batch); })) {
+        jobs_.erase(ticket);
+        finished.push_back(ticket);
+    }
+    return finished;
+}
+
+void TextureUploader::WaitIdle()
+{
+    if (scheduler_.IsIdle()) {
+        return;
+    }
+    ++stats_.idleWaits;
+    // 提出しては待つのを、すべて写し終えるまで繰り返す。ここで終わったチケットは次のUpdateで返す
+    while (!scheduler_.IsIdle()) {
+        std::vector<uint32_t> finished = Update(UINT32_MAX);
+        waitedTickets_.insert(waitedTickets_.end(), finished.begin(), finished.end());
+        timeline_.Wait(scheduler_.GetLastFenceValue());
+    }
+}
+
+uint64_t TextureUploader::Submit(const UploadBatch& batch)
+{
+    CommandContext context = AcquireCommandContext();
+    HRESULT hr = context.commandAllocator->Reset();
+    assert(SUCCEEDED(hr));
+    hr = commandList_->Reset(context.commandAllocator.Get(), nullptr);
+    assert(SUCCEEDED(hr));
+
+    std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> dedicatedBuffers;
+    for (const UploadCopy& copy : batch.copies) {
+        const Job& job = jobs_.at(copy.ticket);
+
+        D3D12_TEXTURE_COPY_LOCATION source {};
+        source.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+        source.PlacedFootprint = job.layouts[copy.subresource];
+        if (copy.dedicated) {
+            // ステージングより大きいものは、このコピーだけのバッファを作って終わったら捨てる
+            Microsoft::WRL::ComPtr<ID3D12Resource> buffer = CreateBufferResource(device_, copy.sizeInBytes);
+            uint8_t* data = nullptr;
+            buffer->Map(0, nullptr, reinterpret_cast<void**>(&data));
+            WriteSubresource(job, copy.subresource, data);
+            buffer->Unmap(0, nullptr);
+            source.pResource = buffer.Get();
+            source.PlacedFootprint.Offset = 0;
+            dedicatedBuffers.push_back(std::move(buffer));
+            ++stats_.dedicatedBuffers;
+            stats_.dedicatedBytes += copy.sizeInBytes;
+        } else {
+            WriteSubresource(job, copy.subresource, stagingData_ + copy.stagingOffset);
+            source.pResource = stagingBuffer_.Get();
+            source.PlacedFootprint.Offset = copy.stagingOffset;
+        }
+
+        D3D12_TEXTURE_COPY_LOCATION destination {};
+        destination.pResource = job.texture.Get();
+        destination.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+        destination.SubresourceIndex = copy.subresource;
+        commandList_->CopyTextureRegion(&destination, 0, 0, 0, &source, nullptr);
+    }
+
+    hr = commandList_->Close();
+    assert(SUCCEEDED(hr));
+    ID3D12CommandList* commandLists[] = { commandList_.Get() };
+    commandQueue_->ExecuteCommandLists(1, commandLists);
+
+    const uint64_t fenceValue = timeline_.Signal();
+    context.fenceValue = fenceValue;
+    busyContexts_.push_back(std::move(context));
+    for (Microsoft::WRL::ComPtr<ID3D12Resource>& buffer : dedicatedBuffers) {
+        dedicatedBuffers_.emplace_back(fenceValue, std::move(buffer));
+    }
+    return fenceValue;
+}
+
+void TextureUploader::WriteSubresource(const Job& job, uint32_t subresource, uint8_t* destination) const
+{
+    // 画像の行の間隔とステージングの行の間隔(256の倍数)は違うので1行ずつ写す
+    const D3D12_SUBRESOURCE_DATA& data = job.subresources[subresource];
+    const D3D12_SUBRESOURCE_FOOTPRINT& footprint = job.layouts[subresource].Footprint;
+    const UINT rowCount = job.rowCounts[subresource];
+    const size_t rowSize = static_cast<size_t>(job.rowSizes[subresource]);
+    for (UINT z = 0; z < footprint.Depth; ++z) {
+        const uint8_t* sourceSlice = static_cast<const uint8_t*>(data.pData) + data.SlicePitch * z;
+        uint8_t* destinationSlice = destination + uint64_t(footprint.RowPitch) * rowCount * z;
+        for (UINT row = 0; row < rowCount; ++row) {
+            std::memcpy(destinationSlice + uint64_t(footprint.RowPitch) * row, sourceSlice + data.RowPitch * row, rowSize);
+        }
+    }
+}
+
+TextureUploader::CommandContext TextureUploader::AcquireCommandContext()
+{
+    CollectCompleted(timeline_.GetCompletedValue());
+    if (!freeContexts_.empty()) {
+        CommandContext context = std::move(freeContexts_.back());
+        freeContexts_.pop_back();
+        return context;
+    }
+    // すべてのアロケータが使用中なら増やす(提出の数はmaxBatchesで抑えているので増えすぎない)
+    CommandContext context;
+    HRESULT hr = device_->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&context.commandAllocator));
+    assert(SUCCEEDED(hr));
+    ++contextCount_;
+    return context;
+}
+
+void TextureUploader::CollectCompleted(uint64_t completedValue)
+{
+    while (!busyContexts_.empty() && busyContexts_.front().fenceValue <= completedValue) {
+        freeContexts_.push_back(std::move(busyContexts_.front()));
+        busyContexts_.pop_front();
+    }
+    while (!dedicatedBuffers_.empty() && dedicatedBuffers_.front().first <= completedValue) {
+        dedicatedBuffers_.pop_front();
+    }
+}
+
+TextureUploaderStats TextureUploader::GetStats() const
+{
+    TextureUploaderStats stats = stats_;
+    stats.scheduler = scheduler_.GetStats();
+    stats.commandAllocators = contextCount_;
+    return stats;
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include "AssetWatcher.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class ThreadPool;
+
+// 1件の再読み込みの結果
+struct HotReloadResult {
+    std::string path;
+    bool succeeded = false;
+    // ワーカーでの作り直しにかかった時間と、変更の検出から差し替えまでの時間
+    double cookMilliseconds = 0.0;
+    double latencyMilliseconds = 0.0;
+};
+
+struct HotReloadStats {
+    uint32_t changes = 0;
+    uint32_t reloaded = 0;
+    uint32_t failed = 0;
+    double lastLatencyMilliseconds = 0.0;
+    double maxLatencyMilliseconds = 0.0;
+    double totalLatencyMilliseconds = 0.0;
+};
+
+// 変更されたアセットとそれに依存するものだけをワーカーで作り直し、フレームの境目で差し替える
+class AssetHotReloader {
+public:
+    // メインスレッドで呼ぶ差し替え処理。成功ならtrue
+    using ApplyFunc = std::function<bool()>;
+    // ワーカーで呼ぶ作り直し処理。失敗したら空のApplyFuncを返す
+    using CookFunc = std::function<ApplyFunc()>;
+
+    explicit AssetHotReloader(ThreadPool& threadPool);
+    ~AssetHotReloader();
+
+    AssetHotReloader(const AssetHotReloader&) = delete;
+    AssetHotReloader& operator=(const AssetHotReloader&) = delete;
+
+    bool Start(const std::string& directory, bool forcePolling = false);
+    bool IsPolling() const { return watcher_.IsPolling(); }
+
+    // pathが変わったら(または依存先が変わったら)cookを呼ぶ
+    void Register(const std::string& path, CookFunc cook);
+    // dependencyが変わったらdependentも作り直す(.hlsliと.hlslなど)
+    void AddDependency(const std::string& dependency, const std::string& dependent);
+
+    // フレームの境目(GPUが使い終わった後)で呼ぶ。変更を拾って作り直しを依頼し、終わったものを差し替える
+    std::vector<HotReloadResult> Update();
+    const HotReloadStats& GetStats() const { return stats_; }
+    uint32_t GetCookingCount() const { return static_cast<uint32_t>(cooking_.size()); }
+
+private:
+    struct Completed {
+        std::string path;
+        ApplyFunc apply;
+        double cookMilliseconds = 0.0;
+        std::chrono::steady_clock::time_point detectedTime;
+    };
+
+    void Schedule(const std::string& path, std::chrono::steady_clock::time_point detectedTime);
+    // changedPathとそれに依存するもののうち、登録されているものを集める
+    std::vector<std::string> CollectTargets(const std::string& changedPath) const;
+
+    ThreadPool& threadPool_;
+    AssetWatcher watcher_;
+
+    std::unordered_map<std::string, CookFunc> targets_;
+    std::unordered_map<std::string, std::vector<std::string>> dependents_;
+
+    // 作り直し中のものと、その間にまた変更されたもの(終わったらもう一度作り直す)
+    std::unordered_set<std::string> cooking_;
+    std::unordered_map<std::string, std::chrono::steady_clock::time_point> changedWhileCooking_;
+
+    std::mutex completedMutex_;
+    std::condition_variable completedCondition_;
+    std::vector<Completed> completed_;
+    uint32_t inFlight_ = 0;
+
+    HotReloadStats stats_;
+};
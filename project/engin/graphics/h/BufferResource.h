@@ -0,0 +1,11 @@
+#pragma once
+#include <cstdint>
+#include <d3d12.h>
+#include <wrl.h>
+
+// sizeInBytesのバッファの設定
+D3D12_RESOURCE_DESC MakeBufferDesc(uint64_t sizeInBytes);
+
+// sizeInBytesのバッファを作る。既定はCPUから書き込むアップロード用
+Microsoft::WRL::ComPtr<ID3D12Resource> CreateBufferResource(ID3D12Device* device, uint64_t sizeInBytes,
+    D3D12_HEAP_TYPE heapType = D3D12_HEAP_TYPE_UPLOAD, D3D12_RESOURCE_STATES state = D3D12_RESOURCE_STATE_GENERIC_READ);
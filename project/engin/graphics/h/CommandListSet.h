@@ -0,0 +1,63 @@
+#pragma once
+#include "ParallelRecorder.h"
+#include "ResourceStateTracker.h"
+#include <cstdint>
+#include <d3d12.h>
+#include <memory>
+#include <vector>
+#include <wrl.h>
+
+// ParallelRecorderの記録先になるD3D12のコマンドリストの組
+// 0番は外で開いたコマンドリストを借り、1番から後ろはリストとフレームごとのアロケータを必要なだけ作って使い回す
+// リストごとにResourceStateTrackerを持ち、提出のときに前のリストの状態から決まる遷移を、要るリストの前だけに足す
+class D3D12CommandListSet : public CommandListBackend {
+public:
+    // 開いたリストにはshaderVisibleHeapを設定しておく
+    D3D12CommandListSet(ID3D12Device* device, ID3D12CommandQueue* commandQueue, uint32_t frameCount, ID3D12DescriptorHeap* shaderVisibleHeap,
+        ResourceStateRegistry& resourceStates);
+
+    D3D12CommandListSet(const D3D12CommandListSet&) = delete;
+    D3D12CommandListSet& operator=(const D3D12CommandListSet&) = delete;
+
+    // フレームを始める。frameIndexはFrameContextRing::BeginFrameが返したもの(そのフレームのアロケータはGPUが使い終えている)
+    // headは0番として使う、開いてあるコマンドリスト
+    void BeginFrame(uint32_t frameIndex, ID3D12GraphicsCommandList* head);
+    ID3D12GraphicsCommandList* GetCommandList(uint32_t list) const { return list == 0 ? head_ : lists_[list]->commandList.Get(); }
+    // list番目のリストに積むバリアはこれを通す
+    ResourceStateTracker& GetStateTracker(uint32_t list) { return lists_[list]->stateTracker; }
+
+    void Reserve(uint32_t listCount) override;
+    void Open(uint32_t list) override;
+    void Close(uint32_t list) override;
+    void Submit(uint32_t listCount) override;
+
+    // 0番を除いて作ったリストの数
+    uint32_t GetCreatedListCount() const { return static_cast<uint32_t>(lists_.size()) - 1; }
+
+private:
+    struct List {
+        explicit List(ResourceStateRegistry& resourceStates) : stateTracker(resourceStates) { }
+
+        Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> commandList;
+        // フレームごと
+        std::vector<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>> commandAllocators;
+        ResourceStateTracker stateTracker;
+        // 提出のときにこのリストの前に張る遷移を積むもの(要ったときに作る)
+        Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> fixupList;
+        std::vector<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>> fixupAllocators;
+    };
+
+    void CreateCommandList(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>& commandList,
+        std::vector<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>>& commandAllocators);
+
+    ID3D12Device* device_ = nullptr;
+    ID3D12CommandQueue* commandQueue_ = nullptr;
+    uint32_t frameCount_ = 0;
+    ID3D12DescriptorHeap* shaderVisibleHeap_ = nullptr;
+    ResourceStateRegistry& resourceStates_;
+    uint32_t frameIndex_ = 0;
+    ID3D12GraphicsCommandList* head_ = nullptr;
+    // 0番のcommandListは使わない(headを使う)。ワーカーが触っている間に動かないよう1つずつ確保する
+    std::vector<std::unique_ptr<List>> lists_;
+    std::vector<ID3D12CommandList*> submitLists_;
+};
@@ -0,0 +1,74 @@
+#pragma once
+#include "DescriptorIndexAllocator.h"
+#include <cstdint>
+#include <d3d12.h>
+#include <vector>
+#include <wrl.h>
+
+// ディスクリプタヒープの中の連続した範囲
+struct DescriptorRange {
+    uint32_t index = UINT32_MAX;
+    uint32_t count = 0;
+    D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle {};
+    // シェーダーから見えるヒープのときだけ
+    D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle {};
+
+    bool IsValid() const { return index != UINT32_MAX; }
+};
+
+// CBV/SRV/UAVのディスクリプタをまとめて管理する
+// シェーダーから見えるヒープは[0, persistentCount)を常駐用にし、残りをフレームごとのリングにする
+// SRVはCPUだけから見えるステージングヒープに作り、描画に使う分だけをそのフレームのリングへまとめて写す
+// 写した後はステージング側を書き換えても前のフレームには影響しない
+// 番号の割り当てはDescriptorIndexAllocatorに任せ、ここではハンドルへの変換とコピーだけを行う
+class DescriptorAllocator {
+public:
+    DescriptorAllocator(ID3D12Device* device, uint32_t persistentCount, uint32_t frameCount, uint32_t stagingCount);
+
+    DescriptorAllocator(const DescriptorAllocator&) = delete;
+    DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+
+    ID3D12DescriptorHeap* GetShaderVisibleHeap() const { return shaderVisibleHeap_.Get(); }
+
+    // ずっと使うシェーダーから見える範囲(ImGuiのフォントなど)。解放はGPUが読み終えてから
+    DescriptorRange AllocatePersistent(uint32_t count);
+    void FreePersistent(DescriptorRange& range);
+    // ビューを作っておくCPU側の範囲。写し終えていればすぐに解放してよい
+    DescriptorRange AllocateStaging(uint32_t count);
+    void FreeStaging(DescriptorRange& range);
+
+    // sourcesをこのフレームのリングの連続した範囲へ写し、テーブルの先頭を返す
+    // 実際のコピーはFlushFrameCopiesで1回にまとめる
+    D3D12_GPU_DESCRIPTOR_HANDLE StageFrameTable(const D3D12_CPU_DESCRIPTOR_HANDLE* sources, uint32_t count);
+    // 1つだけのテーブル。同じフレームで同じsourceを渡したら同じ場所を返す
+    D3D12_GPU_DESCRIPTOR_HANDLE StageFrameDescriptor(D3D12_CPU_DESCRIPTOR_HANDLE source);
+    // ExecuteCommandListsより前に呼ぶ
+    void FlushFrameCopies();
+
+    // FrameContextRingから呼ぶ。timelineはリングが足りないときに待つのに使う
+    void SetTimeline(GpuTimeline* timeline) { indices_.SetTimeline(timeline); }
+    void Reclaim(uint64_t completedValue) { indices_.Reclaim(completedValue); }
+    void FinishFrame(uint64_t fenceValue) { indices_.FinishFrame(fenceValue); }
+
+    DescriptorAllocatorStats GetStats() const { return indices_.GetStats(); }
+
+private:
+    D3D12_CPU_DESCRIPTOR_HANDLE GetShaderVisibleCpuHandle(uint32_t index) const;
+    D3D12_GPU_DESCRIPTOR_HANDLE GetShaderVisibleGpuHandle(uint32_t index) const;
+
+    ID3D12Device* device_ = nullptr;
+    uint32_t descriptorSize_ = 0;
+
+    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> shaderVisibleHeap_;
+    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> stagingHeap_;
+    D3D12_CPU_DESCRIPTOR_HANDLE shaderVisibleCpuStart_ {};
+    D3D12_GPU_DESCRIPTOR_HANDLE shaderVisibleGpuStart_ {};
+    D3D12_CPU_DESCRIPTOR_HANDLE stagingCpuStart_ {};
+
+    DescriptorIndexAllocator indices_;
+
+    // StageFrameTableとCopyDescriptorsに渡すもの(毎フレーム使い回す)
+    std::vector<uint64_t> stageSources_;
+    std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> copyDestinations_;
+    std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> copySources_;
+};
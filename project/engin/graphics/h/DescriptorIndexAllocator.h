@@ -0,0 +1,74 @@
+#pragma once
+#include "FramePacer.h"
+#include "FreeListAllocator.h"
+#include "RingAllocator.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+struct DescriptorAllocatorStats {
+    FreeListAllocatorStats persistent;
+    FreeListAllocatorStats staging;
+    RingAllocatorStats frame;
+    // 直前のフレームで写した数と、同じフレームで写し済みだったので省いた数
+    uint32_t copiedDescriptors = 0;
+    uint32_t reusedDescriptors = 0;
+    uint64_t copyCalls = 0;
+    // フレーム用の範囲が足りずにGPUを待った回数
+    uint64_t overflowWaits = 0;
+};
+
+// まだ写していないコピー。コピー先はシェーダーから見えるヒープの番号とテーブルの大きさ、コピー元は1つずつ
+struct DescriptorCopyList {
+    std::vector<uint32_t> destinations;
+    std::vector<uint32_t> destinationSizes;
+    std::vector<uint64_t> sources;
+
+    bool empty() const { return sources.empty(); }
+};
+
+// DescriptorAllocatorのうち、ヒープの中の番号だけを扱う部分(d3d12を使わないのでGPUが無くても動かせる)
+// シェーダーから見えるヒープは[0, persistentCount)を常駐用にし、残りをフレームごとのリングにする
+// コピー元はCPUハンドルの値をそのまま使う
+class DescriptorIndexAllocator {
+public:
+    DescriptorIndexAllocator(uint32_t persistentCount, uint32_t frameCount, uint32_t stagingCount);
+
+    // 入らなければkFreeListAllocationFailed
+    uint32_t AllocatePersistent(uint32_t count) { return persistent_.Allocate(count); }
+    void FreePersistent(uint32_t index, uint32_t count) { persistent_.Free(index, count); }
+    uint32_t AllocateStaging(uint32_t count) { return staging_.Allocate(count); }
+    void FreeStaging(uint32_t index, uint32_t count) { staging_.Free(index, count); }
+
+    // sourcesをこのフレームのリングの連続した範囲へ写す予約をし、シェーダーから見えるヒープの番号を返す
+    uint32_t StageFrameTable(const uint64_t* sources, uint32_t count);
+    // 1つだけのテーブル。同じフレームで同じsourceを渡したら同じ番号を返す
+    uint32_t StageFrameDescriptor(uint64_t source);
+    // 写し終えたらClearPendingCopiesで空にする
+    const DescriptorCopyList& GetPendingCopies() const { return pendingCopies_; }
+    void ClearPendingCopies();
+
+    // timelineはリングが足りないときに待つのに使う
+    void SetTimeline(GpuTimeline* timeline) { timeline_ = timeline; }
+    void Reclaim(uint64_t completedValue) { frameRing_.Reclaim(completedValue); }
+    void FinishFrame(uint64_t fenceValue);
+
+    uint32_t GetPersistentCount() const { return persistentCount_; }
+    DescriptorAllocatorStats GetStats() const;
+
+private:
+    GpuTimeline* timeline_ = nullptr;
+    uint32_t persistentCount_ = 0;
+
+    FreeListAllocator persistent_;
+    FreeListAllocator staging_;
+    RingAllocator frameRing_;
+
+    DescriptorCopyList pendingCopies_;
+    // このフレームで写したsource -> シェーダーから見えるヒープの番号
+    std::unordered_map<uint64_t, uint32_t> frameDescriptors_;
+
+    uint32_t frameCopied_ = 0;
+    uint32_t frameReused_ = 0;
+    DescriptorAllocatorStats stats_;
+};
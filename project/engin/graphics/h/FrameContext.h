@@ -0,0 +1,99 @@
+#pragma once
+#include "FramePacer.h"
+#include "RingAllocator.h"
+#include <cstdint>
+#include <d3d12.h>
+#include <vector>
+#include <wrl.h>
+
+class DescriptorAllocator;
+
+// コマンドキューとフェンスで動くGpuTimeline
+class D3D12FenceTimeline : public GpuTimeline {
+public:
+    D3D12FenceTimeline(ID3D12Device* device, ID3D12CommandQueue* commandQueue);
+    ~D3D12FenceTimeline() override;
+
+    D3D12FenceTimeline(const D3D12FenceTimeline&) = delete;
+    D3D12FenceTimeline& operator=(const D3D12FenceTimeline&) = delete;
+
+    uint64_t Signal() override;
+    uint64_t GetCompletedValue() override;
+    void Wait(uint64_t value) override;
+
+private:
+    ID3D12CommandQueue* commandQueue_ = nullptr;
+    Microsoft::WRL::ComPtr<ID3D12Fence> fence_;
+    void* fenceEvent_ = nullptr;
+    uint64_t fenceValue_ = 0;
+};
+
+// アップロードリングから切り出した場所
+struct FrameUpload {
+    void* cpuAddress = nullptr;
+    D3D12_GPU_VIRTUAL_ADDRESS gpuAddress = 0;
+    // CopyBufferRegionのコピー元に使うとき
+    ID3D12Resource* resource = nullptr;
+    uint64_t offset = 0;
+};
+
+struct FrameUploadStats {
+    RingAllocatorStats ring;
+    // 空きを作るためにGPUを待った回数と、リングに入りきらずに専用のバッファを作った回数と量
+    uint64_t overflowWaits = 0;
+    uint64_t overflowBuffers = 0;
+    uint64_t overflowBytes = 0;
+};
+
+// フレームごとのコマンドアロケータをframeCount個持ち、FramePacerで順に使い回す
+// 毎フレーム書き換える定数や頂点は、ずっとMapしたままの1つのアップロードリングから切り出す
+// 切り出した分はそのフレームの印が終わったら返るので、GPUが読んでいる前のフレームの分は壊さない
+class FrameContextRing {
+public:
+    FrameContextRing(ID3D12Device* device, ID3D12CommandQueue* commandQueue, uint32_t frameCount, uint64_t uploadRingBytes);
+
+    FrameContextRing(const FrameContextRing&) = delete;
+    FrameContextRing& operator=(const FrameContextRing&) = delete;
+
+    // フレームを始める。必要ならGPUを待ってから、このフレームのアロケータでcommandListを開き直す
+    uint32_t BeginFrame(ID3D12GraphicsCommandList* commandList);
+    // ExecuteCommandListsの後に呼ぶ
+    void EndFrame();
+    void WaitIdle() { pacer_.WaitIdle(); }
+    void DeferRelease(std::function<void()> release) { pacer_.DeferRelease(std::move(release)); }
+    // フレームごとのディスクリプタのリングも、アップロードリングと同じ印で返す
+    void AttachDescriptorAllocator(DescriptorAllocator* descriptors);
+
+    // アップロードリングから切り出す(このフレームをGPUが終えるまで有効)
+    // 空きが無ければ古いフレームを待ち、それでも入らなければこのフレームだけの専用バッファを作る
+    FrameUpload AllocateUpload(uint64_t sizeInBytes, uint64_t alignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+    template <class T>
+    T* AllocateUpload(D3D12_GPU_VIRTUAL_ADDRESS& gpuAddress, uint32_t count = 1)
+    {
+        FrameUpload upload = AllocateUpload(sizeof(T) * count);
+        gpuAddress = upload.gpuAddress;
+        return static_cast<T*>(upload.cpuAddress);
+    }
+
+    // 最初のコマンドリストを作るときに使う
+    ID3D12CommandAllocator* GetCommandAllocator() const { return frames_[pacer_.GetFrameIndex()].commandAllocator.Get(); }
+    uint32_t GetFrameCount() const { return pacer_.GetFrameCount(); }
+    const FramePacerStats& GetStats() const { return pacer_.GetStats(); }
+    FrameUploadStats GetUploadStats() const;
+
+private:
+    struct Frame {
+        Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator;
+    };
+
+    ID3D12Device* device_ = nullptr;
+    // pacer_がデストラクタでGPUを待つので、待つ前にタイムラインやバッファが消えないよう先に宣言する
+    D3D12FenceTimeline timeline_;
+    std::vector<Frame> frames_;
+    Microsoft::WRL::ComPtr<ID3D12Resource> uploadBuffer_;
+    uint8_t* uploadData_ = nullptr;
+    RingAllocator uploadRing_;
+    DescriptorAllocator* descriptors_ = nullptr;
+    FramePacer pacer_;
+    FrameUploadStats uploadStats_;
+};
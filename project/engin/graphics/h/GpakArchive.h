@@ -0,0 +1,117 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// .gpak の形式
+// [ヘッダー][ディレクトリ(オープンアドレスのハッシュ表)][パス文字列][4KiB境界にそろえたファイル本体...]
+// 圧縮したファイルの本体は [ブロックごとの格納サイズ(uint32) x ブロック数][ブロック...]
+constexpr uint32_t kGpakMagic = 0x4B415047; // "GPAK"
+constexpr uint32_t kGpakVersion = 1;
+constexpr uint64_t kGpakAlignment = 4096;
+constexpr uint32_t kGpakBlockSize = 64 * 1024;
+
+enum GpakEntryFlags : uint32_t {
+    GpakEntry_Used = 1 << 0,
+    GpakEntry_Compressed = 1 << 1,
+};
+
+struct GpakHeader {
+    uint32_t magic = kGpakMagic;
+    uint32_t version = kGpakVersion;
+    uint32_t entryCount = 0;
+    // 2の累乗
+    uint32_t bucketCount = 0;
+    uint64_t directoryOffset = 0;
+    uint64_t namesOffset = 0;
+    uint64_t namesSize = 0;
+    uint64_t fileSize = 0;
+};
+
+struct GpakEntry {
+    uint64_t pathHash = 0;
+    uint64_t offset = 0;
+    uint64_t size = 0; // 展開後のサイズ
+    uint64_t storedSize = 0; // アーカイブ内のサイズ
+    uint32_t nameOffset = 0;
+    uint32_t nameLength = 0;
+    uint32_t flags = 0;
+    uint32_t blockCount = 0;
+};
+
+// アーカイブから読んだファイルの中身
+// 無圧縮ならマップしたメモリを直接指し、圧縮やアーカイブ外のファイルはstorageに展開する
+struct AssetBytes {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    std::vector<uint8_t> storage;
+
+    bool empty() const { return data == nullptr; }
+};
+
+// .gpakをメモリマップして読む。Open後は読み取り専用なので複数スレッドから同時に読める
+class GpakArchive {
+public:
+    GpakArchive() = default;
+    ~GpakArchive();
+
+    GpakArchive(const GpakArchive&) = delete;
+    GpakArchive& operator=(const GpakArchive&) = delete;
+
+    bool Open(const std::string& archivePath);
+    void Close();
+    bool IsOpen() const { return header_ != nullptr; }
+
+    // 渡したパスはTextureCache::NormalizePathでそろえてから引く。ハッシュ1回と平均1回程度の比較で見つかる
+    const GpakEntry* Find(const std::string& path) const;
+    bool Contains(const std::string& path) const { return Find(path) != nullptr; }
+    // 中身を取り出す。無圧縮ならコピーしない
+    bool Read(const std::string& path, AssetBytes& bytes) const;
+    bool Read(const GpakEntry& entry, AssetBytes& bytes) const;
+    std::string GetName(const GpakEntry& entry) const;
+
+    uint32_t GetEntryCount() const { return header_ ? header_->entryCount : 0; }
+    // 使用中のエントリーを列挙する
+    std::vector<const GpakEntry*> GetEntries() const;
+
+private:
+    const uint8_t* base_ = nullptr;
+    uint64_t mappedSize_ = 0;
+    const GpakHeader* header_ = nullptr;
+    const GpakEntry* buckets_ = nullptr;
+    // Windowsだけで使う(それ以外はmmapしたメモリだけを持つ)
+    void* fileHandle_ = nullptr;
+    void* mappingHandle_ = nullptr;
+};
+
+// ファイルがアーカイブにあればそこから、無ければディスクから読む(archiveはnullptrでもよい)
+bool ReadAssetBytes(const GpakArchive* archive, const std::string& filePath, AssetBytes& bytes);
+
+// パッカーの統計
+struct GpakPackStats {
+    uint32_t files = 0;
+    uint32_t compressedFiles = 0;
+    uint64_t sourceBytes = 0;
+    uint64_t archiveBytes = 0;
+    double milliseconds = 0.0;
+};
+
+// ファイルを集めて.gpakを書き出す
+class GpakWriter {
+public:
+    // archivePathはアーカイブ内で引くときのパス。compressはブロック圧縮を試す(縮まなければ無圧縮で入れる)
+    void AddFile(const std::string& sourcePath, const std::string& archivePath, bool compress);
+    // 圧縮はスレッドプールで並列に行う。読めない元ファイルや書き込みの失敗があればfalseを返し、出力は残さない
+    bool Write(const std::string& outputPath, ThreadPool& threadPool, GpakPackStats& stats);
+
+private:
+    struct Source {
+        std::string sourcePath;
+        std::string archivePath;
+        bool compress = false;
+    };
+    std::vector<Source> sources_;
+};
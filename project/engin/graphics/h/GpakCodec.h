@@ -0,0 +1,12 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// .gpakのブロック圧縮(LZ4に近い形式)
+// トークン(上位4bitがリテラル長、下位4bitが一致長-4)、リテラル、2バイトのオフセット、の繰り返しで、最後はリテラルだけで終わる
+
+// 縮まなければfalse
+bool GpakCompressBlock(const uint8_t* source, size_t sourceSize, std::vector<uint8_t>& destination);
+// 壊れたデータやdestinationSizeとちょうど合わない展開結果はfalse
+bool GpakDecompressBlock(const uint8_t* source, size_t sourceSize, uint8_t* destination, size_t destinationSize);
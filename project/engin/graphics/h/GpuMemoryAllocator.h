@@ -0,0 +1,118 @@
+#pragma once
+#include "TlsfAllocator.h"
+#include <cstdint>
+#include <d3d12.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <wrl.h>
+
+// ヒープに置けるリソースの種類。Resource Heap Tier 1ではこの3つを同じヒープに混ぜられない
+enum class GpuResourceClass {
+    Buffer,
+    Texture,
+    RenderTarget, // レンダーターゲットと深度ステンシル
+    Count,
+};
+
+GpuResourceClass ClassifyGpuResource(const D3D12_RESOURCE_DESC& resourceDesc);
+// その種類だけを置くヒープのフラグ
+D3D12_HEAP_FLAGS GetGpuResourceHeapFlags(GpuResourceClass resourceClass);
+
+// GpuMemoryAllocatorから作ったリソース。使い終わったらGPUが読み終えてからFreeする
+struct GpuAllocation {
+    Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+    // どのプールのどのヒープに置いたか(ヒープに入らず単独で作ったものはpoolがUINT32_MAX)
+    uint32_t pool = UINT32_MAX;
+    uint32_t heap = 0;
+    TlsfAllocation range;
+
+    bool IsPlaced() const { return pool != UINT32_MAX; }
+};
+
+struct GpuMemoryPoolStats {
+    std::string name;
+    uint32_t heapCount = 0;
+    // プール内の全ヒープの合計(largestFreeBlockは一番大きいもの、fragmentationは一番悪いヒープのもの)
+    TlsfAllocatorStats heaps;
+};
+
+struct GpuMemoryStats {
+    uint64_t heapBytes = 0;
+    uint64_t usedBytes = 0;
+    uint32_t heapCount = 0;
+    uint32_t placedResources = 0;
+    // 4KBアラインメントで置けた小さいテクスチャ
+    uint32_t smallTextures = 0;
+    // ヒープより大きいなどで単独のヒープに作ったもの
+    uint32_t committedResources = 0;
+    uint64_t committedBytes = 0;
+    uint32_t defragmentMoves = 0;
+    std::vector<GpuMemoryPoolStats> pools;
+};
+
+// 大きなID3D12Heapをまとめて確保し、その中にTLSFでリソースを置いていく
+// ヒープの種類(DEFAULT/UPLOAD/CUSTOM)とリソースの種類ごとにプールを分ける
+class GpuMemoryAllocator {
+public:
+    // heapBytesごとにヒープを足していく。heapBytesの半分より大きいものは単独で作る
+    void Initialize(ID3D12Device* device, uint64_t heapBytes);
+
+    GpuAllocation CreateResource(const D3D12_HEAP_PROPERTIES& heapProperties, const D3D12_RESOURCE_DESC& resourceDesc,
+        D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* clearValue = nullptr);
+    // 既定はCPUから書き込むアップロード用
+    GpuAllocation CreateBuffer(uint64_t sizeInBytes, D3D12_HEAP_TYPE heapType = D3D12_HEAP_TYPE_UPLOAD,
+        D3D12_RESOURCE_STATES initialState = D3D12_RESOURCE_STATE_GENERIC_READ);
+    // GPUが読み終えてから呼ぶ。空になったヒープはプールに1つ残して解放する
+    void Free(GpuAllocation& allocation);
+
+    // ヒープの後ろにあるリソースを前の空きへ移す。toは元と同じ設定と初期状態で作ってある
+    // moveは中身をtoへ移して参照を差し替えたらtrueを返す(fromはGPUが読み終えてからFreeする)。戻り値は移した数
+    using MoveFunc = std::function<bool(const GpuAllocation& from, GpuAllocation& to)>;
+    uint32_t Defragment(uint32_t maxMoves, const MoveFunc& move);
+
+    GpuMemoryStats GetStats() const;
+
+private:
+    struct Placement {
+        ID3D12Resource* resource = nullptr;
+        D3D12_RESOURCE_STATES initialState = D3D12_RESOURCE_STATE_COMMON;
+        D3D12_CLEAR_VALUE clearValue {};
+        bool hasClearValue = false;
+        bool smallTexture = false;
+    };
+
+    struct Heap {
+        Microsoft::WRL::ComPtr<ID3D12Heap> heap;
+        TlsfAllocator allocator;
+        // TLSFのブロック番号ごとに置いたリソース(デフラグで作り直すのに使う)
+        std::vector<Placement> placements;
+
+        explicit Heap(uint64_t heapBytes);
+    };
+
+    struct Pool {
+        D3D12_HEAP_PROPERTIES heapProperties {};
+        GpuResourceClass resourceClass = GpuResourceClass::Buffer;
+        // 空いた番号はnullptrのまま残し、次に足すヒープが使う
+        std::vector<std::unique_ptr<Heap>> heaps;
+    };
+
+    uint32_t FindPool(const D3D12_HEAP_PROPERTIES& heapProperties, GpuResourceClass resourceClass);
+    uint32_t AddHeap(Pool& pool);
+    // 置く場所が決まったリソースを作り、ヒープに記録する
+    GpuAllocation CreatePlaced(uint32_t poolIndex, uint32_t heapIndex, const TlsfAllocation& range, const D3D12_RESOURCE_DESC& resourceDesc,
+        D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* clearValue);
+    void ForgetPlacement(Heap& heap, uint32_t block);
+
+    ID3D12Device* device_ = nullptr;
+    uint64_t heapBytes_ = 0;
+    std::vector<Pool> pools_;
+
+    uint32_t placedResources_ = 0;
+    uint32_t smallTextures_ = 0;
+    uint32_t committedResources_ = 0;
+    uint64_t committedBytes_ = 0;
+    uint32_t defragmentMoves_ = 0;
+};
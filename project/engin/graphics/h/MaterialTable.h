@@ -0,0 +1,68 @@
+#pragma once
+#include "GpuMemoryAllocator.h"
+#include "MakeAffine.h"
+#include <cstdint>
+#include <d3d12.h>
+#include <vector>
+#include <wrl.h>
+
+class FrameContextRing;
+class ResourceStateRegistry;
+class ResourceStateTracker;
+
+// シェーダーのStructuredBuffer<Material>と同じ並び(96バイト)
+struct Material {
+    Vector4 color;
+    int enableLighting;
+    int shadingType; // 0: Lambert, 1: HalfLambert
+    int alphaTest; // 0以外ならα値の低いピクセルを棄却する
+    float padding;
+    Matrix4x4 uvTransform;
+};
+
+using MaterialId = uint32_t;
+
+struct MaterialTableStats {
+    uint32_t materialCount = 0;
+    uint32_t capacity = 0;
+    // 直前のUploadで送った数とコピーの回数
+    uint32_t uploadedMaterials = 0;
+    uint32_t copyCommands = 0;
+    uint64_t totalUploadedBytes = 0;
+};
+
+// 全マテリアルを1つのStructuredBufferにまとめ、描画ではIDで引く
+// 変更されたものだけを連続した範囲ごとにコピーする
+class MaterialTable {
+public:
+    // バッファはresourceStatesに加えて状態を追う
+    void Initialize(GpuMemoryAllocator& gpuMemory, ResourceStateRegistry& resourceStates, uint32_t capacity);
+
+    MaterialId Add(const Material& material);
+    const Material& Get(MaterialId id) const { return materials_[id]; }
+    // 中身が変わったときだけ送り直す対象にする
+    void Set(MaterialId id, const Material& material);
+
+    // 描画より前に積む。変更された範囲をアップロード用バッファからコピーし、シェーダーから読める状態にする
+    // コピー元はフレームのアップロードリングから切り出すので、GPUが読んでいる前のフレームの分は壊さない
+    // 読める状態への遷移はtrackerに積むだけなので、次にFlushするときの他のバリアとまとめて張られる
+    void Upload(ResourceStateTracker& tracker, FrameContextRing& frameContexts);
+
+    // ルートのSRVに渡すアドレス
+    D3D12_GPU_VIRTUAL_ADDRESS GetGpuAddress() const { return buffer_.resource->GetGPUVirtualAddress(); }
+    const MaterialTableStats& GetStats() const { return stats_; }
+
+private:
+    void MarkDirty(MaterialId id);
+
+    GpuAllocation buffer_;
+
+    std::vector<Material> materials_;
+    std::vector<uint8_t> dirty_;
+    uint32_t dirtyCount_ = 0;
+    // 変更されたものがある範囲[dirtyBegin_, dirtyEnd_)。この中だけを調べる
+    uint32_t dirtyBegin_ = 0;
+    uint32_t dirtyEnd_ = 0;
+
+    MaterialTableStats stats_;
+};
@@ -1,11 +1,16 @@
 #pragma once
 #include "MakeAffine.h"
+#include <cstdint>
+#include <string>
 #include <vector>
 
+class MeshStreamer;
+
 enum MeshType {
     MeshType_Sphere,
     MeshType_Cube,
     MeshType_Plane,
+    MeshType_Model,
     MeshType_Count
 };
 
@@ -18,6 +23,8 @@ struct VertexData {
 struct MeshData {
     std::vector<VertexData> vertices;
     Transform transform;
+    // 頂点が差し替えられるたびに増える(GPU側の再アップロード判定用)
+    uint32_t version = 0;
 };
 
 class MeshManager {
@@ -28,7 +35,16 @@ public:
     MeshType GetCurrentMeshType() const;
     std::vector<MeshData> meshes;
 
+    // 非同期読み込みに使うストリーマーを設定する
+    void AttachStreamer(MeshStreamer* streamer);
+    // ファイルからの読み込みを依頼する(完了するまでは今のメッシュのまま)
+    // fromDiskならアーカイブを通さずにディスクから読む(ホットリロード用)
+    void RequestMesh(const std::string& filePath, MeshType target, bool fromDisk = false);
+    // フレームの境目で呼ぶ。読み込みが終わったメッシュを差し替え、その数を返す
+    uint32_t Update();
+
 private:
     MeshType currentMeshType_;
+    MeshStreamer* streamer_ = nullptr;
     void InitMeshes();
-};
\ No newline at end of file
+};
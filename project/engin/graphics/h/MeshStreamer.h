@@ -0,0 +1,70 @@
+#pragma once
+#include "LockFreeQueue.h"
+#include "MeshManager.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+class GpakArchive;
+class ThreadPool;
+
+// 読み込みが終わったメッシュ
+struct StreamedMesh {
+    uint32_t requestId = 0;
+    MeshType target = MeshType_Count;
+    std::string filePath;
+    // アーカイブを通さずにディスクから読む(ホットリロード用)
+    bool fromDisk = false;
+    MeshData mesh;
+    bool succeeded = false;
+    // 依頼してから読み込み完了までの時間
+    std::chrono::steady_clock::time_point requestTime;
+    double decodeMilliseconds = 0.0;
+};
+
+// 読み込みの統計
+struct MeshStreamerStats {
+    uint32_t requested = 0;
+    uint32_t completed = 0;
+    uint32_t failed = 0;
+    uint64_t decodedBytes = 0;
+    double totalLatencyMilliseconds = 0.0;
+    double maxLatencyMilliseconds = 0.0;
+    double totalDecodeMilliseconds = 0.0;
+};
+
+// メッシュファイルをワーカースレッドで読み込み、完了したものをロックフリーキューで返す
+class MeshStreamer {
+public:
+    explicit MeshStreamer(ThreadPool& threadPool);
+    ~MeshStreamer();
+
+    MeshStreamer(const MeshStreamer&) = delete;
+    MeshStreamer& operator=(const MeshStreamer&) = delete;
+
+    // ファイルをこのアーカイブから読む(無いものはディスクから読む)。Requestより先に呼ぶ
+    void SetArchive(const GpakArchive* archive) { archive_ = archive; }
+    // 読み込みを依頼する。戻り値はリクエストID。fromDiskならアーカイブを通さずにディスクから読む
+    uint32_t Request(const std::string& filePath, MeshType target, bool fromDisk = false);
+    // 完了したメッシュを1つ取り出す(無ければnullptr)。メインスレッドから呼ぶ
+    std::unique_ptr<StreamedMesh> PopCompleted();
+    // 読み込み中の数
+    uint32_t GetPendingCount() const { return pending_.load(std::memory_order_acquire); }
+
+    MeshStreamerStats GetStats();
+
+private:
+    void Decode(StreamedMesh& result);
+
+    ThreadPool& threadPool_;
+    const GpakArchive* archive_ = nullptr;
+    LockFreeQueue<std::unique_ptr<StreamedMesh>, 64> completed_;
+    std::atomic<uint32_t> nextRequestId_ { 1 };
+    std::atomic<uint32_t> pending_ { 0 };
+
+    std::mutex statsMutex_;
+    MeshStreamerStats stats_;
+};
@@ -0,0 +1,143 @@
+#pragma once
+#include "MakeAffine.h"
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// ワールド空間の軸にそろった箱
+struct OcclusionBounds {
+    Vector3 min;
+    Vector3 max;
+};
+
+// 直前のフレームのもの
+struct OcclusionCullerStats {
+    uint32_t occluders = 0;
+    uint32_t occluderTriangles = 0;
+    // 近クリップと裏面を除いて実際にラスタライズした三角形
+    uint32_t rasterizedTriangles = 0;
+    uint32_t tested = 0;
+    // 視錐台の外(カメラの後ろを含む)と、オクルーダーの陰で隠れたもの
+    uint32_t frustumCulled = 0;
+    uint32_t occlusionCulled = 0;
+    uint32_t threadCount = 0;
+    double rasterMilliseconds = 0.0;
+    double hizMilliseconds = 0.0;
+    double testMilliseconds = 0.0;
+
+    uint32_t GetVisible() const { return tested - frustumCulled - occlusionCulled; }
+    double GetCullRate() const { return tested > 0 ? double(frustumCulled + occlusionCulled) / tested : 0.0; }
+    double GetTotalMilliseconds() const { return rasterMilliseconds + hizMilliseconds + testMilliseconds; }
+};
+
+// CPUで行うオクルージョンカリング
+// 選んだオクルーダーのメッシュを低解像度の深度バッファにタイルごとにSIMDでラスタライズし、
+// 2x2の一番遠い深度をたどる階層Z(HiZ)を作って、物の箱をその粗い深度と比べる
+// 三角形の変換と振り分け、タイルのラスタライズ、箱の判定はそれぞれスレッドに分けて行う
+// 頂点は1/16ピクセルに丸めて辺を整数で調べ、辺の上の画素は左上の規則でどちらか一方だけが描くので、辺を共有する三角形の間に隙間ができない
+// 深度はD3Dと同じく0(近)から1(遠)、画面はyが下向き。表は時計回り
+class OcclusionCuller {
+public:
+    // 深度バッファのタイルの大きさ。幅と高さはこの倍数にする
+    static constexpr uint32_t kTileWidth = 64;
+    static constexpr uint32_t kTileHeight = 32;
+    // 頂点を丸める細かさ(1ピクセルを2^kSubpixelBitsに分ける)
+    static constexpr int32_t kSubpixelBits = 4;
+    // 画面の中心からこのピクセル数より外に出る三角形はそこで切る(辺の式を32bitで求められる広さ)。幅と高さはこの2倍まで
+    static constexpr int32_t kGuardBandPixels = 960;
+
+    // threadPoolがnullptrなら呼び出しスレッドだけで処理する
+    explicit OcclusionCuller(ThreadPool* threadPool = nullptr, uint32_t width = 320, uint32_t height = 192);
+
+    // 使うスレッド数(呼び出しスレッドを含む)。0ならプールの全スレッドを使う
+    void SetThreadCount(uint32_t threadCount) { threadCount_ = threadCount; }
+    uint32_t GetMaxThreadCount() const;
+
+    // フレームを始める。viewProjectionはワールドからクリップ空間(行ベクトル形式)
+    void BeginFrame(const Matrix4x4& viewProjection);
+    // オクルーダーを足す。positionsはstrideInBytesおきに並んだx, y, zで、vertexCountは3の倍数(三角形リスト)
+    // 中身はRasterizeが終わるまで読むので、それまで残しておく
+    void AddOccluder(const void* positions, uint32_t strideInBytes, uint32_t vertexCount, const Matrix4x4& world);
+    // 足したオクルーダーを深度バッファに描き、HiZを作る
+    void Rasterize();
+
+    // 箱が見えるかもしれなければtrue。Rasterizeの後に呼ぶ(同時に呼んでよい)
+    bool TestBounds(const OcclusionBounds& bounds) const;
+    // count個の箱をスレッドに分けて判定し、visibleに1(見える)か0を書く。戻り値は見える数
+    uint32_t TestBounds(const OcclusionBounds* bounds, uint32_t count, uint8_t* visible);
+
+    uint32_t GetWidth() const { return width_; }
+    uint32_t GetHeight() const { return height_; }
+    // 描いた深度(width*height、何も描いていないところは1)
+    const std::vector<float>& GetDepthBuffer() const { return levels_[0].depth; }
+    const OcclusionCullerStats& GetLastStats() const { return stats_; }
+
+private:
+    enum class TestResult : uint8_t {
+        Visible,
+        OutsideFrustum,
+        Occluded,
+    };
+
+    struct Occluder {
+        const uint8_t* positions = nullptr;
+        uint32_t stride = 0;
+        uint32_t triangleCount = 0;
+        // 全オクルーダーを通した最初の三角形の番号
+        uint32_t firstTriangle = 0;
+        Matrix4x4 worldViewProjection;
+    };
+
+    // 画面上の三角形。頂点は固定小数点のピクセルで、三角形の中の深度は z = zAtOrigin + dzdx * x + dzdy * y (ピクセル)
+    struct ScreenTriangle {
+        int32_t x[3];
+        int32_t y[3];
+        // 中心が三角形の外接矩形に入る画素の範囲(画面の中に収めたもの)
+        int32_t minX;
+        int32_t minY;
+        int32_t maxX;
+        int32_t maxY;
+        float zAtOrigin;
+        float dzdx;
+        float dzdy;
+    };
+
+    // 三角形の変換を分けた1つ分。タイルごとの振り分けをここに持つので、ワーカー同士でロックしない
+    struct SetupChunk {
+        std::vector<ScreenTriangle> triangles;
+        std::vector<std::vector<uint32_t>> bins;
+    };
+
+    struct Level {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<float> depth;
+    };
+
+    void SetupTriangles(uint32_t begin, uint32_t end, SetupChunk& chunk) const;
+    // クリップ空間の三角形(近クリップ面とガードバンドで切ったもの)を画面に写して振り分ける
+    void BinTriangle(const float (*clip)[4], SetupChunk& chunk) const;
+    void RasterizeTile(uint32_t tile);
+    void BuildHiZ();
+    TestResult Test(const OcclusionBounds& bounds) const;
+    uint32_t ResolveThreadCount() const;
+
+    ThreadPool* threadPool_ = nullptr;
+    uint32_t threadCount_ = 0;
+    uint32_t width_ = 0;
+    uint32_t height_ = 0;
+    uint32_t tilesX_ = 0;
+    uint32_t tilesY_ = 0;
+    // クリップ空間でのガードバンドの広さ(|x| <= guardBandX_ * w)
+    float guardBandX_ = 0.0f;
+    float guardBandY_ = 0.0f;
+    Matrix4x4 viewProjection_ {};
+    std::vector<Occluder> occluders_;
+    uint32_t triangleCount_ = 0;
+    std::vector<SetupChunk> chunks_;
+    uint32_t chunkCount_ = 0;
+    // 0番が深度バッファで、後ろほど粗い(1x1まで)
+    std::vector<Level> levels_;
+    OcclusionCullerStats stats_;
+};
@@ -0,0 +1,74 @@
+#pragma once
+#include "PipelineTable.h"
+#include <cstdint>
+#include <d3d12.h>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <wrl.h>
+
+class ThreadPool;
+
+struct PipelineCacheStats {
+    uint32_t requests = 0;
+    // すでに作ってあった(または作っている途中だった)ので作らずに済んだ数
+    uint32_t deduplicated = 0;
+    // パイプラインライブラリから読めた数と、新しく作った数
+    uint32_t libraryHits = 0;
+    uint32_t created = 0;
+    uint32_t failed = 0;
+    uint32_t prewarmed = 0;
+    double createMilliseconds = 0.0;
+};
+
+// パイプラインの記述全体のハッシュで作ったPSOを使い回す
+// 同じ記述は1回しか作らず、前もってワーカーで作っておける。作ったものはパイプラインライブラリに入れて次の起動で読む
+class PipelineCache {
+public:
+    PipelineCache(ID3D12Device* device, ThreadPool& threadPool, std::string libraryPath = "Resources/cooked/shaders/pipelines.plib");
+    ~PipelineCache();
+
+    PipelineCache(const PipelineCache&) = delete;
+    PipelineCache& operator=(const PipelineCache&) = delete;
+
+    // ルートシグネチャはシリアライズした中身でハッシュする(ポインターは起動ごとに変わるので)。記述で使う前に登録する
+    void RegisterRootSignature(ID3D12RootSignature* rootSignature, const void* serialized, size_t size);
+
+    // 記述全体のハッシュ(ComputePipelineKey)。デバイスを使わないのでCPUだけで確かめられる
+    static uint64_t ComputeKey(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash);
+    uint64_t GetKey(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) const;
+
+    // ワーカーで作り始める。descが指すもの(シェーダー、入力レイアウト)は作り終わるまで生かしておくこと
+    void Prewarm(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc);
+    // 作ってあればそれを返し、作っている途中なら待ち、無ければこのスレッドで作る。失敗したらnullptr
+    Microsoft::WRL::ComPtr<ID3D12PipelineState> GetOrCreate(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc);
+
+    // 新しく作ったものがあればパイプラインライブラリをファイルに書き出す
+    bool Save();
+
+    bool HasLibrary() const { return library_ != nullptr; }
+    PipelineCacheStats GetStats();
+
+private:
+    // keyのPSOを作る(ライブラリにあればそこから読む)
+    Microsoft::WRL::ComPtr<ID3D12PipelineState> Create(uint64_t key, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc);
+    void OpenLibrary();
+
+    ID3D12Device* device_ = nullptr;
+    ThreadPool& threadPool_;
+    std::string libraryPath_;
+
+    Microsoft::WRL::ComPtr<ID3D12PipelineLibrary> library_;
+    // ライブラリは読み込んだ中身を参照し続けるので、生きている間は持っておく
+    std::vector<uint8_t> libraryBytes_;
+    std::mutex libraryMutex_;
+    bool libraryChanged_ = false;
+
+    std::unordered_map<ID3D12RootSignature*, uint64_t> rootSignatureHashes_;
+
+    PipelineTable<Microsoft::WRL::ComPtr<ID3D12PipelineState>> table_;
+    // requestsとdeduplicatedはtable_が数える
+    std::mutex mutex_;
+    PipelineCacheStats stats_;
+};
@@ -0,0 +1,87 @@
+#pragma once
+#include "Hash.h"
+#include <cstdint>
+
+// パイプラインの記述全体(ルートシグネチャ、シェーダーの中身、ブレンド、ラスタライザー、深度、入力レイアウト、フォーマット)のハッシュ
+// D3D12_GRAPHICS_PIPELINE_STATE_DESCのメンバー名だけを使うので、d3d12.hを読まずにテストできる
+// ポインターは起動ごとに変わるので、シェーダーとセマンティクス名は指す先の中身を足す
+template <class GraphicsPipelineDesc>
+uint64_t ComputePipelineKey(const GraphicsPipelineDesc& desc, uint64_t rootSignatureHash)
+{
+    Hasher hasher;
+    hasher.Add(rootSignatureHash);
+    for (const auto* shader : { &desc.VS, &desc.PS, &desc.DS, &desc.HS, &desc.GS }) {
+        hasher.Add(shader->BytecodeLength);
+        hasher.Add(shader->pShaderBytecode, shader->BytecodeLength);
+    }
+    // ストリームアウトは使っていないので有無だけを見る
+    hasher.Add(desc.StreamOutput.NumEntries);
+
+    hasher.Add(desc.BlendState.AlphaToCoverageEnable);
+    hasher.Add(desc.BlendState.IndependentBlendEnable);
+    for (const auto& target : desc.BlendState.RenderTarget) {
+        hasher.Add(target.BlendEnable);
+        hasher.Add(target.LogicOpEnable);
+        hasher.Add(target.SrcBlend);
+        hasher.Add(target.DestBlend);
+        hasher.Add(target.BlendOp);
+        hasher.Add(target.SrcBlendAlpha);
+        hasher.Add(target.DestBlendAlpha);
+        hasher.Add(target.BlendOpAlpha);
+        hasher.Add(target.LogicOp);
+        hasher.Add(target.RenderTargetWriteMask);
+    }
+    hasher.Add(desc.SampleMask);
+
+    const auto& rasterizer = desc.RasterizerState;
+    hasher.Add(rasterizer.FillMode);
+    hasher.Add(rasterizer.CullMode);
+    hasher.Add(rasterizer.FrontCounterClockwise);
+    hasher.Add(rasterizer.DepthBias);
+    hasher.Add(rasterizer.DepthBiasClamp);
+    hasher.Add(rasterizer.SlopeScaledDepthBias);
+    hasher.Add(rasterizer.DepthClipEnable);
+    hasher.Add(rasterizer.MultisampleEnable);
+    hasher.Add(rasterizer.AntialiasedLineEnable);
+    hasher.Add(rasterizer.ForcedSampleCount);
+    hasher.Add(rasterizer.ConservativeRaster);
+
+    const auto& depthStencil = desc.DepthStencilState;
+    hasher.Add(depthStencil.DepthEnable);
+    hasher.Add(depthStencil.DepthWriteMask);
+    hasher.Add(depthStencil.DepthFunc);
+    hasher.Add(depthStencil.StencilEnable);
+    hasher.Add(depthStencil.StencilReadMask);
+    hasher.Add(depthStencil.StencilWriteMask);
+    for (const auto* op : { &depthStencil.FrontFace, &depthStencil.BackFace }) {
+        hasher.Add(op->StencilFailOp);
+        hasher.Add(op->StencilDepthFailOp);
+        hasher.Add(op->StencilPassOp);
+        hasher.Add(op->StencilFunc);
+    }
+
+    hasher.Add(desc.InputLayout.NumElements);
+    for (uint32_t i = 0; i < desc.InputLayout.NumElements; ++i) {
+        const auto& element = desc.InputLayout.pInputElementDescs[i];
+        hasher.AddString(element.SemanticName);
+        hasher.Add(element.SemanticIndex);
+        hasher.Add(element.Format);
+        hasher.Add(element.InputSlot);
+        hasher.Add(element.AlignedByteOffset);
+        hasher.Add(element.InputSlotClass);
+        hasher.Add(element.InstanceDataStepRate);
+    }
+
+    hasher.Add(desc.IBStripCutValue);
+    hasher.Add(desc.PrimitiveTopologyType);
+    hasher.Add(desc.NumRenderTargets);
+    for (uint32_t i = 0; i < desc.NumRenderTargets; ++i) {
+        hasher.Add(desc.RTVFormats[i]);
+    }
+    hasher.Add(desc.DSVFormat);
+    hasher.Add(desc.SampleDesc.Count);
+    hasher.Add(desc.SampleDesc.Quality);
+    hasher.Add(desc.NodeMask);
+    hasher.Add(desc.Flags);
+    return hasher.Get();
+}
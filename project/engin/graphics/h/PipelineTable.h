@@ -0,0 +1,91 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+// キーごとにパイプラインを1回だけ作るための表(GPUには触れない)
+// 同じキーを同時に要求されたら最初の1つだけが作り、残りは作り終わるまで待って同じものを受け取る
+// Tは空(nullptr)で失敗を表せる型(ComPtrなど)
+template <class T>
+class PipelineTable {
+public:
+    struct Stats {
+        uint32_t requests = 0;
+        // すでに作ってあった(または作っている途中だった)ので作らずに済んだ数
+        uint32_t deduplicated = 0;
+    };
+
+    PipelineTable() = default;
+    PipelineTable(const PipelineTable&) = delete;
+    PipelineTable& operator=(const PipelineTable&) = delete;
+
+    // 前もって作るために予約する。まだ誰も作っていなければtrue(呼び出し側が作ってFinishする)
+    bool Claim(uint64_t key)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!entries_.try_emplace(key).second) {
+            return false;
+        }
+        ++pendingCount_;
+        return true;
+    }
+
+    // 作ってあればvalueに入れてfalse、作っている途中なら待ってからfalse
+    // 無いか前に失敗していればtrueを返すので、呼び出し側が作ってFinishする
+    bool Acquire(uint64_t key, T& value)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ++stats_.requests;
+        auto [it, inserted] = entries_.try_emplace(key);
+        Entry& entry = it->second;
+        // 前に失敗したものはもう一度作る
+        if (inserted || (!entry.pending && entry.value == nullptr)) {
+            entry.pending = true;
+            ++pendingCount_;
+            return true;
+        }
+        ++stats_.deduplicated;
+        // unordered_mapの要素は再ハッシュしても動かず、消しもしないので参照を持ったまま待てる
+        finishedCondition_.wait(lock, [&entry] { return !entry.pending; });
+        value = entry.value;
+        return false;
+    }
+
+    // ClaimかAcquireで作る側になったキーの結果を入れる(失敗ならnullptr)
+    void Finish(uint64_t key, T value)
+    {
+        // WaitIdleの後に表ごと消されることがあるので、ロックを持ったまま起こす
+        std::lock_guard<std::mutex> lock(mutex_);
+        Entry& entry = entries_[key];
+        entry.value = std::move(value);
+        entry.pending = false;
+        --pendingCount_;
+        finishedCondition_.notify_all();
+    }
+
+    // 作っている途中のものがすべて終わるまで待つ
+    void WaitIdle()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        finishedCondition_.wait(lock, [this] { return pendingCount_ == 0; });
+    }
+
+    Stats GetStats()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+private:
+    struct Entry {
+        T value {};
+        bool pending = true;
+    };
+
+    std::mutex mutex_;
+    std::condition_variable finishedCondition_;
+    std::unordered_map<uint64_t, Entry> entries_;
+    uint32_t pendingCount_ = 0;
+    Stats stats_;
+};
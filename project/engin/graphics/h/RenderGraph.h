@@ -0,0 +1,107 @@
+#pragma once
+#include "GpuMemoryAllocator.h"
+#include "RenderGraphCompiler.h"
+#include "ResourceStateTracker.h"
+#include <cstdint>
+#include <d3d12.h>
+#include <functional>
+#include <string>
+#include <vector>
+#include <wrl.h>
+
+// 1フレームの描画をパスの並びとして組み立てる
+// パスは読むものと書くものを宣言し、Compileで出力に届かないパスを除き、必要なバリアをパスごとに1回にまとめ、
+// 生きている間が重ならない一時リソースを同じメモリに重ねる
+// 除去、配置、バリアの計画はd3d12に触らないRenderGraphCompilerが行い、ここではd3d12の型との受け渡しと記録を行う
+// バリアはResourceStateTrackerを通して張るので、外で積んだものともまとまり、すでにその状態なら張らない
+class RenderGraph {
+public:
+    using ExecuteFunc = std::function<void(ID3D12GraphicsCommandList* commandList)>;
+
+    // フレームの始めに呼ぶ。パスとリソースを消す(配列の確保は使い回す)
+    void Reset();
+
+    // 外で作ったリソースを使う。initialStateはフレームの始めの状態で、最後にfinalStateへ戻す
+    // Importしたものは出力として扱い、それを書くパスは除かない
+    RenderGraphResource ImportResource(const std::string& name, ID3D12Resource* resource,
+        D3D12_RESOURCE_STATES initialState, D3D12_RESOURCE_STATES finalState);
+    // このフレームの中だけで使うリソース。allocationInfoはGetResourceAllocationInfoで求めたもの
+    // 同じメモリを前に別のリソースが使っているかもしれないので、最初に使うパスはDiscardで書く(でなければCompileで検証に掛かる)
+    // レンダーターゲット、深度、UAVとして最初に書くときは、パスを呼ぶ前にDiscardResourceで中身を捨てる
+    RenderGraphResource CreateTransient(const std::string& name, const D3D12_RESOURCE_DESC& desc,
+        const D3D12_RESOURCE_ALLOCATION_INFO& allocationInfo, const D3D12_CLEAR_VALUE* clearValue = nullptr);
+
+    // パスを足して番号を返す。executeは宣言した状態になってから呼ばれる
+    uint32_t AddPass(const std::string& name, ExecuteFunc execute);
+    void Read(uint32_t pass, RenderGraphResource resource, D3D12_RESOURCE_STATES state);
+    void Write(uint32_t pass, RenderGraphResource resource, D3D12_RESOURCE_STATES state, RenderGraphLoad load = RenderGraphLoad::Preserve);
+    // 出力を誰も読まなくても除かない(読み戻しなど)
+    void SetSideEffect(uint32_t pass) { compiler_.SetSideEffect(pass); }
+
+    // 除くパス、バリア、一時リソースの置き場所を決める
+    void Compile() { compiler_.Compile(); }
+
+    // 一時リソースの実体を渡す(TransientResourceCacheから呼ぶ)
+    void BindTransient(RenderGraphResource resource, ID3D12Resource* physical);
+    ID3D12Resource* GetResource(RenderGraphResource resource) const { return resources_[resource].physical; }
+    // 残ったパスを順に、その前のバリアを1回にまとめて張りながら記録する。最後にImportしたものをfinalStateへ戻す
+    // 検証が有効なら、パスを呼ぶ前に宣言したリソースがその状態になっているかを調べる
+    void Execute(ResourceStateTracker& tracker);
+    // パスの中で記録先のリストが変わる(ParallelRecorderで分けて記録する)ときは、バリアを張る前に毎回今のリストのものを聞く
+    void Execute(const std::function<ResourceStateTracker&()>& getStateTracker);
+
+    const RenderGraphCompiler& GetCompiler() const { return compiler_; }
+    uint32_t GetResourceCount() const { return compiler_.GetResourceCount(); }
+    bool IsTransient(RenderGraphResource resource) const { return compiler_.IsTransient(resource); }
+    // 生きているパスが使わない一時リソースは置かない(firstPassがUINT32_MAXのまま)
+    const RenderGraphPlacement& GetPlacement(RenderGraphResource resource) const { return compiler_.GetPlacement(resource); }
+    const D3D12_RESOURCE_DESC& GetDesc(RenderGraphResource resource) const { return resources_[resource].desc; }
+    const D3D12_CLEAR_VALUE* GetClearValue(RenderGraphResource resource) const;
+    uint64_t GetTransientHeapBytes(GpuResourceClass resourceClass) const { return compiler_.GetTransientHeapBytes(static_cast<uint32_t>(resourceClass)); }
+
+    const RenderGraphStats& GetStats() const { return compiler_.GetStats(); }
+
+private:
+    // d3d12の実体と作り方。番号はcompiler_のリソースと同じ
+    struct Resource {
+        ID3D12Resource* physical = nullptr;
+        D3D12_RESOURCE_DESC desc {};
+        D3D12_CLEAR_VALUE clearValue {};
+        bool hasClearValue = false;
+    };
+
+    RenderGraphCompiler compiler_;
+    // パスの番号ごと
+    std::vector<ExecuteFunc> executes_;
+    std::vector<Resource> resources_;
+};
+
+// RenderGraphの一時リソースの実体を、種類ごとのヒープに置いて作る
+// 置き場所が前のフレームと同じなら作ったものを使い回し、変わったときだけ作り直す
+class TransientResourceCache {
+public:
+    // 作ったリソースはresourceStatesに加える
+    TransientResourceCache(ID3D12Device* device, ResourceStateRegistry& resourceStates) : device_(device), resourceStates_(resourceStates) { }
+
+    // graph.Compileの後に呼ぶ。作り直すときの古いヒープとリソースは、流しているフレームが終わってから消すようdeferReleaseに渡す
+    void Realize(RenderGraph& graph, const std::function<void(std::function<void()>)>& deferRelease);
+
+    uint32_t GetRebuildCount() const { return rebuilds_; }
+
+private:
+    struct Entry {
+        RenderGraphPlacement placement;
+        D3D12_RESOURCE_DESC desc {};
+        Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+    };
+
+    static bool IsSamePlacement(const Entry& entry, const RenderGraph& graph, RenderGraphResource resource);
+
+    ID3D12Device* device_ = nullptr;
+    ResourceStateRegistry& resourceStates_;
+    Microsoft::WRL::ComPtr<ID3D12Heap> heaps_[static_cast<size_t>(GpuResourceClass::Count)];
+    uint64_t heapBytes_[static_cast<size_t>(GpuResourceClass::Count)] {};
+    // グラフの一時リソースの順番に並べたもの
+    std::vector<Entry> entries_;
+    uint32_t rebuilds_ = 0;
+};
@@ -0,0 +1,182 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// グラフの中のリソースの番号
+using RenderGraphResource = uint32_t;
+constexpr RenderGraphResource kInvalidRenderGraphResource = UINT32_MAX;
+
+// リソースの状態。値はD3D12_RESOURCE_STATESと同じにしてあり、RenderGraphはそのまま置き換える
+enum RenderGraphState : uint32_t {
+    RenderGraphState_Common = 0,
+    RenderGraphState_VertexAndConstantBuffer = 0x1,
+    RenderGraphState_IndexBuffer = 0x2,
+    RenderGraphState_RenderTarget = 0x4,
+    RenderGraphState_UnorderedAccess = 0x8,
+    RenderGraphState_DepthWrite = 0x10,
+    RenderGraphState_DepthRead = 0x20,
+    RenderGraphState_NonPixelShaderResource = 0x40,
+    RenderGraphState_PixelShaderResource = 0x80,
+    RenderGraphState_StreamOut = 0x100,
+    RenderGraphState_IndirectArgument = 0x200,
+    RenderGraphState_CopyDest = 0x400,
+    RenderGraphState_CopySource = 0x800,
+    RenderGraphState_ResolveDest = 0x1000,
+    RenderGraphState_ResolveSource = 0x2000,
+};
+// RenderGraphStateを組み合わせたもの
+using RenderGraphStates = uint32_t;
+
+// 書き込むパスが前の内容を使うかどうか
+enum class RenderGraphLoad {
+    Preserve, // 前の内容に重ねる(ブレンドや深度テストなど)。前に書いたパスも残す
+    Discard, // クリアするか全体を書き直す。前に書いたパスは読まれなければ除く
+};
+
+enum class RenderGraphBarrierType {
+    Transition,
+    Aliasing, // 同じメモリを前に使っていたものから切り替える
+    Uav, // UAVへの書き込みが終わるのを待つ
+};
+
+// 分割バリアの始めと終わり
+enum class RenderGraphBarrierSplit {
+    None,
+    BeginOnly,
+    EndOnly,
+};
+
+// Compileで決めたバリア。リソースは番号のままで、Executeのときに実体に置き換える
+struct RenderGraphBarrier {
+    RenderGraphBarrierType type = RenderGraphBarrierType::Transition;
+    RenderGraphResource resource = kInvalidRenderGraphResource;
+    RenderGraphStates before = RenderGraphState_Common;
+    RenderGraphStates after = RenderGraphState_Common;
+    RenderGraphBarrierSplit split = RenderGraphBarrierSplit::None;
+};
+
+// 一時リソースを置く場所。ヒープはheapClassごとに1つ
+struct RenderGraphPlacement {
+    uint32_t heapClass = 0;
+    uint64_t offset = 0;
+    // 最初に使う状態。この状態で作り、フレームの終わり(後から同じ場所を使うものがあれば使い終えたところ)でこの状態へ戻す
+    RenderGraphStates initialState = RenderGraphState_Common;
+    // 最初と最後に使う生きているパスの順番(除いたパスは数えない)
+    uint32_t firstPass = UINT32_MAX;
+    uint32_t lastPass = 0;
+    // 同じ場所を別の一時リソースと使い回している
+    bool aliased = false;
+    // 使い終えた後に、同じ場所を別の一時リソースが使う(フレームの終わりには持ち主でない)
+    bool reusedLater = false;
+};
+
+struct RenderGraphStats {
+    uint32_t passes = 0;
+    uint32_t culledPasses = 0;
+    uint32_t resources = 0;
+    uint32_t transientResources = 0;
+    uint32_t transitionBarriers = 0;
+    uint32_t aliasingBarriers = 0;
+    uint32_t uavBarriers = 0;
+    // 使い終えてから次に使うまでの間にパスを挟むので、分割して張る遷移
+    uint32_t splitBarriers = 0;
+    // ResourceBarrierを呼ぶ回数
+    uint32_t barrierBatches = 0;
+    // 読むだけが続くときにまとめず、使うたびに1つずつ張った場合の遷移の数(比較用)
+    uint32_t naiveTransitions = 0;
+    // 最初に使うパスがDiscardで書かない一時リソース(中身が決まらないまま使われる)
+    uint32_t uninitializedTransients = 0;
+    // 一時リソースのヒープの合計と、重ねずに置いた場合の合計
+    uint64_t transientBytes = 0;
+    uint64_t unaliasedBytes = 0;
+    double compileMilliseconds = 0.0;
+};
+
+// RenderGraphのうち、パスの除去、一時リソースの配置、バリアの計画だけを行う部分
+// 状態とバリアは自前の型で持ち、d3d12に触らないのでGPUが無くても試せる
+class RenderGraphCompiler {
+public:
+    // パスとリソースを消す(配列の確保は使い回す)
+    void Reset();
+
+    // 外で作ったリソース。initialStateはフレームの始めの状態で、最後にfinalStateへ戻す
+    // Importしたものは出力として扱い、それを書くパスは除かない
+    RenderGraphResource ImportResource(const std::string& name, RenderGraphStates initialState, RenderGraphStates finalState);
+    // このフレームの中だけで使うリソース。同じheapClassのものだけを同じメモリに重ねる
+    // 同じメモリを前に別のリソースが使っているかもしれないので、最初に使うパスはDiscardで書かなければならない
+    RenderGraphResource CreateTransient(const std::string& name, uint64_t sizeInBytes, uint64_t alignment, uint32_t heapClass);
+
+    uint32_t AddPass(const std::string& name);
+    void Read(uint32_t pass, RenderGraphResource resource, RenderGraphStates state);
+    void Write(uint32_t pass, RenderGraphResource resource, RenderGraphStates state, RenderGraphLoad load = RenderGraphLoad::Preserve);
+    // 出力を誰も読まなくても除かない(読み戻しなど)
+    void SetSideEffect(uint32_t pass);
+
+    // 除くパス、バリア、一時リソースの置き場所を決める
+    void Compile();
+
+    uint32_t GetPassCount() const { return static_cast<uint32_t>(passes_.size()); }
+    const std::string& GetPassName(uint32_t pass) const { return passes_[pass].name; }
+    bool IsPassCulled(uint32_t pass) const { return passes_[pass].culled; }
+    // パスの前に張るもの、フレームの終わりに張るもの
+    const std::vector<RenderGraphBarrier>& GetPassBarriers(uint32_t pass) const { return passes_[pass].barriers; }
+    const std::vector<RenderGraphBarrier>& GetFinalBarriers() const { return finalBarriers_; }
+    // バリアを張った後、パスを呼ぶ前に中身を捨てる一時リソース(同じメモリの前の持ち主の内容を引き継がないように)
+    const std::vector<RenderGraphResource>& GetPassDiscards(uint32_t pass) const { return passes_[pass].discards; }
+    // パスが宣言したリソースと、Compileで決めたそのパスを呼ぶときの状態(続けて読むものはまとめた状態)
+    uint32_t GetAccessCount(uint32_t pass) const { return static_cast<uint32_t>(passes_[pass].accesses.size()); }
+    RenderGraphResource GetAccessResource(uint32_t pass, uint32_t access) const { return passes_[pass].accesses[access].resource; }
+    RenderGraphStates GetPlannedState(uint32_t pass, uint32_t access) const { return passes_[pass].accesses[access].plannedState; }
+
+    uint32_t GetResourceCount() const { return static_cast<uint32_t>(resources_.size()); }
+    const std::string& GetResourceName(RenderGraphResource resource) const { return resources_[resource].name; }
+    bool IsTransient(RenderGraphResource resource) const { return resources_[resource].transient; }
+    // 生きているパスが使わない一時リソースは置かない(firstPassがUINT32_MAXのまま)
+    const RenderGraphPlacement& GetPlacement(RenderGraphResource resource) const { return resources_[resource].placement; }
+    uint64_t GetTransientHeapBytes(uint32_t heapClass) const { return heapClass < heapBytes_.size() ? heapBytes_[heapClass] : 0; }
+    // 最初に使うパスがDiscardで書かない一時リソース
+    const std::vector<RenderGraphResource>& GetUninitializedTransients() const { return uninitializedTransients_; }
+
+    const RenderGraphStats& GetStats() const { return stats_; }
+
+private:
+    struct Access {
+        RenderGraphResource resource = kInvalidRenderGraphResource;
+        RenderGraphStates state = RenderGraphState_Common;
+        bool write = false;
+        RenderGraphLoad load = RenderGraphLoad::Preserve;
+        RenderGraphStates plannedState = RenderGraphState_Common;
+    };
+
+    struct Pass {
+        std::string name;
+        std::vector<Access> accesses;
+        bool sideEffect = false;
+        bool culled = false;
+        std::vector<RenderGraphBarrier> barriers;
+        std::vector<RenderGraphResource> discards;
+    };
+
+    struct Resource {
+        std::string name;
+        bool transient = false;
+        RenderGraphStates initialState = RenderGraphState_Common;
+        RenderGraphStates finalState = RenderGraphState_Common;
+        uint64_t sizeInBytes = 0;
+        uint64_t alignment = 0;
+        RenderGraphPlacement placement;
+    };
+
+    void AddAccess(uint32_t pass, const Access& access);
+    void CullPasses();
+    void PlaceTransients();
+    void BuildBarriers();
+
+    std::vector<Pass> passes_;
+    std::vector<Resource> resources_;
+    std::vector<RenderGraphBarrier> finalBarriers_;
+    std::vector<uint64_t> heapBytes_;
+    std::vector<RenderGraphResource> uninitializedTransients_;
+    RenderGraphStats stats_;
+};
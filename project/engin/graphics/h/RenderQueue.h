@@ -0,0 +1,93 @@
+#pragma once
+#include "MaterialTable.h"
+#include "RadixSort.h"
+#include <cstdint>
+#include <d3d12.h>
+#include <mutex>
+#include <vector>
+
+class ThreadPool;
+
+// 描画の順番の大分類。小さいものから描く
+enum class RenderLayer : uint32_t {
+    Opaque = 0, // 手前から奥へ(早期深度テストで塗りを減らす)
+    Transparent = 1, // 奥から手前へ(正しく重ねる)
+    Overlay = 2, // 積んだ順(2Dの重なり順を保つ)
+};
+
+// 1回の描画に必要なものとソート用のID
+// IDはキーに詰めるために下位ビットだけを使う(パイプライン8bit、マテリアル/テクスチャ/メッシュ12bit)
+struct DrawItem {
+    RenderLayer layer = RenderLayer::Opaque;
+    // カメラからの距離
+    float depth = 0.0f;
+
+    ID3D12PipelineState* pipelineState = nullptr;
+    uint32_t pipelineId = 0;
+    MaterialId materialId = 0;
+    D3D12_VERTEX_BUFFER_VIEW vertexBufferView {};
+    uint32_t meshId = 0;
+    D3D12_GPU_VIRTUAL_ADDRESS transform = 0;
+    D3D12_GPU_DESCRIPTOR_HANDLE texture {};
+    uint32_t textureId = 0;
+
+    uint32_t vertexCount = 0;
+    uint32_t startVertex = 0;
+};
+
+struct RenderQueueStats {
+    uint32_t drawCount = 0;
+    double sortMilliseconds = 0.0;
+    // 飛ばさずに処理した基数ソートの桁の数(最大8)
+    uint32_t sortPasses = 0;
+    // ソート後に実際に発行した状態の切り替え
+    uint32_t pipelineChanges = 0;
+    uint32_t materialChanges = 0;
+    uint32_t vertexBufferChanges = 0;
+    uint32_t transformChanges = 0;
+    uint32_t textureChanges = 0;
+    // 積んだ順のまま描いた場合の切り替えの合計(比較用)
+    uint32_t unsortedStateChanges = 0;
+
+    uint32_t GetStateChanges() const { return pipelineChanges + materialChanges + vertexBufferChanges + transformChanges + textureChanges; }
+};
+
+// 描画を64bitのキーで並べ替えてから発行し、状態の切り替えを減らす
+// 不透明: [レイヤー4][パイプライン8][マテリアル12][テクスチャ12][メッシュ12][深度16]
+// 半透明: [レイヤー4][反転した深度24][パイプライン8][マテリアル12][テクスチャ12][メッシュ4]
+// 2D:     [レイヤー4][積んだ順24][パイプライン8][マテリアル12][テクスチャ12][メッシュ4]
+class RenderQueue {
+public:
+    // threadPoolがあれば多いときのソートを並列に行う
+    explicit RenderQueue(ThreadPool* threadPool = nullptr)
+        : threadPool_(threadPool)
+    {
+    }
+
+    // フレームの始めに呼ぶ
+    void Clear();
+    void Submit(const DrawItem& item);
+
+    // キーで並べ替える
+    void Sort();
+    // 並べた順に発行する。ルートシグネチャとルート引数のうち共通のもの(ライトなど)は呼び出し側で設定しておく
+    // ルート引数: 0=マテリアル番号, 1=変換行列のCBV, 2=テクスチャのSRVテーブル
+    void Execute(ID3D12GraphicsCommandList* commandList);
+    // 並べた順で[begin, end)番目だけを発行する。範囲が重ならなければ別々のスレッドから別々のリストへ同時に呼んでよい
+    // 状態は範囲の始めで何も設定されていないものとして扱うので、リストごとに共通のものは呼び出し側で設定しておく
+    void Execute(ID3D12GraphicsCommandList* commandList, uint32_t begin, uint32_t end);
+
+    static uint64_t MakeKey(const DrawItem& item, uint32_t sequence);
+
+    uint32_t GetDrawCount() const { return static_cast<uint32_t>(items_.size()); }
+    const RenderQueueStats& GetStats() const { return stats_; }
+
+private:
+    ThreadPool* threadPool_ = nullptr;
+    std::vector<DrawItem> items_;
+    std::vector<SortKey> keys_;
+    std::vector<SortKey> scratch_;
+    // 同時に発行した範囲の切り替えの数を足し合わせるとき
+    std::mutex statsMutex_;
+    RenderQueueStats stats_;
+};
@@ -0,0 +1,187 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 状態を追うリソース。ID3D12Resource*をそのまま使う
+using ResourceStateKey = void*;
+
+// リソースの状態。値はD3D12_RESOURCE_STATESと同じにしてあり、ResourceStateTrackerはそのまま置き換える
+enum ResourceState : uint32_t {
+    ResourceState_Common = 0,
+    ResourceState_VertexAndConstantBuffer = 0x1,
+    ResourceState_IndexBuffer = 0x2,
+    ResourceState_RenderTarget = 0x4,
+    ResourceState_UnorderedAccess = 0x8,
+    ResourceState_DepthWrite = 0x10,
+    ResourceState_DepthRead = 0x20,
+    ResourceState_NonPixelShaderResource = 0x40,
+    ResourceState_PixelShaderResource = 0x80,
+    ResourceState_StreamOut = 0x100,
+    ResourceState_IndirectArgument = 0x200,
+    ResourceState_CopyDest = 0x400,
+    ResourceState_CopySource = 0x800,
+    ResourceState_ResolveDest = 0x1000,
+    ResourceState_ResolveSource = 0x2000,
+};
+// ResourceStateを組み合わせたもの
+using ResourceStates = uint32_t;
+
+struct ResourceStateStats {
+    // 張った遷移(分割したものは組で1つ)、エイリアシング、UAVのバリア
+    uint64_t transitions = 0;
+    uint64_t splitTransitions = 0;
+    uint64_t aliasingBarriers = 0;
+    uint64_t uavBarriers = 0;
+    // ResourceBarrierを呼んだ回数
+    uint64_t barrierCalls = 0;
+    // 張らずに済んだ遷移: すでにその状態だった/続けて積んだものをまとめた/COMMONからの暗黙の昇格で済んだ
+    uint64_t redundantAvoided = 0;
+    uint64_t mergedAvoided = 0;
+    uint64_t promotionsAvoided = 0;
+    // 提出のとき、前のリストの状態が分かってからリストの前に足した遷移と、そのためのコマンドリスト
+    uint64_t resolvedTransitions = 0;
+    uint64_t fixupLists = 0;
+    uint64_t validationErrors = 0;
+
+    void Add(const ResourceStateStats& other);
+};
+
+// キューに提出し終えたところでのリソースの状態。すべてのコマンドリストで共有し、メインスレッドだけで触る
+class ResourceStateRegistry {
+public:
+    // 状態を追うリソースを加える
+    // decaysはExecuteCommandListsの後にCOMMONへ戻り、COMMONからどの状態へも暗黙に昇格するもの(バッファ)
+    void Register(ResourceStateKey resource, ResourceStates state, bool decays = false);
+    void Unregister(ResourceStateKey resource);
+    bool IsRegistered(ResourceStateKey resource) const { return entries_.count(resource) != 0; }
+    ResourceStates GetState(ResourceStateKey resource) const;
+
+    // 検証を有効にすると、宣言した状態と追っている状態の食い違いを調べてエラーに残す
+    void SetValidation(bool enabled) { validation_ = enabled; }
+    bool IsValidationEnabled() const { return validation_; }
+    // 見つかったエラーを取り出す(溜めるのはkMaxErrors件まで)
+    std::vector<std::string> TakeErrors();
+
+    // 直前に提出したフレームの分と、起動からの合計
+    const ResourceStateStats& GetFrameStats() const { return frameStats_; }
+    const ResourceStateStats& GetTotalStats() const { return totalStats_; }
+
+    // 以下はResourceStateListとコマンドリストの提出から呼ぶ
+    bool Find(ResourceStateKey resource, ResourceStates& state, bool& decays) const;
+    // afterSubmitDecayはこの提出の後にCOMMONへ戻す(読む状態へ暗黙に昇格したテクスチャ)
+    void SetState(ResourceStateKey resource, ResourceStates state, bool afterSubmitDecay);
+    void AddStats(const ResourceStateStats& stats) { pendingStats_.Add(stats); }
+    void AddError(std::string error);
+    // ExecuteCommandListsの後に呼ぶ。戻るものをCOMMONに戻し、このフレームの数をまとめる
+    void EndSubmit();
+
+    static constexpr size_t kMaxErrors = 64;
+
+private:
+    struct Entry {
+        ResourceStates state = ResourceState_Common;
+        bool decays = false;
+        bool decayAfterSubmit = false;
+    };
+
+    std::unordered_map<ResourceStateKey, Entry> entries_;
+    bool validation_ = false;
+    std::vector<std::string> errors_;
+    ResourceStateStats pendingStats_;
+    ResourceStateStats frameStats_;
+    ResourceStateStats totalStats_;
+};
+
+enum class ResourceBarrierType {
+    Transition,
+    Aliasing,
+    Uav,
+};
+
+// 分割バリアの始めと終わり
+enum class ResourceBarrierSplit {
+    None,
+    BeginOnly,
+    EndOnly,
+};
+
+// 張るバリア。エイリアシングはresourceが前の持ち主(nullptrでよい)、resourceAfterが使い始めるもの
+struct ResourceStateBarrier {
+    ResourceBarrierType type = ResourceBarrierType::Transition;
+    ResourceStateKey resource = nullptr;
+    ResourceStateKey resourceAfter = nullptr;
+    ResourceStates before = ResourceState_Common;
+    ResourceStates after = ResourceState_Common;
+    ResourceBarrierSplit split = ResourceBarrierSplit::None;
+};
+
+// ResourceStateTrackerのうち、1つのコマンドリストの中での状態と張るバリアを決める部分
+// コマンドリストに触らず、張るものを返すだけなのでGPUが無くても試せる
+class ResourceStateList {
+public:
+    explicit ResourceStateList(ResourceStateRegistry& registry) : registry_(&registry) { }
+
+    // 記録を始める。前のリストで分かった状態は忘れる
+    void Begin();
+
+    // 使い方はResourceStateTrackerの同じ名前のもの
+    void Transition(ResourceStateKey resource, ResourceStates state);
+    void Assume(ResourceStateKey resource, ResourceStates state);
+    void BeginTransition(ResourceStateKey resource, ResourceStates state);
+    void EndTransition(ResourceStateKey resource, ResourceStates state);
+    void UavBarrier(ResourceStateKey resource);
+    void AliasingBarrier(ResourceStateKey resourceBefore, ResourceStateKey resourceAfter);
+    // 積んだバリアのうち張るものを返す(1回のResourceBarrierで張る)。次に積むまで使える
+    const std::vector<ResourceStateBarrier>& Flush();
+    // リストを閉じる前に呼ぶ。始めたままの分割バリアを終えてから、張るものを返す
+    const std::vector<ResourceStateBarrier>& End();
+
+    void Validate(ResourceStateKey resource, ResourceStates state);
+
+    // 提出のとき、提出する順にメインスレッドから呼ぶ
+    // このリストの前に張る遷移を返し、Commitでこのリストの最後の状態をregistryに書く
+    const std::vector<ResourceStateBarrier>& ResolvePending();
+    void Commit();
+
+    const ResourceStateStats& GetStats() const { return stats_; }
+
+private:
+    struct Local {
+        ResourceStates state = ResourceState_Common;
+        // 分割バリアを始めて終えていない。stateは行き先で、splitBeforeが元の状態
+        bool splitting = false;
+        ResourceStates splitBefore = ResourceState_Common;
+        // Flushしていない遷移のbarriers_の中の位置(無ければ-1)
+        int32_t queued = -1;
+        // リストの中で遷移を張った。最初に使う状態から張っているので、提出のときにちょうどその状態にしておく
+        bool transitioned = false;
+        // 提出のときに暗黙の昇格で済み、その後遷移を張っていない
+        bool promoted = false;
+    };
+    enum class PendingKind {
+        Transition, // その状態にする
+        Assume, // その状態になっているとみなした(違えば遷移する)
+        Validate, // 遷移は要らず、その状態であることを調べるだけ
+    };
+    struct Pending {
+        ResourceStateKey resource = nullptr;
+        ResourceStates state = ResourceState_Common;
+        PendingKind kind = PendingKind::Transition;
+    };
+
+    // 初めて使うならpendingに積んでtrueを返す
+    bool AddPending(ResourceStateKey resource, ResourceStates state, PendingKind kind);
+    void FinishSplit(ResourceStateKey resource, Local& local);
+    void AddError(std::string error);
+
+    ResourceStateRegistry* registry_ = nullptr;
+    std::unordered_map<ResourceStateKey, Local> states_;
+    std::vector<Pending> pending_;
+    std::vector<ResourceStateBarrier> barriers_;
+    std::vector<ResourceStateBarrier> flushed_;
+    std::vector<ResourceStateBarrier> resolved_;
+    std::vector<std::string> errors_;
+    ResourceStateStats stats_;
+};
@@ -0,0 +1,54 @@
+#pragma once
+#include "ResourceStateList.h"
+#include <d3d12.h>
+#include <vector>
+
+// 1つのコマンドリストの中でのリソースの状態を追い、要るバリアだけを積んでまとめて張る
+// リストの中で初めて使うリソースは前の状態が分からないので、提出のときにResolvePendingで前のリストの状態から遷移を決める
+// 別々のリストのものは別々のスレッドから使ってよい(registryに触るのは提出のときだけ)
+// どのバリアを張るかはResourceStateListが決め、ここではD3D12のバリアにして張るだけ
+class ResourceStateTracker {
+public:
+    explicit ResourceStateTracker(ResourceStateRegistry& registry) : list_(registry) { }
+
+    // 開いたコマンドリストで記録を始める。前のリストで分かった状態は忘れる
+    void Begin(ID3D12GraphicsCommandList* commandList);
+    ID3D12GraphicsCommandList* GetCommandList() const { return commandList_; }
+
+    // resourceをstateにする。すでにその状態(読む状態ならそれを含む状態)なら何もしない
+    // 張るのはFlushのときで、それまでに同じリソースへ積んだ遷移は1つにまとめる
+    void Transition(ID3D12Resource* resource, D3D12_RESOURCE_STATES state);
+    // このリストで初めて使うresourceが、ここでstateになっているとみなす(すでに追っているものは何もしない)
+    // 提出のときに違っていればリストの前で遷移させるので、前の状態の見当がつくならリストの中で遷移を張れる
+    void Assume(ID3D12Resource* resource, D3D12_RESOURCE_STATES state);
+    // 分割バリア。Beginを張ってからEndを張るまでの間、GPUは遷移を他の処理と重ねられる。その間resourceは使えない
+    // 同じリストで終えなかったものは、Endのときにそのリストの中で終える
+    void BeginTransition(ID3D12Resource* resource, D3D12_RESOURCE_STATES state);
+    void EndTransition(ID3D12Resource* resource, D3D12_RESOURCE_STATES state);
+    void UavBarrier(ID3D12Resource* resource);
+    // resourceAfterが同じメモリを使い始める(resourceBeforeはnullptrでよい)
+    void AliasingBarrier(ID3D12Resource* resourceBefore, ID3D12Resource* resourceAfter);
+    // 積んだバリアを1回のResourceBarrierで張る
+    void Flush();
+    // リストを閉じる前に呼ぶ。始めたままの分割バリアを終えてから張る
+    void End();
+
+    // 検証: resourceは今stateで使えるはず(検証が有効なときだけ調べる。前の状態が分からなければ提出のときに調べる)
+    void Validate(ID3D12Resource* resource, D3D12_RESOURCE_STATES state);
+
+    // 提出のとき、提出する順にメインスレッドから呼ぶ
+    // このリストの前に張る遷移を返し、Commitでこのリストの最後の状態をregistryに書く
+    const std::vector<D3D12_RESOURCE_BARRIER>& ResolvePending();
+    void Commit();
+
+    const ResourceStateStats& GetStats() const { return list_.GetStats(); }
+
+private:
+    // listが決めたバリアをD3D12のものにして並べる
+    static void ToD3D12Barriers(const std::vector<ResourceStateBarrier>& barriers, std::vector<D3D12_RESOURCE_BARRIER>& d3d12Barriers);
+
+    ResourceStateList list_;
+    ID3D12GraphicsCommandList* commandList_ = nullptr;
+    std::vector<D3D12_RESOURCE_BARRIER> barriers_;
+    std::vector<D3D12_RESOURCE_BARRIER> resolved_;
+};
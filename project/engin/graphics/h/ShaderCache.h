@@ -0,0 +1,79 @@
+#pragma once
+#include <Windows.h>
+#include <cstdint>
+#include <dxcapi.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <wrl.h>
+
+class ThreadPool;
+
+// コンパイルするシェーダー(エントリーポイントはmain)
+struct ShaderCompileDesc {
+    std::string filePath;
+    std::wstring profile;
+    // "NAME=1"の形のdefine
+    std::vector<std::wstring> defines;
+};
+
+struct ShaderCompileResult {
+    // 失敗したらnullptr
+    Microsoft::WRL::ComPtr<IDxcBlob> blob;
+    bool cacheHit = false;
+    uint64_t key = 0;
+    // コンパイラが出したエラーや警告
+    std::string messages;
+};
+
+struct ShaderCacheStats {
+    uint32_t hits = 0;
+    uint32_t compiled = 0;
+    uint32_t failed = 0;
+    double lastMilliseconds = 0.0;
+};
+
+// コンパイルしたDXILをディスクに置いておき、同じ入力なら読むだけで済ませる
+// キーはソースとインクルード(再帰)の中身、プロファイル、define、コンパイル引数、コンパイラのバージョンのハッシュ
+// 見つからないインクルードがあるシェーダーは、入力をすべて把握できないのでキャッシュせずに毎回コンパイルする
+class ShaderCache {
+public:
+    explicit ShaderCache(std::string cacheDirectory = "Resources/cooked/shaders");
+    ~ShaderCache();
+
+    // ビルド構成で決まるコンパイル引数(Debugは-Od -Zi -Qembed_debug、それ以外は-O3)
+    static const std::vector<std::wstring>& GetCompileArguments();
+
+    // まとめて取得する。キャッシュに無いものはthreadPoolで並列にコンパイルして書き込む
+    // threadPoolがnullptrならこのスレッドで順に処理する(ワーカー内から呼ぶときはnullptrにする)
+    std::vector<ShaderCompileResult> Compile(const std::vector<ShaderCompileDesc>& descs, ThreadPool* threadPool);
+
+    const std::string& GetCacheDirectory() const { return cacheDirectory_; }
+    ShaderCacheStats GetStats();
+
+private:
+    struct DxcInstances;
+    // キーに使ったソースとインクルードの中身(絶対パス→中身)
+    using SourceMap = std::unordered_map<std::string, std::string>;
+
+    // ファイルが読めなければ0。読めないインクルードがあればcacheableをfalseにする
+    // ハッシュしたファイルの中身をsourcesに入れる
+    uint64_t ComputeKey(const ShaderCompileDesc& desc, uint64_t compilerVersion, SourceMap& sources, bool& cacheable) const;
+    // キーを作ったときに読んだsourcesの中身をコンパイルする(途中で保存されてもキーと中身が食い違わない)
+    // writeCacheがfalseならキャッシュに書かない
+    void CompileOne(const ShaderCompileDesc& desc, const SourceMap& sources, ShaderCompileResult& result, DxcInstances& dxc, bool writeCache);
+    std::string GetCachePath(uint64_t key) const;
+    // 使っていないDXCのインスタンスを借りる(無ければ作る)。同時に動くスレッドの数だけ作られ、次のCompileでも使い回す
+    std::unique_ptr<DxcInstances> AcquireDxc();
+    void ReleaseDxc(std::unique_ptr<DxcInstances> dxc);
+
+    std::string cacheDirectory_;
+
+    std::mutex dxcMutex_;
+    std::vector<std::unique_ptr<DxcInstances>> idleDxc_;
+
+    std::mutex statsMutex_;
+    ShaderCacheStats stats_;
+};
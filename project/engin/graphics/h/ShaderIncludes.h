@@ -0,0 +1,7 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// #include "..."で読んでいるパスを、出てくる順に返す
+// コメントと文字列の中は見ない。<...>のインクルードはシステム側のものなので返さない
+std::vector<std::string> FindShaderIncludes(const std::string& source);
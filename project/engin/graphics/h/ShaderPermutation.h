@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// シェーダーの機能キーワードと、その組み合わせ(バリアント)
+// キーワードはソースの「// @keyword NAME」または「// @keyword NAME requires OTHER」の行で宣言する
+// バリアントごとにNAME=0/1のdefineを付けてコンパイルし、実行時の分岐を無くす
+class ShaderPermutation {
+public:
+    // 有効なキーワードのビットの組み合わせ。宣言順に下位ビットから割り当てる
+    using Key = uint32_t;
+
+    static constexpr uint32_t kMaxKeywords = 8;
+
+    // キーワードの宣言を読み、有効なバリアントを列挙する。宣言がおかしければfalse
+    bool Parse(const std::string& source);
+    bool ParseFile(const std::string& filePath);
+
+    // キーワードのビット(無ければ0)
+    Key GetKeywordBit(const std::string& name) const;
+    // 前提のキーワードが無いものを落として、有効なバリアントのキーにする
+    Key Resolve(Key key) const;
+
+    const std::vector<Key>& GetVariants() const { return variants_; }
+    uint32_t GetVariantCount() const { return static_cast<uint32_t>(variants_.size()); }
+    // Resolve済みのキーがGetVariantsの何番目か
+    uint32_t GetVariantIndex(Key key) const;
+
+    // DXCに渡すdefine("NAME=1"の形)。すべてのキーワードについて0か1を付ける
+    std::vector<std::wstring> GetDefines(Key key) const;
+    // ログやマニフェスト用の名前("LIGHTING+ALPHA_TEST"、何も無ければ"BASE")
+    std::string GetVariantName(Key key) const;
+
+private:
+    struct Keyword {
+        std::string name;
+        // 有効にするのに必要なキーワードのビット
+        Key required = 0;
+    };
+
+    std::vector<Keyword> keywords_;
+    std::vector<Key> variants_;
+};
@@ -0,0 +1,30 @@
+#pragma once
+#include "SpriteAtlasBuilder.h"
+#include "TextureCache.h"
+#include <string>
+#include <vector>
+
+class TextureManager;
+
+// SpriteAtlasBuilderのページをテクスチャとしてGPUに載せる
+class SpriteAtlas {
+public:
+    SpriteAtlas(TextureManager& textureManager, std::string name, const SpriteAtlasDesc& desc = {});
+    ~SpriteAtlas();
+
+    SpriteAtlas(const SpriteAtlas&) = delete;
+    SpriteAtlas& operator=(const SpriteAtlas&) = delete;
+
+    SpriteAtlasBuilder& GetBuilder() { return builder_; }
+    const SpriteAtlasBuilder& GetBuilder() const { return builder_; }
+
+    // 書き換わったページをミップ付きで作り直す(フレームの境目で呼ぶ)。更新したページ数を返す
+    uint32_t Update();
+    TextureHandle GetPageTexture(uint32_t page) const { return pageTextures_[page]; }
+
+private:
+    TextureManager& textureManager_;
+    std::string name_;
+    SpriteAtlasBuilder builder_;
+    std::vector<TextureHandle> pageTextures_;
+};
@@ -0,0 +1,85 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct SpriteAtlasDesc {
+    // ページの一辺(ピクセル)
+    uint32_t pageSize = 1024;
+    // ページに作るミップの数。スプライトの位置と大きさを 2^(mipLevels-1) にそろえ、縮小しても隣と混ざらないようにする
+    uint32_t mipLevels = 4;
+    // スプライトの周りに広げる縁(端のピクセルを複製する)。0ならミップに合わせて決める
+    // 指定するなら 2^(mipLevels-1) の倍数にする
+    uint32_t padding = 0;
+};
+
+// アトラス上のスプライトの位置
+struct AtlasRegion {
+    uint32_t page = 0;
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    float u0 = 0.0f;
+    float v0 = 0.0f;
+    float u1 = 0.0f;
+    float v1 = 0.0f;
+};
+
+struct SpriteAtlasStats {
+    uint32_t spriteCount = 0;
+    uint32_t pageCount = 0;
+    // 縁を除いたスプライトが占める割合
+    float occupancy = 0.0f;
+};
+
+// 小さな画像をimstb_rectpackで数枚のページに詰め込む(GPUには触れない)
+// 画素はRGBA8。追加分はPackで既存ページの空きに詰め、削除で空いた場所はRepackで回収する
+class SpriteAtlasBuilder {
+public:
+    explicit SpriteAtlasBuilder(const SpriteAtlasDesc& desc = {});
+    ~SpriteAtlasBuilder();
+
+    // スプライトを登録してIDを返す(Packするまで位置は決まらない)
+    uint32_t AddSprite(uint32_t width, uint32_t height, const uint8_t* pixels, uint32_t rowPitch);
+    void RemoveSprite(uint32_t id);
+
+    // 未配置のスプライトを詰める。入りきらなければページを増やす
+    void Pack();
+    // すべてのスプライトを詰め直す(ページ数が減ることがある)
+    void Repack();
+
+    const AtlasRegion& GetRegion(uint32_t id) const { return sprites_[id].region; }
+    bool IsPlaced(uint32_t id) const { return sprites_[id].placed; }
+    uint32_t GetPageSize() const { return desc_.pageSize; }
+    uint32_t GetMipLevels() const { return desc_.mipLevels; }
+    uint32_t GetPageCount() const { return static_cast<uint32_t>(pages_.size()); }
+    const std::vector<uint8_t>& GetPagePixels(uint32_t page) const;
+    // 前回ClearDirtyしてから書き換わったか
+    bool IsPageDirty(uint32_t page) const;
+    void ClearDirty(uint32_t page);
+    SpriteAtlasStats GetStats() const;
+
+private:
+    struct Sprite {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<uint8_t> pixels;
+        AtlasRegion region;
+        bool placed = false;
+        bool alive = false;
+    };
+    struct Page;
+
+    Page* AddPage();
+    // 縁ごとページに書き込む
+    void Blit(Page& page, const Sprite& sprite);
+    void Clear(Page& page, const AtlasRegion& region);
+
+    SpriteAtlasDesc desc_;
+    // 配置の単位(ミップの一番粗い段で1テクセル)
+    uint32_t cellSize_ = 1;
+    std::vector<Sprite> sprites_;
+    std::vector<uint32_t> freeIds_;
+    std::vector<std::unique_ptr<Page>> pages_;
+};
@@ -0,0 +1,49 @@
+#pragma once
+#include "GpuMemoryAllocator.h"
+#include "SpriteQuadBuilder.h"
+#include <cstdint>
+#include <d3d12.h>
+#include <functional>
+
+class FrameContextRing;
+class ThreadPool;
+
+// たくさんのスプライトを、テクスチャごとにまとめた少ないドローで描く
+// 板の頂点はSpriteQuadBuilderがCPUで作ってアップロードリングへ直接書く
+// インデックスはどの板も同じ並びなので、1回に描ける数の分を最初に1つだけ作っておく
+class SpriteBatch {
+public:
+    static constexpr uint32_t kMaxSpritesPerDraw = SpriteQuadBuilder::kMaxSpritesPerDraw;
+
+    // threadPoolがnullptrなら呼び出しスレッドだけで板を作る
+    explicit SpriteBatch(ThreadPool* threadPool = nullptr) : quads_(threadPool) { }
+
+    // 共有するインデックスバッファを作る
+    void Initialize(GpuMemoryAllocator& gpuMemory);
+
+    void SetThreadCount(uint32_t threadCount) { quads_.SetThreadCount(threadCount); }
+    uint32_t GetMaxThreadCount() const { return quads_.GetMaxThreadCount(); }
+    void SetSimdEnabled(bool enabled) { quads_.SetSimdEnabled(enabled); }
+
+    // 積んだスプライトを捨てる(フレームの始めに呼ぶ)
+    void Clear();
+    // textureIdはRecordのgetTextureに渡す番号
+    void Draw(uint32_t textureId, const Sprite& sprite, uint16_t layer = 0) { quads_.Draw(textureId, sprite, layer); }
+    uint32_t GetSpriteCount() const { return quads_.GetSpriteCount(); }
+
+    // 並べ替えて板の頂点をこのフレームのアップロードリングに作る。記録の前にメインスレッドで呼ぶ
+    void Build(FrameContextRing& frameContexts);
+    // Buildした板をまとめて描く
+    // ルートシグネチャとパイプライン、画面への射影のCBV、ビューポートは呼び出し側で設定しておく
+    // テクスチャはgetTexture(textureId)で受け取り、rootParameterIndexのディスクリプタテーブルに設定する
+    void Record(ID3D12GraphicsCommandList* commandList, UINT rootParameterIndex,
+        const std::function<D3D12_GPU_DESCRIPTOR_HANDLE(uint32_t textureId)>& getTexture) const;
+
+    const SpriteBatchStats& GetLastStats() const { return quads_.GetLastStats(); }
+
+private:
+    SpriteQuadBuilder quads_;
+    GpuAllocation indexBuffer_;
+    D3D12_INDEX_BUFFER_VIEW indexBufferView_ {};
+    D3D12_VERTEX_BUFFER_VIEW vertexBufferView_ {};
+};
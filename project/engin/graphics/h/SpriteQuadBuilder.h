@@ -0,0 +1,90 @@
+#pragma once
+#include "MakeAffine.h"
+#include "RadixSort.h"
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// スプライトの板の頂点(20バイト)
+struct SpriteVertex {
+    Vector2 position;
+    Vector2 texcoord;
+    uint32_t color; // RGBA8(Rが下位)
+};
+
+// 1枚のスプライト。位置と大きさは画面のピクセルで、positionが中心
+struct Sprite {
+    Vector2 position = { 0.0f, 0.0f };
+    Vector2 scale = { 1.0f, 1.0f };
+    // テクスチャの中の範囲(u0, v0, u1, v1)
+    Vector4 uvRect = { 0.0f, 0.0f, 1.0f, 1.0f };
+    // Z軸まわりの回転(ラジアン)
+    float rotation = 0.0f;
+    uint32_t color = 0xFFFFFFFF;
+};
+
+// 0から1の色をSprite::colorの形にする
+uint32_t PackSpriteColor(const Vector4& color);
+
+// 直前にBuildしたもの
+struct SpriteBatchStats {
+    uint32_t spriteCount = 0;
+    // テクスチャ(とレイヤー)が続く区間の数と、それを1回に描ける数で区切ったドローの数
+    uint32_t batchCount = 0;
+    uint32_t drawCount = 0;
+    uint32_t threadCount = 0;
+    bool simd = false;
+    double sortMilliseconds = 0.0;
+    // 板の頂点を作るのにかかった時間
+    double buildMilliseconds = 0.0;
+    double spritesPerSecond = 0.0;
+};
+
+// SpriteBatchのうち、積んだスプライトを並べ替えて板の頂点を作る部分(d3d12を使わないのでGPUが無くても測れる)
+// 積んだスプライトをレイヤーとテクスチャで並べ替え、4頂点の板をSIMDとスレッドに分けて作る
+class SpriteQuadBuilder {
+public:
+    // 1回のドローで描く最大の枚数(16bitのインデックスで引ける頂点の数)
+    static constexpr uint32_t kMaxSpritesPerDraw = 65536 / 4;
+
+    // threadPoolがnullptrなら呼び出しスレッドだけで板を作る
+    explicit SpriteQuadBuilder(ThreadPool* threadPool = nullptr);
+
+    // 使うスレッド数(呼び出しスレッドを含む)。0ならプールの全スレッドを使う
+    void SetThreadCount(uint32_t threadCount) { threadCount_ = threadCount; }
+    uint32_t GetMaxThreadCount() const;
+    // falseにすると板を1枚ずつスカラーで作る(比べる用)
+    void SetSimdEnabled(bool enabled) { simdEnabled_ = enabled; }
+
+    // 積んだスプライトを捨てる(フレームの始めに呼ぶ)
+    void Clear();
+    // layerの小さい順に描き、同じレイヤーの中はテクスチャごとにまとめる(同じテクスチャの中は積んだ順)
+    void Draw(uint32_t textureId, const Sprite& sprite, uint16_t layer = 0);
+    uint32_t GetSpriteCount() const { return static_cast<uint32_t>(sprites_.size()); }
+
+    // 並べ替えてテクスチャの区間を決める
+    void Sort();
+    // 並べ替えた順に板の頂点をoutputへ書く(GetSpriteCount()*4頂点)。outputはアップロードバッファを直接指してよい
+    void WriteVertices(SpriteVertex* output);
+
+    // テクスチャの区間(並べ替えた後の番号で、[first, first+count))
+    struct Batch {
+        uint32_t textureId = 0;
+        uint32_t first = 0;
+        uint32_t count = 0;
+    };
+    const std::vector<Batch>& GetBatches() const { return batches_; }
+    const SpriteBatchStats& GetLastStats() const { return stats_; }
+
+private:
+    ThreadPool* threadPool_ = nullptr;
+    uint32_t threadCount_ = 0;
+    bool simdEnabled_ = true;
+    std::vector<Sprite> sprites_;
+    // 上位がレイヤー、下位がテクスチャのキー
+    std::vector<SortKey> keys_;
+    std::vector<SortKey> sortScratch_;
+    std::vector<Batch> batches_;
+    SpriteBatchStats stats_;
+};
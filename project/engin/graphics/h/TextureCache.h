@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// テクスチャのハンドル(0は無効)
+using TextureHandle = uint32_t;
+constexpr TextureHandle kInvalidTextureHandle = 0;
+
+// キャッシュの統計
+struct TextureCacheStats {
+    uint32_t requests = 0;
+    uint32_t pathHits = 0; // 同じパスで再要求された
+    uint32_t contentHits = 0; // 別のパスだが中身が同じだった
+    uint32_t uniqueTextures = 0;
+    uint64_t residentBytes = 0;
+    // 共有して読み込まずに済んだバイト数(同じパスの再要求と、中身が同じ別のファイル)
+    uint64_t bytesSaved = 0;
+};
+
+// パスと中身のハッシュでテクスチャを共有するためのキャッシュ(GPUには触れない)
+class TextureCache {
+public:
+    // 区切り文字と大文字小文字、"./" "../" をそろえたパスにする
+    static std::string NormalizePath(const std::string& path);
+
+    // パスで探す。見つかれば参照を増やしてハンドルを返す
+    TextureHandle AcquireByPath(const std::string& normalizedPath);
+    // ファイルの中身のハッシュで探す。ハッシュが一致した候補はisSameContentで中身を比べ、同じならパスを別名として登録し、
+    // 参照を増やしてハンドルを返す(ハッシュの衝突で別の画像を共有しないため)
+    TextureHandle AcquireByContent(const std::string& normalizedPath, uint64_t contentHash, const std::function<bool(TextureHandle)>& isSameContent);
+    // 新しく登録する(参照数1)。byteSizeはミップを含めたGPU上のサイズ
+    TextureHandle Insert(const std::string& normalizedPath, uint64_t contentHash, uint64_t byteSize);
+
+    void AddRef(TextureHandle handle);
+    // 参照が0になったらtrueを返す(呼び出し側でGPUリソースを解放する)。無効なハンドルなら何もせずfalse
+    bool Release(TextureHandle handle);
+
+    // 参照を増やさずにパスで探す
+    TextureHandle FindByPath(const std::string& normalizedPath) const;
+    // 再読み込みで中身が変わったときに、ハッシュとサイズを付け替える
+    void UpdateContent(TextureHandle handle, uint64_t contentHash, uint64_t byteSize);
+
+    bool IsValid(TextureHandle handle) const;
+    bool ContainsPath(const std::string& normalizedPath) const { return pathTable_.count(normalizedPath) != 0; }
+    uint32_t GetRefCount(TextureHandle handle) const;
+    // 削除された後に同じ番号が再利用されるので、ハンドルは配列の添字として使える
+    uint32_t GetCapacity() const { return static_cast<uint32_t>(entries_.size()); }
+    const TextureCacheStats& GetStats() const { return stats_; }
+
+private:
+    struct Entry {
+        uint64_t contentHash = 0;
+        uint64_t byteSize = 0;
+        uint32_t refCount = 0;
+        std::vector<std::string> paths;
+    };
+
+    Entry* Find(TextureHandle handle);
+    const Entry* Find(TextureHandle handle) const;
+    void EraseContent(uint64_t contentHash, TextureHandle handle);
+
+    // handle - 1 が添字
+    std::vector<Entry> entries_;
+    std::vector<TextureHandle> freeHandles_;
+    std::unordered_map<std::string, TextureHandle> pathTable_;
+    // ハッシュが衝突した別の中身も並べて持つ
+    std::unordered_multimap<uint64_t, TextureHandle> contentTable_;
+    TextureCacheStats stats_;
+};
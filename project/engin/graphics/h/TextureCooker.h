@@ -0,0 +1,70 @@
+#pragma once
+#include "DirectXTex.h"
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class GpakArchive;
+class ThreadPool;
+
+// テクスチャの使い道(圧縮形式が変わる)
+enum class TextureUsage {
+    Albedo, // BC7 sRGB
+    Normal, // BC5
+    Mask, // BC4
+};
+
+// クック済みテクスチャの記録
+struct CookedTextureEntry {
+    uint64_t sourceHash = 0;
+    std::string cookedFileName;
+};
+
+struct TextureCookerStats {
+    uint32_t cooked = 0;
+    uint32_t upToDate = 0;
+    uint32_t failed = 0;
+    // ミップ込みの非圧縮サイズとクック後のサイズ
+    uint64_t uncompressedBytes = 0;
+    uint64_t cookedBytes = 0;
+    double milliseconds = 0.0;
+};
+
+// 元画像をBC圧縮+ミップ付きのDDSに変換する
+// 結果は元ファイルのハッシュで管理し、変わっていないものはクックし直さない
+class TextureCooker {
+public:
+    explicit TextureCooker(std::string cookedDirectory = "Resources/cooked");
+
+    // ファイル名から使い道を決める(_n, _normal: 法線 / _mask, _rough, _ao など: マスク / それ以外: アルベド)
+    static TextureUsage GuessUsage(const std::string& filePath);
+    static DXGI_FORMAT GetCookedFormat(TextureUsage usage);
+    // directory以下の画像ファイルを探す(クック先は除く)
+    static std::vector<std::string> FindSourceFiles(const std::string& directory, const std::string& cookedDirectory = "Resources/cooked");
+    // マニフェストを読む。キーは正規化した元ファイルのパス。archiveにあればそちらから読む
+    static std::unordered_map<std::string, CookedTextureEntry> ReadManifest(const std::string& cookedDirectory, const GpakArchive* archive = nullptr);
+
+    // sourceFilesを並列にクックし、マニフェストを書き出す
+    TextureCookerStats Cook(const std::vector<std::string>& sourceFiles, ThreadPool& threadPool);
+    // 1ファイルだけクックしてマニフェストを書き直す(ワーカーから呼べる)。成功したらentryに結果を入れる
+    bool CookSingle(const std::string& sourceFile, CookedTextureEntry& entry);
+    const std::string& GetCookedDirectory() const { return cookedDirectory_; }
+    // クック済みとして記録されているか
+    bool IsCooked(const std::string& sourceFile) const;
+
+private:
+    void CookFile(const std::string& sourceFile, TextureCookerStats& stats);
+    void WriteManifest() const;
+
+    std::string cookedDirectory_;
+    std::unordered_map<std::string, CookedTextureEntry> manifest_;
+    // 同じ中身を同時にクックしないように。クックしている間だけ入れておく
+    std::unordered_set<std::string> cookingFiles_;
+    // cookingFiles_から外れたら知らせる
+    std::condition_variable cookedCondition_;
+    mutable std::mutex mutex_;
+};
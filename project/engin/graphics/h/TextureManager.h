@@ -0,0 +1,176 @@
+#pragma once
+#include "DescriptorAllocator.h"
+#include "DirectXTex.h"
+#include "GpakArchive.h"
+#include "GpuMemoryAllocator.h"
+#include "TextureCache.h"
+#include "TextureCooker.h"
+#include "TextureResidency.h"
+#include "TextureUploader.h"
+#include <condition_variable>
+#include <cstdint>
+#include <d3d12.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <wrl.h>
+
+class StartupTimeline;
+class ThreadPool;
+
+// 読み込んだテクスチャとそのSRV
+struct Texture {
+    // GpuMemoryAllocatorのDEFAULTヒープに置いたリソース。SRVが指しているのはこちら
+    GpuAllocation memory;
+    DirectX::TexMetadata metadata {};
+    // ステージングヒープに作ったSRV。最初のコピーが終わるまではヌルのビュー
+    DescriptorRange srv;
+    // 読み込んだファイル。中身による共有でバイトを比べるのに使う(CreateTextureで作ったものは空)
+    std::string sourcePath;
+
+    // ストリーミング時のみ: 全ミップのCPU側コピーと、GPUに載っている一番細かいミップ
+    std::shared_ptr<DirectX::ScratchImage> sourceImages;
+    uint32_t residentMip = 0;
+    uint32_t residencyId = UINT32_MAX;
+
+    // コピーキューで写している途中の作り直し。終わったらmemoryと入れ替える
+    GpuAllocation pendingMemory;
+    uint32_t pendingMip = 0;
+    uint32_t uploadTicket = 0;
+};
+
+// 再読み込みのためにワーカーで作り直した画像
+struct PreparedTexture {
+    DirectX::ScratchImage mipImages;
+    uint64_t contentHash = 0;
+    // クックし直した場合のマニフェストの記録
+    bool cooked = false;
+    CookedTextureEntry cookedEntry;
+};
+
+// テクスチャの読み込みと共有を行う
+// 同じパス、または中身が同じファイルは一度だけ読み込み、同じハンドルを返す
+class TextureManager {
+public:
+    // threadPoolがあればRequestLoadのデコードとミップ生成をワーカーで行う
+    explicit TextureManager(ThreadPool* threadPool = nullptr);
+    ~TextureManager();
+
+    // リソースはgpuMemoryのヒープに置いてuploaderで中身を写し、SRVはdescriptorsのステージングヒープに作る
+    void Initialize(ID3D12Device* device, GpuMemoryAllocator* gpuMemory, DescriptorAllocator* descriptors, TextureUploader* uploader);
+    // デコード時間を記録する先
+    void SetTimeline(StartupTimeline* timeline) { timeline_ = timeline; }
+    // ファイルをこのアーカイブから読む(無いものはディスクから読む)。SetCookedDirectoryより先に呼ぶ
+    void SetArchive(const GpakArchive* archive) { archive_ = archive; }
+    // クック済みのDDSがあるものは、元画像の代わりにそれを読む
+    void SetCookedDirectory(const std::string& cookedDirectory);
+    // 描画が読んでいるかもしれない古いリソースを、流しているフレームが終わってから解放するよう渡す(無ければすぐに解放する)
+    void SetDeferRelease(std::function<void(std::function<void()>)> deferRelease) { deferRelease_ = std::move(deferRelease); }
+
+    // 読み込んでハンドルを返す。使い終わったらReleaseする
+    TextureHandle Load(const std::string& filePath);
+    // 読み込みを依頼する。Initializeの前でも呼べる(WICを使うのでCoInitializeExの後に呼ぶこと)
+    void RequestLoad(const std::string& filePath);
+    // 依頼したものがすべてデコードされるまで待ち、コピーを依頼して依頼順にハンドルを返す
+    // 中身はUpdateUploadsでコピーの終わりを見つけてから見えるようになる
+    std::vector<TextureHandle> FinishLoading();
+    // フレームの境目で呼ぶ。コピーが終わったテクスチャのSRVを差し替え、その数を返す
+    uint32_t UpdateUploads();
+
+    // ミップ単位のストリーミングを有効にする(テクスチャを作る前に呼ぶ)
+    // 最初は粗いミップだけを載せ、RequestMipで要求された分を予算内で読み込む
+    void EnableStreaming(uint64_t budgetBytes);
+    void SetStreamingBudget(uint64_t budgetBytes) { residency_.SetBudget(budgetBytes); }
+    bool IsStreamingEnabled() const { return streamingEnabled_; }
+    // このフレームで必要なミップを伝える
+    void RequestMip(TextureHandle handle, uint32_t mip);
+    // フレームの境目で呼ぶ。常駐ミップが変わったテクスチャの作り直しを依頼し、その数を返す
+    uint32_t UpdateStreaming();
+    const TextureResidencyStats& GetStreamingStats() const { return residency_.GetStats(); }
+    uint32_t GetRequestedMip(TextureHandle handle) const;
+
+    // CPUで作った画像からテクスチャを作る(アトラスなど)。nameは他と重ならない名前にする
+    TextureHandle CreateTexture(const std::string& name, DirectX::ScratchImage&& mipImages);
+    // CreateTextureで作ったテクスチャの中身を差し替える(SRVの位置は変わらない)
+    void UpdateTexture(TextureHandle handle, DirectX::ScratchImage&& mipImages);
+
+    // ホットリロード用。ディスク上のファイルから画像を作り直す(アーカイブは見ない)
+    // cookerがあり、そのファイルがクック済みならクックし直したDDSを読む。ワーカーから呼べる
+    static bool PrepareReload(const std::string& filePath, TextureCooker* cooker, PreparedTexture& prepared);
+    // フレームの境目で呼ぶ。読み込み済みのテクスチャを差し替える(SRVの位置は変わらない)
+    // 中身で共有している別名のパスも同じテクスチャなので一緒に変わる
+    bool ApplyReload(const std::string& filePath, PreparedTexture&& prepared);
+    bool IsLoaded(const std::string& filePath) const { return cache_.ContainsPath(TextureCache::NormalizePath(filePath)); }
+
+    void AddRef(TextureHandle handle);
+    void Release(TextureHandle handle);
+
+    const Texture& GetTexture(TextureHandle handle) const;
+    // 描画に使うときはDescriptorAllocator::StageFrameDescriptorでそのフレームのテーブルへ写す
+    D3D12_CPU_DESCRIPTOR_HANDLE GetSrvHandleCPU(TextureHandle handle) const;
+    const TextureCacheStats& GetStats() const { return cache_.GetStats(); }
+
+private:
+    struct PendingTexture {
+        std::string filePath;
+        std::string normalizedPath;
+        // 依頼時点でパスが一致したもの
+        TextureHandle cachedHandle = kInvalidTextureHandle;
+        uint64_t contentHash = 0;
+        // 中身が同じものを別の依頼がデコードしている場合は空のまま
+        DirectX::ScratchImage mipImages;
+    };
+
+    void DecodePending(PendingTexture* pending);
+    // クック済みならマニフェストのハッシュ、そうでなければファイルを読んでハッシュを取る
+    uint64_t ResolveContentHash(const std::string& filePath, const std::string& normalizedPath, AssetBytes& fileBytes) const;
+    DirectX::ScratchImage LoadImageData(const std::string& filePath, const std::string& normalizedPath, AssetBytes& fileBytes) const;
+    // ハッシュが一致した2つのファイルが同じ画像になるか。どちらもクック済みなら同じDDSを指すかで、そうでなければバイトで比べる
+    // fileBytesが空なら読み込んで埋める
+    bool IsSameContent(const std::string& filePath, AssetBytes& fileBytes, const std::string& otherFilePath) const;
+    TextureHandle CreateFromPending(PendingTexture* pending);
+    TextureHandle InsertTexture(const std::string& filePath, const std::string& normalizedPath, uint64_t contentHash, DirectX::ScratchImage& mipImages, bool streamable);
+    // ストリーミングに登録して粗いミップだけを載せ、mipImagesはCPU側に持っておく
+    void CreateStreamedResource(TextureHandle handle, DirectX::ScratchImage&& mipImages);
+    // mipImagesのfirstMip以降を載せたリソースを作ってコピーを依頼する。SRVはコピーが終わってから書き直す
+    void CreateResidentResource(TextureHandle handle, std::shared_ptr<const DirectX::ScratchImage> mipImages, uint32_t firstMip);
+    // 写している途中の作り直しをやめる。リソースはコピーが終わってから返す
+    void AbandonUpload(Texture& texture);
+    void WriteSrv(const Texture& texture, ID3D12Resource* resource, uint32_t firstMip);
+    void ReleaseMemory(GpuAllocation& memory);
+
+    ID3D12Device* device_ = nullptr;
+    GpuMemoryAllocator* gpuMemory_ = nullptr;
+    DescriptorAllocator* descriptors_ = nullptr;
+    TextureUploader* uploader_ = nullptr;
+
+    ThreadPool* threadPool_ = nullptr;
+    StartupTimeline* timeline_ = nullptr;
+    const GpakArchive* archive_ = nullptr;
+    std::function<void(std::function<void()>)> deferRelease_;
+
+    std::string cookedDirectory_;
+    std::unordered_map<std::string, CookedTextureEntry> cookedTextures_;
+
+    std::vector<std::unique_ptr<PendingTexture>> pending_;
+    // 今回の依頼の中で、どの依頼がその中身をデコードするか
+    std::unordered_map<uint64_t, PendingTexture*> decodingContents_;
+    std::mutex pendingMutex_;
+    std::condition_variable pendingCondition_;
+    uint32_t pendingJobs_ = 0;
+
+    bool streamingEnabled_ = false;
+    uint64_t streamingFrame_ = 0;
+    TextureResidency residency_;
+
+    // コピー中のチケット -> ハンドル。やめたものはチケット -> 返すリソース
+    std::unordered_map<uint32_t, TextureHandle> uploads_;
+    std::unordered_map<uint32_t, GpuAllocation> abandonedUploads_;
+
+    TextureCache cache_;
+    // ハンドル - 1 が添字
+    std::vector<Texture> textures_;
+};
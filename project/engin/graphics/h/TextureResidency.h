@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// 常駐しているミップが変わったテクスチャ
+struct ResidencyChange {
+    uint32_t id = 0;
+    uint32_t fromMip = 0;
+    uint32_t toMip = 0;
+};
+
+struct TextureResidencyStats {
+    uint64_t budgetBytes = 0;
+    uint64_t residentBytes = 0;
+    // 直近のUpdateで読み込んだ/追い出したミップの数とバイト数
+    uint32_t loadedMips = 0;
+    uint32_t evictedMips = 0;
+    uint64_t streamedBytes = 0;
+    // 予算が足りずに要求を満たせなかったテクスチャの数
+    uint32_t starvedTextures = 0;
+    uint64_t totalStreamedBytes = 0;
+};
+
+// テクスチャごとにどのミップまでGPUに載せるかを決める(GPUには触れない)
+// ミップ番号は小さいほど細かい。residentMip以上のミップがすべて常駐している
+class TextureResidency {
+public:
+    // 画面上の大きさから必要なミップを求める。texelsAcross: 画面上の範囲に対応するテクセル数
+    static uint32_t EstimateMip(float texelsAcross, float pixelsAcross, uint32_t mipLevels);
+    // 半径radiusの球が画面上で何ピクセルになるか(fovYはラジアン)
+    static float ProjectSphereToPixels(float radius, float distance, float fovY, float screenHeight);
+
+    void SetBudget(uint64_t budgetBytes) { stats_.budgetBytes = budgetBytes; }
+    // 1回のUpdateで読み込む量の上限(ヒッチ防止)
+    void SetMaxStreamBytesPerUpdate(uint64_t bytes) { maxStreamBytesPerUpdate_ = bytes; }
+
+    // mipBytes: 各ミップのサイズ。alwaysResidentMip以上のミップは常に載せておく
+    uint32_t AddTexture(const std::vector<uint64_t>& mipBytes, uint32_t alwaysResidentMip);
+    void RemoveTexture(uint32_t id);
+
+    // このフレームで必要なミップを伝える(同じフレームで複数回呼ぶと一番細かいものになる)
+    void Request(uint32_t id, uint32_t mip, uint64_t frame);
+    // 予算内で常駐ミップを決め直し、変わったものを返す
+    std::vector<ResidencyChange> Update(uint64_t frame);
+
+    uint32_t GetResidentMip(uint32_t id) const { return entries_[id].residentMip; }
+    uint32_t GetRequestedMip(uint32_t id) const { return entries_[id].requestedMip; }
+    const TextureResidencyStats& GetStats() const { return stats_; }
+
+private:
+    struct Entry {
+        std::vector<uint64_t> mipBytes;
+        uint32_t alwaysResidentMip = 0;
+        uint32_t residentMip = 0;
+        uint32_t requestedMip = 0;
+        uint64_t lastUsedFrame = 0;
+        bool used = false;
+        bool valid = false;
+    };
+
+    // 今フレームで必要なミップ(使っていなければ常駐させる最低限まで)
+    uint32_t GetFloorMip(const Entry& entry, uint64_t frame) const;
+    // bytes分の空きができるまでLRUで追い出す。requesterは追い出さない
+    bool Evict(uint64_t bytes, uint64_t frame, uint32_t requester);
+
+    std::vector<Entry> entries_;
+    std::vector<uint32_t> freeIds_;
+    uint64_t maxStreamBytesPerUpdate_ = UINT64_MAX;
+    TextureResidencyStats stats_;
+};
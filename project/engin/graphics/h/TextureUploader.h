@@ -0,0 +1,86 @@
+#pragma once
+#include "FrameContext.h"
+#include "UploadScheduler.h"
+#include <cstdint>
+#include <d3d12.h>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <wrl.h>
+
+struct TextureUploaderStats {
+    UploadSchedulerStats scheduler;
+    // ステージングに入らずに作った専用のバッファの数と量
+    uint64_t dedicatedBuffers = 0;
+    uint64_t dedicatedBytes = 0;
+    uint32_t commandAllocators = 0;
+    // WaitIdleで止まった回数
+    uint64_t idleWaits = 0;
+};
+
+// DEFAULTヒープのテクスチャへ、コピー専用のキューで中身を写す
+// 写す内容はずっとMapしたままのステージングバッファへ書き、いくつものサブリソースを1回の提出にまとめる
+// 終わったかどうかはコピーキューのフェンスで見るので、描画のキューは待たない
+class TextureUploader {
+public:
+    TextureUploader(ID3D12Device* device, uint64_t stagingBytes, uint64_t batchBytes);
+    ~TextureUploader();
+
+    TextureUploader(const TextureUploader&) = delete;
+    TextureUploader& operator=(const TextureUploader&) = delete;
+
+    // textureのサブリソース0から順にsubresourcesを写すよう依頼し、チケットを返す
+    // textureはCOMMONで作っておく(コピーキューで暗黙にCOPY_DESTになり、終わればCOMMONに戻る)
+    // subresourcesが指す画素はsourceが持っておき、写し終えるまで残す
+    uint32_t Upload(ID3D12Resource* texture, std::vector<D3D12_SUBRESOURCE_DATA> subresources, std::shared_ptr<const void> source);
+    // 終わった提出を確かめ、待っているコピーを最大maxBatches回提出する。すべて写し終えたチケットを返す
+    // 返したチケットのテクスチャは、どのキューからもそのまま読んでよい
+    std::vector<uint32_t> Update(uint32_t maxBatches = 4);
+    // 依頼したものをすべて写し終えるまで待つ(起動時や終了時)
+    void WaitIdle();
+
+    bool IsIdle() const { return scheduler_.IsIdle(); }
+    TextureUploaderStats GetStats() const;
+
+private:
+    struct Job {
+        Microsoft::WRL::ComPtr<ID3D12Resource> texture;
+        std::vector<D3D12_SUBRESOURCE_DATA> subresources;
+        std::shared_ptr<const void> source;
+        // ステージング上の並び(Offsetは0から)
+        std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> layouts;
+        std::vector<UINT> rowCounts;
+        std::vector<UINT64> rowSizes;
+    };
+    struct CommandContext {
+        Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator;
+        uint64_t fenceValue = 0;
+    };
+
+    // バッチを記録してコピーキューに流し、フェンスの値を返す
+    uint64_t Submit(const UploadBatch& batch);
+    void WriteSubresource(const Job& job, uint32_t subresource, uint8_t* destination) const;
+    CommandContext AcquireCommandContext();
+    void CollectCompleted(uint64_t completedValue);
+
+    ID3D12Device* device_ = nullptr;
+    // timeline_がキューを使うので先に宣言する
+    Microsoft::WRL::ComPtr<ID3D12CommandQueue> commandQueue_;
+    D3D12FenceTimeline timeline_;
+    Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> commandList_;
+    // 空いているものと、提出して終わっていないもの(古い順)
+    std::vector<CommandContext> freeContexts_;
+    std::deque<CommandContext> busyContexts_;
+    uint32_t contextCount_ = 0;
+
+    Microsoft::WRL::ComPtr<ID3D12Resource> stagingBuffer_;
+    uint8_t* stagingData_ = nullptr;
+    UploadScheduler scheduler_;
+    std::unordered_map<uint32_t, Job> jobs_;
+    // WaitIdleの中で終わり、まだUpdateで返していないチケット
+    std::vector<uint32_t> waitedTickets_;
+    // 専用のバッファとそれを使った提出の印
+    std::deque<std::pair<uint64_t, Microsoft::WRL::ComPtr<ID3D12Resource>>> dedicatedBuffers_;
+    TextureUploaderStats stats_;
+};
@@ -10,32 +10,40 @@ struct Matrix3x3 {
     float m[3][3];
 };
 
+struct Vector2 {
+    float x, y;
+};
+
 struct Vector3 {
     float x;
     float y;
     float z;
 };
 
+struct Vector4 {
+    float x, y, z, w;
+};
+
 struct Transform {
     Vector3 scale;
     Vector3 rotate;
     Vector3 translate;
 };
 
-Transform transform = {
+inline Transform transform = {
     { 1.0f, 1.0f, 1.0f }, // scale
     { 0.0f, 0.0f, 0.0f }, // rotate
     { 0.0f, 0.0f, 0.0f } // translate
 };
 
-Transform cameraTransform = {
+inline Transform cameraTransform = {
     { 1.0f, 1.0f, 1.0f }, // scale
     { 0.0f, 0.0f, 0.0f }, // rotate
     { 0.0f, 0.0f, -5.0f } // translate
 };
 
 // 単位行列
-Matrix4x4 MakeIdentity4x4()
+inline Matrix4x4 MakeIdentity4x4()
 {
     Matrix4x4 identity;
     identity.m[0][0] = 1.0f;
@@ -58,7 +66,7 @@ Matrix4x4 MakeIdentity4x4()
 }
 
 // 4x4の掛け算
-Matrix4x4 Multiply(const Matrix4x4& m1, const Matrix4x4& m2)
+inline Matrix4x4 Multiply(const Matrix4x4& m1, const Matrix4x4& m2)
 {
     Matrix4x4 result;
     result.m[0][0] = m1.m[0][0] * m2.m[0][0] + m1.m[0][1] * m2.m[1][0] + m1.m[0][2] * m2.m[2][0] + m1.m[0][3] * m2.m[3][0];
@@ -85,7 +93,7 @@ Matrix4x4 Multiply(const Matrix4x4& m1, const Matrix4x4& m2)
 }
 
 // X軸で回転
-Matrix4x4 MakeRotateXMatrix(float radian)
+inline Matrix4x4 MakeRotateXMatrix(float radian)
 {
     float cosTheta = std::cos(radian);
     float sinTheta = std::sin(radian);
@@ -96,7 +104,7 @@ Matrix4x4 MakeRotateXMatrix(float radian)
 }
 
 // Y軸で回転
-Matrix4x4 MakeRotateYMatrix(float radian)
+inline Matrix4x4 MakeRotateYMatrix(float radian)
 {
     float cosTheta = std::cos(radian);
     float sinTheta = std::sin(radian);
@@ -107,7 +115,7 @@ Matrix4x4 MakeRotateYMatrix(float radian)
 }
 
 // Z軸で回転
-Matrix4x4 MakeRotateZMatrix(float radian)
+inline Matrix4x4 MakeRotateZMatrix(float radian)
 {
     float cosTheta = std::cos(radian);
     float sinTheta = std::sin(radian);
@@ -118,7 +126,7 @@ Matrix4x4 MakeRotateZMatrix(float radian)
 }
 
 // Affine変換
-Matrix4x4 MakeAffineMatrix(const Vector3& scale, const Vector3& rotate, const Vector3& translate)
+inline Matrix4x4 MakeAffineMatrix(const Vector3& scale, const Vector3& rotate, const Vector3& translate)
 {
     Matrix4x4 result = Multiply(Multiply(MakeRotateXMatrix(rotate.x), MakeRotateYMatrix(rotate.y)), MakeRotateZMatrix(rotate.z));
     result.m[0][0] *= scale.x;
@@ -139,7 +147,7 @@ Matrix4x4 MakeAffineMatrix(const Vector3& scale, const Vector3& rotate, const Ve
     return result;
 }
 
-Matrix4x4 MakePerspectiveFovMatrix(float fovY, float aspectRatio, float nearClip, float farClip)
+inline Matrix4x4 MakePerspectiveFovMatrix(float fovY, float aspectRatio, float nearClip, float farClip)
 {
     float cotHalfFovV = 1.0f / std::tan(fovY / 2.0f);
     return {
@@ -150,7 +158,7 @@ Matrix4x4 MakePerspectiveFovMatrix(float fovY, float aspectRatio, float nearClip
     };
 }
 
-Matrix4x4 MakeOrthographicMatrix(float left, float top, float right, float bottom, float nearClip, float farClip)
+inline Matrix4x4 MakeOrthographicMatrix(float left, float top, float right, float bottom, float nearClip, float farClip)
 {
     return {
         2.0f / (right - left),
@@ -172,7 +180,7 @@ Matrix4x4 MakeOrthographicMatrix(float left, float top, float right, float botto
     };
 }
 
-Matrix4x4 MakeScaleMatrix(const Vector3& scale)
+inline Matrix4x4 MakeScaleMatrix(const Vector3& scale)
 {
     Matrix4x4 result = MakeIdentity4x4();
     result.m[0][0] = scale.x;
@@ -181,7 +189,7 @@ Matrix4x4 MakeScaleMatrix(const Vector3& scale)
     return result;
 }
 
-Matrix4x4 MakeTranslateMatrix(const Vector3& translate)
+inline Matrix4x4 MakeTranslateMatrix(const Vector3& translate)
 {
     Matrix4x4 result = MakeIdentity4x4();
     result.m[3][0] = translate.x;
@@ -190,7 +198,7 @@ Matrix4x4 MakeTranslateMatrix(const Vector3& translate)
     return result;
 }
 
-Matrix4x4 Inverse(const Matrix4x4& m)
+inline Matrix4x4 Inverse(const Matrix4x4& m)
 {
     float determinant = +m.m[0][0] * m.m[1][1] * m.m[2][2] * m.m[3][3]
         + m.m[0][0] * m.m[1][2] * m.m[2][3] * m.m[3][1]
@@ -0,0 +1,17 @@
+#include "TestFramework.h"
+#include <string>
+
+// 使い方: EnginBenchmarks [--quick] [名前に含まれる文字列]
+// --quickは回数と大きさを減らして、動くことだけを確かめる
+int main(int argc, char** argv)
+{
+    std::string filter;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--quick") {
+            test::SetQuick(true);
+        } else {
+            filter = argv[i];
+        }
+    }
+    return test::RunCases(test::GetBenchmarks(), filter) == 0 ? 0 : 1;
+}
@@ -0,0 +1,143 @@
+#include "DescriptorIndexAllocator.h"
+#include "FramePacer.h"
+#include "FreeListAllocator.h"
+#include "TestFramework.h"
+#include <iterator>
+#include <map>
+#include <random>
+#include <vector>
+
+TEST(FreeListAllocator_ReusesAndMergesRanges)
+{
+    FreeListAllocator allocator(16);
+    CHECK(allocator.Allocate(4) == 0);
+    CHECK(allocator.Allocate(4) == 4);
+    CHECK(allocator.Allocate(4) == 8);
+    CHECK(allocator.Allocate(8) == kFreeListAllocationFailed);
+    CHECK(allocator.GetStats().failedAllocations == 1);
+
+    // 真ん中を返すと、そこが先頭から見て最初の空きになる
+    allocator.Free(4, 4);
+    CHECK(allocator.GetStats().freeRangeCount == 2);
+    CHECK(allocator.Allocate(2) == 4);
+    allocator.Free(4, 2);
+
+    // 前後とまとまって1つに戻る
+    allocator.Free(0, 4);
+    allocator.Free(8, 4);
+    const FreeListAllocatorStats stats = allocator.GetStats();
+    CHECK(stats.freeRangeCount == 1);
+    CHECK(stats.largestFreeRange == 16);
+    CHECK(stats.usedCount == 0 && stats.allocationCount == 0);
+    CHECK(stats.peakUsedCount == 12);
+    CHECK(allocator.Allocate(16) == 0);
+}
+
+TEST(FreeListAllocator_Fuzz)
+{
+    constexpr uint32_t kCapacity = 4096;
+    std::mt19937 random(3);
+    FreeListAllocator allocator(kCapacity);
+    // 先頭 -> 数
+    std::map<uint32_t, uint32_t> live;
+    uint32_t used = 0;
+    for (uint32_t step = 0; step < 50000; ++step) {
+        if (live.empty() || random() % 2 == 0) {
+            const uint32_t count = 1 + random() % 64;
+            const uint32_t first = allocator.Allocate(count);
+            if (first == kFreeListAllocationFailed) {
+                continue;
+            }
+            CHECK(first + count <= kCapacity);
+            auto next = live.lower_bound(first);
+            CHECK(next == live.end() || first + count <= next->first);
+            if (next != live.begin()) {
+                auto prev = std::prev(next);
+                CHECK(prev->first + prev->second <= first);
+            }
+            live[first] = count;
+            used += count;
+        } else {
+            auto it = live.begin();
+            std::advance(it, random() % live.size());
+            allocator.Free(it->first, it->second);
+            used -= it->second;
+            live.erase(it);
+        }
+        CHECK(allocator.GetStats().usedCount == used);
+    }
+    for (const auto& [first, count] : live) {
+        allocator.Free(first, count);
+    }
+    CHECK(allocator.GetStats().freeRangeCount == 1);
+    CHECK(allocator.GetStats().largestFreeRange == kCapacity);
+}
+
+TEST(DescriptorIndexAllocator_StagesTablesAfterPersistentRange)
+{
+    DescriptorIndexAllocator descriptors(8, 32, 64);
+    CHECK(descriptors.AllocatePersistent(2) == 0);
+    CHECK(descriptors.AllocateStaging(4) == 0);
+
+    const uint64_t sources[3] = { 100, 200, 300 };
+    const uint32_t table = descriptors.StageFrameTable(sources, 3);
+    CHECK(table == 8);
+    // 同じフレームで同じものは写し直さない
+    const uint32_t single = descriptors.StageFrameDescriptor(200);
+    CHECK(single == 11);
+    CHECK(descriptors.StageFrameDescriptor(200) == single);
+
+    const DescriptorCopyList& copies = descriptors.GetPendingCopies();
+    CHECK(copies.destinations.size() == 2);
+    CHECK(copies.destinations[0] == 8 && copies.destinationSizes[0] == 3);
+    CHECK(copies.destinations[1] == 11 && copies.destinationSizes[1] == 1);
+    CHECK(copies.sources.size() == 4 && copies.sources[3] == 200);
+    descriptors.ClearPendingCopies();
+    CHECK(descriptors.GetPendingCopies().empty());
+
+    descriptors.FinishFrame(1);
+    DescriptorAllocatorStats stats = descriptors.GetStats();
+    CHECK(stats.copiedDescriptors == 4);
+    CHECK(stats.reusedDescriptors == 1);
+    CHECK(stats.copyCalls == 1);
+    CHECK(stats.persistent.usedCount == 2);
+    CHECK(stats.staging.usedCount == 4);
+    CHECK(stats.frame.usedBytes == 4);
+
+    // 次のフレームでは同じsourceでも新しく写す
+    CHECK(descriptors.StageFrameDescriptor(200) == 12);
+    descriptors.ClearPendingCopies();
+    descriptors.FinishFrame(2);
+    descriptors.Reclaim(2);
+    CHECK(descriptors.GetStats().frame.usedBytes == 0);
+}
+
+// リングが足りなくなったら古いフレームをGPUが終えるまで待つ
+TEST(DescriptorIndexAllocator_WaitsForOldFramesWhenRingIsFull)
+{
+    constexpr uint32_t kPersistent = 4;
+    constexpr uint32_t kRing = 256;
+    SimulatedGpuTimeline timeline(10.0);
+    FramePacer pacer(timeline, 3);
+    DescriptorIndexAllocator descriptors(kPersistent, kRing, 16);
+    descriptors.SetTimeline(&timeline);
+
+    std::vector<uint64_t> sources(100);
+    for (uint32_t frame = 0; frame < 30; ++frame) {
+        pacer.BeginFrame();
+        descriptors.Reclaim(timeline.GetCompletedValue());
+        // 1フレーム100個、リングには2フレーム分しか入らないので、待たないと使い回せない
+        for (uint32_t i = 0; i < sources.size(); ++i) {
+            sources[i] = frame * 1000 + i;
+        }
+        const uint32_t table = descriptors.StageFrameTable(sources.data(), 100);
+        CHECK(table >= kPersistent && table + 100 <= kPersistent + kRing);
+        descriptors.ClearPendingCopies();
+        timeline.AdvanceCpu(1.0);
+        descriptors.FinishFrame(pacer.EndFrame());
+    }
+    const DescriptorAllocatorStats stats = descriptors.GetStats();
+    CHECK(stats.overflowWaits > 0);
+    CHECK(stats.frame.usedBytes <= kRing);
+    CHECK(stats.frame.overflows >= stats.overflowWaits);
+}
@@ -0,0 +1,102 @@
+#include "FramePacer.h"
+#include "TestFramework.h"
+#include <vector>
+
+TEST(SimulatedGpuTimeline_WaitOnCompletedValueReturnsImmediately)
+{
+    SimulatedGpuTimeline timeline(10.0);
+    timeline.Signal();
+    timeline.Signal();
+    timeline.AdvanceCpu(10.0);
+    CHECK(timeline.GetCompletedValue() == 1);
+
+    // 1はもう終わっているので、2の終わり(20ms)まで待ってはいけない
+    timeline.Wait(1);
+    CHECK_NEAR(timeline.GetNow(), 10.0, 1e-9);
+    CHECK_NEAR(timeline.GetCpuStallMilliseconds(), 0.0, 1e-9);
+
+    timeline.Wait(2);
+    CHECK_NEAR(timeline.GetNow(), 20.0, 1e-9);
+    CHECK_NEAR(timeline.GetCpuStallMilliseconds(), 10.0, 1e-9);
+    CHECK(timeline.GetCompletedValue() == 2);
+}
+
+TEST(SimulatedGpuTimeline_CountsGpuIdleTime)
+{
+    SimulatedGpuTimeline timeline(4.0);
+    timeline.Signal();
+    timeline.AdvanceCpu(10.0);
+    // GPUは4msで終わり、次を受け取るまで6ms遊んでいた
+    timeline.Signal();
+    CHECK_NEAR(timeline.GetGpuIdleMilliseconds(), 6.0, 1e-9);
+    timeline.Wait(2);
+    CHECK_NEAR(timeline.GetNow(), 14.0, 1e-9);
+}
+
+TEST(FramePacer_GpuBoundKeepsFrameCountInFlight)
+{
+    constexpr uint32_t kFrameCount = 3;
+    SimulatedGpuTimeline timeline(16.0);
+    FramePacer pacer(timeline, kFrameCount);
+    for (uint32_t frame = 0; frame < 120; ++frame) {
+        CHECK(pacer.BeginFrame() == frame % kFrameCount);
+        CHECK(pacer.GetStats().framesInFlight <= kFrameCount);
+        timeline.AdvanceCpu(4.0);
+        pacer.EndFrame();
+    }
+    // CPUが先行しすぎたフレームだけ待つ。最初のkFrameCountフレームは待たない
+    CHECK(pacer.GetStats().waits == 120 - kFrameCount);
+    // GPUは休まず動き続ける
+    CHECK_NEAR(timeline.GetGpuIdleMilliseconds(), 0.0, 1e-9);
+    // 120フレームがGPUの速さで流れる(最後のフレームは積んだだけで終わりを待っていない)
+    CHECK(timeline.GetNow() <= 120 * 16.0);
+    CHECK(timeline.GetNow() >= (120 - kFrameCount) * 16.0);
+}
+
+TEST(FramePacer_CpuBoundNeverWaits)
+{
+    SimulatedGpuTimeline timeline(5.0);
+    FramePacer pacer(timeline, 2);
+    for (uint32_t frame = 0; frame < 60; ++frame) {
+        pacer.BeginFrame();
+        timeline.AdvanceCpu(12.0);
+        pacer.EndFrame();
+    }
+    CHECK(pacer.GetStats().waits == 0);
+    CHECK_NEAR(timeline.GetCpuStallMilliseconds(), 0.0, 1e-9);
+    // 1フレームにつき7ms遊ぶ(最初のフレームの前は数えない)
+    CHECK_NEAR(timeline.GetGpuIdleMilliseconds(), 59 * 7.0, 1e-6);
+}
+
+TEST(FramePacer_DeferredReleaseRunsAfterItsFrame)
+{
+    SimulatedGpuTimeline timeline(10.0);
+    FramePacer pacer(timeline, 2);
+    std::vector<uint32_t> released;
+
+    pacer.BeginFrame();
+    pacer.DeferRelease([&] { released.push_back(0); });
+    pacer.EndFrame();
+
+    pacer.BeginFrame();
+    pacer.DeferRelease([&] { released.push_back(1); });
+    pacer.EndFrame();
+    CHECK(released.empty());
+    CHECK(pacer.GetStats().pendingReleases == 2);
+
+    // フレーム0が終わるまで待つので、0だけが解放される
+    pacer.BeginFrame();
+    CHECK(released.size() == 1 && released[0] == 0);
+    pacer.EndFrame();
+
+    // フレームの外で渡したものは積み終えたフレームを待つ
+    pacer.DeferRelease([&] { released.push_back(2); });
+    pacer.WaitIdle();
+    CHECK(released.size() == 3 && released[1] == 1 && released[2] == 2);
+    CHECK(pacer.GetStats().pendingReleases == 0);
+    CHECK(pacer.GetStats().idleWaits == 1);
+
+    // 何も積んでいなければWaitIdleは待たない
+    pacer.WaitIdle();
+    CHECK(pacer.GetStats().idleWaits == 1);
+}
@@ -0,0 +1,99 @@
+#include "GpakArchive.h"
+#include "TestFramework.h"
+#include "ThreadPool.h"
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// ページキャッシュから落として、次の読み込みをディスクからにする(Linux以外では何もしない)
+bool DropFromPageCache(const std::string& path)
+{
+#ifdef __linux__
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0) {
+        return false;
+    }
+    fdatasync(file);
+    const bool dropped = posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    close(file);
+    return dropped;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+} // namespace
+
+// 小さなファイルを大量に読むときの、ばらばらのファイルとアーカイブの比較
+// 起動時を想定して、ページキャッシュから落とした状態(cold)と載った状態(warm)を測る
+BENCHMARK(GpakArchive_ColdStartVsLooseFiles)
+{
+    test::TemporaryDirectory directory;
+    std::mt19937 random(5);
+    const uint32_t kFiles = test::Scale(2000, 100);
+    static const char* kWords[] = { "v ", "vt ", "vn ", "f ", "0.25 ", "1/2/3 ", "\n" };
+    std::vector<std::string> loosePaths;
+    std::vector<std::string> archivePaths;
+    GpakWriter writer;
+    uint64_t sourceBytes = 0;
+    for (uint32_t i = 0; i < kFiles; ++i) {
+        std::string text;
+        const size_t size = 4096 + random() % 60000;
+        while (text.size() < size) {
+            text += kWords[random() % 7];
+        }
+        sourceBytes += text.size();
+        loosePaths.push_back(directory.Write("asset" + std::to_string(i) + ".obj", text));
+        archivePaths.push_back("Resources/Asset" + std::to_string(i) + ".obj");
+        writer.AddFile(loosePaths.back(), archivePaths.back(), true);
+    }
+    const std::string archiveFile = (directory.GetPath() / "assets.gpak").string();
+    ThreadPool threadPool(2);
+    GpakPackStats packStats;
+    CHECK(writer.Write(archiveFile, threadPool, packStats));
+    std::printf("  %u files, %.1f MB loose, %.1f MB packed\n", kFiles, sourceBytes / 1048576.0, packStats.archiveBytes / 1048576.0);
+
+    for (bool cold : { true, false }) {
+        bool dropped = true;
+        if (cold) {
+            for (const std::string& path : loosePaths) {
+                dropped &= DropFromPageCache(path);
+            }
+        }
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        uint64_t looseBytes = 0;
+        for (const std::string& path : loosePaths) {
+            AssetBytes bytes;
+            CHECK(ReadAssetBytes(nullptr, path, bytes));
+            looseBytes += bytes.size;
+        }
+        const double looseMilliseconds = test::ElapsedMilliseconds(start);
+
+        if (cold) {
+            dropped &= DropFromPageCache(archiveFile);
+        }
+        start = std::chrono::steady_clock::now();
+        GpakArchive archive;
+        CHECK(archive.Open(archiveFile));
+        uint64_t packedBytes = 0;
+        for (const std::string& path : archivePaths) {
+            AssetBytes bytes;
+            CHECK(archive.Read(path, bytes));
+            packedBytes += bytes.size;
+        }
+        const double archiveMilliseconds = test::ElapsedMilliseconds(start);
+        CHECK(looseBytes == sourceBytes && packedBytes == sourceBytes);
+
+        std::printf("  %s%s: loose %.1f ms, archive %.1f ms (%.2fx)\n", cold ? "cold" : "warm", cold && !dropped ? " (page cache not dropped)" : "",
+            looseMilliseconds, archiveMilliseconds, looseMilliseconds / archiveMilliseconds);
+    }
+}
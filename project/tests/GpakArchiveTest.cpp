@@ -0,0 +1,186 @@
+#include "GpakArchive.h"
+#include "GpakCodec.h"
+#include "TestFramework.h"
+#include "ThreadPool.h"
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// 単語を並べた、よく縮むテキスト
+std::string MakeText(size_t size, std::mt19937& random)
+{
+    static const char* kWords[] = { "vertex ", "normal ", "texture ", "mip ", "0.125 ", "1.0 ", "\n" };
+    std::string text;
+    while (text.size() < size) {
+        text += kWords[random() % 7];
+    }
+    text.resize(size);
+    return text;
+}
+
+std::string MakeNoise(size_t size, std::mt19937& random)
+{
+    std::string bytes(size, '\0');
+    for (char& c : bytes) {
+        c = static_cast<char>(random());
+    }
+    return bytes;
+}
+
+bool RoundTrips(const std::string& source)
+{
+    std::vector<uint8_t> compressed;
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(source.data());
+    if (!GpakCompressBlock(bytes, source.size(), compressed)) {
+        return true;
+    }
+    std::vector<uint8_t> restored(source.size());
+    return compressed.size() < source.size() && GpakDecompressBlock(compressed.data(), compressed.size(), restored.data(), restored.size())
+        && std::memcmp(restored.data(), source.data(), source.size()) == 0;
+}
+
+} // namespace
+
+TEST(GpakCodec_RoundTrip)
+{
+    std::mt19937 random(1);
+    for (size_t size : { 0, 1, 4, 15, 16, 100, 4096, 65536, 70000, 300000 }) {
+        CHECK(RoundTrips(MakeText(size, random)));
+        CHECK(RoundTrips(MakeNoise(size, random)));
+        CHECK(RoundTrips(std::string(size, 'a')));
+    }
+
+    // テキストは縮み、乱数は縮まない
+    std::vector<uint8_t> compressed;
+    const std::string text = MakeText(65536, random);
+    CHECK(GpakCompressBlock(reinterpret_cast<const uint8_t*>(text.data()), text.size(), compressed));
+    CHECK(compressed.size() < text.size() / 2);
+    const std::string noise = MakeNoise(65536, random);
+    CHECK(!GpakCompressBlock(reinterpret_cast<const uint8_t*>(noise.data()), noise.size(), compressed));
+}
+
+TEST(GpakCodec_RejectsCorruptBlocks)
+{
+    std::mt19937 random(2);
+    const std::string text = MakeText(20000, random);
+    std::vector<uint8_t> compressed;
+    CHECK(GpakCompressBlock(reinterpret_cast<const uint8_t*>(text.data()), text.size(), compressed));
+    std::vector<uint8_t> restored(text.size());
+
+    // 短すぎる・長すぎる展開先や、途中で切れたデータは失敗する
+    CHECK(!GpakDecompressBlock(compressed.data(), compressed.size(), restored.data(), restored.size() - 1));
+    restored.resize(text.size() + 1);
+    CHECK(!GpakDecompressBlock(compressed.data(), compressed.size(), restored.data(), restored.size()));
+    restored.resize(text.size());
+    CHECK(!GpakDecompressBlock(compressed.data(), compressed.size() / 2, restored.data(), restored.size()));
+
+    // 壊したデータでも展開先の外には書かない(アドレスサニタイザーで確かめる)
+    for (int i = 0; i < 2000; ++i) {
+        std::vector<uint8_t> broken = compressed;
+        for (int k = 0; k < 4; ++k) {
+            broken[random() % broken.size()] = static_cast<uint8_t>(random());
+        }
+        GpakDecompressBlock(broken.data(), broken.size(), restored.data(), restored.size());
+    }
+    for (int i = 0; i < 2000; ++i) {
+        const std::string noise = MakeNoise(random() % 256, random);
+        GpakDecompressBlock(reinterpret_cast<const uint8_t*>(noise.data()), noise.size(), restored.data(), random() % restored.size());
+    }
+}
+
+TEST(GpakArchive_WriteAndRead)
+{
+    test::TemporaryDirectory directory;
+    std::mt19937 random(3);
+    std::vector<std::string> contents;
+    GpakWriter writer;
+    for (int i = 0; i < 40; ++i) {
+        contents.push_back(i % 2 == 0 ? MakeText(1000 + i * 3000, random) : MakeNoise(1000 + i * 3000, random));
+        const std::string source = directory.Write("file" + std::to_string(i) + ".bin", contents.back());
+        writer.AddFile(source, "Resources/Data/File" + std::to_string(i) + ".bin", i % 4 != 3);
+    }
+    const std::string archivePath = (directory.GetPath() / "data.gpak").string();
+    ThreadPool threadPool(2);
+    GpakPackStats stats;
+    CHECK(writer.Write(archivePath, threadPool, stats));
+    CHECK(stats.files == 40);
+    CHECK(stats.compressedFiles > 0);
+    CHECK(stats.archiveBytes < stats.sourceBytes);
+
+    GpakArchive archive;
+    CHECK(archive.Open(archivePath));
+    CHECK(archive.GetEntryCount() == 40);
+    CHECK(archive.GetEntries().size() == 40);
+    for (int i = 0; i < 40; ++i) {
+        // 区切り文字や大文字小文字が違っても見つかる
+        AssetBytes bytes;
+        CHECK(archive.Read("resources\\data\\./file" + std::to_string(i) + ".BIN", bytes));
+        CHECK(bytes.size == contents[i].size() && std::memcmp(bytes.data, contents[i].data(), bytes.size) == 0);
+    }
+    AssetBytes missing;
+    CHECK(!archive.Read("resources/data/file40.bin", missing));
+    CHECK(!archive.Contains("resources/data"));
+
+    // アーカイブに無いものはディスクから読む
+    AssetBytes loose;
+    CHECK(ReadAssetBytes(&archive, (directory.GetPath() / "file1.bin").string(), loose));
+    CHECK(loose.size == contents[1].size());
+    archive.Close();
+    CHECK(!archive.IsOpen());
+}
+
+TEST(GpakArchive_RejectsBrokenFiles)
+{
+    test::TemporaryDirectory directory;
+    GpakArchive archive;
+    CHECK(!archive.Open((directory.GetPath() / "missing.gpak").string()));
+    CHECK(!archive.Open(directory.Write("empty.gpak", "")));
+    CHECK(!archive.Open(directory.Write("text.gpak", "this is not an archive at all, just some text")));
+}
+
+TEST(GpakArchive_WriterFailsOnMissingSource)
+{
+    test::TemporaryDirectory directory;
+    GpakWriter writer;
+    writer.AddFile(directory.Write("present.bin", "present"), "present.bin", true);
+    writer.AddFile((directory.GetPath() / "missing.bin").string(), "missing.bin", true);
+    const std::string archivePath = (directory.GetPath() / "data.gpak").string();
+    ThreadPool threadPool(2);
+    GpakPackStats stats;
+    CHECK(!writer.Write(archivePath, threadPool, stats));
+    CHECK(!std::filesystem::exists(archivePath));
+
+    // 書き出し先を開けなくても失敗を返す
+    GpakWriter unwritable;
+    unwritable.AddFile(directory.Write("other.bin", "other"), "other.bin", false);
+    CHECK(!unwritable.Write((directory.GetPath() / "no_such_dir" / "data.gpak").string(), threadPool, stats));
+}
+
+TEST(GpakArchive_RejectsUncompressedSizeMismatch)
+{
+    test::TemporaryDirectory directory;
+    GpakWriter writer;
+    writer.AddFile(directory.Write("raw.bin", std::string(100, 'x')), "raw.bin", false);
+    const std::string archivePath = (directory.GetPath() / "data.gpak").string();
+    ThreadPool threadPool(1);
+    GpakPackStats stats;
+    CHECK(writer.Write(archivePath, threadPool, stats));
+
+    GpakArchive archive;
+    CHECK(archive.Open(archivePath));
+    CHECK(archive.GetEntries().size() == 1);
+    GpakEntry entry = *archive.GetEntries()[0];
+    AssetBytes bytes;
+    CHECK(archive.Read(entry, bytes) && bytes.size == 100);
+
+    // 壊れたディレクトリがstoredSizeより大きいsizeを持っていても、マップの外を返さない
+    entry.size = entry.storedSize + 1000000;
+    CHECK(!archive.Read(entry, bytes));
+    entry.size = entry.storedSize;
+    entry.offset = ~uint64_t(0) - entry.storedSize + 1;
+    CHECK(!archive.Read(entry, bytes));
+}
@@ -0,0 +1,33 @@
+#include "Hash.h"
+#include "TestFramework.h"
+#include <cstring>
+
+TEST(Hash_MatchesFnv1a)
+{
+    // ファイルに残した値と合うよう、FNV-1aの既知の値と一致することを確かめる
+    CHECK(HashBytes("", 0) == 0xcbf29ce484222325ull);
+    CHECK(HashBytes("a", 1) == 0xaf63dc4c8601ec8cull);
+    CHECK(HashBytes("foobar", 6) == 0x85944171f73967e8ull);
+}
+
+TEST(Hash_HasherMatchesHashBytes)
+{
+    const char* text = "resources/textures/a.png";
+    Hasher hasher;
+    hasher.Add(text, 10);
+    hasher.Add(text + 10, std::strlen(text) - 10);
+    CHECK(hasher.Get() == HashBytes(text, std::strlen(text)));
+
+    // AddStringは終端の0も足す
+    Hasher withString;
+    withString.AddString(text);
+    CHECK(withString.Get() == HashBytes(text, std::strlen(text) + 1));
+    Hasher withNull;
+    withNull.AddString(nullptr);
+    CHECK(withNull.Get() == HashBytes(nullptr, 0));
+
+    const uint32_t value = 0x12345678;
+    Hasher withValue;
+    withValue.Add(value);
+    CHECK(withValue.Get() == HashBytes(&value, sizeof(value)));
+}
@@ -0,0 +1,77 @@
+#include "MeshStreamer.h"
+#include "TestFramework.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace {
+
+// size x sizeの格子(2*size*size枚の三角形)のOBJ
+std::string MakeGridObj(uint32_t size)
+{
+    std::string obj;
+    char line[96];
+    for (uint32_t y = 0; y <= size; ++y) {
+        for (uint32_t x = 0; x <= size; ++x) {
+            std::snprintf(line, sizeof(line), "v %f %f %f\nvt %f %f\n", x * 0.1f, y * 0.1f, (x * 7 + y * 3) % 5 * 0.01f, float(x) / size, float(y) / size);
+            obj += line;
+        }
+    }
+    obj += "vn 0 0 1\n";
+    const uint32_t row = size + 1;
+    for (uint32_t y = 0; y < size; ++y) {
+        for (uint32_t x = 0; x < size; ++x) {
+            const uint32_t i = y * row + x + 1;
+            std::snprintf(line, sizeof(line), "f %u/%u/1 %u/%u/1 %u/%u/1 %u/%u/1\n", i, i, i + 1, i + 1, i + row + 1, i + row + 1, i + row, i + row);
+            obj += line;
+        }
+    }
+    return obj;
+}
+
+} // namespace
+
+// ローカルのファイルを読み込み元の代わりにして、まとめて依頼したときの処理量と遅延を測る
+BENCHMARK(MeshStreamer_Throughput)
+{
+    test::TemporaryDirectory directory;
+    const uint32_t kGrid = test::Scale(100, 10);
+    const uint32_t kFiles = test::Scale(64, 4);
+    std::vector<std::string> paths;
+    uint64_t fileBytes = 0;
+    const std::string obj = MakeGridObj(kGrid);
+    for (uint32_t i = 0; i < kFiles; ++i) {
+        paths.push_back(directory.Write("mesh" + std::to_string(i) + ".obj", obj));
+        fileBytes += obj.size();
+    }
+
+    const uint32_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (uint32_t threads = 1; threads <= maxThreads; threads *= 2) {
+        ThreadPool threadPool(threads);
+        MeshStreamer streamer(threadPool);
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (const std::string& path : paths) {
+            streamer.Request(path, MeshType_Model);
+        }
+        uint32_t received = 0;
+        uint64_t vertices = 0;
+        while (received < kFiles) {
+            if (std::unique_ptr<StreamedMesh> result = streamer.PopCompleted()) {
+                CHECK(result->succeeded);
+                vertices += result->mesh.vertices.size();
+                ++received;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        const double milliseconds = test::ElapsedMilliseconds(start);
+        const MeshStreamerStats stats = streamer.GetStats();
+        CHECK(vertices == uint64_t(kFiles) * kGrid * kGrid * 6);
+        std::printf("  %u threads: %u meshes (%.1f MB) in %.1f ms, %.1f meshes/s, %.1f MB/s, latency avg %.1f ms max %.1f ms, decode avg %.2f ms\n",
+            threads, kFiles, fileBytes / 1.0e6, milliseconds, kFiles * 1000.0 / milliseconds, fileBytes / 1.0e3 / milliseconds,
+            stats.totalLatencyMilliseconds / kFiles, stats.maxLatencyMilliseconds, stats.totalDecodeMilliseconds / kFiles);
+    }
+}
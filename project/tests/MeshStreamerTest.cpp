@@ -0,0 +1,181 @@
+#include "GpakArchive.h"
+#include "MeshManager.h"
+#include "MeshStreamer.h"
+#include "TestFramework.h"
+#include "ThreadPool.h"
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// 1x1の四角形(2枚の三角形)
+const char* kQuadObj = "v 0 0 0\n"
+                       "v 1 0 0\n"
+                       "v 1 1 0\n"
+                       "v 0 1 0\n"
+                       "vt 0 0\n"
+                       "vt 1 0\n"
+                       "vt 1 1\n"
+                       "vt 0 1\n"
+                       "vn 0 0 1\n"
+                       "f 1/1/1 2/2/1 3/3/1 4/4/1\n";
+
+// 全部終わるまで取り出す(止まったら諦める)
+std::vector<std::unique_ptr<StreamedMesh>> WaitAll(MeshStreamer& streamer, uint32_t count)
+{
+    std::vector<std::unique_ptr<StreamedMesh>> results;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    while (results.size() < count && test::ElapsedMilliseconds(start) < 10000.0) {
+        if (std::unique_ptr<StreamedMesh> result = streamer.PopCompleted()) {
+            results.push_back(std::move(result));
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    return results;
+}
+
+} // namespace
+
+TEST(MeshStreamer_LoadsObjFromDisk)
+{
+    test::TemporaryDirectory directory;
+    const std::string path = directory.Write("quad.obj", kQuadObj);
+    ThreadPool threadPool(2);
+    MeshStreamer streamer(threadPool);
+    const uint32_t requestId = streamer.Request(path, MeshType_Model);
+
+    std::vector<std::unique_ptr<StreamedMesh>> results = WaitAll(streamer, 1);
+    CHECK(results.size() == 1);
+    if (results.size() != 1) {
+        return;
+    }
+    const StreamedMesh& result = *results[0];
+    CHECK(result.succeeded);
+    CHECK(result.requestId == requestId);
+    CHECK(result.target == MeshType_Model);
+    // 四角形は2枚の三角形になり、xは左手系へ反転される
+    CHECK(result.mesh.vertices.size() == 6);
+    for (const VertexData& vertex : result.mesh.vertices) {
+        CHECK(vertex.position.x <= 0.0f);
+        CHECK(vertex.normal.z == 1.0f);
+    }
+    // 巻き順を反転している(1, 3, 2)
+    CHECK(result.mesh.vertices[1].position.x == -1.0f && result.mesh.vertices[1].position.y == 1.0f);
+    CHECK(result.mesh.vertices[2].position.x == -1.0f && result.mesh.vertices[2].position.y == 0.0f);
+    CHECK(streamer.GetPendingCount() == 0);
+
+    MeshStreamerStats stats = streamer.GetStats();
+    CHECK(stats.requested == 1 && stats.completed == 1 && stats.failed == 0);
+    CHECK(stats.decodedBytes == std::string(kQuadObj).size());
+}
+
+TEST(MeshStreamer_MalformedFaceFailsWithoutThrowing)
+{
+    test::TemporaryDirectory directory;
+    const std::vector<std::string> paths = {
+        directory.Write("letters.obj", "v 0 0 0\nv 1 0 0\nv 1 1 0\nf a/b/c 2 3\n"),
+        directory.Write("trailing.obj", "v 0 0 0\nv 1 0 0\nv 1 1 0\nf 1x 2 3\n"),
+        directory.Write("overflow.obj", "v 0 0 0\nv 1 0 0\nv 1 1 0\nf 99999999999999999999 2 3\n"),
+        directory.Write("out_of_range.obj", "v 0 0 0\nv 1 0 0\nv 1 1 0\nf 1 2 7\n"),
+        directory.Write("no_position.obj", "v 0 0 0\nv 1 0 0\nv 1 1 0\nf /1 2 3\n"),
+        (directory.GetPath() / "missing.obj").string(),
+    };
+    ThreadPool threadPool(2);
+    MeshStreamer streamer(threadPool);
+    for (const std::string& path : paths) {
+        streamer.Request(path, MeshType_Model);
+    }
+    std::vector<std::unique_ptr<StreamedMesh>> results = WaitAll(streamer, uint32_t(paths.size()));
+    CHECK(results.size() == paths.size());
+    for (const std::unique_ptr<StreamedMesh>& result : results) {
+        CHECK(!result->succeeded);
+    }
+    CHECK(streamer.GetStats().failed == paths.size());
+}
+
+TEST(MeshStreamer_ReadsFromArchive)
+{
+    test::TemporaryDirectory directory;
+    const std::string source = directory.Write("source.obj", kQuadObj);
+    const std::string archivePath = (directory.GetPath() / "meshes.gpak").string();
+    ThreadPool threadPool(2);
+    GpakWriter writer;
+    writer.AddFile(source, "Resources/Quad.obj", true);
+    GpakPackStats stats;
+    CHECK(writer.Write(archivePath, threadPool, stats));
+    GpakArchive archive;
+    CHECK(archive.Open(archivePath));
+
+    // ディスクには無いパスでもアーカイブから読める
+    MeshStreamer streamer(threadPool);
+    streamer.SetArchive(&archive);
+    streamer.Request("resources\\quad.obj", MeshType_Model);
+    streamer.Request("resources\\quad.obj", MeshType_Model, true);
+    std::vector<std::unique_ptr<StreamedMesh>> results = WaitAll(streamer, 2);
+    CHECK(results.size() == 2);
+    for (const std::unique_ptr<StreamedMesh>& result : results) {
+        CHECK(result->succeeded == !result->fromDisk);
+    }
+}
+
+TEST(MeshStreamer_ManyRequestsAllComplete)
+{
+    // 完了キュー(64個)より多く積み、メインスレッドが取り出すまでワーカーが待つ場合も通す
+    test::TemporaryDirectory directory;
+    const std::string path = directory.Write("quad.obj", kQuadObj);
+    ThreadPool threadPool(4);
+    MeshStreamer streamer(threadPool);
+    const uint32_t kRequests = 300;
+    for (uint32_t i = 0; i < kRequests; ++i) {
+        streamer.Request(path, MeshType_Model);
+    }
+    std::vector<std::unique_ptr<StreamedMesh>> results = WaitAll(streamer, kRequests);
+    CHECK(results.size() == kRequests);
+    std::vector<bool> seen(kRequests + 1, false);
+    for (const std::unique_ptr<StreamedMesh>& result : results) {
+        CHECK(result->succeeded);
+        CHECK(result->requestId >= 1 && result->requestId <= kRequests && !seen[result->requestId]);
+        if (result->requestId <= kRequests) {
+            seen[result->requestId] = true;
+        }
+    }
+    MeshStreamerStats stats = streamer.GetStats();
+    CHECK(stats.completed == kRequests);
+    CHECK(stats.maxLatencyMilliseconds >= stats.totalLatencyMilliseconds / kRequests);
+}
+
+TEST(MeshStreamer_MeshManagerSwapsAtUpdate)
+{
+    test::TemporaryDirectory directory;
+    const std::string path = directory.Write("quad.obj", kQuadObj);
+    ThreadPool threadPool(2);
+    MeshStreamer streamer(threadPool);
+    MeshManager meshManager;
+    meshManager.AttachStreamer(&streamer);
+    const MeshData before = meshManager.meshes[MeshType_Model];
+    meshManager.meshes[MeshType_Model].transform.translate = { 1.0f, 2.0f, 3.0f };
+
+    meshManager.RequestMesh(path, MeshType_Model);
+    // 読み込みが終わるまでは今のメッシュのまま
+    uint32_t swapped = 0;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    while (swapped == 0 && test::ElapsedMilliseconds(start) < 10000.0) {
+        CHECK(meshManager.meshes[MeshType_Model].vertices.size() == before.vertices.size());
+        swapped = meshManager.Update();
+    }
+    CHECK(swapped == 1);
+    const MeshData& after = meshManager.meshes[MeshType_Model];
+    CHECK(after.vertices.size() == 6);
+    CHECK(after.version == before.version + 1);
+    CHECK(after.transform.translate.y == 2.0f);
+
+    // 失敗したものは差し替えない
+    meshManager.RequestMesh((directory.GetPath() / "missing.obj").string(), MeshType_Model);
+    while (streamer.GetPendingCount() != 0) {
+        std::this_thread::yield();
+    }
+    CHECK(meshManager.Update() == 0);
+    CHECK(meshManager.meshes[MeshType_Model].version == before.version + 1);
+}
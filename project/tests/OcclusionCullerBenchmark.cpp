@@ -0,0 +1,57 @@
+#include "OcclusionCuller.h"
+#include "OcclusionScene.h"
+#include "TestFramework.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+// デモと同じ場面に細かく分けた壁を足して、スレッド数ごとにラスタライズ、HiZ、箱の判定の時間と省けた割合を測る
+BENCHMARK(OcclusionCuller_CullRateAndTime)
+{
+    const OcclusionScene scene = BuildOcclusionScene();
+    // 手前の壁と同じ場所を細かく分けたもの(三角形の数を増やしてラスタライズの重さを見る)
+    const uint32_t cells = test::Scale(64, 8);
+    const std::vector<Vector3> grid = MakeOcclusionGrid({ -5.0f, 0.5f, 3.75f }, { 10.0f, 0.0f, 0.0f }, { 0.0f, -3.0f, 0.0f }, cells, 0.3f, 1);
+    // 箱を床に何段も積んで判定の数を増やす
+    std::vector<OcclusionBounds> boxes;
+    for (float height = 0.0f; height < float(test::Scale(8, 1)); height += 1.0f) {
+        for (OcclusionBounds bounds : scene.boxes) {
+            bounds.min.y += height;
+            bounds.max.y += height;
+            boxes.push_back(bounds);
+        }
+    }
+    std::vector<uint8_t> visible(boxes.size());
+
+    const uint32_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    ThreadPool threadPool(hardwareThreads > 1 ? hardwareThreads - 1 : 1);
+    OcclusionCuller culler(&threadPool);
+    std::vector<uint32_t> threadCounts;
+    for (uint32_t threads = 1; threads < culler.GetMaxThreadCount(); threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(culler.GetMaxThreadCount());
+    const uint32_t repeats = test::Scale(50, 2);
+    for (uint32_t threads : threadCounts) {
+        culler.SetThreadCount(threads);
+        OcclusionCullerStats best;
+        best.rasterMilliseconds = best.hizMilliseconds = best.testMilliseconds = 1.0e30;
+        for (uint32_t i = 0; i < repeats; ++i) {
+            AddOcclusionSceneOccluders(culler, scene);
+            culler.AddOccluder(grid.data(), sizeof(Vector3), uint32_t(grid.size()), MakeIdentity4x4());
+            culler.Rasterize();
+            culler.TestBounds(boxes.data(), uint32_t(boxes.size()), visible.data());
+            const OcclusionCullerStats& stats = culler.GetLastStats();
+            best.rasterMilliseconds = std::min(best.rasterMilliseconds, stats.rasterMilliseconds);
+            best.hizMilliseconds = std::min(best.hizMilliseconds, stats.hizMilliseconds);
+            best.testMilliseconds = std::min(best.testMilliseconds, stats.testMilliseconds);
+        }
+        const OcclusionCullerStats& stats = culler.GetLastStats();
+        std::printf("  %u threads: %u/%u triangles, %u boxes (%u frustum, %u occluded, %.1f%% culled)\n", stats.threadCount, stats.rasterizedTriangles,
+            stats.occluderTriangles, stats.tested, stats.frustumCulled, stats.occlusionCulled, stats.GetCullRate() * 100.0);
+        std::printf("    raster %.3f ms, HiZ %.3f ms, test %.3f ms, total %.3f ms\n", best.rasterMilliseconds, best.hizMilliseconds, best.testMilliseconds,
+            best.GetTotalMilliseconds());
+    }
+}
@@ -0,0 +1,305 @@
+#include "OcclusionCuller.h"
+#include "OcclusionScene.h"
+#include "TestFramework.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t kWidth = 320;
+constexpr uint32_t kHeight = 192;
+
+Matrix4x4 MakeTestProjection()
+{
+    return MakePerspectiveFovMatrix(0.9f, float(kWidth) / float(kHeight), 0.1f, 100.0f);
+}
+
+// ワールドの(x, y)をそのまま画面のピクセルに、zを深度にする行列
+Matrix4x4 MakePixelProjection()
+{
+    Matrix4x4 m = MakeIdentity4x4();
+    m.m[0][0] = 2.0f / float(kWidth);
+    m.m[1][1] = -2.0f / float(kHeight);
+    m.m[3][0] = -1.0f;
+    m.m[3][1] = 1.0f;
+    return m;
+}
+
+uint32_t CountUncovered(const OcclusionCuller& culler, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1)
+{
+    uint32_t uncovered = 0;
+    for (uint32_t y = y0; y <= y1; ++y) {
+        for (uint32_t x = x0; x <= x1; ++x) {
+            uncovered += culler.GetDepthBuffer()[size_t(y) * kWidth + x] == 1.0f ? 1 : 0;
+        }
+    }
+    return uncovered;
+}
+
+// 行ベクトル形式でpoint * mをしてwで割る
+Vector3 TransformCoord(const Vector3& point, const Matrix4x4& m)
+{
+    float result[4];
+    for (int c = 0; c < 4; ++c) {
+        result[c] = point.x * m.m[0][c] + point.y * m.m[1][c] + point.z * m.m[2][c] + m.m[3][c];
+    }
+    return { result[0] / result[3], result[1] / result[3], result[2] / result[3] };
+}
+
+// 光線originからdirectionと箱が交わる一番近いtを返す(交わらなければ負)
+float IntersectBounds(const Vector3& origin, const Vector3& direction, const OcclusionBounds& bounds, float margin)
+{
+    const float origins[3] = { origin.x, origin.y, origin.z };
+    const float directions[3] = { direction.x, direction.y, direction.z };
+    const float mins[3] = { bounds.min.x - margin, bounds.min.y - margin, bounds.min.z - margin };
+    const float maxs[3] = { bounds.max.x + margin, bounds.max.y + margin, bounds.max.z + margin };
+    float tNear = 0.0f;
+    float tFar = 1e30f;
+    for (int axis = 0; axis < 3; ++axis) {
+        if (std::fabs(directions[axis]) < 1e-12f) {
+            if (origins[axis] < mins[axis] || origins[axis] > maxs[axis]) {
+                return -1.0f;
+            }
+            continue;
+        }
+        float t0 = (mins[axis] - origins[axis]) / directions[axis];
+        float t1 = (maxs[axis] - origins[axis]) / directions[axis];
+        tNear = std::max(tNear, std::min(t0, t1));
+        tFar = std::min(tFar, std::max(t0, t1));
+    }
+    return tNear <= tFar ? tNear : -1.0f;
+}
+
+// 画素の中心を通る光線を箱ごとに調べるだけの参照の深度バッファ
+// 三角形を描く仕組みとは別に求めるので、ひび割れや端の抜けがあれば食い違う
+class RayCastReference {
+public:
+    RayCastReference(const Matrix4x4& viewProjection, const std::vector<OcclusionBounds>& occluders)
+        : viewProjection_(viewProjection)
+        , inverse_(Inverse(viewProjection))
+        , occluders_(occluders)
+    {
+    }
+
+    // 画素(x, y)の中心を通る光線(近クリップ面から遠クリップ面まで)
+    void GetRay(uint32_t x, uint32_t y, Vector3& origin, Vector3& direction) const
+    {
+        float ndcX = (float(x) + 0.5f) / float(kWidth) * 2.0f - 1.0f;
+        float ndcY = 1.0f - (float(y) + 0.5f) / float(kHeight) * 2.0f;
+        origin = TransformCoord({ ndcX, ndcY, 0.0f }, inverse_);
+        Vector3 end = TransformCoord({ ndcX, ndcY, 1.0f }, inverse_);
+        direction = { end.x - origin.x, end.y - origin.y, end.z - origin.z };
+    }
+
+    // 一番近いオクルーダーのt(無ければ負)。marginだけ広げたり(正)縮めたり(負)した箱で調べる
+    float Cast(const Vector3& origin, const Vector3& direction, float margin) const
+    {
+        float nearest = -1.0f;
+        for (const OcclusionBounds& occluder : occluders_) {
+            float t = IntersectBounds(origin, direction, occluder, margin);
+            if (t >= 0.0f && (nearest < 0.0f || t < nearest)) {
+                nearest = t;
+            }
+        }
+        return nearest;
+    }
+
+    float GetDepth(const Vector3& origin, const Vector3& direction, float t) const
+    {
+        return TransformCoord({ origin.x + direction.x * t, origin.y + direction.y * t, origin.z + direction.z * t }, viewProjection_).z;
+    }
+
+private:
+    Matrix4x4 viewProjection_;
+    Matrix4x4 inverse_;
+    std::vector<OcclusionBounds> occluders_;
+};
+
+} // namespace
+
+TEST(OcclusionCuller_QuadWallHasNoCrackAlongItsDiagonal)
+{
+    // 10x10の壁をどちらの対角線でも2つの三角形に分けて描き、その後ろに箱を置く
+    const Vector3 topLeft = { -5.0f, 5.0f, 10.0f };
+    const Vector3 topRight = { 5.0f, 5.0f, 10.0f };
+    const Vector3 bottomRight = { 5.0f, -5.0f, 10.0f };
+    const Vector3 bottomLeft = { -5.0f, -5.0f, 10.0f };
+    const Vector3 walls[2][6] = {
+        { topLeft, topRight, bottomRight, topLeft, bottomRight, bottomLeft },
+        { topLeft, topRight, bottomLeft, topRight, bottomRight, bottomLeft },
+    };
+    const uint32_t x0 = uint32_t((TransformCoord(topLeft, MakeTestProjection()).x * 0.5f + 0.5f) * kWidth) + 1;
+    const uint32_t x1 = uint32_t((TransformCoord(bottomRight, MakeTestProjection()).x * 0.5f + 0.5f) * kWidth) - 1;
+    for (const auto& wall : walls) {
+        OcclusionCuller culler(nullptr, kWidth, kHeight);
+        culler.BeginFrame(MakeTestProjection());
+        culler.AddOccluder(wall, sizeof(Vector3), 6, MakeIdentity4x4());
+        culler.Rasterize();
+
+        // 壁の内側(縁の1画素を除く)に描けていない画素が無い
+        CHECK(CountUncovered(culler, x0, 0, x1, kHeight - 1) == 0);
+        CHECK(!culler.TestBounds({ { -1.0f, -1.0f, 20.0f }, { 1.0f, 1.0f, 22.0f } }));
+        CHECK(culler.TestBounds({ { -1.0f, -1.0f, 5.0f }, { 1.0f, 1.0f, 6.0f } }));
+    }
+}
+
+TEST(OcclusionCuller_SharedEdgesFollowTopLeftRule)
+{
+    // 左右に並べた三角形の境目と上下に並べた三角形の境目を画素の中心にちょうど通す
+    // 境目の画素は右(左の辺を持つ)と下(上の辺を持つ)の三角形だけが描く
+    constexpr float kNear = 0.25f;
+    constexpr float kFar = 0.75f;
+    const Vector3 triangles[] = {
+        // 左で近い。右の辺がx = 100.5
+        { 10.0f, 10.5f, kNear }, { 100.5f, 10.5f, kNear }, { 100.5f, 60.5f, kNear },
+        // 右で遠い。左の辺がx = 100.5
+        { 100.5f, 10.5f, kFar }, { 190.0f, 60.5f, kFar }, { 100.5f, 60.5f, kFar },
+        // 上で近い。下の辺がy = 120.5
+        { 200.0f, 80.5f, kNear }, { 300.0f, 120.5f, kNear }, { 200.0f, 120.5f, kNear },
+        // 下で遠い。上の辺がy = 120.5
+        { 200.0f, 120.5f, kFar }, { 300.0f, 120.5f, kFar }, { 200.0f, 170.0f, kFar },
+    };
+    OcclusionCuller culler(nullptr, kWidth, kHeight);
+    culler.BeginFrame(MakePixelProjection());
+    culler.AddOccluder(triangles, sizeof(Vector3), 12, MakeIdentity4x4());
+    culler.Rasterize();
+
+    const std::vector<float>& depth = culler.GetDepthBuffer();
+    uint32_t wrongColumn = 0;
+    for (uint32_t y = 11; y < 60; ++y) {
+        wrongColumn += depth[size_t(y) * kWidth + 100] != kFar ? 1 : 0;
+        // 左の三角形の右の辺のすぐ内側は近い方
+        wrongColumn += depth[size_t(y) * kWidth + 99] != kNear && y >= 11 + (99 - 10) * 50 / 90 + 1 ? 1 : 0;
+    }
+    CHECK(wrongColumn == 0);
+    uint32_t wrongRow = 0;
+    for (uint32_t x = 201; x < 299; ++x) {
+        wrongRow += depth[size_t(120) * kWidth + x] != kFar ? 1 : 0;
+    }
+    CHECK(wrongRow == 0);
+}
+
+TEST(OcclusionCuller_TessellatedPlaneThroughNearPlaneLeavesNoHoles)
+{
+    // 画面を覆う傾いた平面をずらしたマス目で描く。カメラの後ろと画面の遥か外まで広がり、近クリップ面をまたぐ
+    ThreadPool threadPool(3);
+    OcclusionCuller culler(&threadPool, kWidth, kHeight);
+    for (uint32_t seed = 0; seed < 8; ++seed) {
+        const std::vector<Vector3> plane = MakeOcclusionGrid({ -100.0f, 100.0f, 5.0f + 0.8f * 100.0f }, { 200.0f, 0.0f, 0.0f },
+            { 0.0f, -200.0f, -0.8f * 200.0f }, 24 + seed, 0.4f, seed);
+        culler.BeginFrame(MakeTestProjection());
+        culler.AddOccluder(plane.data(), sizeof(Vector3), uint32_t(plane.size()), MakeIdentity4x4());
+        culler.Rasterize();
+        uint32_t uncovered = CountUncovered(culler, 0, 0, kWidth - 1, kHeight - 1);
+        if (uncovered != 0) {
+            std::printf("    seed %u: %u holes\n", seed, uncovered);
+        }
+        CHECK(uncovered == 0);
+    }
+}
+
+TEST(OcclusionCuller_MatchesRayCastReference)
+{
+    const OcclusionScene scene = BuildOcclusionScene(float(kWidth), float(kHeight));
+    OcclusionCuller culler(nullptr, kWidth, kHeight);
+    AddOcclusionSceneOccluders(culler, scene);
+    culler.Rasterize();
+    RayCastReference reference(scene.viewProjection, scene.wallBounds);
+
+    // 壁の縁から少し離れた画素だけ比べる(縁は画素の中心がどちらに入るかが丸めで変わりうる)
+    constexpr float kMargin = 0.02f;
+    uint32_t compared = 0;
+    uint32_t mismatches = 0;
+    for (uint32_t y = 0; y < kHeight; ++y) {
+        for (uint32_t x = 0; x < kWidth; ++x) {
+            Vector3 origin;
+            Vector3 direction;
+            reference.GetRay(x, y, origin, direction);
+            const float inner = reference.Cast(origin, direction, -kMargin);
+            const float outer = reference.Cast(origin, direction, kMargin);
+            const float depth = culler.GetDepthBuffer()[size_t(y) * kWidth + x];
+            bool ok = true;
+            if (outer < 0.0f) {
+                ok = depth == 1.0f;
+            } else if (inner >= 0.0f) {
+                // 縮めた箱と広げた箱の深度の間にある
+                ok = depth >= reference.GetDepth(origin, direction, outer) - 1e-4f && depth <= reference.GetDepth(origin, direction, inner) + 1e-4f;
+            } else {
+                continue;
+            }
+            ++compared;
+            if (!ok && mismatches++ == 0) {
+                std::printf("    pixel (%u, %u): depth %f\n", x, y, depth);
+            }
+        }
+    }
+    CHECK(compared > kWidth * kHeight * 9 / 10);
+    CHECK(mismatches == 0);
+
+    // 隠れたとした箱は、どの画素の光線でも先に壁に当たる
+    std::vector<uint8_t> visible(scene.boxes.size());
+    const uint32_t visibleCount = culler.TestBounds(scene.boxes.data(), uint32_t(scene.boxes.size()), visible.data());
+    const OcclusionCullerStats& stats = culler.GetLastStats();
+    CHECK(stats.occlusionCulled > 0 && stats.frustumCulled > 0 && visibleCount > 0);
+    uint32_t wronglyCulled = 0;
+    for (size_t i = 0; i < scene.boxes.size(); ++i) {
+        if (visible[i]) {
+            continue;
+        }
+        // 隠れたとした箱はカメラの前にあるので、隅を写した範囲の画素だけ調べればよい
+        const OcclusionBounds& box = scene.boxes[i];
+        float minX = float(kWidth);
+        float maxX = 0.0f;
+        float minY = float(kHeight);
+        float maxY = 0.0f;
+        for (int corner = 0; corner < 8; ++corner) {
+            const Vector3 ndc = TransformCoord({ (corner & 1) ? box.max.x : box.min.x, (corner & 2) ? box.max.y : box.min.y,
+                                                    (corner & 4) ? box.max.z : box.min.z },
+                scene.viewProjection);
+            minX = std::min(minX, (ndc.x * 0.5f + 0.5f) * kWidth);
+            maxX = std::max(maxX, (ndc.x * 0.5f + 0.5f) * kWidth);
+            minY = std::min(minY, (0.5f - ndc.y * 0.5f) * kHeight);
+            maxY = std::max(maxY, (0.5f - ndc.y * 0.5f) * kHeight);
+        }
+        bool seen = false;
+        for (int32_t y = std::max(0, int32_t(minY) - 1); y <= std::min(int32_t(kHeight) - 1, int32_t(maxY) + 1) && !seen; ++y) {
+            for (int32_t x = std::max(0, int32_t(minX) - 1); x <= std::min(int32_t(kWidth) - 1, int32_t(maxX) + 1) && !seen; ++x) {
+                Vector3 origin;
+                Vector3 direction;
+                reference.GetRay(uint32_t(x), uint32_t(y), origin, direction);
+                const float hit = IntersectBounds(origin, direction, box, 0.0f);
+                const float wall = reference.Cast(origin, direction, kMargin);
+                seen = hit >= 0.0f && (wall < 0.0f || wall > hit);
+            }
+        }
+        wronglyCulled += seen ? 1 : 0;
+    }
+    CHECK(wronglyCulled == 0);
+}
+
+TEST(OcclusionCuller_ThreadsMatchSingleThread)
+{
+    const OcclusionScene scene = BuildOcclusionScene(float(kWidth), float(kHeight));
+    ThreadPool threadPool(3);
+    OcclusionCuller single(nullptr, kWidth, kHeight);
+    OcclusionCuller threaded(&threadPool, kWidth, kHeight);
+    // 三角形をスレッドに分けるよう、壁を何度も足す
+    for (OcclusionCuller* culler : { &single, &threaded }) {
+        AddOcclusionSceneOccluders(*culler, scene);
+        for (uint32_t i = 0; i < 100; ++i) {
+            culler->AddOccluder(scene.cube.data(), sizeof(Vector3), uint32_t(scene.cube.size()), scene.walls[i % scene.walls.size()]);
+        }
+        culler->Rasterize();
+    }
+    CHECK(threaded.GetLastStats().threadCount > 1);
+    CHECK(single.GetDepthBuffer() == threaded.GetDepthBuffer());
+
+    std::vector<uint8_t> expected(scene.boxes.size());
+    std::vector<uint8_t> actual(scene.boxes.size());
+    single.TestBounds(scene.boxes.data(), uint32_t(scene.boxes.size()), expected.data());
+    threaded.TestBounds(scene.boxes.data(), uint32_t(scene.boxes.size()), actual.data());
+    CHECK(expected == actual);
+}
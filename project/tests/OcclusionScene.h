@@ -0,0 +1,118 @@
+#pragma once
+#include "MakeAffine.h"
+#include "OcclusionCuller.h"
+#include <random>
+#include <utility>
+#include <vector>
+
+// テストとベンチマークで使うオクルーダーと場面
+// 三角形はどれも外(カメラの側)から見て時計回り
+
+// -0.5から0.5の立方体の三角形リスト
+inline std::vector<Vector3> MakeOcclusionCube()
+{
+    constexpr float s = 0.5f;
+    // 面ごとに外から見て時計回りの4隅
+    const Vector3 faces[6][4] = {
+        { { s, s, -s }, { s, s, s }, { s, -s, s }, { s, -s, -s } },
+        { { -s, s, s }, { -s, s, -s }, { -s, -s, -s }, { -s, -s, s } },
+        { { -s, s, s }, { s, s, s }, { s, s, -s }, { -s, s, -s } },
+        { { -s, -s, -s }, { s, -s, -s }, { s, -s, s }, { -s, -s, s } },
+        { { s, s, s }, { -s, s, s }, { -s, -s, s }, { s, -s, s } },
+        { { -s, s, -s }, { s, s, -s }, { s, -s, -s }, { -s, -s, -s } },
+    };
+    std::vector<Vector3> triangles;
+    for (const auto& face : faces) {
+        triangles.insert(triangles.end(), { face[0], face[1], face[2], face[0], face[2], face[3] });
+    }
+    return triangles;
+}
+
+// originからu、vの向きに広がる平面をcells x cellsのマス目に分けた三角形リスト(originから見てu、u+v、vが時計回り)
+// 内側の頂点は平面の中でjitter(マスの大きさに対する割合)までずらし、マスの対角線の向きも乱数で選ぶ
+inline std::vector<Vector3> MakeOcclusionGrid(const Vector3& origin, const Vector3& u, const Vector3& v, uint32_t cells, float jitter, uint32_t seed)
+{
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> offset(-jitter, jitter);
+    std::vector<Vector3> points;
+    for (uint32_t j = 0; j <= cells; ++j) {
+        for (uint32_t i = 0; i <= cells; ++i) {
+            float s = float(i);
+            float t = float(j);
+            if (i > 0 && i < cells && j > 0 && j < cells) {
+                s += offset(random);
+                t += offset(random);
+            }
+            s /= float(cells);
+            t /= float(cells);
+            points.push_back({ origin.x + u.x * s + v.x * t, origin.y + u.y * s + v.y * t, origin.z + u.z * s + v.z * t });
+        }
+    }
+    std::vector<Vector3> triangles;
+    for (uint32_t j = 0; j < cells; ++j) {
+        for (uint32_t i = 0; i < cells; ++i) {
+            const Vector3& p00 = points[j * (cells + 1) + i];
+            const Vector3& p10 = points[j * (cells + 1) + i + 1];
+            const Vector3& p01 = points[(j + 1) * (cells + 1) + i];
+            const Vector3& p11 = points[(j + 1) * (cells + 1) + i + 1];
+            if (random() % 2 == 0) {
+                triangles.insert(triangles.end(), { p00, p10, p11, p00, p11, p01 });
+            } else {
+                triangles.insert(triangles.end(), { p00, p10, p01, p10, p11, p01 });
+            }
+        }
+    }
+    return triangles;
+}
+
+// main.cppのデモと同じ並び: 床に並べた小さな箱と、その手前と横に立てた大きな壁
+struct OcclusionScene {
+    Matrix4x4 viewProjection;
+    std::vector<Vector3> cube;
+    // 壁(立方体を広げたもの)のワールド行列と、そのワールド空間の箱
+    std::vector<Matrix4x4> walls;
+    std::vector<OcclusionBounds> wallBounds;
+    std::vector<OcclusionBounds> boxes;
+};
+
+inline OcclusionScene BuildOcclusionScene(float width = 320.0f, float height = 192.0f)
+{
+    OcclusionScene scene;
+    const Matrix4x4 camera = MakeAffineMatrix({ 1.0f, 1.0f, 1.0f }, { 0.1f, 0.0f, 0.0f }, { 0.0f, 1.0f, -10.0f });
+    scene.viewProjection = Multiply(Inverse(camera), MakePerspectiveFovMatrix(0.9f, width / height, 0.1f, 100.0f));
+    scene.cube = MakeOcclusionCube();
+
+    const std::pair<Vector3, Vector3> walls[] = {
+        { { 10.0f, 3.0f, 0.5f }, { 0.0f, -1.0f, 4.0f } },
+        { { 0.5f, 3.0f, 24.0f }, { -12.0f, -1.0f, 20.0f } },
+        { { 0.5f, 3.0f, 24.0f }, { 12.0f, -1.0f, 20.0f } },
+    };
+    for (const auto& [scale, translate] : walls) {
+        scene.walls.push_back(MakeAffineMatrix(scale, { 0.0f, 0.0f, 0.0f }, translate));
+        scene.wallBounds.push_back({
+            { translate.x - scale.x * 0.5f, translate.y - scale.y * 0.5f, translate.z - scale.z * 0.5f },
+            { translate.x + scale.x * 0.5f, translate.y + scale.y * 0.5f, translate.z + scale.z * 0.5f },
+        });
+    }
+
+    // カメラの後ろや横にはみ出すところまで並べる
+    constexpr float kBoxSize = 0.5f;
+    for (int z = -30; z <= 50; z += 2) {
+        for (int x = -30; x <= 30; x += 2) {
+            const Vector3 center = { float(x), -1.5f, float(z) };
+            scene.boxes.push_back({
+                { center.x - kBoxSize * 0.5f, center.y - kBoxSize * 0.5f, center.z - kBoxSize * 0.5f },
+                { center.x + kBoxSize * 0.5f, center.y + kBoxSize * 0.5f, center.z + kBoxSize * 0.5f },
+            });
+        }
+    }
+    return scene;
+}
+
+inline void AddOcclusionSceneOccluders(OcclusionCuller& culler, const OcclusionScene& scene)
+{
+    culler.BeginFrame(scene.viewProjection);
+    for (const Matrix4x4& wall : scene.walls) {
+        culler.AddOccluder(scene.cube.data(), sizeof(Vector3), uint32_t(scene.cube.size()), wall);
+    }
+}
@@ -0,0 +1,159 @@
+#include "ParallelRecorder.h"
+#include "TestFramework.h"
+#include "ThreadPool.h"
+#include <vector>
+
+namespace {
+
+using EventType = RecordingCommandListBackend::EventType;
+
+// メインで記録する値とワーカーで記録する値を混ぜないよう、ワーカーのものはこれより後ろの番号にする
+constexpr uint32_t kItemBase = 1000;
+
+// メイン、区切ったitemCount個、メインの順に記録した1フレーム分の期待する並び
+std::vector<uint32_t> ExpectedFrame(uint32_t itemCount)
+{
+    std::vector<uint32_t> expected = { 1, 2 };
+    for (uint32_t i = 0; i < itemCount; ++i) {
+        expected.push_back(kItemBase + i);
+    }
+    expected.push_back(3);
+    return expected;
+}
+
+void RecordFrame(ParallelRecorder& recorder, RecordingCommandListBackend& backend, uint32_t itemCount)
+{
+    recorder.BeginFrame();
+    backend.Record(recorder.GetCurrentList(), 1);
+    backend.Record(recorder.GetCurrentList(), 2);
+    recorder.RecordParallel(itemCount, [&](uint32_t list, uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i) {
+            backend.Record(list, kItemBase + i);
+        }
+    });
+    backend.Record(recorder.GetCurrentList(), 3);
+    recorder.Submit();
+}
+
+} // namespace
+
+TEST(ParallelRecorder_PartitionSplitsEvenly)
+{
+    const std::vector<RecordRange> ranges = ParallelRecorder::Partition(10, 3, 1);
+    CHECK(ranges.size() == 3);
+    // 隙間なく順に並び、大きさの差は1以下
+    uint32_t next = 0;
+    for (const RecordRange& range : ranges) {
+        CHECK(range.begin == next);
+        CHECK(range.end - range.begin >= 3 && range.end - range.begin <= 4);
+        next = range.end;
+    }
+    CHECK(next == 10);
+
+    // 1つminItemsPerChunk個以上にする
+    CHECK(ParallelRecorder::Partition(10, 8, 4).size() == 2);
+    CHECK(ParallelRecorder::Partition(3, 8, 4).size() == 1);
+    CHECK(ParallelRecorder::Partition(0, 8, 4).empty());
+}
+
+TEST(ParallelRecorder_WithoutThreadPoolRecordsIntoOneList)
+{
+    RecordingCommandListBackend backend;
+    ParallelRecorder recorder(backend, nullptr, 1);
+    RecordFrame(recorder, backend, 100);
+
+    CHECK(backend.GetSubmitted() == ExpectedFrame(100));
+    CHECK(recorder.GetStats().commandLists == 1);
+    CHECK(recorder.GetStats().parallelLists == 0);
+    CHECK(recorder.GetStats().items == 100);
+    // 0番を閉じて1つだけ提出する
+    const std::vector<RecordingCommandListBackend::Event>& events = backend.GetEvents();
+    CHECK(events.size() == 2);
+    CHECK(events[0].type == EventType::Close && events[0].list == 0);
+    CHECK(events[1].type == EventType::Submit && events[1].list == 1);
+}
+
+TEST(ParallelRecorder_SmallBatchStaysOnCurrentList)
+{
+    ThreadPool threadPool(3);
+    RecordingCommandListBackend backend;
+    ParallelRecorder recorder(backend, &threadPool, 64);
+    RecordFrame(recorder, backend, 40);
+
+    CHECK(backend.GetSubmitted() == ExpectedFrame(40));
+    CHECK(recorder.GetStats().commandLists == 1);
+}
+
+TEST(ParallelRecorder_SubmitsListsInRecordingOrder)
+{
+    constexpr uint32_t kItems = 10000;
+    ThreadPool threadPool(3);
+    RecordingCommandListBackend backend;
+    ParallelRecorder recorder(backend, &threadPool, 16);
+
+    for (uint32_t frame = 0; frame < 20; ++frame) {
+        backend.Clear();
+        RecordFrame(recorder, backend, kItems);
+
+        // ワーカーがどの順に終わっても、提出した中身は記録した順になる
+        CHECK(backend.GetSubmitted() == ExpectedFrame(kItems));
+        const ParallelRecorderStats& stats = recorder.GetStats();
+        CHECK(stats.parallelLists == threadPool.GetThreadCount() + 1);
+        // 前のメイン、区切ったもの、続きのメイン
+        CHECK(stats.commandLists == stats.parallelLists + 2);
+
+        // どのリストも1回だけ開いて閉じ、すべて閉じてから1回で提出する
+        const std::vector<RecordingCommandListBackend::Event>& events = backend.GetEvents();
+        std::vector<uint32_t> opens(stats.commandLists);
+        std::vector<uint32_t> closes(stats.commandLists);
+        for (size_t i = 0; i + 1 < events.size(); ++i) {
+            CHECK(events[i].type != EventType::Submit);
+            CHECK(events[i].list < stats.commandLists);
+            if (events[i].list >= stats.commandLists) {
+                continue;
+            }
+            if (events[i].type == EventType::Open) {
+                ++opens[events[i].list];
+            } else if (events[i].type == EventType::Close) {
+                CHECK(closes[events[i].list] < opens[events[i].list] || events[i].list == 0);
+                ++closes[events[i].list];
+            }
+        }
+        CHECK(events.back().type == EventType::Submit && events.back().list == stats.commandLists);
+        for (uint32_t list = 0; list < stats.commandLists; ++list) {
+            // 0番は呼び出し側が開いている
+            CHECK(opens[list] == (list == 0 ? 0u : 1u));
+            CHECK(closes[list] == 1);
+        }
+    }
+}
+
+TEST(ParallelRecorder_SeveralParallelSectionsInOneFrame)
+{
+    ThreadPool threadPool(2);
+    RecordingCommandListBackend backend;
+    ParallelRecorder recorder(backend, &threadPool, 8);
+
+    recorder.BeginFrame();
+    std::vector<uint32_t> expected;
+    auto record = [&](uint32_t list, uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i) {
+            backend.Record(list, kItemBase + i);
+        }
+    };
+    for (uint32_t section = 0; section < 3; ++section) {
+        backend.Record(recorder.GetCurrentList(), section);
+        expected.push_back(section);
+        recorder.RecordParallel(100, record);
+        for (uint32_t i = 0; i < 100; ++i) {
+            expected.push_back(kItemBase + i);
+        }
+    }
+    recorder.Submit();
+
+    CHECK(backend.GetSubmitted() == expected);
+    // 区切るたびに3つのリストと続きのリストを足す
+    CHECK(recorder.GetStats().parallelLists == 9);
+    CHECK(recorder.GetStats().commandLists == 1 + 3 * 4);
+    CHECK(recorder.GetStats().items == 300);
+}
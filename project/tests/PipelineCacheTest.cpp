@@ -0,0 +1,235 @@
+#include "PipelineKey.h"
+#include "PipelineTable.h"
+#include "TestFramework.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// D3D12_GRAPHICS_PIPELINE_STATE_DESCのうち、ComputePipelineKeyが読むメンバーだけを同じ名前で持つ
+struct FakeShader {
+    const void* pShaderBytecode = nullptr;
+    size_t BytecodeLength = 0;
+};
+struct FakeRenderTargetBlend {
+    int BlendEnable = 0, LogicOpEnable = 0, SrcBlend = 2, DestBlend = 1, BlendOp = 1;
+    int SrcBlendAlpha = 2, DestBlendAlpha = 1, BlendOpAlpha = 1, LogicOp = 0;
+    uint8_t RenderTargetWriteMask = 15;
+};
+struct FakeBlend {
+    int AlphaToCoverageEnable = 0, IndependentBlendEnable = 0;
+    FakeRenderTargetBlend RenderTarget[8];
+};
+struct FakeRasterizer {
+    int FillMode = 3, CullMode = 3, FrontCounterClockwise = 0, DepthBias = 0;
+    float DepthBiasClamp = 0.0f, SlopeScaledDepthBias = 0.0f;
+    int DepthClipEnable = 1, MultisampleEnable = 0, AntialiasedLineEnable = 0;
+    unsigned ForcedSampleCount = 0;
+    int ConservativeRaster = 0;
+};
+struct FakeStencilOp {
+    int StencilFailOp = 1, StencilDepthFailOp = 1, StencilPassOp = 1, StencilFunc = 8;
+};
+struct FakeDepthStencil {
+    int DepthEnable = 1, DepthWriteMask = 1, DepthFunc = 4, StencilEnable = 0;
+    uint8_t StencilReadMask = 0xFF, StencilWriteMask = 0xFF;
+    FakeStencilOp FrontFace, BackFace;
+};
+struct FakeInputElement {
+    const char* SemanticName = nullptr;
+    unsigned SemanticIndex = 0;
+    int Format = 0;
+    unsigned InputSlot = 0, AlignedByteOffset = 0;
+    int InputSlotClass = 0;
+    unsigned InstanceDataStepRate = 0;
+};
+struct FakeInputLayout {
+    const FakeInputElement* pInputElementDescs = nullptr;
+    unsigned NumElements = 0;
+};
+struct FakeStreamOutput {
+    unsigned NumEntries = 0;
+};
+struct FakeSampleDesc {
+    unsigned Count = 1, Quality = 0;
+};
+struct FakePipelineDesc {
+    FakeShader VS, PS, DS, HS, GS;
+    FakeStreamOutput StreamOutput;
+    FakeBlend BlendState;
+    unsigned SampleMask = 0xFFFFFFFF;
+    FakeRasterizer RasterizerState;
+    FakeDepthStencil DepthStencilState;
+    FakeInputLayout InputLayout;
+    int IBStripCutValue = 0, PrimitiveTopologyType = 3;
+    unsigned NumRenderTargets = 1;
+    int RTVFormats[8] = { 29 };
+    int DSVFormat = 45;
+    FakeSampleDesc SampleDesc;
+    unsigned NodeMask = 0;
+    int Flags = 0;
+};
+
+// シェーダーとセマンティクス名は別々のメモリに持ち、ポインターが違っても中身が同じなら同じキーになることを確かめる
+struct PipelineSource {
+    std::vector<uint8_t> vertexShader = { 1, 2, 3, 4 };
+    std::vector<uint8_t> pixelShader = { 5, 6, 7, 8, 9 };
+    std::string position = "POSITION";
+    std::string texcoord = "TEXCOORD";
+    FakeInputElement elements[2];
+    FakePipelineDesc desc;
+
+    PipelineSource()
+    {
+        elements[0].SemanticName = position.c_str();
+        elements[0].Format = 2;
+        elements[1].SemanticName = texcoord.c_str();
+        elements[1].Format = 16;
+        elements[1].AlignedByteOffset = 16;
+        desc.VS = { vertexShader.data(), vertexShader.size() };
+        desc.PS = { pixelShader.data(), pixelShader.size() };
+        desc.InputLayout = { elements, 2 };
+    }
+    PipelineSource(const PipelineSource&) = delete;
+};
+
+} // namespace
+
+TEST(PipelineKey_SameContentSameKey)
+{
+    PipelineSource a;
+    PipelineSource b;
+    CHECK(a.desc.VS.pShaderBytecode != b.desc.VS.pShaderBytecode);
+    CHECK(ComputePipelineKey(a.desc, 1) == ComputePipelineKey(b.desc, 1));
+    CHECK(ComputePipelineKey(a.desc, 1) != ComputePipelineKey(a.desc, 2));
+}
+
+TEST(PipelineKey_EachFieldChangesKey)
+{
+    PipelineSource source;
+    const uint64_t base = ComputePipelineKey(source.desc, 7);
+    std::vector<uint64_t> keys = { base };
+    auto changed = [&](auto edit) {
+        PipelineSource other;
+        edit(other);
+        keys.push_back(ComputePipelineKey(other.desc, 7));
+        return keys.back() != base;
+    };
+    CHECK(changed([](PipelineSource& s) { s.pixelShader[2] = 0; }));
+    CHECK(changed([](PipelineSource& s) { s.desc.PS.BytecodeLength = 4; }));
+    CHECK(changed([](PipelineSource& s) { s.texcoord = "NORMAL"; s.elements[1].SemanticName = s.texcoord.c_str(); }));
+    CHECK(changed([](PipelineSource& s) { s.elements[1].Format = 6; }));
+    CHECK(changed([](PipelineSource& s) { s.desc.InputLayout.NumElements = 1; }));
+    CHECK(changed([](PipelineSource& s) { s.desc.BlendState.RenderTarget[0].BlendEnable = 1; }));
+    CHECK(changed([](PipelineSource& s) { s.desc.BlendState.RenderTarget[7].RenderTargetWriteMask = 0; }));
+    CHECK(changed([](PipelineSource& s) { s.desc.RasterizerState.CullMode = 1; }));
+    CHECK(changed([](PipelineSource& s) { s.desc.RasterizerState.SlopeScaledDepthBias = 1.0f; }));
+    CHECK(changed([](PipelineSource& s) { s.desc.DepthStencilState.BackFace.StencilFunc = 1; }));
+    CHECK(changed([](PipelineSource& s) { s.desc.DepthStencilState.DepthEnable = 0; }));
+    CHECK(changed([](PipelineSource& s) { s.desc.NumRenderTargets = 2; }));
+    CHECK(changed([](PipelineSource& s) { s.desc.DSVFormat = 0; }));
+    CHECK(changed([](PipelineSource& s) { s.desc.SampleDesc.Count = 4; }));
+    CHECK(changed([](PipelineSource& s) { s.desc.StreamOutput.NumEntries = 1; }));
+
+    // 使っていないRTVのフォーマットは見ない
+    CHECK(!changed([](PipelineSource& s) { s.desc.RTVFormats[3] = 10; }));
+    // 変更ごとにキーが重ならない
+    std::sort(keys.begin(), keys.end() - 1);
+    CHECK(std::unique(keys.begin(), keys.end() - 1) == keys.end() - 1);
+}
+
+TEST(PipelineTable_CreatesEachKeyOnce)
+{
+    PipelineTable<std::shared_ptr<int>> table;
+    std::shared_ptr<int> value;
+    CHECK(table.Acquire(1, value));
+    table.Finish(1, std::make_shared<int>(10));
+    CHECK(!table.Acquire(1, value));
+    CHECK(value && *value == 10);
+
+    // 予約済みのキーは作る側にならない
+    CHECK(table.Claim(2));
+    CHECK(!table.Claim(2));
+    CHECK(!table.Claim(1));
+    table.Finish(2, std::make_shared<int>(20));
+    CHECK(!table.Acquire(2, value) && *value == 20);
+
+    const PipelineTable<std::shared_ptr<int>>::Stats stats = table.GetStats();
+    CHECK(stats.requests == 3);
+    CHECK(stats.deduplicated == 2);
+}
+
+TEST(PipelineTable_RetriesFailures)
+{
+    PipelineTable<std::shared_ptr<int>> table;
+    std::shared_ptr<int> value;
+    CHECK(table.Acquire(5, value));
+    table.Finish(5, nullptr);
+    // 失敗したものは次の要求でもう一度作る
+    CHECK(table.Acquire(5, value));
+    table.Finish(5, std::make_shared<int>(1));
+    CHECK(!table.Acquire(5, value) && value != nullptr);
+}
+
+TEST(PipelineTable_ConcurrentRequestsShareOneCreation)
+{
+    PipelineTable<std::shared_ptr<int>> table;
+    std::atomic<uint32_t> creations { 0 };
+    constexpr uint32_t kThreads = 8;
+    constexpr uint32_t kKeys = 64;
+    std::vector<std::vector<std::shared_ptr<int>>> results(kThreads, std::vector<std::shared_ptr<int>>(kKeys));
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&, t] {
+            for (uint32_t k = 0; k < kKeys; ++k) {
+                // スレッドごとに違う順で要求して、作っている途中のキーを待つ場合も通す
+                const uint64_t key = (k * 7 + t * 13) % kKeys;
+                std::shared_ptr<int> value;
+                if (table.Acquire(key, value)) {
+                    ++creations;
+                    std::this_thread::yield();
+                    value = std::make_shared<int>(int(key));
+                    table.Finish(key, value);
+                }
+                results[t][key] = value;
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    CHECK(creations == kKeys);
+    for (uint32_t k = 0; k < kKeys; ++k) {
+        for (uint32_t t = 0; t < kThreads; ++t) {
+            CHECK(results[t][k] == results[0][k] && *results[t][k] == int(k));
+        }
+    }
+    const PipelineTable<std::shared_ptr<int>>::Stats stats = table.GetStats();
+    CHECK(stats.requests == kThreads * kKeys);
+    CHECK(stats.deduplicated == kThreads * kKeys - kKeys);
+}
+
+TEST(PipelineTable_WaitIdleWaitsForPrewarm)
+{
+    ThreadPool threadPool(2);
+    PipelineTable<std::shared_ptr<int>> table;
+    std::atomic<uint32_t> finished { 0 };
+    for (uint64_t key = 0; key < 32; ++key) {
+        if (table.Claim(key)) {
+            threadPool.Enqueue([&, key] {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+                ++finished;
+                table.Finish(key, std::make_shared<int>(int(key)));
+            });
+        }
+    }
+    table.WaitIdle();
+    CHECK(finished == 32);
+    std::shared_ptr<int> value;
+    CHECK(!table.Acquire(31, value) && *value == 31);
+}
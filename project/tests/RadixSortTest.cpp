@@ -0,0 +1,79 @@
+#include "RadixSort.h"
+#include "TestFramework.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+// RadixSort.cppで並列に切り替える要素数
+constexpr uint32_t kParallelThreshold = 16 * 1024;
+
+// 0桁目と5桁目だけが変わり、ほかの桁は全要素で同じキー。値の種類が少ないので同じキーがたくさん並ぶ
+std::vector<SortKey> MakeKeys(uint32_t count, uint32_t seed)
+{
+    std::vector<SortKey> keys(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        const uint64_t low = (seed >> 8) & 0x0f;
+        const uint64_t high = (seed >> 16) % 37;
+        keys[i] = { 0xab00000000000000ull | (high << 40) | low, i };
+    }
+    return keys;
+}
+
+// std::stable_sortと同じ並び(キーの順、同じキーは元の順)になるかを確かめる
+void CheckMatchesStableSort(uint32_t count, ThreadPool* threadPool)
+{
+    std::vector<SortKey> keys = MakeKeys(count, count);
+    std::vector<SortKey> expected = keys;
+    std::stable_sort(expected.begin(), expected.end(), [](const SortKey& a, const SortKey& b) { return a.key < b.key; });
+
+    std::vector<SortKey> scratch;
+    const uint32_t sortedPasses = RadixSort(keys, scratch, threadPool);
+    // 全要素で同じ桁は飛ばすので、変わる2桁だけを処理する
+    CHECK(sortedPasses == 2);
+    CHECK(keys.size() == expected.size());
+    bool same = keys.size() == expected.size();
+    for (size_t i = 0; same && i < keys.size(); ++i) {
+        same = keys[i].key == expected[i].key && keys[i].index == expected[i].index;
+    }
+    CHECK(same);
+}
+
+} // namespace
+
+TEST(RadixSort_MatchesStableSortBelowThreshold)
+{
+    ThreadPool threadPool(3);
+    for (uint32_t count : { 2u, 100u, kParallelThreshold - 1 }) {
+        CheckMatchesStableSort(count, nullptr);
+        CheckMatchesStableSort(count, &threadPool);
+    }
+}
+
+TEST(RadixSort_MatchesStableSortAboveThreshold)
+{
+    // チャンクごとのヒストグラムで分担する並列の経路
+    ThreadPool threadPool(3);
+    for (uint32_t count : { kParallelThreshold, kParallelThreshold + 1, 100003u }) {
+        CheckMatchesStableSort(count, nullptr);
+        CheckMatchesStableSort(count, &threadPool);
+    }
+}
+
+TEST(RadixSort_SkipsAllPassesWhenKeysAreEqual)
+{
+    ThreadPool threadPool(3);
+    std::vector<SortKey> keys(kParallelThreshold * 2);
+    for (uint32_t i = 0; i < uint32_t(keys.size()); ++i) {
+        keys[i] = { 0x0123456789abcdefull, i };
+    }
+    std::vector<SortKey> scratch;
+    CHECK(RadixSort(keys, scratch, &threadPool) == 0);
+    bool inOrder = true;
+    for (uint32_t i = 0; i < uint32_t(keys.size()); ++i) {
+        inOrder = inOrder && keys[i].index == i;
+    }
+    CHECK(inOrder);
+}
@@ -0,0 +1,31 @@
+#include "RenderGraphCompiler.h"
+#include "RenderGraphScene.h"
+#include "TestFramework.h"
+#include <cstdio>
+
+// 数百パスのグラフを組み立て直してコンパイルする時間と、バリアとメモリをどれだけ減らせたかを測る
+BENCHMARK(RenderGraphCompiler_CompileLargeGraph)
+{
+    constexpr uint32_t kPasses = 500;
+    constexpr uint32_t kTransients = 200;
+    const uint32_t kFrames = test::Scale(200, 5);
+
+    RenderGraphCompiler graph;
+    double buildMilliseconds = 0.0;
+    double compileMilliseconds = 0.0;
+    for (uint32_t frame = 0; frame < kFrames; ++frame) {
+        // 毎フレーム組み立て直す(配列の確保はResetをまたいで使い回す)
+        const auto start = std::chrono::steady_clock::now();
+        BuildRandomRenderGraph(graph, kPasses, kTransients, frame % 4);
+        buildMilliseconds += test::ElapsedMilliseconds(start);
+        graph.Compile();
+        compileMilliseconds += graph.GetStats().compileMilliseconds;
+    }
+
+    const RenderGraphStats& stats = graph.GetStats();
+    std::printf("    %u passes (%u culled), %u transients: build %.3f ms, compile %.3f ms per frame\n", stats.passes, stats.culledPasses,
+        stats.transientResources, buildMilliseconds / kFrames, compileMilliseconds / kFrames);
+    std::printf("    transitions %u (naive %u, split %u), aliasing %u, uav %u, batches %u\n", stats.transitionBarriers, stats.naiveTransitions,
+        stats.splitBarriers, stats.aliasingBarriers, stats.uavBarriers, stats.barrierBatches);
+    std::printf("    transient memory %.1f MiB (unaliased %.1f MiB)\n", stats.transientBytes / 1048576.0, stats.unaliasedBytes / 1048576.0);
+}
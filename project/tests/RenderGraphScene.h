@@ -0,0 +1,67 @@
+#pragma once
+#include "RenderGraphCompiler.h"
+#include <random>
+#include <string>
+#include <vector>
+
+// テストとベンチマークで使う、乱数で組み立てたフレーム
+// 一時リソースは最初にDiscardで書き、読むのは書き終えたものだけにする。誰も読まない書き込みは除かれる
+struct RenderGraphScene {
+    RenderGraphResource backBuffer = kInvalidRenderGraphResource;
+    std::vector<RenderGraphResource> transients;
+    // 一時リソースの大きさ(transientsと同じ並び)
+    std::vector<uint64_t> sizes;
+};
+
+inline RenderGraphScene BuildRandomRenderGraph(RenderGraphCompiler& graph, uint32_t passCount, uint32_t transientCount, uint32_t seed)
+{
+    std::mt19937 random(seed);
+    RenderGraphScene scene;
+    graph.Reset();
+    scene.backBuffer = graph.ImportResource("BackBuffer", RenderGraphState_Common, RenderGraphState_Common);
+    const RenderGraphResource history = graph.ImportResource("History", RenderGraphState_PixelShaderResource, RenderGraphState_PixelShaderResource);
+
+    // 種類ごとに書くときの状態と、読むときの状態
+    constexpr RenderGraphStates kWriteStates[] = { RenderGraphState_RenderTarget, RenderGraphState_UnorderedAccess, RenderGraphState_DepthWrite, RenderGraphState_CopyDest };
+    constexpr RenderGraphStates kReadStates[] = { RenderGraphState_PixelShaderResource, RenderGraphState_NonPixelShaderResource, RenderGraphState_DepthRead,
+        RenderGraphState_CopySource };
+    std::vector<uint32_t> kinds;
+    for (uint32_t i = 0; i < transientCount; ++i) {
+        const uint32_t kind = random() % 4;
+        // 大きさは64KiBから16MiBくらい。深度とレンダーターゲットは同じヒープ、UAVとコピー先はテクスチャのヒープに置く
+        const uint64_t size = (uint64_t(1) + random() % 256) * 65536;
+        const uint32_t heapClass = kind == 0 || kind == 2 ? 2 : 1;
+        scene.transients.push_back(graph.CreateTransient("Transient" + std::to_string(i), size, 65536, heapClass));
+        scene.sizes.push_back(size);
+        kinds.push_back(kind);
+    }
+
+    // 書き終えた一時リソース
+    std::vector<RenderGraphResource> written;
+    uint32_t nextTransient = 0;
+    for (uint32_t p = 0; p < passCount; ++p) {
+        const uint32_t pass = graph.AddPass("Pass" + std::to_string(p));
+        for (uint32_t r = random() % 3; r > 0 && !written.empty(); --r) {
+            const RenderGraphResource resource = written[random() % written.size()];
+            graph.Read(pass, resource, kReadStates[kinds[resource - 2]]);
+        }
+        if (random() % 8 == 0) {
+            graph.Read(pass, history, RenderGraphState_PixelShaderResource);
+        }
+        if (nextTransient < transientCount && (random() % 2 == 0 || written.empty())) {
+            // 新しい一時リソースを最初に書く
+            const RenderGraphResource resource = scene.transients[nextTransient++];
+            graph.Write(pass, resource, kWriteStates[kinds[resource - 2]], RenderGraphLoad::Discard);
+            written.push_back(resource);
+        } else if (!written.empty()) {
+            // 書き終えたものに重ねて書く
+            const RenderGraphResource resource = written[random() % written.size()];
+            graph.Write(pass, resource, kWriteStates[kinds[resource - 2]], random() % 4 == 0 ? RenderGraphLoad::Discard : RenderGraphLoad::Preserve);
+        }
+        // 時々画面に描く
+        if (random() % 16 == 0 || p + 1 == passCount) {
+            graph.Write(pass, scene.backBuffer, RenderGraphState_RenderTarget, p == 0 ? RenderGraphLoad::Discard : RenderGraphLoad::Preserve);
+        }
+    }
+    return scene;
+}
@@ -0,0 +1,375 @@
+#include "RenderGraphCompiler.h"
+#include "RenderGraphScene.h"
+#include "TestFramework.h"
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+constexpr uint64_t kMiB = 1ull << 20;
+
+bool HasBarrier(const std::vector<RenderGraphBarrier>& barriers, RenderGraphBarrierType type, RenderGraphResource resource)
+{
+    for (const RenderGraphBarrier& barrier : barriers) {
+        if (barrier.type == type && barrier.resource == resource) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// コンパイルしたグラフをD3D12のようにたどり、状態と同じ場所の持ち主を確かめる
+// フレームをまたいで呼ぶと、前のフレームの終わりの状態から続ける
+class StateSimulator {
+public:
+    StateSimulator(const RenderGraphCompiler& graph, const RenderGraphScene& scene)
+        : graph_(graph)
+        , scene_(scene)
+        , resources_(graph.GetResourceCount())
+    {
+        for (RenderGraphResource r = 0; r < graph.GetResourceCount(); ++r) {
+            // 一時リソースは最初に使う状態で作る。重ねていないものは最初から持ち主
+            if (graph.IsTransient(r)) {
+                resources_[r].state = graph.GetPlacement(r).initialState;
+                resources_[r].active = !graph.GetPlacement(r).aliased;
+            }
+        }
+        resources_[scene.backBuffer].state = RenderGraphState_Common;
+        resources_[scene.backBuffer + 1].state = RenderGraphState_PixelShaderResource;
+    }
+
+    // 見つけた食い違いの数を返す
+    uint32_t RunFrame()
+    {
+        for (uint32_t pass = 0; pass < graph_.GetPassCount(); ++pass) {
+            if (graph_.IsPassCulled(pass)) {
+                continue;
+            }
+            Apply(graph_.GetPassBarriers(pass), pass);
+            for (RenderGraphResource r : graph_.GetPassDiscards(pass)) {
+                constexpr RenderGraphStates kDiscardable = RenderGraphState_RenderTarget | RenderGraphState_DepthWrite | RenderGraphState_UnorderedAccess;
+                Expect(IsActive(r) && (resources_[r].state & kDiscardable) != 0, pass, r, "discard");
+            }
+            for (uint32_t a = 0; a < graph_.GetAccessCount(pass); ++a) {
+                const RenderGraphResource r = graph_.GetAccessResource(pass, a);
+                Expect(IsActive(r), pass, r, "access to retired alias");
+                Expect(!resources_[r].splitPending, pass, r, "access during split barrier");
+                Expect(resources_[r].state == graph_.GetPlannedState(pass, a), pass, r, "state");
+            }
+        }
+        Apply(graph_.GetFinalBarriers(), UINT32_MAX);
+        // 次のフレームは作った状態(Importは決めた状態)から始まる
+        for (RenderGraphResource r = 0; r < graph_.GetResourceCount(); ++r) {
+            const bool used = !graph_.IsTransient(r) || graph_.GetPlacement(r).firstPass != UINT32_MAX;
+            const RenderGraphStates expected = graph_.IsTransient(r) ? graph_.GetPlacement(r).initialState
+                : r == scene_.backBuffer                             ? RenderGraphState_Common
+                                                                     : RenderGraphState_PixelShaderResource;
+            Expect(!used || resources_[r].state == expected, UINT32_MAX, r, "end of frame");
+            Expect(!resources_[r].splitPending, UINT32_MAX, r, "unfinished split barrier");
+        }
+        return errors_;
+    }
+
+private:
+    struct Resource {
+        RenderGraphStates state = RenderGraphState_Common;
+        bool splitPending = false;
+        RenderGraphStates splitAfter = RenderGraphState_Common;
+        bool active = true;
+    };
+
+    bool IsActive(RenderGraphResource r) const { return !graph_.IsTransient(r) || resources_[r].active; }
+
+    bool Overlaps(RenderGraphResource a, RenderGraphResource b) const
+    {
+        const RenderGraphPlacement& pa = graph_.GetPlacement(a);
+        const RenderGraphPlacement& pb = graph_.GetPlacement(b);
+        return pa.heapClass == pb.heapClass && pa.offset < pb.offset + GetSize(b) && pb.offset < pa.offset + GetSize(a);
+    }
+
+    uint64_t GetSize(RenderGraphResource r) const { return scene_.sizes[r - scene_.transients.front()]; }
+
+    void Apply(const std::vector<RenderGraphBarrier>& barriers, uint32_t pass)
+    {
+        for (const RenderGraphBarrier& barrier : barriers) {
+            Resource& resource = resources_[barrier.resource];
+            if (barrier.type == RenderGraphBarrierType::Aliasing) {
+                // 重なっているものはすべて持ち主でなくなる
+                for (RenderGraphResource other : scene_.transients) {
+                    if (other != barrier.resource && graph_.GetPlacement(other).firstPass != UINT32_MAX && Overlaps(other, barrier.resource)) {
+                        resources_[other].active = false;
+                    }
+                }
+                resource.active = true;
+                continue;
+            }
+            if (barrier.type == RenderGraphBarrierType::Uav) {
+                Expect(resource.state == RenderGraphState_UnorderedAccess, pass, barrier.resource, "uav barrier");
+                continue;
+            }
+            // 持ち主でないものに遷移を張ってはいけない
+            Expect(IsActive(barrier.resource), pass, barrier.resource, "transition on retired alias");
+            if (barrier.split == RenderGraphBarrierSplit::EndOnly) {
+                Expect(resource.splitPending && resource.splitAfter == barrier.after, pass, barrier.resource, "split end");
+                resource.splitPending = false;
+                resource.state = barrier.after;
+                continue;
+            }
+            Expect(!resource.splitPending && resource.state == barrier.before, pass, barrier.resource, "transition before");
+            if (barrier.split == RenderGraphBarrierSplit::BeginOnly) {
+                resource.splitPending = true;
+                resource.splitAfter = barrier.after;
+            } else {
+                resource.state = barrier.after;
+            }
+        }
+    }
+
+    void Expect(bool condition, uint32_t pass, RenderGraphResource r, const char* what)
+    {
+        if (!condition) {
+            if (errors_ == 0) {
+                std::printf("    pass %u resource %s: %s\n", pass, graph_.GetResourceName(r).c_str(), what);
+            }
+            ++errors_;
+        }
+    }
+
+    const RenderGraphCompiler& graph_;
+    const RenderGraphScene& scene_;
+    std::vector<Resource> resources_;
+    uint32_t errors_ = 0;
+};
+
+} // namespace
+
+TEST(RenderGraphCompiler_CullsPassesWhoseOutputIsUnused)
+{
+    RenderGraphCompiler graph;
+    const RenderGraphResource backBuffer = graph.ImportResource("BackBuffer", RenderGraphState_Common, RenderGraphState_Common);
+    const RenderGraphResource unused = graph.CreateTransient("Unused", kMiB, 65536, 0);
+    const RenderGraphResource readback = graph.CreateTransient("Readback", kMiB, 65536, 0);
+    const uint32_t dead = graph.AddPass("Dead");
+    graph.Write(dead, unused, RenderGraphState_RenderTarget, RenderGraphLoad::Discard);
+    const uint32_t sideEffect = graph.AddPass("SideEffect");
+    graph.Write(sideEffect, readback, RenderGraphState_CopyDest, RenderGraphLoad::Discard);
+    graph.SetSideEffect(sideEffect);
+    const uint32_t present = graph.AddPass("Present");
+    graph.Write(present, backBuffer, RenderGraphState_RenderTarget, RenderGraphLoad::Discard);
+    graph.Compile();
+
+    CHECK(graph.IsPassCulled(dead));
+    CHECK(!graph.IsPassCulled(sideEffect));
+    CHECK(!graph.IsPassCulled(present));
+    CHECK(graph.GetStats().culledPasses == 1);
+    // 除いたパスしか使わないものは置かない
+    CHECK(graph.GetPlacement(unused).firstPass == UINT32_MAX);
+    CHECK(graph.GetStats().transientResources == 1);
+}
+
+TEST(RenderGraphCompiler_DiscardWriteCullsEarlierWriter)
+{
+    RenderGraphCompiler graph;
+    const RenderGraphResource backBuffer = graph.ImportResource("BackBuffer", RenderGraphState_Common, RenderGraphState_Common);
+    const uint32_t overwritten = graph.AddPass("Overwritten");
+    graph.Write(overwritten, backBuffer, RenderGraphState_RenderTarget, RenderGraphLoad::Discard);
+    const uint32_t clear = graph.AddPass("Clear");
+    graph.Write(clear, backBuffer, RenderGraphState_RenderTarget, RenderGraphLoad::Discard);
+    const uint32_t blend = graph.AddPass("Blend");
+    graph.Write(blend, backBuffer, RenderGraphState_RenderTarget);
+    graph.Compile();
+
+    CHECK(graph.IsPassCulled(overwritten));
+    CHECK(!graph.IsPassCulled(clear));
+    CHECK(!graph.IsPassCulled(blend));
+}
+
+TEST(RenderGraphCompiler_MergesConsecutiveReads)
+{
+    RenderGraphCompiler graph;
+    const RenderGraphResource backBuffer = graph.ImportResource("BackBuffer", RenderGraphState_Common, RenderGraphState_Common);
+    const RenderGraphResource color = graph.CreateTransient("Color", kMiB, 65536, 0);
+    const uint32_t draw = graph.AddPass("Draw");
+    graph.Write(draw, color, RenderGraphState_RenderTarget, RenderGraphLoad::Discard);
+    const uint32_t compute = graph.AddPass("Compute");
+    graph.Read(compute, color, RenderGraphState_NonPixelShaderResource);
+    graph.Write(compute, backBuffer, RenderGraphState_UnorderedAccess, RenderGraphLoad::Discard);
+    const uint32_t composite = graph.AddPass("Composite");
+    graph.Read(composite, color, RenderGraphState_PixelShaderResource);
+    graph.Write(composite, backBuffer, RenderGraphState_RenderTarget);
+    graph.Compile();
+
+    // 2つの読み込みは1回の遷移でまとめた状態にする
+    constexpr RenderGraphStates kMerged = RenderGraphState_NonPixelShaderResource | RenderGraphState_PixelShaderResource;
+    CHECK(graph.GetPlannedState(compute, 0) == kMerged);
+    CHECK(graph.GetPlannedState(composite, 0) == kMerged);
+    CHECK(HasBarrier(graph.GetPassBarriers(compute), RenderGraphBarrierType::Transition, color));
+    CHECK(!HasBarrier(graph.GetPassBarriers(composite), RenderGraphBarrierType::Transition, color));
+    CHECK(graph.GetStats().naiveTransitions > graph.GetStats().transitionBarriers);
+}
+
+TEST(RenderGraphCompiler_SplitsTransitionAcrossIdlePasses)
+{
+    RenderGraphCompiler graph;
+    const RenderGraphResource backBuffer = graph.ImportResource("BackBuffer", RenderGraphState_Common, RenderGraphState_Common);
+    const RenderGraphResource shadow = graph.CreateTransient("Shadow", kMiB, 65536, 0);
+    const uint32_t shadowPass = graph.AddPass("Shadow");
+    graph.Write(shadowPass, shadow, RenderGraphState_DepthWrite, RenderGraphLoad::Discard);
+    const uint32_t idle = graph.AddPass("Idle");
+    graph.Write(idle, backBuffer, RenderGraphState_RenderTarget, RenderGraphLoad::Discard);
+    const uint32_t lighting = graph.AddPass("Lighting");
+    graph.Read(lighting, shadow, RenderGraphState_PixelShaderResource);
+    graph.Write(lighting, backBuffer, RenderGraphState_RenderTarget);
+    graph.Compile();
+
+    // 使い終えた次のパスで始め、使うパスの前で終える
+    auto find = [](const std::vector<RenderGraphBarrier>& barriers, RenderGraphResource resource) {
+        for (const RenderGraphBarrier& barrier : barriers) {
+            if (barrier.resource == resource) {
+                return barrier;
+            }
+        }
+        return RenderGraphBarrier {};
+    };
+    const RenderGraphBarrier begin = find(graph.GetPassBarriers(idle), shadow);
+    const RenderGraphBarrier end = find(graph.GetPassBarriers(lighting), shadow);
+    CHECK(begin.resource == shadow && begin.split == RenderGraphBarrierSplit::BeginOnly);
+    CHECK(end.resource == shadow && end.split == RenderGraphBarrierSplit::EndOnly);
+    CHECK(end.before == RenderGraphState_DepthWrite && end.after == RenderGraphState_PixelShaderResource);
+    // BackBufferもフレームの始めから使うIdleまでの間に遷移を分割する
+    const RenderGraphBarrier backBufferBegin = find(graph.GetPassBarriers(shadowPass), backBuffer);
+    CHECK(backBufferBegin.resource == backBuffer && backBufferBegin.split == RenderGraphBarrierSplit::BeginOnly);
+    CHECK(graph.GetStats().splitBarriers == 2);
+}
+
+TEST(RenderGraphCompiler_UavBarrierBetweenConsecutiveWrites)
+{
+    RenderGraphCompiler graph;
+    const RenderGraphResource backBuffer = graph.ImportResource("BackBuffer", RenderGraphState_Common, RenderGraphState_Common);
+    const RenderGraphResource buffer = graph.CreateTransient("Buffer", kMiB, 65536, 0);
+    const uint32_t first = graph.AddPass("First");
+    graph.Write(first, buffer, RenderGraphState_UnorderedAccess, RenderGraphLoad::Discard);
+    const uint32_t second = graph.AddPass("Second");
+    graph.Write(second, buffer, RenderGraphState_UnorderedAccess);
+    const uint32_t resolve = graph.AddPass("Resolve");
+    graph.Read(resolve, buffer, RenderGraphState_PixelShaderResource);
+    graph.Write(resolve, backBuffer, RenderGraphState_RenderTarget, RenderGraphLoad::Discard);
+    graph.Compile();
+
+    CHECK(HasBarrier(graph.GetPassBarriers(second), RenderGraphBarrierType::Uav, buffer));
+    CHECK(!HasBarrier(graph.GetPassBarriers(second), RenderGraphBarrierType::Transition, buffer));
+    CHECK(graph.GetStats().uavBarriers == 1);
+}
+
+TEST(RenderGraphCompiler_AliasesTransientsAndRestoresOnlyTheLiveAlias)
+{
+    RenderGraphCompiler graph;
+    const RenderGraphResource backBuffer = graph.ImportResource("BackBuffer", RenderGraphState_Common, RenderGraphState_Common);
+    const RenderGraphResource early = graph.CreateTransient("Early", kMiB, 65536, 0);
+    const RenderGraphResource late = graph.CreateTransient("Late", kMiB, 65536, 0);
+    const uint32_t writeEarly = graph.AddPass("WriteEarly");
+    graph.Write(writeEarly, early, RenderGraphState_RenderTarget, RenderGraphLoad::Discard);
+    const uint32_t readEarly = graph.AddPass("ReadEarly");
+    graph.Read(readEarly, early, RenderGraphState_PixelShaderResource);
+    graph.Write(readEarly, backBuffer, RenderGraphState_RenderTarget, RenderGraphLoad::Discard);
+    const uint32_t writeLate = graph.AddPass("WriteLate");
+    graph.Write(writeLate, late, RenderGraphState_RenderTarget, RenderGraphLoad::Discard);
+    const uint32_t readLate = graph.AddPass("ReadLate");
+    graph.Read(readLate, late, RenderGraphState_PixelShaderResource);
+    graph.Write(readLate, backBuffer, RenderGraphState_RenderTarget);
+    graph.Compile();
+
+    // 生きている間が重ならないので同じ場所に置く
+    CHECK(graph.GetPlacement(early).offset == graph.GetPlacement(late).offset);
+    CHECK(graph.GetPlacement(early).aliased && graph.GetPlacement(late).aliased);
+    CHECK(graph.GetPlacement(early).reusedLater && !graph.GetPlacement(late).reusedLater);
+    CHECK(graph.GetStats().transientBytes == kMiB);
+    CHECK(graph.GetStats().unaliasedBytes == 2 * kMiB);
+
+    // Earlyは場所を明け渡す前(エイリアシングバリアより先)に作った状態へ戻す
+    const std::vector<RenderGraphBarrier>& handover = graph.GetPassBarriers(writeLate);
+    CHECK(handover.size() == 2);
+    CHECK(handover[0].type == RenderGraphBarrierType::Transition && handover[0].resource == early);
+    CHECK(handover[0].after == RenderGraphState_RenderTarget);
+    CHECK(handover[1].type == RenderGraphBarrierType::Aliasing && handover[1].resource == late);
+
+    // フレームの終わりに戻すのは、その時点で場所の持ち主であるLateだけ
+    CHECK(!HasBarrier(graph.GetFinalBarriers(), RenderGraphBarrierType::Transition, early));
+    CHECK(HasBarrier(graph.GetFinalBarriers(), RenderGraphBarrierType::Transition, late));
+}
+
+TEST(RenderGraphCompiler_DiscardsFirstWriteOfTransient)
+{
+    RenderGraphCompiler graph;
+    const RenderGraphResource backBuffer = graph.ImportResource("BackBuffer", RenderGraphState_Common, RenderGraphState_Common);
+    const RenderGraphResource depth = graph.CreateTransient("Depth", kMiB, 65536, 0);
+    const RenderGraphResource copy = graph.CreateTransient("Copy", kMiB, 65536, 1);
+    const uint32_t prepass = graph.AddPass("Prepass");
+    graph.Write(prepass, depth, RenderGraphState_DepthWrite, RenderGraphLoad::Discard);
+    graph.Write(prepass, copy, RenderGraphState_CopyDest, RenderGraphLoad::Discard);
+    const uint32_t draw = graph.AddPass("Draw");
+    graph.Write(draw, depth, RenderGraphState_DepthWrite);
+    graph.Read(draw, copy, RenderGraphState_PixelShaderResource);
+    graph.Write(draw, backBuffer, RenderGraphState_RenderTarget, RenderGraphLoad::Discard);
+    graph.Compile();
+
+    // DiscardResourceはレンダーターゲット、深度、UAVの状態でだけ呼べる。コピー先はコピーが全体を書く
+    CHECK(graph.GetPassDiscards(prepass).size() == 1 && graph.GetPassDiscards(prepass)[0] == depth);
+    CHECK(graph.GetPassDiscards(draw).empty());
+    CHECK(graph.GetUninitializedTransients().empty());
+}
+
+#ifdef NDEBUG
+// assertが無いときは数えて返す
+TEST(RenderGraphCompiler_ReportsTransientFirstUsedWithoutDiscard)
+{
+    RenderGraphCompiler graph;
+    const RenderGraphResource backBuffer = graph.ImportResource("BackBuffer", RenderGraphState_Common, RenderGraphState_Common);
+    const RenderGraphResource accumulation = graph.CreateTransient("Accumulation", kMiB, 65536, 0);
+    const uint32_t blend = graph.AddPass("Blend");
+    graph.Write(blend, accumulation, RenderGraphState_RenderTarget);
+    const uint32_t resolve = graph.AddPass("Resolve");
+    graph.Read(resolve, accumulation, RenderGraphState_PixelShaderResource);
+    graph.Write(resolve, backBuffer, RenderGraphState_RenderTarget, RenderGraphLoad::Discard);
+    graph.Compile();
+
+    CHECK(graph.GetStats().uninitializedTransients == 1);
+    CHECK(graph.GetUninitializedTransients().size() == 1 && graph.GetUninitializedTransients()[0] == accumulation);
+    CHECK(graph.GetPassDiscards(blend).empty());
+}
+#endif
+
+TEST(RenderGraphCompiler_RandomGraphsKeepStatesConsistentAcrossFrames)
+{
+    constexpr uint32_t kSeeds = 20;
+    for (uint32_t seed = 0; seed < kSeeds; ++seed) {
+        RenderGraphCompiler graph;
+        const RenderGraphScene scene = BuildRandomRenderGraph(graph, 300, 120, seed);
+        graph.Compile();
+        CHECK(graph.GetUninitializedTransients().empty());
+        CHECK(graph.GetStats().aliasingBarriers > 0);
+        CHECK(graph.GetStats().transientBytes < graph.GetStats().unaliasedBytes);
+
+        // 同じ場所を使う生きているもの同士は、生きている間が重ならない
+        uint32_t overlaps = 0;
+        for (size_t i = 0; i < scene.transients.size(); ++i) {
+            const RenderGraphPlacement& a = graph.GetPlacement(scene.transients[i]);
+            for (size_t j = i + 1; j < scene.transients.size(); ++j) {
+                const RenderGraphPlacement& b = graph.GetPlacement(scene.transients[j]);
+                if (a.firstPass == UINT32_MAX || b.firstPass == UINT32_MAX || a.heapClass != b.heapClass) {
+                    continue;
+                }
+                const bool memory = a.offset < b.offset + scene.sizes[j] && b.offset < a.offset + scene.sizes[i];
+                const bool lifetime = a.firstPass <= b.lastPass && b.firstPass <= a.lastPass;
+                overlaps += memory && lifetime;
+            }
+        }
+        CHECK(overlaps == 0);
+
+        // 2フレーム目は1フレーム目の終わりの状態と持ち主から始まる
+        StateSimulator simulator(graph, scene);
+        const uint32_t firstFrameErrors = simulator.RunFrame();
+        CHECK(firstFrameErrors == 0);
+        CHECK(simulator.RunFrame() == firstFrameErrors);
+    }
+}
@@ -0,0 +1,394 @@
+#include "ResourceStateList.h"
+#include "TestFramework.h"
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+// リソースの代わりに、アドレスだけを使う
+struct FakeResources {
+    explicit FakeResources(size_t count) : storage(count) { }
+    ResourceStateKey operator[](size_t index) { return &storage[index]; }
+    std::vector<int> storage;
+};
+
+constexpr ResourceStates kReadStates = ResourceState_NonPixelShaderResource | ResourceState_PixelShaderResource;
+
+// 1つのリストを記録して、そのまま提出する
+const std::vector<ResourceStateBarrier>& Submit(ResourceStateList& list, std::vector<ResourceStateBarrier>& resolved)
+{
+    list.End();
+    resolved = list.ResolvePending();
+    list.Commit();
+    return resolved;
+}
+
+} // namespace
+
+TEST(ResourceStateList_SkipsRedundantAndMergesQueuedTransitions)
+{
+    FakeResources resources(1);
+    ResourceStateRegistry registry;
+    registry.Register(resources[0], ResourceState_RenderTarget);
+    ResourceStateList list(registry);
+    list.Begin();
+
+    // 最初に使う状態は提出のときに決めるので、ここでは張らない
+    list.Transition(resources[0], ResourceState_RenderTarget);
+    CHECK(list.Flush().empty());
+
+    // まだ張っていない遷移の行き先を変え、読む状態同士はまとめる
+    list.Transition(resources[0], ResourceState_PixelShaderResource);
+    list.Transition(resources[0], ResourceState_NonPixelShaderResource);
+    const std::vector<ResourceStateBarrier> barriers = list.Flush();
+    CHECK(barriers.size() == 1);
+    CHECK(barriers[0].before == ResourceState_RenderTarget && barriers[0].after == kReadStates);
+    CHECK(list.GetStats().mergedAvoided == 1);
+
+    // まとめた状態に含まれるので張らない
+    list.Transition(resources[0], ResourceState_PixelShaderResource);
+    CHECK(list.Flush().empty());
+    CHECK(list.GetStats().redundantAvoided == 1);
+    CHECK(list.GetStats().transitions == 1);
+    CHECK(list.GetStats().barrierCalls == 1);
+}
+
+TEST(ResourceStateList_DropsTransitionThatMergesBackToStart)
+{
+    FakeResources resources(1);
+    ResourceStateRegistry registry;
+    registry.Register(resources[0], ResourceState_RenderTarget);
+    ResourceStateList list(registry);
+    list.Begin();
+    list.Transition(resources[0], ResourceState_RenderTarget);
+    list.Flush();
+
+    list.Transition(resources[0], ResourceState_PixelShaderResource);
+    list.Transition(resources[0], ResourceState_RenderTarget);
+    CHECK(list.Flush().empty());
+    CHECK(list.GetStats().transitions == 0);
+    CHECK(list.GetStats().barrierCalls == 0);
+}
+
+TEST(ResourceStateList_ResolvesFirstUseFromPreviousList)
+{
+    FakeResources resources(1);
+    ResourceStateRegistry registry;
+    registry.Register(resources[0], ResourceState_RenderTarget);
+    std::vector<ResourceStateBarrier> resolved;
+
+    ResourceStateList list(registry);
+    list.Begin();
+    list.Transition(resources[0], ResourceState_PixelShaderResource);
+    Submit(list, resolved);
+    // 前のリストの終わりの状態から、このリストの前で遷移させる
+    CHECK(resolved.size() == 1);
+    CHECK(resolved[0].before == ResourceState_RenderTarget && resolved[0].after == ResourceState_PixelShaderResource);
+    CHECK(registry.GetState(resources[0]) == ResourceState_PixelShaderResource);
+
+    // 含む読む状態のまま使えるなら遷移しない
+    registry.SetState(resources[0], kReadStates, false);
+    list.Begin();
+    list.Transition(resources[0], ResourceState_PixelShaderResource);
+    CHECK(Submit(list, resolved).empty());
+    CHECK(registry.GetState(resources[0]) == kReadStates);
+}
+
+TEST(ResourceStateList_AssumedStateIsReachedExactly)
+{
+    FakeResources resources(1);
+    ResourceStateRegistry registry;
+    registry.Register(resources[0], ResourceState_PixelShaderResource);
+    std::vector<ResourceStateBarrier> resolved;
+
+    ResourceStateList list(registry);
+    list.Begin();
+    list.Assume(resources[0], ResourceState_RenderTarget);
+    list.Transition(resources[0], ResourceState_PixelShaderResource);
+    const std::vector<ResourceStateBarrier> barriers = list.Flush();
+    CHECK(barriers.size() == 1 && barriers[0].before == ResourceState_RenderTarget);
+    // リストの中でRENDER_TARGETから張っているので、提出のときにちょうどそこへ戻す
+    Submit(list, resolved);
+    CHECK(resolved.size() == 1);
+    CHECK(resolved[0].before == ResourceState_PixelShaderResource && resolved[0].after == ResourceState_RenderTarget);
+}
+
+TEST(ResourceStateList_PromotedTextureDecaysAfterSubmit)
+{
+    FakeResources resources(1);
+    ResourceStateRegistry registry;
+    registry.Register(resources[0], ResourceState_Common);
+    std::vector<ResourceStateBarrier> resolved;
+
+    ResourceStateList list(registry);
+    list.Begin();
+    list.Transition(resources[0], ResourceState_PixelShaderResource);
+    CHECK(Submit(list, resolved).empty());
+    CHECK(registry.GetFrameStats().promotionsAvoided == 0);
+    CHECK(registry.GetState(resources[0]) == ResourceState_PixelShaderResource);
+    registry.EndSubmit();
+    CHECK(registry.GetFrameStats().promotionsAvoided == 1);
+    CHECK(registry.GetState(resources[0]) == ResourceState_Common);
+}
+
+TEST(ResourceStateList_ExplicitTransitionAfterPromotionDoesNotDecay)
+{
+    FakeResources resources(1);
+    ResourceStateRegistry registry;
+    registry.Register(resources[0], ResourceState_Common);
+    std::vector<ResourceStateBarrier> resolved;
+
+    ResourceStateList list(registry);
+    list.Begin();
+    list.Transition(resources[0], ResourceState_PixelShaderResource);
+    list.Flush();
+    list.Transition(resources[0], ResourceState_RenderTarget);
+    list.Flush();
+    list.Transition(resources[0], ResourceState_PixelShaderResource);
+    list.Flush();
+    // 最初の読み込みは昇格で済むが、その後で張った遷移の状態はExecuteCommandListsの後も残る
+    CHECK(Submit(list, resolved).empty());
+    registry.EndSubmit();
+    CHECK(registry.GetState(resources[0]) == ResourceState_PixelShaderResource);
+}
+
+TEST(ResourceStateList_BufferAlwaysDecays)
+{
+    FakeResources resources(1);
+    ResourceStateRegistry registry;
+    registry.Register(resources[0], ResourceState_Common, true);
+    std::vector<ResourceStateBarrier> resolved;
+
+    ResourceStateList list(registry);
+    list.Begin();
+    // バッファは書く状態へも昇格する
+    list.Transition(resources[0], ResourceState_UnorderedAccess);
+    list.Flush();
+    list.Transition(resources[0], ResourceState_NonPixelShaderResource);
+    CHECK(list.Flush().size() == 1);
+    CHECK(Submit(list, resolved).empty());
+    registry.EndSubmit();
+    CHECK(registry.GetState(resources[0]) == ResourceState_Common);
+}
+
+TEST(ResourceStateList_SplitBarrierBeginsAndEnds)
+{
+    FakeResources resources(1);
+    ResourceStateRegistry registry;
+    registry.SetValidation(true);
+    registry.Register(resources[0], ResourceState_RenderTarget);
+    std::vector<ResourceStateBarrier> resolved;
+
+    ResourceStateList list(registry);
+    list.Begin();
+    list.Transition(resources[0], ResourceState_RenderTarget);
+    list.Flush();
+    list.BeginTransition(resources[0], ResourceState_PixelShaderResource);
+    std::vector<ResourceStateBarrier> barriers = list.Flush();
+    CHECK(barriers.size() == 1 && barriers[0].split == ResourceBarrierSplit::BeginOnly);
+    // 終えるまでは使えない
+    list.Validate(resources[0], ResourceState_PixelShaderResource);
+    list.EndTransition(resources[0], ResourceState_PixelShaderResource);
+    barriers = list.Flush();
+    CHECK(barriers.size() == 1 && barriers[0].split == ResourceBarrierSplit::EndOnly);
+    CHECK(barriers[0].before == ResourceState_RenderTarget && barriers[0].after == ResourceState_PixelShaderResource);
+    list.Validate(resources[0], ResourceState_PixelShaderResource);
+
+    // 終えなかったものはEndで終える
+    list.BeginTransition(resources[0], ResourceState_CopyDest);
+    list.Flush();
+    barriers = list.End();
+    CHECK(barriers.size() == 1 && barriers[0].split == ResourceBarrierSplit::EndOnly);
+    resolved = list.ResolvePending();
+    list.Commit();
+    CHECK(registry.GetState(resources[0]) == ResourceState_CopyDest);
+    CHECK(registry.TakeErrors().size() == 1);
+    registry.EndSubmit();
+    CHECK(registry.GetFrameStats().splitTransitions == 2);
+}
+
+TEST(ResourceStateList_ValidatorReportsMismatches)
+{
+    FakeResources resources(3);
+    ResourceStateRegistry registry;
+    registry.SetValidation(true);
+    registry.Register(resources[0], ResourceState_RenderTarget);
+    registry.Register(resources[1], ResourceState_CopyDest);
+    std::vector<ResourceStateBarrier> resolved;
+
+    ResourceStateList list(registry);
+    list.Begin();
+    list.Transition(resources[0], ResourceState_RenderTarget);
+    list.Flush();
+    // 追っている状態と違う
+    list.Validate(resources[0], ResourceState_PixelShaderResource);
+    // 遷移を張る前に使った
+    list.Transition(resources[0], ResourceState_PixelShaderResource);
+    list.Validate(resources[0], ResourceState_PixelShaderResource);
+    list.Flush();
+    list.Validate(resources[0], ResourceState_PixelShaderResource);
+    // リストで初めて使うものは、提出のときに前のリストの状態と比べる
+    list.Validate(resources[1], ResourceState_PixelShaderResource);
+    // 登録していない
+    list.Transition(resources[2], ResourceState_CopySource);
+    Submit(list, resolved);
+    CHECK(resolved.empty());
+
+    const std::vector<std::string> errors = registry.TakeErrors();
+    CHECK(errors.size() == 4);
+    for (const std::string& error : errors) {
+        std::printf("    %s\n", error.c_str());
+    }
+    registry.EndSubmit();
+    CHECK(registry.GetFrameStats().validationErrors == 4);
+
+    // 検証を切れば調べない
+    registry.SetValidation(false);
+    list.Begin();
+    list.Transition(resources[0], ResourceState_RenderTarget);
+    list.Flush();
+    list.Validate(resources[0], ResourceState_PixelShaderResource);
+    Submit(list, resolved);
+    CHECK(registry.TakeErrors().empty());
+}
+
+// いくつものリストに乱数でバリアと使用を記録して提出し、D3D12のようにGPUの状態をたどって確かめる
+// 張ったバリアの前の状態がGPUの状態と合い、使うときにその状態であり、提出後にregistryがGPUと同じ状態を指すこと
+TEST(ResourceStateList_RandomListsMatchSimulatedGpu)
+{
+    constexpr uint32_t kResources = 12;
+    constexpr uint32_t kBuffers = 3;
+    // テクスチャは時々COMMONへ戻し(表示するときなど)、次に使うときに昇格させる
+    constexpr ResourceStates kTextureStates[] = { ResourceState_Common, ResourceState_Common, ResourceState_RenderTarget, ResourceState_UnorderedAccess,
+        ResourceState_DepthWrite, ResourceState_DepthRead, ResourceState_PixelShaderResource, ResourceState_NonPixelShaderResource, kReadStates,
+        ResourceState_CopyDest, ResourceState_CopySource };
+    constexpr ResourceStates kBufferStates[] = { ResourceState_UnorderedAccess, ResourceState_NonPixelShaderResource, ResourceState_IndirectArgument,
+        ResourceState_CopyDest, ResourceState_CopySource, ResourceState_VertexAndConstantBuffer };
+
+    // GPUが見る記録。バリアをまとめたものと、使う状態
+    struct Event {
+        std::vector<ResourceStateBarrier> barriers;
+        uint32_t resource = UINT32_MAX;
+        ResourceStates use = ResourceState_Common;
+    };
+    struct GpuResource {
+        ResourceStates state = ResourceState_Common;
+        bool promoted = false;
+        bool splitting = false;
+    };
+
+    FakeResources resources(kResources);
+    auto indexOf = [&](ResourceStateKey key) { return static_cast<uint32_t>(static_cast<int*>(key) - resources.storage.data()); };
+    auto isReadOnly = [](ResourceStates state) {
+        return (state & (ResourceState_RenderTarget | ResourceState_UnorderedAccess | ResourceState_DepthWrite | ResourceState_CopyDest)) == 0;
+    };
+
+    std::mt19937 random(11);
+    ResourceStateRegistry registry;
+    registry.SetValidation(true);
+    std::vector<GpuResource> gpu(kResources);
+    for (uint32_t r = 0; r < kResources; ++r) {
+        const bool buffer = r < kBuffers;
+        gpu[r].state = buffer || random() % 2 == 0 ? ResourceState_Common : kTextureStates[random() % std::size(kTextureStates)];
+        registry.Register(resources[r], gpu[r].state, buffer);
+    }
+
+    uint32_t mismatches = 0;
+    auto expect = [&](bool condition, const char* what, uint32_t frame, uint32_t resource) {
+        if (!condition) {
+            if (mismatches == 0) {
+                std::printf("    frame %u resource %u: %s\n", frame, resource, what);
+            }
+            ++mismatches;
+        }
+    };
+
+    std::vector<ResourceStateList> lists(4, ResourceStateList(registry));
+    std::vector<std::vector<Event>> events(lists.size());
+    const uint32_t kFrames = 400;
+    for (uint32_t frame = 0; frame < kFrames; ++frame) {
+        const uint32_t listCount = 1 + random() % static_cast<uint32_t>(lists.size());
+        // 記録(実際には別々のスレッドで同時に記録する)
+        for (uint32_t l = 0; l < listCount; ++l) {
+            ResourceStateList& list = lists[l];
+            std::vector<Event>& listEvents = events[l];
+            listEvents.clear();
+            list.Begin();
+            auto use = [&](uint32_t r, ResourceStates state) {
+                list.Validate(resources[r], state);
+                listEvents.push_back({ {}, r, state });
+            };
+            for (uint32_t op = 0; op < 24; ++op) {
+                const uint32_t r = random() % kResources;
+                const ResourceStates state = r < kBuffers ? kBufferStates[random() % std::size(kBufferStates)]
+                                                          : kTextureStates[random() % std::size(kTextureStates)];
+                if (random() % 8 == 0) {
+                    list.BeginTransition(resources[r], state);
+                    listEvents.push_back({ list.Flush() });
+                    list.EndTransition(resources[r], state);
+                    listEvents.push_back({ list.Flush() });
+                } else {
+                    list.Transition(resources[r], state);
+                    listEvents.push_back({ list.Flush() });
+                }
+                use(r, state);
+            }
+            listEvents.push_back({ list.End() });
+        }
+
+        // 提出する順に、前のリストの状態から最初の遷移を決めてGPUに流す
+        for (uint32_t l = 0; l < listCount; ++l) {
+            std::vector<Event> submitted;
+            submitted.push_back({ lists[l].ResolvePending() });
+            lists[l].Commit();
+            submitted.insert(submitted.end(), events[l].begin(), events[l].end());
+            for (const Event& event : submitted) {
+                for (const ResourceStateBarrier& barrier : event.barriers) {
+                    if (barrier.type != ResourceBarrierType::Transition) {
+                        continue;
+                    }
+                    GpuResource& resource = gpu[indexOf(barrier.resource)];
+                    if (barrier.split == ResourceBarrierSplit::EndOnly) {
+                        expect(resource.splitting, "split end without begin", frame, indexOf(barrier.resource));
+                        resource.splitting = false;
+                        resource.state = barrier.after;
+                        continue;
+                    }
+                    expect(resource.state == barrier.before && !resource.splitting, "barrier before state", frame, indexOf(barrier.resource));
+                    resource.promoted = false;
+                    resource.splitting = barrier.split == ResourceBarrierSplit::BeginOnly;
+                    resource.state = barrier.after;
+                }
+                if (event.resource == UINT32_MAX) {
+                    continue;
+                }
+                GpuResource& resource = gpu[event.resource];
+                const bool covered = resource.state == event.use || (isReadOnly(resource.state) && (resource.state & event.use) == event.use);
+                const bool buffer = event.resource < kBuffers;
+                const ResourceStates promotable = ResourceState_NonPixelShaderResource | ResourceState_PixelShaderResource | ResourceState_CopyDest
+                    | ResourceState_CopySource;
+                if (!covered && resource.state == ResourceState_Common && (buffer || (event.use & ~promotable) == 0)) {
+                    // COMMONから暗黙に昇格する
+                    resource.state = event.use;
+                    resource.promoted = true;
+                } else {
+                    expect(covered && !resource.splitting, "use state", frame, event.resource);
+                }
+            }
+        }
+        registry.EndSubmit();
+        // ExecuteCommandListsの後、バッファと読む状態へ昇格したままのテクスチャはCOMMONへ戻る
+        for (uint32_t r = 0; r < kResources; ++r) {
+            if (r < kBuffers || (gpu[r].promoted && isReadOnly(gpu[r].state))) {
+                gpu[r].state = ResourceState_Common;
+            }
+            gpu[r].promoted = false;
+            expect(registry.GetState(resources[r]) == gpu[r].state, "registry after submit", frame, r);
+        }
+        expect(registry.TakeErrors().empty(), "validation error", frame, 0);
+    }
+    CHECK(mismatches == 0);
+    CHECK(registry.GetTotalStats().promotionsAvoided > 0);
+    CHECK(registry.GetTotalStats().resolvedTransitions > 0);
+}
@@ -0,0 +1,124 @@
+#include "FramePacer.h"
+#include "RingAllocator.h"
+#include "TestFramework.h"
+#include <deque>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct Range {
+    uint64_t begin = 0;
+    uint64_t end = 0;
+};
+
+bool Overlaps(const Range& a, const Range& b) { return a.begin < b.end && b.begin < a.end; }
+
+} // namespace
+
+TEST(RingAllocator_AlignsAndWrapsAround)
+{
+    RingAllocator ring(1024);
+    CHECK(ring.Allocate(100, 1) == 0);
+    CHECK(ring.Allocate(10, 256) == 256);
+    ring.FinishFrame(1);
+    CHECK(ring.Allocate(600, 16) == 272);
+    ring.FinishFrame(2);
+    CHECK(ring.GetStats().usedBytes == 872);
+    // 100の後ろに156、266の後ろに6を空ける
+    CHECK(ring.GetStats().paddingBytes == 162);
+
+    // 終わりにも先頭にも入らない
+    CHECK(ring.Allocate(200, 16) == kRingAllocationFailed);
+    CHECK(ring.GetStats().overflows == 1);
+    CHECK(ring.GetOldestFenceValue() == 1);
+
+    // フレーム1を返すと[0, 266)が空き、終わりの残りを捨てて先頭に折り返す
+    ring.Reclaim(1);
+    CHECK(ring.GetStats().usedBytes == 606);
+    CHECK(ring.Allocate(200, 16) == 0);
+    CHECK(ring.GetStats().usedBytes == 606 + (1024 - 872) + 200);
+    ring.FinishFrame(3);
+
+    ring.Reclaim(3);
+    CHECK(ring.GetStats().usedBytes == 0);
+    CHECK(ring.GetStats().framesInFlight == 0);
+    // 空になったら先頭から使い直す
+    CHECK(ring.Allocate(1024, 256) == 0);
+}
+
+TEST(RingAllocator_FullRingFailsUntilReclaimed)
+{
+    RingAllocator ring(256);
+    CHECK(ring.Allocate(256, 1) == 0);
+    CHECK(ring.Allocate(1, 1) == kRingAllocationFailed);
+    ring.FinishFrame(1);
+    CHECK(ring.Allocate(1, 1) == kRingAllocationFailed);
+    ring.Reclaim(0);
+    CHECK(ring.Allocate(1, 1) == kRingAllocationFailed);
+    ring.Reclaim(1);
+    CHECK(ring.Allocate(1, 1) == 0);
+}
+
+// 乱数の大きさで切り出し続け、GPUが使っている範囲と重ならないことを確かめる
+TEST(RingAllocator_FuzzAgainstInFlightFrames)
+{
+    constexpr uint64_t kCapacity = 64 * 1024;
+    constexpr uint32_t kFrameCount = 3;
+    std::mt19937 random(42);
+    SimulatedGpuTimeline timeline(8.0);
+    FramePacer pacer(timeline, kFrameCount);
+    RingAllocator ring(kCapacity);
+
+    // 閉じたフレームの印と、そのフレームが切り出した範囲
+    std::deque<std::pair<uint64_t, std::vector<Range>>> inFlight;
+    uint64_t allocations = 0;
+    uint64_t failures = 0;
+    for (uint32_t frame = 0; frame < 2000; ++frame) {
+        pacer.BeginFrame();
+        const uint64_t completed = timeline.GetCompletedValue();
+        ring.Reclaim(completed);
+        while (!inFlight.empty() && inFlight.front().first <= completed) {
+            inFlight.pop_front();
+        }
+
+        std::vector<Range> current;
+        const uint32_t count = random() % 64;
+        for (uint32_t i = 0; i < count; ++i) {
+            const uint64_t size = 1 + random() % 2048;
+            const uint64_t alignment = uint64_t(1) << (random() % 9);
+            const uint64_t offset = ring.Allocate(size, alignment);
+            if (offset == kRingAllocationFailed) {
+                ++failures;
+                continue;
+            }
+            ++allocations;
+            CHECK(offset % alignment == 0);
+            CHECK(offset + size <= kCapacity);
+            const Range range { offset, offset + size };
+            for (const Range& other : current) {
+                CHECK(!Overlaps(range, other));
+            }
+            for (const auto& [fenceValue, ranges] : inFlight) {
+                for (const Range& other : ranges) {
+                    CHECK(!Overlaps(range, other));
+                }
+            }
+            current.push_back(range);
+        }
+        CHECK(ring.GetStats().usedBytes <= kCapacity);
+
+        timeline.AdvanceCpu(1.0 + random() % 12);
+        const uint64_t fenceValue = pacer.EndFrame();
+        ring.FinishFrame(fenceValue);
+        inFlight.push_back({ fenceValue, std::move(current) });
+    }
+    // 1フレーム平均64KiB近くを要求するので、あふれることもある
+    CHECK(allocations > 0);
+    CHECK(failures > 0);
+    CHECK(ring.GetStats().overflows == failures);
+
+    pacer.WaitIdle();
+    ring.Reclaim(timeline.GetCompletedValue());
+    CHECK(ring.GetStats().usedBytes == 0);
+}
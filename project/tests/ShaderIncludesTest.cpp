@@ -0,0 +1,34 @@
+#include "ShaderIncludes.h"
+#include "TestFramework.h"
+
+TEST(ShaderIncludes_FindsQuotedIncludes)
+{
+    const std::vector<std::string> includes = FindShaderIncludes("#include \"Object3d.hlsli\"\n"
+                                                                 "  #  include   \"common/Light.hlsli\" // 光源\n"
+                                                                 "#include <system.hlsli>\n"
+                                                                 "float4 main() : SV_TARGET { return 0; }\n");
+    CHECK(includes.size() == 2);
+    CHECK(includes.size() == 2 && includes[0] == "Object3d.hlsli" && includes[1] == "common/Light.hlsli");
+}
+
+TEST(ShaderIncludes_SkipsComments)
+{
+    const std::vector<std::string> includes = FindShaderIncludes("// #include \"LineComment.hlsli\"\n"
+                                                                 "/* #include \"BlockComment.hlsli\"\n"
+                                                                 "#include \"StillInBlock.hlsli\" */\n"
+                                                                 "/* 前のコメント */ #include \"AfterComment.hlsli\"\n"
+                                                                 "float x; #include \"NotDirective.hlsli\"\n"
+                                                                 "static const char* s = \"#include \\\"InString.hlsli\\\"\";\n"
+                                                                 "#include \"Last.hlsli\"");
+    CHECK(includes.size() == 2);
+    CHECK(includes.size() == 2 && includes[0] == "AfterComment.hlsli" && includes[1] == "Last.hlsli");
+}
+
+TEST(ShaderIncludes_BrokenSourceDoesNotThrow)
+{
+    CHECK(FindShaderIncludes("").empty());
+    CHECK(FindShaderIncludes("#include").empty());
+    CHECK(FindShaderIncludes("#include \"Unclosed.hlsli\n").empty());
+    CHECK(FindShaderIncludes("/* 閉じていない #include \"A.hlsli\"").empty());
+    CHECK(FindShaderIncludes("\"閉じていない文字列\n#include \"A.hlsli\"").size() == 1);
+}
@@ -0,0 +1,52 @@
+#include "ShaderPermutation.h"
+#include "TestFramework.h"
+
+TEST(ShaderPermutation_EnumeratesWithRequires)
+{
+    ShaderPermutation permutation;
+    CHECK(permutation.Parse("// @keyword LIGHTING\n"
+                            "// @keyword HALF_LAMBERT requires LIGHTING\n"
+                            "float4 main() : SV_TARGET { return 0; }\n"
+                            "// @keyword ALPHA_TEST\n"));
+    // HALF_LAMBERTだけが有効な組み合わせは落ちる
+    CHECK(permutation.GetVariantCount() == 6);
+    const std::vector<ShaderPermutation::Key> expected = { 0, 1, 3, 4, 5, 7 };
+    CHECK(permutation.GetVariants() == expected);
+    CHECK(permutation.Resolve(2) == 0);
+    CHECK(permutation.Resolve(6) == 4);
+    CHECK(permutation.Resolve(0xFF) == 7);
+    CHECK(permutation.GetVariantIndex(5) == 4);
+    CHECK(permutation.GetVariantName(0) == "BASE");
+    CHECK(permutation.GetVariantName(5) == "LIGHTING+ALPHA_TEST");
+
+    const std::vector<std::wstring> defines = permutation.GetDefines(3);
+    CHECK(defines.size() == 3);
+    CHECK(defines[0] == L"LIGHTING=1" && defines[1] == L"HALF_LAMBERT=1" && defines[2] == L"ALPHA_TEST=0");
+}
+
+TEST(ShaderPermutation_ChainedRequires)
+{
+    ShaderPermutation permutation;
+    CHECK(permutation.Parse("// @keyword A\n// @keyword B requires A\n// @keyword C requires B\n"));
+    // Aが無ければBもCも落ちる
+    CHECK(permutation.Resolve(6) == 0);
+    CHECK(permutation.Resolve(5) == 1);
+    CHECK(permutation.GetVariantCount() == 4);
+}
+
+TEST(ShaderPermutation_RejectsBadDeclarations)
+{
+    ShaderPermutation permutation;
+    CHECK(!permutation.Parse("// @keyword A\n// @keyword A\n"));
+    CHECK(!permutation.Parse("// @keyword B requires A\n// @keyword A\n"));
+    CHECK(!permutation.Parse("// @keyword A needs B\n"));
+    std::string tooMany;
+    for (uint32_t i = 0; i <= ShaderPermutation::kMaxKeywords; ++i) {
+        tooMany += "// @keyword K" + std::to_string(i) + "\n";
+    }
+    CHECK(!permutation.Parse(tooMany));
+
+    // 宣言が無ければBASEだけ
+    CHECK(permutation.Parse("float4 main() : SV_TARGET { return 0; }\n"));
+    CHECK(permutation.GetVariantCount() == 1);
+}
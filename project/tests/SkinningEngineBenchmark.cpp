@@ -0,0 +1,56 @@
+#include "SkinningEngine.h"
+#include "TestFramework.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+// スレッド数を変えながら、1秒あたりにスキニングできる頂点の数を測る
+BENCHMARK(SkinningEngine_VerticesPerSecond)
+{
+    std::mt19937 random(4);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    const uint32_t kVertices = test::Scale(1000000, 20000);
+    const uint16_t kJoints = 64;
+    std::vector<SkinVertexData> vertices(kVertices);
+    for (SkinVertexData& vertex : vertices) {
+        vertex.position = { unit(random), unit(random), unit(random), 1.0f };
+        vertex.normal = { 0.0f, 0.0f, 1.0f };
+        for (int k = 0; k < 4; ++k) {
+            vertex.jointIndices[k] = static_cast<uint16_t>(random() % kJoints);
+            vertex.weights[k] = 0.25f;
+        }
+    }
+    std::vector<Matrix4x4> palette(kJoints);
+    for (Matrix4x4& m : palette) {
+        m = MakeAffineMatrix({ 1.0f, 1.0f, 1.0f }, { unit(random), unit(random), unit(random) }, { unit(random), unit(random), unit(random) });
+    }
+    std::vector<VertexData> output(kVertices);
+
+    const uint32_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    ThreadPool threadPool(hardwareThreads > 1 ? hardwareThreads - 1 : 1);
+    SkinningEngine engine(&threadPool);
+    // 1, 2, 4 ... と倍にしていき、最後に全スレッドも測る
+    std::vector<uint32_t> threadCounts;
+    for (uint32_t threads = 1; threads < engine.GetMaxThreadCount(); threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(engine.GetMaxThreadCount());
+    const uint32_t repeats = test::Scale(20, 2);
+    for (SkinningMode mode : { SkinningMode::LinearBlend, SkinningMode::DualQuaternion }) {
+        for (uint32_t threads : threadCounts) {
+            engine.SetThreadCount(threads);
+            double best = 1.0e30;
+            for (uint32_t i = 0; i < repeats; ++i) {
+                engine.Skin(vertices.data(), kVertices, palette, output.data(), mode);
+                best = std::min(best, engine.GetLastStats().milliseconds);
+            }
+            std::printf("  %s, %u threads: %u vertices in %.3f ms, %.1f M vertices/s\n", mode == SkinningMode::LinearBlend ? "linear blend" : "dual quaternion",
+                engine.GetLastStats().threadCount, kVertices, best, kVertices / best / 1000.0);
+        }
+    }
+    CHECK(std::isfinite(output[kVertices / 2].position.x));
+}
@@ -0,0 +1,129 @@
+#include "SkinningEngine.h"
+#include "TestFramework.h"
+#include "ThreadPool.h"
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+// 重みが4つに分かれたランダムな頂点
+std::vector<SkinVertexData> MakeVertices(uint32_t count, uint16_t jointCount, std::mt19937& random)
+{
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::vector<SkinVertexData> vertices(count);
+    for (SkinVertexData& vertex : vertices) {
+        vertex.position = { unit(random), unit(random), unit(random), 1.0f };
+        Vector3 normal = { unit(random), unit(random), unit(random) + 2.0f };
+        float length = std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+        vertex.normal = { normal.x / length, normal.y / length, normal.z / length };
+        vertex.texcoord = { unit(random), unit(random) };
+        float total = 0.0f;
+        for (int k = 0; k < 4; ++k) {
+            vertex.jointIndices[k] = static_cast<uint16_t>(random() % jointCount);
+            vertex.weights[k] = k < 2 || random() % 2 ? unit(random) + 1.0f : 0.0f;
+            total += vertex.weights[k];
+        }
+        for (float& weight : vertex.weights) {
+            weight /= total;
+        }
+    }
+    return vertices;
+}
+
+std::vector<Matrix4x4> MakePalette(uint16_t jointCount, std::mt19937& random)
+{
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::vector<Matrix4x4> palette(jointCount);
+    for (Matrix4x4& m : palette) {
+        m = MakeAffineMatrix({ 1.0f, 1.0f, 1.0f }, { unit(random) * 3.0f, unit(random) * 3.0f, unit(random) * 3.0f },
+            { unit(random) * 5.0f, unit(random) * 5.0f, unit(random) * 5.0f });
+    }
+    return palette;
+}
+
+Vector4 Transform4(const Vector4& v, const Matrix4x4& m)
+{
+    return {
+        v.x * m.m[0][0] + v.y * m.m[1][0] + v.z * m.m[2][0] + v.w * m.m[3][0],
+        v.x * m.m[0][1] + v.y * m.m[1][1] + v.z * m.m[2][1] + v.w * m.m[3][1],
+        v.x * m.m[0][2] + v.y * m.m[1][2] + v.z * m.m[2][2] + v.w * m.m[3][2],
+        v.x * m.m[0][3] + v.y * m.m[1][3] + v.z * m.m[2][3] + v.w * m.m[3][3],
+    };
+}
+
+} // namespace
+
+TEST(SkinningEngine_LinearBlendMatchesReference)
+{
+    std::mt19937 random(1);
+    const std::vector<SkinVertexData> vertices = MakeVertices(5000, 16, random);
+    const std::vector<Matrix4x4> palette = MakePalette(16, random);
+    ThreadPool threadPool(3);
+    SkinningEngine engine(&threadPool);
+    std::vector<VertexData> output(vertices.size());
+    engine.Skin(vertices.data(), uint32_t(vertices.size()), palette, output.data());
+
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        // 位置は各関節で変換してから重みで混ぜたものと同じ
+        Vector4 expected = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for (int k = 0; k < 4; ++k) {
+            Vector4 p = Transform4(vertices[i].position, palette[vertices[i].jointIndices[k]]);
+            expected = { expected.x + p.x * vertices[i].weights[k], expected.y + p.y * vertices[i].weights[k],
+                expected.z + p.z * vertices[i].weights[k], expected.w + p.w * vertices[i].weights[k] };
+        }
+        CHECK_NEAR(output[i].position.x, expected.x, 1.0e-4f);
+        CHECK_NEAR(output[i].position.y, expected.y, 1.0e-4f);
+        CHECK_NEAR(output[i].position.z, expected.z, 1.0e-4f);
+        CHECK_NEAR(output[i].position.w, 1.0f, 1.0e-5f);
+        const Vector3& n = output[i].normal;
+        CHECK_NEAR(n.x * n.x + n.y * n.y + n.z * n.z, 1.0f, 1.0e-4f);
+        CHECK(output[i].texcoord.x == vertices[i].texcoord.x);
+    }
+    CHECK(engine.GetLastStats().vertexCount == vertices.size());
+}
+
+TEST(SkinningEngine_ThreadCountDoesNotChangeResult)
+{
+    std::mt19937 random(2);
+    const std::vector<SkinVertexData> vertices = MakeVertices(10007, 8, random);
+    const std::vector<Matrix4x4> palette = MakePalette(8, random);
+    ThreadPool threadPool(3);
+    SkinningEngine engine(&threadPool);
+    for (SkinningMode mode : { SkinningMode::LinearBlend, SkinningMode::DualQuaternion }) {
+        std::vector<VertexData> single(vertices.size());
+        std::vector<VertexData> multi(vertices.size());
+        engine.SetThreadCount(1);
+        engine.Skin(vertices.data(), uint32_t(vertices.size()), palette, single.data(), mode);
+        CHECK(engine.GetLastStats().threadCount == 1);
+        engine.SetThreadCount(0);
+        engine.Skin(vertices.data(), uint32_t(vertices.size()), palette, multi.data(), mode);
+        CHECK(engine.GetLastStats().threadCount == 4);
+        CHECK(std::memcmp(single.data(), multi.data(), single.size() * sizeof(VertexData)) == 0);
+    }
+}
+
+TEST(SkinningEngine_DualQuaternionMatchesRigidJoints)
+{
+    // 1つの関節だけに乗った頂点は、どちらの方式でもその関節の剛体変換になる
+    std::mt19937 random(3);
+    std::vector<SkinVertexData> vertices = MakeVertices(1000, 8, random);
+    for (SkinVertexData& vertex : vertices) {
+        vertex.weights[0] = 1.0f;
+        vertex.weights[1] = vertex.weights[2] = vertex.weights[3] = 0.0f;
+    }
+    const std::vector<Matrix4x4> palette = MakePalette(8, random);
+    SkinningEngine engine;
+    std::vector<VertexData> linear(vertices.size());
+    std::vector<VertexData> dual(vertices.size());
+    engine.Skin(vertices.data(), uint32_t(vertices.size()), palette, linear.data(), SkinningMode::LinearBlend);
+    engine.Skin(vertices.data(), uint32_t(vertices.size()), palette, dual.data(), SkinningMode::DualQuaternion);
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        CHECK_NEAR(linear[i].position.x, dual[i].position.x, 1.0e-4f);
+        CHECK_NEAR(linear[i].position.y, dual[i].position.y, 1.0e-4f);
+        CHECK_NEAR(linear[i].position.z, dual[i].position.z, 1.0e-4f);
+        CHECK_NEAR(linear[i].normal.x, dual[i].normal.x, 1.0e-4f);
+        CHECK_NEAR(linear[i].normal.z, dual[i].normal.z, 1.0e-4f);
+    }
+}
@@ -0,0 +1,189 @@
+#include "SpriteAtlasBuilder.h"
+#include "TestFramework.h"
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// 画素ごとに違う色のスプライト(R=x、G=y、B=seed)
+std::vector<uint8_t> MakePixels(uint32_t width, uint32_t height, uint8_t seed)
+{
+    std::vector<uint8_t> pixels(size_t(width) * height * 4);
+    for (uint32_t y = 0; y < height; ++y) {
+        for (uint32_t x = 0; x < width; ++x) {
+            uint8_t* pixel = &pixels[(size_t(y) * width + x) * 4];
+            pixel[0] = uint8_t(x);
+            pixel[1] = uint8_t(y);
+            pixel[2] = seed;
+            pixel[3] = 255;
+        }
+    }
+    return pixels;
+}
+
+uint32_t AddSprite(SpriteAtlasBuilder& builder, uint32_t width, uint32_t height, uint8_t seed)
+{
+    std::vector<uint8_t> pixels = MakePixels(width, height, seed);
+    return builder.AddSprite(width, height, pixels.data(), width * 4);
+}
+
+const uint8_t* GetPagePixel(const SpriteAtlasBuilder& builder, uint32_t page, uint32_t x, uint32_t y)
+{
+    return &builder.GetPagePixels(page)[(size_t(y) * builder.GetPageSize() + x) * 4];
+}
+
+// ページ上のスプライトがMakePixelsの中身と一致するか
+bool MatchesSource(const SpriteAtlasBuilder& builder, uint32_t id, uint8_t seed)
+{
+    const AtlasRegion& region = builder.GetRegion(id);
+    for (uint32_t y = 0; y < region.height; ++y) {
+        for (uint32_t x = 0; x < region.width; ++x) {
+            const uint8_t* pixel = GetPagePixel(builder, region.page, region.x + x, region.y + y);
+            if (pixel[0] != uint8_t(x) || pixel[1] != uint8_t(y) || pixel[2] != seed || pixel[3] != 255) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// 同じページのスプライトが縁ごと重なっていないか
+bool Overlaps(const AtlasRegion& a, const AtlasRegion& b, uint32_t padding)
+{
+    return a.page == b.page && a.x < b.x + b.width + padding * 2 && b.x < a.x + a.width + padding * 2
+        && a.y < b.y + b.height + padding * 2 && b.y < a.y + a.height + padding * 2;
+}
+
+} // namespace
+
+TEST(SpriteAtlasBuilder_SpillsIntoMorePages)
+{
+    // 縁を含めて32x32なので、64x64のページには4つずつ入る
+    SpriteAtlasDesc desc;
+    desc.pageSize = 64;
+    desc.mipLevels = 1;
+    desc.padding = 1;
+    SpriteAtlasBuilder builder(desc);
+    std::vector<uint32_t> ids;
+    for (uint8_t i = 0; i < 8; ++i) {
+        ids.push_back(AddSprite(builder, 30, 30, i));
+    }
+    builder.Pack();
+
+    CHECK(builder.GetPageCount() == 2);
+    CHECK(builder.GetStats().spriteCount == 8);
+    for (uint32_t i = 0; i < ids.size(); ++i) {
+        CHECK(builder.IsPlaced(ids[i]));
+        CHECK(MatchesSource(builder, ids[i], uint8_t(i)));
+        for (uint32_t j = i + 1; j < ids.size(); ++j) {
+            CHECK(!Overlaps(builder.GetRegion(ids[i]), builder.GetRegion(ids[j]), desc.padding));
+        }
+    }
+
+    // 後から足したものは既存のページの空きではなく、新しいページに入る
+    const uint32_t extra = AddSprite(builder, 30, 30, 8);
+    builder.Pack();
+    CHECK(builder.GetPageCount() == 3);
+    CHECK(builder.GetRegion(extra).page == 2);
+}
+
+TEST(SpriteAtlasBuilder_AlignsToMipCells)
+{
+    // 一番粗いミップで1テクセルになる4x4に、位置と縁をそろえる
+    SpriteAtlasDesc desc;
+    desc.pageSize = 128;
+    desc.mipLevels = 3;
+    SpriteAtlasBuilder builder(desc);
+    const uint32_t sizes[][2] = { { 5, 7 }, { 13, 3 }, { 1, 1 }, { 9, 16 }, { 30, 2 } };
+    std::vector<uint32_t> ids;
+    for (const auto& size : sizes) {
+        ids.push_back(AddSprite(builder, size[0], size[1], uint8_t(ids.size())));
+    }
+    builder.Pack();
+
+    for (uint32_t i = 0; i < ids.size(); ++i) {
+        const AtlasRegion& region = builder.GetRegion(ids[i]);
+        // 縁は指定しなければセルの大きさになる
+        CHECK(region.x % 4 == 0 && region.y % 4 == 0);
+        CHECK(region.x >= 4 && region.y >= 4);
+        CHECK(region.x + region.width + 4 <= desc.pageSize && region.y + region.height + 4 <= desc.pageSize);
+        CHECK(region.width == sizes[i][0] && region.height == sizes[i][1]);
+        CHECK_NEAR(region.u0, float(region.x) / float(desc.pageSize), 1e-6f);
+        CHECK_NEAR(region.v1, float(region.y + region.height) / float(desc.pageSize), 1e-6f);
+        CHECK(MatchesSource(builder, ids[i], uint8_t(i)));
+        for (uint32_t j = i + 1; j < ids.size(); ++j) {
+            CHECK(!Overlaps(builder.GetRegion(ids[i]), builder.GetRegion(ids[j]), 4));
+        }
+    }
+}
+
+TEST(SpriteAtlasBuilder_PaddingReplicatesEdges)
+{
+    SpriteAtlasDesc desc;
+    desc.pageSize = 32;
+    desc.mipLevels = 2;
+    SpriteAtlasBuilder builder(desc);
+    const uint32_t id = AddSprite(builder, 3, 2, 7);
+    builder.Pack();
+
+    // 縁(2ピクセル)には一番近い端のピクセルが入る
+    const AtlasRegion& region = builder.GetRegion(id);
+    for (int32_t y = -2; y < int32_t(region.height) + 2; ++y) {
+        for (int32_t x = -2; x < int32_t(region.width) + 2; ++x) {
+            const uint8_t* pixel = GetPagePixel(builder, region.page, uint32_t(int32_t(region.x) + x), uint32_t(int32_t(region.y) + y));
+            const int32_t nearestX = x < 0 ? 0 : (x >= int32_t(region.width) ? int32_t(region.width) - 1 : x);
+            const int32_t nearestY = y < 0 ? 0 : (y >= int32_t(region.height) ? int32_t(region.height) - 1 : y);
+            CHECK(pixel[0] == uint8_t(nearestX) && pixel[1] == uint8_t(nearestY) && pixel[2] == 7 && pixel[3] == 255);
+        }
+    }
+    // 縁の外は何も書かない
+    CHECK(GetPagePixel(builder, region.page, region.x + region.width + 2, region.y)[3] == 0);
+}
+
+TEST(SpriteAtlasBuilder_RemoveThenRepackReclaimsPages)
+{
+    SpriteAtlasDesc desc;
+    desc.pageSize = 64;
+    desc.mipLevels = 1;
+    desc.padding = 1;
+    SpriteAtlasBuilder builder(desc);
+    std::vector<uint32_t> ids;
+    for (uint8_t i = 0; i < 8; ++i) {
+        ids.push_back(AddSprite(builder, 30, 30, i));
+    }
+    builder.Pack();
+    CHECK(builder.GetPageCount() == 2);
+    for (uint32_t page = 0; page < builder.GetPageCount(); ++page) {
+        builder.ClearDirty(page);
+    }
+
+    // 消した場所は縁ごと透明になり、そのページは書き換わった扱いになる
+    std::vector<uint32_t> kept;
+    for (uint32_t i = 0; i < ids.size(); ++i) {
+        if (i % 2 == 0) {
+            const AtlasRegion region = builder.GetRegion(ids[i]);
+            builder.RemoveSprite(ids[i]);
+            CHECK(builder.IsPageDirty(region.page));
+            CHECK(GetPagePixel(builder, region.page, region.x - 1, region.y - 1)[3] == 0);
+            CHECK(GetPagePixel(builder, region.page, region.x + region.width - 1, region.y + region.height - 1)[3] == 0);
+        } else {
+            kept.push_back(i);
+        }
+    }
+    CHECK(builder.GetStats().spriteCount == 4);
+    CHECK(builder.GetPageCount() == 2);
+
+    // 詰め直すと1ページに収まり、残したものの中身はそのまま
+    builder.Repack();
+    CHECK(builder.GetPageCount() == 1);
+    for (uint32_t i : kept) {
+        CHECK(builder.IsPlaced(ids[i]));
+        CHECK(builder.GetRegion(ids[i]).page == 0);
+        CHECK(MatchesSource(builder, ids[i], uint8_t(i)));
+    }
+
+    // 消したIDは使い回す
+    const uint32_t reused = AddSprite(builder, 4, 4, 99);
+    CHECK(reused == ids[6]);
+    CHECK(!builder.IsPlaced(reused));
+}
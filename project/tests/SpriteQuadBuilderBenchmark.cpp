@@ -0,0 +1,50 @@
+#include "SpriteQuadBuilder.h"
+#include "TestFramework.h"
+#include "ThreadPool.h"
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// たくさんのスプライトの並べ替えと、板を作る速さをスカラー/SIMDとスレッド数ごとに測る
+BENCHMARK(SpriteQuadBuilder_QuadGeneration)
+{
+    const uint32_t kSprites = test::Scale(200000, 20000);
+    const uint32_t kRepeats = test::Scale(20, 2);
+    ThreadPool threadPool;
+    SpriteQuadBuilder quads(&threadPool);
+
+    std::mt19937 random(3);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (uint32_t i = 0; i < kSprites; ++i) {
+        Sprite sprite;
+        sprite.position = { unit(random) * 1920.0f, unit(random) * 1080.0f };
+        sprite.scale = { 16.0f + unit(random) * 32.0f, 16.0f + unit(random) * 32.0f };
+        sprite.rotation = unit(random) * 6.2831853f;
+        quads.Draw(random() % 8, sprite);
+    }
+
+    double sortMilliseconds = 0.0;
+    for (uint32_t repeat = 0; repeat < kRepeats; ++repeat) {
+        quads.Sort();
+        sortMilliseconds += quads.GetLastStats().sortMilliseconds;
+    }
+    std::printf("  %u sprites in %u batches: sort %.3f ms\n", kSprites, quads.GetLastStats().batchCount, sortMilliseconds / kRepeats);
+
+    // アップロードバッファと同じく16バイトにそろえた出力
+    std::vector<SpriteVertex> vertices(size_t(kSprites) * 4 + 1);
+    SpriteVertex* output = reinterpret_cast<SpriteVertex*>((reinterpret_cast<uintptr_t>(vertices.data()) + 15) & ~uintptr_t(15));
+    for (int simd = 0; simd < 2; ++simd) {
+        quads.SetSimdEnabled(simd != 0);
+        for (uint32_t threads = 1; threads <= quads.GetMaxThreadCount(); threads *= 2) {
+            quads.SetThreadCount(threads);
+            double milliseconds = 0.0;
+            for (uint32_t repeat = 0; repeat < kRepeats; ++repeat) {
+                quads.WriteVertices(output);
+                milliseconds += quads.GetLastStats().buildMilliseconds;
+            }
+            milliseconds /= kRepeats;
+            std::printf("  %s, %u threads: %.3f ms (%.1f Msprites/s)\n", quads.GetLastStats().simd ? "SIMD" : "scalar", quads.GetLastStats().threadCount,
+                milliseconds, kSprites / (milliseconds * 1000.0));
+        }
+    }
+}
@@ -0,0 +1,113 @@
+#include "SpriteQuadBuilder.h"
+#include "TestFramework.h"
+#include "ThreadPool.h"
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+
+void DrawRandomSprites(SpriteQuadBuilder& quads, uint32_t count, uint32_t textureCount, uint32_t seed)
+{
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (uint32_t i = 0; i < count; ++i) {
+        Sprite sprite;
+        sprite.position = { unit(random) * 1280.0f, unit(random) * 720.0f };
+        sprite.scale = { 8.0f + unit(random) * 64.0f, 8.0f + unit(random) * 64.0f };
+        sprite.uvRect = { unit(random) * 0.5f, unit(random) * 0.5f, 0.5f + unit(random) * 0.5f, 0.5f + unit(random) * 0.5f };
+        // 何周も回したものも混ぜる
+        sprite.rotation = (unit(random) - 0.5f) * 40.0f;
+        sprite.color = static_cast<uint32_t>(random());
+        quads.Draw(random() % textureCount, sprite, static_cast<uint16_t>(random() % 3));
+    }
+}
+
+} // namespace
+
+TEST(SpriteQuadBuilder_GroupsByLayerThenTexture)
+{
+    SpriteQuadBuilder quads;
+    Sprite sprite;
+    quads.Draw(7, sprite, 1);
+    quads.Draw(3, sprite, 0);
+    quads.Draw(7, sprite, 0);
+    quads.Draw(3, sprite, 0);
+    quads.Draw(7, sprite, 1);
+    quads.Sort();
+
+    const std::vector<SpriteQuadBuilder::Batch>& batches = quads.GetBatches();
+    CHECK(batches.size() == 3);
+    CHECK(batches[0].textureId == 3 && batches[0].first == 0 && batches[0].count == 2);
+    CHECK(batches[1].textureId == 7 && batches[1].first == 2 && batches[1].count == 1);
+    CHECK(batches[2].textureId == 7 && batches[2].first == 3 && batches[2].count == 2);
+    CHECK(quads.GetLastStats().drawCount == 3);
+}
+
+TEST(SpriteQuadBuilder_SplitsBatchesLargerThanOneDraw)
+{
+    SpriteQuadBuilder quads;
+    Sprite sprite;
+    for (uint32_t i = 0; i < SpriteQuadBuilder::kMaxSpritesPerDraw + 1; ++i) {
+        quads.Draw(0, sprite);
+    }
+    quads.Sort();
+    CHECK(quads.GetLastStats().batchCount == 1);
+    CHECK(quads.GetLastStats().drawCount == 2);
+}
+
+TEST(SpriteQuadBuilder_WritesUnrotatedQuadCorners)
+{
+    SpriteQuadBuilder quads;
+    Sprite sprite;
+    sprite.position = { 100.0f, 50.0f };
+    sprite.scale = { 20.0f, 10.0f };
+    sprite.uvRect = { 0.25f, 0.5f, 0.75f, 1.0f };
+    sprite.color = 0x11223344;
+    quads.Draw(0, sprite);
+    quads.Sort();
+    SpriteVertex vertices[4];
+    quads.WriteVertices(vertices);
+
+    // 左上、右上、左下、右下
+    CHECK_NEAR(vertices[0].position.x, 90.0f, 1e-4f);
+    CHECK_NEAR(vertices[0].position.y, 45.0f, 1e-4f);
+    CHECK_NEAR(vertices[3].position.x, 110.0f, 1e-4f);
+    CHECK_NEAR(vertices[3].position.y, 55.0f, 1e-4f);
+    CHECK(vertices[1].texcoord.x == 0.75f && vertices[1].texcoord.y == 0.5f);
+    CHECK(vertices[2].texcoord.x == 0.25f && vertices[2].texcoord.y == 1.0f);
+    for (const SpriteVertex& vertex : vertices) {
+        CHECK(vertex.color == 0x11223344);
+    }
+}
+
+TEST(SpriteQuadBuilder_SimdAndThreadsMatchScalar)
+{
+    constexpr uint32_t kSprites = 10001;
+    ThreadPool threadPool(3);
+    SpriteQuadBuilder scalar;
+    SpriteQuadBuilder simd(&threadPool);
+    DrawRandomSprites(scalar, kSprites, 16, 5);
+    DrawRandomSprites(simd, kSprites, 16, 5);
+    scalar.SetSimdEnabled(false);
+    scalar.Sort();
+    simd.Sort();
+
+    std::vector<SpriteVertex> expected(kSprites * 4);
+    std::vector<SpriteVertex> actual(kSprites * 4);
+    scalar.WriteVertices(expected.data());
+    simd.WriteVertices(actual.data());
+    CHECK(simd.GetLastStats().threadCount > 1);
+
+    // sin/cosの近似の誤差だけ違ってよい(大きさ72ピクセル程度なら1e-3ピクセル以内)
+    float maxError = 0.0f;
+    uint32_t exactMismatches = 0;
+    for (size_t i = 0; i < expected.size(); ++i) {
+        maxError = std::max(maxError, std::fabs(expected[i].position.x - actual[i].position.x));
+        maxError = std::max(maxError, std::fabs(expected[i].position.y - actual[i].position.y));
+        exactMismatches += expected[i].texcoord.x != actual[i].texcoord.x || expected[i].texcoord.y != actual[i].texcoord.y
+            || expected[i].color != actual[i].color;
+    }
+    CHECK(maxError < 1e-3f);
+    CHECK(exactMismatches == 0);
+}
@@ -0,0 +1,100 @@
+#include "Hash.h"
+#include "TestFramework.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// 読み込み、ハッシュ、デコード、ミップ生成をTextureManager::DecodePendingと同じ順に行う
+// (WICとGenerateMipMapsはWindowsにしか無いので、RGBA8をfloatに直してボックスフィルタで縮める)
+uint64_t DecodeWithMips(const std::string& path, uint32_t size)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::vector<uint8_t> bytes(size_t(size) * size * 4);
+    file.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+    uint64_t checksum = HashBytes(bytes.data(), bytes.size());
+
+    std::vector<float> mip(bytes.begin(), bytes.end());
+    for (float& value : mip) {
+        value *= 1.0f / 255.0f;
+    }
+    std::vector<float> next;
+    for (uint32_t width = size; width > 1; width /= 2) {
+        const uint32_t half = width / 2;
+        next.resize(size_t(half) * half * 4);
+        for (uint32_t y = 0; y < half; ++y) {
+            for (uint32_t x = 0; x < half; ++x) {
+                for (uint32_t c = 0; c < 4; ++c) {
+                    const size_t top = (size_t(y) * 2 * width + x * 2) * 4 + c;
+                    const size_t bottom = top + size_t(width) * 4;
+                    next[(size_t(y) * half + x) * 4 + c] = (mip[top] + mip[top + 4] + mip[bottom] + mip[bottom + 4]) * 0.25f;
+                }
+            }
+        }
+        mip.swap(next);
+    }
+    return checksum ^ static_cast<uint64_t>(mip[0] * 65535.0f);
+}
+
+} // namespace
+
+// ワーカー数を変えながら、起動から最初のフレームまでの時間を測る
+// メインスレッドはデバイス作成とシェーダーコンパイルの代わりに決まった時間だけ待ち、その間にワーカーがテクスチャを処理する
+BENCHMARK(Startup_TimeToFirstFrame)
+{
+    test::TemporaryDirectory directory;
+    std::mt19937 random(6);
+    const uint32_t kTextures = test::Scale(48, 6);
+    const uint32_t kSize = test::Scale(1024, 64);
+    const std::chrono::milliseconds kDeviceSetup(test::Scale(30, 2));
+    std::vector<std::string> paths;
+    for (uint32_t i = 0; i < kTextures; ++i) {
+        std::string pixels(size_t(kSize) * kSize * 4, '\0');
+        for (char& c : pixels) {
+            c = static_cast<char>(random());
+        }
+        paths.push_back(directory.Write("texture" + std::to_string(i) + ".rgba", pixels));
+    }
+
+    // 以前の流れ: デバイスなどを作ってからメインスレッドで1枚ずつ処理する
+    std::chrono::steady_clock::time_point serialBegin = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(kDeviceSetup);
+    uint64_t serialChecksum = 0;
+    for (const std::string& path : paths) {
+        serialChecksum ^= DecodeWithMips(path, kSize);
+    }
+    const double serialMilliseconds = test::ElapsedMilliseconds(serialBegin);
+    std::printf("  serial: %u textures (%ux%u) in %.2f ms\n", kTextures, kSize, kSize, serialMilliseconds);
+
+    // 1, 2, 4 ... と倍にしていき、最後に全スレッドも測る
+    const uint32_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    const uint32_t maxWorkers = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    std::vector<uint32_t> workerCounts;
+    for (uint32_t workers = 1; workers < maxWorkers; workers *= 2) {
+        workerCounts.push_back(workers);
+    }
+    workerCounts.push_back(maxWorkers);
+    for (uint32_t workers : workerCounts) {
+        ThreadPool threadPool(workers);
+        std::atomic<uint64_t> checksum = 0;
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        for (const std::string& path : paths) {
+            threadPool.Enqueue([&checksum, &path, kSize] { checksum ^= DecodeWithMips(path, kSize); });
+        }
+        std::this_thread::sleep_for(kDeviceSetup);
+        const double setupMilliseconds = test::ElapsedMilliseconds(begin);
+        threadPool.WaitIdle();
+        const double firstFrameMilliseconds = test::ElapsedMilliseconds(begin);
+        std::printf("  %u workers: first frame %.2f ms (setup %.2f ms, wait texture decode %.2f ms), x%.2f\n",
+            workers, firstFrameMilliseconds, setupMilliseconds, firstFrameMilliseconds - setupMilliseconds, serialMilliseconds / firstFrameMilliseconds);
+        CHECK(checksum == serialChecksum);
+    }
+}
@@ -0,0 +1,108 @@
+#include "TestFramework.h"
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <random>
+
+namespace test {
+
+namespace {
+
+std::atomic<uint32_t> failureCount { 0 };
+std::mutex printMutex;
+bool quick = false;
+
+} // namespace
+
+std::vector<Case>& GetTests()
+{
+    static std::vector<Case> cases;
+    return cases;
+}
+
+std::vector<Case>& GetBenchmarks()
+{
+    static std::vector<Case> cases;
+    return cases;
+}
+
+void ReportFailure(const char* file, int line, const char* expression)
+{
+    failureCount.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(printMutex);
+    std::printf("    %s:%d: CHECK(%s) failed\n", file, line, expression);
+    std::fflush(stdout);
+}
+
+uint32_t GetFailureCount()
+{
+    return failureCount.load(std::memory_order_relaxed);
+}
+
+int RunCases(const std::vector<Case>& cases, const std::string& filter)
+{
+    int failedCases = 0;
+    int runCases = 0;
+    for (const Case& c : cases) {
+        if (!filter.empty() && std::string(c.name).find(filter) == std::string::npos) {
+            continue;
+        }
+        std::printf("[ RUN  ] %s\n", c.name);
+        std::fflush(stdout);
+        const uint32_t failuresBefore = GetFailureCount();
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        c.function();
+        const bool passed = GetFailureCount() == failuresBefore;
+        std::printf("[ %s ] %s (%.1f ms)\n", passed ? " OK " : "FAIL", c.name, ElapsedMilliseconds(start));
+        std::fflush(stdout);
+        failedCases += passed ? 0 : 1;
+        ++runCases;
+    }
+    std::printf("%d of %d passed\n", runCases - failedCases, runCases);
+    return failedCases;
+}
+
+bool IsQuick()
+{
+    return quick;
+}
+
+void SetQuick(bool value)
+{
+    quick = value;
+}
+
+uint32_t Scale(uint32_t full, uint32_t quickValue)
+{
+    return quick ? quickValue : full;
+}
+
+double ElapsedMilliseconds(std::chrono::steady_clock::time_point from)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - from).count();
+}
+
+TemporaryDirectory::TemporaryDirectory()
+{
+    std::random_device random;
+    path_ = std::filesystem::temp_directory_path() / ("engin_test_" + std::to_string(random()));
+    std::filesystem::create_directories(path_);
+}
+
+TemporaryDirectory::~TemporaryDirectory()
+{
+    std::error_code error;
+    std::filesystem::remove_all(path_, error);
+}
+
+std::string TemporaryDirectory::Write(const std::string& name, const std::string& contents) const
+{
+    const std::filesystem::path filePath = path_ / name;
+    std::filesystem::create_directories(filePath.parent_path());
+    std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+    file.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+    return filePath.string();
+}
+
+} // namespace test
@@ -0,0 +1,74 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// GPUを使わない部品をLinuxでも確かめるための小さなテストの枠組み
+// TEST(名前) { ... } でテストを、BENCHMARK(名前) { ... } でベンチマークを登録する
+namespace test {
+
+struct Case {
+    const char* name;
+    void (*function)();
+};
+
+std::vector<Case>& GetTests();
+std::vector<Case>& GetBenchmarks();
+
+struct Registrar {
+    Registrar(std::vector<Case>& cases, const char* name, void (*function)()) { cases.push_back({ name, function }); }
+};
+
+// 失敗を記録してテストは続ける(ワーカースレッドから呼んでもよい)
+void ReportFailure(const char* file, int line, const char* expression);
+uint32_t GetFailureCount();
+// filterが空でなければ、名前にそれを含むものだけを走らせる。戻り値は失敗したケースの数
+int RunCases(const std::vector<Case>& cases, const std::string& filter);
+
+// ベンチマークを短く回す(ctestから動くことだけを確かめる)ときtrue
+bool IsQuick();
+void SetQuick(bool quick);
+// 短く回すときはquickを、そうでなければfullを返す
+uint32_t Scale(uint32_t full, uint32_t quick);
+
+double ElapsedMilliseconds(std::chrono::steady_clock::time_point from);
+
+// テスト用の一時ディレクトリ。破棄するときに中身ごと消す
+class TemporaryDirectory {
+public:
+    TemporaryDirectory();
+    ~TemporaryDirectory();
+
+    TemporaryDirectory(const TemporaryDirectory&) = delete;
+    TemporaryDirectory& operator=(const TemporaryDirectory&) = delete;
+
+    const std::filesystem::path& GetPath() const { return path_; }
+    // ファイルを書いてそのパスを返す
+    std::string Write(const std::string& name, const std::string& contents) const;
+
+private:
+    std::filesystem::path path_;
+};
+
+} // namespace test
+
+#define TEST(name)                                                                \
+    static void name();                                                           \
+    static ::test::Registrar name##Registrar(::test::GetTests(), #name, name);    \
+    static void name()
+
+#define BENCHMARK(name)                                                              \
+    static void name();                                                              \
+    static ::test::Registrar name##Registrar(::test::GetBenchmarks(), #name, name);  \
+    static void name()
+
+#define CHECK(expression)                                             \
+    do {                                                              \
+        if (!(expression)) {                                          \
+            ::test::ReportFailure(__FILE__, __LINE__, #expression);   \
+        }                                                             \
+    } while (0)
+
+#define CHECK_NEAR(a, b, tolerance) CHECK(((a) > (b) ? (a) - (b) : (b) - (a)) <= (tolerance))
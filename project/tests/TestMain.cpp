@@ -0,0 +1,7 @@
+#include "TestFramework.h"
+
+// 使い方: EnginTests [名前に含まれる文字列]
+int main(int argc, char** argv)
+{
+    return test::RunCases(test::GetTests(), argc > 1 ? argv[1] : "") == 0 ? 0 : 1;
+}
@@ -0,0 +1,100 @@
+#include "TestFramework.h"
+#include "TextureCache.h"
+
+namespace {
+
+bool AlwaysSame(TextureHandle) { return true; }
+
+} // namespace
+
+TEST(TextureCache_NormalizePath)
+{
+    CHECK(TextureCache::NormalizePath("Resources\\Textures\\.\\A.PNG") == "resources/textures/a.png");
+    CHECK(TextureCache::NormalizePath("resources/x/../b.png") == "resources/b.png");
+    CHECK(TextureCache::NormalizePath("../b.png") == "../b.png");
+    CHECK(TextureCache::NormalizePath("/abs//c.png") == "/abs/c.png");
+}
+
+TEST(TextureCache_HitsCountAsSavedBytes)
+{
+    TextureCache cache;
+    const TextureHandle handle = cache.Insert("a.png", 1, 1000);
+    CHECK(cache.GetStats().bytesSaved == 0);
+    // 同じパスの再要求も読み込まずに済んだ分になる
+    CHECK(cache.AcquireByPath("a.png") == handle);
+    CHECK(cache.AcquireByPath("a.png") == handle);
+    CHECK(cache.GetStats().pathHits == 2);
+    CHECK(cache.GetStats().bytesSaved == 2000);
+    CHECK(cache.GetRefCount(handle) == 3);
+
+    // 別のパスで中身が同じもの
+    CHECK(cache.AcquireByContent("b.png", 1, AlwaysSame) == handle);
+    CHECK(cache.GetStats().contentHits == 1);
+    CHECK(cache.GetStats().bytesSaved == 3000);
+    CHECK(cache.AcquireByPath("b.png") == handle);
+    CHECK(cache.GetStats().bytesSaved == 4000);
+}
+
+TEST(TextureCache_HashCollisionIsNotShared)
+{
+    TextureCache cache;
+    const TextureHandle first = cache.Insert("a.png", 7, 100);
+    // ハッシュは同じでも、中身を比べて違えば共有しない
+    CHECK(cache.AcquireByContent("b.png", 7, [](TextureHandle) { return false; }) == kInvalidTextureHandle);
+    CHECK(cache.GetStats().contentHits == 0);
+    CHECK(cache.GetRefCount(first) == 1);
+
+    // 衝突した方も登録でき、それぞれの中身で見つかる
+    const TextureHandle second = cache.Insert("b.png", 7, 200);
+    CHECK(second != first);
+    CHECK(cache.AcquireByContent("c.png", 7, [&](TextureHandle candidate) { return candidate == second; }) == second);
+    CHECK(cache.AcquireByContent("d.png", 7, [&](TextureHandle candidate) { return candidate == first; }) == first);
+
+    // 片方を消しても、もう片方は中身で見つかる
+    CHECK(!cache.Release(first));
+    CHECK(cache.Release(first));
+    CHECK(cache.AcquireByContent("e.png", 7, AlwaysSame) == second);
+}
+
+TEST(TextureCache_ReleaseReusesHandles)
+{
+    TextureCache cache;
+    const TextureHandle a = cache.Insert("a.png", 1, 10);
+    const TextureHandle b = cache.Insert("b.png", 2, 20);
+    CHECK(cache.GetStats().residentBytes == 30);
+    CHECK(cache.Release(a));
+    CHECK(!cache.IsValid(a));
+    CHECK(!cache.ContainsPath("a.png"));
+    CHECK(cache.AcquireByContent("x.png", 1, AlwaysSame) == kInvalidTextureHandle);
+    CHECK(cache.GetStats().residentBytes == 20);
+
+    const TextureHandle c = cache.Insert("c.png", 3, 30);
+    CHECK(c == a);
+    CHECK(cache.GetCapacity() == 2);
+    CHECK(cache.IsValid(b) && cache.IsValid(c));
+}
+
+TEST(TextureCache_UpdateContentMovesHash)
+{
+    TextureCache cache;
+    const TextureHandle handle = cache.Insert("a.png", 1, 10);
+    cache.UpdateContent(handle, 2, 40);
+    CHECK(cache.GetStats().residentBytes == 40);
+    CHECK(cache.AcquireByContent("b.png", 1, AlwaysSame) == kInvalidTextureHandle);
+    CHECK(cache.AcquireByContent("b.png", 2, AlwaysSame) == handle);
+}
+
+#ifdef NDEBUG
+// 無効なハンドルはassertで止まるので、assertの無いビルドで壊れないことだけ確かめる
+TEST(TextureCache_ReleaseInvalidHandleIsIgnored)
+{
+    TextureCache cache;
+    CHECK(!cache.Release(kInvalidTextureHandle));
+    CHECK(!cache.Release(5));
+    const TextureHandle handle = cache.Insert("a.png", 1, 10);
+    CHECK(cache.Release(handle));
+    CHECK(!cache.Release(handle));
+    CHECK(cache.GetStats().uniqueTextures == 0);
+    CHECK(cache.GetStats().residentBytes == 0);
+}
+#endif
@@ -0,0 +1,175 @@
+#include "TestFramework.h"
+#include "TextureResidency.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+// 1024x1024 RGBA8 のミップ(11段)
+std::vector<uint64_t> MakeMipBytes()
+{
+    std::vector<uint64_t> mipBytes;
+    for (uint64_t size = 1024; size >= 1; size /= 2) {
+        mipBytes.push_back(size * size * 4);
+    }
+    return mipBytes;
+}
+
+// 直線上に並んだ物体の横をカメラが通り過ぎる
+struct CameraPathScene {
+    static constexpr uint32_t kObjects = 64;
+    static constexpr float kSpacing = 10.0f;
+    static constexpr float kRadius = 2.0f;
+    static constexpr float kFovY = 0.8f;
+    static constexpr float kScreenHeight = 1080.0f;
+
+    TextureResidency residency;
+    std::vector<uint64_t> mipBytes = MakeMipBytes();
+    std::vector<uint32_t> ids;
+
+    explicit CameraPathScene(uint32_t alwaysResidentMip)
+    {
+        for (uint32_t i = 0; i < kObjects; ++i) {
+            ids.push_back(residency.AddTexture(mipBytes, alwaysResidentMip));
+        }
+    }
+
+    // カメラはx軸上、物体は横に3だけずれた位置に並ぶ
+    uint32_t RequiredMip(uint32_t object, float cameraX) const
+    {
+        const float dx = object * kSpacing - cameraX;
+        const float distance = std::sqrt(dx * dx + 9.0f);
+        const float pixels = TextureResidency::ProjectSphereToPixels(kRadius, distance, kFovY, kScreenHeight);
+        return TextureResidency::EstimateMip(1024.0f, pixels, static_cast<uint32_t>(mipBytes.size()));
+    }
+
+    uint64_t ResidentBytesOf(uint32_t id) const
+    {
+        uint64_t bytes = 0;
+        for (uint32_t mip = residency.GetResidentMip(id); mip < mipBytes.size(); ++mip) {
+            bytes += mipBytes[mip];
+        }
+        return bytes;
+    }
+};
+
+} // namespace
+
+TEST(TextureResidency_EstimateMip)
+{
+    CHECK(TextureResidency::EstimateMip(1024.0f, 1024.0f, 11) == 0);
+    CHECK(TextureResidency::EstimateMip(1024.0f, 2048.0f, 11) == 0);
+    CHECK(TextureResidency::EstimateMip(1024.0f, 512.0f, 11) == 1);
+    CHECK(TextureResidency::EstimateMip(1024.0f, 100.0f, 11) == 3);
+    CHECK(TextureResidency::EstimateMip(1024.0f, 0.0f, 11) == 10);
+    CHECK(TextureResidency::EstimateMip(1024.0f, 0.5f, 11) == 10);
+    CHECK(TextureResidency::ProjectSphereToPixels(1.0f, 0.5f, 0.8f, 1080.0f) == 1080.0f);
+}
+
+TEST(TextureResidency_CameraPathStaysInBudget)
+{
+    CameraPathScene scene(6);
+    const uint64_t kBudget = 24ull << 20;
+    const uint64_t kMaxPerUpdate = 4ull << 20;
+    scene.residency.SetBudget(kBudget);
+    scene.residency.SetMaxStreamBytesPerUpdate(kMaxPerUpdate);
+
+    uint32_t satisfiedFrames = 0;
+    uint64_t frame = 0;
+    for (float cameraX = -20.0f; cameraX < CameraPathScene::kObjects * CameraPathScene::kSpacing; cameraX += 0.5f) {
+        ++frame;
+        // 前後30以内の物体だけが見えている
+        for (uint32_t i = 0; i < CameraPathScene::kObjects; ++i) {
+            if (std::fabs(i * CameraPathScene::kSpacing - cameraX) < 30.0f) {
+                scene.residency.Request(scene.ids[i], scene.RequiredMip(i, cameraX), frame);
+            }
+        }
+        const std::vector<ResidencyChange> changes = scene.residency.Update(frame);
+        const TextureResidencyStats& stats = scene.residency.GetStats();
+
+        CHECK(stats.residentBytes <= kBudget);
+        // 1回の読み込み量は上限を超えない(1段目が上限より大きい場合だけは1段読む)
+        CHECK(stats.streamedBytes <= std::max(kMaxPerUpdate, scene.mipBytes[0]));
+
+        uint64_t residentBytes = 0;
+        for (uint32_t id : scene.ids) {
+            residentBytes += scene.ResidentBytesOf(id);
+            // 常に載せておくミップは追い出されない
+            CHECK(scene.residency.GetResidentMip(id) <= 6);
+        }
+        CHECK(residentBytes == stats.residentBytes);
+        for (const ResidencyChange& change : changes) {
+            CHECK(change.fromMip != change.toMip);
+            CHECK(scene.residency.GetResidentMip(change.id) == change.toMip);
+        }
+
+        // 一番近い物体は数フレームで要求したミップまで載る
+        const uint32_t nearest = static_cast<uint32_t>(std::lround(std::max(cameraX, 0.0f) / CameraPathScene::kSpacing));
+        if (nearest < CameraPathScene::kObjects && scene.residency.GetResidentMip(scene.ids[nearest]) <= scene.RequiredMip(nearest, cameraX)) {
+            ++satisfiedFrames;
+        }
+    }
+    CHECK(satisfiedFrames > frame * 9 / 10);
+}
+
+TEST(TextureResidency_StationaryCameraStopsStreaming)
+{
+    CameraPathScene scene(6);
+    scene.residency.SetBudget(64ull << 20);
+    scene.residency.SetMaxStreamBytesPerUpdate(2ull << 20);
+    const float cameraX = 100.0f;
+    uint64_t lastTotal = 0;
+    for (uint64_t frame = 1; frame <= 200; ++frame) {
+        for (uint32_t i = 0; i < CameraPathScene::kObjects; ++i) {
+            scene.residency.Request(scene.ids[i], scene.RequiredMip(i, cameraX), frame);
+        }
+        scene.residency.Update(frame);
+        if (frame == 150) {
+            lastTotal = scene.residency.GetStats().totalStreamedBytes;
+        }
+    }
+    // 落ち着いた後は読み込みも追い出しも起きない
+    CHECK(scene.residency.GetStats().totalStreamedBytes == lastTotal);
+    CHECK(scene.residency.GetStats().evictedMips == 0);
+    for (uint32_t i = 0; i < CameraPathScene::kObjects; ++i) {
+        CHECK(scene.residency.GetResidentMip(scene.ids[i]) == scene.RequiredMip(i, cameraX));
+    }
+}
+
+TEST(TextureResidency_LoweredBudgetEvictsLeastRecentlyUsed)
+{
+    CameraPathScene scene(6);
+    scene.residency.SetBudget(1ull << 30);
+    // 0番を先に、1番を後で使う
+    scene.residency.Request(scene.ids[0], 0, 1);
+    scene.residency.Update(1);
+    scene.residency.Request(scene.ids[1], 0, 2);
+    scene.residency.Update(2);
+    CHECK(scene.residency.GetResidentMip(scene.ids[0]) == 0);
+    CHECK(scene.residency.GetResidentMip(scene.ids[1]) == 0);
+
+    // 1番だけが全部載る予算に下げると、長く使われていない0番から落とす
+    const uint64_t floorBytes = scene.ResidentBytesOf(scene.ids[2]);
+    const uint64_t budget = floorBytes * (CameraPathScene::kObjects - 1) + scene.ResidentBytesOf(scene.ids[1]);
+    scene.residency.SetBudget(budget);
+    scene.residency.Update(3);
+    CHECK(scene.residency.GetResidentMip(scene.ids[0]) == 6);
+    CHECK(scene.residency.GetResidentMip(scene.ids[1]) == 0);
+    CHECK(scene.residency.GetStats().residentBytes == budget);
+}
+
+TEST(TextureResidency_RemoveReturnsBytes)
+{
+    CameraPathScene scene(6);
+    scene.residency.SetBudget(1ull << 30);
+    const uint64_t before = scene.residency.GetStats().residentBytes;
+    scene.residency.Request(scene.ids[5], 2, 1);
+    scene.residency.Update(1);
+    CHECK(scene.residency.GetResidentMip(scene.ids[5]) == 2);
+    scene.residency.RemoveTexture(scene.ids[5]);
+    CHECK(scene.residency.GetStats().residentBytes == before - scene.ResidentBytesOf(scene.ids[6]));
+    // 空いた番号は使い回す
+    CHECK(scene.residency.AddTexture(scene.mipBytes, 6) == scene.ids[5]);
+    CHECK(scene.residency.GetStats().residentBytes == before);
+}
@@ -0,0 +1,56 @@
+#include "TestFramework.h"
+#include "TlsfAllocator.h"
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// 確保と解放を混ぜたときの1回あたりの時間と、そのときの断片化を測る
+BENCHMARK(TlsfAllocator_AllocFree)
+{
+    constexpr uint64_t kCapacity = 256ull << 20;
+    const uint32_t kOperations = test::Scale(4000000, 100000);
+    std::mt19937_64 random(7);
+    // 乱数は先に作り、測る時間に含めない
+    struct Operation {
+        uint64_t size;
+        uint64_t alignment;
+        uint32_t pick;
+    };
+    std::vector<Operation> operations(kOperations);
+    for (Operation& operation : operations) {
+        operation.size = random() % 8 == 0 ? 64 * 1024 + random() % (1ull << 20) : 256 + random() % 16384;
+        operation.alignment = random() % 4 == 0 ? 65536 : 256;
+        operation.pick = static_cast<uint32_t>(random());
+    }
+
+    TlsfAllocator allocator(kCapacity);
+    std::vector<TlsfAllocation> live;
+    live.reserve(1 << 16);
+    uint32_t failures = 0;
+    uint64_t allocations = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (const Operation& operation : operations) {
+        // 使用率が半分ほどで落ち着くように、大きさに応じて確保と解放を選ぶ
+        const bool allocate = live.empty() || (allocator.GetStats().occupancy < 0.5f ? operation.pick % 4 != 0 : operation.pick % 4 == 0);
+        if (allocate) {
+            const TlsfAllocation allocation = allocator.Allocate(operation.size, operation.alignment);
+            if (allocation.IsValid()) {
+                live.push_back(allocation);
+                ++allocations;
+            } else {
+                ++failures;
+            }
+        } else {
+            const size_t index = operation.pick % live.size();
+            allocator.Free(live[index]);
+            live[index] = live.back();
+            live.pop_back();
+        }
+    }
+    const double milliseconds = test::ElapsedMilliseconds(start);
+    const TlsfAllocatorStats stats = allocator.GetStats();
+    std::printf("  %u operations (%llu allocations, %u failed) in %.2f ms, %.1f ns/operation\n", kOperations,
+        static_cast<unsigned long long>(allocations), failures, milliseconds, milliseconds * 1.0e6 / kOperations);
+    std::printf("  occupancy %.2f, %u free blocks, fragmentation %.3f\n", stats.occupancy, stats.freeBlockCount, stats.fragmentation);
+    CHECK(stats.allocationCount == live.size());
+}
@@ -0,0 +1,170 @@
+#include "TestFramework.h"
+#include "TlsfAllocator.h"
+#include <iterator>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace {
+
+// 確保した範囲を覚えておき、重なりと合計を確かめる
+class AllocationTracker {
+public:
+    void Add(const TlsfAllocation& allocation)
+    {
+        auto next = ranges_.lower_bound(allocation.offset);
+        if (next != ranges_.end()) {
+            CHECK(allocation.offset + allocation.size <= next->first);
+        }
+        if (next != ranges_.begin()) {
+            CHECK(std::prev(next)->first + std::prev(next)->second.size <= allocation.offset);
+        }
+        ranges_[allocation.offset] = allocation;
+        usedBytes_ += allocation.size;
+    }
+    void Remove(const TlsfAllocation& allocation)
+    {
+        CHECK(ranges_.erase(allocation.offset) == 1);
+        usedBytes_ -= allocation.size;
+    }
+
+    uint64_t GetUsedBytes() const { return usedBytes_; }
+    const std::map<uint64_t, TlsfAllocation>& GetRanges() const { return ranges_; }
+
+private:
+    std::map<uint64_t, TlsfAllocation> ranges_;
+    uint64_t usedBytes_ = 0;
+};
+
+} // namespace
+
+TEST(TlsfAllocator_AllocatesAlignedAndCoalesces)
+{
+    TlsfAllocator allocator(1 << 20);
+    const TlsfAllocation a = allocator.Allocate(1000, 256);
+    const TlsfAllocation b = allocator.Allocate(3000, 65536);
+    const TlsfAllocation c = allocator.Allocate(1, 1);
+    CHECK(a.IsValid() && b.IsValid() && c.IsValid());
+    CHECK(a.offset == 0 && a.size == 1024);
+    CHECK(b.offset % 65536 == 0 && b.size == 3072);
+    CHECK(c.size == 256);
+    CHECK(allocator.GetStats().allocationCount == 3);
+
+    // 真ん中を先に返し、最後に両隣とまとまって1つに戻る
+    allocator.Free(b);
+    allocator.Free(a);
+    allocator.Free(c);
+    const TlsfAllocatorStats stats = allocator.GetStats();
+    CHECK(allocator.IsEmpty());
+    CHECK(stats.freeBlockCount == 1);
+    CHECK(stats.largestFreeBlock == allocator.GetCapacity());
+    CHECK(stats.fragmentation == 0.0f);
+}
+
+TEST(TlsfAllocator_FailsWhenFullAndFitsExactly)
+{
+    TlsfAllocator allocator(4096);
+    CHECK(!allocator.Allocate(8192, 256).IsValid());
+    const TlsfAllocation whole = allocator.Allocate(4096, 4096);
+    CHECK(whole.IsValid() && whole.offset == 0);
+    CHECK(!allocator.Allocate(1, 1).IsValid());
+    allocator.Free(whole);
+
+    // 空きがアラインメントの分だけ大きくなくても、先頭がそろっていれば入る
+    const TlsfAllocation front = allocator.Allocate(2048, 256);
+    const TlsfAllocation back = allocator.Allocate(2048, 2048);
+    CHECK(front.IsValid() && back.IsValid() && back.offset == 2048);
+}
+
+// 乱数の大きさとアラインメントで確保と解放を繰り返し、重なり、アラインメント、解放後のまとまりを確かめる
+TEST(TlsfAllocator_Fuzz)
+{
+    constexpr uint64_t kCapacity = 64ull << 20;
+    for (uint32_t seed = 1; seed <= 8; ++seed) {
+        std::mt19937_64 random(seed);
+        TlsfAllocator allocator(kCapacity);
+        AllocationTracker tracker;
+        std::vector<TlsfAllocation> live;
+        uint32_t failures = 0;
+        for (uint32_t step = 0; step < 20000; ++step) {
+            // 確保を少し多めにして、埋まった状態での失敗も通す
+            if (live.empty() || random() % 100 < 55) {
+                // 小さいものが多く、たまに大きいもの
+                const uint64_t size = random() % 8 == 0 ? 1 + random() % (4ull << 20) : 1 + random() % 65536;
+                const uint64_t alignment = uint64_t(1) << (random() % 17);
+                const TlsfAllocation allocation = allocator.Allocate(size, alignment);
+                if (!allocation.IsValid()) {
+                    ++failures;
+                    continue;
+                }
+                CHECK(allocation.offset % alignment == 0);
+                CHECK(allocation.offset % 256 == 0);
+                CHECK(allocation.size >= size);
+                CHECK(allocation.offset + allocation.size <= kCapacity);
+                tracker.Add(allocation);
+                live.push_back(allocation);
+            } else {
+                const size_t index = random() % live.size();
+                allocator.Free(live[index]);
+                tracker.Remove(live[index]);
+                live[index] = live.back();
+                live.pop_back();
+            }
+            if (step % 1000 == 0) {
+                const TlsfAllocatorStats stats = allocator.GetStats();
+                CHECK(stats.usedBytes == tracker.GetUsedBytes());
+                CHECK(stats.allocationCount == live.size());
+                CHECK(stats.largestFreeBlock <= stats.freeBytes);
+            }
+        }
+        CHECK(failures > 0);
+
+        // 全部返すと1つの空きに戻る
+        while (!live.empty()) {
+            const size_t index = random() % live.size();
+            allocator.Free(live[index]);
+            live[index] = live.back();
+            live.pop_back();
+        }
+        const TlsfAllocatorStats stats = allocator.GetStats();
+        CHECK(allocator.IsEmpty());
+        CHECK(stats.freeBlockCount == 1);
+        CHECK(stats.largestFreeBlock == kCapacity);
+        CHECK(allocator.Allocate(kCapacity, 1).IsValid());
+    }
+}
+
+TEST(TlsfAllocator_DefragmentMovesToFront)
+{
+    TlsfAllocator allocator(1 << 20, 1024);
+    AllocationTracker tracker;
+    std::vector<TlsfAllocation> allocations;
+    for (uint32_t i = 0; i < 64; ++i) {
+        allocations.push_back(allocator.Allocate(8192, 1024));
+    }
+    // 前半の偶数番目を返して穴を空ける
+    for (uint32_t i = 0; i < 32; i += 2) {
+        allocator.Free(allocations[i]);
+    }
+    for (uint32_t i = 0; i < 64; ++i) {
+        if (i >= 32 || i % 2 == 1) {
+            tracker.Add(allocations[i]);
+        }
+    }
+    const float before = allocator.GetStats().fragmentation;
+
+    std::vector<TlsfAllocation> moved;
+    const uint32_t moves = allocator.Defragment(8, [&](const TlsfAllocation& from, const TlsfAllocation& to) {
+        CHECK(to.offset < from.offset);
+        CHECK(to.size == from.size);
+        moved.push_back(from);
+        return true;
+    });
+    CHECK(moves == 8);
+    // 移した元は呼び出し側が返す
+    for (const TlsfAllocation& from : moved) {
+        allocator.Free(from);
+    }
+    CHECK(allocator.GetStats().allocationCount == 48);
+    CHECK(allocator.GetStats().fragmentation < before);
+}
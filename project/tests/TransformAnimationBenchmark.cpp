@@ -0,0 +1,36 @@
+#include "TestFramework.h"
+#include "TransformAnimation.h"
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// 1万個(とその4倍)のオブジェクトを毎フレームまとめてサンプリングする
+BENCHMARK(TransformAnimation_Sample)
+{
+    std::mt19937 random(3);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    for (uint32_t objects : { test::Scale(10000, 1000), test::Scale(40000, 2000) }) {
+        std::vector<TransformTrack> tracks(objects);
+        for (TransformTrack& track : tracks) {
+            for (int key = 0; key <= 8; ++key) {
+                const float time = float(key) * 0.5f;
+                track.translate.push_back({ time, { unit(random), unit(random), unit(random) } });
+                track.rotate.push_back({ time, { unit(random), unit(random), unit(random) } });
+                track.scale.push_back({ time, { 1.0f + unit(random) * 0.1f, 1.0f, 1.0f } });
+            }
+        }
+        TransformAnimation animation;
+        animation.Build(tracks);
+
+        std::vector<Transform> output(objects);
+        const uint32_t frames = test::Scale(600, 10);
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (uint32_t frame = 0; frame < frames; ++frame) {
+            animation.Sample(float(frame) / 60.0f, output.data());
+        }
+        const double milliseconds = test::ElapsedMilliseconds(start);
+        CHECK(std::isfinite(output[objects / 2].rotate.y));
+        std::printf("  %u objects: %.3f ms/frame, %.1f M objects/s, keys %.1f KiB\n", objects, milliseconds / frames,
+            double(objects) * frames / milliseconds / 1000.0, animation.GetKeyBytes() / 1024.0);
+    }
+}
@@ -0,0 +1,149 @@
+#include "TestFramework.h"
+#include "TransformAnimation.h"
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr float kPi = 3.14159265358979f;
+
+// 回転を含めた見た目が同じかを行列で比べる(オイラー角は表し方が1つではない)
+float MatrixDifference(const Transform& a, const Transform& b)
+{
+    Matrix4x4 ma = MakeAffineMatrix(a.scale, a.rotate, a.translate);
+    Matrix4x4 mb = MakeAffineMatrix(b.scale, b.rotate, b.translate);
+    float difference = 0.0f;
+    for (int row = 0; row < 4; ++row) {
+        for (int column = 0; column < 4; ++column) {
+            difference = std::max(difference, std::abs(ma.m[row][column] - mb.m[row][column]));
+        }
+    }
+    return difference;
+}
+
+Transform MakeTransform(const Vector3& scale, const Vector3& rotate, const Vector3& translate)
+{
+    Transform result;
+    result.scale = scale;
+    result.rotate = rotate;
+    result.translate = translate;
+    return result;
+}
+
+} // namespace
+
+TEST(TransformAnimation_LastKeyLandsOnDuration)
+{
+    // 1.05秒を30Hzで割り切れない長さにして、最後のキーが最後の値になるかを見る
+    TransformTrack track;
+    track.translate = { { 0.0f, { 0.0f, 0.0f, 0.0f } }, { 1.05f, { 1.0f, 2.0f, 3.0f } } };
+    TransformAnimation animation;
+    animation.Build({ track }, 30.0f, false);
+    CHECK(animation.GetKeyCount() == 33);
+
+    Transform result;
+    animation.Sample(1.05f, &result);
+    CHECK_NEAR(result.translate.x, 1.0f, 1.0e-4f);
+    CHECK_NEAR(result.translate.z, 3.0f, 1.0e-4f);
+    // 線形なキーは途中でも線形のまま(キーの間隔が一定)
+    for (float time = 0.0f; time <= 1.05f; time += 0.0123f) {
+        animation.Sample(time, &result);
+        CHECK_NEAR(result.translate.y, 2.0f * time / 1.05f, 2.0e-4f);
+    }
+
+    // ループでは終わりの直前が最後の値に近く、0秒で最初に戻る
+    TransformAnimation looped;
+    looped.Build({ track }, 30.0f, true);
+    looped.Sample(1.0499f, &result);
+    CHECK_NEAR(result.translate.x, 1.0f, 1.0e-3f);
+    looped.Sample(1.05f + 0.525f, &result);
+    CHECK_NEAR(result.translate.x, 0.5f, 1.0e-3f);
+}
+
+TEST(TransformAnimation_RotationTakesShortestArc)
+{
+    // 170度から-170度へは、360度近く戻らずに180度を通って20度だけ回る
+    TransformTrack track;
+    track.rotate = { { 0.0f, { 0.0f, 170.0f / 180.0f * kPi, 0.0f } }, { 1.0f, { 0.0f, -170.0f / 180.0f * kPi, 0.0f } } };
+    TransformAnimation animation;
+    animation.Build({ track }, 30.0f, false);
+
+    Transform result;
+    animation.Sample(0.5f, &result);
+    const Transform expected = MakeTransform({ 1.0f, 1.0f, 1.0f }, { 0.0f, kPi, 0.0f }, { 0.0f, 0.0f, 0.0f });
+    CHECK(MatrixDifference(result, expected) < 1.0e-3f);
+    for (float time = 0.0f; time <= 1.0f; time += 0.05f) {
+        animation.Sample(time, &result);
+        const float angle = (170.0f + 20.0f * time) / 180.0f * kPi;
+        CHECK(MatrixDifference(result, MakeTransform({ 1.0f, 1.0f, 1.0f }, { 0.0f, angle, 0.0f }, { 0.0f, 0.0f, 0.0f })) < 1.0e-3f);
+    }
+}
+
+TEST(TransformAnimation_QuaternionRoundTripMatchesEuler)
+{
+    // 動かない回転はオイラー角→クォータニオン→オイラー角で同じ向きに戻る
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> angle(-kPi, kPi);
+    std::vector<TransformTrack> tracks(37);
+    std::vector<Transform> expected(tracks.size());
+    for (size_t i = 0; i < tracks.size(); ++i) {
+        Vector3 rotate = { angle(random), angle(random) * 0.45f, angle(random) };
+        tracks[i].rotate = { { 0.0f, rotate }, { 1.0f, rotate } };
+        expected[i] = MakeTransform({ 1.0f, 1.0f, 1.0f }, rotate, { 0.0f, 0.0f, 0.0f });
+    }
+    TransformAnimation animation;
+    animation.Build(tracks);
+
+    // 端数のオブジェクトの後ろは書き換えない
+    std::vector<Transform> result(tracks.size() + 1);
+    result.back() = MakeTransform({ 7.0f, 7.0f, 7.0f }, { 7.0f, 7.0f, 7.0f }, { 7.0f, 7.0f, 7.0f });
+    animation.Sample(0.3f, result.data());
+    for (size_t i = 0; i < tracks.size(); ++i) {
+        CHECK(MatrixDifference(result[i], expected[i]) < 1.0e-3f);
+    }
+    CHECK(result.back().scale.x == 7.0f && result.back().translate.z == 7.0f);
+}
+
+TEST(TransformAnimation_MatchesSourceTracks)
+{
+    // 量子化と再サンプリングをしても、元のキーを直接補間したものとほぼ同じになる
+    std::mt19937 random(2);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    const uint32_t kObjects = 50;
+    std::vector<TransformTrack> tracks(kObjects);
+    for (TransformTrack& track : tracks) {
+        Vector3 rotate = { 0.0f, 0.0f, 0.0f };
+        for (int key = 0; key <= 4; ++key) {
+            const float time = float(key) * 0.5f;
+            track.scale.push_back({ time, { 1.0f + unit(random) * 0.5f, 1.0f + unit(random) * 0.5f, 1.0f + unit(random) * 0.5f } });
+            track.translate.push_back({ time, { unit(random) * 10.0f, unit(random) * 10.0f, unit(random) * 10.0f } });
+            track.rotate.push_back({ time, rotate });
+            rotate = { rotate.x + unit(random) * 0.3f, rotate.y + unit(random) * 0.3f, rotate.z + unit(random) * 0.3f };
+        }
+    }
+    TransformAnimation animation;
+    animation.Build(tracks, 60.0f, false);
+
+    std::vector<Transform> result(kObjects);
+    for (float time = 0.0f; time <= 2.0f; time += 0.1f) {
+        animation.Sample(time, result.data());
+        for (uint32_t i = 0; i < kObjects; ++i) {
+            const TransformTrack& track = tracks[i];
+            const int key = std::min(int(time / 0.5f), 3);
+            const float t = (time - key * 0.5f) / 0.5f;
+            auto lerp = [&](const std::vector<Keyframe>& keys) {
+                const Vector3& a = keys[key].value;
+                const Vector3& b = keys[key + 1].value;
+                return Vector3 { a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t };
+            };
+            CHECK_NEAR(result[i].translate.x, lerp(track.translate).x, 2.0e-3f);
+            CHECK_NEAR(result[i].scale.z, lerp(track.scale).z, 2.0e-3f);
+            // 回転はキーの時刻でだけ元と一致する(間はクォータニオンの補間になる)
+            if (std::abs(t) < 1.0e-4f) {
+                Transform expected = MakeTransform(result[i].scale, track.rotate[key].value, result[i].translate);
+                CHECK(MatrixDifference(result[i], expected) < 5.0e-3f);
+            }
+        }
+    }
+}
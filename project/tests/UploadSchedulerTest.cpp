@@ -0,0 +1,168 @@
+#include "FramePacer.h"
+#include "TestFramework.h"
+#include "UploadScheduler.h"
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <set>
+#include <vector>
+
+namespace {
+
+// コピーキューの代わり。提出したバッチをステージング領域に書き込み、GPUが終えた時点でまだ中身が残っているかを確かめる
+// 終わる前に次の提出で上書きされていれば、GPUは壊れたデータを読んだことになる
+class StandInCopyQueue {
+public:
+    StandInCopyQueue(uint64_t stagingBytes, double batchMilliseconds)
+        : timeline_(batchMilliseconds)
+        , staging_(stagingBytes, 0)
+    {
+    }
+
+    uint64_t Submit(const UploadBatch& batch)
+    {
+        Submitted submitted;
+        for (const UploadCopy& copy : batch.copies) {
+            if (copy.dedicated) {
+                ++dedicatedCopies_;
+                continue;
+            }
+            CHECK(copy.stagingOffset + copy.sizeInBytes <= staging_.size());
+            const uint8_t value = Pattern(copy);
+            std::fill(staging_.begin() + copy.stagingOffset, staging_.begin() + copy.stagingOffset + copy.sizeInBytes, value);
+            submitted.copies.push_back(copy);
+        }
+        submitted.fenceValue = timeline_.Signal();
+        submitted_.push_back(std::move(submitted));
+        return submitted_.back().fenceValue;
+    }
+
+    // GPUが終えた提出の中身を確かめ、終わった印を返す
+    uint64_t Retire()
+    {
+        const uint64_t completed = timeline_.GetCompletedValue();
+        while (!submitted_.empty() && submitted_.front().fenceValue <= completed) {
+            for (const UploadCopy& copy : submitted_.front().copies) {
+                const uint8_t value = Pattern(copy);
+                CHECK(std::all_of(staging_.begin() + copy.stagingOffset, staging_.begin() + copy.stagingOffset + copy.sizeInBytes, [value](uint8_t b) { return b == value; }));
+            }
+            submitted_.pop_front();
+        }
+        return completed;
+    }
+
+    SimulatedGpuTimeline& GetTimeline() { return timeline_; }
+    uint64_t GetDedicatedCopies() const { return dedicatedCopies_; }
+
+private:
+    struct Submitted {
+        uint64_t fenceValue = 0;
+        std::vector<UploadCopy> copies;
+    };
+
+    static uint8_t Pattern(const UploadCopy& copy) { return static_cast<uint8_t>(copy.ticket * 31 + copy.subresource * 7 + 1); }
+
+    SimulatedGpuTimeline timeline_;
+    std::vector<uint8_t> staging_;
+    std::deque<Submitted> submitted_;
+    uint64_t dedicatedCopies_ = 0;
+};
+
+} // namespace
+
+TEST(UploadScheduler_BatchesByBytesAndKeepsOrder)
+{
+    UploadScheduler scheduler(1 << 20, 1000, 256);
+    const uint32_t a = scheduler.Enqueue({ 400, 400, 400 });
+    const uint32_t b = scheduler.Enqueue({ 2000 });
+    std::vector<UploadBatch> batches;
+    uint64_t fence = 0;
+    const auto submit = [&](const UploadBatch& batch) {
+        batches.push_back(batch);
+        return ++fence;
+    };
+
+    CHECK(scheduler.Update(0, 1, submit).empty());
+    // 2つで800、3つ目は1000を超えるので次に回す
+    CHECK(batches.size() == 1 && batches[0].copies.size() == 2);
+    CHECK(batches[0].copies[0].stagingOffset % 256 == 0 && batches[0].copies[1].stagingOffset % 256 == 0);
+    CHECK(scheduler.GetStats().queuedCopies == 2);
+
+    CHECK(scheduler.Update(0, 8, submit).empty());
+    // 大きいものは1つでもそれだけで提出する
+    CHECK(batches.size() == 3);
+    CHECK(batches[1].copies.size() == 1 && batches[1].copies[0].ticket == a && batches[1].copies[0].subresource == 2);
+    CHECK(batches[2].copies.size() == 1 && batches[2].copies[0].ticket == b);
+    CHECK(scheduler.GetLastFenceValue() == 3);
+
+    // 3つ目のサブリソースが届くまでaは終わらない
+    CHECK(scheduler.Update(1, 8, submit).empty());
+    const std::vector<uint32_t> finished = scheduler.Update(3, 8, submit);
+    CHECK(finished.size() == 2 && finished[0] == a && finished[1] == b);
+    CHECK(scheduler.IsIdle());
+    CHECK(scheduler.GetStats().completedTickets == 2);
+    CHECK(scheduler.GetStats().staging.usedBytes == 0);
+}
+
+TEST(UploadScheduler_OversizedCopiesUseDedicatedBuffers)
+{
+    UploadScheduler scheduler(4096, 1 << 20, 256);
+    scheduler.Enqueue({ 100000, 512 });
+    std::vector<UploadBatch> batches;
+    uint64_t fence = 0;
+    scheduler.Update(0, 4, [&](const UploadBatch& batch) {
+        batches.push_back(batch);
+        return ++fence;
+    });
+    CHECK(batches.size() == 1 && batches[0].copies.size() == 2);
+    CHECK(batches[0].copies[0].dedicated);
+    CHECK(!batches[0].copies[1].dedicated);
+    CHECK(scheduler.GetStats().dedicatedCopies == 1);
+}
+
+// 乱数の大きさのテクスチャを流し続け、ステージング領域をGPUが読み終える前に上書きしないことを確かめる
+TEST(UploadScheduler_StandInQueueNeverOverwritesInFlightStaging)
+{
+    constexpr uint64_t kStagingBytes = 256 * 1024;
+    std::mt19937 random(11);
+    StandInCopyQueue queue(kStagingBytes, 3.0);
+    UploadScheduler scheduler(kStagingBytes, 64 * 1024, 512);
+
+    std::set<uint32_t> waiting;
+    uint32_t enqueued = 0;
+    uint32_t finishedCount = 0;
+    for (uint32_t frame = 0; frame < 600; ++frame) {
+        if (frame < 400) {
+            for (uint32_t i = random() % 3; i > 0; --i) {
+                // ミップの量は4分の1ずつ減る。たまにステージングより大きいものも混ぜる
+                std::vector<uint64_t> mips;
+                uint64_t size = random() % 16 == 0 ? kStagingBytes * 2 : 1024 + random() % (96 * 1024);
+                for (uint32_t mip = 0; mip < 1 + random() % 6 && size > 0; ++mip, size /= 4) {
+                    mips.push_back(size);
+                }
+                waiting.insert(scheduler.Enqueue(mips));
+                ++enqueued;
+            }
+        }
+        const uint64_t completed = queue.Retire();
+        for (uint32_t ticket : scheduler.Update(completed, 2, [&](const UploadBatch& batch) { return queue.Submit(batch); })) {
+            CHECK(waiting.erase(ticket) == 1);
+            ++finishedCount;
+        }
+        CHECK(scheduler.GetStats().staging.usedBytes <= kStagingBytes);
+        queue.GetTimeline().AdvanceCpu(1.0 + random() % 3);
+    }
+    // 残りを流し切る
+    while (!scheduler.IsIdle()) {
+        queue.GetTimeline().Wait(scheduler.GetLastFenceValue());
+        for (uint32_t ticket : scheduler.Update(queue.Retire(), 8, [&](const UploadBatch& batch) { return queue.Submit(batch); })) {
+            CHECK(waiting.erase(ticket) == 1);
+            ++finishedCount;
+        }
+    }
+    CHECK(waiting.empty());
+    CHECK(finishedCount == enqueued);
+    CHECK(queue.GetDedicatedCopies() > 0);
+    CHECK(queue.GetDedicatedCopies() == scheduler.GetStats().dedicatedCopies);
+    CHECK(scheduler.GetStats().staging.usedBytes == 0);
+}
@@ -0,0 +1,29 @@
+#include "ShaderPermutation.h"
+#include <cstdio>
+#include <string>
+
+// shader_variants.py から呼ぶ。バリアントの列挙の規則はShaderPermutationだけが持つ
+// 使い方: ShaderVariants <シェーダーのパス>
+// 有効なバリアントごとに「キー 名前 NAME=0/1 ...」を1行ずつ出力する。宣言がおかしければ1を返す
+int main(int argc, char** argv)
+{
+    if (argc != 2) {
+        std::fprintf(stderr, "usage: ShaderVariants <shader>\n");
+        return 2;
+    }
+    ShaderPermutation permutation;
+    if (!permutation.ParseFile(argv[1])) {
+        std::fprintf(stderr, "%s: bad keyword declaration\n", argv[1]);
+        return 1;
+    }
+    for (ShaderPermutation::Key key : permutation.GetVariants()) {
+        std::string line = std::to_string(key) + " " + permutation.GetVariantName(key);
+        // キーワードはASCIIの識別子なのでそのまま狭い文字にする
+        for (const std::wstring& define : permutation.GetDefines(key)) {
+            line += ' ';
+            line.append(define.begin(), define.end());
+        }
+        std::printf("%s\n", line.c_str());
+    }
+    return 0;
+}
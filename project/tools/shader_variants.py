@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+# シェーダーの「// @keyword NAME [requires OTHER...]」からバリアントを列挙し、マニフェストを書き出す
+# dxcが見つかれば全バリアントをコンパイルして、すべて通るか確かめる(WindowsのSDK付属版でもLinux版でも動く)
+# 列挙はtools/ShaderVariants.cpp(ShaderPermutationをそのまま使う)に任せ、規則をここで書き直さない
+# 実行時はShaderCacheが同じバリアントをコンパイルしてキャッシュするので、ここで作るDXILは読まれない
+import argparse
+import concurrent.futures
+import hashlib
+import os
+import shutil
+import subprocess
+import sys
+
+PROJECT_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+# (シェーダー, プロファイル)
+DEFAULT_SHADERS = [
+    ("Resources/shaders/object3d/Object3dPS.hlsl", "ps_6_0"),
+]
+
+
+def enumerate_variants(enumerator, shader_path):
+    """[(キー, 名前, [define...])] を返す。宣言がおかしければValueError"""
+    result = subprocess.run([enumerator, shader_path], capture_output=True, text=True)
+    if result.returncode != 0:
+        raise ValueError(result.stderr.strip() or f"{enumerator} failed")
+    variants = []
+    for line in result.stdout.splitlines():
+        words = line.split()
+        variants.append((int(words[0]), words[1], words[2:]))
+    return variants
+
+
+def compile_variant(dxc, shader_path, profile, defines, output_path, optimize):
+    arguments = [dxc, shader_path, "-E", "main", "-T", profile, "-Zpr", "-O3" if optimize else "-Od",
+                 "-I", os.path.dirname(shader_path), "-Fo", output_path]
+    for define in defines:
+        arguments += ["-D", define]
+    result = subprocess.run(arguments, capture_output=True, text=True)
+    return result.returncode, result.stdout + result.stderr
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Enumerate and compile shader permutations")
+    parser.add_argument("--enumerator", required=True, help="path to the ShaderVariants tool built from project/tests")
+    parser.add_argument("--dxc", help="path to dxc (default: dxc on PATH). An explicit path that does not exist is an error")
+    parser.add_argument("--output", default=os.path.join(PROJECT_DIR, "Resources/shaders/variants"))
+    parser.add_argument("--no-compile", action="store_true", help="only write the manifest")
+    parser.add_argument("--debug", action="store_true", help="compile with -Od instead of -O3")
+    args = parser.parse_args()
+    # 明示したのに見つからない(空文字も含む)ときは、コンパイルを飛ばさずに失敗する
+    if args.dxc is not None and (not args.dxc or shutil.which(args.dxc) is None):
+        print(f"dxc not found at '{args.dxc}'", file=sys.stderr)
+        return 1
+    if args.dxc is None:
+        args.dxc = shutil.which("dxc")
+
+    os.makedirs(args.output, exist_ok=True)
+    compile_jobs = []
+    with concurrent.futures.ThreadPoolExecutor(max_workers=os.cpu_count()) as executor:
+        for relative_path, profile in DEFAULT_SHADERS:
+            shader_path = os.path.join(PROJECT_DIR, relative_path)
+            with open(shader_path, "rb") as file:
+                source_bytes = file.read()
+            variants = enumerate_variants(args.enumerator, shader_path)
+            stem = os.path.splitext(os.path.basename(shader_path))[0]
+
+            # マニフェスト: 1行目に元ファイルと内容のハッシュ、以降はバリアントごとに キー 名前 define...
+            lines = [f"# {relative_path} {profile} sha1:{hashlib.sha1(source_bytes).hexdigest()}"]
+            for key, name, defines in variants:
+                lines.append(" ".join([str(key), name] + defines))
+                if args.dxc and not args.no_compile:
+                    output_path = os.path.join(args.output, f"{stem}.{key}.dxil")
+                    job = executor.submit(compile_variant, args.dxc, shader_path, profile, defines, output_path, not args.debug)
+                    compile_jobs.append((f"{stem} {name}", job))
+
+            manifest_path = os.path.join(args.output, f"{stem}.variants.txt")
+            with open(manifest_path, "w", newline="\n") as file:
+                file.write("\n".join(lines) + "\n")
+            print(f"{manifest_path}: {len(lines) - 1} variants")
+
+        failed = 0
+        for name, job in compile_jobs:
+            returncode, output = job.result()
+            if returncode != 0:
+                failed += 1
+                print(f"{name}: failed\n{output}", file=sys.stderr)
+            else:
+                print(f"{name}: ok")
+
+    if not args.dxc and not args.no_compile:
+        print("dxc not found; only the manifest was written", file=sys.stderr)
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())